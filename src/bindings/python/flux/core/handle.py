@@ -14,7 +14,7 @@ from contextlib import contextmanager
 import six
 
 from flux.wrapper import Wrapper
-from flux.rpc import RPC
+from flux.rpc import RPC, RPCBatch
 from flux.message import Message
 from flux.util import encode_topic, encode_payload
 from flux.core.inner import raw
@@ -198,6 +198,10 @@ class Flux(Wrapper):
         """ Create a new RPC object """
         return RPC(self, topic, payload, nodeid, flags)
 
+    def rpc_batch(self, flags=0):
+        """ Create a new RPC batch object """
+        return RPCBatch(self, flags)
+
     def event_create(self, topic, payload=None):
         """Create a new event message.
 
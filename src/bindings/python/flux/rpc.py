@@ -79,3 +79,70 @@ class RPC(Future):
         if resp_str is None:
             return None
         return json.loads(resp_str)
+
+
+class RPCBatch(Future):
+    """A batch of RPCs sent together, fulfilled when all have responses
+
+    Add requests with add(), which returns the index of the request in the
+    batch, then call send().  Responses are retrieved by index.
+    """
+
+    def __init__(self, flux_handle, flags=0):
+        if isinstance(flux_handle, Wrapper):
+            # keep the flux_handle alive for the lifetime of the batch
+            self.flux_handle = flux_handle
+            flux_handle = flux_handle.handle
+
+        future_handle = raw.flux_rpc_batch_create(flux_handle, flags)
+        super(RPCBatch, self).__init__(
+            future_handle,
+            prefixes=["flux_rpc_batch_", "flux_rpc_", "flux_future_"],
+            pimpl_t=RPC.RPCInnerWrapper,
+        )
+
+    def __len__(self):
+        return self.pimpl.count()
+
+    def add(self, topic, payload=None, nodeid=flux.constants.FLUX_NODEID_ANY):
+        return self.pimpl.add(encode_topic(topic), encode_payload(payload), nodeid)
+
+    def send(self):
+        self.pimpl.send()
+        return self
+
+    def error_string(self, index=None):
+        try:
+            if index is None:
+                errmsg = raw.flux_future_error_string(self.pimpl.handle)
+            else:
+                errmsg = raw.flux_rpc_batch_error_string(self.pimpl.handle, index)
+        except EnvironmentError:
+            return None
+        return errmsg.decode("utf-8") if errmsg else None
+
+    @interruptible
+    def get_str(self, index):
+        payload_str = ffi.new("char *[1]")
+        try:
+            raw.flux_rpc_batch_get(self.pimpl.handle, index, payload_str)
+        except EnvironmentError as error:
+            errmsg = self.error_string(index)
+            if errmsg is None:
+                raise
+            raise EnvironmentError(error.errno, errmsg) from None
+        if payload_str[0] == ffi.NULL:
+            return None
+        return ffi.string(payload_str[0]).decode("utf-8")
+
+    def get(self, index=None):
+        """Return the decoded response to request 'index', or if 'index'
+        is None, a list of all responses.  Raises EnvironmentError if the
+        response was an error.
+        """
+        if index is None:
+            return [self.get(i) for i in range(len(self))]
+        resp_str = self.get_str(index)
+        if resp_str is None:
+            return None
+        return json.loads(resp_str)
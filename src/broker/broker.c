@@ -1506,9 +1506,11 @@ done:
 }
 
 /* Handle events received by parent_cb.
- * On rank 0, publisher is wired to send events here also.
+ * On rank 0, publisher is wired to send events here also (via handle_event).
+ * If 'forward' is false, the event was received in a batch that has already
+ * been forwarded to this rank's children.
  */
-static int handle_event (broker_ctx_t *ctx, const flux_msg_t *msg)
+static int route_event (broker_ctx_t *ctx, const flux_msg_t *msg, bool forward)
 {
     uint32_t seq;
     const char *topic, *s;
@@ -1534,7 +1536,8 @@ static int handle_event (broker_ctx_t *ctx, const flux_msg_t *msg)
 
     /* Forward to this rank's children.
      */
-    overlay_mcast_child (ctx->overlay, msg);
+    if (forward)
+        overlay_mcast_child (ctx->overlay, msg);
 
     /* Internal services may install message handlers for events.
      */
@@ -1552,6 +1555,33 @@ static int handle_event (broker_ctx_t *ctx, const flux_msg_t *msg)
     return module_event_mcast (ctx->modhash, msg);
 }
 
+static int handle_event (broker_ctx_t *ctx, const flux_msg_t *msg)
+{
+    return route_event (ctx, msg, true);
+}
+
+static int handle_batched_event (const flux_msg_t *msg, void *arg)
+{
+    broker_ctx_t *ctx = arg;
+    return route_event (ctx, msg, false);
+}
+
+/* Forward a batch of events received from parent to this rank's children
+ * intact, then deliver its contents locally.
+ */
+static int handle_event_batch (broker_ctx_t *ctx, const flux_msg_t *msg)
+{
+    overlay_mcast_child (ctx->overlay, msg);
+    if (overlay_event_batch_unpack (ctx->overlay,
+                                    msg,
+                                    handle_batched_event,
+                                    ctx) < 0) {
+        flux_log_error (ctx->h, "dropping malformed event batch");
+        return -1;
+    }
+    return 0;
+}
+
 /* Handle messages from parent.
  */
 static void parent_cb (struct overlay *ov, void *arg)
@@ -1574,6 +1604,11 @@ static void parent_cb (struct overlay *ov, void *arg)
                 flux_log (ctx->h, LOG_ERR, "dropping malformed event");
                 goto done;
             }
+            if (overlay_event_is_batch (msg)) {
+                if (handle_event_batch (ctx, msg) < 0)
+                    goto done;
+                break;
+            }
             if (handle_event (ctx, msg) < 0)
                 goto done;
             break;
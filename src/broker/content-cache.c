@@ -14,10 +14,14 @@
 #include "config.h"
 #endif
 #include <inttypes.h>
+#include <arpa/inet.h>
 #include <czmq.h>
+#include <lz4.h>
+#include <jansson.h>
 #include <flux/core.h>
 #include "src/common/libutil/errno_safe.h"
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 #include "src/common/libutil/iterators.h"
 #include "src/common/libutil/log.h"
 
@@ -28,7 +32,6 @@ static const uint32_t default_cache_purge_target_entries = 1024*1024;
 static const uint32_t default_cache_purge_target_size = 1024*1024*16;
 
 static const uint32_t default_cache_purge_old_entry = 5;
-static const uint32_t default_cache_purge_large_entry = 256;
 
 /* Raise the max blob size value to 1GB so that large KVS values
  * (including KVS directories) can be supported while the KVS transitions
@@ -39,6 +42,10 @@ static const uint32_t default_blob_size_limit = 1048576*1024;
 
 static const uint32_t default_flush_batch_limit = 256;
 
+/* Blobs of at least this size are LZ4 compressed when sent between brokers.
+ */
+static const uint32_t default_compress_threshold = 256;
+
 struct cache_entry {
     flux_t *h;
     void *data;
@@ -49,9 +56,12 @@ struct cache_entry {
                                     /*   or to backing store (rank 0) */
     uint8_t load_pending:1;
     uint8_t store_pending:1;
+    uint8_t lru:1;                  /* entry is on the LRU list */
     zlist_t *load_requests;
     zlist_t *store_requests;
     int lastused;
+    struct cache_entry *lru_prev;
+    struct cache_entry *lru_next;
 };
 
 struct content_cache {
@@ -59,7 +69,11 @@ struct content_cache {
     flux_msg_handler_t **handlers;
     uint32_t rank;
     zhash_t *entries;
+    struct cache_entry *lru_head;   /* least recently used clean entry */
+    struct cache_entry *lru_tail;   /* most recently used clean entry */
     uint8_t backing:1;              /* 'content.backing' service available */
+    uint8_t backing_noload_batch:1; /* backing lacks load-batch */
+    uint8_t backing_nostore_batch:1;/* backing lacks store-batch */
     char *backing_name;
     char hash_name[BLOBREF_MAX_STRING_SIZE];
     zlist_t *flush_requests;
@@ -72,15 +86,31 @@ struct content_cache {
     uint32_t purge_target_entries;
     uint32_t purge_target_size;
     uint32_t purge_old_entry;
-    uint32_t purge_large_entry;
+    uint32_t purge_max_size;        /* hard limit on acct_size (0=none) */
 
     uint32_t acct_size;             /* total size of all cache entries */
     uint32_t acct_valid;            /* count of valid cache entries */
     uint32_t acct_dirty;            /* count of dirty cache entries */
+    uint64_t hit_count;             /* load requests satisfied from cache */
+    uint64_t miss_count;            /* load requests sent to next level */
+    uint64_t evict_count;           /* entries purged from cache */
+
+    char *compression;              /* "lz4" or "none" */
+    uint32_t compress_threshold;
+    void *compress_buf;
+    int compress_bufsize;
+    uint64_t compress_count;        /* blobs sent compressed */
+    uint64_t compress_saved;        /* bytes saved by compression */
+    uint64_t decompress_count;      /* compressed blobs received */
 };
 
 static void flush_respond (content_cache_t *cache);
 static int cache_flush (content_cache_t *cache);
+static void cache_purge_max (content_cache_t *cache);
+static int respond_load (content_cache_t *cache,
+                         const flux_msg_t *msg,
+                         const void *data,
+                         int len);
 
 static void request_list_destroy (zlist_t **l)
 {
@@ -113,6 +143,24 @@ static void request_list_respond_raw (zlist_t **l,
     }
 }
 
+/* Same as above, but responses to content.load requests may be compressed.
+ */
+static void request_list_respond_load (zlist_t **l,
+                                       content_cache_t *cache,
+                                       const void *data,
+                                       int len)
+{
+    if (*l) {
+        const flux_msg_t *msg;
+        while ((msg = zlist_pop (*l))) {
+            if (respond_load (cache, msg, data, len) < 0)
+                flux_log_error (cache->h, "%s:", __FUNCTION__);
+            flux_msg_decref (msg);
+        }
+        zlist_destroy (l);
+    }
+}
+
 /* Same as above only send errnum, errmsg response
  */
 static void request_list_respond_error (zlist_t **l,
@@ -151,6 +199,204 @@ static int request_list_add (zlist_t **l, const flux_msg_t *msg)
     return 0;
 }
 
+/* Compression of blobs sent between brokers
+ *
+ * A content.load request with FLUX_MSGFLAG_USER1 set indicates that the
+ * sender accepts a compressed response.  A content.load response or a
+ * content.store request with FLUX_MSGFLAG_USER1 set carries a compressed
+ * blob, consisting of the uncompressed size as a 4 byte integer in network
+ * byte order, followed by an LZ4 block.  Blobs are only sent compressed
+ * if they are at least compress_threshold bytes and compression makes
+ * them smaller.
+ *
+ * The batch RPCs use FLUX_MSGFLAG_USER1 the same way, but since only some
+ * blobs in a batch may be worth compressing, every blob element of a
+ * flagged content.store-batch request or content.load-batch response
+ * starts with the uncompressed size.  If the rest of the element is
+ * shorter than that, it is an LZ4 block, otherwise it is the blob itself.
+ */
+
+static bool compression_enabled (content_cache_t *cache)
+{
+    return !strcmp (cache->compression, "lz4");
+}
+
+/* Grow cache->compress_buf to at least 'size' bytes.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int compress_buf_reserve (content_cache_t *cache, int size)
+{
+    if (cache->compress_bufsize < size) {
+        void *buf;
+        if (!(buf = realloc (cache->compress_buf, size)))
+            return -1;
+        cache->compress_buf = buf;
+        cache->compress_bufsize = size;
+    }
+    return 0;
+}
+
+/* Compress 'data' into cache->compress_buf.
+ * Returns 0 with 'cdata' and 'clen' set on success, or -1 if the blob
+ * was not compressed, in which case it should be sent as is.
+ */
+static int blob_compress (content_cache_t *cache,
+                          const void *data,
+                          int len,
+                          const void **cdata,
+                          int *clen)
+{
+    uint32_t size = htonl (len);
+    int bound;
+    int n;
+
+    if (!compression_enabled (cache) || len < cache->compress_threshold)
+        return -1;
+    bound = LZ4_compressBound (len) + sizeof (size);
+    if (compress_buf_reserve (cache, bound) < 0)
+        return -1;
+    n = LZ4_compress_default (data,
+                              (char *)cache->compress_buf + sizeof (size),
+                              len,
+                              bound - sizeof (size));
+    if (n <= 0 || n + sizeof (size) >= len)
+        return -1;
+    memcpy (cache->compress_buf, &size, sizeof (size));
+    *cdata = cache->compress_buf;
+    *clen = n + sizeof (size);
+    cache->compress_count++;
+    cache->compress_saved += len - *clen;
+    return 0;
+}
+
+/* Decompress 'cdata' into a new buffer that the caller must free.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int blob_decompress (content_cache_t *cache,
+                            const void *cdata,
+                            int clen,
+                            void **data,
+                            int *len)
+{
+    uint32_t size;
+    void *buf;
+    int n;
+
+    if (clen < sizeof (size)) {
+        errno = EPROTO;
+        return -1;
+    }
+    memcpy (&size, cdata, sizeof (size));
+    size = ntohl (size);
+    if (size > cache->blob_size_limit) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (!(buf = malloc (size > 0 ? size : 1)))
+        return -1;
+    n = LZ4_decompress_safe ((char *)cdata + sizeof (size),
+                             buf,
+                             clen - sizeof (size),
+                             size);
+    if (n < 0 || n != size) {
+        free (buf);
+        errno = EPROTO;
+        return -1;
+    }
+    *data = buf;
+    *len = size;
+    cache->decompress_count++;
+    return 0;
+}
+
+/* Append blob to a batch that will be sent with FLUX_MSGFLAG_USER1 set,
+ * compressing it if worthwhile.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int batch_append_blob (content_cache_t *cache,
+                              struct blobvec *bv,
+                              const void *data,
+                              int len)
+{
+    uint32_t size = htonl (len);
+    const void *cdata;
+    int clen;
+
+    if (blob_compress (cache, data, len, &cdata, &clen) < 0) {
+        if (compress_buf_reserve (cache, len + sizeof (size)) < 0)
+            return -1;
+        memcpy (cache->compress_buf, &size, sizeof (size));
+        memcpy ((char *)cache->compress_buf + sizeof (size), data, len);
+        cdata = cache->compress_buf;
+        clen = len + sizeof (size);
+    }
+    return blobvec_append (bv, cdata, clen);
+}
+
+/* Decode a blob element of a batch received with FLUX_MSGFLAG_USER1 set.
+ * If it was compressed, 'buf' is set to a new buffer holding the blob,
+ * that the caller must free.  Otherwise 'buf' is set to NULL and 'data'
+ * points into 'cdata'.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int batch_decode_blob (content_cache_t *cache,
+                              const void *cdata,
+                              int clen,
+                              const void **data,
+                              int *len,
+                              void **buf)
+{
+    uint32_t size;
+
+    if (clen < sizeof (size)) {
+        errno = EPROTO;
+        return -1;
+    }
+    memcpy (&size, cdata, sizeof (size));
+    size = ntohl (size);
+    if (clen - sizeof (size) > size) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (clen - sizeof (size) == size) {
+        *data = (const char *)cdata + sizeof (size);
+        *len = size;
+        *buf = NULL;
+        return 0;
+    }
+    if (blob_decompress (cache, cdata, clen, buf, len) < 0)
+        return -1;
+    *data = *buf;
+    return 0;
+}
+
+/* Respond to content.load request with blob, compressing it if the
+ * requestor indicated it is acceptable.
+ */
+static int respond_load (content_cache_t *cache,
+                         const flux_msg_t *msg,
+                         const void *data,
+                         int len)
+{
+    const void *cdata;
+    int clen;
+    flux_msg_t *rmsg;
+    int rc = -1;
+
+    if (!flux_msg_is_user1 (msg)
+        || blob_compress (cache, data, len, &cdata, &clen) < 0)
+        return flux_respond_raw (cache->h, msg, data, len);
+    if (!(rmsg = flux_response_derive (msg, 0))
+        || flux_msg_set_payload (rmsg, cdata, clen) < 0
+        || flux_msg_set_user1 (rmsg) < 0
+        || flux_send (cache->h, rmsg, 0) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_msg_destroy (rmsg);
+    return rc;
+}
+
 /* Destroy a cache entry
  */
 static void cache_entry_destroy (void *arg)
@@ -216,6 +462,55 @@ done:
     return rc;
 }
 
+/* LRU list
+ *
+ * Entries that are valid and not dirty may be dropped from the cache
+ * without data loss.  These are kept on an intrusive doubly linked list,
+ * ordered from least to most recently used, so that purging is
+ * proportional to the number of entries purged rather than cache size.
+ */
+
+static void lru_unlink (content_cache_t *cache, struct cache_entry *e)
+{
+    if (e->lru) {
+        if (e->lru_prev)
+            e->lru_prev->lru_next = e->lru_next;
+        else
+            cache->lru_head = e->lru_next;
+        if (e->lru_next)
+            e->lru_next->lru_prev = e->lru_prev;
+        else
+            cache->lru_tail = e->lru_prev;
+        e->lru_prev = e->lru_next = NULL;
+        e->lru = 0;
+    }
+}
+
+static void lru_append (content_cache_t *cache, struct cache_entry *e)
+{
+    assert (!e->lru);
+    e->lru_prev = cache->lru_tail;
+    e->lru_next = NULL;
+    if (cache->lru_tail)
+        cache->lru_tail->lru_next = e;
+    else
+        cache->lru_head = e;
+    cache->lru_tail = e;
+    e->lru = 1;
+}
+
+/* Mark entry as used in the current epoch.  Call this whenever an entry
+ * is accessed or its valid/dirty state changes, so it is (re)placed at the
+ * most recently used end of the LRU list if it is eligible for purge.
+ */
+static void cache_entry_touch (content_cache_t *cache, struct cache_entry *e)
+{
+    e->lastused = cache->epoch;
+    lru_unlink (cache, e);
+    if (e->valid && !e->dirty)
+        lru_append (cache, e);
+}
+
 /* Insert a cache entry, by blobref.
  * Returns 0 on success, -1 on failure with errno set.
  * Side effect: destroys entry on failure.
@@ -259,6 +554,7 @@ static void remove_entry (content_cache_t *cache, struct cache_entry *e)
     }
     if (e->dirty)
         cache->acct_dirty--;
+    lru_unlink (cache, e);
     zhash_delete (cache->entries, e->blobref);
 }
 
@@ -277,35 +573,45 @@ static void cache_load_continuation (flux_future_t *f, void *arg)
 {
     content_cache_t *cache = arg;
     struct cache_entry *e = flux_future_aux_get (f, "entry");
+    const flux_msg_t *msg;
     const void *data = NULL;
     int len = 0;
+    void *buf = NULL;
 
     e->load_pending = 0;
-    if (flux_content_load_get (f, &data, &len) < 0) {
+    if (flux_future_get (f, (const void **)&msg) < 0
+        || flux_content_load_get (f, &data, &len) < 0) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
         if (errno != ENOENT)
             flux_log_error (cache->h, "content load");
         goto error;
     }
+    if (flux_msg_is_user1 (msg)) {
+        if (blob_decompress (cache, data, len, &buf, &len) < 0) {
+            flux_log_error (cache->h, "content load");
+            goto error;
+        }
+        data = buf;
+    }
     if (cache_entry_fill (e, data, len) < 0) {
         flux_log_error (cache->h, "content load");
         goto error;
     }
+    free (buf);
+    buf = NULL;
     if (!e->valid) {
         e->valid = 1;
         cache->acct_valid++;
         cache->acct_size += len;
     }
-    e->lastused = cache->epoch;
-    request_list_respond_raw (&e->load_requests,
-                              cache->h,
-                              e->data,
-                              e->len,
-                              "load");
+    cache_entry_touch (cache, e);
+    request_list_respond_load (&e->load_requests, cache, e->data, e->len);
     flux_future_destroy (f);
+    cache_purge_max (cache);
     return;
 error:
+    ERRNO_SAFE_WRAP (free, buf);
     request_list_respond_error (&e->load_requests,
                                 cache->h,
                                 errno,
@@ -315,18 +621,40 @@ error:
     flux_future_destroy (f);
 }
 
+/* Send content.load request to TBON parent, indicating that a compressed
+ * response is acceptable if compression is enabled.
+ */
+static flux_future_t *cache_load_upstream (content_cache_t *cache,
+                                           const char *blobref)
+{
+    flux_msg_t *msg;
+    flux_future_t *f = NULL;
+
+    if (!(msg = flux_request_encode_raw ("content.load",
+                                         blobref,
+                                         strlen (blobref) + 1)))
+        return NULL;
+    if (compression_enabled (cache) && flux_msg_set_user1 (msg) < 0)
+        goto done;
+    f = flux_rpc_message (cache->h, msg, FLUX_NODEID_UPSTREAM, 0);
+done:
+    flux_msg_destroy (msg);
+    return f;
+}
+
 static int cache_load (content_cache_t *cache, struct cache_entry *e)
 {
     flux_future_t *f;
     int saved_errno = 0;
-    int flags = CONTENT_FLAG_UPSTREAM;
     int rc = -1;
 
     if (e->load_pending)
         return 0;
     if (cache->rank == 0)
-        flags = CONTENT_FLAG_CACHE_BYPASS;
-    if (!(f = flux_content_load (cache->h, e->blobref, flags))) {
+        f = flux_content_load (cache->h, e->blobref, CONTENT_FLAG_CACHE_BYPASS);
+    else
+        f = cache_load_upstream (cache, e->blobref);
+    if (!f) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
         saved_errno = errno;
@@ -387,13 +715,16 @@ void content_load_request (flux_t *h, flux_msg_handler_t *mh,
             flux_log_error (h, "content load");
             goto error;
         }
+        cache->miss_count++;
         return; /* RPC continuation will respond to msg */
     }
-    e->lastused = cache->epoch;
+    cache->hit_count++;
+    cache_entry_touch (cache, e);
     data = e->data;
     len = e->len;
-    if (flux_respond_raw (h, msg, data, len) < 0)
+    if (respond_load (cache, msg, data, len) < 0)
         flux_log_error (h, "content load: flux_respond_raw");
+    cache_purge_max (cache);
     return;
 error:
     if (flux_respond_error (h, msg, errno, NULL) < 0)
@@ -460,6 +791,7 @@ static void cache_store_continuation (flux_future_t *f, void *arg)
     if (e->dirty) {
         cache->acct_dirty--;
         e->dirty = 0;
+        cache_entry_touch (cache, e);
     }
     request_list_respond_raw (&e->store_requests,
                               cache->h,
@@ -479,11 +811,34 @@ error:
     cache_resume_flush (cache);
 }
 
+/* Send content.store request to TBON parent, compressing the blob
+ * if compression is enabled and worthwhile.
+ */
+static flux_future_t *cache_store_upstream (content_cache_t *cache,
+                                            const void *data,
+                                            int len)
+{
+    const void *cdata;
+    int clen;
+    flux_msg_t *msg;
+    flux_future_t *f = NULL;
+
+    if (blob_compress (cache, data, len, &cdata, &clen) < 0)
+        return flux_content_store (cache->h, data, len, CONTENT_FLAG_UPSTREAM);
+    if (!(msg = flux_request_encode_raw ("content.store", cdata, clen)))
+        return NULL;
+    if (flux_msg_set_user1 (msg) < 0)
+        goto done;
+    f = flux_rpc_message (cache->h, msg, FLUX_NODEID_UPSTREAM, 0);
+done:
+    flux_msg_destroy (msg);
+    return f;
+}
+
 static int cache_store (content_cache_t *cache, struct cache_entry *e)
 {
     flux_future_t *f;
     int saved_errno = 0;
-    int flags = CONTENT_FLAG_UPSTREAM;
     int rc = -1;
 
     assert (e->valid);
@@ -493,9 +848,14 @@ static int cache_store (content_cache_t *cache, struct cache_entry *e)
     if (cache->rank == 0) {
         if (cache->flush_batch_count >= cache->flush_batch_limit)
             return 0;
-        flags = CONTENT_FLAG_CACHE_BYPASS;
+        f = flux_content_store (cache->h,
+                                e->data,
+                                e->len,
+                                CONTENT_FLAG_CACHE_BYPASS);
     }
-    if (!(f = flux_content_store (cache->h, e->data, e->len, flags))) {
+    else
+        f = cache_store_upstream (cache, e->data, e->len);
+    if (!f) {
         saved_errno = errno;
         flux_log_error (cache->h, "content store");
         goto done;
@@ -519,152 +879,1029 @@ done:
     return rc;
 }
 
-static void content_store_request (flux_t *h, flux_msg_handler_t *mh,
-                                   const flux_msg_t *msg, void *arg)
+/* Add blob to the cache, making its entry valid and dirty if it was not
+ * already valid.  The blobref is computed and copied to 'blobref'.
+ * Returns 0 with 'ep' set to the entry on success, -1 on failure with
+ * errno set.
+ */
+static int cache_store_blob (content_cache_t *cache,
+                             const void *data,
+                             int len,
+                             char *blobref,
+                             int blobref_size,
+                             struct cache_entry **ep)
 {
-    content_cache_t *cache = arg;
-    const void *data;
-    int len;
-    struct cache_entry *e = NULL;
-    char blobref[BLOBREF_MAX_STRING_SIZE];
+    struct cache_entry *e;
 
-    if (flux_request_decode_raw (msg, NULL, &data, &len) < 0)
-        goto error;
     if (len > cache->blob_size_limit) {
         errno = EFBIG;
-        goto error;
+        return -1;
     }
     if (blobref_hash (cache->hash_name, (uint8_t *)data, len, blobref,
-                      sizeof (blobref)) < 0)
-        goto error;
-
+                      blobref_size) < 0)
+        return -1;
     if (!(e = lookup_entry (cache, blobref))) {
-        if (!(e = cache_entry_create (h, blobref)))
-            goto error;
+        if (!(e = cache_entry_create (cache->h, blobref)))
+            return -1;
         if (insert_entry (cache, e) < 0)
-            goto error; /* insert destroys 'e' on failure */
+            return -1; /* insert destroys 'e' on failure */
     }
     if (!e->valid) {
         if (cache_entry_fill (e, data, len) < 0)
-            goto error;
+            return -1;
         if (!e->valid) {
             e->valid = 1;
             cache->acct_valid++;
             cache->acct_size += len;
         }
-        request_list_respond_raw (&e->load_requests,
-                                  cache->h,
-                                  e->data,
-                                  e->len,
-                                  "load");
+        request_list_respond_load (&e->load_requests,
+                                   cache,
+                                   e->data,
+                                   e->len);
         if (!e->dirty) {
             e->dirty = 1;
             cache->acct_dirty++;
         }
     }
-    e->lastused = cache->epoch;
-    if (e->dirty) {
-        if (cache->rank > 0 || cache->backing) {
-            if (cache_store (cache, e) < 0)
+    cache_entry_touch (cache, e);
+    /* When a backing store module is unloaded, it will clear
+     * cache->backing then attempt to store all its blobs.  Any of
+     * those still in cache need to be marked dirty.
+     */
+    if (!e->dirty && cache->rank == 0 && !cache->backing) {
+        e->dirty = 1;
+        cache->acct_dirty++;
+        lru_unlink (cache, e);
+    }
+    *ep = e;
+    return 0;
+}
+
+static void content_store_request (flux_t *h, flux_msg_handler_t *mh,
+                                   const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    const void *data;
+    int len;
+    void *buf = NULL;
+    struct cache_entry *e = NULL;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+
+    if (flux_request_decode_raw (msg, NULL, &data, &len) < 0)
+        goto error;
+    if (flux_msg_is_user1 (msg)) {
+        if (blob_decompress (cache, data, len, &buf, &len) < 0)
+            goto error;
+        data = buf;
+    }
+    if (cache_store_blob (cache, data, len, blobref, sizeof (blobref), &e) < 0)
+        goto error;
+    if (e->dirty && (cache->rank > 0 || cache->backing)) {
+        if (cache_store (cache, e) < 0)
+            goto error;
+        if (cache->rank > 0) {  /* write-through */
+            if (request_list_add (&e->store_requests, msg) < 0)
                 goto error;
-            if (cache->rank > 0) {  /* write-through */
-                if (request_list_add (&e->store_requests, msg) < 0)
-                    goto error;
-                return;
-            }
-        }
-    } else {
-        /* When a backing store module is unloaded, it will clear
-         * cache->backing then attempt to store all its blobs.  Any of
-         * those still in cache need to be marked dirty.
-         */
-        if (cache->rank == 0 && !cache->backing) {
-            e->dirty = 1;
-            cache->acct_dirty++;
+            free (buf);
+            return;
         }
     }
     if (flux_respond_raw (h, msg, blobref, strlen (blobref) + 1) < 0)
         flux_log_error (h, "content store: flux_respond_raw");
+    free (buf);
+    cache_purge_max (cache);
     return;
 error:
     if (flux_respond_error (h, msg, errno, NULL) < 0)
         flux_log_error (h, "content store: flux_respond_error");
+    free (buf);
 }
 
-/* Backing store is enabled/disabled by modules that provide the
- * 'content.backing' service.  At module load time, the backing module
- * informs the content service of its availability, and entries are
- * asynchronously duplicated on the backing store and made eligible for
- * dropping from the rank 0 cache.
+/* Batch operations
+ *
+ * content.load-batch and content.store-batch carry many blobrefs or blobs
+ * per message, encoded as a blobvec, so that a cold cache directory walk
+ * or a flush costs one round trip per batch rather than one per blob.
+ *
+ * For load-batch, blobs that are valid in the cache are returned directly.
+ * The rest are requested from the TBON parent, or on rank 0 from the
+ * backing store, in a single batch request and added to the cache when it
+ * completes.  The response has one element per requested blobref, in order,
+ * with an error element for each blob that could not be loaded.
+ *
+ * For store-batch, blobs are added to the cache as for content.store.
+ * On rank > 0, dirty blobs are sent upstream in a single batch request
+ * (write-through), and the response is deferred until it completes.
+ * On rank 0, dirty blobs are flushed to the backing store in the
+ * background (write-back).  The response is a blobvec of blobrefs.
  */
 
-static int cache_flush (content_cache_t *cache)
-{
-    struct cache_entry *e;
-    const char *key;
-    int saved_errno = 0;
-    int count = 0;
-    int rc = 0;
+struct load_slot {
+    const char *blobref;            /* points into request payload */
+    const void *data;
+    void *copy;                     /* owned copy of 'data', if any */
+    int len;
+    int errnum;
+    bool miss;
+};
 
-    if (cache->acct_dirty - cache->flush_batch_count == 0
-            || cache->flush_batch_count >= cache->flush_batch_limit)
-        return 0;
+struct load_batch {
+    content_cache_t *cache;
+    const flux_msg_t *msg;
+    int count;
+    int miss_count;
+    bool each;                      /* misses were loaded one at a time */
+    struct load_slot slots[];
+};
 
-    flux_log (cache->h, LOG_DEBUG, "content flush begin");
-    FOREACH_ZHASH (cache->entries, key, e) {
-        if (!e->dirty || e->store_pending)
-            continue;
-        if (cache_store (cache, e) < 0) {
-            saved_errno = errno;
-            rc = -1;
-        }
-        count++;
-        if (cache->flush_batch_count >= cache->flush_batch_limit)
-            break;
-    }
-    flux_log (cache->h, LOG_DEBUG, "content flush +%d (dirty=%d pending=%d)",
-              count, cache->acct_dirty, cache->flush_batch_count);
-    if (rc < 0)
+static void load_batch_destroy (struct load_batch *lb)
+{
+    if (lb) {
+        int saved_errno = errno;
+        int i;
+        for (i = 0; i < lb->count; i++)
+            free (lb->slots[i].copy);
+        flux_msg_decref (lb->msg);
+        free (lb);
         errno = saved_errno;
-    return rc;
+    }
 }
 
-static void content_register_backing_request (flux_t *h,
-                                              flux_msg_handler_t *mh,
-                                              const flux_msg_t *msg,
-                                              void *arg)
+static struct load_batch *load_batch_create (content_cache_t *cache,
+                                             const flux_msg_t *msg,
+                                             int count)
 {
-    content_cache_t *cache = arg;
-    const char *name;
-    const char *errstr = NULL;
+    struct load_batch *lb;
 
-    if (flux_request_unpack (msg, NULL, "{s:s}", "name", &name) < 0)
-        goto error;
-    if (cache->rank != 0) {
-        errno = EINVAL;
-        errstr = "content backing store can only be registered on rank 0";
+    if (!(lb = calloc (1, sizeof (*lb) + count * sizeof (lb->slots[0]))))
+        return NULL;
+    lb->cache = cache;
+    lb->msg = flux_msg_incref (msg);
+    lb->count = count;
+    return lb;
+}
+
+/* Respond to content.load-batch request, compressing blobs if the
+ * requestor indicated it is acceptable.
+ */
+static void load_batch_respond (struct load_batch *lb)
+{
+    flux_t *h = lb->cache->h;
+    bool compress = flux_msg_is_user1 (lb->msg);
+    struct blobvec *bv;
+    flux_msg_t *rmsg = NULL;
+    const void *buf;
+    int len;
+    int i;
+
+    if (!(bv = blobvec_create ()))
         goto error;
+    for (i = 0; i < lb->count; i++) {
+        struct load_slot *slot = &lb->slots[i];
+        int rc;
+        if (slot->errnum)
+            rc = blobvec_append_error (bv, slot->errnum);
+        else if (compress)
+            rc = batch_append_blob (lb->cache, bv, slot->data, slot->len);
+        else
+            rc = blobvec_append (bv, slot->data, slot->len);
+        if (rc < 0)
+            goto error;
     }
-    if (cache->backing) {
-        errno = EBUSY;
-        errstr = "content backing store is already active";
-        goto error;
+    blobvec_encode (bv, &buf, &len);
+    if (!compress) {
+        if (flux_respond_raw (h, lb->msg, buf, len) < 0)
+            flux_log_error (h, "content load-batch: flux_respond_raw");
     }
-    /* cache->backing_name is either set to the initial value of the
-     * "content.backing-module" attribute (e.g. from broker command line),
-     * or to the first-registered backing store name.  Once set, it cannot
-     * be changed.
-     */
-    if (!cache->backing_name) {
-        if (!(cache->backing_name = strdup (name)))
-            goto error;
+    else {
+        if (!(rmsg = flux_response_derive (lb->msg, 0))
+            || flux_msg_set_payload (rmsg, buf, len) < 0
+            || flux_msg_set_user1 (rmsg) < 0
+            || flux_send (h, rmsg, 0) < 0)
+            flux_log_error (h, "content load-batch: flux_send");
+        flux_msg_destroy (rmsg);
     }
-    if (strcmp (cache->backing_name, name) != 0) {
+    blobvec_destroy (bv);
+    return;
+error:
+    if (flux_respond_error (h, lb->msg, errno, NULL) < 0)
+        flux_log_error (h, "content load-batch: flux_respond_error");
+    blobvec_destroy (bv);
+}
+
+/* Add a blob received in a batch load response to the cache.
+ * Entries with a load in progress are left alone, since that load's
+ * continuation still holds a reference to them.
+ */
+static int cache_insert_loaded (content_cache_t *cache,
+                                const char *blobref,
+                                const void *data,
+                                int len)
+{
+    struct cache_entry *e;
+
+    if (!(e = lookup_entry (cache, blobref))) {
+        if (!(e = cache_entry_create (cache->h, blobref)))
+            return -1;
+        if (insert_entry (cache, e) < 0)
+            return -1; /* insert destroys 'e' on failure */
+    }
+    if (e->valid || e->load_pending)
+        return 0;
+    if (cache_entry_fill (e, data, len) < 0) {
+        if (!e->load_requests && !e->store_requests)
+            remove_entry (cache, e);
+        return -1;
+    }
+    e->valid = 1;
+    cache->acct_valid++;
+    cache->acct_size += len;
+    cache_entry_touch (cache, e);
+    request_list_respond_load (&e->load_requests, cache, e->data, e->len);
+    return 0;
+}
+
+static int load_batch_send (content_cache_t *cache, struct load_batch *lb);
+
+/* Get the result for the miss at 'index' of a batch.
+ */
+static int load_batch_get (flux_future_t *f,
+                           struct load_batch *lb,
+                           int index,
+                           const void **data,
+                           int *len)
+{
+    flux_future_t *child;
+    char name[16];
+
+    if (!lb->each)
+        return flux_content_load_batch_get (f, index, data, len);
+    snprintf (name, sizeof (name), "%d", index);
+    if (!(child = flux_future_get_child (f, name)))
+        return -1;
+    return flux_content_load_get (child, data, len);
+}
+
+/* Send the misses in 'lb' again, after the backing store failed the
+ * batch with ENOSYS.  Since 'lb' belongs to a future that is about to be
+ * destroyed, its slots are moved to a new batch.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int load_batch_resend (content_cache_t *cache, struct load_batch *lb)
+{
+    struct load_batch *nlb;
+
+    if (!(nlb = load_batch_create (cache, lb->msg, lb->count)))
+        return -1;
+    memcpy (nlb->slots, lb->slots, lb->count * sizeof (lb->slots[0]));
+    nlb->miss_count = lb->miss_count;
+    if (load_batch_send (cache, nlb) < 0) {
+        nlb->count = 0; /* slots still belong to 'lb' */
+        load_batch_destroy (nlb);
+        return -1;
+    }
+    lb->count = 0; /* slots belong to 'nlb' now */
+    return 0;
+}
+
+static void load_batch_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    struct load_batch *lb = flux_future_aux_get (f, "batch");
+    const flux_msg_t *msg;
+    bool compressed = false;
+    int index = 0;
+    int i;
+
+    if (!lb->each && flux_future_get (f, (const void **)&msg) == 0)
+        compressed = flux_msg_is_user1 (msg);
+    /* If the backing store does not support load-batch, remember that
+     * and load the blobs one at a time.
+     */
+    if (cache->rank == 0
+        && cache->backing
+        && !lb->each
+        && flux_future_get (f, NULL) < 0
+        && errno == ENOSYS) {
+        flux_log (cache->h, LOG_DEBUG, "content load-batch: %s",
+                  "unsupported by backing store, loading blobs singly");
+        cache->backing_noload_batch = 1;
+        if (load_batch_resend (cache, lb) == 0) {
+            flux_future_destroy (f);
+            return;
+        }
+        flux_log_error (cache->h, "content load-batch");
+    }
+    for (i = 0; i < lb->count; i++) {
+        struct load_slot *slot = &lb->slots[i];
+
+        if (!slot->miss)
+            continue;
+        if (load_batch_get (f,
+                            lb,
+                            index++,
+                            &slot->data,
+                            &slot->len) < 0) {
+            if (errno == ENOSYS && cache->rank == 0)
+                errno = ENOENT;
+            if (errno != ENOENT)
+                flux_log_error (cache->h, "content load-batch");
+            slot->errnum = errno;
+            continue;
+        }
+        if (compressed && batch_decode_blob (cache,
+                                             slot->data,
+                                             slot->len,
+                                             &slot->data,
+                                             &slot->len,
+                                             &slot->copy) < 0) {
+            flux_log_error (cache->h, "content load-batch");
+            slot->errnum = errno;
+            continue;
+        }
+        if (cache_insert_loaded (cache,
+                                 slot->blobref,
+                                 slot->data,
+                                 slot->len) < 0)
+            flux_log_error (cache->h, "content load-batch");
+    }
+    load_batch_respond (lb);
+    flux_future_destroy (f);
+    cache_purge_max (cache);
+}
+
+/* Send content.load-batch request to TBON parent, indicating that
+ * compressed blobs in the response are acceptable if compression is enabled.
+ */
+static flux_future_t *cache_load_batch_upstream (content_cache_t *cache,
+                                                 const char **blobrefs,
+                                                 int count)
+{
+    struct blobvec *bv;
+    const void *buf;
+    int len;
+    flux_msg_t *msg = NULL;
+    flux_future_t *f = NULL;
+    int i;
+
+    if (!compression_enabled (cache))
+        return flux_content_load_batch (cache->h,
+                                        blobrefs,
+                                        count,
+                                        CONTENT_FLAG_UPSTREAM);
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (blobvec_append (bv, blobrefs[i], strlen (blobrefs[i]) + 1) < 0)
+            goto done;
+    }
+    blobvec_encode (bv, &buf, &len);
+    if (!(msg = flux_request_encode_raw ("content.load-batch", buf, len))
+        || flux_msg_set_user1 (msg) < 0)
+        goto done;
+    f = flux_rpc_message (cache->h, msg, FLUX_NODEID_UPSTREAM, 0);
+done:
+    flux_msg_destroy (msg);
+    blobvec_destroy (bv);
+    return f;
+}
+
+/* Send one content-backing.load request per blobref, for a backing store
+ * that does not support load-batch.  The composite future is fulfilled
+ * when all the requests are, and the request for blobrefs[i] is its child
+ * named "i".
+ */
+static flux_future_t *cache_load_each (content_cache_t *cache,
+                                       const char **blobrefs,
+                                       int count)
+{
+    flux_future_t *cf;
+    flux_future_t *f = NULL;
+    int i;
+
+    if (!(cf = flux_future_wait_all_create ()))
+        return NULL;
+    flux_future_set_flux (cf, cache->h);
+    for (i = 0; i < count; i++) {
+        char name[16];
+
+        snprintf (name, sizeof (name), "%d", i);
+        if (!(f = flux_content_load (cache->h,
+                                     blobrefs[i],
+                                     CONTENT_FLAG_CACHE_BYPASS))
+            || flux_future_push (cf, name, f) < 0)
+            goto error;
+    }
+    return cf;
+error:
+    ERRNO_SAFE_WRAP (flux_future_destroy, f);
+    ERRNO_SAFE_WRAP (flux_future_destroy, cf);
+    return NULL;
+}
+
+/* Send one batch request for all the misses in 'lb'.
+ * On success, 'lb' is owned by the future.
+ */
+static int load_batch_send (content_cache_t *cache, struct load_batch *lb)
+{
+    const char **blobrefs;
+    flux_future_t *f;
+    int count = 0;
+    int i;
+
+    if (!(blobrefs = calloc (lb->miss_count, sizeof (blobrefs[0]))))
+        return -1;
+    for (i = 0; i < lb->count; i++) {
+        if (lb->slots[i].miss)
+            blobrefs[count++] = lb->slots[i].blobref;
+    }
+    lb->each = false;
+    if (cache->rank > 0)
+        f = cache_load_batch_upstream (cache, blobrefs, count);
+    else if (cache->backing_noload_batch) {
+        f = cache_load_each (cache, blobrefs, count);
+        lb->each = true;
+    }
+    else
+        f = flux_content_load_batch (cache->h,
+                                     blobrefs,
+                                     count,
+                                     CONTENT_FLAG_CACHE_BYPASS);
+    free (blobrefs);
+    if (!f)
+        return -1;
+    if (flux_future_then (f, -1., load_batch_continuation, cache) < 0
+        || flux_future_aux_set (f,
+                                "batch",
+                                lb,
+                                (flux_free_f)load_batch_destroy) < 0) {
+        flux_future_destroy (f);
+        return -1;
+    }
+    return 0;
+}
+
+static void content_load_batch_request (flux_t *h, flux_msg_handler_t *mh,
+                                        const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    int count;
+    struct load_batch *lb = NULL;
+    int i;
+
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    if ((count = blobvec_decode_count (buf, len)) < 0)
+        goto error;
+    if (!(lb = load_batch_create (cache, msg, count)))
+        goto error;
+    for (i = 0; i < count; i++) {
+        struct load_slot *slot = &lb->slots[i];
+        struct cache_entry *e;
+        int size;
+
+        if (blobvec_next (buf,
+                          len,
+                          &cursor,
+                          (const void **)&slot->blobref,
+                          &size) != 1
+            || size <= 0
+            || slot->blobref[size - 1] != '\0'
+            || blobref_validate (slot->blobref) < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if ((e = lookup_entry (cache, slot->blobref)) && e->valid) {
+            cache->hit_count++;
+            cache_entry_touch (cache, e);
+            slot->data = e->data;
+            slot->len = e->len;
+        }
+        else if (cache->rank == 0 && !cache->backing)
+            slot->errnum = ENOENT;
+        else {
+            cache->miss_count++;
+            slot->miss = true;
+            lb->miss_count++;
+        }
+    }
+    if (lb->miss_count > 0) {
+        /* Cached blobs could be purged before the batch completes,
+         * so take a copy of them.
+         */
+        for (i = 0; i < count; i++) {
+            struct load_slot *slot = &lb->slots[i];
+            if (slot->miss || slot->errnum || slot->len == 0)
+                continue;
+            if (!(slot->copy = malloc (slot->len)))
+                goto error;
+            memcpy (slot->copy, slot->data, slot->len);
+            slot->data = slot->copy;
+        }
+        if (load_batch_send (cache, lb) < 0) {
+            flux_log_error (h, "content load-batch");
+            goto error;
+        }
+        return; /* RPC continuation will respond to msg */
+    }
+    load_batch_respond (lb);
+    load_batch_destroy (lb);
+    cache_purge_max (cache);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "content load-batch: flux_respond_error");
+    load_batch_destroy (lb);
+}
+
+/* Entries sent upstream by a store-batch request or a flush, which were
+ * marked store_pending and counted in cache->flush_batch_count.
+ */
+struct flush_batch {
+    int count;
+    struct cache_entry *entries[];
+};
+
+/* Clear store_pending on the entries of 'fb', undoing the accounting.
+ */
+static void flush_batch_release (content_cache_t *cache,
+                                 struct flush_batch *fb)
+{
+    int i;
+
+    for (i = 0; i < fb->count; i++) {
+        fb->entries[i]->store_pending = 0;
+        assert (cache->flush_batch_count > 0);
+        cache->flush_batch_count--;
+    }
+    fb->count = 0;
+}
+
+static void store_batch_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    const flux_msg_t *msg = flux_future_aux_get (f, "msg");
+    struct blobvec *bv = flux_future_aux_get (f, "blobrefs");
+    struct flush_batch *fb = flux_future_aux_get (f, "batch");
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const char *blobref;
+
+    flush_batch_release (cache, fb);
+    if (flux_future_get (f, NULL) < 0) {
+        flux_log_error (cache->h, "content store-batch");
+        goto error;
+    }
+    /* All blobs in the batch are now stored upstream.
+     */
+    blobvec_encode (bv, &buf, &len);
+    while (blobvec_next (buf,
+                         len,
+                         &cursor,
+                         (const void **)&blobref,
+                         NULL) == 1) {
+        struct cache_entry *e;
+
+        if ((e = lookup_entry (cache, blobref))
+            && e->dirty
+            && !e->store_pending) {
+            cache->acct_dirty--;
+            e->dirty = 0;
+            cache_entry_touch (cache, e);
+        }
+    }
+    if (flux_respond_raw (cache->h, msg, buf, len) < 0)
+        flux_log_error (cache->h, "content store-batch: flux_respond_raw");
+    flux_future_destroy (f);
+    cache_resume_flush (cache);
+    return;
+error:
+    if (flux_respond_error (cache->h, msg, errno, NULL) < 0)
+        flux_log_error (cache->h, "content store-batch: flux_respond_error");
+    flux_future_destroy (f);
+    cache_resume_flush (cache);
+}
+
+/* Send content.store-batch request to TBON parent, compressing blobs
+ * if compression is enabled.
+ */
+static flux_future_t *cache_store_batch_upstream (content_cache_t *cache,
+                                                  const void **bufs,
+                                                  const int *lens,
+                                                  int count)
+{
+    struct blobvec *bv;
+    const void *buf;
+    int len;
+    flux_msg_t *msg = NULL;
+    flux_future_t *f = NULL;
+    int i;
+
+    if (!compression_enabled (cache))
+        return flux_content_store_batch (cache->h,
+                                         bufs,
+                                         lens,
+                                         count,
+                                         CONTENT_FLAG_UPSTREAM);
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (batch_append_blob (cache, bv, bufs[i], lens[i]) < 0)
+            goto done;
+    }
+    blobvec_encode (bv, &buf, &len);
+    if (!(msg = flux_request_encode_raw ("content.store-batch", buf, len))
+        || flux_msg_set_user1 (msg) < 0)
+        goto done;
+    f = flux_rpc_message (cache->h, msg, FLUX_NODEID_UPSTREAM, 0);
+done:
+    flux_msg_destroy (msg);
+    blobvec_destroy (bv);
+    return f;
+}
+
+/* Send dirty blobs upstream in one batch request (rank > 0).
+ * 'blobrefs' (the eventual response) and 'fb' (the entries marked
+ * store_pending by this request) are consumed, even on failure.
+ */
+static int store_batch_send (content_cache_t *cache,
+                             const flux_msg_t *msg,
+                             struct blobvec *blobrefs,
+                             struct flush_batch *fb,
+                             const void **bufs,
+                             const int *lens,
+                             int count)
+{
+    flux_future_t *f;
+
+    if (!(f = cache_store_batch_upstream (cache, bufs, lens, count))
+        || flux_future_then (f, -1., store_batch_continuation, cache) < 0
+        || flux_future_aux_set (f,
+                                "msg",
+                                (void *)flux_msg_incref (msg),
+                                (flux_free_f)flux_msg_decref) < 0)
+        goto error;
+    if (flux_future_aux_set (f,
+                             "blobrefs",
+                             blobrefs,
+                             (flux_free_f)blobvec_destroy) < 0)
+        goto error;
+    blobrefs = NULL; /* owned by 'f' now */
+    if (flux_future_aux_set (f, "batch", fb, free) < 0)
+        goto error;
+    return 0;
+error:
+    flush_batch_release (cache, fb);
+    ERRNO_SAFE_WRAP (free, fb);
+    ERRNO_SAFE_WRAP (blobvec_destroy, blobrefs);
+    ERRNO_SAFE_WRAP (flux_future_destroy, f);
+    return -1;
+}
+
+static void content_store_batch_request (flux_t *h, flux_msg_handler_t *mh,
+                                         const flux_msg_t *msg, void *arg)
+{
+    content_cache_t *cache = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    int count;
+    struct blobvec *blobrefs = NULL;
+    struct flush_batch *fb = NULL;
+    const void **bufs = NULL;
+    int *lens = NULL;
+    int dirty = 0;
+    const void *rbuf;
+    int rlen;
+    int i;
+
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    if ((count = blobvec_decode_count (buf, len)) < 0)
+        goto error;
+    if (!(blobrefs = blobvec_create ())
+        || !(fb = calloc (1, sizeof (*fb) + count * sizeof (fb->entries[0])))
+        || (count > 0 && !(bufs = calloc (count, sizeof (bufs[0]))))
+        || (count > 0 && !(lens = calloc (count, sizeof (lens[0])))))
+        goto error;
+    for (i = 0; i < count; i++) {
+        struct cache_entry *e;
+        char blobref[BLOBREF_MAX_STRING_SIZE];
+        const void *data;
+        int size;
+        void *dbuf = NULL;
+        int rc;
+
+        if (blobvec_next (buf, len, &cursor, &data, &size) != 1
+            || size < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if (flux_msg_is_user1 (msg)
+            && batch_decode_blob (cache, data, size, &data, &size, &dbuf) < 0)
+            goto error;
+        rc = cache_store_blob (cache,
+                               data,
+                               size,
+                               blobref,
+                               sizeof (blobref),
+                               &e);
+        ERRNO_SAFE_WRAP (free, dbuf);
+        if (rc < 0)
+            goto error;
+        if (blobvec_append (blobrefs, blobref, strlen (blobref) + 1) < 0)
+            goto error;
+        if (e->dirty && cache->rank > 0) {
+            bufs[dirty] = e->data;
+            lens[dirty] = e->len;
+            dirty++;
+            /* Account for the upstream store as cache_flush() does,
+             * unless another request already has.
+             */
+            if (!e->store_pending) {
+                e->store_pending = 1;
+                cache->flush_batch_count++;
+                fb->entries[fb->count++] = e;
+            }
+        }
+    }
+    if (dirty > 0) {
+        int rc = store_batch_send (cache,
+                                   msg,
+                                   blobrefs,
+                                   fb,
+                                   bufs,
+                                   lens,
+                                   dirty);
+        blobrefs = NULL;
+        fb = NULL;
+        if (rc < 0) {
+            flux_log_error (h, "content store-batch");
+            goto error;
+        }
+        free (bufs);
+        free (lens);
+        return; /* RPC continuation will respond to msg */
+    }
+    if (cache->rank == 0 && cache->backing)
+        (void)cache_flush (cache);
+    blobvec_encode (blobrefs, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "content store-batch: flux_respond_raw");
+    blobvec_destroy (blobrefs);
+    free (fb);
+    free (bufs);
+    free (lens);
+    cache_purge_max (cache);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "content store-batch: flux_respond_error");
+    if (fb)
+        flush_batch_release (cache, fb);
+    blobvec_destroy (blobrefs);
+    free (fb);
+    free (bufs);
+    free (lens);
+}
+
+/* Backing store is enabled/disabled by modules that provide the
+ * 'content.backing' service.  At module load time, the backing module
+ * informs the content service of its availability, and entries are
+ * asynchronously duplicated on the backing store and made eligible for
+ * dropping from the rank 0 cache.
+ */
+
+/* Flushed entries are sent in a single store-batch request, so each
+ * call to cache_flush() costs one round trip.  Entries remain dirty and
+ * store_pending (and thus cannot be purged) until it completes.
+ */
+
+/* Check the result for the entry at 'index' in a flush batch.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int flush_batch_check (content_cache_t *cache,
+                              flux_future_t *f,
+                              int index,
+                              struct cache_entry *e)
+{
+    const char *blobref;
+
+    if (flux_content_store_batch_get (f, index, &blobref) < 0) {
+        flux_log_error (cache->h, "content store-batch");
+        return -1;
+    }
+    if (strcmp (blobref, e->blobref)) {
+        flux_log (cache->h, LOG_ERR, "content store: wrong blobref");
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+static void flush_batch_continuation (flux_future_t *f, void *arg)
+{
+    content_cache_t *cache = arg;
+    struct flush_batch *fb = flux_future_aux_get (f, "batch");
+    bool resend = false;
+    int errnum = 0;
+    int i;
+
+    if (flux_future_get (f, NULL) < 0) {
+        errnum = errno;
+        /* If the backing store does not support store-batch, remember
+         * that and leave the entries dirty, so that cache_flush() will
+         * store them one at a time.
+         */
+        if (cache->rank == 0 && errno == ENOSYS && cache->backing) {
+            flux_log (cache->h, LOG_DEBUG, "content store-batch: %s",
+                      "unsupported by backing store, storing blobs singly");
+            cache->backing_nostore_batch = 1;
+            resend = true;
+        }
+        else if (cache->rank == 0 && errno == ENOSYS)
+            flux_log (cache->h, LOG_DEBUG, "content store: %s",
+                      "backing store service unavailable");
+        else
+            flux_log_error (cache->h, "content store-batch");
+    }
+    for (i = 0; i < fb->count; i++) {
+        struct cache_entry *e = fb->entries[i];
+
+        e->store_pending = 0;
+        assert (cache->flush_batch_count > 0);
+        cache->flush_batch_count--;
+        if (resend)
+            continue;
+        if (errnum || flush_batch_check (cache, f, i, e) < 0) {
+            request_list_respond_error (&e->store_requests,
+                                        cache->h,
+                                        errnum ? errnum : errno,
+                                        NULL,
+                                        "store");
+            continue;
+        }
+        if (e->dirty) {
+            cache->acct_dirty--;
+            e->dirty = 0;
+            cache_entry_touch (cache, e);
+        }
+        request_list_respond_raw (&e->store_requests,
+                                  cache->h,
+                                  e->blobref,
+                                  strlen (e->blobref) + 1,
+                                  "store");
+    }
+    flux_future_destroy (f);
+    cache_resume_flush (cache);
+}
+
+/* Flush dirty entries with one store request each, for a backing store
+ * that does not support store-batch.
+ */
+static int cache_flush_each (content_cache_t *cache)
+{
+    struct cache_entry *e;
+    const char *key;
+    int saved_errno = 0;
+    int count = 0;
+    int rc = 0;
+
+    FOREACH_ZHASH (cache->entries, key, e) {
+        if (!e->dirty || e->store_pending)
+            continue;
+        if (cache_store (cache, e) < 0) {
+            saved_errno = errno;
+            rc = -1;
+        }
+        count++;
+        if (cache->flush_batch_count >= cache->flush_batch_limit)
+            break;
+    }
+    flux_log (cache->h, LOG_DEBUG, "content flush +%d (dirty=%d pending=%d)",
+              count, cache->acct_dirty, cache->flush_batch_count);
+    if (rc < 0)
+        errno = saved_errno;
+    return rc;
+}
+
+static int cache_flush (content_cache_t *cache)
+{
+    struct cache_entry *e;
+    const char *key;
+    struct flush_batch *fb;
+    const void **bufs = NULL;
+    int *lens = NULL;
+    flux_future_t *f = NULL;
+    int max;
+    int i;
+
+    if (cache->acct_dirty - cache->flush_batch_count == 0
+            || cache->flush_batch_count >= cache->flush_batch_limit)
+        return 0;
+
+    flux_log (cache->h, LOG_DEBUG, "content flush begin");
+    if (cache->rank == 0 && cache->backing_nostore_batch)
+        return cache_flush_each (cache);
+    max = cache->flush_batch_limit - cache->flush_batch_count;
+    if (!(fb = calloc (1, sizeof (*fb) + max * sizeof (fb->entries[0]))))
+        goto nomem;
+    FOREACH_ZHASH (cache->entries, key, e) {
+        if (!e->dirty || e->store_pending)
+            continue;
+        fb->entries[fb->count++] = e;
+        if (fb->count == max)
+            break;
+    }
+    if (fb->count == 0) {
+        free (fb);
+        return 0;
+    }
+    if (!(bufs = calloc (fb->count, sizeof (bufs[0])))
+        || !(lens = calloc (fb->count, sizeof (lens[0]))))
+        goto nomem;
+    for (i = 0; i < fb->count; i++) {
+        bufs[i] = fb->entries[i]->data;
+        lens[i] = fb->entries[i]->len;
+    }
+    if (cache->rank == 0)
+        f = flux_content_store_batch (cache->h,
+                                      bufs,
+                                      lens,
+                                      fb->count,
+                                      CONTENT_FLAG_CACHE_BYPASS);
+    else
+        f = cache_store_batch_upstream (cache, bufs, lens, fb->count);
+    if (!f || flux_future_aux_set (f, "batch", fb, free) < 0) {
+        flux_log_error (cache->h, "content flush");
+        goto error;
+    }
+    fb = NULL; /* owned by 'f' now */
+    if (flux_future_then (f, -1., flush_batch_continuation, cache) < 0) {
+        flux_log_error (cache->h, "content flush");
+        goto error;
+    }
+    fb = flux_future_aux_get (f, "batch");
+    for (i = 0; i < fb->count; i++)
+        fb->entries[i]->store_pending = 1;
+    cache->flush_batch_count += fb->count;
+    flux_log (cache->h, LOG_DEBUG, "content flush +%d (dirty=%d pending=%d)",
+              fb->count, cache->acct_dirty, cache->flush_batch_count);
+    free (bufs);
+    free (lens);
+    return 0;
+nomem:
+    errno = ENOMEM;
+error:
+    ERRNO_SAFE_WRAP (flux_future_destroy, f);
+    ERRNO_SAFE_WRAP (free, fb);
+    ERRNO_SAFE_WRAP (free, bufs);
+    ERRNO_SAFE_WRAP (free, lens);
+    return -1;
+}
+
+static void content_register_backing_request (flux_t *h,
+                                              flux_msg_handler_t *mh,
+                                              const flux_msg_t *msg,
+                                              void *arg)
+{
+    content_cache_t *cache = arg;
+    const char *name;
+    const char *errstr = NULL;
+
+    if (flux_request_unpack (msg, NULL, "{s:s}", "name", &name) < 0)
+        goto error;
+    if (cache->rank != 0) {
+        errno = EINVAL;
+        errstr = "content backing store can only be registered on rank 0";
+        goto error;
+    }
+    if (cache->backing) {
+        errno = EBUSY;
+        errstr = "content backing store is already active";
+        goto error;
+    }
+    /* cache->backing_name is either set to the initial value of the
+     * "content.backing-module" attribute (e.g. from broker command line),
+     * or to the first-registered backing store name.  Once set, it cannot
+     * be changed.
+     */
+    if (!cache->backing_name) {
+        if (!(cache->backing_name = strdup (name)))
+            goto error;
+    }
+    if (strcmp (cache->backing_name, name) != 0) {
         errno = EINVAL;
         errstr = "content backing store cannot be changed on the fly";
         goto error;
     }
     cache->backing = 1;
+    cache->backing_noload_batch = 0;
+    cache->backing_nostore_batch = 0;
     flux_log (h, LOG_DEBUG, "content backing store: enabled %s", name);
     if (flux_respond (h, msg, NULL) < 0)
         flux_log_error (h, "error responding to register-backing request");
@@ -703,44 +1940,29 @@ error:
 }
 
 /* Forcibly drop all entries from the cache that can be dropped
- * without data loss.
- * N.B. this walks the entire cache in one go.
+ * without data loss, i.e. everything on the LRU list.
  */
 
 static void content_dropcache_request (flux_t *h, flux_msg_handler_t *mh,
                                        const flux_msg_t *msg, void *arg)
 {
     content_cache_t *cache = arg;
-    zlist_t *keys = NULL;
-    char *key;
-    struct cache_entry *e;
     int orig_size;
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto error;
     orig_size = zhash_size (cache->entries);
-    if (!(keys = zhash_keys (cache->entries))) {
-        errno = ENOMEM;
-        goto error;
-    }
-    while ((key = zlist_pop (keys))) {
-        e = zhash_lookup (cache->entries, key);
-        assert (e != NULL);
-        if (e->valid && !e->dirty)
-            remove_entry (cache, e);
-        free (key);
-    }
+    while (cache->lru_head)
+        remove_entry (cache, cache->lru_head);
     flux_log (h, LOG_DEBUG, "content dropcache %d/%d",
               orig_size - (int)zhash_size (cache->entries), orig_size);
     if (flux_respond (h, msg, NULL) < 0)
         flux_log_error (h, "content dropcache");
-    zlist_destroy (&keys);
     return;
 error:
     flux_log (h, LOG_DEBUG, "content dropcache: %s", flux_strerror (errno));
     if (flux_respond_error (h, msg, errno, NULL) < 0)
         flux_log_error (h, "content dropcache");
-    zlist_destroy (&keys);
 }
 
 /* Return stats about the cache.
@@ -753,11 +1975,18 @@ static void content_stats_request (flux_t *h, flux_msg_handler_t *mh,
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto error;
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i}",
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:I s:I s:I s:I s:I s:I}",
                            "count", zhash_size (cache->entries),
                            "valid", cache->acct_valid,
                            "dirty", cache->acct_dirty,
-                           "size", cache->acct_size) < 0)
+                           "size", cache->acct_size,
+                           "hit", (json_int_t)cache->hit_count,
+                           "miss", (json_int_t)cache->miss_count,
+                           "evict", (json_int_t)cache->evict_count,
+                           "compress-count", (json_int_t)cache->compress_count,
+                           "compress-saved", (json_int_t)cache->compress_saved,
+                           "decompress-count",
+                           (json_int_t)cache->decompress_count) < 0)
         flux_log_error (h, "content stats");
     return;
 error:
@@ -825,50 +2054,47 @@ error:
         flux_log_error (h, "content flush");
 }
 
-/* Heartbeat drives periodic cache purge
+/* Heartbeat drives periodic cache purge.
+ * Entries are purged from the least recently used end of the LRU list
+ * until the cache is within both targets, or the next candidate was used
+ * less than purge_old_entry heartbeats ago.
  */
 
-static int cache_purge (content_cache_t *cache)
+static void cache_purge (content_cache_t *cache)
 {
-    int after_entries = zhash_size (cache->entries);
-    int after_size = cache->acct_size;
     struct cache_entry *e;
-    zlist_t *purge = NULL;
-    int rc = -1;
-    const char *key;
-
-    if (cache->acct_dirty == zhash_size (cache->entries))
-        return 0;
+    int count = 0;
 
-    FOREACH_ZHASH (cache->entries, key, e) {
-        if (after_size <= cache->purge_target_size
-                        && after_entries <= cache->purge_target_entries)
+    while ((e = cache->lru_head)) {
+        if (cache->acct_size <= cache->purge_target_size
+                && zhash_size (cache->entries) <= cache->purge_target_entries)
             break;
-        if (!e->valid || e->dirty)
-            continue;
         if (cache->epoch - e->lastused < cache->purge_old_entry)
-            continue;
-        if (after_entries <= cache->purge_target_entries
-                    && e->len < cache->purge_large_entry)
-            continue;
-        if ((!purge && !(purge = zlist_new ()))
-                    || zlist_append (purge, e) < 0) {
-            errno = ENOMEM;
-            goto done;
-        }
-        after_size -= e->len;
-        after_entries--;
+            break;
+        remove_entry (cache, e);
+        count++;
     }
-    if (purge) {
-        flux_log (cache->h, LOG_DEBUG, "content purge: %d entries",
-                  (int)zlist_size (purge));
-        while ((e = zlist_pop (purge)))
-            remove_entry (cache, e);
+    if (count > 0) {
+        cache->evict_count += count;
+        flux_log (cache->h, LOG_DEBUG, "content purge: %d entries", count);
+    }
+}
+
+/* Enforce the hard size limit, if set, regardless of entry age.
+ * Only clean entries can be purged, so the cache may still exceed the
+ * limit if it is mostly dirty.
+ */
+static void cache_purge_max (content_cache_t *cache)
+{
+    struct cache_entry *e;
+
+    if (cache->purge_max_size == 0)
+        return;
+    while (cache->acct_size > cache->purge_max_size
+                && (e = cache->lru_head)) {
+        remove_entry (cache, e);
+        cache->evict_count++;
     }
-    rc = 0;
-done:
-    zlist_destroy (&purge);
-    return rc;
 }
 
 static void heartbeat_event (flux_t *h, flux_msg_handler_t *mh,
@@ -897,6 +2123,18 @@ static const struct flux_msg_handler_spec htab[] = {
         content_store_request,
         FLUX_ROLE_USER
     },
+    {
+        FLUX_MSGTYPE_REQUEST,
+        "content.load-batch",
+        content_load_batch_request,
+        FLUX_ROLE_USER
+    },
+    {
+        FLUX_MSGTYPE_REQUEST,
+        "content.store-batch",
+        content_store_batch_request,
+        FLUX_ROLE_USER
+    },
     {
         FLUX_MSGTYPE_REQUEST,
         "content.unregister-backing",
@@ -957,6 +2195,14 @@ static int content_cache_setattr (const char *name, const char *val, void *arg)
         if (blobref_validate_hashtype (val) < 0)
             goto invalid;
         strcpy (cache->hash_name, val);
+    } else if (!strcmp (name, "content.compression")) {
+        char *cpy;
+        if (strcmp (val, "lz4") != 0 && strcmp (val, "none") != 0)
+            goto invalid;
+        if (!(cpy = strdup (val)))
+            return -1;
+        free (cache->compression);
+        cache->compression = cpy;
     } else
         goto invalid;
     return 0;
@@ -974,6 +2220,8 @@ static int content_cache_getattr (const char *name, const char **val, void *arg)
         *val = cache->hash_name;
     else if (!strcmp (name, "content.backing-module"))
         *val = cache->backing_name;
+    else if (!strcmp (name, "content.compression"))
+        *val = cache->compression;
     else if (!strcmp (name, "content.acct-entries")) {
         snprintf (s, sizeof (s), "%zd", zhash_size (cache->entries));
         *val = s;
@@ -1007,8 +2255,8 @@ int content_cache_register_attrs (content_cache_t *cache, attr_t *attr)
     if (attr_add_active_uint32 (attr, "content.purge-old-entry",
                 &cache->purge_old_entry, 0) < 0)
         return -1;
-    if (attr_add_active_uint32 (attr, "content.purge-large-entry",
-                &cache->purge_large_entry, 0) < 0)
+    if (attr_add_active_uint32 (attr, "content.purge-max-size",
+                &cache->purge_max_size, 0) < 0)
         return -1;
     /* Accounting numbers
      */
@@ -1038,6 +2286,15 @@ int content_cache_register_attrs (content_cache_t *cache, attr_t *attr)
     if (attr_add_active_uint32 (attr, "content.flush-batch-count",
                 &cache->flush_batch_count, 0) < 0)
         return -1;
+    /* Compression of blobs sent between brokers
+     */
+    if (attr_add_active (attr, "content.compression", 0,
+                         content_cache_getattr,
+                         content_cache_setattr, cache) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attr, "content.compress-threshold",
+                &cache->compress_threshold, 0) < 0)
+        return -1;
     /* content-hash can be set on the command line
      */
     if (attr_add_active (attr, "content.hash", FLUX_ATTRFLAG_IMMUTABLE,
@@ -1059,6 +2316,8 @@ void content_cache_destroy (content_cache_t *cache)
             free (cache->backing_name);
         zhash_destroy (&cache->entries);
         request_list_destroy (&cache->flush_requests);
+        free (cache->compression);
+        free (cache->compress_buf);
         free (cache);
     }
 }
@@ -1075,13 +2334,18 @@ content_cache_t *content_cache_create (void)
         errno = ENOMEM;
         return NULL;
     }
+    if (!(cache->compression = strdup ("lz4"))) {
+        content_cache_destroy (cache);
+        errno = ENOMEM;
+        return NULL;
+    }
     cache->rank = FLUX_NODEID_ANY;
     cache->blob_size_limit = default_blob_size_limit;
+    cache->compress_threshold = default_compress_threshold;
     cache->flush_batch_limit = default_flush_batch_limit;
     cache->purge_target_entries = default_cache_purge_target_entries;
     cache->purge_target_size = default_cache_purge_target_size;
     cache->purge_old_entry = default_cache_purge_old_entry;
-    cache->purge_large_entry = default_cache_purge_large_entry;
     strcpy (cache->hash_name, "sha1");
     return cache;
 }
@@ -26,6 +26,7 @@
 #include <stdarg.h>
 #include <argz.h>
 #include <czmq.h>
+#include <jansson.h>
 #include <flux/core.h>
 
 #include "src/common/libutil/log.h"
@@ -76,37 +77,142 @@ static modservice_ctx_t *getctx (flux_t *h, module_t *p)
     return ctx;
 }
 
+static int reactor_stat_append (const struct flux_reactor_stat *st, void *arg)
+{
+    json_t *o = arg;
+    json_t *entry;
+    json_t *kind;
+
+    if (st->kind == FLUX_REACTOR_STAT_LOOP)
+        kind = o;
+    else if (!(kind = json_object_get (o, st->kind == FLUX_REACTOR_STAT_TOPIC
+                                          ? "topic" : "watcher")))
+        return -1;
+    if (!(entry = json_pack ("{s:I s:f s:f s:f s:f s:f s:f}",
+                             "count", (json_int_t)st->count,
+                             "min", st->min,
+                             "max", st->max,
+                             "mean", st->mean,
+                             "p50", st->p50,
+                             "p90", st->p90,
+                             "p99", st->p99)))
+        return -1;
+    if (json_object_set_new (kind, st->name, entry) < 0)
+        return -1;
+    return 0;
+}
+
+/* Encode reactor instrumentation as
+ *   {"loop":{...}, "watcher":{type:{...}}, "topic":{topic:{...}}}
+ * where each {...} has count and duration statistics in seconds.
+ */
+static json_t *reactor_stats_encode (flux_reactor_t *r)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:{} s:{}}", "watcher", "topic"))
+        || flux_reactor_stats_foreach (r, reactor_stat_append, o) < 0) {
+        json_decref (o);
+        errno = ENOMEM;
+        return NULL;
+    }
+    return o;
+}
+
 static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                           const flux_msg_t *msg, void *arg)
 {
+    flux_reactor_t *r = flux_get_reactor (h);
     flux_msgcounters_t mcs;
+    struct flux_dispatch_stats ds;
+    struct flux_msg_pool_stats ps;
+    json_t *o;
+    json_t *reactor;
 
     flux_get_msgcounters (h, &mcs);
+    if (flux_dispatch_get_stats (h, &ds) < 0)
+        memset (&ds, 0, sizeof (ds));
+    if (flux_msg_pool_get_stats (&ps) < 0)
+        memset (&ps, 0, sizeof (ps));
 
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i s:i }",
-                           "#request (tx)", mcs.request_tx,
-                           "#request (rx)", mcs.request_rx,
-                           "#response (tx)", mcs.response_tx,
-                           "#response (rx)", mcs.response_rx,
-                           "#event (tx)", mcs.event_tx,
-                           "#event (rx)", mcs.event_rx,
-                           "#keepalive (tx)", mcs.keepalive_tx,
-                           "#keepalive (rx)", mcs.keepalive_rx) < 0)
-      FLUX_LOG_ERROR (h);
+    if (!(o = json_pack ("{ s:i s:i s:i s:i s:i s:i s:i s:i"
+                         "  s:I s:I s:I s:i s:i"
+                         "  s:I s:I s:I s:I }",
+                         "#request (tx)", mcs.request_tx,
+                         "#request (rx)", mcs.request_rx,
+                         "#response (tx)", mcs.response_tx,
+                         "#response (rx)", mcs.response_rx,
+                         "#event (tx)", mcs.event_tx,
+                         "#event (rx)", mcs.event_rx,
+                         "#keepalive (tx)", mcs.keepalive_tx,
+                         "#keepalive (rx)", mcs.keepalive_rx,
+                         "#dispatch (wakeups)", (json_int_t)ds.wakeups,
+                         "#dispatch (messages)", (json_int_t)ds.messages,
+                         "#dispatch (exhausted)", (json_int_t)ds.exhausted,
+                         "#dispatch (max batch)", ds.max_batch,
+                         "dispatch budget", ds.budget,
+                         "#msgpool (msg hits)", (json_int_t)ps.msg_hits,
+                         "#msgpool (msg misses)", (json_int_t)ps.msg_misses,
+                         "#msgpool (buf hits)", (json_int_t)ps.buf_hits,
+                         "#msgpool (buf misses)",
+                         (json_int_t)ps.buf_misses))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (flux_reactor_stats_enabled (r)) {
+        if (!(reactor = reactor_stats_encode (r)))
+            goto error;
+        if (json_object_set_new (o, "reactor", reactor) < 0) {
+            errno = ENOMEM;
+            goto error;
+        }
+    }
+    if (flux_respond_pack (h, msg, "O", o) < 0)
+        FLUX_LOG_ERROR (h);
+    json_decref (o);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        FLUX_LOG_ERROR (h);
+    json_decref (o);
 }
 
 static void stats_clear_event_cb (flux_t *h, flux_msg_handler_t *mh,
                                   const flux_msg_t *msg, void *arg)
 {
     flux_clr_msgcounters (h);
+    flux_dispatch_clear_stats (h);
+    flux_msg_pool_clear_stats ();
+    flux_reactor_stats_clear (flux_get_reactor (h));
 }
 
 static void stats_clear_request_cb (flux_t *h, flux_msg_handler_t *mh,
                                     const flux_msg_t *msg, void *arg)
 {
     flux_clr_msgcounters (h);
+    flux_dispatch_clear_stats (h);
+    flux_msg_pool_clear_stats ();
+    flux_reactor_stats_clear (flux_get_reactor (h));
+    if (flux_respond (h, msg, NULL) < 0)
+        FLUX_LOG_ERROR (h);
+}
+
+/* Enable or disable reactor instrumentation in the module thread.
+ */
+static void stats_reactor_cb (flux_t *h, flux_msg_handler_t *mh,
+                              const flux_msg_t *msg, void *arg)
+{
+    int enable;
+
+    if (flux_request_unpack (msg, NULL, "{s:b}", "enable", &enable) < 0
+        || flux_reactor_stats_enable (flux_get_reactor (h), enable) < 0)
+        goto error;
     if (flux_respond (h, msg, NULL) < 0)
         FLUX_LOG_ERROR (h);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        FLUX_LOG_ERROR (h);
 }
 
 static void shutdown_cb (flux_t *h, flux_msg_handler_t *mh,
@@ -260,6 +366,8 @@ int modservice_register (flux_t *h, module_t *p)
         return -1;
     if (register_request (ctx, "stats.clear", stats_clear_request_cb, FLUX_ROLE_OWNER) < 0)
         return -1;
+    if (register_request (ctx, "stats.reactor", stats_reactor_cb, FLUX_ROLE_OWNER) < 0)
+        return -1;
     if (register_request (ctx, "debug", debug_cb, FLUX_ROLE_OWNER) < 0)
         return -1;
 
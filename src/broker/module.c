@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include <sys/param.h>
 #include <stdbool.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <stdarg.h>
@@ -37,6 +38,8 @@
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/iterators.h"
+#include "src/common/libutil/topic_trie.h"
+#include "src/common/libutil/mpscq.h"
 
 #include "heartbeat.h"
 #include "module.h"
@@ -53,12 +56,16 @@ struct broker_module {
 
     uint32_t rank;
     flux_t *broker_h;
-    flux_watcher_t *broker_w;
+    flux_watcher_t *prepare_w;  /* level-triggered watch on 'to_broker' */
+    flux_watcher_t *check_w;
+    flux_watcher_t *idle_w;
+    flux_watcher_t *fd_w;
 
     int lastseen;
     heartbeat_t *heartbeat;
 
-    zsock_t *sock;          /* broker end of PAIR socket */
+    struct mpscq *to_module;   /* messages from broker to module thread */
+    struct mpscq *to_broker;   /* messages from module thread to broker */
     struct flux_msg_cred cred; /* cred of connection */
 
     uuid_t uuid;            /* uuid for unique request sender identity */
@@ -88,10 +95,13 @@ struct broker_module {
     flux_t *h;               /* module's handle */
 
     zlist_t *subs;          /* subscription strings */
+    unsigned int mcast_seq; /* last module_event_mcast() that sent to us */
 };
 
 struct modhash {
     zhash_t *zh_byuuid;
+    struct topic_trie *subs; /* subscription prefix => module_t */
+    unsigned int mcast_seq;
     uint32_t rank;
     flux_t *broker_h;
     heartbeat_t *heartbeat;
@@ -143,13 +153,110 @@ done:
     return rc;
 }
 
+/* The module's handle is connected to the broker by a pair of lock-free
+ * queues that carry flux_msg_t pointers, so messages cross between
+ * threads without being serialized.  A message is owned by whichever
+ * thread has most recently popped it.
+ */
+static int op_pollevents (void *impl)
+{
+    module_t *p = impl;
+    int e;
+    int revents = 0;
+
+    if ((e = mpscq_pollevents (p->to_module)) < 0)
+        return FLUX_POLLERR;
+    if (e & POLLIN)
+        revents |= FLUX_POLLIN;
+    if (e & POLLOUT)
+        revents |= FLUX_POLLOUT;
+    return revents;
+}
+
+static int op_pollfd (void *impl)
+{
+    module_t *p = impl;
+
+    return mpscq_pollfd (p->to_module);
+}
+
+static int op_send (void *impl, const flux_msg_t *msg, int flags)
+{
+    module_t *p = impl;
+    flux_msg_t *cpy;
+
+    /* The caller retains 'msg', so hand the broker a private copy.
+     */
+    if (!(cpy = flux_msg_copy (msg, true)))
+        return -1;
+    if (mpscq_push (p->to_broker, cpy) < 0) {
+        flux_msg_destroy (cpy);
+        return -1;
+    }
+    return 0;
+}
+
+static flux_msg_t *op_recv (void *impl, int flags)
+{
+    module_t *p = impl;
+
+    if ((flags & FLUX_O_NONBLOCK))
+        return mpscq_pop (p->to_module);
+    return mpscq_pop_wait (p->to_module);
+}
+
+static int op_event_subscribe (void *impl, const char *topic)
+{
+    module_t *p = impl;
+    flux_future_t *f;
+    int rc = -1;
+
+    if (!(f = flux_rpc_pack (p->h, "broker.sub", FLUX_NODEID_ANY, 0,
+                             "{ s:s }", "topic", topic)))
+        goto done;
+    if (flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    return rc;
+}
+
+static int op_event_unsubscribe (void *impl, const char *topic)
+{
+    module_t *p = impl;
+    flux_future_t *f;
+    int rc = -1;
+
+    if (!(f = flux_rpc_pack (p->h, "broker.unsub", FLUX_NODEID_ANY, 0,
+                             "{ s:s }", "topic", topic)))
+        goto done;
+    if (flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    return rc;
+}
+
+static const struct flux_handle_ops module_handle_ops = {
+    .pollfd = op_pollfd,
+    .pollevents = op_pollevents,
+    .send = op_send,
+    .recv = op_recv,
+    .getopt = NULL,
+    .setopt = NULL,
+    .event_subscribe = op_event_subscribe,
+    .event_unsubscribe = op_event_unsubscribe,
+    .impl_destroy = NULL,
+};
+
 static void *module_thread (void *arg)
 {
     module_t *p = arg;
     assert (p->magic == MODULE_MAGIC);
     sigset_t signal_set;
     int errnum;
-    char *uri = NULL;
     char **av = NULL;
     char *rankstr = NULL;
     int ac;
@@ -159,14 +266,10 @@ static void *module_thread (void *arg)
 
     setup_module_profiling (p);
 
-    /* Connect to broker socket, enable logging, register built-in services
+    /* Connect to broker queues, enable logging, register built-in services
      */
-    if (asprintf (&uri, "shmem://%s", p->uuid_str) < 0) {
-        log_err ("asprintf");
-        goto done;
-    }
-    if (!(p->h = flux_open (uri, 0))) {
-        log_err ("flux_open %s", uri);
+    if (!(p->h = flux_handle_create (p, &module_handle_ops, 0))) {
+        log_err ("%s: flux_handle_create", p->name);
         goto done;
     }
     if (asprintf (&rankstr, "%"PRIu32, p->rank) < 0) {
@@ -245,7 +348,6 @@ static void *module_thread (void *arg)
         flux_log_error (p->h, "flux_send");
     flux_msg_destroy (msg);
 done:
-    free (uri);
     free (rankstr);
     if (av)
         free (av);
@@ -278,7 +380,7 @@ flux_msg_t *module_recvmsg (module_t *p)
 
     assert (p->magic == MODULE_MAGIC);
 
-    if (!(msg = flux_msg_recvzsock (p->sock)))
+    if (!(msg = mpscq_pop (p->to_broker)))
         goto error;
     if (flux_msg_get_type (msg, &type) < 0)
         goto error;
@@ -295,7 +397,7 @@ flux_msg_t *module_recvmsg (module_t *p)
         default:
             break;
     }
-    /* All shmem:// connections to the broker have FLUX_ROLE_OWNER
+    /* All module connections to the broker have FLUX_ROLE_OWNER
      * and are "authenticated" as the instance owner.
      * Allow modules so endowed to change the userid/rolemask on messages when
      * sending on behalf of other users.  This is necessary for connectors
@@ -341,8 +443,6 @@ int module_sendmsg (module_t *p, const flux_msg_t *msg)
                 goto done;
             if (flux_msg_push_route (cpy, uuid) < 0)
                 goto done;
-            if (flux_msg_sendzsock (p->sock, cpy) < 0)
-                goto done;
             break;
         }
         case FLUX_MSGTYPE_RESPONSE: { /* simulate ROUTER socket */
@@ -350,15 +450,18 @@ int module_sendmsg (module_t *p, const flux_msg_t *msg)
                 goto done;
             if (flux_msg_pop_route (cpy, NULL) < 0)
                 goto done;
-            if (flux_msg_sendzsock (p->sock, cpy) < 0)
-                goto done;
             break;
         }
         default:
-            if (flux_msg_sendzsock (p->sock, msg) < 0)
+            if (!(cpy = flux_msg_copy (msg, true)))
                 goto done;
             break;
     }
+    /* On success, ownership of 'cpy' passes to the module thread.
+     */
+    if (mpscq_push (p->to_module, cpy) < 0)
+        goto done;
+    cpy = NULL;
     rc = 0;
 done:
     flux_msg_destroy (cpy);
@@ -423,9 +526,12 @@ static void module_destroy (module_t *p)
      */
     disconnect_destroy (p->disconnect);
 
-    flux_watcher_stop (p->broker_w);
-    flux_watcher_destroy (p->broker_w);
-    zsock_destroy (&p->sock);
+    flux_watcher_destroy (p->prepare_w);
+    flux_watcher_destroy (p->check_w);
+    flux_watcher_destroy (p->idle_w);
+    flux_watcher_destroy (p->fd_w);
+    mpscq_destroy (p->to_module);
+    mpscq_destroy (p->to_broker);
 
 #ifndef __SANITIZE_ADDRESS__
     dlclose (p->dso);
@@ -476,14 +582,37 @@ void module_mute (module_t *p)
     p->muted = true;
 }
 
+/* Messages from the module thread are watched with prepare/check/idle
+ * watchers, like the handle watcher, so that the callback runs once per
+ * loop iteration for as long as the queue is non-empty.  The fd watcher
+ * only wakes the loop when the queue goes from empty to non-empty.
+ */
+static void module_prepare_cb (flux_reactor_t *r, flux_watcher_t *w,
+                               int revents, void *arg)
+{
+    module_t *p = arg;
+    int e = mpscq_pollevents (p->to_broker);
+
+    if (e > 0 && (e & POLLIN))
+        flux_watcher_start (p->idle_w);
+}
+
+static void module_wakeup_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+}
+
 static void module_cb (flux_reactor_t *r, flux_watcher_t *w,
                        int revents, void *arg)
 {
     module_t *p = arg;
     assert (p->magic == MODULE_MAGIC);
-    p->lastseen = heartbeat_get_epoch (p->heartbeat);
-    if (p->poller_cb)
-        p->poller_cb (p, p->poller_arg);
+    flux_watcher_stop (p->idle_w);
+    if (mpscq_count (p->to_broker) > 0) {
+        p->lastseen = heartbeat_get_epoch (p->heartbeat);
+        if (p->poller_cb)
+            p->poller_cb (p, p->poller_arg);
+    }
 }
 
 int module_start (module_t *p)
@@ -492,7 +621,9 @@ int module_start (module_t *p)
     int errnum;
     int rc = -1;
 
-    flux_watcher_start (p->broker_w);
+    flux_watcher_start (p->prepare_w);
+    flux_watcher_start (p->check_w);
+    flux_watcher_start (p->fd_w);
     if ((errnum = pthread_create (&p->t, NULL, module_thread, p))) {
         errno = errnum;
         goto done;
@@ -614,6 +745,7 @@ module_t *module_add (modhash_t *mh, const char *path)
     const char **mod_namep;
     mod_main_f *mod_main;
     zfile_t *zf;
+    flux_reactor_t *r;
     int rc;
 
     dlerror ();
@@ -663,20 +795,24 @@ module_t *module_add (modhash_t *mh, const char *path)
     p->broker_h = mh->broker_h;
     p->heartbeat = mh->heartbeat;
 
-    /* Broker end of PAIR socket is opened here.
+    /* Message queues between broker and module thread are created here.
      */
-    if (!(p->sock = zsock_new_pair (NULL))) {
-        log_err ("zsock_new_pair");
-        goto cleanup;
-    }
-    if (zsock_bind (p->sock, "inproc://%s", module_get_uuid (p)) < 0) {
-        log_err ("zsock_bind inproc://%s", module_get_uuid (p));
+    if (!(p->to_module = mpscq_create ((mpscq_free_f)flux_msg_destroy))
+        || !(p->to_broker = mpscq_create ((mpscq_free_f)flux_msg_destroy))) {
+        log_err ("mpscq_create");
         goto cleanup;
     }
-    if (!(p->broker_w = flux_zmq_watcher_create (flux_get_reactor (p->broker_h),
-                                                 p->sock, FLUX_POLLIN,
-                                                 module_cb, p))) {
-        log_err ("flux_zmq_watcher_create");
+    r = flux_get_reactor (p->broker_h);
+    if (!(p->prepare_w = flux_prepare_watcher_create (r, module_prepare_cb,
+                                                      p))
+        || !(p->check_w = flux_check_watcher_create (r, module_cb, p))
+        || !(p->idle_w = flux_idle_watcher_create (r, NULL, NULL))
+        || !(p->fd_w = flux_fd_watcher_create (r,
+                                               mpscq_pollfd (p->to_broker),
+                                               FLUX_POLLIN,
+                                               module_wakeup_cb,
+                                               p))) {
+        log_err ("error creating module watchers");
         goto cleanup;
     }
     /* Set creds for connection.
@@ -701,7 +837,11 @@ cleanup:
 
 void module_remove (modhash_t *mh, module_t *p)
 {
+    const char *s;
+
     assert (p->magic == MODULE_MAGIC);
+    FOREACH_ZLIST (p->subs, s)
+        (void)topic_trie_remove (mh->subs, s, p);
     zhash_delete (mh->zh_byuuid, module_get_uuid (p));
 }
 
@@ -712,7 +852,8 @@ modhash_t *modhash_create (void)
         errno = ENOMEM;
         return NULL;
     }
-    if (!(mh->zh_byuuid = zhash_new ())) {
+    if (!(mh->zh_byuuid = zhash_new ())
+        || !(mh->subs = topic_trie_create ())) {
         modhash_destroy (mh);
         errno = ENOMEM;
         return NULL;
@@ -736,6 +877,7 @@ void modhash_destroy (modhash_t *mh)
             }
             zhash_destroy (&mh->zh_byuuid);
         }
+        topic_trie_destroy (mh->subs);
         free (mh);
     }
 }
@@ -844,7 +986,12 @@ int module_subscribe (modhash_t *mh, const char *uuid, const char *topic)
         errno = ENOMEM;
         goto done;
     }
+    if (topic_trie_insert (mh->subs, cpy, p) < 0) {
+        free (cpy);
+        goto done;
+    }
     if (zlist_push (p->subs, cpy) < 0) {
+        (void)topic_trie_remove (mh->subs, cpy, p);
         free (cpy);
         errno = ENOMEM;
         goto done;
@@ -867,6 +1014,7 @@ int module_unsubscribe (modhash_t *mh, const char *uuid, const char *topic)
     s = zlist_first (p->subs);
     while (s) {
         if (!strcmp (topic, s)) {
+            (void)topic_trie_remove (mh->subs, s, p);
             zlist_remove (p->subs, s);
             free (s);
             break;
@@ -878,37 +1026,37 @@ done:
     return rc;
 }
 
-static bool match_sub (module_t *p, const char *topic)
+struct mcast {
+    modhash_t *mh;
+    const flux_msg_t *msg;
+    int rc;
+};
+
+/* topic_trie_f - send event to module once, even if it has more than
+ * one matching subscription.
+ */
+static void mcast_cb (void *item, void *arg)
 {
-    char *s = zlist_first (p->subs);
+    module_t *p = item;
+    struct mcast *mc = arg;
 
-    while (s) {
-        if (!strncmp (topic, s, strlen (s)))
-            return true;
-        s = zlist_next (p->subs);
-    }
-    return false;
+    if (p->mcast_seq == mc->mh->mcast_seq)
+        return;
+    p->mcast_seq = mc->mh->mcast_seq;
+    if (module_sendmsg (p, mc->msg) < 0)
+        mc->rc = -1;
 }
 
 int module_event_mcast (modhash_t *mh, const flux_msg_t *msg)
 {
+    struct mcast mc = { .mh = mh, .msg = msg, .rc = 0 };
     const char *topic;
-    module_t *p;
-    int rc = -1;
 
     if (flux_msg_get_topic (msg, &topic) < 0)
-        goto done;
-    p = zhash_first (mh->zh_byuuid);
-    while (p) {
-        if (match_sub (p, topic)) {
-            if (module_sendmsg (p, msg) < 0)
-                goto done;
-        }
-        p = zhash_next (mh->zh_byuuid);
-    }
-    rc = 0;
-done:
-    return rc;
+        return -1;
+    mh->mcast_seq++;
+    topic_trie_match (mh->subs, topic, mcast_cb, &mc);
+    return mc.rc;
 }
 
 module_t *module_first (modhash_t *mh)
@@ -12,6 +12,7 @@
 #include "config.h"
 #endif
 #include <stdarg.h>
+#include <arpa/inet.h>
 #include <czmq.h>
 #include <zmq.h>
 #include <flux/core.h>
@@ -29,12 +30,37 @@
 #define FLUX_ZAP_DOMAIN "flux"
 #define ZAP_ENDPOINT "inproc://zeromq.zap.01"
 
+static const uint32_t default_event_batch_max = 256;
+static const size_t event_batch_size_limit = 1048576*4;
+
 struct endpoint {
     zsock_t *zsock;
     char *uri;
     flux_watcher_t *w;
 };
 
+/* Events multicast to children are optionally coalesced into a single
+ * envelope event, whose payload is a sequence of encoded events, each
+ * preceded by its length as a 4 byte integer in network byte order.
+ */
+struct event_batch {
+    uint32_t window_ms;     /* 0 = batching disabled */
+    uint32_t max;           /* max events per batch */
+    flux_watcher_t *timer;
+    uint8_t *buf;
+    size_t size;
+    size_t alloc;
+    int count;
+    uint32_t seq;           /* seq of last event in batch */
+
+    /* stats */
+    uint64_t events_sent;
+    uint64_t batches_sent;
+    uint64_t msgs_sent;
+    uint64_t events_recv;
+    uint64_t batches_recv;
+};
+
 struct child {
     int lastseen;
     unsigned long rank;
@@ -79,6 +105,8 @@ struct overlay {
     void *init_arg;
 
     int idle_warning;
+
+    struct event_batch batch;
 };
 
 /* Convenience iterator for ov->children
@@ -374,38 +402,20 @@ flux_msg_t *overlay_recvmsg_child (struct overlay *ov)
     return flux_msg_recvzsock (ov->child->zsock);
 }
 
-static int overlay_mcast_child_one (void *zsock,
-                                    const flux_msg_t *msg,
-                                    struct child *child)
-{
-    flux_msg_t *cpy;
-    int rc = -1;
-
-    if (!(cpy = flux_msg_copy (msg, true)))
-        return -1;
-    if (flux_msg_enable_route (cpy) < 0)
-        goto done;
-    if (flux_msg_push_route (cpy, child->uuid) < 0)
-        goto done;
-    if (flux_msg_sendzsock_ex (zsock, cpy, true) < 0)
-        goto done;
-    rc = 0;
-done:
-    flux_msg_destroy (cpy);
-    return rc;
-}
-
-void overlay_mcast_child (struct overlay *ov, const flux_msg_t *msg)
+/* Send 'msg' to all connected children.
+ */
+static void mcast_child_raw (struct overlay *ov, const flux_msg_t *msg)
 {
     struct child *child;
     int disconnects = 0;
 
-    if (!ov->child || !ov->child->zsock)
-        return;
     foreach_overlay_child (ov, child) {
         if (!child->connected)
             continue;
-        if (overlay_mcast_child_one (ov->child->zsock, msg, child) < 0) {
+        if (flux_msg_sendzsock_route (ov->child->zsock,
+                                      msg,
+                                      child->uuid,
+                                      true) < 0) {
             if (errno == EHOSTUNREACH) {
                 child->connected = false;
                 disconnects++;
@@ -415,11 +425,173 @@ void overlay_mcast_child (struct overlay *ov, const flux_msg_t *msg)
                                 "mcast error to child rank %lu",
                                 child->rank);
         }
+        else
+            ov->batch.msgs_sent++;
     }
     if (disconnects)
         overlay_monitor_notify (ov);
 }
 
+bool overlay_event_is_batch (const flux_msg_t *msg)
+{
+    return flux_msg_cmp (msg, flux_match_init (FLUX_MSGTYPE_EVENT,
+                                               FLUX_MATCHTAG_NONE,
+                                               OVERLAY_EVENT_BATCH_TOPIC));
+}
+
+/* Send pending batch (if any) to children as one envelope event.
+ */
+static void event_batch_flush (struct overlay *ov)
+{
+    struct event_batch *batch = &ov->batch;
+    flux_msg_t *msg;
+
+    flux_watcher_stop (batch->timer);
+    if (batch->count == 0)
+        return;
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_EVENT))
+            || flux_msg_set_topic (msg, OVERLAY_EVENT_BATCH_TOPIC) < 0
+            || flux_msg_set_seq (msg, batch->seq) < 0
+            || flux_msg_set_payload (msg, batch->buf, batch->size) < 0) {
+        flux_log_error (ov->h,
+                        "error encoding batch of %d events",
+                        batch->count);
+        goto done;
+    }
+    mcast_child_raw (ov, msg);
+    batch->batches_sent++;
+done:
+    flux_msg_destroy (msg);
+    batch->size = 0;
+    batch->count = 0;
+}
+
+static void event_batch_timer_cb (flux_reactor_t *r,
+                                  flux_watcher_t *w,
+                                  int revents,
+                                  void *arg)
+{
+    struct overlay *ov = arg;
+    event_batch_flush (ov);
+}
+
+/* Append encoded 'msg' to the pending batch, growing buffer as needed.
+ */
+static int event_batch_append (struct overlay *ov, const flux_msg_t *msg)
+{
+    struct event_batch *batch = &ov->batch;
+    size_t len = flux_msg_encode_size (msg);
+    uint32_t nlen = htonl (len);
+
+    if (batch->size + len + sizeof (nlen) > batch->alloc) {
+        size_t alloc = batch->alloc > 0 ? batch->alloc : 4096;
+        uint8_t *buf;
+
+        while (alloc < batch->size + len + sizeof (nlen))
+            alloc *= 2;
+        if (!(buf = realloc (batch->buf, alloc)))
+            return -1;
+        batch->buf = buf;
+        batch->alloc = alloc;
+    }
+    if (flux_msg_encode (msg,
+                         batch->buf + batch->size + sizeof (nlen),
+                         len) < 0)
+        return -1;
+    memcpy (batch->buf + batch->size, &nlen, sizeof (nlen));
+    batch->size += len + sizeof (nlen);
+    batch->count++;
+    if (flux_msg_get_seq (msg, &batch->seq) < 0)
+        batch->seq = 0;
+    return 0;
+}
+
+static int event_batch_add (struct overlay *ov, const flux_msg_t *msg)
+{
+    struct event_batch *batch = &ov->batch;
+
+    if (!batch->timer) {
+        if (!(batch->timer = flux_timer_watcher_create (flux_get_reactor (ov->h),
+                                                        0.,
+                                                        0.,
+                                                        event_batch_timer_cb,
+                                                        ov)))
+            return -1;
+    }
+    if (event_batch_append (ov, msg) < 0)
+        return -1;
+    if (batch->count >= batch->max || batch->size >= event_batch_size_limit)
+        event_batch_flush (ov);
+    else if (batch->count == 1) {
+        flux_timer_watcher_reset (batch->timer, 1E-3 * batch->window_ms, 0.);
+        flux_watcher_start (batch->timer);
+    }
+    return 0;
+}
+
+void overlay_mcast_child (struct overlay *ov, const flux_msg_t *msg)
+{
+    if (!ov->child || !ov->child->zsock || ov->child_count == 0)
+        return;
+    if (ov->batch.window_ms > 0 && ov->batch.max > 1
+                                && !overlay_event_is_batch (msg)) {
+        if (event_batch_add (ov, msg) == 0) {
+            ov->batch.events_sent++;
+            return;
+        }
+        flux_log_error (ov->h, "error batching event, sending immediately");
+    }
+    /* Preserve event order by sending any pending batch first.
+     */
+    event_batch_flush (ov);
+    mcast_child_raw (ov, msg);
+    if (overlay_event_is_batch (msg))
+        ov->batch.batches_sent++;
+    else
+        ov->batch.events_sent++;
+}
+
+int overlay_event_batch_unpack (struct overlay *ov,
+                                const flux_msg_t *msg,
+                                overlay_event_f cb,
+                                void *arg)
+{
+    const uint8_t *buf;
+    int size;
+    int offset = 0;
+    uint32_t nlen;
+
+    if (!overlay_event_is_batch (msg)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flux_msg_get_payload (msg, (const void **)&buf, &size) < 0)
+        return -1;
+    ov->batch.batches_recv++;
+    while (offset < size) {
+        flux_msg_t *event;
+        size_t len;
+
+        if (size - offset < sizeof (nlen))
+            goto eproto;
+        memcpy (&nlen, buf + offset, sizeof (nlen));
+        len = ntohl (nlen);
+        offset += sizeof (nlen);
+        if (size - offset < len)
+            goto eproto;
+        if (!(event = flux_msg_decode (buf + offset, len)))
+            return -1;
+        offset += len;
+        ov->batch.events_recv++;
+        (void)cb (event, arg);
+        flux_msg_destroy (event);
+    }
+    return 0;
+eproto:
+    errno = EPROTO;
+    return -1;
+}
+
 static void child_cb (flux_reactor_t *r, flux_watcher_t *w,
                       int revents, void *arg)
 {
@@ -680,6 +852,12 @@ int overlay_register_attrs (struct overlay *overlay, attr_t *attrs)
     if (attr_add_int (attrs, "tbon.descendants", tbon_descendants,
                       FLUX_ATTRFLAG_IMMUTABLE) < 0)
         return -1;
+    if (attr_add_active_uint32 (attrs, "tbon.event-batch-ms",
+                                &overlay->batch.window_ms, 0) < 0)
+        return -1;
+    if (attr_add_active_uint32 (attrs, "tbon.event-batch-max",
+                                &overlay->batch.max, 0) < 0)
+        return -1;
 
     return 0;
 }
@@ -738,6 +916,47 @@ error:
         flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
 }
 
+static void stats_cb (flux_t *h,
+                      flux_msg_handler_t *mh,
+                      const flux_msg_t *msg,
+                      void *arg)
+{
+    struct overlay *ov = arg;
+    struct event_batch *batch = &ov->batch;
+    struct flux_msg_pool_stats ps;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    /* The broker thread's message pool.
+     */
+    if (flux_msg_pool_get_stats (&ps) < 0)
+        goto error;
+    if (flux_respond_pack (h, msg,
+                           "{s:{s:i s:i s:I s:I s:I s:I s:I}"
+                           " s:{s:I s:I s:I s:I s:i s:i}}",
+                           "event-batch",
+                           "window-ms", batch->window_ms,
+                           "max", batch->max,
+                           "events-sent", (json_int_t)batch->events_sent,
+                           "batches-sent", (json_int_t)batch->batches_sent,
+                           "msgs-sent", (json_int_t)batch->msgs_sent,
+                           "events-recv", (json_int_t)batch->events_recv,
+                           "batches-recv",
+                           (json_int_t)batch->batches_recv,
+                           "msg-pool",
+                           "msg-hits", (json_int_t)ps.msg_hits,
+                           "msg-misses", (json_int_t)ps.msg_misses,
+                           "buf-hits", (json_int_t)ps.buf_hits,
+                           "buf-misses", (json_int_t)ps.buf_misses,
+                           "msg-cached", ps.msg_cached,
+                           "buf-cached", ps.buf_cached) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+}
+
 int overlay_cert_load (struct overlay *ov, const char *path)
 {
     struct stat sb;
@@ -809,6 +1028,10 @@ void overlay_destroy (struct overlay *ov)
             (void)flux_event_unsubscribe (ov->h, "hb");
 
         flux_msg_handler_delvec (ov->handlers);
+        if (ov->child && ov->child->zsock)
+            event_batch_flush (ov);
+        flux_watcher_destroy (ov->batch.timer);
+        free (ov->batch.buf);
         overlay_keepalive_parent (ov, KEEPALIVE_STATUS_DISCONNECT);
         endpoint_destroy (ov->parent);
         endpoint_destroy (ov->child);
@@ -822,6 +1045,7 @@ void overlay_destroy (struct overlay *ov)
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_EVENT,  "hb", heartbeat_cb, 0 },
     { FLUX_MSGTYPE_REQUEST,  "overlay.lspeer", lspeer_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST,  "overlay.stats.get", stats_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
@@ -834,6 +1058,7 @@ struct overlay *overlay_create (flux_t *h)
     ov->rank = FLUX_NODEID_ANY;
     ov->parent_lastsent = -1;
     ov->h = h;
+    ov->batch.max = default_event_batch_max;
 
     if (flux_msg_handler_addvec (h, htab, ov, &ov->handlers) < 0)
         goto error;
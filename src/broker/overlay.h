@@ -79,10 +79,29 @@ int overlay_sendmsg_child (struct overlay *ov, const flux_msg_t *msg);
 flux_msg_t *overlay_recvmsg_child (struct overlay *ov);
 
 /* We can "multicast" events to all child peers using mcast_child().
- * It walks the 'children' hash, finding peers and routeing them a copy of msg.
+ * It walks the 'children' array, finding connected peers and routing msg
+ * to each.  The payload is shared among peers rather than copied.
+ * If the tbon.event-batch-ms attribute is nonzero, events are coalesced
+ * for up to that many milliseconds (or tbon.event-batch-max events) and
+ * sent as a single envelope event with topic OVERLAY_EVENT_BATCH_TOPIC.
  */
 void overlay_mcast_child (struct overlay *ov, const flux_msg_t *msg);
 
+/* Envelope events received from the parent should be forwarded to
+ * children as is with overlay_mcast_child(), then unpacked for local
+ * delivery with overlay_event_batch_unpack(), which calls 'cb' once for
+ * each event in the batch, in the order they were published.
+ */
+#define OVERLAY_EVENT_BATCH_TOPIC "overlay.event-batch"
+
+typedef int (*overlay_event_f)(const flux_msg_t *msg, void *arg);
+
+bool overlay_event_is_batch (const flux_msg_t *msg);
+int overlay_event_batch_unpack (struct overlay *ov,
+                                const flux_msg_t *msg,
+                                overlay_event_f cb,
+                                void *arg);
+
 /* Call when message is received from child 'uuid'.
  * If message was a keepalive, update 'status', otherwise set to zero.
  */
@@ -102,6 +121,8 @@ int overlay_connect (struct overlay *ov);
 /* Add attributes to 'attrs' to reveal information about the overlay network.
  * Active attrs:
  *   tbon.parent-endpoint
+ *   tbon.event-batch-ms
+ *   tbon.event-batch-max
  * Passive attrs:
  *   rank
  *   size
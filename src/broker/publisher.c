@@ -21,6 +21,7 @@
 #include "src/common/libutil/macros.h"
 
 #include "publisher.h"
+#include "overlay.h"
 
 struct sender {
     publisher_send_f send;
@@ -150,6 +151,10 @@ void pub_cb (flux_t *h, flux_msg_handler_t *mh,
         errno = EPROTO;
         goto error;
     }
+    if (!strcmp (topic, OVERLAY_EVENT_BATCH_TOPIC)) {
+        errno = EPERM;
+        goto error;
+    }
     if (flux_msg_get_cred (msg, &cred) < 0)
         goto error;
     if (!(event = encode_event (topic, flags, cred, ++pub->seq, payload)))
@@ -171,6 +176,10 @@ int publisher_send (struct publisher *pub, const flux_msg_t *msg)
 {
     flux_msg_t *cpy;
 
+    if (overlay_event_is_batch (msg)) {
+        errno = EPERM;
+        return -1;
+    }
     if (!(cpy = flux_msg_copy (msg, true)))
         return -1;
     if (flux_msg_clear_route (cpy) < 0)
@@ -11,41 +11,111 @@
 #include "builtin.h"
 
 #include <unistd.h>
+#include <fcntl.h>
 
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/read_all.h"
 
+/* Multiple blobrefs are loaded with a single batch request,
+ * and the blobs are written to stdout in order.
+ */
 static int internal_content_load (optparse_t *p, int ac, char *av[])
 {
     int n;
-    const char *ref;
     const uint8_t *data;
     int size;
     flux_t *h;
     flux_future_t *f;
     int flags = 0;
+    int i;
 
     n = optparse_option_index (p);
-    if (n != ac - 1) {
+    if (n == ac) {
         optparse_print_usage (p);
         exit (1);
     }
-    ref = av[n];
     if (!(h = builtin_get_flux_handle (p)))
         log_err_exit ("flux_open");
     if (optparse_hasopt (p, "bypass-cache"))
         flags |= CONTENT_FLAG_CACHE_BYPASS;
-    if (!(f = flux_content_load (h, ref, flags)))
-        log_err_exit ("flux_content_load");
-    if (flux_content_load_get (f, (const void **)&data, &size) < 0)
-        log_err_exit ("flux_content_load_get");
-    if (write_all (STDOUT_FILENO, data, size) < 0)
-        log_err_exit ("write");
+    if (n == ac - 1) {
+        if (!(f = flux_content_load (h, av[n], flags)))
+            log_err_exit ("flux_content_load");
+        if (flux_content_load_get (f, (const void **)&data, &size) < 0)
+            log_err_exit ("flux_content_load_get");
+        if (write_all (STDOUT_FILENO, data, size) < 0)
+            log_err_exit ("write");
+    }
+    else {
+        if (!(f = flux_content_load_batch (h,
+                                           (const char **)&av[n],
+                                           ac - n,
+                                           flags)))
+            log_err_exit ("flux_content_load_batch");
+        for (i = 0; i < ac - n; i++) {
+            if (flux_content_load_batch_get (f,
+                                             i,
+                                             (const void **)&data,
+                                             &size) < 0)
+                log_err_exit ("%s", av[n + i]);
+            if (write_all (STDOUT_FILENO, data, size) < 0)
+                log_err_exit ("write");
+        }
+    }
     flux_future_destroy (f);
     flux_close (h);
     return (0);
 }
 
+/* Store each FILE argument as a blob with a single batch request,
+ * and print the blobrefs on stdout in order.
+ */
+static int content_store_files (optparse_t *p, int ac, char *av[])
+{
+    int n = optparse_option_index (p);
+    int count = ac - n;
+    void **bufs;
+    int *lens;
+    flux_t *h;
+    flux_future_t *f;
+    const char *blobref;
+    int flags = 0;
+    int i;
+
+    if (optparse_hasopt (p, "bypass-cache"))
+        flags |= CONTENT_FLAG_CACHE_BYPASS;
+    if (!(h = builtin_get_flux_handle (p)))
+        log_err_exit ("flux_open");
+    bufs = xzmalloc (count * sizeof (bufs[0]));
+    lens = xzmalloc (count * sizeof (lens[0]));
+    for (i = 0; i < count; i++) {
+        int fd;
+        if ((fd = open (av[n + i], O_RDONLY)) < 0)
+            log_err_exit ("%s", av[n + i]);
+        if ((lens[i] = read_all (fd, &bufs[i])) < 0)
+            log_err_exit ("%s", av[n + i]);
+        close (fd);
+    }
+    if (!(f = flux_content_store_batch (h,
+                                        (const void **)bufs,
+                                        lens,
+                                        count,
+                                        flags)))
+        log_err_exit ("flux_content_store_batch");
+    for (i = 0; i < count; i++) {
+        if (flux_content_store_batch_get (f, i, &blobref) < 0)
+            log_err_exit ("flux_content_store_batch_get");
+        printf ("%s\n", blobref);
+    }
+    flux_future_destroy (f);
+    flux_close (h);
+    for (i = 0; i < count; i++)
+        free (bufs[i]);
+    free (bufs);
+    free (lens);
+    return (0);
+}
+
 static int internal_content_store (optparse_t *p, int ac, char *av[])
 {
     uint8_t *data;
@@ -55,10 +125,8 @@ static int internal_content_store (optparse_t *p, int ac, char *av[])
     const char *blobref;
     int flags = 0;
 
-    if (optparse_option_index (p)  != ac) {
-        optparse_print_usage (p);
-        exit (1);
-    }
+    if (optparse_option_index (p) < ac)
+        return content_store_files (p, ac, av);
     if (optparse_hasopt (p, "bypass-cache"))
         flags |= CONTENT_FLAG_CACHE_BYPASS;
     if (!(h = builtin_get_flux_handle (p)))
@@ -194,15 +262,15 @@ static struct optparse_option store_opts[] = {
 
 static struct optparse_subcommand content_subcmds[] = {
     { "load",
-      "[OPTIONS] BLOBREF",
+      "[OPTIONS] BLOBREF...",
       "Load blob for digest BLOBREF to stdout",
       internal_content_load,
       0,
       load_opts,
     },
     { "store",
-      "[OPTIONS]",
-      "Store blob from stdin, print BLOBREF on stdout",
+      "[OPTIONS] [FILE...]",
+      "Store blob from stdin or FILEs, print BLOBREF on stdout",
       internal_content_store,
       0,
       store_opts,
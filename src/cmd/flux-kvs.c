@@ -440,6 +440,7 @@ int cmd_namespace_create (optparse_t *p, int argc, char **argv)
     flux_future_t *f;
     int optindex, i;
     uint32_t owner = FLUX_USERID_UNKNOWN;
+    int flags = 0;
     const char *str;
 
     optindex = optparse_option_index (p);
@@ -454,10 +455,11 @@ int cmd_namespace_create (optparse_t *p, int argc, char **argv)
         if (*endptr != '\0')
             log_msg_exit ("--owner requires an unsigned integer argument");
     }
+    if (optparse_hasopt (p, "binary"))
+        flags |= FLUX_KVS_NAMESPACE_BINARY;
 
     for (i = optindex; i < argc; i++) {
         const char *name = argv[i];
-        int flags = 0;
         if (!(f = flux_kvs_namespace_create (h, name, owner, flags))
             || flux_future_get (f, NULL) < 0)
             log_err_exit ("%s", name);
@@ -536,6 +538,9 @@ static struct optparse_option namespace_create_opts[] =  {
     { .name = "owner", .key = 'o', .has_arg = 1,
       .usage = "Specify alternate namespace owner via userid",
     },
+    { .name = "binary", .key = 'b', .has_arg = 0,
+      .usage = "Store directories in compact binary encoding",
+    },
     OPTPARSE_TABLE_END
 };
 
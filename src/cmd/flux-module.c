@@ -73,6 +73,9 @@ static struct optparse_option stats_opts[] =  {
     { .name = "clear-all", .key = 'C', .has_arg = 0,
       .usage = "Clear stats on all ranks",
     },
+    { .name = "reactor", .key = 'r', .has_arg = 1, .arginfo = "on|off",
+      .usage = "Enable or disable reactor instrumentation on target rank",
+    },
     OPTPARSE_TABLE_END
 };
 static struct optparse_option debug_opts[] = {
@@ -633,6 +636,21 @@ int cmd_stats (optparse_t *p, int argc, char **argv)
         if (flux_send (h, msg, 0) < 0)
             log_err_exit ("sending event");
         flux_msg_destroy (msg);
+    } else if (optparse_hasopt (p, "reactor")) {
+        const char *arg = optparse_get_str (p, "reactor", NULL);
+        int enable;
+        if (!strcmp (arg, "on"))
+            enable = 1;
+        else if (!strcmp (arg, "off"))
+            enable = 0;
+        else
+            log_msg_exit ("--reactor argument must be on or off");
+        topic = xasprintf ("%s.stats.reactor", service);
+        if (!(f = flux_rpc_pack (h, topic, nodeid, 0,
+                                 "{s:b}", "enable", enable)))
+            log_err_exit ("%s", topic);
+        if (flux_future_get (f, NULL) < 0)
+            log_err_exit ("%s", topic);
     } else if (optparse_hasopt (p, "rusage")) {
         topic = xasprintf ("%s.rusage", service);
         if (!(f = flux_rpc (h, topic, NULL, nodeid, 0)))
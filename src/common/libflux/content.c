@@ -19,6 +19,18 @@
 #include "content.h"
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
+
+/* Decoded batch response, cached in the future so that elements may be
+ * accessed by index without rescanning the payload.
+ */
+struct content_batch {
+    int count;
+    const void **data;
+    int *len;
+};
+
+static const char *auxkey = "flux::content_batch";
 
 flux_future_t *flux_content_load (flux_t *h, const char *blobref, int flags)
 {
@@ -73,6 +85,199 @@ int flux_content_store_get (flux_future_t *f, const char **blobref)
     return 0;
 }
 
+static void content_batch_destroy (struct content_batch *cb)
+{
+    if (cb) {
+        int saved_errno = errno;
+        free (cb->data);
+        free (cb->len);
+        free (cb);
+        errno = saved_errno;
+    }
+}
+
+static struct content_batch *content_batch_decode (const void *buf, int len)
+{
+    struct content_batch *cb;
+    int cursor = 0;
+    int count;
+    int i;
+
+    if ((count = blobvec_decode_count (buf, len)) < 0)
+        return NULL;
+    if (!(cb = calloc (1, sizeof (*cb)))
+        || (count > 0 && !(cb->data = calloc (count, sizeof (cb->data[0]))))
+        || (count > 0 && !(cb->len = calloc (count, sizeof (cb->len[0])))))
+        goto error;
+    for (i = 0; i < count; i++) {
+        if (blobvec_next (buf, len, &cursor, &cb->data[i], &cb->len[i]) != 1)
+            goto error;
+    }
+    cb->count = count;
+    return cb;
+error:
+    content_batch_destroy (cb);
+    return NULL;
+}
+
+/* Look up element 'index' of the batch response in 'f'.
+ * An error element sets errno to the error it carries.
+ */
+static int content_batch_get (flux_future_t *f,
+                              int index,
+                              const void **buf,
+                              int *len)
+{
+    struct content_batch *cb;
+
+    if (!(cb = flux_future_aux_get (f, auxkey))) {
+        const void *payload;
+        int payload_size;
+
+        if (flux_rpc_get_raw (f, &payload, &payload_size) < 0)
+            return -1;
+        if (!(cb = content_batch_decode (payload, payload_size)))
+            return -1;
+        if (flux_future_aux_set (f,
+                                 auxkey,
+                                 cb,
+                                 (flux_free_f)content_batch_destroy) < 0) {
+            content_batch_destroy (cb);
+            return -1;
+        }
+    }
+    if (index < 0 || index >= cb->count) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (cb->len[index] < 0) {
+        errno = -cb->len[index];
+        return -1;
+    }
+    *buf = cb->data[index];
+    *len = cb->len[index];
+    return 0;
+}
+
+flux_future_t *flux_content_load_batch (flux_t *h,
+                                        const char **blobrefs,
+                                        int count,
+                                        int flags)
+{
+    const char *topic = "content.load-batch";
+    uint32_t rank = FLUX_NODEID_ANY;
+    struct blobvec *bv;
+    const void *buf;
+    int len;
+    flux_future_t *f;
+    int i;
+
+    if (!h || !blobrefs || count <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (!blobrefs[i] || blobref_validate (blobrefs[i]) < 0) {
+            errno = EINVAL;
+            goto error;
+        }
+        if (blobvec_append (bv, blobrefs[i], strlen (blobrefs[i]) + 1) < 0)
+            goto error;
+    }
+    if ((flags & CONTENT_FLAG_UPSTREAM))
+        rank = FLUX_NODEID_UPSTREAM;
+    if ((flags & CONTENT_FLAG_CACHE_BYPASS)) {
+        topic = "content-backing.load-batch";
+        rank = 0;
+    }
+    blobvec_encode (bv, &buf, &len);
+    if (!(f = flux_rpc_raw (h, topic, buf, len, rank, 0)))
+        goto error;
+    blobvec_destroy (bv);
+    return f;
+error:
+    blobvec_destroy (bv);
+    return NULL;
+}
+
+int flux_content_load_batch_get (flux_future_t *f,
+                                 int index,
+                                 const void **buf,
+                                 int *len)
+{
+    const void *data;
+    int size;
+
+    if (content_batch_get (f, index, &data, &size) < 0)
+        return -1;
+    if (buf)
+        *buf = data;
+    if (len)
+        *len = size;
+    return 0;
+}
+
+flux_future_t *flux_content_store_batch (flux_t *h,
+                                         const void **bufs,
+                                         const int *lens,
+                                         int count,
+                                         int flags)
+{
+    const char *topic = "content.store-batch";
+    uint32_t rank = FLUX_NODEID_ANY;
+    struct blobvec *bv;
+    const void *buf;
+    int len;
+    flux_future_t *f;
+    int i;
+
+    if (!h || !bufs || !lens || count <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(bv = blobvec_create ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (blobvec_append (bv, bufs[i], lens[i]) < 0)
+            goto error;
+    }
+    if ((flags & CONTENT_FLAG_UPSTREAM))
+        rank = FLUX_NODEID_UPSTREAM;
+    if ((flags & CONTENT_FLAG_CACHE_BYPASS)) {
+        topic = "content-backing.store-batch";
+        rank = 0;
+    }
+    blobvec_encode (bv, &buf, &len);
+    if (!(f = flux_rpc_raw (h, topic, buf, len, rank, 0)))
+        goto error;
+    blobvec_destroy (bv);
+    return f;
+error:
+    blobvec_destroy (bv);
+    return NULL;
+}
+
+int flux_content_store_batch_get (flux_future_t *f,
+                                  int index,
+                                  const char **blobref)
+{
+    const char *ref;
+    int ref_size;
+
+    if (content_batch_get (f, index, (const void **)&ref, &ref_size) < 0)
+        return -1;
+    if (ref_size == 0 || ref[ref_size - 1] != '\0'
+                      || blobref_validate (ref) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (blobref)
+        *blobref = ref;
+    return 0;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -46,6 +46,43 @@ flux_future_t *flux_content_store (flux_t *h,
  */
 int flux_content_store_get (flux_future_t *f, const char **blobref);
 
+/* Send request to load 'count' blobs by blobref in a single message.
+ * Flags are as for flux_content_load().
+ */
+flux_future_t *flux_content_load_batch (flux_t *h,
+                                        const char **blobrefs,
+                                        int count,
+                                        int flags);
+
+/* Get result of load batch request at 'index' (blob), where 'index'
+ * corresponds to the position of the blobref in the request.
+ * This blocks until response is received.
+ * Storage for 'buf' belongs to 'f' and is valid until 'f' is destroyed.
+ * Returns 0 on success, -1 on failure with errno set, if either the
+ * request as a whole failed, or the blob at 'index' could not be loaded.
+ */
+int flux_content_load_batch_get (flux_future_t *f,
+                                 int index,
+                                 const void **buf,
+                                 int *len);
+
+/* Send request to store 'count' blobs in a single message.
+ * Flags are as for flux_content_store().
+ */
+flux_future_t *flux_content_store_batch (flux_t *h,
+                                         const void **bufs,
+                                         const int *lens,
+                                         int count,
+                                         int flags);
+
+/* Get result of store batch request at 'index' (blobref).
+ * Storage for 'blobref' belongs to 'f' and is valid until 'f' is destroyed.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int flux_content_store_batch_get (flux_future_t *f,
+                                  int index,
+                                  const char **blobref);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,7 @@
 #include "message.h"
 #include "tagpool.h"
 #include "msg_handler.h" // for flux_sleep_on ()
+#include "msg_handler_private.h"
 #include "flog.h"
 #include "conf.h"
 
@@ -505,6 +506,7 @@ void tagpool_grow_notify (void *arg, uint32_t old, uint32_t new)
 {
     flux_t *h = arg;
     flux_log (h, LOG_INFO, "tagpool expanded from %u to %u entries", old, new);
+    flux_dispatch_matchtag_reserve (h, new);
 }
 
 uint32_t flux_matchtag_alloc (flux_t *h)
@@ -520,6 +522,23 @@ uint32_t flux_matchtag_alloc (flux_t *h)
     return tag;
 }
 
+uint32_t flux_matchtag_alloc_range (flux_t *h, int count)
+{
+    h = lookup_clone_ancestor (h);
+    uint32_t tag;
+
+    if (count <= 0) {
+        errno = EINVAL;
+        return FLUX_MATCHTAG_NONE;
+    }
+    tag = tagpool_alloc_range (h->tagpool, count);
+    if (tag == FLUX_MATCHTAG_NONE) {
+        flux_log (h, LOG_ERR, "tagpool temporarily out of tags");
+        errno = EBUSY;
+    }
+    return tag;
+}
+
 /* Free matchtag, first deleting any queued matching responses.
  */
 void flux_matchtag_free (flux_t *h, uint32_t matchtag)
@@ -127,8 +127,11 @@ int flux_flags_get (flux_t *h);
 
 /* Alloc/free matchtag for matched request/response.
  * This is mainly used internally by the rpc code.
+ * flux_matchtag_alloc_range() allocates 'count' consecutive matchtags
+ * and returns the first;  each is freed individually.
  */
 uint32_t flux_matchtag_alloc (flux_t *h);
+uint32_t flux_matchtag_alloc_range (flux_t *h, int count);
 void flux_matchtag_free (flux_t *h, uint32_t matchtag);
 uint32_t flux_matchtag_avail (flux_t *h);
 
@@ -8,7 +8,7 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* A flux messages consist of a list of zeromq frames:
+/* A flux message consists of a list of zeromq frames:
  *
  * [route]
  * [route]
@@ -33,6 +33,8 @@
 #include <assert.h>
 #include <fnmatch.h>
 #include <inttypes.h>
+#include <stddef.h>
+#include <pthread.h>
 #include <czmq.h>
 #include <jansson.h>
 
@@ -41,14 +43,6 @@
 
 #include "message.h"
 
-struct flux_msg {
-    zmsg_t *zmsg;
-    json_t *json;
-    char *lasterr;
-    struct aux_item *aux;
-    int refcount;
-};
-
 /* Begin manual codec
  * PROTO consists of 4 byte prelude followed by a fixed length
  * array of u32's in network byte order.
@@ -116,7 +110,7 @@ static int proto_set_type (uint8_t *data, int len, int type)
     data[PROTO_OFF_TYPE] = type;
     return 0;
 }
-static int proto_get_type (uint8_t *data, int len, int *type)
+static int proto_get_type (const uint8_t *data, int len, int *type)
 {
     if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
                          || data[PROTO_OFF_VERSION] != PROTO_VERSION)
@@ -132,7 +126,7 @@ static int proto_set_flags (uint8_t *data, int len, uint8_t flags)
     data[PROTO_OFF_FLAGS] = flags;
     return 0;
 }
-static int proto_get_flags (uint8_t *data, int len, uint8_t *val)
+static int proto_get_flags (const uint8_t *data, int len, uint8_t *val)
 {
     if (len < PROTO_SIZE || data[PROTO_OFF_MAGIC] != PROTO_MAGIC
                          || data[PROTO_OFF_VERSION] != PROTO_VERSION)
@@ -152,7 +146,7 @@ static int proto_set_u32 (uint8_t *data, int len, int index, uint32_t val)
     memcpy (&data[offset], &x, sizeof (x));
     return 0;
 }
-static int proto_get_u32 (uint8_t *data, int len, int index, uint32_t *val)
+static int proto_get_u32 (const uint8_t *data, int len, int index, uint32_t *val)
 {
     uint32_t x;
     int offset = PROTO_OFF_U32_ARRAY + index * 4;
@@ -181,34 +175,492 @@ static void proto_init (uint8_t *data, int len, uint8_t flags)
 /* End manual codec
  */
 
+/* In memory, the PROTO frame is stored in the message structure and the
+ * remaining frames are stored back to back in a single buffer, in the
+ * same encoding used by flux_msg_encode():
+ *
+ *   [headroom][route]...[route][delim][topic][payload][free]
+ *             ^head                   ^topic ^payload ^tail
+ *
+ * Routes are pushed into the headroom, so the buffer always holds the
+ * frames in wire order and encoding a message is a single memcpy().
+ * Small messages use storage inline in the message structure.
+ *
+ * A large payload may instead be held in a zeromq message, so that it
+ * can be handed to zeromq, or copied to another message, without copying
+ * the payload data.  See msg_payload_share().
+ */
+#define MSG_INLINE_SIZE         448
+#define MSG_HEADROOM            64
+#define MSG_PAYLOAD_SHARE_MIN   1024
+
+struct flux_msg {
+    uint8_t proto[PROTO_SIZE];
+    uint8_t *buf;
+    size_t bufsize;
+    size_t head;
+    size_t topic;
+    size_t payload;
+    size_t tail;
+    int routes;
+    bool payload_shared;
+    zmq_msg_t zpayload;
+    json_t *json;
+    char *lasterr;
+    struct aux_item *aux;
+    int refcount;
+    uint8_t inline_buf[MSG_INLINE_SIZE];
+};
+
+/* Message pool
+ * Destroyed messages, and buffers of power-of-two size classes from
+ * MSG_POOL_BUF_MIN to MSG_POOL_BUF_MAX bytes, are kept on per-thread free
+ * lists for reuse.  Messages often travel between threads (e.g. a module
+ * thread and the broker), so an item is cached by whichever thread frees
+ * it.  The lists are bounded, and are freed when the thread exits.
+ */
+#define MSG_POOL_MSG_COUNT      256
+#define MSG_POOL_BUF_COUNT      32
+#define MSG_POOL_BUF_MIN_SHIFT  10
+#define MSG_POOL_BUF_MIN        (1 << MSG_POOL_BUF_MIN_SHIFT)
+#define MSG_POOL_BUF_CLASSES    7
+#define MSG_POOL_BUF_MAX        (MSG_POOL_BUF_MIN << (MSG_POOL_BUF_CLASSES - 1))
+
+struct msg_pool_item {
+    struct msg_pool_item *next;
+};
+
+struct msg_pool_list {
+    struct msg_pool_item *head;
+    int count;
+};
+
+struct msg_pool {
+    struct msg_pool_list msgs;
+    struct msg_pool_list bufs[MSG_POOL_BUF_CLASSES];
+    struct flux_msg_pool_stats stats;
+};
+
+static __thread struct msg_pool *msg_pool;
+static pthread_key_t msg_pool_key;
+static pthread_once_t msg_pool_once = PTHREAD_ONCE_INIT;
+static bool msg_pool_enabled;
+
+static void *msg_pool_list_pop (struct msg_pool_list *list)
+{
+    struct msg_pool_item *item = list->head;
+
+    if (item) {
+        list->head = item->next;
+        list->count--;
+    }
+    return item;
+}
+
+static bool msg_pool_list_push (struct msg_pool_list *list,
+                                void *ptr,
+                                int max)
+{
+    struct msg_pool_item *item = ptr;
+
+    if (list->count == max)
+        return false;
+    item->next = list->head;
+    list->head = item;
+    list->count++;
+    return true;
+}
+
+static void msg_pool_list_clear (struct msg_pool_list *list)
+{
+    void *item;
+
+    while ((item = msg_pool_list_pop (list)))
+        free (item);
+}
+
+/* pthread key destructor, called when a thread with a pool exits.
+ */
+static void msg_pool_destroy (void *arg)
+{
+    struct msg_pool *pool = arg;
+    int i;
+
+    msg_pool_list_clear (&pool->msgs);
+    for (i = 0; i < MSG_POOL_BUF_CLASSES; i++)
+        msg_pool_list_clear (&pool->bufs[i]);
+    free (pool);
+    msg_pool = NULL;
+}
+
+static void msg_pool_init (void)
+{
+    const char *s = getenv ("FLUX_MSG_POOL");
+
+    if (s && !strcmp (s, "0"))
+        return;
+    if (pthread_key_create (&msg_pool_key, msg_pool_destroy) == 0)
+        msg_pool_enabled = true;
+}
+
+/* Return the calling thread's pool, creating it if needed,
+ * or NULL if pooling is disabled or the pool could not be created.
+ */
+static struct msg_pool *msg_pool_get (void)
+{
+    struct msg_pool *pool;
+
+    if (msg_pool)
+        return msg_pool;
+    pthread_once (&msg_pool_once, msg_pool_init);
+    if (!msg_pool_enabled || !(pool = calloc (1, sizeof (*pool))))
+        return NULL;
+    if (pthread_setspecific (msg_pool_key, pool) != 0) {
+        free (pool);
+        return NULL;
+    }
+    return msg_pool = pool;
+}
+
+static flux_msg_t *msg_pool_alloc_msg (void)
+{
+    struct msg_pool *pool = msg_pool_get ();
+    flux_msg_t *msg;
+
+    if (pool && (msg = msg_pool_list_pop (&pool->msgs))) {
+        pool->stats.msg_hits++;
+        return msg;
+    }
+    if (pool)
+        pool->stats.msg_misses++;
+    return malloc (sizeof (*msg));
+}
+
+static void msg_pool_free_msg (flux_msg_t *msg)
+{
+    struct msg_pool *pool = msg_pool_get ();
+
+    if (!pool || !msg_pool_list_push (&pool->msgs, msg, MSG_POOL_MSG_COUNT))
+        free (msg);
+}
+
+/* Return the size class index for a buffer of 'size' bytes, or -1 if
+ * the buffer is too large to pool.
+ */
+static int msg_pool_buf_class (size_t size)
+{
+    int i = 0;
+
+    if (size > MSG_POOL_BUF_MAX)
+        return -1;
+    while ((MSG_POOL_BUF_MIN << i) < size)
+        i++;
+    return i;
+}
+
+/* Allocate a buffer of at least '*size' bytes, updating '*size' to the
+ * actual size if it was rounded up to a pooled size class.
+ */
+static void *msg_pool_alloc_buf (size_t *size)
+{
+    struct msg_pool *pool = msg_pool_get ();
+    int i;
+    void *buf;
+
+    if (!pool || (i = msg_pool_buf_class (*size)) < 0)
+        return malloc (*size);
+    *size = MSG_POOL_BUF_MIN << i;
+    if ((buf = msg_pool_list_pop (&pool->bufs[i]))) {
+        pool->stats.buf_hits++;
+        return buf;
+    }
+    pool->stats.buf_misses++;
+    return malloc (*size);
+}
+
+/* Only buffers that are exactly a size class in size are pooled.
+ */
+static void msg_pool_free_buf (void *buf, size_t size)
+{
+    struct msg_pool *pool = msg_pool_get ();
+    int i;
+
+    if (!pool
+        || (i = msg_pool_buf_class (size)) < 0
+        || (MSG_POOL_BUF_MIN << i) != size
+        || !msg_pool_list_push (&pool->bufs[i], buf, MSG_POOL_BUF_COUNT))
+        free (buf);
+}
+
+int flux_msg_pool_get_stats (struct flux_msg_pool_stats *stats)
+{
+    struct msg_pool *pool;
+    int i;
+
+    if (!stats) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset (stats, 0, sizeof (*stats));
+    if ((pool = msg_pool_get ())) {
+        *stats = pool->stats;
+        stats->msg_cached = pool->msgs.count;
+        for (i = 0; i < MSG_POOL_BUF_CLASSES; i++)
+            stats->buf_cached += pool->bufs[i].count;
+    }
+    return 0;
+}
+
+void flux_msg_pool_clear_stats (void)
+{
+    struct msg_pool *pool;
+
+    if ((pool = msg_pool_get ()))
+        memset (&pool->stats, 0, sizeof (pool->stats));
+}
+
+/* Frame codec
+ * A frame is a one byte size followed by data, or if the size is 0xff or
+ * more, 0xff followed by a four byte size in network byte order.
+ */
+#define FRAME_SIZE_LONG     0xff
+
+static size_t frame_encode_size (size_t n)
+{
+    return (n < FRAME_SIZE_LONG ? 1 : 1 + 4) + n;
+}
+
+static uint8_t *frame_encode (uint8_t *p, const void *data, size_t n)
+{
+    if (n < FRAME_SIZE_LONG)
+        *p++ = (uint8_t)n;
+    else {
+        uint32_t x = htonl (n);
+        *p++ = FRAME_SIZE_LONG;
+        memcpy (p, &x, sizeof (x));
+        p += sizeof (x);
+    }
+    if (n > 0)
+        memcpy (p, data, n);
+    return p + n;
+}
+
+/* Decode frame at 'p' with 'avail' bytes remaining in the buffer.
+ * Returns the encoded size of the frame, or -1 if it is truncated.
+ */
+static ssize_t frame_decode (const uint8_t *p,
+                             size_t avail,
+                             const uint8_t **data,
+                             size_t *n)
+{
+    size_t prefix = 1;
+    size_t size;
+
+    if (avail < 1)
+        return -1;
+    size = *p;
+    if (size == FRAME_SIZE_LONG) {
+        uint32_t x;
+        if (avail < 1 + sizeof (x))
+            return -1;
+        memcpy (&x, p + 1, sizeof (x));
+        size = ntohl (x);
+        prefix += sizeof (x);
+    }
+    if (avail - prefix < size)
+        return -1;
+    if (data)
+        *data = p + prefix;
+    if (n)
+        *n = size;
+    return prefix + size;
+}
+/* End frame codec
+ */
+
+/* Ensure there is room for 'front' more bytes before msg->head and 'back'
+ * more bytes after msg->tail, moving the frames if necessary.
+ */
+static int msg_reserve (flux_msg_t *msg, size_t front, size_t back)
+{
+    size_t used = msg->tail - msg->head;
+    size_t head, size;
+    uint8_t *buf;
+    ssize_t delta;
+
+    if (msg->head >= front && msg->bufsize - msg->tail >= back)
+        return 0;
+    head = front + MSG_HEADROOM;
+    size = head + used + back;
+    if (size <= msg->bufsize)
+        buf = msg->buf;
+    else {
+        if (!(buf = msg_pool_alloc_buf (&size))) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    memmove (buf + head, msg->buf + msg->head, used);
+    if (buf != msg->buf) {
+        if (msg->buf != msg->inline_buf)
+            msg_pool_free_buf (msg->buf, msg->bufsize);
+        msg->buf = buf;
+        msg->bufsize = size;
+    }
+    delta = head - msg->head;
+    msg->head += delta;
+    msg->topic += delta;
+    msg->payload += delta;
+    msg->tail += delta;
+    return 0;
+}
+
+/* Set the frame offsets from the encoded frames in the buffer and the
+ * PROTO flags.  Fail with EPROTO if they are inconsistent.
+ */
+static int msg_parse (flux_msg_t *msg)
+{
+    uint8_t flags;
+    size_t off = msg->head;
+    ssize_t len;
+    size_t n;
+
+    if (proto_get_flags (msg->proto, PROTO_SIZE, &flags) < 0)
+        goto error;
+    msg->routes = 0;
+    if ((flags & FLUX_MSGFLAG_ROUTE)) {
+        do {
+            if ((len = frame_decode (msg->buf + off,
+                                     msg->tail - off,
+                                     NULL,
+                                     &n)) < 0)
+                goto error;
+            off += len;
+            if (n > 0)
+                msg->routes++;
+        } while (n > 0);
+    }
+    msg->topic = off;
+    if ((flags & FLUX_MSGFLAG_TOPIC)) {
+        if ((len = frame_decode (msg->buf + off,
+                                 msg->tail - off,
+                                 NULL,
+                                 NULL)) < 0)
+            goto error;
+        off += len;
+    }
+    msg->payload = off;
+    if ((flags & FLUX_MSGFLAG_PAYLOAD) && !msg->payload_shared) {
+        if ((len = frame_decode (msg->buf + off,
+                                 msg->tail - off,
+                                 NULL,
+                                 NULL)) < 0)
+            goto error;
+        off += len;
+    }
+    if (off != msg->tail)
+        goto error;
+    return 0;
+error:
+    errno = EPROTO;
+    return -1;
+}
+
+/* Append an encoded frame containing 'data' to the buffer.
+ */
+static int msg_append_frame (flux_msg_t *msg, const void *data, size_t n)
+{
+    if (msg_reserve (msg, 0, frame_encode_size (n)) < 0)
+        return -1;
+    msg->tail = frame_encode (msg->buf + msg->tail, data, n) - msg->buf;
+    return 0;
+}
+
+static void msg_payload_clear (flux_msg_t *msg)
+{
+    if (msg->payload_shared) {
+        zmq_msg_close (&msg->zpayload);
+        msg->payload_shared = false;
+    }
+    msg->tail = msg->payload;
+}
+
+static int msg_payload_get (const flux_msg_t *msg,
+                            const uint8_t **data,
+                            size_t *n)
+{
+    if (msg->payload_shared) {
+        zmq_msg_t *zpayload = (zmq_msg_t *)&msg->zpayload;
+        *data = zmq_msg_data (zpayload);
+        *n = zmq_msg_size (zpayload);
+        return 0;
+    }
+    if (frame_decode (msg->buf + msg->payload,
+                      msg->tail - msg->payload,
+                      data,
+                      n) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/* Move a large payload from the buffer to a zeromq message, which can be
+ * sent or copied with zmq_msg_copy() without copying the payload data.
+ * N.B. const attribute of msg argument is defeated internally, since only
+ * the storage of the payload changes, not the message content.
+ */
+static int msg_payload_share (const flux_msg_t *const_msg)
+{
+    flux_msg_t *msg = (flux_msg_t *)const_msg;
+    const uint8_t *data;
+    size_t n;
+    uint8_t flags;
+
+    if (msg->payload_shared)
+        return 0;
+    if (proto_get_flags (msg->proto, PROTO_SIZE, &flags) < 0
+        || !(flags & FLUX_MSGFLAG_PAYLOAD)
+        || msg_payload_get (msg, &data, &n) < 0
+        || n < MSG_PAYLOAD_SHARE_MIN)
+        return 0;
+    if (zmq_msg_init_size (&msg->zpayload, n) < 0)
+        return -1;
+    memcpy (zmq_msg_data (&msg->zpayload), data, n);
+    msg->payload_shared = true;
+    msg->tail = msg->payload;
+    return 0;
+}
+
 static flux_msg_t *flux_msg_create_common (void)
 {
     flux_msg_t *msg;
 
-    if (!(msg = calloc (1, sizeof (*msg))))
+    if (!(msg = msg_pool_alloc_msg ())) {
+        errno = ENOMEM;
         return NULL;
+    }
+    /* The inline buffer need not be cleared.
+     */
+    memset (msg, 0, offsetof (struct flux_msg, inline_buf));
+    msg->buf = msg->inline_buf;
+    msg->bufsize = sizeof (msg->inline_buf);
+    msg->head = msg->topic = msg->payload = msg->tail = MSG_HEADROOM;
     msg->refcount = 1;
     return msg;
 }
 
 flux_msg_t *flux_msg_create (int type)
 {
-    uint8_t proto[PROTO_SIZE];
     flux_msg_t *msg;
 
     if (!(msg = flux_msg_create_common ()))
         return NULL;
-    proto_init (proto, PROTO_SIZE, 0);
-    if (proto_set_type (proto, PROTO_SIZE, type) < 0) {
+    proto_init (msg->proto, PROTO_SIZE, 0);
+    if (proto_set_type (msg->proto, PROTO_SIZE, type) < 0) {
         errno = EINVAL;
         goto error;
     }
-    if (!(msg->zmsg = zmsg_new ())) {
-        errno = ENOMEM;
-        goto error;
-    }
-    if (zmsg_addmem (msg->zmsg, proto, PROTO_SIZE) < 0)
-        goto error;
     return msg;
 error:
     flux_msg_destroy (msg);
@@ -220,10 +672,13 @@ void flux_msg_destroy (flux_msg_t *msg)
     if (msg && --msg->refcount == 0) {
         int saved_errno = errno;
         json_decref (msg->json);
-        zmsg_destroy (&msg->zmsg);
+        if (msg->payload_shared)
+            zmq_msg_close (&msg->zpayload);
+        if (msg->buf != msg->inline_buf)
+            msg_pool_free_buf (msg->buf, msg->bufsize);
         aux_destroy (&msg->aux);
         free (msg->lasterr);
-        free (msg);
+        msg_pool_free_msg (msg);
         errno = saved_errno;
     }
 }
@@ -277,85 +732,69 @@ void *flux_msg_aux_get (const flux_msg_t *msg, const char *name)
 
 size_t flux_msg_encode_size (const flux_msg_t *msg)
 {
-    zframe_t *zf;
-    size_t size = 0;
+    size_t size = msg->tail - msg->head;
 
-    zf = zmsg_first (msg->zmsg);
-    while (zf) {
-        size_t n = zframe_size (zf);
-        if (n < 255)
-            size += 1;
-        else
-            size += 1 + 4;
-        size += n;
-        zf = zmsg_next (msg->zmsg);
+    if (msg->payload_shared) {
+        zmq_msg_t *zpayload = (zmq_msg_t *)&msg->zpayload;
+        size += frame_encode_size (zmq_msg_size (zpayload));
     }
-    return size;
+    return size + frame_encode_size (PROTO_SIZE);
 }
 
 
 int flux_msg_encode (const flux_msg_t *msg, void *buf, size_t size)
 {
     uint8_t *p = buf;
-    zframe_t *zf;
-
-    zf = zmsg_first (msg->zmsg);
-    while (zf) {
-        size_t n = zframe_size (zf);
-        if (n < 0xff) {
-            if (size - (p - (uint8_t *)buf) < n + 1)
-                goto nospace;
-            *p++ = (uint8_t)n;
-        } else {
-            if (size - (p - (uint8_t *)buf) < n + 1 + 4)
-                goto nospace;
-            *p++ = 0xff;
-            *(uint32_t *)p = htonl (n);
-            p += 4;
-        }
-        memcpy (p, zframe_data (zf), n);
-        p += n;
-        zf = zmsg_next (msg->zmsg);
+    size_t used = msg->tail - msg->head;
+
+    if (size < flux_msg_encode_size (msg)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy (p, msg->buf + msg->head, used);
+    p += used;
+    if (msg->payload_shared) {
+        zmq_msg_t *zpayload = (zmq_msg_t *)&msg->zpayload;
+        p = frame_encode (p, zmq_msg_data (zpayload), zmq_msg_size (zpayload));
     }
+    frame_encode (p, msg->proto, PROTO_SIZE);
     return 0;
-nospace:
-    errno = EINVAL;
-    return -1;
 }
 
 flux_msg_t *flux_msg_decode (const void *buf, size_t size)
 {
     flux_msg_t *msg;
-    uint8_t const *p = buf;
-    zframe_t *zf;
-
-    if (!(msg = flux_msg_create_common ()))
-        return NULL;
-    if (!(msg->zmsg = zmsg_new ()))
-        goto nomem;
-    while (p - (uint8_t *)buf < size) {
-        size_t n = *p++;
-        if (n == 0xff) {
-            if (size - (p - (uint8_t *)buf) < 4) {
-                errno = EINVAL;
-                goto error;
-            }
-            n = ntohl (*(uint32_t *)p);
-            p += 4;
-        }
-        if (size - (p - (uint8_t *)buf) < n) {
+    const uint8_t *p = buf;
+    const uint8_t *proto = NULL;
+    size_t off = 0;
+    size_t last = 0;
+    ssize_t len;
+    size_t n = 0;
+
+    /* Find the PROTO frame, which is last.
+     */
+    while (off < size) {
+        if ((len = frame_decode (p + off, size - off, &proto, &n)) < 0) {
             errno = EINVAL;
-            goto error;
+            return NULL;
         }
-        if (!(zf = zframe_new (p, n)))
-            goto nomem;
-        if (zmsg_append (msg->zmsg, &zf) < 0)
-            goto nomem;
-        p += n;
+        last = off;
+        off += len;
     }
+    if (!proto || n != PROTO_SIZE) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (!(msg = flux_msg_create_common ()))
+        return NULL;
+    memcpy (msg->proto, proto, PROTO_SIZE);
+    if (msg_reserve (msg, 0, last) < 0)
+        goto error;
+    memcpy (msg->buf + msg->tail, p, last);
+    msg->tail += last;
+    if (msg_parse (msg) < 0)
+        goto error;
     return msg;
-nomem:
-    errno = ENOMEM;
 error:
     flux_msg_destroy (msg);
     return NULL;
@@ -363,8 +802,7 @@ error:
 
 int flux_msg_set_type (flux_msg_t *msg, int type)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_type (zframe_data (zf), zframe_size (zf), type) < 0) {
+    if (proto_set_type (msg->proto, PROTO_SIZE, type) < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -373,8 +811,7 @@ int flux_msg_set_type (flux_msg_t *msg, int type)
 
 int flux_msg_get_type (const flux_msg_t *msg, int *type)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), type) < 0) {
+    if (proto_get_type (msg->proto, PROTO_SIZE, type) < 0) {
         errno = EPROTO;
         return -1;
     }
@@ -386,15 +823,15 @@ int flux_msg_set_flags (flux_msg_t *msg, uint8_t fl)
     const uint8_t valid_flags = FLUX_MSGFLAG_TOPIC | FLUX_MSGFLAG_PAYLOAD
                               | FLUX_MSGFLAG_ROUTE | FLUX_MSGFLAG_UPSTREAM
                               | FLUX_MSGFLAG_PRIVATE | FLUX_MSGFLAG_STREAMING
-                              | FLUX_MSGFLAG_NORESPONSE;
+                              | FLUX_MSGFLAG_NORESPONSE
+                              | FLUX_MSGFLAG_USER1;
 
     if (!msg || fl & ~valid_flags || ((fl & FLUX_MSGFLAG_STREAMING)
                                    && (fl & FLUX_MSGFLAG_NORESPONSE)) != 0) {
         errno = EINVAL;
         return -1;
     }
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_flags (zframe_data (zf), zframe_size (zf), fl) < 0) {
+    if (proto_set_flags (msg->proto, PROTO_SIZE, fl) < 0) {
         errno = EINVAL;
         return -1;
     }
@@ -407,8 +844,7 @@ int flux_msg_get_flags (const flux_msg_t *msg, uint8_t *fl)
         errno = EINVAL;
         return -1;
     }
-    zframe_t *zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_flags (zframe_data (zf), zframe_size (zf), fl) < 0) {
+    if (proto_get_flags (msg->proto, PROTO_SIZE, fl) < 0) {
         errno = EPROTO;
         return -1;
     }
@@ -471,17 +907,33 @@ bool flux_msg_is_noresponse (const flux_msg_t *msg)
     return (flags & FLUX_MSGFLAG_NORESPONSE) ? true : false;
 }
 
+int flux_msg_set_user1 (flux_msg_t *msg)
+{
+    uint8_t flags;
+    if (flux_msg_get_flags (msg, &flags) < 0)
+        return -1;
+    if (flux_msg_set_flags (msg, flags | FLUX_MSGFLAG_USER1) < 0)
+        return -1;
+    return 0;
+}
+
+bool flux_msg_is_user1 (const flux_msg_t *msg)
+{
+    uint8_t flags;
+    if (flux_msg_get_flags (msg, &flags) < 0)
+        return false;
+    return (flags & FLUX_MSGFLAG_USER1) ? true : false;
+}
+
 int flux_msg_set_userid (flux_msg_t *msg, uint32_t userid)
 {
-    zframe_t *zf;
 
     if (!msg) {
         errno = EINVAL;
         return -1;
     }
-    zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_u32 (zframe_data (zf),
-                              zframe_size (zf),
+    if (proto_set_u32 (msg->proto,
+                              PROTO_SIZE,
                               PROTO_IND_USERID,
                               userid) < 0) {
         errno = EINVAL;
@@ -492,15 +944,13 @@ int flux_msg_set_userid (flux_msg_t *msg, uint32_t userid)
 
 int flux_msg_get_userid (const flux_msg_t *msg, uint32_t *userid)
 {
-    zframe_t *zf;
 
     if (!msg || !userid) {
         errno = EINVAL;
         return -1;
     }
-    zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_u32 (zframe_data (zf),
-                              zframe_size (zf),
+    if (proto_get_u32 (msg->proto,
+                              PROTO_SIZE,
                               PROTO_IND_USERID,
                               userid) < 0) {
         errno = EPROTO;
@@ -511,15 +961,13 @@ int flux_msg_get_userid (const flux_msg_t *msg, uint32_t *userid)
 
 int flux_msg_set_rolemask (flux_msg_t *msg, uint32_t rolemask)
 {
-    zframe_t *zf;
 
     if (!msg) {
         errno = EINVAL;
         return -1;
     }
-    zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_set_u32 (zframe_data (zf),
-                              zframe_size (zf),
+    if (proto_set_u32 (msg->proto,
+                              PROTO_SIZE,
                               PROTO_IND_ROLEMASK,
                               rolemask) < 0) {
         errno = EINVAL;
@@ -530,15 +978,13 @@ int flux_msg_set_rolemask (flux_msg_t *msg, uint32_t rolemask)
 
 int flux_msg_get_rolemask (const flux_msg_t *msg, uint32_t *rolemask)
 {
-    zframe_t *zf;
 
     if (!msg || !rolemask) {
         errno = EINVAL;
         return -1;
     }
-    zf = zmsg_last (msg->zmsg);
-    if (!zf || proto_get_u32 (zframe_data (zf),
-                              zframe_size (zf),
+    if (proto_get_u32 (msg->proto,
+                              PROTO_SIZE,
                               PROTO_IND_ROLEMASK,
                               rolemask) < 0) {
         errno = EPROTO;
@@ -597,20 +1043,17 @@ int flux_msg_authorize (const flux_msg_t *msg, uint32_t userid)
 
 int flux_msg_set_nodeid (flux_msg_t *msg, uint32_t nodeid)
 {
-    zframe_t *zf;
     int type;
 
     if (!msg)
         goto error;
     if (nodeid == FLUX_NODEID_UPSTREAM) /* should have been resolved earlier */
         goto error;
-    if (!(zf = zmsg_last (msg->zmsg)))
-        goto error;
-    if (proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0)
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0)
         goto error;
     if (type != FLUX_MSGTYPE_REQUEST)
         goto error;
-    if (proto_set_u32 (zframe_data (zf), zframe_size (zf),
+    if (proto_set_u32 (msg->proto, PROTO_SIZE,
                        PROTO_IND_NODEID, nodeid) < 0)
         goto error;
     return 0;
@@ -621,7 +1064,6 @@ error:
 
 int flux_msg_get_nodeid (const flux_msg_t *msg, uint32_t *nodeidp)
 {
-    zframe_t *zf;
     int type;
     uint32_t nodeid;
 
@@ -629,13 +1071,11 @@ int flux_msg_get_nodeid (const flux_msg_t *msg, uint32_t *nodeidp)
         errno = EINVAL;
         return -1;
     }
-    if (!(zf = zmsg_last (msg->zmsg)))
-        goto error;
-    if (proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0)
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0)
         goto error;
     if (type != FLUX_MSGTYPE_REQUEST)
         goto error;
-    if (proto_get_u32 (zframe_data (zf), zframe_size (zf),
+    if (proto_get_u32 (msg->proto, PROTO_SIZE,
                        PROTO_IND_NODEID, &nodeid) < 0)
         goto error;
     *nodeidp = nodeid;
@@ -647,12 +1087,11 @@ error:
 
 int flux_msg_set_errnum (flux_msg_t *msg, int e)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || (type != FLUX_MSGTYPE_RESPONSE && type != FLUX_MSGTYPE_KEEPALIVE)
-            || proto_set_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_set_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_ERRNUM, e) < 0) {
         errno = EINVAL;
         return -1;
@@ -662,13 +1101,12 @@ int flux_msg_set_errnum (flux_msg_t *msg, int e)
 
 int flux_msg_get_errnum (const flux_msg_t *msg, int *e)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
     uint32_t xe;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || (type != FLUX_MSGTYPE_RESPONSE && type != FLUX_MSGTYPE_KEEPALIVE)
-            || proto_get_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_get_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_ERRNUM, &xe) < 0) {
         errno = EPROTO;
         return -1;
@@ -679,12 +1117,11 @@ int flux_msg_get_errnum (const flux_msg_t *msg, int *e)
 
 int flux_msg_set_seq (flux_msg_t *msg, uint32_t seq)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || type != FLUX_MSGTYPE_EVENT
-            || proto_set_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_set_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_SEQUENCE, seq) < 0) {
         errno = EINVAL;
         return -1;
@@ -694,12 +1131,11 @@ int flux_msg_set_seq (flux_msg_t *msg, uint32_t seq)
 
 int flux_msg_get_seq (const flux_msg_t *msg, uint32_t *seq)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || type != FLUX_MSGTYPE_EVENT
-            || proto_get_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_get_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_SEQUENCE, seq) < 0) {
         errno = EPROTO;
         return -1;
@@ -709,12 +1145,11 @@ int flux_msg_get_seq (const flux_msg_t *msg, uint32_t *seq)
 
 int flux_msg_set_matchtag (flux_msg_t *msg, uint32_t t)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || (type != FLUX_MSGTYPE_REQUEST && type != FLUX_MSGTYPE_RESPONSE)
-            || proto_set_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_set_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_MATCHTAG, t) < 0) {
         errno = EINVAL;
         return -1;
@@ -724,12 +1159,11 @@ int flux_msg_set_matchtag (flux_msg_t *msg, uint32_t t)
 
 int flux_msg_get_matchtag (const flux_msg_t *msg, uint32_t *t)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || (type != FLUX_MSGTYPE_REQUEST && type != FLUX_MSGTYPE_RESPONSE)
-            || proto_get_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_get_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_MATCHTAG, t) < 0) {
         errno = EPROTO;
         return -1;
@@ -739,12 +1173,11 @@ int flux_msg_get_matchtag (const flux_msg_t *msg, uint32_t *t)
 
 int flux_msg_set_status (flux_msg_t *msg, int s)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || type != FLUX_MSGTYPE_KEEPALIVE
-            || proto_set_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_set_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_STATUS, s) < 0) {
         errno = EINVAL;
         return -1;
@@ -754,13 +1187,12 @@ int flux_msg_set_status (flux_msg_t *msg, int s)
 
 int flux_msg_get_status (const flux_msg_t *msg, int *s)
 {
-    zframe_t *zf = zmsg_last (msg->zmsg);
     int type;
     uint32_t u;
 
-    if (!zf || proto_get_type (zframe_data (zf), zframe_size (zf), &type) < 0
+    if (proto_get_type (msg->proto, PROTO_SIZE, &type) < 0
             || type != FLUX_MSGTYPE_KEEPALIVE
-            || proto_get_u32 (zframe_data (zf), zframe_size (zf),
+            || proto_get_u32 (msg->proto, PROTO_SIZE,
                               PROTO_IND_STATUS, &u) < 0) {
         errno = EPROTO;
         return -1;
@@ -834,10 +1266,10 @@ int flux_msg_enable_route (flux_msg_t *msg)
         return -1;
     if ((flags & FLUX_MSGFLAG_ROUTE))
         return 0;
-    if (zmsg_pushmem (msg->zmsg, NULL, 0) < 0) {
-        errno = ENOMEM;
+    if (msg_reserve (msg, frame_encode_size (0), 0) < 0)
         return -1;
-    }
+    msg->head -= frame_encode_size (0);
+    frame_encode (msg->buf + msg->head, NULL, 0);
     flags |= FLUX_MSGFLAG_ROUTE;
     return flux_msg_set_flags (msg, flags);
 }
@@ -845,19 +1277,13 @@ int flux_msg_enable_route (flux_msg_t *msg)
 int flux_msg_clear_route (flux_msg_t *msg)
 {
     uint8_t flags;
-    zframe_t *zf;
-    int size;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
     if (!(flags & FLUX_MSGFLAG_ROUTE))
         return 0;
-    while ((zf = zmsg_pop (msg->zmsg))) {
-        size = zframe_size (zf);
-        zframe_destroy (&zf);
-        if (size == 0)
-            break;
-    }
+    msg->head = msg->topic;
+    msg->routes = 0;
     flags &= ~(uint8_t)FLUX_MSGFLAG_ROUTE;
     return flux_msg_set_flags (msg, flags);
 }
@@ -865,6 +1291,7 @@ int flux_msg_clear_route (flux_msg_t *msg)
 int flux_msg_push_route (flux_msg_t *msg, const char *id)
 {
     uint8_t flags;
+    size_t n;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
@@ -872,39 +1299,65 @@ int flux_msg_push_route (flux_msg_t *msg, const char *id)
         errno = EPROTO;
         return -1;
     }
-    if (zmsg_pushstr (msg->zmsg, id) < 0) {
+    n = strlen (id);
+    if (msg_reserve (msg, frame_encode_size (n), 0) < 0)
+        return -1;
+    msg->head -= frame_encode_size (n);
+    frame_encode (msg->buf + msg->head, id, n);
+    msg->routes++;
+    return 0;
+}
+
+/* Get the route frame at 'off'.  Returns its encoded size.
+ */
+static ssize_t msg_route_get (const flux_msg_t *msg,
+                              size_t off,
+                              const uint8_t **data,
+                              size_t *n)
+{
+    ssize_t len;
+
+    if ((len = frame_decode (msg->buf + off, msg->topic - off, data, n)) < 0)
+        errno = EPROTO;
+    return len;
+}
+
+static int route_strdup (const uint8_t *data, size_t n, char **id)
+{
+    char *s = NULL;
+
+    if (n > 0 && !(s = strndup ((const char *)data, n))) {
         errno = ENOMEM;
         return -1;
     }
+    *id = s;
     return 0;
 }
 
 int flux_msg_pop_route (flux_msg_t *msg, char **id)
 {
     uint8_t flags;
-    zframe_t *zf;
+    const uint8_t *data;
+    size_t n;
+    ssize_t len;
+    char *s = NULL;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
-    if (!(flags & FLUX_MSGFLAG_ROUTE) || !(zf = zmsg_first (msg->zmsg))) {
+    if (!(flags & FLUX_MSGFLAG_ROUTE)) {
         errno = EPROTO;
         return -1;
     }
-    if (zframe_size (zf) > 0 && (zf = zmsg_pop (msg->zmsg))) {
-        if (id) {
-            char *s = zframe_strdup (zf);
-            if (!s) {
-                zframe_destroy (&zf);
-                errno = ENOMEM;
-                return -1;
-            }
-            *id = s;
-        }
-        zframe_destroy (&zf);
-    } else {
-        if (id)
-            *id = NULL;
+    if ((len = msg_route_get (msg, msg->head, &data, &n)) < 0)
+        return -1;
+    if (n > 0) {
+        if (id && route_strdup (data, n, &s) < 0)
+            return -1;
+        msg->head += len;
+        msg->routes--;
     }
+    if (id)
+        *id = s;
     return 0;
 }
 
@@ -912,29 +1365,49 @@ int flux_msg_pop_route (flux_msg_t *msg, char **id)
 int flux_msg_get_route_last (const flux_msg_t *msg, char **id)
 {
     uint8_t flags;
-    zframe_t *zf;
-    char *s = NULL;
+    const uint8_t *data;
+    size_t n;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
-    if (!(flags & FLUX_MSGFLAG_ROUTE) || !(zf = zmsg_first (msg->zmsg))) {
+    if (!(flags & FLUX_MSGFLAG_ROUTE)) {
         errno = EPROTO;
         return -1;
     }
-    if (zframe_size (zf) > 0 && !(s = zframe_strdup (zf))) {
-        errno = ENOMEM;
+    if (msg_route_get (msg, msg->head, &data, &n) < 0)
+        return -1;
+    return route_strdup (data, n, id);
+}
+
+/* Get the nth route frame, where n=0 is the most recently pushed.
+ */
+static int msg_route_nth (const flux_msg_t *msg,
+                          int nth,
+                          const uint8_t **data,
+                          size_t *n)
+{
+    size_t off = msg->head;
+    ssize_t len;
+    int count = 0;
+
+    if (nth < 0 || nth >= msg->routes) {
+        errno = ENOENT;
         return -1;
     }
-    *id = s;
-    return 0;
+    while ((len = msg_route_get (msg, off, data, n)) >= 0) {
+        if (count++ == nth)
+            return 0;
+        off += len;
+    }
+    return -1;
 }
 
 /* replaces flux_msg_sender */
 int flux_msg_get_route_first (const flux_msg_t *msg, char **id)
 {
     uint8_t flags;
-    zframe_t *zf, *zf_next;
-    char *s = NULL;
+    const uint8_t *data;
+    size_t n;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
@@ -942,30 +1415,18 @@ int flux_msg_get_route_first (const flux_msg_t *msg, char **id)
         errno = EPROTO;
         return -1;
     }
-    zf = zmsg_first (msg->zmsg);
-    while (zf && zframe_size (zf) > 0) {
-        zf_next = zmsg_next (msg->zmsg);
-        if (zf_next && zframe_size (zf_next) == 0)
-            break;
-        zf = zf_next;
-    }
-    if (!zf) {
-        errno = EPROTO;
-        return -1;
+    if (msg->routes == 0) {
+        *id = NULL;
+        return 0;
     }
-    if (zframe_size (zf) > 0 && !(s = zframe_strdup (zf))) {
-        errno = ENOMEM;
+    if (msg_route_nth (msg, msg->routes - 1, &data, &n) < 0)
         return -1;
-    }
-    *id = s;
-    return 0;
+    return route_strdup (data, n, id);
 }
 
 int flux_msg_get_route_count (const flux_msg_t *msg)
 {
     uint8_t flags;
-    zframe_t *zf;
-    int count = 0;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
@@ -973,12 +1434,7 @@ int flux_msg_get_route_count (const flux_msg_t *msg)
         errno = EPROTO;
         return -1;
     }
-    zf = zmsg_first (msg->zmsg);
-    while (zf && zframe_size (zf) > 0) {
-        zf = zmsg_next (msg->zmsg);
-        count++;
-    }
-    return count;
+    return msg->routes;
 }
 
 /* Get sum of size in bytes of route frames
@@ -986,7 +1442,10 @@ int flux_msg_get_route_count (const flux_msg_t *msg)
 static int flux_msg_get_route_size (const flux_msg_t *msg)
 {
     uint8_t flags;
-    zframe_t *zf;
+    const uint8_t *data;
+    size_t off = msg->head;
+    ssize_t len;
+    size_t n;
     int size = 0;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
@@ -995,42 +1454,21 @@ static int flux_msg_get_route_size (const flux_msg_t *msg)
         errno = EPROTO;
         return -1;
     }
-    zf = zmsg_first (msg->zmsg);
-    while (zf && zframe_size (zf) > 0) {
-        size += zframe_size (zf);
-        zf = zmsg_next (msg->zmsg);
+    while ((len = msg_route_get (msg, off, &data, &n)) > 0 && n > 0) {
+        size += n;
+        off += len;
     }
+    if (len < 0)
+        return -1;
     return size;
 }
 
-static zframe_t *flux_msg_get_route_nth (const flux_msg_t *msg, int n)
-{
-    uint8_t flags;
-    zframe_t *zf;
-    int count = 0;
-
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        return NULL;
-    if (!(flags & FLUX_MSGFLAG_ROUTE)) {
-        errno = EPROTO;
-        return NULL;
-    }
-    zf = zmsg_first (msg->zmsg);
-    while (zf && zframe_size (zf) > 0) {
-        if (count == n)
-            return zf;
-        zf = zmsg_next (msg->zmsg);
-        count++;
-    }
-    errno = ENOENT;
-    return NULL;
-}
-
 char *flux_msg_get_route_string (const flux_msg_t *msg)
 {
     int hops, len;
     int n;
-    zframe_t *zf;
+    const uint8_t *data;
+    size_t size;
     char *buf, *cp;
 
     if (msg == NULL) {
@@ -1046,30 +1484,31 @@ char *flux_msg_get_route_string (const flux_msg_t *msg)
     for (n = hops - 1; n >= 0; n--) {
         if (cp > buf)
             *cp++ = '!';
-        if (!(zf = flux_msg_get_route_nth (msg, n))) {
+        if (msg_route_nth (msg, n, &data, &size) < 0) {
             ERRNO_SAFE_WRAP (free, buf);
             return NULL;
         }
-        int cpylen = zframe_size (zf);
+        int cpylen = size;
         if (cpylen == 36) /* abbreviate long UUID */
             cpylen = 8;
         assert (cp - buf + cpylen < len + hops);
-        memcpy (cp, zframe_data (zf), cpylen);
+        memcpy (cp, data, cpylen);
         cp += cpylen;
     }
     *cp = '\0';
     return buf;
 }
 
-static bool payload_overlap (const void *b, zframe_t *zf)
+static bool payload_overlap (const void *b, const uint8_t *data, size_t n)
 {
-    return ((char *)b >= (char *)zframe_data (zf)
-         && (char *)b <  (char *)zframe_data (zf) + zframe_size (zf));
+    return ((char *)b >= (char *)data
+         && (char *)b <  (char *)data + n);
 }
 
 int flux_msg_set_payload (flux_msg_t *msg, const void *buf, int size)
 {
-    zframe_t *zf;
+    const uint8_t *data;
+    size_t n;
     uint8_t flags;
     int rc = -1;
 
@@ -1085,46 +1524,30 @@ int flux_msg_set_payload (flux_msg_t *msg, const void *buf, int size)
         rc = 0;
         goto done;
     }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);      /* skip route frame */
-        if (zf)
-            zf = zmsg_next (msg->zmsg);      /* skip route delim */
-    }
-    if ((flags & FLUX_MSGFLAG_TOPIC)) {
-        if (zf)
-            zf = zmsg_next (msg->zmsg);      /* skip topic frame */
-    }
-    if (!zf) {                          /* must at least have proto frame */
-        errno = EPROTO;
-        goto done;
-    }
     /* Case #1: replace existing payload.
      */
     if ((flags & FLUX_MSGFLAG_PAYLOAD) && (buf != NULL && size > 0)) {
-        if (zframe_data (zf) != buf || zframe_size (zf) != size) {
-            if (payload_overlap (buf, zf)) {
+        if (msg_payload_get (msg, &data, &n) < 0)
+            goto done;
+        if (data != buf || n != size) {
+            if (payload_overlap (buf, data, n)) {
                 errno = EINVAL;
                 goto done;
             }
-            zframe_reset (zf, buf, size);
+            msg_payload_clear (msg);
+            if (msg_append_frame (msg, buf, size) < 0)
+                goto done;
         }
     /* Case #2: add payload.
      */
     } else if (!(flags & FLUX_MSGFLAG_PAYLOAD) && (buf != NULL && size > 0)) {
-        zmsg_remove (msg->zmsg, zf);
-        if (zmsg_addmem (msg->zmsg, buf, size) < 0
-                                        || zmsg_append (msg->zmsg, &zf) < 0) {
-            errno = ENOMEM;
+        if (msg_append_frame (msg, buf, size) < 0)
             goto done;
-        }
         flags |= FLUX_MSGFLAG_PAYLOAD;
     /* Case #3: remove payload.
      */
     } else if ((flags & FLUX_MSGFLAG_PAYLOAD) && (buf == NULL || size == 0)) {
-        zmsg_remove (msg->zmsg, zf);
-        zframe_destroy (&zf);
+        msg_payload_clear (msg);
         flags &= ~(uint8_t)(FLUX_MSGFLAG_PAYLOAD);
     }
     if (flux_msg_set_flags (msg, flags) < 0)
@@ -1208,8 +1631,9 @@ int flux_msg_pack (flux_msg_t *msg, const char *fmt, ...)
 
 int flux_msg_get_payload (const flux_msg_t *msg, const void **buf, int *size)
 {
-    zframe_t *zf;
     uint8_t flags;
+    const uint8_t *data;
+    size_t n;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         return -1;
@@ -1217,25 +1641,12 @@ int flux_msg_get_payload (const flux_msg_t *msg, const void **buf, int *size)
         errno = EPROTO;
         return -1;
     }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if ((flags & FLUX_MSGFLAG_TOPIC)) {
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if (!zf) {
-        errno = EPROTO;
+    if (msg_payload_get (msg, &data, &n) < 0)
         return -1;
-    }
     if (buf)
-        *buf = zframe_data (zf);
+        *buf = data;
     if (size)
-        *size = zframe_size (zf);
+        *size = n;
     return 0;
 }
 
@@ -1353,139 +1764,114 @@ const char *flux_msg_last_error (const flux_msg_t *msg)
 
 int flux_msg_set_topic (flux_msg_t *msg, const char *topic)
 {
-    zframe_t *zf, *zf2 = NULL;
     uint8_t flags;
+    char *cpy = NULL;
+    size_t oldlen, newlen = 0;
+    ssize_t delta;
     int rc = -1;
 
     if (flux_msg_get_flags (msg, &flags) < 0)
         goto done;
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {   /* skip over routing frames, if any */
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if (!zf) {                          /* must at least have proto frame */
-        errno = EPROTO;
+    if (!(flags & FLUX_MSGFLAG_TOPIC) && !topic) {
+        rc = 0;
         goto done;
     }
-    if ((flags & FLUX_MSGFLAG_TOPIC) && topic) {        /* case 1: repl topic */
-        zframe_reset (zf, topic, strlen (topic) + 1);
-    } else if (!(flags & FLUX_MSGFLAG_TOPIC) && topic) {/* case 2: add topic */
-        zmsg_remove (msg->zmsg, zf);
-        if ((flags & FLUX_MSGFLAG_PAYLOAD) && (zf2 = zmsg_next (msg->zmsg)))
-            zmsg_remove (msg->zmsg, zf2);
-        if (zmsg_addmem (msg->zmsg, topic, strlen (topic) + 1) < 0
-                                    || zmsg_append (msg->zmsg, &zf) < 0
-                                    || (zf2 && zmsg_append (msg->zmsg, &zf2) < 0)) {
+    /* The new topic might point into the message buffer, which is about
+     * to be rearranged.
+     */
+    if (topic && (const uint8_t *)topic >= msg->buf
+              && (const uint8_t *)topic < msg->buf + msg->bufsize) {
+        if (!(cpy = strdup (topic))) {
             errno = ENOMEM;
             goto done;
         }
-        flags |= FLUX_MSGFLAG_TOPIC;
-        if (flux_msg_set_flags (msg, flags) < 0)
-            goto done;
-    } else if ((flags & FLUX_MSGFLAG_TOPIC) && !topic) { /* case 3: del topic */
-        zmsg_remove (msg->zmsg, zf);
-        zframe_destroy (&zf);
-        flags &= ~(uint8_t)FLUX_MSGFLAG_TOPIC;
-        if (flux_msg_set_flags (msg, flags) < 0)
-            goto done;
+        topic = cpy;
     }
-    rc = 0;
-done:
-    return rc;
-}
-
-static int zf_topic (const flux_msg_t *msg, zframe_t **zfp)
-{
-    uint8_t flags;
-    zframe_t *zf = NULL;
-    int rc = -1;
-
-    if (flux_msg_get_flags (msg, &flags) < 0)
-        goto done;
-    if (!(flags & FLUX_MSGFLAG_TOPIC)) {
-        errno = EPROTO;
+    oldlen = msg->payload - msg->topic;
+    if (topic)
+        newlen = frame_encode_size (strlen (topic) + 1);
+    delta = newlen - oldlen;
+    if (delta > 0 && msg_reserve (msg, 0, delta) < 0)
         goto done;
+    memmove (msg->buf + msg->payload + delta,
+             msg->buf + msg->payload,
+             msg->tail - msg->payload);
+    msg->payload += delta;
+    msg->tail += delta;
+    if (topic) {
+        frame_encode (msg->buf + msg->topic, topic, strlen (topic) + 1);
+        flags |= FLUX_MSGFLAG_TOPIC;
     }
-    zf = zmsg_first (msg->zmsg);
-    if ((flags & FLUX_MSGFLAG_ROUTE)) {
-        while (zf && zframe_size (zf) > 0)
-            zf = zmsg_next (msg->zmsg);
-        if (zf)
-            zf = zmsg_next (msg->zmsg);
-    }
-    if (!zf) {
-        errno = EPROTO;
+    else
+        flags &= ~(uint8_t)FLUX_MSGFLAG_TOPIC;
+    if (flux_msg_set_flags (msg, flags) < 0)
         goto done;
-    }
-    *zfp = zf;
     rc = 0;
 done:
+    ERRNO_SAFE_WRAP (free, cpy);
     return rc;
 }
 
 int flux_msg_get_topic (const flux_msg_t *msg, const char **topic)
 {
-    zframe_t *zf;
-    const char *s;
-    int rc = -1;
+    uint8_t flags;
+    const uint8_t *data;
+    size_t n;
 
-    if (zf_topic (msg, &zf) < 0)
-        goto done;
-    s = (const char *)zframe_data (zf);
-    if (s[zframe_size (zf) - 1] != '\0') {
+    if (flux_msg_get_flags (msg, &flags) < 0)
+        return -1;
+    if (!(flags & FLUX_MSGFLAG_TOPIC)
+        || frame_decode (msg->buf + msg->topic,
+                         msg->payload - msg->topic,
+                         &data,
+                         &n) < 0
+        || n == 0
+        || data[n - 1] != '\0') {
         errno = EPROTO;
-        goto done;
+        return -1;
     }
-    *topic = s;
-    rc = 0;
-done:
-    return rc;
+    *topic = (const char *)data;
+    return 0;
 }
 
 flux_msg_t *flux_msg_copy (const flux_msg_t *msg, bool payload)
 {
     flux_msg_t *cpy = NULL;
-    zframe_t *zf;
-    int count;
     uint8_t flags;
-    bool skip_payload = false;
+    size_t used;
 
-    /* Set skip_payload = true if caller set 'payload' flag false
+    /* Clear the payload flag if caller set 'payload' flag false
      * AND message contains a payload frame.
      */
     if (flux_msg_get_flags (msg, &flags) < 0)
         return NULL;
-    if (!payload && (flags & FLUX_MSGFLAG_PAYLOAD)) {
+    if (!payload)
         flags &= ~(FLUX_MSGFLAG_PAYLOAD);
-        skip_payload = true;
-    }
     if (!(cpy = flux_msg_create_common ()))
         return NULL;
-    if (!(cpy->zmsg = zmsg_new ()))
-        goto nomem;
+    memcpy (cpy->proto, msg->proto, PROTO_SIZE);
 
-    /* Copy frames from 'msg' to 'cpy'.
-     * 'count' indexes frames from 0 to zmsg_size (msg) - 1.
-     * The payload frame (if it exists) will be in the second to last position.
+    /* Copy frames from 'msg' to 'cpy' with one memcpy().
+     * A shared payload is shared with 'cpy' too.
      */
-    count = 0;
-    zf = zmsg_first (msg->zmsg);
-    while (zf) {
-        if (!skip_payload || count != zmsg_size (msg->zmsg) - 2) {
-            if (zmsg_addmem (cpy->zmsg, zframe_data (zf), zframe_size (zf)) < 0)
-                goto nomem;
-        }
-        zf = zmsg_next (msg->zmsg);
-        count++;
+    used = (payload ? msg->tail : msg->payload) - msg->head;
+    if (msg_reserve (cpy, 0, used) < 0)
+        goto error;
+    memcpy (cpy->buf + cpy->tail, msg->buf + msg->head, used);
+    cpy->routes = msg->routes;
+    cpy->topic = cpy->tail + (msg->topic - msg->head);
+    cpy->payload = cpy->tail + (msg->payload - msg->head);
+    cpy->tail += used;
+    if (payload && msg->payload_shared) {
+        zmq_msg_t *zpayload = (zmq_msg_t *)&msg->zpayload;
+        if (zmq_msg_init (&cpy->zpayload) < 0
+            || zmq_msg_copy (&cpy->zpayload, zpayload) < 0)
+            goto error;
+        cpy->payload_shared = true;
     }
     if (flux_msg_set_flags (cpy, flags) < 0)
         goto error;
     return cpy;
-nomem:
-    errno = ENOMEM;
 error:
     flux_msg_destroy (cpy);
     return NULL;
@@ -1529,7 +1915,7 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
 {
     int hops;
     int type = 0;
-    zframe_t *proto;
+    int i;
     const char *prefix, *topic = NULL;
 
     fprintf (f, "--------------------------------------\n");
@@ -1537,8 +1923,7 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
         fprintf (f, "NULL");
         return;
     }
-    if (flux_msg_get_type (msg, &type) < 0
-            || (!(proto = zmsg_last (msg->zmsg)))) {
+    if (flux_msg_get_type (msg, &type) < 0) {
         fprintf (f, "malformed message");
         return;
     }
@@ -1573,36 +1958,64 @@ void flux_msg_fprint (FILE *f, const flux_msg_t *msg)
     }
     /* Proto block
      */
-    zframe_fprint (proto, prefix, f);
+    fprintf (f, "%s[%03d] ", prefix, PROTO_SIZE);
+    for (i = 0; i < PROTO_SIZE; i++)
+        fprintf (f, "%02X", msg->proto[i]);
+    fprintf (f, "\n");
 }
 
-int flux_msg_sendzsock_ex (void *sock, const flux_msg_t *msg, bool nonblock)
-{
-    int rc = -1;
-
-    if (!sock || !msg || !zmsg_is (msg->zmsg)) {
-        errno = EINVAL;
-        goto done;
+/* Send the frames of 'msg' that precede the payload, the payload, and if
+ * 'proto' is non-NULL, that PROTO frame in place of the message's.
+ * A shared payload is sent without copying its data.
+ */
+static int sendzsock_frames (void *handle,
+                             const flux_msg_t *msg,
+                             const uint8_t *proto,
+                             int flags)
+{
+    size_t off = msg->head;
+    const uint8_t *data;
+    ssize_t len;
+    size_t n;
+
+    while (off < msg->tail) {
+        if ((len = frame_decode (msg->buf + off,
+                                 msg->tail - off,
+                                 &data,
+                                 &n)) < 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (zmq_send (handle, data, n, flags | ZMQ_SNDMORE) < 0)
+            return -1;
+        off += len;
     }
+    if (msg->payload_shared) {
+        zmq_msg_t part;
 
-    void *handle = zsock_resolve (sock);
-    int flags = ZFRAME_REUSE | ZFRAME_MORE;
-    zframe_t *zf = zmsg_first (msg->zmsg);
-    size_t count = 0;
-
-    if (nonblock)
-        flags |= ZFRAME_DONTWAIT;
+        if (zmq_msg_init (&part) < 0)
+            return -1;
+        if (zmq_msg_copy (&part, (zmq_msg_t *)&msg->zpayload) < 0
+            || zmq_msg_send (&part, handle, flags | ZMQ_SNDMORE) < 0) {
+            ERRNO_SAFE_WRAP (zmq_msg_close, &part);
+            return -1;
+        }
+    }
+    if (zmq_send (handle, proto ? proto : msg->proto, PROTO_SIZE, flags) < 0)
+        return -1;
+    return 0;
+}
 
-    while (zf) {
-        if (++count == zmsg_size (msg->zmsg))
-            flags &= ~ZFRAME_MORE;
-        if (zframe_send (&zf, handle, flags) < 0)
-            goto done;
-        zf = zmsg_next (msg->zmsg);
+int flux_msg_sendzsock_ex (void *sock, const flux_msg_t *msg, bool nonblock)
+{
+    if (!sock || !msg) {
+        errno = EINVAL;
+        return -1;
     }
-    rc = 0;
-done:
-    return rc;
+    return sendzsock_frames (zsock_resolve (sock),
+                             msg,
+                             NULL,
+                             nonblock ? ZMQ_DONTWAIT : 0);
 }
 
 int flux_msg_sendzsock (void *sock, const flux_msg_t *msg)
@@ -1610,25 +2023,132 @@ int flux_msg_sendzsock (void *sock, const flux_msg_t *msg)
     return flux_msg_sendzsock_ex (sock, msg, false);
 }
 
+/* Send 'msg' to ROUTER socket 'sock' as though 'id' were pushed onto its
+ * route stack.  Unlike flux_msg_copy() + flux_msg_push_route(), 'msg' is
+ * not duplicated.  A large payload is moved to a zeromq message on first
+ * use, which lets zeromq share its reference counted content among all
+ * the peers that 'msg' is sent to.  Only the 'id' frame, and if routing
+ * is not yet enabled, a route delimiter and a PROTO frame with
+ * FLUX_MSGFLAG_ROUTE set, are added per call.
+ */
+int flux_msg_sendzsock_route (void *sock,
+                              const flux_msg_t *msg,
+                              const char *id,
+                              bool nonblock)
+{
+    void *handle;
+    uint8_t flags;
+    uint8_t proto[PROTO_SIZE];
+    int zflags = 0;
+
+    if (!sock || !msg || !id) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flux_msg_get_flags (msg, &flags) < 0)
+        return -1;
+    if (msg_payload_share (msg) < 0)
+        return -1;
+    if (nonblock)
+        zflags |= ZMQ_DONTWAIT;
+    handle = zsock_resolve (sock);
+
+    if (zmq_send (handle, id, strlen (id), zflags | ZMQ_SNDMORE) < 0)
+        return -1;
+    if (!(flags & FLUX_MSGFLAG_ROUTE)) {
+        if (zmq_send (handle, NULL, 0, zflags | ZMQ_SNDMORE) < 0)
+            return -1;
+        memcpy (proto, msg->proto, PROTO_SIZE);
+        if (proto_set_flags (proto, PROTO_SIZE, flags | FLUX_MSGFLAG_ROUTE) < 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        return sendzsock_frames (handle, msg, proto, zflags);
+    }
+    return sendzsock_frames (handle, msg, NULL, zflags);
+}
+
+/* Receive a message from 'sock' into a new message.  A large payload is
+ * kept in the zeromq message it was received in rather than copied.
+ */
 flux_msg_t *flux_msg_recvzsock (void *sock)
 {
-    zmsg_t *zmsg;
+    void *handle = zsock_resolve (sock);
     flux_msg_t *msg;
+    zmq_msg_t part;
+    zmq_msg_t prev;
+    bool have_prev = false;
+    uint8_t flags;
 
-    if (!(zmsg = zmsg_recv (sock)))
-        return NULL;
     if (!(msg = flux_msg_create_common ())) {
-        zmsg_destroy (&zmsg);
         errno = ENOMEM;
         return NULL;
     }
-    msg->zmsg = zmsg;
+    if (zmq_msg_init (&part) < 0 || zmq_msg_init (&prev) < 0)
+        goto error;
+    for (;;) {
+        if (zmq_msg_recv (&part, handle, 0) < 0)
+            goto error;
+        if (!zmq_msg_more (&part))
+            break;
+        /* The last frame before PROTO may be the payload, so hold on to
+         * it until the PROTO frame arrives.
+         */
+        if (have_prev) {
+            if (msg_append_frame (msg,
+                                  zmq_msg_data (&prev),
+                                  zmq_msg_size (&prev)) < 0)
+                goto error;
+        }
+        if (zmq_msg_move (&prev, &part) < 0)
+            goto error;
+        have_prev = true;
+    }
+    if (zmq_msg_size (&part) != PROTO_SIZE) {
+        errno = EPROTO;
+        goto error;
+    }
+    memcpy (msg->proto, zmq_msg_data (&part), PROTO_SIZE);
+    if (have_prev) {
+        if (proto_get_flags (msg->proto, PROTO_SIZE, &flags) == 0
+            && (flags & FLUX_MSGFLAG_PAYLOAD)
+            && zmq_msg_size (&prev) >= MSG_PAYLOAD_SHARE_MIN) {
+            if (zmq_msg_init (&msg->zpayload) < 0
+                || zmq_msg_move (&msg->zpayload, &prev) < 0)
+                goto error;
+            msg->payload_shared = true;
+        }
+        else if (msg_append_frame (msg,
+                                   zmq_msg_data (&prev),
+                                   zmq_msg_size (&prev)) < 0)
+            goto error;
+    }
+    if (msg_parse (msg) < 0)
+        goto error;
+    zmq_msg_close (&prev);
+    zmq_msg_close (&part);
     return msg;
+error:
+    ERRNO_SAFE_WRAP (zmq_msg_close, &prev);
+    ERRNO_SAFE_WRAP (zmq_msg_close, &part);
+    flux_msg_destroy (msg);
+    return NULL;
 }
 
 int flux_msg_frames (const flux_msg_t *msg)
 {
-    return zmsg_size (msg->zmsg);
+    uint8_t flags;
+    int count = 1;
+
+    if (flux_msg_get_flags (msg, &flags) < 0)
+        return -1;
+    if ((flags & FLUX_MSGFLAG_ROUTE))
+        count += msg->routes + 1;
+    if ((flags & FLUX_MSGFLAG_TOPIC))
+        count++;
+    if ((flags & FLUX_MSGFLAG_PAYLOAD))
+        count++;
+    return count;
 }
 
 struct flux_match flux_match_init (int typemask,
@@ -41,6 +41,7 @@ enum {
     FLUX_MSGFLAG_UPSTREAM   = 0x10, /* request nodeid is sender (route away) */
     FLUX_MSGFLAG_PRIVATE    = 0x20, /* private to instance owner and sender */
     FLUX_MSGFLAG_STREAMING  = 0x40, /* request/response is streaming RPC */
+    FLUX_MSGFLAG_USER1      = 0x80, /* user-defined message flag */
 };
 
 /* N.B. FLUX_NODEID_UPSTREAM should be used in the RPC interface only.
@@ -94,6 +95,24 @@ int flux_match_asprintf (struct flux_match *m, const char *topic_glob_fmt, ...);
 flux_msg_t *flux_msg_create (int type);
 void flux_msg_destroy (flux_msg_t *msg);
 
+/* Destroyed messages and their buffers are kept in a per-thread pool
+ * and reused by messages later created on the same thread.  Set
+ * FLUX_MSG_POOL=0 in the environment to disable pooling, e.g. when
+ * looking for message use-after-free bugs.
+ * flux_msg_pool_get_stats() returns counters for the calling thread.
+ */
+struct flux_msg_pool_stats {
+    uint64_t msg_hits;      // messages reused from the pool
+    uint64_t msg_misses;    // messages allocated with malloc
+    uint64_t buf_hits;      // message buffers reused from the pool
+    uint64_t buf_misses;    // message buffers allocated with malloc
+    int msg_cached;         // messages currently held by the pool
+    int buf_cached;         // message buffers currently held by the pool
+};
+
+int flux_msg_pool_get_stats (struct flux_msg_pool_stats *stats);
+void flux_msg_pool_clear_stats (void);
+
 /* Access auxiliary data members in Flux message.
  * These are for convenience only - they are not sent over the wire.
  */
@@ -132,6 +151,18 @@ flux_msg_t *flux_msg_decode (const void *buf, size_t size);
 int flux_msg_sendzsock (void *dest, const flux_msg_t *msg);
 int flux_msg_sendzsock_ex (void *dest, const flux_msg_t *msg, bool nonblock);
 
+/* Send message to zeromq ROUTER socket, addressed to peer 'id'.
+ * The effect is as if 'id' were pushed onto a copy of the message's route
+ * stack (enabling routing if necessary), but 'msg' is neither copied nor
+ * modified, and the payload frame is shared by zeromq rather than
+ * duplicated, making this suitable for multicast to many peers.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int flux_msg_sendzsock_route (void *dest,
+                              const flux_msg_t *msg,
+                              const char *id,
+                              bool nonblock);
+
 /* Receive a message from zeromq socket.
  * Returns message on success, NULL on failure with errno set.
  */
@@ -164,6 +195,13 @@ bool flux_msg_is_streaming (const flux_msg_t *msg);
 int flux_msg_set_noresponse (flux_msg_t *msg);
 bool flux_msg_is_noresponse (const flux_msg_t *msg);
 
+/* Get/set user-defined flag.
+ * The meaning of this flag is defined by the service that receives it.
+ * Unlike other flags, it is not copied from a request to its response.
+ */
+int flux_msg_set_user1 (flux_msg_t *msg);
+bool flux_msg_is_user1 (const flux_msg_t *msg);
+
 /* Get/set/compare message topic string.
  * set adds/deletes/replaces topic frame as needed.
  */
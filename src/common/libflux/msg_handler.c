@@ -19,23 +19,34 @@
 
 #include "message.h"
 #include "reactor.h"
+#include "reactor_private.h"
 #include "msg_handler.h"
+#include "msg_handler_private.h"
 #include "response.h"
 #include "flog.h"
+#include "tagmap.h"
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/iterators.h"
+#include "src/common/libutil/topic_trie.h"
 
 struct dispatch {
     flux_t *h;
+    flux_reactor_t *r;
     zlist_t *handlers;
     zlist_t *handlers_new;
-    zhashx_t *handlers_rpc; // matchtag => response handler
+    struct tagmap *handlers_rpc; // matchtag => response handler
     zhashx_t *handlers_method; // topic => request handler (non-glob only)
+    struct topic_trie *handlers_event; // topic prefix => event handler
+    unsigned long handler_seq;
+    int event_depth;
+    flux_msg_handler_t *zombies; // destroyed during event dispatch
     flux_watcher_t *w;
     int running_count;
     int usecount;
     zlist_t *unmatched;
+    int budget;
+    struct flux_dispatch_stats stats;
 #if HAVE_CALIPER
     cali_id_t prof_msg_type;
     cali_id_t prof_msg_topic;
@@ -52,15 +63,25 @@ struct flux_msg_handler {
     flux_msg_handler_f fn;
     void *arg;
     uint8_t running:1;
+    unsigned long seq;          // creation order
+    char *event_prefix;         // handlers_event key
+    uint32_t tag_count;         // matchtag range size (range handler only)
+    flux_msg_handler_t *zombie_next;
+};
+
+#define EVENT_CANDIDATES_INLINE 16
+struct event_candidates {
+    flux_msg_handler_t **mh;
+    int count;
+    int size;
+    int errnum;
+    flux_msg_handler_t *inline_mh[EVENT_CANDIDATES_INLINE];
 };
 
 static void handle_cb (flux_reactor_t *r, flux_watcher_t *w,
                        int revents, void *arg);
 static void free_msg_handler (flux_msg_handler_t *mh);
 
-static size_t matchtag_hasher (const void *key);
-static int matchtag_cmp (const void *key1, const void *key2);
-
 /* Return true if topic string 's' could match multiple request topics,
  * e.g. contains a glob character, or is NULL or "" which match anything.
  */
@@ -73,6 +94,16 @@ static bool isa_multmatch (const char *s)
     return false;
 }
 
+/* Return the literal prefix of topic glob 's', the part before any glob
+ * or escape character.  Any topic matched by 's' begins with this prefix.
+ */
+static char *event_prefix (const char *s)
+{
+    if (!s)
+        return strdup ("");
+    return strndup (s, strcspn (s, "*?[\\"));
+}
+
 static void dispatch_requeue (struct dispatch *d)
 {
     if (d->unmatched) {
@@ -102,8 +133,9 @@ static void dispatch_usecount_decr (struct dispatch *d)
             zlist_destroy (&d->handlers_new);
         }
         flux_watcher_destroy (d->w);
-        zhashx_destroy (&d->handlers_rpc);
+        tagmap_destroy (d->handlers_rpc);
         zhashx_destroy (&d->handlers_method);
+        topic_trie_destroy (d->handlers_event);
         free (d);
         errno = saved_errno;
     }
@@ -126,24 +158,28 @@ static struct dispatch *dispatch_get (flux_t *h)
     struct dispatch *d = flux_aux_get (h, "flux::dispatch");
     if (!d) {
         flux_reactor_t *r = flux_get_reactor (h);
+        const char *s;
         if (!(d = malloc (sizeof (*d))))
             return NULL;
         memset (d, 0, sizeof (*d));
         d->usecount = 1;
+        d->budget = FLUX_DISPATCH_BUDGET_DEFAULT;
+        if ((s = getenv ("FLUX_DISPATCH_BUDGET"))) {
+            int budget = strtol (s, NULL, 10);
+            if (budget > 0)
+                d->budget = budget;
+        }
         if (!(d->handlers = zlist_new ()))
             goto nomem;
         if (!(d->handlers_new = zlist_new ()))
             goto nomem;
         d->h = h;
+        d->r = r;
         d->w = flux_handle_watcher_create (r, h, FLUX_POLLIN, handle_cb, d);
         if (!d->w)
             goto error;
-        if (!(d->handlers_rpc = zhashx_new ()))
-            goto nomem;
-        zhashx_set_key_hasher (d->handlers_rpc, matchtag_hasher);
-        zhashx_set_key_comparator (d->handlers_rpc, matchtag_cmp);
-        zhashx_set_key_destructor (d->handlers_rpc, NULL);
-        zhashx_set_key_duplicator (d->handlers_rpc, NULL);
+        if (!(d->handlers_rpc = tagmap_create ()))
+            goto error;
         /* N.B. d->handlers_method key points to mh->match.topic_glob in entry,
          * so disable the key duplicator and destructor to avoid extra malloc.
          */
@@ -151,6 +187,8 @@ static struct dispatch *dispatch_get (flux_t *h)
             goto nomem;
         zhashx_set_key_destructor (d->handlers_method, NULL);
         zhashx_set_key_duplicator (d->handlers_method, NULL);
+        if (!(d->handlers_event = topic_trie_create ()))
+            goto nomem;
 #if HAVE_CALIPER
         d->prof_msg_type = cali_create_attribute ("flux.message.type",
                                                   CALI_TYPE_STRING,
@@ -173,27 +211,12 @@ error:
     return NULL;
 }
 
-/* zhahsx_comparator_fn to compare matchtags
- */
-static int matchtag_cmp (const void *key1, const void *key2)
+void flux_dispatch_matchtag_reserve (flux_t *h, uint32_t size)
 {
-    uint32_t m1 = *(uint32_t *)key1;
-    uint32_t m2 = *(uint32_t *)key2;
-
-    if (m1 < m2)
-        return -1;
-    if (m1 > m2)
-        return 1;
-    return 0;
-}
-
-/* zhashx_hash_fn to map response matchtags to handlers
- */
-static size_t matchtag_hasher (const void *key)
-{
-    uint32_t matchtag = *(uint32_t *)key;
+    struct dispatch *d = flux_aux_get (h, "flux::dispatch");
 
-    return matchtag;
+    if (d)
+        (void)tagmap_reserve (d->handlers_rpc, size);
 }
 
 static int copy_match (struct flux_match *dst,
@@ -212,6 +235,8 @@ static int copy_match (struct flux_match *dst,
 static void call_handler (flux_msg_handler_t *mh, const flux_msg_t *msg)
 {
     uint32_t rolemask, matchtag;
+    flux_reactor_t *r = mh->d->r;
+    const char *topic;
 
     if (flux_msg_get_rolemask (msg, &rolemask) < 0)
         return;
@@ -228,32 +253,156 @@ static void call_handler (flux_msg_handler_t *mh, const flux_msg_t *msg)
         }
         return;
     }
-    mh->fn (mh->d->h, mh, msg, mh->arg);
+    /* N.B. the handler may destroy 'mh'.
+     */
+    if (flux_reactor_stats_enabled (r)
+        && flux_msg_get_topic (msg, &topic) == 0) {
+        uint64_t t0 = flux_reactor_stats_start ();
+        mh->fn (mh->d->h, mh, msg, mh->arg);
+        flux_reactor_stats_record_topic (r, topic, t0);
+    }
+    else
+        mh->fn (mh->d->h, mh, msg, mh->arg);
+}
+
+static void event_candidates_append (struct event_candidates *ec,
+                                     flux_msg_handler_t *mh)
+{
+    if (ec->count == ec->size) {
+        int size = ec->size * 2;
+        flux_msg_handler_t **new;
+
+        if (ec->mh == ec->inline_mh) {
+            if ((new = malloc (size * sizeof (new[0]))))
+                memcpy (new, ec->mh, ec->count * sizeof (new[0]));
+        }
+        else
+            new = realloc (ec->mh, size * sizeof (new[0]));
+        if (!new) {
+            ec->errnum = ENOMEM;
+            return;
+        }
+        ec->mh = new;
+        ec->size = size;
+    }
+    ec->mh[ec->count++] = mh;
+}
+
+// topic_trie_f footprint
+static void event_candidates_append_cb (void *item, void *arg)
+{
+    event_candidates_append (arg, item);
+}
+
+/* Sort most recently registered handlers first.
+ */
+static int event_candidates_cmp (const void *a, const void *b)
+{
+    const flux_msg_handler_t *mh1 = *(const flux_msg_handler_t **)a;
+    const flux_msg_handler_t *mh2 = *(const flux_msg_handler_t **)b;
+
+    if (mh1->seq < mh2->seq)
+        return 1;
+    if (mh1->seq > mh2->seq)
+        return -1;
+    return 0;
+}
+
+static void free_zombies (struct dispatch *d)
+{
+    while (d->zombies) {
+        flux_msg_handler_t *mh = d->zombies;
+        d->zombies = mh->zombie_next;
+        free_msg_handler (mh);
+    }
+}
+
+/* Events are sent to all matching handlers.  Handlers registered for
+ * events only are found in handlers_event by topic prefix, while
+ * multi-type handlers are on the handlers list.  The candidates are
+ * collected before any handler is called, so handlers may be created
+ * or destroyed by the callbacks.  Destroyed handlers are stopped, and
+ * freed after the last candidate has been visited.
+ * Return -1 on allocation failure, otherwise the number of matches.
+ */
+static int dispatch_event (struct dispatch *d, const flux_msg_t *msg)
+{
+    struct event_candidates ec = { .size = EVENT_CANDIDATES_INLINE };
+    flux_msg_handler_t *mh;
+    const char *topic;
+    int count = 0;
+    int i;
+
+    ec.mh = ec.inline_mh;
+    if (flux_msg_get_topic (msg, &topic) < 0)
+        topic = "";
+    topic_trie_match (d->handlers_event,
+                      topic,
+                      event_candidates_append_cb,
+                      &ec);
+    FOREACH_ZLIST (d->handlers, mh) {
+        if (mh->match.typemask == 0
+            || (mh->match.typemask & FLUX_MSGTYPE_EVENT))
+            event_candidates_append (&ec, mh);
+    }
+    if (ec.errnum != 0)
+        goto error;
+    if (ec.count > 1)
+        qsort (ec.mh, ec.count, sizeof (ec.mh[0]), event_candidates_cmp);
+
+    d->event_depth++;
+    for (i = 0; i < ec.count; i++) {
+        mh = ec.mh[i];
+        if (mh->running && flux_msg_cmp (msg, mh->match)) {
+            call_handler (mh, msg);
+            count++;
+        }
+    }
+    if (--d->event_depth == 0)
+        free_zombies (d);
+
+    if (ec.mh != ec.inline_mh)
+        free (ec.mh);
+    return count;
+error:
+    if (ec.mh != ec.inline_mh)
+        free (ec.mh);
+    errno = ec.errnum;
+    return -1;
 }
 
 /* Messages are matched in the following order:
- * 1) RPC responses - lookup in handlers_rpc hash by matchtag.
+ * 1) RPC responses - lookup in handlers_rpc table by matchtag.
  * 2) RPC requests - lookup in handlers_method hash by topic string
  * 3) Requests and responses not matched above - sent to first match in
  *    list of handlers, where most recently registered handlers match first.
- * 4) Events - sent to all matches in list of handlers
+ * 4) Events - sent to all matches in handlers_event trie and list of
+ *    handlers (see dispatch_event() above).
+ * Return -1 on error, 0 if no handler matched, or 1 otherwise.
  */
-static bool dispatch_message (struct dispatch *d,
-                              const flux_msg_t *msg,
-                              int type)
+static int dispatch_message (struct dispatch *d,
+                             const flux_msg_t *msg,
+                             int type)
 {
     flux_msg_handler_t *mh;
     bool match = false;
 
+    if (type == FLUX_MSGTYPE_EVENT) {
+        int count;
+        if ((count = dispatch_event (d, msg)) < 0)
+            return -1;
+        return count > 0 ? 1 : 0;
+    }
+
     /* rpc response w/matchtag */
     if (type == FLUX_MSGTYPE_RESPONSE) {
         uint32_t matchtag;
         if (flux_msg_get_route_count (msg) == 0
                 && flux_msg_get_matchtag (msg, &matchtag) == 0
                 && matchtag != FLUX_MATCHTAG_NONE
-                && (mh = zhashx_lookup (d->handlers_rpc, &matchtag))
+                && (mh = tagmap_lookup (d->handlers_rpc, matchtag))
                 && mh->running
-                && flux_msg_cmp (msg, mh->match)) {
+                && (mh->tag_count > 0 || flux_msg_cmp (msg, mh->match))) {
             call_handler (mh, msg);
             match = true;
         }
@@ -275,14 +424,12 @@ static bool dispatch_message (struct dispatch *d,
                 continue;
             if (flux_msg_cmp (msg, mh->match)) {
                 call_handler (mh, msg);
-                if (type != FLUX_MSGTYPE_EVENT) {
-                    match = true;
-                    break;
-                }
+                match = true;
+                break;
             }
         }
     }
-    return match;
+    return match ? 1 : 0;
 }
 
 /* A matchtag may have been leaked if an RPC future is destroyed with
@@ -325,24 +472,15 @@ done:
     return rc;
 }
 
-static void handle_cb (flux_reactor_t *r,
-                       flux_watcher_t *hw,
-                       int revents,
-                       void *arg)
+/* Dispatch one message received by handle_cb().
+ * Return -1 on a fatal error (errno set), 0 otherwise.
+ */
+static int handle_message (struct dispatch *d, flux_msg_t *msg)
 {
-    struct dispatch *d = arg;
-    flux_msg_t *msg = NULL;
-    int rc = -1;
     int type;
-    bool match;
+    int match;
+    int rc = -1;
 
-    if (revents & FLUX_POLLERR)
-        goto done;
-    if (!(msg = flux_recv (d->h, FLUX_MATCH_ANY, FLUX_O_NONBLOCK))) {
-        if (errno == EAGAIN && errno == EWOULDBLOCK)
-            rc = 0; /* ignore spurious wakeup */
-        goto done;
-    }
     if (flux_msg_get_type (msg, &type) < 0) {
         rc = 0; /* ignore mangled message */
         goto done;
@@ -373,6 +511,8 @@ static void handle_cb (flux_reactor_t *r,
     cali_end (d->prof_msg_topic);
     cali_end (d->prof_msg_type);
 #endif
+    if (match < 0)
+        goto done;
 
     /* Message was not "consumed".
      * If in a cloned handle, queue message for later.
@@ -420,11 +560,71 @@ static void handle_cb (flux_reactor_t *r,
     }
     rc = 0;
 done:
-    if (rc < 0) {
+    flux_msg_destroy (msg);
+    return rc;
+}
+
+static void dispatch_stats_update (struct dispatch *d, int count)
+{
+    int i = 0;
+
+    d->stats.wakeups++;
+    d->stats.messages += count;
+    if (d->stats.max_batch < count)
+        d->stats.max_batch = count;
+    if (count == d->budget)
+        d->stats.exhausted++;
+    while (count > 1 && i < FLUX_DISPATCH_HIST_SIZE - 1) {
+        count >>= 1;
+        i++;
+    }
+    d->stats.batch_hist[i]++;
+}
+
+/* Handle up to d->budget ready messages, then return to the reactor so
+ * other watchers get a turn.  Stop early if no messages are ready, if
+ * all handlers were stopped, if the reactor was asked to stop, or if the
+ * handle was destroyed by a handler (only our reference remains).
+ */
+static void handle_cb (flux_reactor_t *r,
+                       flux_watcher_t *hw,
+                       int revents,
+                       void *arg)
+{
+    struct dispatch *d = arg;
+    flux_msg_t *msg;
+    int count = 0;
+    int rc = -1;
+
+    if (revents & FLUX_POLLERR)
+        goto fatal;
+    dispatch_usecount_incr (d);
+    while (count < d->budget) {
+        if (!(msg = flux_recv (d->h, FLUX_MATCH_ANY, FLUX_O_NONBLOCK))) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                rc = 0; /* no more messages, or spurious wakeup */
+            goto done;
+        }
+        count++;
+        if (handle_message (d, msg) < 0)
+            goto done;
+        if (d->usecount == 1
+            || d->running_count == 0
+            || flux_reactor_is_stopping (r))
+            break;
+    }
+    rc = 0;
+done:
+    dispatch_stats_update (d, count);
+    if (rc < 0 && d->usecount > 1) {
         flux_reactor_stop_error (r);
         FLUX_FATAL (d->h);
     }
-    flux_msg_destroy (msg);
+    dispatch_usecount_decr (d);
+    return;
+fatal:
+    flux_reactor_stop_error (r);
+    FLUX_FATAL (d->h);
 }
 
 void flux_msg_handler_start (flux_msg_handler_t *mh)
@@ -474,6 +674,7 @@ static void free_msg_handler (flux_msg_handler_t *mh)
         int saved_errno = errno;
         assert (mh->magic == HANDLER_MAGIC);
         flux_match_free (mh->match);
+        free (mh->event_prefix);
         mh->magic = ~HANDLER_MAGIC;
         free (mh);
         errno = saved_errno;
@@ -485,21 +686,40 @@ void flux_msg_handler_destroy (flux_msg_handler_t *mh)
     if (mh) {
         int saved_errno = errno;
         assert (mh->magic == HANDLER_MAGIC);
-        if (mh->match.typemask == FLUX_MSGTYPE_RESPONSE
+        if (mh->tag_count > 0) {
+            tagmap_delete (mh->d->handlers_rpc,
+                           mh->match.matchtag,
+                           mh->tag_count);
+        }
+        else if (mh->match.typemask == FLUX_MSGTYPE_RESPONSE
                             && mh->match.matchtag != FLUX_MATCHTAG_NONE) {
-            zhashx_delete (mh->d->handlers_rpc, &mh->match.matchtag);
+            tagmap_delete (mh->d->handlers_rpc, mh->match.matchtag, 1);
         }
         else if (mh->match.typemask == FLUX_MSGTYPE_REQUEST
                             && !isa_multmatch (mh->match.topic_glob)) {
             zhashx_delete (mh->d->handlers_method, mh->match.topic_glob);
         }
+        else if (mh->event_prefix) {
+            (void)topic_trie_remove (mh->d->handlers_event,
+                                     mh->event_prefix,
+                                     mh);
+        }
         else {
             zlist_remove (mh->d->handlers_new, mh);
             zlist_remove (mh->d->handlers, mh);
         }
         flux_msg_handler_stop (mh);
-        dispatch_usecount_decr (mh->d);
-        free_msg_handler (mh);
+        /* dispatch_event() may still hold a reference to mh.
+         */
+        if (mh->d->event_depth > 0) {
+            mh->zombie_next = mh->d->zombies;
+            mh->d->zombies = mh;
+            dispatch_usecount_decr (mh->d);
+        }
+        else {
+            dispatch_usecount_decr (mh->d);
+            free_msg_handler (mh);
+        }
         errno = saved_errno;
     }
 }
@@ -526,16 +746,15 @@ flux_msg_handler_t *flux_msg_handler_create (flux_t *h,
     mh->fn = cb;
     mh->arg = arg;
     mh->d = d;
+    mh->seq = d->handler_seq++;
     /* Response (valid matchtag):
-     * Fail if entry in the handlers_rpc hash exists, since that probably
+     * Fail if entry in the handlers_rpc table exists, since that probably
      * indicates a matchtag reuse problem!
      */
     if (mh->match.typemask == FLUX_MSGTYPE_RESPONSE
                             && mh->match.matchtag != FLUX_MATCHTAG_NONE) {
-        if (zhashx_insert (d->handlers_rpc, &mh->match.matchtag, mh) < 0) {
-            errno = EEXIST;
+        if (tagmap_insert (d->handlers_rpc, mh->match.matchtag, 1, mh) < 0)
             goto error;
-        }
     }
     /* Request (non-glob):
      * Replace existing entry in the handlers_method hash, if any.
@@ -545,7 +764,17 @@ flux_msg_handler_t *flux_msg_handler_create (flux_t *h,
                             && !isa_multmatch (mh->match.topic_glob)) {
         zhashx_update (d->handlers_method, mh->match.topic_glob, mh);
     }
-    /* Request (glob), response (FLUX_MATCHTAG_NONE), events:
+    /* Event:
+     * Message handler is indexed by the literal prefix of its topic glob
+     * in the handlers_event trie.  See dispatch_event().
+     */
+    else if (mh->match.typemask == FLUX_MSGTYPE_EVENT) {
+        if (!(mh->event_prefix = event_prefix (mh->match.topic_glob)))
+            goto error;
+        if (topic_trie_insert (d->handlers_event, mh->event_prefix, mh) < 0)
+            goto error;
+    }
+    /* Request (glob), response (FLUX_MATCHTAG_NONE), multiple types:
      * Message handler is pushed to the front of the handlers list,
      * and matches before older ones for requests and responses.
      * (Requests and responses in hashes above match first though).
@@ -567,6 +796,41 @@ error:
     return NULL;
 }
 
+flux_msg_handler_t *flux_msg_handler_create_range (flux_t *h,
+                                                   uint32_t matchtag,
+                                                   int count,
+                                                   flux_msg_handler_f cb,
+                                                   void *arg)
+{
+    struct dispatch *d;
+    flux_msg_handler_t *mh;
+
+    if (!h || matchtag == FLUX_MATCHTAG_NONE || count <= 0 || !cb) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(d = dispatch_get (h)))
+        return NULL;
+    if (!(mh = calloc (1, sizeof (*mh))))
+        return NULL;
+    mh->magic = HANDLER_MAGIC;
+    mh->match = FLUX_MATCH_RESPONSE;
+    mh->match.matchtag = matchtag;
+    mh->tag_count = count;
+    mh->rolemask = FLUX_ROLE_OWNER;
+    mh->fn = cb;
+    mh->arg = arg;
+    mh->d = d;
+    mh->seq = d->handler_seq++;
+    if (tagmap_insert (d->handlers_rpc, matchtag, count, mh) < 0)
+        goto error;
+    dispatch_usecount_incr (d);
+    return mh;
+error:
+    free_msg_handler (mh);
+    return NULL;
+}
+
 static bool at_end (struct flux_msg_handler_spec spec)
 {
     struct flux_msg_handler_spec end = FLUX_MSGHANDLER_TABLE_END;
@@ -640,6 +904,43 @@ int flux_dispatch_requeue (flux_t *h)
     return 0;
 }
 
+int flux_dispatch_set_budget (flux_t *h, int budget)
+{
+    struct dispatch *d;
+
+    if (!h || budget < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(d = dispatch_get (h)))
+        return -1;
+    d->budget = budget;
+    return 0;
+}
+
+int flux_dispatch_get_stats (flux_t *h, struct flux_dispatch_stats *stats)
+{
+    struct dispatch *d;
+
+    if (!h || !stats) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(d = dispatch_get (h)))
+        return -1;
+    *stats = d->stats;
+    stats->budget = d->budget;
+    return 0;
+}
+
+void flux_dispatch_clear_stats (flux_t *h)
+{
+    struct dispatch *d;
+
+    if (h && (d = flux_aux_get (h, "flux::dispatch")))
+        memset (&d->stats, 0, sizeof (d->stats));
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
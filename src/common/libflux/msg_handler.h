@@ -59,6 +59,33 @@ void flux_msg_handler_delvec (flux_msg_handler_t *msg_handlers[]);
  */
 int flux_dispatch_requeue (flux_t *h);
 
+/* The dispatcher handles up to 'budget' ready messages each time the
+ * handle becomes ready, before returning to the reactor so that other
+ * watchers get a turn.  The default may be overridden by setting
+ * FLUX_DISPATCH_BUDGET in the environment.
+ */
+#define FLUX_DISPATCH_BUDGET_DEFAULT 16
+
+int flux_dispatch_set_budget (flux_t *h, int budget);
+
+/* Dispatcher counters.  batch_hist[i] counts wakeups that handled
+ * 2^i to 2^(i+1)-1 messages (the last bucket is open ended, and
+ * spurious wakeups that handled no messages are counted in bucket 0).
+ */
+#define FLUX_DISPATCH_HIST_SIZE 8
+
+struct flux_dispatch_stats {
+    uint64_t wakeups;       // handle watcher callbacks
+    uint64_t messages;      // messages handled
+    uint64_t exhausted;     // wakeups that stopped due to budget
+    int max_batch;          // most messages handled in one wakeup
+    int budget;             // current budget
+    uint64_t batch_hist[FLUX_DISPATCH_HIST_SIZE];
+};
+
+int flux_dispatch_get_stats (flux_t *h, struct flux_dispatch_stats *stats);
+void flux_dispatch_clear_stats (flux_t *h);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,35 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef FLUX_MSG_HANDLER_PRIVATE_H
+#define FLUX_MSG_HANDLER_PRIVATE_H
+
+#include "msg_handler.h"
+
+/* Create a handler for responses to 'count' consecutive matchtags
+ * starting at 'matchtag' (see flux_matchtag_alloc_range()).
+ * Destroy with flux_msg_handler_destroy().
+ */
+flux_msg_handler_t *flux_msg_handler_create_range (flux_t *h,
+                                                   uint32_t matchtag,
+                                                   int count,
+                                                   flux_msg_handler_f cb,
+                                                   void *arg);
+
+/* Called when the handle's matchtag pool grows to 'size' tags, so the
+ * dispatcher can size its response handler table up front.
+ */
+void flux_dispatch_matchtag_reserve (flux_t *h, uint32_t size);
+
+#endif /* !FLUX_MSG_HANDLER_PRIVATE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -15,10 +15,14 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 #include <czmq.h>
 
 #include "handle.h"
 #include "reactor.h"
+#include "reactor_private.h"
 #include "ev_flux.h"
 #include "ev_buffer_read.h"
 #include "ev_buffer_write.h"
@@ -29,13 +33,47 @@
 #include "src/common/libutil/ev_zmq.h"
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/fdutils.h"
+#include "src/common/libutil/histogram.h"
+
+/* Watcher types for instrumentation, in the order of watcher_ops[].
+ */
+enum {
+    WATCHER_HANDLE,
+    WATCHER_FD,
+    WATCHER_BUFFER_READ,
+    WATCHER_BUFFER_WRITE,
+    WATCHER_ZMQ,
+    WATCHER_TIMER,
+    WATCHER_PERIODIC,
+    WATCHER_PREPARE,
+    WATCHER_CHECK,
+    WATCHER_IDLE,
+    WATCHER_CHILD,
+    WATCHER_SIGNAL,
+    WATCHER_STAT,
+    WATCHER_TYPE_COUNT,
+};
+
+struct reactor_stats {
+    struct histogram *loop;     // wakeup to next poll, per loop iteration
+    struct histogram *watcher[WATCHER_TYPE_COUNT];
+    zhash_t *topics;            // message topic => struct histogram
+    ev_check check;
+    ev_prepare prepare;
+    uint64_t wakeup;            // time of last wakeup, or 0
+};
 
 struct flux_reactor {
     struct ev_loop *loop;
     int usecount;
     unsigned int errflag:1;
+    unsigned int stopflag:1;
+    struct reactor_stats *stats;
 };
 
+static void stats_destroy (flux_reactor_t *r);
+static void watcher_call_timed (flux_watcher_t *w, int revents);
+
 struct flux_watcher {
     flux_reactor_t *r;
     flux_watcher_f fn;
@@ -48,6 +86,7 @@ static void reactor_usecount_decr (flux_reactor_t *r)
 {
     if (r && --r->usecount == 0) {
         int saved_errno = errno;
+        stats_destroy (r);
         if (r->loop) {
             if (ev_is_default_loop (r->loop))
                 ev_default_destroy ();
@@ -85,6 +124,11 @@ flux_reactor_t *flux_reactor_create (int flags)
     }
     ev_set_userdata (r->loop, r);
     r->usecount = 1;
+    if (getenv ("FLUX_REACTOR_STATS")
+        && flux_reactor_stats_enable (r, true) < 0) {
+        flux_reactor_destroy (r);
+        return NULL;
+    }
     return r;
 }
 
@@ -123,6 +167,7 @@ int flux_reactor_run (flux_reactor_t *r, int flags)
     if (flags & FLUX_REACTOR_ONCE)
         ev_flags |= EVRUN_ONCE;
     r->errflag = 0;
+    r->stopflag = 0;
     count = ev_run (r->loop, ev_flags);
     return (r->errflag ? -1 : count);
 }
@@ -145,15 +190,22 @@ void flux_reactor_now_update (flux_reactor_t *r)
 void flux_reactor_stop (flux_reactor_t *r)
 {
     r->errflag = 0;
+    r->stopflag = 1;
     ev_break (r->loop, EVBREAK_ALL);
 }
 
 void flux_reactor_stop_error (flux_reactor_t *r)
 {
     r->errflag = 1;
+    r->stopflag = 1;
     ev_break (r->loop, EVBREAK_ALL);
 }
 
+bool flux_reactor_is_stopping (flux_reactor_t *r)
+{
+    return r->stopflag ? true : false;
+}
+
 void flux_reactor_active_incref (flux_reactor_t *r)
 {
     if (r)
@@ -194,6 +246,16 @@ static int libev_to_events (int events)
  ** Watchers
  **/
 
+static inline void watcher_call (flux_watcher_t *w, int revents)
+{
+    if (w->fn) {
+        if (w->r->stats)
+            watcher_call_timed (w, revents);
+        else
+            w->fn (w->r, w, revents, w->arg);
+    }
+}
+
 flux_watcher_t *flux_watcher_create (flux_reactor_t *r,
                                      size_t data_size,
                                      struct flux_watcher_ops *ops,
@@ -295,8 +357,7 @@ static void handle_stop (flux_watcher_t *w)
 static void handle_cb (struct ev_loop *loop, struct ev_flux *fw, int revents)
 {
     struct flux_watcher *w = fw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops handle_watcher = {
@@ -343,8 +404,7 @@ static void fd_stop (flux_watcher_t *w)
 static void fd_cb (struct ev_loop *loop, ev_io *iow, int revents)
 {
     struct flux_watcher *w = iow->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops fd_watcher = {
@@ -401,8 +461,7 @@ static void buffer_read_cb (struct ev_loop *loop,
                             int revents)
 {
     struct flux_watcher *w = ebr->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops buffer_read_watcher = {
@@ -488,8 +547,7 @@ static void buffer_write_cb (struct ev_loop *loop,
                              int revents)
 {
     struct flux_watcher *w = ebw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops buffer_write_watcher = {
@@ -599,8 +657,7 @@ static void zmq_stop (flux_watcher_t *w)
 static void zmq_cb (struct ev_loop *loop, ev_zmq *pw, int revents)
 {
     struct flux_watcher *w = pw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops zmq_watcher  = {
@@ -651,8 +708,7 @@ static void timer_stop (flux_watcher_t *w)
 static void timer_cb (struct ev_loop *loop, ev_timer *tw, int revents)
 {
     struct flux_watcher *w = tw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops timer_watcher = {
@@ -711,8 +767,7 @@ static void periodic_cb (struct ev_loop *loop, ev_periodic *pw, int revents)
 {
     struct f_periodic *fp = pw->data;
     struct flux_watcher *w = fp->w;
-    if (w->fn)
-        fp->w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static ev_tstamp periodic_reschedule_cb (ev_periodic *pw, ev_tstamp now)
@@ -808,8 +863,7 @@ static void prepare_stop (flux_watcher_t *w)
 static void prepare_cb (struct ev_loop *loop, ev_prepare *pw, int revents)
 {
     struct flux_watcher *w = pw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops prepare_watcher = {
@@ -849,8 +903,7 @@ static void check_stop (flux_watcher_t *w)
 static void check_cb (struct ev_loop *loop, ev_check *cw, int revents)
 {
     struct flux_watcher *w = cw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops check_watcher = {
@@ -890,8 +943,7 @@ static void idle_stop (flux_watcher_t *w)
 static void idle_cb (struct ev_loop *loop, ev_idle *iw, int revents)
 {
     struct flux_watcher *w = iw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops idle_watcher = {
@@ -931,8 +983,7 @@ static void child_stop (flux_watcher_t *w)
 static void child_cb (struct ev_loop *loop, ev_child *cw, int revents)
 {
     struct flux_watcher *w = cw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops child_watcher = {
@@ -998,8 +1049,7 @@ static void signal_stop (flux_watcher_t *w)
 static void signal_cb (struct ev_loop *loop, ev_signal *sw, int revents)
 {
     struct flux_watcher *w = sw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops signal_watcher = {
@@ -1049,8 +1099,7 @@ static void stat_stop (flux_watcher_t *w)
 static void stat_cb (struct ev_loop *loop, ev_stat *sw, int revents)
 {
     struct flux_watcher *w = sw->data;
-    if (w->fn)
-        w->fn (ev_userdata (loop), w, libev_to_events (revents), w->arg);
+    watcher_call (w, libev_to_events (revents));
 }
 
 static struct flux_watcher_ops stat_watcher = {
@@ -1086,6 +1135,254 @@ void flux_stat_watcher_get_rstat (flux_watcher_t *w,
         *prev = sw->prev;
 }
 
+/* Instrumentation
+ */
+
+static struct {
+    struct flux_watcher_ops *ops;
+    const char *name;
+} watcher_types[WATCHER_TYPE_COUNT] = {
+    [WATCHER_HANDLE] = { &handle_watcher, "handle" },
+    [WATCHER_FD] = { &fd_watcher, "fd" },
+    [WATCHER_BUFFER_READ] = { &buffer_read_watcher, "buffer_read" },
+    [WATCHER_BUFFER_WRITE] = { &buffer_write_watcher, "buffer_write" },
+    [WATCHER_ZMQ] = { &zmq_watcher, "zmq" },
+    [WATCHER_TIMER] = { &timer_watcher, "timer" },
+    [WATCHER_PERIODIC] = { &periodic_watcher, "periodic" },
+    [WATCHER_PREPARE] = { &prepare_watcher, "prepare" },
+    [WATCHER_CHECK] = { &check_watcher, "check" },
+    [WATCHER_IDLE] = { &idle_watcher, "idle" },
+    [WATCHER_CHILD] = { &child_watcher, "child" },
+    [WATCHER_SIGNAL] = { &signal_watcher, "signal" },
+    [WATCHER_STAT] = { &stat_watcher, "stat" },
+};
+
+static inline uint64_t stats_clock (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t flux_reactor_stats_start (void)
+{
+    return stats_clock ();
+}
+
+static int watcher_type (struct flux_watcher_ops *ops)
+{
+    int i;
+
+    for (i = 0; i < WATCHER_TYPE_COUNT; i++) {
+        if (watcher_types[i].ops == ops)
+            return i;
+    }
+    return -1;
+}
+
+static void stats_record (struct histogram **hp, uint64_t t)
+{
+    if (!*hp && !(*hp = histogram_create ()))
+        return;
+    histogram_record (*hp, t);
+}
+
+/* N.B. the callback may destroy the watcher, or disable instrumentation,
+ * so neither 'w' nor the old r->stats may be accessed after it returns.
+ */
+static void watcher_call_timed (flux_watcher_t *w, int revents)
+{
+    flux_reactor_t *r = w->r;
+    int type = watcher_type (w->ops);
+    uint64_t t0 = stats_clock ();
+
+    w->fn (r, w, revents, w->arg);
+    if (r->stats && type >= 0)
+        stats_record (&r->stats->watcher[type], stats_clock () - t0);
+}
+
+void flux_reactor_stats_record_topic (flux_reactor_t *r,
+                                      const char *topic,
+                                      uint64_t start)
+{
+    uint64_t t = stats_clock () - start;
+    struct histogram *hist;
+
+    if (!r || !r->stats || !topic)
+        return;
+    if (!(hist = zhash_lookup (r->stats->topics, topic))) {
+        if (!(hist = histogram_create ()))
+            return;
+        if (zhash_insert (r->stats->topics, topic, hist) < 0) {
+            histogram_destroy (hist);
+            return;
+        }
+        zhash_freefn (r->stats->topics,
+                      topic,
+                      (zhash_free_fn *)histogram_destroy);
+    }
+    histogram_record (hist, t);
+}
+
+/* The check watcher runs first after the loop wakes up and the prepare
+ * watcher runs last before it blocks, so the difference is the time
+ * spent handling events in one loop iteration.
+ */
+static void stats_check_cb (struct ev_loop *loop, ev_check *cw, int revents)
+{
+    struct reactor_stats *stats = cw->data;
+    stats->wakeup = stats_clock ();
+}
+
+static void stats_prepare_cb (struct ev_loop *loop,
+                              ev_prepare *pw,
+                              int revents)
+{
+    struct reactor_stats *stats = pw->data;
+    if (stats->wakeup > 0) {
+        stats_record (&stats->loop, stats_clock () - stats->wakeup);
+        stats->wakeup = 0;
+    }
+}
+
+static void stats_destroy (flux_reactor_t *r)
+{
+    struct reactor_stats *stats = r->stats;
+
+    if (stats) {
+        int saved_errno = errno;
+        int i;
+        /* Watchers were unref'd on start, so re-ref before stopping.
+         */
+        if (r->loop) {
+            ev_ref (r->loop);
+            ev_check_stop (r->loop, &stats->check);
+            ev_ref (r->loop);
+            ev_prepare_stop (r->loop, &stats->prepare);
+        }
+        histogram_destroy (stats->loop);
+        for (i = 0; i < WATCHER_TYPE_COUNT; i++)
+            histogram_destroy (stats->watcher[i]);
+        zhash_destroy (&stats->topics);
+        free (stats);
+        r->stats = NULL;
+        errno = saved_errno;
+    }
+}
+
+static struct reactor_stats *stats_create (flux_reactor_t *r)
+{
+    struct reactor_stats *stats;
+
+    if (!(stats = calloc (1, sizeof (*stats))))
+        return NULL;
+    if (!(stats->topics = zhash_new ())) {
+        free (stats);
+        errno = ENOMEM;
+        return NULL;
+    }
+    /* Instrumentation watchers should not keep the loop alive.
+     */
+    ev_check_init (&stats->check, stats_check_cb);
+    ev_set_priority (&stats->check, EV_MAXPRI);
+    stats->check.data = stats;
+    ev_check_start (r->loop, &stats->check);
+    ev_unref (r->loop);
+    ev_prepare_init (&stats->prepare, stats_prepare_cb);
+    ev_set_priority (&stats->prepare, EV_MINPRI);
+    stats->prepare.data = stats;
+    ev_prepare_start (r->loop, &stats->prepare);
+    ev_unref (r->loop);
+    return stats;
+}
+
+int flux_reactor_stats_enable (flux_reactor_t *r, bool enable)
+{
+    if (!r) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (enable && !r->stats) {
+        if (!(r->stats = stats_create (r)))
+            return -1;
+    }
+    else if (!enable)
+        stats_destroy (r);
+    return 0;
+}
+
+bool flux_reactor_stats_enabled (flux_reactor_t *r)
+{
+    return r && r->stats ? true : false;
+}
+
+void flux_reactor_stats_clear (flux_reactor_t *r)
+{
+    if (r && r->stats) {
+        int i;
+        histogram_clear (r->stats->loop);
+        for (i = 0; i < WATCHER_TYPE_COUNT; i++)
+            histogram_clear (r->stats->watcher[i]);
+        zhash_purge (r->stats->topics);
+    }
+}
+
+static int stats_call (flux_reactor_stat_f fn,
+                       void *arg,
+                       int kind,
+                       const char *name,
+                       struct histogram *hist)
+{
+    struct flux_reactor_stat st;
+
+    if (histogram_count (hist) == 0)
+        return 0;
+    st.kind = kind;
+    st.name = name;
+    st.count = histogram_count (hist);
+    st.min = 1E-9 * histogram_min (hist);
+    st.max = 1E-9 * histogram_max (hist);
+    st.mean = 1E-9 * histogram_mean (hist);
+    st.p50 = 1E-9 * histogram_percentile (hist, 50);
+    st.p90 = 1E-9 * histogram_percentile (hist, 90);
+    st.p99 = 1E-9 * histogram_percentile (hist, 99);
+    return fn (&st, arg);
+}
+
+int flux_reactor_stats_foreach (flux_reactor_t *r,
+                                flux_reactor_stat_f fn,
+                                void *arg)
+{
+    struct histogram *hist;
+    int i;
+
+    if (!r || !fn) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!r->stats)
+        return 0;
+    if (stats_call (fn, arg, FLUX_REACTOR_STAT_LOOP, "loop",
+                    r->stats->loop) < 0)
+        return -1;
+    for (i = 0; i < WATCHER_TYPE_COUNT; i++) {
+        if (stats_call (fn, arg, FLUX_REACTOR_STAT_WATCHER,
+                        watcher_types[i].name,
+                        r->stats->watcher[i]) < 0)
+            return -1;
+    }
+    hist = zhash_first (r->stats->topics);
+    while (hist) {
+        if (stats_call (fn, arg, FLUX_REACTOR_STAT_TOPIC,
+                        zhash_cursor (r->stats->topics),
+                        hist) < 0)
+            return -1;
+        hist = zhash_next (r->stats->topics);
+    }
+    return 0;
+}
+
 
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
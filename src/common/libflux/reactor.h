@@ -14,6 +14,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "handle.h"
 #include "buffer.h"
@@ -69,6 +70,46 @@ double flux_reactor_time (void);
 void flux_reactor_active_incref (flux_reactor_t *r);
 void flux_reactor_active_decref (flux_reactor_t *r);
 
+/* Reactor instrumentation.
+ * When enabled, the reactor records the duration of each watcher callback
+ * by watcher type, of each message handler callback by message topic, and
+ * of each loop iteration from wakeup to the next poll, in log-linear
+ * histograms.  It is off by default, or on for every reactor if
+ * FLUX_REACTOR_STATS is set in the environment.  When off, the cost is
+ * one branch per callback.
+ */
+enum {
+    FLUX_REACTOR_STAT_LOOP = 0,
+    FLUX_REACTOR_STAT_WATCHER = 1,
+    FLUX_REACTOR_STAT_TOPIC = 2,
+};
+
+struct flux_reactor_stat {
+    int kind;               // FLUX_REACTOR_STAT_*
+    const char *name;       // "loop", watcher type, or message topic
+    uint64_t count;
+    double min;             // durations in seconds
+    double max;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+};
+
+typedef int (*flux_reactor_stat_f)(const struct flux_reactor_stat *stat,
+                                   void *arg);
+
+int flux_reactor_stats_enable (flux_reactor_t *r, bool enable);
+bool flux_reactor_stats_enabled (flux_reactor_t *r);
+void flux_reactor_stats_clear (flux_reactor_t *r);
+
+/* Call 'fn' for each non-empty histogram.  Iteration stops if 'fn'
+ * returns -1, and flux_reactor_stats_foreach() returns -1.
+ */
+int flux_reactor_stats_foreach (flux_reactor_t *r,
+                                flux_reactor_stat_f fn,
+                                void *arg);
+
 
 /* Watchers
  */
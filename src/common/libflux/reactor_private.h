@@ -0,0 +1,39 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef FLUX_REACTOR_PRIVATE_H
+#define FLUX_REACTOR_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "reactor.h"
+
+/* Return true if flux_reactor_stop() or flux_reactor_stop_error()
+ * has been called since the reactor was last started.  Watchers that
+ * do more than one unit of work per callback use this to stop early,
+ * leaving the remaining work for the next flux_reactor_run().
+ */
+bool flux_reactor_is_stopping (flux_reactor_t *r);
+
+/* Message dispatch times each message handler callback with these so
+ * reactor instrumentation can report callback time by message topic.
+ * Call flux_reactor_stats_start() only if flux_reactor_stats_enabled().
+ */
+uint64_t flux_reactor_stats_start (void);
+void flux_reactor_stats_record_topic (flux_reactor_t *r,
+                                      const char *topic,
+                                      uint64_t start);
+
+#endif /* !FLUX_REACTOR_PRIVATE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -200,6 +200,7 @@ error:
 flux_msg_t *flux_response_derive (const flux_msg_t *request, int errnum)
 {
     flux_msg_t *msg;
+    uint8_t flags;
 
     if (!request || flux_msg_is_noresponse (request)) {
         errno = EINVAL;
@@ -209,6 +210,11 @@ flux_msg_t *flux_response_derive (const flux_msg_t *request, int errnum)
         return NULL;
     if (flux_msg_set_type (msg, FLUX_MSGTYPE_RESPONSE) < 0)
         goto error;
+    /* The user-defined flag applies only to the request.
+     */
+    if (flux_msg_get_flags (msg, &flags) < 0
+        || flux_msg_set_flags (msg, flags & ~FLUX_MSGFLAG_USER1) < 0)
+        goto error;
     if (flux_msg_set_userid (msg, FLUX_USERID_UNKNOWN) < 0)
         goto error;
     if (flux_msg_set_rolemask (msg, FLUX_ROLE_NONE) < 0)
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
 #if HAVE_CALIPER
 #include <caliper/cali.h>
 #include <sys/syscall.h>
@@ -30,6 +31,7 @@
 #include "rpc.h"
 #include "reactor.h"
 #include "msg_handler.h"
+#include "msg_handler_private.h"
 #include "flog.h"
 
 struct flux_rpc {
@@ -39,6 +41,28 @@ struct flux_rpc {
     bool sent;
 };
 
+struct batch_entry {
+    flux_msg_t *msg;            // request, until sent
+    flux_msg_t *response;
+    int errnum;
+    char *errstr;
+    bool done;
+};
+
+/* Requests in a batch are assigned consecutive matchtags, so a response
+ * is mapped to its entry by subtracting the first one.
+ */
+struct flux_rpc_batch {
+    uint32_t matchtag;          // first of 'count' consecutive matchtags
+    int flags;
+    flux_future_t *f;
+    struct batch_entry *entries;
+    int count;
+    int size;
+    int sent;                   // entries sent (in order)
+    int done;                   // entries with a response
+};
+
 static void log_matchtag_leak (flux_t *h, const char *msg, int matchtag)
 {
     if ((flux_flags_get (h) & FLUX_O_MATCHDEBUG))
@@ -230,6 +254,33 @@ error:
     flux_future_fulfill_error (f, errno, NULL);
 }
 
+/* Set request message flags and nodeid for an RPC with 'flags'.
+ */
+static int request_prep (flux_t *h,
+                         flux_msg_t *msg,
+                         uint32_t nodeid,
+                         int flags)
+{
+    uint8_t msgflags;
+
+    if (flux_msg_get_flags (msg, &msgflags) < 0)
+        return -1;
+    if (nodeid == FLUX_NODEID_UPSTREAM) {
+        msgflags |= FLUX_MSGFLAG_UPSTREAM;
+        if (flux_get_rank (h, &nodeid) < 0)
+            return -1;
+    }
+    if ((flags & FLUX_RPC_STREAMING))
+        msgflags |= FLUX_MSGFLAG_STREAMING;
+    if ((flags & FLUX_RPC_NORESPONSE))
+        msgflags |= FLUX_MSGFLAG_NORESPONSE;
+    if (flux_msg_set_flags (msg, msgflags) < 0)
+        return -1;
+    if (flux_msg_set_nodeid (msg, nodeid) < 0)
+        return -1;
+    return 0;
+}
+
 static flux_future_t *flux_rpc_message_nocopy (flux_t *h,
                                                flux_msg_t *msg,
                                                uint32_t nodeid,
@@ -237,7 +288,6 @@ static flux_future_t *flux_rpc_message_nocopy (flux_t *h,
 {
     struct flux_rpc *rpc = NULL;
     flux_future_t *f;
-    uint8_t msgflags;
 
     if (!(f = flux_future_create (initialize_cb, NULL)))
         goto error;
@@ -250,20 +300,7 @@ static flux_future_t *flux_rpc_message_nocopy (flux_t *h,
     }
     if (flux_msg_set_matchtag (msg, rpc->matchtag) < 0)
         goto error;
-    if (flux_msg_get_flags (msg, &msgflags) < 0)
-        goto error;
-    if (nodeid == FLUX_NODEID_UPSTREAM) {
-        msgflags |= FLUX_MSGFLAG_UPSTREAM;
-        if (flux_get_rank (h, &nodeid) < 0)
-            goto error;
-    }
-    if ((flags & FLUX_RPC_STREAMING))
-        msgflags |= FLUX_MSGFLAG_STREAMING;
-    if ((flags & FLUX_RPC_NORESPONSE))
-        msgflags |= FLUX_MSGFLAG_NORESPONSE;
-    if (flux_msg_set_flags (msg, msgflags) < 0)
-        goto error;
-    if (flux_msg_set_nodeid (msg, nodeid) < 0)
+    if (request_prep (h, msg, nodeid, flags) < 0)
         goto error;
 #if HAVE_CALIPER
     cali_begin_string_byname ("flux.message.rpc", "single");
@@ -412,6 +449,391 @@ uint32_t flux_rpc_get_matchtag (flux_future_t *f)
     return rpc ? rpc->matchtag : FLUX_MATCHTAG_NONE;
 }
 
+/* Return matchtags to the pool, except those of requests that are still
+ * awaiting a response, which are reclaimed if the response ever arrives
+ * (see handle_late_response() in msg_handler.c).
+ */
+static void batch_destroy (struct flux_rpc_batch *b)
+{
+    if (b) {
+        int saved_errno = errno;
+        flux_t *h = flux_future_get_flux (b->f);
+        int leaked = 0;
+        int i;
+
+        for (i = 0; i < b->count; i++) {
+            struct batch_entry *e = &b->entries[i];
+
+            if (b->matchtag != FLUX_MATCHTAG_NONE) {
+                if (i >= b->sent || e->done)
+                    flux_matchtag_free (h, b->matchtag + i);
+                else
+                    leaked++;
+            }
+            flux_msg_destroy (e->msg);
+            flux_msg_destroy (e->response);
+            free (e->errstr);
+        }
+        if (leaked > 0)
+            log_matchtag_leak (h, "unfulfilled RPC batch", b->matchtag);
+        free (b->entries);
+        free (b);
+        errno = saved_errno;
+    }
+}
+
+static void batch_response_cb (flux_t *h,
+                               flux_msg_handler_t *mh,
+                               const flux_msg_t *msg,
+                               void *arg)
+{
+    flux_future_t *f = arg;
+    struct flux_rpc_batch *b = flux_future_aux_get (f, "flux::rpc_batch");
+    struct batch_entry *e;
+    uint32_t matchtag;
+    const char *errstr;
+
+    if (flux_msg_get_matchtag (msg, &matchtag) < 0
+        || matchtag - b->matchtag >= b->sent)
+        return;
+    e = &b->entries[matchtag - b->matchtag];
+    if (e->done)
+        return;
+    if (flux_response_decode (msg, NULL, NULL) < 0) {
+        e->errnum = errno;
+        if (flux_response_decode_error (msg, &errstr) == 0)
+            e->errstr = strdup (errstr);
+    }
+    else if (!(e->response = flux_msg_copy (msg, true)))
+        e->errnum = errno;
+    e->done = true;
+    if (++b->done == b->count)
+        flux_future_fulfill (f, NULL, NULL);
+}
+
+/* Install one message handler for the whole matchtag range.
+ */
+static void batch_initialize_cb (flux_future_t *f, void *arg)
+{
+    struct flux_rpc_batch *b = flux_future_aux_get (f, "flux::rpc_batch");
+    flux_t *h = flux_future_get_flux (f);
+    flux_msg_handler_t *mh;
+
+    if (b->done == b->count)
+        return;
+    if (b->sent < b->count) {
+        flux_future_fulfill_error (f, EINVAL, "RPC batch was not sent");
+        return;
+    }
+    if (!(mh = flux_msg_handler_create_range (h,
+                                              b->matchtag,
+                                              b->count,
+                                              batch_response_cb,
+                                              f)))
+        goto error;
+    if (flux_future_aux_set (f, NULL, mh,
+                            (flux_free_f)flux_msg_handler_destroy) < 0) {
+        flux_msg_handler_destroy (mh);
+        goto error;
+    }
+    flux_msg_handler_allow_rolemask (mh, FLUX_ROLE_ALL);
+    flux_msg_handler_start (mh);
+    return;
+error:
+    flux_future_fulfill_error (f, errno, NULL);
+}
+
+static struct flux_rpc_batch *batch_get (flux_future_t *f)
+{
+    struct flux_rpc_batch *b;
+
+    if (!(b = flux_future_aux_get (f, "flux::rpc_batch"))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return b;
+}
+
+flux_future_t *flux_rpc_batch_create (flux_t *h, int flags)
+{
+    struct flux_rpc_batch *b;
+    flux_future_t *f;
+
+    if (!h || validate_flags (flags, FLUX_RPC_NORESPONSE) < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(f = flux_future_create (batch_initialize_cb, NULL)))
+        return NULL;
+    if (!(b = calloc (1, sizeof (*b))))
+        goto error;
+    b->f = f;
+    b->flags = flags;
+    b->matchtag = FLUX_MATCHTAG_NONE;
+    flux_future_set_flux (f, h);
+    if (flux_future_aux_set (f, "flux::rpc_batch", b,
+                             (flux_free_f)batch_destroy) < 0) {
+        batch_destroy (b);
+        goto error;
+    }
+    return f;
+error:
+    flux_future_destroy (f);
+    return NULL;
+}
+
+/* Append request 'msg' to the batch, taking ownership on success.
+ */
+static int batch_append (flux_future_t *f, flux_msg_t *msg, uint32_t nodeid)
+{
+    struct flux_rpc_batch *b;
+    struct batch_entry *e;
+
+    if (!(b = batch_get (f)))
+        return -1;
+    if (b->sent > 0 || flux_future_is_ready (f)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (request_prep (flux_future_get_flux (f), msg, nodeid, b->flags) < 0)
+        return -1;
+    if (b->count == b->size) {
+        int size = b->size ? b->size * 2 : 16;
+        struct batch_entry *entries;
+
+        if (!(entries = realloc (b->entries, size * sizeof (entries[0])))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        b->entries = entries;
+        b->size = size;
+    }
+    e = &b->entries[b->count];
+    memset (e, 0, sizeof (*e));
+    e->msg = msg;
+    return b->count++;
+}
+
+int flux_rpc_batch_add_message (flux_future_t *f,
+                                const flux_msg_t *msg,
+                                uint32_t nodeid)
+{
+    flux_msg_t *cpy;
+    int index;
+
+    if (!f || !msg) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(cpy = flux_msg_copy (msg, true)))
+        return -1;
+    if ((index = batch_append (f, cpy, nodeid)) < 0)
+        flux_msg_destroy (cpy);
+    return index;
+}
+
+int flux_rpc_batch_add (flux_future_t *f,
+                        const char *topic,
+                        const char *s,
+                        uint32_t nodeid)
+{
+    flux_msg_t *msg;
+    int index;
+
+    if (!f) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(msg = flux_request_encode (topic, s)))
+        return -1;
+    if ((index = batch_append (f, msg, nodeid)) < 0)
+        flux_msg_destroy (msg);
+    return index;
+}
+
+int flux_rpc_batch_add_raw (flux_future_t *f,
+                            const char *topic,
+                            const void *data,
+                            int len,
+                            uint32_t nodeid)
+{
+    flux_msg_t *msg;
+    int index;
+
+    if (!f) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(msg = flux_request_encode_raw (topic, data, len)))
+        return -1;
+    if ((index = batch_append (f, msg, nodeid)) < 0)
+        flux_msg_destroy (msg);
+    return index;
+}
+
+int flux_rpc_batch_add_vpack (flux_future_t *f,
+                              const char *topic,
+                              uint32_t nodeid,
+                              const char *fmt,
+                              va_list ap)
+{
+    flux_msg_t *msg;
+    int index;
+
+    if (!f) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(msg = flux_request_encode (topic, NULL)))
+        return -1;
+    if (flux_msg_vpack (msg, fmt, ap) < 0
+        || (index = batch_append (f, msg, nodeid)) < 0) {
+        flux_msg_destroy (msg);
+        return -1;
+    }
+    return index;
+}
+
+int flux_rpc_batch_add_pack (flux_future_t *f,
+                             const char *topic,
+                             uint32_t nodeid,
+                             const char *fmt, ...)
+{
+    va_list ap;
+    int index;
+
+    va_start (ap, fmt);
+    index = flux_rpc_batch_add_vpack (f, topic, nodeid, fmt, ap);
+    va_end (ap);
+    return index;
+}
+
+int flux_rpc_batch_send (flux_future_t *f)
+{
+    struct flux_rpc_batch *b;
+    flux_t *h;
+
+    if (!(b = batch_get (f)))
+        return -1;
+    if (b->sent > 0 || flux_future_is_ready (f)) {
+        errno = EINVAL;
+        return -1;
+    }
+    h = flux_future_get_flux (f);
+    if (b->count > 0 && !(b->flags & FLUX_RPC_NORESPONSE)) {
+        int i;
+
+        b->matchtag = flux_matchtag_alloc_range (h, b->count);
+        if (b->matchtag == FLUX_MATCHTAG_NONE)
+            return -1;
+        for (i = 0; i < b->count; i++) {
+            if (flux_msg_set_matchtag (b->entries[i].msg,
+                                       b->matchtag + i) < 0)
+                return -1;
+        }
+    }
+    while (b->sent < b->count) {
+        struct batch_entry *e = &b->entries[b->sent];
+
+        if (flux_send (h, e->msg, 0) < 0)
+            return -1;
+        flux_msg_destroy (e->msg);
+        e->msg = NULL;
+        b->sent++;
+    }
+    if (b->count == 0 || (b->flags & FLUX_RPC_NORESPONSE)) {
+        b->done = b->count;
+        flux_future_fulfill (f, NULL, NULL);
+    }
+    return 0;
+}
+
+int flux_rpc_batch_count (flux_future_t *f)
+{
+    struct flux_rpc_batch *b;
+
+    if (!(b = batch_get (f)))
+        return -1;
+    return b->count;
+}
+
+/* Wait for the batch to complete, then return entry 'index'.
+ */
+static struct batch_entry *batch_entry_get (flux_future_t *f, int index)
+{
+    struct flux_rpc_batch *b;
+    struct batch_entry *e;
+
+    if (!(b = batch_get (f)))
+        return NULL;
+    if (index < 0 || index >= b->count) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (flux_future_get (f, NULL) < 0)
+        return NULL;
+    e = &b->entries[index];
+    if (e->errnum != 0) {
+        errno = e->errnum;
+        return NULL;
+    }
+    if (!e->response) {
+        errno = EINVAL; // FLUX_RPC_NORESPONSE
+        return NULL;
+    }
+    return e;
+}
+
+int flux_rpc_batch_get (flux_future_t *f, int index, const char **s)
+{
+    struct batch_entry *e;
+
+    if (!(e = batch_entry_get (f, index)))
+        return -1;
+    return flux_response_decode (e->response, NULL, s);
+}
+
+int flux_rpc_batch_get_raw (flux_future_t *f,
+                            int index,
+                            const void **data,
+                            int *len)
+{
+    struct batch_entry *e;
+
+    if (!(e = batch_entry_get (f, index)))
+        return -1;
+    return flux_response_decode_raw (e->response, NULL, data, len);
+}
+
+int flux_rpc_batch_get_unpack (flux_future_t *f,
+                               int index,
+                               const char *fmt, ...)
+{
+    struct batch_entry *e;
+    va_list ap;
+    int rc;
+
+    if (!(e = batch_entry_get (f, index)))
+        return -1;
+    va_start (ap, fmt);
+    rc = flux_msg_vunpack (e->response, fmt, ap);
+    va_end (ap);
+    return rc;
+}
+
+const char *flux_rpc_batch_error_string (flux_future_t *f, int index)
+{
+    struct flux_rpc_batch *b;
+
+    if (!(b = batch_get (f)) || index < 0 || index >= b->count)
+        return NULL;
+    if (b->entries[index].errstr)
+        return b->entries[index].errstr;
+    if (b->entries[index].errnum != 0)
+        return flux_strerror (b->entries[index].errnum);
+    return flux_future_error_string (f);
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -52,6 +52,51 @@ int flux_rpc_get_raw (flux_future_t *f, const void **data, int *len);
  */
 uint32_t flux_rpc_get_matchtag (flux_future_t *f);
 
+/* Batched RPCs.
+ * Requests are queued with flux_rpc_batch_add*(), which return the index
+ * of the request in the batch, then sent together with flux_rpc_batch_send()
+ * using a range of consecutive matchtags.  The future is fulfilled when all
+ * requests have received a response (flags may be 0 or FLUX_RPC_NORESPONSE;
+ * streaming RPCs cannot be batched).  Call flux_rpc_batch_send() before
+ * flux_future_then() or flux_future_get().
+ *
+ * flux_rpc_batch_get*() wait for the batch to complete, then decode the
+ * response to request 'index', failing with its errno if it was an error.
+ * flux_rpc_batch_error_string() returns the error string for 'index'.
+ */
+flux_future_t *flux_rpc_batch_create (flux_t *h, int flags);
+
+int flux_rpc_batch_add (flux_future_t *f, const char *topic, const char *s,
+                        uint32_t nodeid);
+
+int flux_rpc_batch_add_pack (flux_future_t *f, const char *topic,
+                             uint32_t nodeid, const char *fmt, ...);
+
+int flux_rpc_batch_add_vpack (flux_future_t *f,
+                              const char *topic,
+                              uint32_t nodeid,
+                              const char *fmt, va_list ap);
+
+int flux_rpc_batch_add_raw (flux_future_t *f, const char *topic,
+                            const void *data, int len, uint32_t nodeid);
+
+int flux_rpc_batch_add_message (flux_future_t *f, const flux_msg_t *msg,
+                                uint32_t nodeid);
+
+int flux_rpc_batch_send (flux_future_t *f);
+
+int flux_rpc_batch_count (flux_future_t *f);
+
+int flux_rpc_batch_get (flux_future_t *f, int index, const char **s);
+
+int flux_rpc_batch_get_unpack (flux_future_t *f, int index,
+                               const char *fmt, ...);
+
+int flux_rpc_batch_get_raw (flux_future_t *f, int index,
+                            const void **data, int *len);
+
+const char *flux_rpc_batch_error_string (flux_future_t *f, int index);
+
 #ifdef __cplusplus
 }
 #endif
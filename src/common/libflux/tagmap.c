@@ -0,0 +1,166 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* tagmap.c - map matchtags to pointers with a paged array */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "tagmap.h"
+
+#define PAGE_BITS   8
+#define PAGE_SIZE   (1U << PAGE_BITS)
+#define PAGE_MASK   (PAGE_SIZE - 1)
+
+struct tagmap {
+    void ***page;       // page directory, NULL entries not yet allocated
+    uint32_t npages;
+};
+
+void tagmap_destroy (struct tagmap *map)
+{
+    if (map) {
+        int saved_errno = errno;
+        uint32_t i;
+        for (i = 0; i < map->npages; i++)
+            free (map->page[i]);
+        free (map->page);
+        free (map);
+        errno = saved_errno;
+    }
+}
+
+struct tagmap *tagmap_create (void)
+{
+    struct tagmap *map;
+
+    if (!(map = calloc (1, sizeof (*map)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return map;
+}
+
+int tagmap_reserve (struct tagmap *map, uint32_t size)
+{
+    uint32_t npages;
+    void ***page;
+
+    if (!map) {
+        errno = EINVAL;
+        return -1;
+    }
+    npages = (size >> PAGE_BITS) + ((size & PAGE_MASK) ? 1 : 0);
+    if (npages <= map->npages)
+        return 0;
+    if (!(page = realloc (map->page, npages * sizeof (page[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset (&page[map->npages],
+            0,
+            (npages - map->npages) * sizeof (page[0]));
+    map->page = page;
+    map->npages = npages;
+    return 0;
+}
+
+static void **get_slot (struct tagmap *map, uint32_t matchtag)
+{
+    uint32_t i = matchtag >> PAGE_BITS;
+
+    if (i >= map->npages || !map->page[i])
+        return NULL;
+    return &map->page[i][matchtag & PAGE_MASK];
+}
+
+static void **get_slot_alloc (struct tagmap *map, uint32_t matchtag)
+{
+    uint32_t i = matchtag >> PAGE_BITS;
+
+    if (i >= map->npages) {
+        /* Grow geometrically to keep reallocation rare.
+         */
+        uint64_t size = (uint64_t)map->npages << (PAGE_BITS + 1);
+        if (size <= matchtag)
+            size = (uint64_t)matchtag + 1;
+        if (size > UINT32_MAX)
+            size = UINT32_MAX;
+        if (tagmap_reserve (map, size) < 0)
+            return NULL;
+    }
+    if (!map->page[i]) {
+        if (!(map->page[i] = calloc (PAGE_SIZE, sizeof (void *)))) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    return &map->page[i][matchtag & PAGE_MASK];
+}
+
+int tagmap_insert (struct tagmap *map,
+                   uint32_t matchtag,
+                   uint32_t count,
+                   void *item)
+{
+    void **slot;
+    uint32_t i;
+
+    if (!map || count == 0 || matchtag + count < matchtag || !item) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if ((slot = get_slot (map, matchtag + i)) && *slot) {
+            errno = EEXIST;
+            return -1;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        if (!(slot = get_slot_alloc (map, matchtag + i))) {
+            int saved_errno = errno;
+            tagmap_delete (map, matchtag, i);
+            errno = saved_errno;
+            return -1;
+        }
+        *slot = item;
+    }
+    return 0;
+}
+
+void tagmap_delete (struct tagmap *map, uint32_t matchtag, uint32_t count)
+{
+    void **slot;
+    uint32_t i;
+
+    if (map) {
+        for (i = 0; i < count; i++) {
+            if ((slot = get_slot (map, matchtag + i)))
+                *slot = NULL;
+        }
+    }
+}
+
+void *tagmap_lookup (struct tagmap *map, uint32_t matchtag)
+{
+    void **slot;
+
+    if (!map || !(slot = get_slot (map, matchtag)))
+        return NULL;
+    return *slot;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,46 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_CORE_TAGMAP_H
+#define _FLUX_CORE_TAGMAP_H
+
+#include <stdint.h>
+
+/* Map matchtags to pointers.  Matchtags are small, dense integers
+ * allocated by tagpool, so the map is a directly indexed array, split
+ * into pages that are allocated on first use and kept until the map is
+ * destroyed.  Lookup, insert, and delete are O(1) and, once a page
+ * exists, do not allocate.
+ */
+struct tagmap *tagmap_create (void);
+void tagmap_destroy (struct tagmap *map);
+
+/* Ensure the map can hold matchtags below 'size' without growing
+ * its page directory, e.g. when the tagpool grows.
+ */
+int tagmap_reserve (struct tagmap *map, uint32_t size);
+
+/* Map 'count' consecutive matchtags starting at 'matchtag' to 'item'.
+ * Fails with EEXIST, leaving the map unchanged, if any are already mapped.
+ */
+int tagmap_insert (struct tagmap *map,
+                   uint32_t matchtag,
+                   uint32_t count,
+                   void *item);
+
+void tagmap_delete (struct tagmap *map, uint32_t matchtag, uint32_t count);
+
+void *tagmap_lookup (struct tagmap *map, uint32_t matchtag);
+
+#endif /* !_FLUX_CORE_TAGMAP_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -88,29 +88,42 @@ void tagpool_set_grow_cb (struct tagpool *t, tagpool_grow_f cb, void *arg)
     t->grow_arg = arg;
 }
 
+/* Double the pool size, copying the allocation state of existing tags.
+ * Return 0 on success, -1 if the pool is at its maximum size or out of memory.
+ */
+static int pool_grow (struct tagpool *t)
+{
+    uint32_t oldsize = t->veb.M;
+    uint32_t newsize = oldsize << 1;
+    uint32_t tag;
+
+    if (newsize > TAGPOOL_COUNT)
+        return -1;
+    if (t->grow_cb && t->grow_depth == 0) {
+        t->grow_depth++;
+        t->grow_cb (t->grow_arg, oldsize, newsize);
+        t->grow_depth--;
+    }
+    Veb new = vebnew (newsize, 0);
+    if (!new.D)
+        return -1;
+    tag = 0;
+    while ((tag = vebsucc (t->veb, tag)) < oldsize)
+        vebput (new, tag++);
+    pool_set (new, oldsize, newsize, 1);
+    free (t->veb.D);
+    t->veb = new;
+    return 0;
+}
+
 static uint32_t alloc_with_resize (struct tagpool *t)
 {
-    uint32_t max = TAGPOOL_COUNT;
-    uint32_t oldsize, newsize, tag;
+    uint32_t tag;
 
-    oldsize = t->veb.M;
-    newsize = oldsize << 1;
     tag = vebsucc (t->veb, 0);
-
-    if (tag == t->veb.M && newsize <= max) {
-        if (t->grow_cb && t->grow_depth == 0) {
-            t->grow_depth++;
-            t->grow_cb (t->grow_arg, oldsize, newsize);
-            t->grow_depth--;
-        }
-        Veb new = vebnew (newsize, 0);
-        if (new.D) {
-            pool_set (new, oldsize, newsize, 1);
-            free (t->veb.D);
-            t->veb = new;
-            tag = vebsucc (t->veb, oldsize);
-            assert (tag == oldsize);
-        }
+    if (tag == t->veb.M && pool_grow (t) == 0) {
+        tag = vebsucc (t->veb, 0);
+        assert (tag < t->veb.M);
     }
     if (tag < t->veb.M)
         vebdel (t->veb, tag);
@@ -130,6 +143,46 @@ uint32_t tagpool_alloc (struct tagpool *t)
     return FLUX_MATCHTAG_NONE;
 }
 
+/* Find the first run of 'count' free tags, growing the pool if none.
+ */
+static uint32_t find_range (struct tagpool *t, uint32_t count)
+{
+    uint32_t tag;
+    uint32_t i;
+
+    for (;;) {
+        tag = vebsucc (t->veb, 0);
+        while (tag + count <= t->veb.M) {
+            for (i = 1; i < count; i++) {
+                if (vebsucc (t->veb, tag + i) != tag + i)
+                    break;
+            }
+            if (i == count)
+                return tag;
+            tag = vebsucc (t->veb, tag + i);
+        }
+        if (pool_grow (t) < 0)
+            return FLUX_MATCHTAG_NONE;
+    }
+}
+
+uint32_t tagpool_alloc_range (struct tagpool *t, uint32_t count)
+{
+    assert (t->magic == TAGPOOL_MAGIC);
+    uint32_t tag;
+    uint32_t i;
+
+    if (count == 0 || count > t->avail)
+        return FLUX_MATCHTAG_NONE;
+    tag = find_range (t, count);
+    if (tag == FLUX_MATCHTAG_NONE)
+        return FLUX_MATCHTAG_NONE;
+    for (i = 0; i < count; i++)
+        vebdel (t->veb, tag + i);
+    t->avail -= count;
+    return tag;
+}
+
 void tagpool_free (struct tagpool *t, uint32_t tag)
 {
     assert (t->magic == TAGPOOL_MAGIC);
@@ -17,6 +17,11 @@
 struct tagpool *tagpool_create (void);
 void tagpool_destroy (struct tagpool *t);
 uint32_t tagpool_alloc (struct tagpool *t);
+
+/* Allocate 'count' consecutive tags and return the first one.
+ * Each tag is returned to the pool individually with tagpool_free().
+ */
+uint32_t tagpool_alloc_range (struct tagpool *t, uint32_t count);
 void tagpool_free (struct tagpool *t, uint32_t matchtag);
 
 typedef void (*tagpool_grow_f)(void *arg, uint32_t oldsize, uint32_t newsize);
@@ -357,6 +357,8 @@ void test_cloned_dispatch (flux_t *orig)
         "created reactor");
     ok (flux_set_reactor (h, r) == 0,
         "set reactor in cloned handle");
+    ok (flux_dispatch_set_budget (h, 1) == 0,
+        "set dispatch budget to 1 in cloned handle");
 
     /* event */
     ok ((mh = flux_msg_handler_create (h, FLUX_MATCH_EVENT, cb, NULL)) != NULL,
@@ -398,8 +400,8 @@ void test_cloned_dispatch (flux_t *orig)
     flux_msg_destroy (msg);
 
     /* N.B. libev NOWAIT semantics don't guarantee that all pending
-     * events are handled as only one loop is run.  The flux_t handle
-     * ensures that only one message is handled per loop, so we need to
+     * events are handled as only one loop is run.  With a dispatch
+     * budget of 1, only one message is handled per loop, so we need to
      * call it twice to handle the expected two messages.
      */
     cb_called = 0;
@@ -462,6 +464,228 @@ void test_cloned_dispatch (flux_t *orig)
     diag ("destroyed reactor, closed clone");
 }
 
+void count_cb (flux_t *h, flux_msg_handler_t *mh,
+               const flux_msg_t *msg, void *arg)
+{
+    int *count = arg;
+    (*count)++;
+}
+
+flux_msg_handler_t *victim;
+void destroy_victim_cb (flux_t *h, flux_msg_handler_t *mh,
+                        const flux_msg_t *msg, void *arg)
+{
+    int *count = arg;
+    (*count)++;
+    flux_msg_handler_destroy (victim);
+    victim = NULL;
+    flux_msg_handler_destroy (mh);
+}
+
+static flux_msg_handler_t *event_handler (flux_t *h,
+                                          int typemask,
+                                          const char *glob,
+                                          flux_msg_handler_f cb,
+                                          void *arg)
+{
+    struct flux_match match = FLUX_MATCH_EVENT;
+    flux_msg_handler_t *mh;
+
+    match.typemask = typemask;
+    match.topic_glob = (char *)glob;
+    if ((mh = flux_msg_handler_create (h, match, cb, arg)))
+        flux_msg_handler_start (mh);
+    return mh;
+}
+
+/* Check event delivery to handlers indexed by topic prefix, plus
+ * multi-type handlers on the handlers list.
+ */
+void test_event_index (flux_t *h)
+{
+    flux_reactor_t *r = flux_get_reactor (h);
+    flux_msg_handler_t *mh[6];
+    int count[6] = { 0 };
+    int killer_count = 0;
+    flux_msg_handler_t *killer;
+    flux_msg_t *msg;
+    int i;
+
+    mh[0] = event_handler (h, FLUX_MSGTYPE_EVENT, "foo.*", count_cb,
+                           &count[0]);
+    mh[1] = event_handler (h, FLUX_MSGTYPE_EVENT, "foo.bar", count_cb,
+                           &count[1]);
+    mh[2] = event_handler (h, FLUX_MSGTYPE_EVENT, "bar", count_cb,
+                           &count[2]);
+    mh[3] = event_handler (h, FLUX_MSGTYPE_EVENT | FLUX_MSGTYPE_REQUEST,
+                           "foo.bar", count_cb, &count[3]);
+    mh[4] = event_handler (h, FLUX_MSGTYPE_EVENT, NULL, count_cb,
+                           &count[4]);
+    mh[5] = event_handler (h, FLUX_MSGTYPE_EVENT, "[f]oo.bar", count_cb,
+                           &count[5]);
+    ok (mh[0] && mh[1] && mh[2] && mh[3] && mh[4] && mh[5],
+        "created event handlers");
+
+    ok ((msg = flux_event_encode ("foo.bar", NULL)) != NULL
+        && flux_send (h, msg, 0) == 0,
+        "sent foo.bar event");
+    flux_msg_destroy (msg);
+    ok (flux_reactor_run (r, FLUX_REACTOR_NOWAIT) >= 0,
+        "flux_reactor_run ran");
+    ok (count[0] == 1 && count[1] == 1 && count[2] == 0
+        && count[3] == 1 && count[4] == 1 && count[5] == 1,
+        "foo.bar was delivered to all matching handlers");
+
+    ok ((msg = flux_event_encode ("foo.baz", NULL)) != NULL
+        && flux_send (h, msg, 0) == 0,
+        "sent foo.baz event");
+    flux_msg_destroy (msg);
+    ok (flux_reactor_run (r, FLUX_REACTOR_NOWAIT) >= 0,
+        "flux_reactor_run ran");
+    ok (count[0] == 2 && count[1] == 1 && count[2] == 0
+        && count[3] == 1 && count[4] == 2 && count[5] == 1,
+        "foo.baz was delivered to glob and catch-all handlers only");
+
+    /* The newer handler runs first and destroys the older one
+     * before it would have been called.
+     */
+    victim = event_handler (h, FLUX_MSGTYPE_EVENT, "foo", count_cb,
+                            &count[2]);
+    killer = event_handler (h, FLUX_MSGTYPE_EVENT, "foo", destroy_victim_cb,
+                            &killer_count);
+    ok (victim != NULL && killer != NULL,
+        "created handler that destroys another handler");
+    ok ((msg = flux_event_encode ("foo", NULL)) != NULL
+        && flux_send (h, msg, 0) == 0,
+        "sent foo event");
+    flux_msg_destroy (msg);
+    ok (flux_reactor_run (r, FLUX_REACTOR_NOWAIT) >= 0,
+        "flux_reactor_run ran");
+    ok (killer_count == 1 && count[2] == 0 && victim == NULL,
+        "destroyed handler was not called");
+
+    for (i = 0; i < 6; i++)
+        flux_msg_handler_destroy (mh[i]);
+}
+
+int stop_called;
+void stop_cb (flux_t *h, flux_msg_handler_t *mh,
+              const flux_msg_t *msg, void *arg)
+{
+    stop_called++;
+    flux_reactor_stop (flux_get_reactor (h));
+}
+
+static int send_events (flux_t *h, int count)
+{
+    flux_msg_t *msg;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!(msg = flux_event_encode ("test", NULL)))
+            return -1;
+        if (flux_send (h, msg, 0) < 0) {
+            flux_msg_destroy (msg);
+            return -1;
+        }
+        flux_msg_destroy (msg);
+    }
+    return 0;
+}
+
+/* Check that up to 'budget' messages are handled per reactor loop
+ * and that the dispatch counters reflect it.
+ */
+void test_budget (flux_t *h)
+{
+    struct flux_dispatch_stats stats;
+    flux_msg_handler_t *mh;
+    int rc;
+
+    errno = 0;
+    ok (flux_dispatch_set_budget (NULL, 1) < 0 && errno == EINVAL,
+        "flux_dispatch_set_budget h=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_dispatch_set_budget (h, 0) < 0 && errno == EINVAL,
+        "flux_dispatch_set_budget budget=0 fails with EINVAL");
+    errno = 0;
+    ok (flux_dispatch_get_stats (NULL, &stats) < 0 && errno == EINVAL,
+        "flux_dispatch_get_stats h=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_dispatch_get_stats (h, NULL) < 0 && errno == EINVAL,
+        "flux_dispatch_get_stats stats=NULL fails with EINVAL");
+
+    ok ((mh = flux_msg_handler_create (h, FLUX_MATCH_EVENT, cb, NULL)) != NULL,
+        "created event handler");
+    flux_msg_handler_start (mh);
+    ok (flux_dispatch_get_stats (h, &stats) == 0
+        && stats.budget == FLUX_DISPATCH_BUDGET_DEFAULT,
+        "dispatch budget is FLUX_DISPATCH_BUDGET_DEFAULT by default");
+    ok (flux_dispatch_set_budget (h, 2) == 0,
+        "set dispatch budget to 2");
+    flux_dispatch_clear_stats (h);
+    ok (send_events (h, 5) == 0,
+        "sent 5 events");
+
+    cb_called = 0;
+    rc = flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_NOWAIT);
+    ok (rc >= 0 && cb_called == 2,
+        "two messages handled on first reactor loop");
+    ok (flux_dispatch_get_stats (h, &stats) == 0,
+        "flux_dispatch_get_stats works");
+    ok (stats.wakeups == 1
+        && stats.messages == 2
+        && stats.exhausted == 1
+        && stats.max_batch == 2
+        && stats.budget == 2
+        && stats.batch_hist[1] == 1,
+        "stats show one wakeup that exhausted the budget");
+
+    ok (flux_dispatch_set_budget (h, 16) == 0,
+        "set dispatch budget to 16");
+    rc = flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_NOWAIT);
+    ok (rc >= 0 && cb_called == 5,
+        "remaining three messages handled on second reactor loop");
+    ok (flux_dispatch_get_stats (h, &stats) == 0
+        && stats.wakeups == 2
+        && stats.messages == 5
+        && stats.exhausted == 1
+        && stats.max_batch == 3,
+        "stats show a second wakeup that drained the handle");
+    flux_dispatch_clear_stats (h);
+    ok (flux_dispatch_get_stats (h, &stats) == 0
+        && stats.wakeups == 0
+        && stats.messages == 0
+        && stats.budget == 16,
+        "flux_dispatch_clear_stats cleared counters but not budget");
+    flux_msg_handler_destroy (mh);
+
+    /* A handler that stops the reactor ends the batch early.
+     */
+    ok ((mh = flux_msg_handler_create (h,
+                                       FLUX_MATCH_EVENT,
+                                       stop_cb,
+                                       NULL)) != NULL,
+        "created event handler that stops the reactor");
+    flux_msg_handler_start (mh);
+    ok (send_events (h, 3) == 0,
+        "sent 3 events");
+    stop_called = 0;
+    rc = flux_reactor_run (flux_get_reactor (h), 0);
+    ok (rc >= 0 && stop_called == 1,
+        "reactor stopped after first message");
+    rc = flux_reactor_run (flux_get_reactor (h), 0);
+    ok (rc >= 0 && stop_called == 2,
+        "reactor stopped after second message");
+    rc = flux_reactor_run (flux_get_reactor (h), 0);
+    ok (rc >= 0 && stop_called == 3,
+        "reactor stopped after third message");
+    flux_msg_handler_destroy (mh);
+
+    ok (flux_dispatch_set_budget (h, FLUX_DISPATCH_BUDGET_DEFAULT) == 0,
+        "restored default dispatch budget");
+}
+
 int main (int argc, char *argv[])
 {
     flux_t *h;
@@ -481,6 +705,8 @@ int main (int argc, char *argv[])
     test_request_catchall (h);
     test_response_catchall (h);
     test_response_with_routes (h);
+    test_budget (h);
+    test_event_index (h);
 
     flux_close (h);
     done_testing();
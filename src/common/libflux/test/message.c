@@ -14,6 +14,7 @@
 #include <czmq.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <jansson.h>
 
 #include "src/common/libflux/message.h"
@@ -645,6 +646,93 @@ void check_cmp (void)
     flux_msg_destroy (msg);
 }
 
+/* Exercise buffer growth, which small messages created above avoid.
+ */
+void check_large (void)
+{
+    flux_msg_t *msg, *msg2;
+    char route[64];
+    char *big;
+    size_t bigsize = 100000;
+    const void *buf;
+    int size;
+    const char *topic;
+    char *s;
+    void *enc;
+    size_t encsize;
+    int i;
+
+    if (!(big = malloc (bigsize)))
+        BAIL_OUT ("out of memory");
+    memset (big, 'x', bigsize);
+
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_REQUEST)) != NULL
+        && flux_msg_set_topic (msg, "a.b") == 0
+        && flux_msg_set_payload (msg, big, bigsize) == 0,
+        "created message with large payload");
+    ok (flux_msg_get_payload (msg, &buf, &size) == 0
+        && size == bigsize && memcmp (buf, big, bigsize) == 0,
+        "flux_msg_get_payload returns large payload");
+    ok (flux_msg_enable_route (msg) == 0,
+        "flux_msg_enable_route works");
+    for (i = 0; i < 100; i++) {
+        snprintf (route, sizeof (route), "route-%d", i);
+        if (flux_msg_push_route (msg, route) < 0)
+            break;
+    }
+    ok (i == 100 && flux_msg_get_route_count (msg) == 100,
+        "pushed 100 routes");
+    ok (flux_msg_get_route_first (msg, &s) == 0 && s != NULL,
+        "flux_msg_get_route_first works");
+    like (s, "route-0",
+        "flux_msg_get_route_first returns first route");
+    free (s);
+    ok (flux_msg_set_topic (msg, "a.much.longer.topic.string") == 0
+        && flux_msg_get_topic (msg, &topic) == 0
+        && !strcmp (topic, "a.much.longer.topic.string"),
+        "flux_msg_set_topic can grow topic between routes and payload");
+    ok (flux_msg_get_payload (msg, &buf, &size) == 0
+        && size == bigsize && memcmp (buf, big, bigsize) == 0,
+        "payload is intact");
+    ok (flux_msg_get_topic (msg, &topic) == 0
+        && flux_msg_set_topic (msg, topic) == 0
+        && flux_msg_get_topic (msg, &topic) == 0
+        && !strcmp (topic, "a.much.longer.topic.string"),
+        "flux_msg_set_topic works with its own topic");
+    ok (flux_msg_frames (msg) == 104,
+        "flux_msg_frames returns 104");
+
+    encsize = flux_msg_encode_size (msg);
+    if (!(enc = malloc (encsize)))
+        BAIL_OUT ("out of memory");
+    ok (flux_msg_encode (msg, enc, encsize) == 0
+        && (msg2 = flux_msg_decode (enc, encsize)) != NULL,
+        "large message can be encoded and decoded");
+    ok (flux_msg_get_route_count (msg2) == 100
+        && flux_msg_get_payload (msg2, &buf, &size) == 0
+        && size == bigsize && memcmp (buf, big, bigsize) == 0,
+        "decoded message has routes and payload");
+    flux_msg_destroy (msg2);
+    errno = 0;
+    ok (flux_msg_decode (enc, encsize - 1) == NULL && errno == EINVAL,
+        "flux_msg_decode fails with EINVAL on truncated message");
+    free (enc);
+
+    ok ((msg2 = flux_msg_copy (msg, false)) != NULL
+        && flux_msg_has_payload (msg2) == false
+        && flux_msg_get_route_count (msg2) == 100,
+        "flux_msg_copy payload=false works on large message");
+    flux_msg_destroy (msg2);
+
+    ok (flux_msg_clear_route (msg) == 0
+        && flux_msg_set_payload (msg, NULL, 0) == 0
+        && flux_msg_frames (msg) == 2,
+        "clearing routes and payload leaves 2 frames");
+
+    flux_msg_destroy (msg);
+    free (big);
+}
+
 void check_encode (void)
 {
     flux_msg_t *msg, *msg2;
@@ -678,6 +766,121 @@ void check_encode (void)
     flux_msg_destroy (msg2);
 }
 
+/* Called from check_sendzsock() with zsys initialized.
+ */
+void check_sendzsock_route (void)
+{
+    zsock_t *router, *dealer;
+    zmsg_t *zmsg;
+    flux_msg_t *msg, *msg2;
+    const char *topic;
+    const char *s;
+    char *id;
+    const char *uri = "inproc://test_route";
+    char *big;
+    size_t bigsize = 100000;
+    const void *buf;
+    int size;
+    int i;
+
+    ok ((router = zsock_new_router (NULL)) != NULL
+                    && zsock_bind (router, "%s", uri) == 0
+                    && (dealer = zsock_new_dealer (NULL)) != NULL,
+        "got inproc router and dealer sockets");
+    zsock_set_identity (dealer, "child");
+    ok (zsock_connect (dealer, "%s", uri) == 0
+            && zstr_send (dealer, "hello") == 0
+            && (zmsg = zmsg_recv (router)) != NULL,
+        "router learned dealer identity");
+    zmsg_destroy (&zmsg);
+
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_EVENT)) != NULL
+            && flux_msg_set_topic (msg, "foo.bar") == 0
+            && flux_msg_set_string (msg, "payload") == 0,
+        "created test event");
+    errno = 0;
+    ok (flux_msg_sendzsock_route (NULL, msg, "child", false) < 0
+            && errno == EINVAL,
+        "flux_msg_sendzsock_route sock=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_msg_sendzsock_route (router, msg, NULL, false) < 0
+            && errno == EINVAL,
+        "flux_msg_sendzsock_route id=NULL fails with EINVAL");
+
+    ok (flux_msg_sendzsock_route (router, msg, "child", false) == 0,
+        "flux_msg_sendzsock_route works without route stack");
+    ok (flux_msg_get_route_count (msg) < 0,
+        "original message was not modified");
+    ok ((msg2 = flux_msg_recvzsock (dealer)) != NULL,
+        "flux_msg_recvzsock works");
+    ok (flux_msg_get_route_count (msg2) == 0
+            && flux_msg_get_topic (msg2, &topic) == 0
+            && !strcmp (topic, "foo.bar")
+            && flux_msg_get_string (msg2, &s) == 0
+            && !strcmp (s, "payload"),
+        "received message has empty route stack, topic, and payload");
+    flux_msg_destroy (msg2);
+
+    ok (flux_msg_enable_route (msg) == 0
+            && flux_msg_push_route (msg, "parent") == 0,
+        "pushed route onto test event");
+    ok (flux_msg_sendzsock_route (router, msg, "child", false) == 0,
+        "flux_msg_sendzsock_route works with route stack");
+    ok (flux_msg_get_route_count (msg) == 1,
+        "original message was not modified");
+    ok ((msg2 = flux_msg_recvzsock (dealer)) != NULL,
+        "flux_msg_recvzsock works");
+    id = NULL;
+    ok (flux_msg_get_route_count (msg2) == 1
+            && flux_msg_get_route_last (msg2, &id) == 0
+            && id != NULL && !strcmp (id, "parent")
+            && flux_msg_get_string (msg2, &s) == 0
+            && !strcmp (s, "payload"),
+        "received message has original route stack and payload");
+    free (id);
+    flux_msg_destroy (msg2);
+    flux_msg_destroy (msg);
+
+    /* A large payload is shared with zeromq rather than copied per peer.
+     */
+    if (!(big = malloc (bigsize)))
+        BAIL_OUT ("out of memory");
+    memset (big, 'y', bigsize);
+    ok ((msg = flux_msg_create (FLUX_MSGTYPE_EVENT)) != NULL
+            && flux_msg_set_topic (msg, "foo.big") == 0
+            && flux_msg_set_payload (msg, big, bigsize) == 0,
+        "created test event with large payload");
+    ok (flux_msg_sendzsock_route (router, msg, "child", false) == 0
+            && flux_msg_sendzsock_route (router, msg, "child", false) == 0,
+        "flux_msg_sendzsock_route works twice with large payload");
+    ok (flux_msg_get_payload (msg, &buf, &size) == 0
+            && size == bigsize && memcmp (buf, big, bigsize) == 0,
+        "original message payload is unchanged");
+    ok ((msg2 = flux_msg_copy (msg, true)) != NULL
+            && flux_msg_get_payload (msg2, &buf, &size) == 0
+            && size == bigsize && memcmp (buf, big, bigsize) == 0,
+        "flux_msg_copy of message with shared payload works");
+    flux_msg_destroy (msg2);
+    for (i = 0; i < 2; i++) {
+        ok ((msg2 = flux_msg_recvzsock (dealer)) != NULL
+                && flux_msg_get_topic (msg2, &topic) == 0
+                && !strcmp (topic, "foo.big")
+                && flux_msg_get_payload (msg2, &buf, &size) == 0
+                && size == bigsize && memcmp (buf, big, bigsize) == 0,
+            "received message %d has large payload", i);
+        ok (flux_msg_set_string (msg2, "small") == 0
+                && flux_msg_get_string (msg2, &s) == 0
+                && !strcmp (s, "small"),
+            "received payload can be replaced");
+        flux_msg_destroy (msg2);
+    }
+    flux_msg_destroy (msg);
+    free (big);
+
+    zsock_destroy (&dealer);
+    zsock_destroy (&router);
+}
+
 void check_sendzsock (void)
 {
     zsock_t *zsock[2] = { NULL, NULL };
@@ -733,6 +936,8 @@ void check_sendzsock (void)
     zsock_destroy (&zsock[0]);
     zsock_destroy (&zsock[1]);
 
+    check_sendzsock_route ();
+
     /* zsys boiler plate - see note above
      */
     zsys_shutdown();
@@ -918,6 +1123,14 @@ void check_flags (void)
     ok (flux_msg_is_noresponse (msg) == true,
         "flux_msg_is_noresponse = true");
 
+    /* FLUX_MSGFLAG_USER1 */
+    ok (flux_msg_is_user1 (msg) == false,
+        "flux_msg_is_user1 = false");
+    ok (flux_msg_set_user1 (msg) == 0,
+        "flux_msg_set_user1 works");
+    ok (flux_msg_is_user1 (msg) == true,
+        "flux_msg_is_user1 = true");
+
     /* noresponse and streaming are mutually exclusive */
     ok (flux_msg_set_streaming (msg) == 0
         && flux_msg_set_noresponse (msg) == 0
@@ -1013,6 +1226,59 @@ void check_refcount (void)
         "flux_msg_destroy msg=NULL doesnt crash crash");
 }
 
+void check_pool (void)
+{
+    struct flux_msg_pool_stats stats;
+    flux_msg_t *msg;
+    flux_msg_t *msg2;
+    char payload[4000];
+    const void *buf;
+    int size;
+    const char *topic;
+
+    errno = 0;
+    ok (flux_msg_pool_get_stats (NULL) < 0 && errno == EINVAL,
+        "flux_msg_pool_get_stats stats=NULL fails with EINVAL");
+
+    /* Ensure pool holds at least one message and one 4K buffer.
+     */
+    memset (payload, 'x', sizeof (payload));
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_REQUEST))
+        || flux_msg_set_payload (msg, payload, sizeof (payload)) < 0)
+        BAIL_OUT ("failed to create test message");
+    flux_msg_destroy (msg);
+
+    flux_msg_pool_clear_stats ();
+    ok (flux_msg_pool_get_stats (&stats) == 0
+        && stats.msg_hits == 0 && stats.msg_misses == 0
+        && stats.buf_hits == 0 && stats.buf_misses == 0,
+        "flux_msg_pool_clear_stats zeroes counters");
+    ok (stats.msg_cached > 0 && stats.buf_cached > 0,
+        "pool holds a destroyed message and its buffer");
+
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_EVENT)))
+        BAIL_OUT ("failed to create test message");
+    ok (flux_msg_pool_get_stats (&stats) == 0 && stats.msg_hits == 1,
+        "flux_msg_create reused a pooled message");
+    ok (flux_msg_get_topic (msg, &topic) < 0 && errno == EPROTO
+        && flux_msg_has_payload (msg) == false
+        && flux_msg_get_route_count (msg) < 0,
+        "reused message has no topic, payload, or routes");
+    ok (flux_msg_set_payload (msg, payload, sizeof (payload)) == 0
+        && flux_msg_pool_get_stats (&stats) == 0 && stats.buf_hits == 1,
+        "large payload reused a pooled buffer");
+    ok (flux_msg_get_payload (msg, &buf, &size) == 0
+        && size == sizeof (payload) && !memcmp (buf, payload, size),
+        "payload is intact");
+    ok ((msg2 = flux_msg_copy (msg, true)) != NULL,
+        "flux_msg_copy works");
+    ok (flux_msg_get_payload (msg2, &buf, &size) == 0
+        && size == sizeof (payload) && !memcmp (buf, payload, size),
+        "copy payload is intact");
+    flux_msg_destroy (msg);
+    flux_msg_destroy (msg2);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -1031,6 +1297,7 @@ int main (int argc, char *argv[])
 
     check_cmp ();
 
+    check_large ();
     check_encode ();
     check_sendzsock ();
 
@@ -1038,6 +1305,8 @@ int main (int argc, char *argv[])
 
     check_refcount();
 
+    check_pool ();
+
     //check_print ();
 
     done_testing();
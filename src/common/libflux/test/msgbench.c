@@ -0,0 +1,214 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* msgbench.c - compare flux_msg_t with an equivalent czmq zmsg_t
+ *
+ * Usage: msgbench [iterations] [payload-size]
+ *
+ * For each representation, time message create (type, topic, payload),
+ * copy, and encode + decode.  The zmsg_t variants do what flux_msg_t
+ * did when it was a list of zeromq frames.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <czmq.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "src/common/libflux/message.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/log.h"
+
+static const char *topic = "kvs.lookup";
+static uint8_t proto[20] = { 0x8e, 0x01, 0x01, 0x01 };
+
+static zmsg_t *zmsg_create (const void *payload, size_t size)
+{
+    zmsg_t *zmsg;
+
+    if (!(zmsg = zmsg_new ())
+        || zmsg_addmem (zmsg, topic, strlen (topic) + 1) < 0
+        || zmsg_addmem (zmsg, payload, size) < 0
+        || zmsg_addmem (zmsg, proto, sizeof (proto)) < 0)
+        log_msg_exit ("zmsg_create");
+    return zmsg;
+}
+
+static size_t zmsg_encode_size (zmsg_t *zmsg)
+{
+    zframe_t *zf;
+    size_t size = 0;
+
+    zf = zmsg_first (zmsg);
+    while (zf) {
+        size += (zframe_size (zf) < 0xff ? 1 : 1 + 4) + zframe_size (zf);
+        zf = zmsg_next (zmsg);
+    }
+    return size;
+}
+
+static void zmsg_encode_buf (zmsg_t *zmsg, uint8_t *p)
+{
+    zframe_t *zf;
+
+    zf = zmsg_first (zmsg);
+    while (zf) {
+        size_t n = zframe_size (zf);
+        if (n < 0xff)
+            *p++ = (uint8_t)n;
+        else {
+            uint32_t x = htonl (n);
+            *p++ = 0xff;
+            memcpy (p, &x, sizeof (x));
+            p += sizeof (x);
+        }
+        memcpy (p, zframe_data (zf), n);
+        p += n;
+        zf = zmsg_next (zmsg);
+    }
+}
+
+static zmsg_t *zmsg_decode_buf (const uint8_t *buf, size_t size)
+{
+    const uint8_t *p = buf;
+    zmsg_t *zmsg;
+    zframe_t *zf;
+
+    if (!(zmsg = zmsg_new ()))
+        log_msg_exit ("zmsg_new");
+    while (p - buf < size) {
+        size_t n = *p++;
+        if (n == 0xff) {
+            uint32_t x;
+            memcpy (&x, p, sizeof (x));
+            n = ntohl (x);
+            p += sizeof (x);
+        }
+        if (!(zf = zframe_new (p, n)) || zmsg_append (zmsg, &zf) < 0)
+            log_msg_exit ("zmsg_decode_buf");
+        p += n;
+    }
+    return zmsg;
+}
+
+static flux_msg_t *msg_create (const void *payload, size_t size)
+{
+    flux_msg_t *msg;
+
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_REQUEST))
+        || flux_msg_set_topic (msg, topic) < 0
+        || flux_msg_set_payload (msg, payload, size) < 0)
+        log_msg_exit ("msg_create");
+    return msg;
+}
+
+static void report (const char *name, int iter, struct timespec t0)
+{
+    double ms = monotime_since (t0);
+
+    printf ("%-24s %10.0f ops/s %8.3f us/op\n",
+            name,
+            iter / (ms / 1000),
+            ms * 1000 / iter);
+}
+
+int main (int argc, char *argv[])
+{
+    int iter = 1000000;
+    size_t size = 64;
+    char *payload;
+    uint8_t *buf;
+    struct timespec t0;
+    flux_msg_t *msg;
+    zmsg_t *zmsg;
+    int i;
+
+    log_init ("msgbench");
+    if (argc > 1)
+        iter = strtoul (argv[1], NULL, 10);
+    if (argc > 2)
+        size = strtoul (argv[2], NULL, 10);
+    if (iter <= 0 || argc > 3)
+        log_msg_exit ("Usage: msgbench [iterations] [payload-size]");
+    if (!(payload = malloc (size)) || !(buf = malloc (size + 1024)))
+        log_msg_exit ("out of memory");
+    memset (payload, 'x', size);
+
+    printf ("%d iterations, %zu byte payload\n", iter, size);
+
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        msg = msg_create (payload, size);
+        flux_msg_destroy (msg);
+    }
+    report ("flux_msg create", iter, t0);
+
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        zmsg = zmsg_create (payload, size);
+        zmsg_destroy (&zmsg);
+    }
+    report ("zmsg create", iter, t0);
+
+    msg = msg_create (payload, size);
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        flux_msg_t *cpy;
+        if (!(cpy = flux_msg_copy (msg, true)))
+            log_msg_exit ("flux_msg_copy");
+        flux_msg_destroy (cpy);
+    }
+    report ("flux_msg copy", iter, t0);
+
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        flux_msg_t *cpy;
+        size_t n = flux_msg_encode_size (msg);
+        if (flux_msg_encode (msg, buf, n) < 0
+            || !(cpy = flux_msg_decode (buf, n)))
+            log_msg_exit ("flux_msg_encode/decode");
+        flux_msg_destroy (cpy);
+    }
+    report ("flux_msg encode+decode", iter, t0);
+    flux_msg_destroy (msg);
+
+    zmsg = zmsg_create (payload, size);
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        zmsg_t *cpy;
+        if (!(cpy = zmsg_dup (zmsg)))
+            log_msg_exit ("zmsg_dup");
+        zmsg_destroy (&cpy);
+    }
+    report ("zmsg copy", iter, t0);
+
+    monotime (&t0);
+    for (i = 0; i < iter; i++) {
+        zmsg_t *cpy;
+        size_t n = zmsg_encode_size (zmsg);
+        zmsg_encode_buf (zmsg, buf);
+        cpy = zmsg_decode_buf (buf, n);
+        zmsg_destroy (&cpy);
+    }
+    report ("zmsg encode+decode", iter, t0);
+    zmsg_destroy (&zmsg);
+
+    free (buf);
+    free (payload);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 
 #include "src/common/libflux/reactor.h"
+#include "src/common/libflux/reactor_private.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/fdutils.h"
 #include "src/common/libtap/tap.h"
@@ -1442,6 +1443,142 @@ static void reactor_destroy_early (void)
     flux_watcher_destroy (w);
 }
 
+static int stats_timer_count = 0;
+static void stats_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
+{
+    if (++stats_timer_count == 4)
+        flux_watcher_stop (w);
+}
+
+static void stats_idle_cb (flux_reactor_t *r, flux_watcher_t *w,
+                           int revents, void *arg)
+{
+    uint64_t t0 = flux_reactor_stats_start ();
+    flux_reactor_stats_record_topic (r, "a.b", t0);
+    flux_watcher_stop (w);
+}
+
+struct stats_seen {
+    int loop;
+    int timer;
+    int idle;
+    int topic;
+    int other;
+    bool ordered;
+};
+
+static int stats_cb (const struct flux_reactor_stat *st, void *arg)
+{
+    struct stats_seen *seen = arg;
+
+    if (st->count == 0 || st->min > st->max || st->p50 > st->p99
+                       || st->p99 > st->max)
+        seen->ordered = false;
+    if (st->kind == FLUX_REACTOR_STAT_LOOP && !strcmp (st->name, "loop"))
+        seen->loop += st->count;
+    else if (st->kind == FLUX_REACTOR_STAT_WATCHER
+             && !strcmp (st->name, "timer"))
+        seen->timer += st->count;
+    else if (st->kind == FLUX_REACTOR_STAT_WATCHER
+             && !strcmp (st->name, "idle"))
+        seen->idle += st->count;
+    else if (st->kind == FLUX_REACTOR_STAT_TOPIC && !strcmp (st->name, "a.b"))
+        seen->topic += st->count;
+    else
+        seen->other++;
+    return 0;
+}
+
+static int stats_fail_cb (const struct flux_reactor_stat *st, void *arg)
+{
+    int *count = arg;
+    (*count)++;
+    return -1;
+}
+
+static void test_stats (void)
+{
+    flux_reactor_t *r;
+    flux_watcher_t *timer;
+    flux_watcher_t *idle;
+    struct stats_seen seen = { .ordered = true };
+    int count;
+
+    if (!(r = flux_reactor_create (0)))
+        BAIL_OUT ("flux_reactor_create failed");
+    ok (flux_reactor_stats_enabled (r) == false,
+        "reactor instrumentation is disabled by default");
+    ok (flux_reactor_stats_enable (r, true) == 0
+        && flux_reactor_stats_enabled (r) == true,
+        "flux_reactor_stats_enable works");
+    ok (flux_reactor_stats_enable (r, true) == 0,
+        "flux_reactor_stats_enable works when already enabled");
+    ok (flux_reactor_run (r, 0) == 0,
+        "reactor with instrumentation and no watchers runs to completion");
+
+    timer = flux_timer_watcher_create (r, 0.001, 0.001, stats_timer_cb, NULL);
+    idle = flux_idle_watcher_create (r, stats_idle_cb, NULL);
+    if (!timer || !idle)
+        BAIL_OUT ("error creating watchers");
+    flux_watcher_start (timer);
+    flux_watcher_start (idle);
+    ok (flux_reactor_run (r, 0) == 0,
+        "reactor ran successfully");
+    ok (flux_reactor_stats_foreach (r, stats_cb, &seen) == 0,
+        "flux_reactor_stats_foreach works");
+    diag ("loop=%d timer=%d idle=%d topic=%d other=%d",
+          seen.loop, seen.timer, seen.idle, seen.topic, seen.other);
+    ok (seen.timer == 4 && seen.idle == 1,
+        "watcher callbacks were counted by type");
+    ok (seen.topic == 1,
+        "topic was recorded");
+    ok (seen.loop >= 4,
+        "loop iterations were counted");
+    ok (seen.other == 0,
+        "no unexpected histograms were reported");
+    ok (seen.ordered == true,
+        "reported statistics are consistent");
+
+    count = 0;
+    errno = 0;
+    ok (flux_reactor_stats_foreach (r, stats_fail_cb, &count) < 0
+        && count == 1,
+        "flux_reactor_stats_foreach stops when callback fails");
+
+    flux_reactor_stats_clear (r);
+    memset (&seen, 0, sizeof (seen));
+    ok (flux_reactor_stats_foreach (r, stats_cb, &seen) == 0
+        && seen.loop == 0 && seen.timer == 0 && seen.topic == 0,
+        "flux_reactor_stats_clear clears all histograms");
+
+    ok (flux_reactor_stats_enable (r, false) == 0
+        && flux_reactor_stats_enabled (r) == false,
+        "flux_reactor_stats_enable (false) works");
+    flux_watcher_start (idle);
+    ok (flux_reactor_run (r, 0) == 0,
+        "reactor runs with instrumentation disabled");
+    count = 0;
+    ok (flux_reactor_stats_foreach (r, stats_fail_cb, &count) == 0
+        && count == 0,
+        "flux_reactor_stats_foreach reports nothing when disabled");
+
+    errno = 0;
+    ok (flux_reactor_stats_enable (NULL, true) < 0 && errno == EINVAL,
+        "flux_reactor_stats_enable r=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_reactor_stats_foreach (r, NULL, NULL) < 0 && errno == EINVAL,
+        "flux_reactor_stats_foreach fn=NULL fails with EINVAL");
+
+    /* Leave instrumentation on at destroy to check cleanup.
+     */
+    ok (flux_reactor_stats_enable (r, true) == 0,
+        "flux_reactor_stats_enable works again");
+    flux_watcher_destroy (timer);
+    flux_watcher_destroy (idle);
+    flux_reactor_destroy (r);
+}
+
 int main (int argc, char *argv[])
 {
     flux_reactor_t *reactor;
@@ -1471,6 +1608,8 @@ int main (int argc, char *argv[])
 
     flux_reactor_destroy (reactor);
 
+    test_stats ();
+
     lives_ok ({ reactor_destroy_early ();},
         "destroying reactor then watcher doesn't segfault");
 
@@ -0,0 +1,222 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* reactorbench.c - measure reactor callback dispatch
+ *
+ * Usage: reactorbench [iterations]
+ *
+ * Time idle, zero-timeout timer, and fd watcher callbacks and message
+ * handler dispatch over a loopback handle, first with reactor
+ * instrumentation disabled, then enabled.  The difference is the cost
+ * of instrumentation.  The recorded latency histograms are printed last.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libtestutil/util.h"
+
+/* libev never polls for less than 1ms when a timer is pending, so a
+ * single zero-timeout timer measures that floor rather than dispatch.
+ * Arm enough timers that each loop iteration dispatches many of them.
+ */
+#define NTIMERS 1000
+
+static int iter = 1000000;
+static int count;
+
+static void report (const char *name, bool stats, struct timespec t0)
+{
+    double ms = monotime_since (t0);
+    char label[64];
+
+    snprintf (label, sizeof (label), "%s%s", name, stats ? " (stats)" : "");
+    printf ("%-28s %10.0f ops/s %8.3f us/op\n",
+            label,
+            iter / (ms / 1000),
+            ms * 1000 / iter);
+}
+
+static void idle_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    if (++count == iter)
+        flux_watcher_stop (w);
+}
+
+static void timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                      int revents, void *arg)
+{
+    if (count++ < iter - NTIMERS) {
+        flux_timer_watcher_reset (w, 0., 0.);
+        flux_watcher_start (w);
+    }
+}
+
+/* The pipe is never drained, so the watcher fires on every iteration.
+ */
+static void fd_cb (flux_reactor_t *r, flux_watcher_t *w,
+                   int revents, void *arg)
+{
+    if (++count == iter)
+        flux_watcher_stop (w);
+}
+
+static void ping_cb (flux_t *h, flux_msg_handler_t *mh,
+                     const flux_msg_t *msg, void *arg)
+{
+    if (++count == iter) {
+        flux_reactor_stop (flux_get_reactor (h));
+        return;
+    }
+    if (flux_send (h, msg, 0) < 0)
+        log_err_exit ("flux_send");
+}
+
+static void run (flux_reactor_t *r, flux_watcher_t *w, const char *name)
+{
+    struct timespec t0;
+
+    count = 0;
+    monotime (&t0);
+    flux_watcher_start (w);
+    if (flux_reactor_run (r, 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    report (name, flux_reactor_stats_enabled (r), t0);
+    flux_watcher_destroy (w);
+}
+
+static void bench_timer (flux_reactor_t *r)
+{
+    flux_watcher_t *w[NTIMERS];
+    struct timespec t0;
+    int i;
+
+    for (i = 0; i < NTIMERS; i++) {
+        if (!(w[i] = flux_timer_watcher_create (r, 0., 0., timer_cb, NULL)))
+            log_err_exit ("flux_timer_watcher_create");
+    }
+    count = 0;
+    monotime (&t0);
+    for (i = 0; i < NTIMERS; i++)
+        flux_watcher_start (w[i]);
+    if (flux_reactor_run (r, 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    report ("timer watcher", flux_reactor_stats_enabled (r), t0);
+    for (i = 0; i < NTIMERS; i++)
+        flux_watcher_destroy (w[i]);
+}
+
+static void bench (flux_reactor_t *r, int fd)
+{
+    flux_watcher_t *w;
+
+    if (!(w = flux_idle_watcher_create (r, idle_cb, NULL)))
+        log_err_exit ("flux_idle_watcher_create");
+    run (r, w, "idle watcher");
+
+    bench_timer (r);
+
+    if (!(w = flux_fd_watcher_create (r, fd, FLUX_POLLIN, fd_cb, NULL)))
+        log_err_exit ("flux_fd_watcher_create");
+    run (r, w, "fd watcher");
+}
+
+static void bench_msg (flux_t *h)
+{
+    flux_reactor_t *r = flux_get_reactor (h);
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    flux_msg_handler_t *mh;
+    flux_msg_t *msg;
+    struct timespec t0;
+
+    match.topic_glob = "bench.ping";
+    if (!(mh = flux_msg_handler_create (h, match, ping_cb, NULL)))
+        log_err_exit ("flux_msg_handler_create");
+    flux_msg_handler_start (mh);
+    if (!(msg = flux_request_encode ("bench.ping", NULL)))
+        log_err_exit ("flux_request_encode");
+
+    count = 0;
+    monotime (&t0);
+    if (flux_send (h, msg, 0) < 0)
+        log_err_exit ("flux_send");
+    if (flux_reactor_run (r, 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    report ("message handler", flux_reactor_stats_enabled (r), t0);
+
+    flux_msg_destroy (msg);
+    flux_msg_handler_destroy (mh);
+}
+
+static int print_stat (const struct flux_reactor_stat *stat, void *arg)
+{
+    printf ("%-28s %10ju %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+            stat->name,
+            (uintmax_t)stat->count,
+            stat->min * 1E6,
+            stat->mean * 1E6,
+            stat->p50 * 1E6,
+            stat->p99 * 1E6,
+            stat->max * 1E6);
+    return 0;
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h;
+    flux_reactor_t *r;
+    int pfd[2];
+
+    log_init ("reactorbench");
+    if (argc > 1)
+        iter = strtoul (argv[1], NULL, 10);
+    if (iter < NTIMERS || argc > 2)
+        log_msg_exit ("Usage: reactorbench [iterations]");
+    if (!(h = loopback_create (0)))
+        log_err_exit ("loopback_create");
+    if (!(r = flux_get_reactor (h)))
+        log_err_exit ("flux_get_reactor");
+    if (pipe (pfd) < 0 || write (pfd[1], "x", 1) != 1)
+        log_err_exit ("pipe");
+
+    printf ("%d iterations\n", iter);
+
+    if (flux_reactor_stats_enable (r, false) < 0)
+        log_err_exit ("flux_reactor_stats_enable");
+    bench (r, pfd[0]);
+    bench_msg (h);
+
+    if (flux_reactor_stats_enable (r, true) < 0)
+        log_err_exit ("flux_reactor_stats_enable");
+    bench (r, pfd[0]);
+    bench_msg (h);
+
+    printf ("\n%-28s %10s %9s %9s %9s %9s %9s\n",
+            "latency (us)", "count", "min", "mean", "p50", "p99", "max");
+    if (flux_reactor_stats_foreach (r, print_stat, NULL) < 0)
+        log_err_exit ("flux_reactor_stats_foreach");
+
+    close (pfd[0]);
+    close (pfd[1]);
+    flux_close (h);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
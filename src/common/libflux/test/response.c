@@ -132,6 +132,16 @@ int main (int argc, char *argv[])
     ok (flux_response_derive (NULL, 0) == NULL && errno == EINVAL,
         "flux_response_derive msg=NULL fails with EINVAL");
 
+    /* response_derive does not copy user1 flag */
+    msg = flux_request_encode ("foo", NULL);
+    if (!msg || flux_msg_set_user1 (msg) < 0)
+        BAIL_OUT ("flux_request_encode failed");
+    flux_msg_t *rmsg = flux_response_derive (msg, 0);
+    ok (rmsg != NULL && flux_msg_is_user1 (rmsg) == false,
+        "flux_response_derive does not copy user1 flag from request");
+    flux_msg_destroy (rmsg);
+    flux_msg_destroy (msg);
+
     /* respond with h=NULL */
     msg = flux_request_encode ("foo", NULL);
     if (!msg)
@@ -807,6 +807,143 @@ static int fake_server_reactor (flux_t *h, void *arg)
     return flux_reactor_run (flux_get_reactor (h), 0);
 }
 
+static void batch_then_cb (flux_future_t *f, void *arg)
+{
+    int *count = arg;
+    (*count)++;
+    flux_reactor_stop (flux_future_get_reactor (f));
+}
+
+void test_batch (flux_t *h)
+{
+    flux_future_t *f;
+    const char *s;
+    const char *errstr;
+    int i, n, index;
+    int errors;
+    int count;
+    uint32_t avail;
+
+    avail = flux_matchtag_avail (h);
+    ok ((f = flux_rpc_batch_create (h, 0)) != NULL,
+        "flux_rpc_batch_create works");
+    errors = 0;
+    for (i = 0; i < 100; i++) {
+        if (i == 50)
+            index = flux_rpc_batch_add_pack (f, "rpctest.echoerr",
+                                             FLUX_NODEID_ANY,
+                                             "{s:i s:s}",
+                                             "errnum", ENOTDIR,
+                                             "errstr", "Hello world");
+        else
+            index = flux_rpc_batch_add_pack (f, "rpctest.incr",
+                                             FLUX_NODEID_ANY,
+                                             "{s:i}", "n", i);
+        if (index != i)
+            errors++;
+    }
+    ok (errors == 0,
+        "flux_rpc_batch_add_pack returned consecutive indices");
+    ok (flux_rpc_batch_count (f) == 100,
+        "flux_rpc_batch_count returns 100");
+    ok (flux_matchtag_avail (h) == avail,
+        "no matchtags are allocated before send");
+    ok (flux_rpc_batch_send (f) == 0,
+        "flux_rpc_batch_send works");
+    ok (flux_matchtag_avail (h) == avail - 100,
+        "100 matchtags were allocated");
+    errno = 0;
+    ok (flux_rpc_batch_send (f) < 0 && errno == EINVAL,
+        "flux_rpc_batch_send fails with EINVAL the second time");
+    errno = 0;
+    ok (flux_rpc_batch_add (f, "rpctest.hello", NULL, FLUX_NODEID_ANY) < 0
+        && errno == EINVAL,
+        "flux_rpc_batch_add fails with EINVAL after send");
+    count = 0;
+    ok (flux_future_then (f, -1., batch_then_cb, &count) == 0,
+        "flux_future_then works");
+    ok (flux_reactor_run (flux_get_reactor (h), 0) >= 0 && count == 1,
+        "continuation was called once for the whole batch");
+    errors = 0;
+    for (i = 0; i < 100; i++) {
+        if (i == 50)
+            continue;
+        if (flux_rpc_batch_get_unpack (f, i, "{s:i}", "n", &n) < 0
+            || n != i + 1)
+            errors++;
+    }
+    ok (errors == 0,
+        "flux_rpc_batch_get_unpack got expected responses");
+    errno = 0;
+    ok (flux_rpc_batch_get (f, 50, &s) < 0 && errno == ENOTDIR,
+        "flux_rpc_batch_get of error response fails with its errno");
+    errstr = flux_rpc_batch_error_string (f, 50);
+    ok (errstr != NULL && !strcmp (errstr, "Hello world"),
+        "flux_rpc_batch_error_string returns its error string");
+    errno = 0;
+    ok (flux_rpc_batch_get (f, 100, &s) < 0 && errno == EINVAL,
+        "flux_rpc_batch_get index=count fails with EINVAL");
+    flux_future_destroy (f);
+    ok (flux_matchtag_avail (h) == avail,
+        "matchtags were returned to the pool");
+
+    /* Synchronous, mixed with a regular RPC.
+     */
+    flux_future_t *r;
+    const void *d;
+    int l;
+
+    ok ((r = flux_rpc (h, "rpctest.echo", "{}", FLUX_NODEID_ANY, 0)) != NULL,
+        "flux_rpc works");
+    if (!(f = flux_rpc_batch_create (h, 0)))
+        BAIL_OUT ("flux_rpc_batch_create failed");
+    ok (flux_rpc_batch_add (f, "rpctest.hello", NULL, FLUX_NODEID_ANY) == 0
+        && flux_rpc_batch_add (f, "rpctest.echo", "{\"a\":1}",
+                               FLUX_NODEID_ANY) == 1
+        && flux_rpc_batch_add_raw (f, "rpctest.rawecho", "xyz", 3,
+                                   FLUX_NODEID_ANY) == 2,
+        "added three requests to batch");
+    ok (flux_rpc_batch_send (f) == 0,
+        "flux_rpc_batch_send works");
+    ok (flux_rpc_batch_get (f, 0, &s) == 0 && s == NULL,
+        "flux_rpc_batch_get index=0 got empty response");
+    ok (flux_rpc_batch_get (f, 1, &s) == 0 && !strcmp (s, "{\"a\":1}"),
+        "flux_rpc_batch_get index=1 got expected payload");
+    ok (flux_rpc_batch_get_raw (f, 2, &d, &l) == 0
+        && l == 3 && !memcmp (d, "xyz", 3),
+        "flux_rpc_batch_get_raw index=2 got expected payload");
+    ok (flux_rpc_get (r, &s) == 0 && !strcmp (s, "{}"),
+        "regular RPC got its response");
+    flux_future_destroy (r);
+    flux_future_destroy (f);
+
+    /* Empty batch.
+     */
+    if (!(f = flux_rpc_batch_create (h, 0)))
+        BAIL_OUT ("flux_rpc_batch_create failed");
+    ok (flux_rpc_batch_send (f) == 0 && flux_future_get (f, NULL) == 0,
+        "empty batch is fulfilled immediately");
+    flux_future_destroy (f);
+
+    errno = 0;
+    ok (flux_rpc_batch_create (h, FLUX_RPC_STREAMING) == NULL
+        && errno == EINVAL,
+        "flux_rpc_batch_create flags=FLUX_RPC_STREAMING fails with EINVAL");
+    errno = 0;
+    ok (flux_rpc_batch_create (NULL, 0) == NULL && errno == EINVAL,
+        "flux_rpc_batch_create h=NULL fails with EINVAL");
+    if (!(r = flux_rpc (h, "rpctest.hello", NULL, FLUX_NODEID_ANY, 0)))
+        BAIL_OUT ("flux_rpc failed");
+    errno = 0;
+    ok (flux_rpc_batch_send (r) < 0 && errno == EINVAL,
+        "flux_rpc_batch_send on regular RPC future fails with EINVAL");
+    ok (flux_rpc_get (r, NULL) == 0,
+        "regular RPC still works");
+    flux_future_destroy (r);
+
+    diag ("completed batch rpc test");
+}
+
 void test_fake_server (void)
 {
     flux_t *h;
@@ -862,6 +999,7 @@ int main (int argc, char *argv[])
     test_multi_response_then_chain (h);
     test_rpc_message_inval (h);
     test_rpc_message (h);
+    test_batch (h);
 
     ok (test_server_stop (h) == 0,
         "stopped test server thread");
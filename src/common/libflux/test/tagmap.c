@@ -0,0 +1,155 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "src/common/libflux/tagmap.h"
+#include "src/common/libtap/tap.h"
+
+static int a, b, c;
+
+void test_basic (void)
+{
+    struct tagmap *map;
+
+    ok ((map = tagmap_create ()) != NULL,
+        "tagmap_create works");
+    ok (tagmap_lookup (map, 1) == NULL,
+        "tagmap_lookup on empty map returns NULL");
+    ok (tagmap_insert (map, 1, 1, &a) == 0,
+        "tagmap_insert 1 works");
+    ok (tagmap_insert (map, 2, 1, &b) == 0,
+        "tagmap_insert 2 works");
+    ok (tagmap_lookup (map, 1) == &a && tagmap_lookup (map, 2) == &b,
+        "tagmap_lookup finds both items");
+    ok (tagmap_lookup (map, 3) == NULL,
+        "tagmap_lookup of unmapped tag returns NULL");
+    errno = 0;
+    ok (tagmap_insert (map, 1, 1, &c) < 0 && errno == EEXIST,
+        "tagmap_insert of mapped tag fails with EEXIST");
+    ok (tagmap_lookup (map, 1) == &a,
+        "original item is still mapped");
+    tagmap_delete (map, 1, 1);
+    ok (tagmap_lookup (map, 1) == NULL && tagmap_lookup (map, 2) == &b,
+        "tagmap_delete removes only the deleted tag");
+    ok (tagmap_insert (map, 1, 1, &c) == 0 && tagmap_lookup (map, 1) == &c,
+        "tagmap_insert of deleted tag works");
+    lives_ok ({tagmap_delete (map, 1000000, 1);},
+        "tagmap_delete of tag beyond the map doesn't crash");
+    tagmap_destroy (map);
+}
+
+void test_range (void)
+{
+    struct tagmap *map;
+    int errors = 0;
+    uint32_t i;
+
+    if (!(map = tagmap_create ()))
+        BAIL_OUT ("tagmap_create failed");
+    ok (tagmap_insert (map, 250, 10, &a) == 0,
+        "tagmap_insert range spanning a page boundary works");
+    for (i = 250; i < 260; i++) {
+        if (tagmap_lookup (map, i) != &a)
+            errors++;
+    }
+    ok (errors == 0 && tagmap_lookup (map, 249) == NULL
+        && tagmap_lookup (map, 260) == NULL,
+        "tagmap_lookup finds each tag in the range and no others");
+    ok (tagmap_insert (map, 259, 1, &b) < 0 && errno == EEXIST,
+        "tagmap_insert of tag inside range fails with EEXIST");
+    ok (tagmap_insert (map, 240, 11, &b) < 0 && errno == EEXIST,
+        "tagmap_insert of overlapping range fails with EEXIST");
+    ok (tagmap_lookup (map, 240) == NULL,
+        "failed tagmap_insert left the map unchanged");
+    tagmap_delete (map, 250, 10);
+    ok (tagmap_lookup (map, 250) == NULL && tagmap_lookup (map, 259) == NULL,
+        "tagmap_delete removes the range");
+    tagmap_destroy (map);
+}
+
+void test_grow (void)
+{
+    struct tagmap *map;
+    int errors = 0;
+    uint32_t i;
+
+    if (!(map = tagmap_create ()))
+        BAIL_OUT ("tagmap_create failed");
+    ok (tagmap_reserve (map, 1024) == 0,
+        "tagmap_reserve works");
+    for (i = 1; i < 100000; i++) {
+        if (tagmap_insert (map, i, 1, (void *)(uintptr_t)i) < 0)
+            errors++;
+    }
+    ok (errors == 0,
+        "tagmap_insert of 100000 tags works");
+    for (i = 1; i < 100000; i++) {
+        if (tagmap_lookup (map, i) != (void *)(uintptr_t)i)
+            errors++;
+    }
+    ok (errors == 0,
+        "tagmap_lookup finds all of them");
+    ok (tagmap_insert (map, (1U << 20) - 1, 1, &a) == 0
+        && tagmap_lookup (map, (1U << 20) - 1) == &a,
+        "tagmap_insert of largest tagpool tag works");
+    ok (tagmap_reserve (map, 16) == 0
+        && tagmap_lookup (map, 99999) == (void *)(uintptr_t)99999,
+        "tagmap_reserve to a smaller size does not shrink the map");
+    tagmap_destroy (map);
+}
+
+void test_invalid (void)
+{
+    struct tagmap *map;
+
+    if (!(map = tagmap_create ()))
+        BAIL_OUT ("tagmap_create failed");
+    errno = 0;
+    ok (tagmap_insert (NULL, 1, 1, &a) < 0 && errno == EINVAL,
+        "tagmap_insert map=NULL fails with EINVAL");
+    errno = 0;
+    ok (tagmap_insert (map, 1, 0, &a) < 0 && errno == EINVAL,
+        "tagmap_insert count=0 fails with EINVAL");
+    errno = 0;
+    ok (tagmap_insert (map, 1, 1, NULL) < 0 && errno == EINVAL,
+        "tagmap_insert item=NULL fails with EINVAL");
+    errno = 0;
+    ok (tagmap_insert (map, UINT32_MAX, 2, &a) < 0 && errno == EINVAL,
+        "tagmap_insert range that wraps fails with EINVAL");
+    errno = 0;
+    ok (tagmap_reserve (NULL, 1) < 0 && errno == EINVAL,
+        "tagmap_reserve map=NULL fails with EINVAL");
+    ok (tagmap_lookup (NULL, 1) == NULL,
+        "tagmap_lookup map=NULL returns NULL");
+    lives_ok ({tagmap_delete (NULL, 1, 1);},
+        "tagmap_delete map=NULL doesn't crash");
+    lives_ok ({tagmap_destroy (NULL);},
+        "tagmap_destroy map=NULL doesn't crash");
+    tagmap_destroy (map);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_range ();
+    test_grow ();
+    test_invalid ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
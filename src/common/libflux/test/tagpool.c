@@ -78,6 +78,46 @@ int main (int argc, char *argv[])
     ok (avail == size,
         "regular: tagpool_free restored all to pool");
 
+    tags[0] = tagpool_alloc (t);
+    tags[1] = tagpool_alloc (t);
+    tags[2] = tagpool_alloc (t);
+    tagpool_free (t, tags[1]);
+    tags[3] = tagpool_alloc_range (t, 2);
+    ok (tags[3] > tags[2],
+        "range: range skips a hole that is too small");
+    tags[4] = tagpool_alloc_range (t, 1);
+    ok (tags[4] == tags[1],
+        "range: range of 1 fills the hole");
+    avail = tagpool_getattr (t, TAGPOOL_ATTR_AVAIL);
+    ok (avail == size - 5,
+        "range: pool depleted by 5");
+    for (i = 0; i < 5; i++) {
+        if (i != 1)
+            tagpool_free (t, tags[i]);
+    }
+    tagpool_free (t, tags[3] + 1);
+    avail = tagpool_getattr (t, TAGPOOL_ATTR_AVAIL);
+    ok (avail == size,
+        "range: tagpool_free restored all to pool");
+
+    tags[0] = tagpool_alloc_range (t, 4096);
+    ok (tags[0] != FLUX_MATCHTAG_NONE,
+        "range: allocated 4096 tags, growing the pool");
+    tags[1] = tagpool_alloc (t);
+    ok (tags[1] != FLUX_MATCHTAG_NONE
+        && (tags[1] < tags[0] || tags[1] >= tags[0] + 4096),
+        "range: next tag is outside of range");
+    for (j = 0; j < 4096; j++)
+        tagpool_free (t, tags[0] + j);
+    tagpool_free (t, tags[1]);
+    ok (tagpool_alloc_range (t, 0) == FLUX_MATCHTAG_NONE,
+        "range: count=0 fails");
+    ok (tagpool_alloc_range (t, size + 1) == FLUX_MATCHTAG_NONE,
+        "range: count=size+1 fails");
+    avail = tagpool_getattr (t, TAGPOOL_ATTR_AVAIL);
+    ok (avail == size,
+        "range: tagpool_free restored all to pool");
+
     count = 0;
     while (tagpool_alloc (t) != FLUX_MATCHTAG_NONE)
         count++;
@@ -21,7 +21,7 @@
 flux_future_t *flux_kvs_namespace_create (flux_t *h, const char *ns,
                                           uint32_t owner, int flags)
 {
-    if (!ns || flags) {
+    if (!ns || (flags & ~FLUX_KVS_NAMESPACE_BINARY)) {
         errno = EINVAL;
         return NULL;
     }
@@ -38,6 +38,10 @@ enum kvs_op {
     FLUX_KVS_WATCH_APPEND = 256
 };
 
+enum kvs_namespace_flags {
+    FLUX_KVS_NAMESPACE_BINARY = 1,  // store treeobjs in binary encoding
+};
+
 /* Namespace
  * - namespace create only creates the namespace on rank 0.  Other
  *   ranks initialize against that namespace the first time they use
@@ -46,6 +50,9 @@ enum kvs_op {
  *   Garbage collection will happen in the background and the
  *   namespace will official be removed.  The removal is "eventually
  *   consistent".
+ * - FLUX_KVS_NAMESPACE_BINARY stores the namespace's directories in a
+ *   compact binary encoding in the content store.  Clients still see
+ *   JSON treeobjs, e.g. with FLUX_KVS_TREEOBJ lookups.
  */
 flux_future_t *flux_kvs_namespace_create (flux_t *h, const char *ns,
                                           uint32_t owner, int flags);
@@ -27,6 +27,11 @@ void errors (void)
     ok (flux_kvs_namespace_create (NULL, NULL, 0, 5) == NULL && errno == EINVAL,
         "flux_kvs_namespace_create fails on bad input");
 
+    errno = 0;
+    ok (flux_kvs_namespace_create (NULL, "foo", 0, 2) == NULL
+        && errno == EINVAL,
+        "flux_kvs_namespace_create fails on unknown flags");
+
     errno = 0;
     ok (flux_kvs_namespace_remove (NULL, NULL) == NULL && errno == EINVAL,
         "flux_kvs_namespace_remove fails on bad input");
@@ -172,6 +172,19 @@ void test_valref (void)
         "and the four blobrefs are identical");
     json_decref (valref);
 
+    char tailref[BLOBREF_MAX_STRING_SIZE];
+    valref = treeobj_create_valref_buf ("sha256", 256, buf, 1000);
+    ok (valref != NULL,
+        "treeobj_create_valref_buf works on 1000 byte blob");
+    ok (treeobj_get_count (valref) == 4,
+        "and maxblob 256 split blob into 4 blobrefs");
+    ok (blobref_hash ("sha256", buf, 1000 - 768, tailref,
+                      sizeof (tailref)) == 0
+        && (blobref = treeobj_get_blobref (valref, 3)) != NULL
+        && !strcmp (blobref, tailref),
+        "and the last blobref covers the short tail");
+    json_decref (valref);
+
     ok ((valref = treeobj_create_valref_buf ("sha256", 0, NULL, 0)) != NULL,
         "treeobj_create_valref_buf works on empty buf");
     diag_json (valref);
@@ -383,6 +396,126 @@ void test_dir (void)
     json_decref (dir);
 }
 
+void test_hdir (void)
+{
+    json_t *dir, *hdir, *cpy, *shard, *dirref;
+    json_t *val;
+    int index, i, count, total;
+    char name[64];
+
+    errno = 0;
+    ok (treeobj_create_hdir (-1) == NULL && errno == EINVAL,
+        "treeobj_create_hdir level=-1 fails with EINVAL");
+    errno = 0;
+    ok (treeobj_create_hdir (TREEOBJ_HDIR_MAXLEVEL) == NULL
+        && errno == EINVAL,
+        "treeobj_create_hdir level=MAXLEVEL fails with EINVAL");
+    ok (treeobj_decode ("{\"ver\":1,\"type\":\"hdir\","
+                        "\"data\":{\"level\":9,\"shards\":{}}}") == NULL,
+        "treeobj_decode rejects hdir with bad level");
+    ok (treeobj_decode ("{\"ver\":1,\"type\":\"hdir\","
+                        "\"data\":{\"level\":0,\"shards\":"
+                        "{\"zz\":{\"ver\":1,\"type\":\"dir\","
+                        "\"data\":{}}}}}") == NULL,
+        "treeobj_decode rejects hdir with bad shard key");
+    ok ((hdir = treeobj_create_hdir (1)) != NULL,
+        "treeobj_create_hdir works");
+    ok (treeobj_is_hdir (hdir) && !treeobj_is_dir (hdir),
+        "treeobj_is_hdir returns true, treeobj_is_dir returns false");
+    ok (treeobj_validate (hdir) == 0,
+        "treeobj_validate likes empty hdir");
+    ok (treeobj_get_hdir_level (hdir) == 1,
+        "treeobj_get_hdir_level returns 1");
+    ok (treeobj_get_count (hdir) == 0,
+        "treeobj_get_count returns 0");
+
+    index = treeobj_hdir_index (hdir, "foo");
+    ok (index >= 0 && index < TREEOBJ_HDIR_FANOUT,
+        "treeobj_hdir_index returns index in range");
+    errno = 0;
+    ok (treeobj_get_shard (hdir, index) == NULL && errno == ENOENT,
+        "treeobj_get_shard fails with ENOENT on missing shard");
+    if (!(dirref = treeobj_create_dirref (blobrefs[0])))
+        BAIL_OUT ("treeobj_create_dirref failed");
+    ok (treeobj_set_shard (hdir, index, dirref) == 0
+        && treeobj_get_count (hdir) == 1
+        && treeobj_get_shard (hdir, index) == dirref
+        && treeobj_peek_shard (hdir, index) == dirref,
+        "treeobj_set_shard works");
+    ok (treeobj_validate (hdir) == 0,
+        "treeobj_validate likes hdir with dirref shard");
+    if (!(val = treeobj_create_val ("foo", 4)))
+        BAIL_OUT ("treeobj_create_val failed");
+    errno = 0;
+    ok (treeobj_set_shard (hdir, index, val) < 0 && errno == EINVAL,
+        "treeobj_set_shard fails with EINVAL on val shard");
+    errno = 0;
+    ok (treeobj_set_shard (hdir, TREEOBJ_HDIR_FANOUT, dirref) < 0
+        && errno == EINVAL,
+        "treeobj_set_shard fails with EINVAL on bad index");
+    errno = 0;
+    ok (treeobj_get_shard (val, 0) == NULL && errno == EINVAL,
+        "treeobj_get_shard fails with EINVAL on non-hdir treeobj");
+    errno = 0;
+    ok (treeobj_hdir_index (val, "foo") < 0 && errno == EINVAL,
+        "treeobj_hdir_index fails with EINVAL on non-hdir treeobj");
+    ok ((cpy = treeobj_copy (hdir)) != NULL
+        && treeobj_get_shard (cpy, index) == dirref
+        && treeobj_set_shard (cpy, index, NULL) == 0
+        && treeobj_get_count (cpy) == 0
+        && treeobj_get_count (hdir) == 1,
+        "treeobj_copy of hdir copies shards");
+    json_decref (cpy);
+    ok (treeobj_set_shard (hdir, index, NULL) == 0
+        && treeobj_get_count (hdir) == 0,
+        "treeobj_set_shard shard=NULL removes shard");
+    json_decref (hdir);
+    json_decref (dirref);
+
+    /* split a large dir */
+    if (!(dir = create_large_dir ()))
+        BAIL_OUT ("create_large_dir failed");
+    ok ((hdir = treeobj_hdir_split (dir, 0)) != NULL,
+        "treeobj_hdir_split works");
+    ok (treeobj_validate (hdir) == 0,
+        "treeobj_validate likes split hdir");
+    ok (treeobj_get_count (hdir) == TREEOBJ_HDIR_FANOUT,
+        "%d entries were distributed over all %d shards",
+        large_dir_entries, TREEOBJ_HDIR_FANOUT);
+    total = 0;
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if ((shard = treeobj_get_shard (hdir, i))
+            && (count = treeobj_get_count (shard)) > 0)
+            total += count;
+    }
+    ok (total == large_dir_entries,
+        "shards hold all entries");
+    count = 0;
+    for (i = 0; i < large_dir_entries; i++) {
+        snprintf (name, sizeof (name), "entry-%.10d", i);
+        index = treeobj_hdir_index (hdir, name);
+        if (!(shard = treeobj_get_shard (hdir, index))
+            || treeobj_get_entry (shard, name)
+                != treeobj_get_entry (dir, name))
+            count++;
+    }
+    ok (count == 0,
+        "each entry is found in the shard selected by treeobj_hdir_index");
+    errno = 0;
+    ok (treeobj_hdir_split (val, 0) == NULL && errno == EINVAL,
+        "treeobj_hdir_split fails with EINVAL on non-dir treeobj");
+    json_decref (hdir);
+
+    ok ((hdir = treeobj_hdir_split (dir, 1)) != NULL
+        && (shard = treeobj_get_shard (hdir, treeobj_hdir_index (hdir,
+                                                "entry-0000000000")))
+        && treeobj_get_entry (shard, "entry-0000000000") != NULL,
+        "treeobj_hdir_split works at level 1");
+    json_decref (hdir);
+    json_decref (dir);
+    json_decref (val);
+}
+
 void test_dir_peek (void)
 {
     json_t *dir;
@@ -801,6 +934,131 @@ void test_corner_cases (void)
     json_decref (symlink);
 }
 
+void test_codec_binary (void)
+{
+    json_t *dir, *sub, *hdir, *o, *cpy;
+    json_t *dir2, *large;
+    char val[1024];
+    char *s, *p, *p2;
+    size_t len, len2;
+    int i, errors;
+
+    for (i = 0; i < sizeof (val); i++)
+        val[i] = i;
+    if (!(dir = treeobj_create_dir ())
+        || !(sub = treeobj_create_dir ())
+        || !(hdir = treeobj_create_hdir (1)))
+        BAIL_OUT ("treeobj_create_dir failed");
+    if (!(o = treeobj_create_val (val, sizeof (val)))
+        || treeobj_insert_entry (dir, "val", o) < 0)
+        BAIL_OUT ("could not insert val");
+    json_decref (o);
+    if (!(o = treeobj_create_val (NULL, 0))
+        || treeobj_insert_entry (dir, "empty", o) < 0)
+        BAIL_OUT ("could not insert empty val");
+    json_decref (o);
+    if (!(o = treeobj_create_valref (blobrefs[0]))
+        || treeobj_append_blobref (o, blobrefs[1]) < 0
+        || treeobj_insert_entry (dir, "valref", o) < 0)
+        BAIL_OUT ("could not insert valref");
+    json_decref (o);
+    if (!(o = treeobj_create_symlink ("ns", "a.b"))
+        || treeobj_insert_entry (sub, "symlink-ns", o) < 0)
+        BAIL_OUT ("could not insert symlink");
+    json_decref (o);
+    if (!(o = treeobj_create_symlink (NULL, "a.b"))
+        || treeobj_insert_entry (sub, "symlink", o) < 0)
+        BAIL_OUT ("could not insert symlink");
+    json_decref (o);
+    if (!(o = treeobj_create_dirref (blobrefs[2]))
+        || treeobj_set_shard (hdir, 3, o) < 0
+        || treeobj_set_shard (hdir, 63, sub) < 0
+        || treeobj_insert_entry (dir, "hdir", hdir) < 0
+        || treeobj_insert_entry (dir, "sub", sub) < 0)
+        BAIL_OUT ("could not insert hdir");
+    json_decref (o);
+
+    errno = 0;
+    ok (treeobj_encode_binary (dir, NULL) == NULL && errno == EINVAL,
+        "treeobj_encode_binary lenp=NULL fails with EINVAL");
+    errno = 0;
+    ok (treeobj_encode_binary (json_null (), &len) == NULL && errno == EINVAL,
+        "treeobj_encode_binary fails with EINVAL on non-treeobj");
+
+    p = treeobj_encode_binary (dir, &len);
+    ok (p != NULL,
+        "treeobj_encode_binary works on dir with all object types");
+    if (!p)
+        BAIL_OUT ("could not continue");
+    s = treeobj_encode (dir);
+    ok (s != NULL && len < strlen (s) - sizeof (val) / 3,
+        "binary encoding is smaller than JSON (%zu < %zu bytes)",
+        len, s ? strlen (s) : 0);
+    ok ((cpy = treeobj_decodeb (p, len)) != NULL,
+        "treeobj_decodeb decodes binary encoding");
+    ok (cpy && json_equal (cpy, dir) == 1,
+        "and the result is identical to the original");
+    json_decref (cpy);
+
+    /* Same entries inserted in a different order must encode the same.
+     */
+    if (!(dir2 = treeobj_create_dir ()))
+        BAIL_OUT ("treeobj_create_dir failed");
+    if (treeobj_insert_entry (dir2, "sub", sub) < 0
+        || treeobj_insert_entry (dir2, "hdir", hdir) < 0
+        || treeobj_insert_entry (dir2, "valref",
+                                 treeobj_get_entry (dir, "valref")) < 0
+        || treeobj_insert_entry (dir2, "empty",
+                                 treeobj_get_entry (dir, "empty")) < 0
+        || treeobj_insert_entry (dir2, "val",
+                                 treeobj_get_entry (dir, "val")) < 0)
+        BAIL_OUT ("could not populate dir2");
+    p2 = treeobj_encode_binary (dir2, &len2);
+    ok (p2 != NULL && len2 == len && memcmp (p, p2, len) == 0,
+        "binary encoding does not depend on entry insertion order");
+    free (p2);
+    json_decref (dir2);
+
+    errors = 0;
+    for (i = 0; i < len; i++) {
+        if ((cpy = treeobj_decodeb (p, i))) {
+            json_decref (cpy);
+            errors++;
+        }
+        else if (errno != EPROTO)
+            errors++;
+    }
+    ok (errors == 0,
+        "treeobj_decodeb fails with EPROTO on every truncation");
+    p[3]++;
+    errno = 0;
+    ok (treeobj_decodeb (p, len) == NULL && errno == EPROTO,
+        "treeobj_decodeb fails with EPROTO on unknown version");
+    p[3]--;
+    p2 = xzmalloc (len + 1);
+    memcpy (p2, p, len);
+    errno = 0;
+    ok (treeobj_decodeb (p2, len + 1) == NULL && errno == EPROTO,
+        "treeobj_decodeb fails with EPROTO on trailing data");
+    free (p2);
+    free (p);
+    free (s);
+
+    if (!(large = create_large_dir ()))
+        BAIL_OUT ("could not create %d-entry dir", large_dir_entries);
+    p = treeobj_encode_binary (large, &len);
+    ok (p != NULL && (cpy = treeobj_decodeb (p, len)) != NULL
+        && json_equal (cpy, large) == 1,
+        "%d-entry dir survives a binary round trip", large_dir_entries);
+    json_decref (cpy);
+    free (p);
+    json_decref (large);
+
+    json_decref (hdir);
+    json_decref (sub);
+    json_decref (dir);
+}
+
 int main(int argc, char** argv)
 {
     plan (NO_PLAN);
@@ -809,6 +1067,7 @@ int main(int argc, char** argv)
     test_val ();
     test_dirref ();
     test_dir ();
+    test_hdir ();
     test_dir_peek ();
     test_copy ();
     test_deep_copy ();
@@ -816,6 +1075,7 @@ int main(int argc, char** argv)
     test_corner_cases ();
 
     test_codec ();
+    test_codec_binary ();
 
     done_testing();
 }
@@ -15,6 +15,11 @@
 #endif
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
 #include <assert.h>
 #include <sodium.h>
 
@@ -44,6 +49,29 @@ static int treeobj_unpack (json_t *obj, const char **typep, json_t **datap)
     return 0;
 }
 
+/* Parse hdir shard key, a two digit hex index.
+ */
+static int hdir_parse_key (const char *key)
+{
+    char *endptr;
+    long index;
+
+    if (strlen (key) != 2)
+        return -1;
+    errno = 0;
+    index = strtol (key, &endptr, 16);
+    if (errno != 0 || *endptr != '\0'
+                   || index < 0
+                   || index >= TREEOBJ_HDIR_FANOUT)
+        return -1;
+    return index;
+}
+
+static void hdir_key (int index, char *buf, size_t bufsz)
+{
+    snprintf (buf, bufsz, "%02x", index);
+}
+
 static int treeobj_peek (const json_t *obj, const char **typep,
                          const json_t **datap)
 {
@@ -101,6 +129,26 @@ int treeobj_validate (const json_t *obj)
                 goto inval;
         }
     }
+    else if (!strcmp (type, "hdir")) {
+        const char *key;
+        json_t *shards;
+        int level;
+        if (json_unpack ((json_t *)data, "{s:i s:o !}",
+                                         "level", &level,
+                                         "shards", &shards) < 0
+            || level < 0
+            || level >= TREEOBJ_HDIR_MAXLEVEL
+            || !json_is_object (shards))
+            goto inval;
+        json_object_foreach (shards, key, o) {
+            if (hdir_parse_key (key) < 0
+                || treeobj_validate (o) < 0
+                || (!treeobj_is_dir (o)
+                    && !treeobj_is_dirref (o)
+                    && !treeobj_is_hdir (o)))
+                goto inval;
+        }
+    }
     else if (!strcmp (type, "symlink")) {
         json_t *o;
         if (!json_is_object (data))
@@ -166,6 +214,12 @@ bool treeobj_is_dirref (const json_t *obj)
     return type && !strcmp (type, "dirref");
 }
 
+bool treeobj_is_hdir (const json_t *obj)
+{
+    const char *type = treeobj_get_type (obj);
+    return type && !strcmp (type, "hdir");
+}
+
 json_t *treeobj_get_data (json_t *obj)
 {
     json_t *data;
@@ -264,6 +318,9 @@ int treeobj_get_count (const json_t *obj)
     else if (!strcmp (type, "dir")) {
         count = json_object_size (data);
     }
+    else if (!strcmp (type, "hdir")) {
+        count = json_object_size (json_object_get (data, "shards"));
+    }
     else if (!strcmp (type, "symlink") || !strcmp (type, "val")) {
         count = 1;
     } else {
@@ -365,6 +422,153 @@ const json_t *treeobj_peek_entry (const json_t *obj, const char *name)
     return obj2;
 }
 
+static int hdir_peek (const json_t *obj, int *levelp, json_t **shardsp)
+{
+    const char *type;
+    const json_t *data;
+    json_t *shards;
+    int level;
+
+    if (treeobj_peek (obj, &type, &data) < 0
+            || strcmp (type, "hdir") != 0
+            || json_unpack ((json_t *)data, "{s:i s:o}",
+                                            "level", &level,
+                                            "shards", &shards) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (levelp)
+        *levelp = level;
+    if (shardsp)
+        *shardsp = shards;
+    return 0;
+}
+
+int treeobj_get_hdir_level (const json_t *obj)
+{
+    int level;
+
+    if (hdir_peek (obj, &level, NULL) < 0)
+        return -1;
+    return level;
+}
+
+/* 32-bit FNV-1a hash of 'name'
+ */
+static uint32_t hdir_hash (const char *name)
+{
+    uint32_t hash = 2166136261U;
+
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static int hdir_index (int level, const char *name)
+{
+    uint32_t hash = hdir_hash (name);
+
+    return (hash >> (level * TREEOBJ_HDIR_BITS)) & (TREEOBJ_HDIR_FANOUT - 1);
+}
+
+int treeobj_hdir_index (const json_t *obj, const char *name)
+{
+    int level;
+
+    if (!name || hdir_peek (obj, &level, NULL) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return hdir_index (level, name);
+}
+
+json_t *treeobj_get_shard (json_t *obj, int index)
+{
+    json_t *shards, *shard;
+    char key[8];
+
+    if (index < 0 || index >= TREEOBJ_HDIR_FANOUT
+                  || hdir_peek (obj, NULL, &shards) < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    hdir_key (index, key, sizeof (key));
+    if (!(shard = json_object_get (shards, key))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return shard;
+}
+
+const json_t *treeobj_peek_shard (const json_t *obj, int index)
+{
+    return treeobj_get_shard ((json_t *)obj, index);
+}
+
+int treeobj_set_shard (json_t *obj, int index, json_t *shard)
+{
+    json_t *shards;
+    char key[8];
+
+    if (index < 0 || index >= TREEOBJ_HDIR_FANOUT
+                  || hdir_peek (obj, NULL, &shards) < 0
+                  || (shard && !treeobj_is_dir (shard)
+                            && !treeobj_is_dirref (shard)
+                            && !treeobj_is_hdir (shard))) {
+        errno = EINVAL;
+        return -1;
+    }
+    hdir_key (index, key, sizeof (key));
+    if (!shard) {
+        (void)json_object_del (shards, key);
+        return 0;
+    }
+    if (json_object_set (shards, key, shard) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+json_t *treeobj_hdir_split (const json_t *obj, int level)
+{
+    const json_t *data;
+    const char *type;
+    const char *name;
+    json_t *entry;
+    json_t *hdir;
+    json_t *shard;
+    int index;
+
+    if (treeobj_peek (obj, &type, &data) < 0
+            || strcmp (type, "dir") != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(hdir = treeobj_create_hdir (level)))
+        return NULL;
+    json_object_foreach ((json_t *)data, name, entry) {
+        index = hdir_index (level, name);
+        if (!(shard = treeobj_get_shard (hdir, index))) {
+            if (!(shard = treeobj_create_dir ()))
+                goto error;
+            if (treeobj_set_shard (hdir, index, shard) < 0) {
+                json_decref (shard);
+                goto error;
+            }
+            json_decref (shard);
+        }
+        if (treeobj_insert_entry_novalidate (shard, name, entry) < 0)
+            goto error;
+    }
+    return hdir;
+error:
+    json_decref (hdir);
+    return NULL;
+}
+
 json_t *treeobj_copy (json_t *obj)
 {
     json_t *data;
@@ -397,6 +601,22 @@ json_t *treeobj_copy (json_t *obj)
             return NULL;
         }
     }
+    else if (treeobj_is_hdir (obj)) {
+        json_t *shards;
+        json_t *shardscpy;
+        int level;
+
+        if (hdir_peek (obj, &level, &shards) < 0)
+            return NULL;
+        if (!(cpy = treeobj_create_hdir (level)))
+            return NULL;
+        if (hdir_peek (cpy, NULL, &shardscpy) < 0
+            || json_object_update (shardscpy, shards) < 0) {
+            json_decref (cpy);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
     else {
         if (!(cpy = json_deep_copy (obj)))
             return NULL;
@@ -470,6 +690,26 @@ json_t *treeobj_create_dir (void)
     return obj;
 }
 
+json_t *treeobj_create_hdir (int level)
+{
+    json_t *obj;
+
+    if (level < 0 || level >= TREEOBJ_HDIR_MAXLEVEL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(obj = json_pack ("{s:i s:s s:{s:i s:{}}}",
+                           "ver", treeobj_version,
+                           "type", "hdir",
+                           "data",
+                             "level", level,
+                             "shards"))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return obj;
+}
+
 json_t *treeobj_create_symlink (const char *ns, const char *target)
 {
     json_t *data, *obj;
@@ -572,31 +812,514 @@ json_t *treeobj_create_valref_buf (const char *hashtype, int maxblob,
                                    void *data, int len)
 {
     json_t *valref = NULL;
-    char blobref[BLOBREF_MAX_STRING_SIZE];
-    int blob_len;
+    struct blobref_hashreq *req = NULL;
+    int count = 1; // N.B. handle zero-length blob
+    int saved_errno;
+    int i;
 
-    if (!(valref = treeobj_create_valref (NULL)))
+    if (maxblob > 0 && len > maxblob)
+        count = (len + maxblob - 1) / maxblob;
+    if (!(req = calloc (count, sizeof (req[0]))))
         goto error;
-    while (len >= 0) { // N.B. handle zero-length blob
-        blob_len = len;
+    for (i = 0; i < count; i++) {
+        req[i].data = data;
+        req[i].len = len;
         if (maxblob > 0 && len > maxblob)
-            blob_len = maxblob;
-        if (blobref_hash (hashtype, data, blob_len, blobref,
-                          sizeof (blobref)) < 0)
-            goto error;
-        if (treeobj_append_blobref (valref, blobref) < 0)
+            req[i].len = maxblob;
+        len -= req[i].len;
+        data += req[i].len;
+    }
+    if (blobref_hash_batch (hashtype, req, count) < 0)
+        goto error;
+    if (!(valref = treeobj_create_valref (NULL)))
+        goto error;
+    for (i = 0; i < count; i++) {
+        if (treeobj_append_blobref (valref, req[i].blobref) < 0)
             goto error;
-        len -= blob_len;
-        data += blob_len;
-        if (len == 0)
-            break;
     }
+    free (req);
     return valref;
 error:
+    saved_errno = errno;
+    free (req);
     json_decref (valref);
+    errno = saved_errno;
+    return NULL;
+}
+
+/* Binary encoding (version 1).
+ *
+ *   blob    := 0x00 'T' 'O' version object
+ *   object  := type payload
+ *   val     := str (raw value bytes)
+ *   valref  := uint (count) blobref...
+ *   dirref  := uint (count) blobref...
+ *   dir     := uint (count) { str (name) object }...
+ *   hdir    := uint (level) uint (count) { byte (index) object }...
+ *   symlink := byte (1 if namespace) [str (namespace)] str (target)
+ *   blobref := str (hash name) str (digest)
+ *   str     := uint (length) bytes
+ *   uint    := unsigned LEB128
+ *
+ * Dir entries are sorted by name and hdir shards by index, so equal
+ * objects encode to equal blobs.  A JSON treeobj always begins with '{',
+ * so the leading NUL byte tells the two encodings apart.
+ */
+static const uint8_t binary_magic[] = { 0x00, 'T', 'O' };
+static const int binary_version = 1;
+static const int binary_maxdepth = 1024;
+
+enum {
+    BINARY_VAL = 1,
+    BINARY_VALREF = 2,
+    BINARY_DIR = 3,
+    BINARY_DIRREF = 4,
+    BINARY_SYMLINK = 5,
+    BINARY_HDIR = 6,
+};
+
+struct binbuf {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+};
+
+static int binbuf_put (struct binbuf *b, const void *p, size_t n)
+{
+    if (n == 0)
+        return 0;
+    if (b->len + n > b->size) {
+        size_t size = b->size ? b->size : 256;
+        uint8_t *data;
+        while (size < b->len + n)
+            size *= 2;
+        if (!(data = realloc (b->data, size))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        b->data = data;
+        b->size = size;
+    }
+    memcpy (b->data + b->len, p, n);
+    b->len += n;
+    return 0;
+}
+
+static int binbuf_put_byte (struct binbuf *b, uint8_t c)
+{
+    return binbuf_put (b, &c, 1);
+}
+
+static int binbuf_put_uint (struct binbuf *b, uint64_t val)
+{
+    uint8_t buf[10];
+    int n = 0;
+
+    do {
+        buf[n] = val & 0x7f;
+        val >>= 7;
+        if (val)
+            buf[n] |= 0x80;
+        n++;
+    } while (val);
+    return binbuf_put (b, buf, n);
+}
+
+static int binbuf_put_str (struct binbuf *b, const void *p, size_t n)
+{
+    if (binbuf_put_uint (b, n) < 0)
+        return -1;
+    return binbuf_put (b, p, n);
+}
+
+static int binbuf_put_blobref (struct binbuf *b, const char *blobref)
+{
+    uint8_t hash[BLOBREF_MAX_DIGEST_SIZE];
+    const char *cp;
+    int len;
+
+    if (!blobref
+        || !(cp = strchr (blobref, '-'))
+        || (len = blobref_strtohash (blobref, hash, sizeof (hash))) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (binbuf_put_str (b, blobref, cp - blobref) < 0
+        || binbuf_put_str (b, hash, len) < 0)
+        return -1;
+    return 0;
+}
+
+static int keycmp (const void *a, const void *b)
+{
+    return strcmp (*(const char **)a, *(const char **)b);
+}
+
+static int encode_binary (struct binbuf *b, const json_t *obj);
+
+static int encode_binary_dir (struct binbuf *b, const json_t *data)
+{
+    const char **keys;
+    const char *key;
+    json_t *o;
+    size_t i, count = json_object_size (data);
+    int rc = -1;
+
+    if (!(keys = calloc (count + 1, sizeof (keys[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    i = 0;
+    json_object_foreach ((json_t *)data, key, o)
+        keys[i++] = key;
+    qsort (keys, count, sizeof (keys[0]), keycmp);
+    if (binbuf_put_byte (b, BINARY_DIR) < 0
+        || binbuf_put_uint (b, count) < 0)
+        goto done;
+    for (i = 0; i < count; i++) {
+        if (binbuf_put_str (b, keys[i], strlen (keys[i])) < 0
+            || encode_binary (b, json_object_get (data, keys[i])) < 0)
+            goto done;
+    }
+    rc = 0;
+done:
+    free (keys);
+    return rc;
+}
+
+static int encode_binary_hdir (struct binbuf *b, const json_t *obj)
+{
+    json_t *shards;
+    const json_t *o;
+    int level, i;
+
+    if (hdir_peek (obj, &level, &shards) < 0
+        || binbuf_put_byte (b, BINARY_HDIR) < 0
+        || binbuf_put_uint (b, level) < 0
+        || binbuf_put_uint (b, json_object_size (shards)) < 0)
+        return -1;
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if (!(o = treeobj_peek_shard (obj, i)))
+            continue;
+        if (binbuf_put_byte (b, i) < 0 || encode_binary (b, o) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int encode_binary (struct binbuf *b, const json_t *obj)
+{
+    const char *type;
+    const json_t *data;
+
+    if (treeobj_peek (obj, &type, &data) < 0)
+        return -1;
+    if (!strcmp (type, "val")) {
+        void *val;
+        int len;
+        int rc;
+        if (treeobj_decode_val (obj, &val, &len) < 0)
+            return -1;
+        rc = binbuf_put_byte (b, BINARY_VAL);
+        if (rc == 0)
+            rc = binbuf_put_str (b, val, len);
+        free (val);
+        return rc;
+    }
+    else if (!strcmp (type, "valref") || !strcmp (type, "dirref")) {
+        const json_t *o;
+        size_t i;
+        if (binbuf_put_byte (b, !strcmp (type, "valref") ? BINARY_VALREF
+                                                         : BINARY_DIRREF) < 0
+            || binbuf_put_uint (b, json_array_size (data)) < 0)
+            return -1;
+        json_array_foreach ((json_t *)data, i, o) {
+            if (binbuf_put_blobref (b, json_string_value (o)) < 0)
+                return -1;
+        }
+        return 0;
+    }
+    else if (!strcmp (type, "dir")) {
+        if (!json_is_object (data)) {
+            errno = EINVAL;
+            return -1;
+        }
+        return encode_binary_dir (b, data);
+    }
+    else if (!strcmp (type, "hdir"))
+        return encode_binary_hdir (b, obj);
+    else if (!strcmp (type, "symlink")) {
+        const char *ns, *target;
+        if (treeobj_get_symlink (obj, &ns, &target) < 0
+            || binbuf_put_byte (b, BINARY_SYMLINK) < 0
+            || binbuf_put_byte (b, ns ? 1 : 0) < 0
+            || (ns && binbuf_put_str (b, ns, strlen (ns)) < 0)
+            || binbuf_put_str (b, target, strlen (target)) < 0)
+            return -1;
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+void *treeobj_encode_binary (const json_t *obj, size_t *lenp)
+{
+    struct binbuf b = { 0 };
+
+    if (!lenp) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (binbuf_put (&b, binary_magic, sizeof (binary_magic)) < 0
+        || binbuf_put_byte (&b, binary_version) < 0
+        || encode_binary (&b, obj) < 0) {
+        int saved_errno = errno;
+        free (b.data);
+        errno = saved_errno;
+        return NULL;
+    }
+    *lenp = b.len;
+    return b.data;
+}
+
+struct bincursor {
+    const uint8_t *p;
+    size_t len;
+};
+
+static int bincursor_get_byte (struct bincursor *c, uint8_t *valp)
+{
+    if (c->len < 1)
+        return -1;
+    *valp = *c->p++;
+    c->len--;
+    return 0;
+}
+
+static int bincursor_get_uint (struct bincursor *c, uint64_t *valp)
+{
+    uint64_t val = 0;
+    uint8_t byte;
+    int shift;
+
+    for (shift = 0; shift < 64; shift += 7) {
+        if (bincursor_get_byte (c, &byte) < 0)
+            return -1;
+        val |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *valp = val;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int bincursor_get_str (struct bincursor *c,
+                              const void **pp,
+                              size_t *lenp)
+{
+    uint64_t len;
+
+    if (bincursor_get_uint (c, &len) < 0 || len > c->len)
+        return -1;
+    *pp = c->p;
+    *lenp = len;
+    c->p += len;
+    c->len -= len;
+    return 0;
+}
+
+/* Get a string as a NUL-terminated copy, which the caller must free.
+ * Strings containing NUL are rejected as they cannot appear in a treeobj.
+ */
+static char *bincursor_get_cstr (struct bincursor *c)
+{
+    const void *p;
+    size_t len;
+    char *s;
+
+    if (bincursor_get_str (c, &p, &len) < 0
+        || memchr (p, '\0', len)
+        || !(s = malloc (len + 1)))
+        return NULL;
+    memcpy (s, p, len);
+    s[len] = '\0';
+    return s;
+}
+
+static int bincursor_get_blobref (struct bincursor *c,
+                                  char *blobref,
+                                  int blobref_len)
+{
+    char hashtype[16];
+    const void *p, *hash;
+    size_t len, hashlen;
+
+    if (bincursor_get_str (c, &p, &len) < 0
+        || len == 0
+        || len >= sizeof (hashtype)
+        || memchr (p, '\0', len)
+        || bincursor_get_str (c, &hash, &hashlen) < 0
+        || hashlen > BLOBREF_MAX_DIGEST_SIZE)
+        return -1;
+    memcpy (hashtype, p, len);
+    hashtype[len] = '\0';
+    return blobref_hashtostr (hashtype, hash, hashlen, blobref, blobref_len);
+}
+
+static json_t *decode_binary (struct bincursor *c, int depth);
+
+static json_t *decode_binary_ref (struct bincursor *c, bool isdir)
+{
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    json_t *obj;
+    uint64_t count, i;
+
+    if (bincursor_get_uint (c, &count) < 0 || count == 0)
+        return NULL;
+    if (!(obj = isdir ? treeobj_create_dirref (NULL)
+                      : treeobj_create_valref (NULL)))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (bincursor_get_blobref (c, blobref, sizeof (blobref)) < 0
+            || treeobj_append_blobref (obj, blobref) < 0)
+            goto error;
+    }
+    return obj;
+error:
+    json_decref (obj);
+    return NULL;
+}
+
+static json_t *decode_binary_dir (struct bincursor *c, int depth)
+{
+    json_t *obj, *entry = NULL;
+    uint64_t count, i;
+    char *name = NULL;
+
+    if (bincursor_get_uint (c, &count) < 0
+        || !(obj = treeobj_create_dir ()))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (!(name = bincursor_get_cstr (c))
+            || treeobj_peek_entry (obj, name) != NULL
+            || !(entry = decode_binary (c, depth + 1))
+            || treeobj_insert_entry_novalidate (obj, name, entry) < 0)
+            goto error;
+        json_decref (entry);
+        entry = NULL;
+        free (name);
+        name = NULL;
+    }
+    return obj;
+error:
+    free (name);
+    json_decref (entry);
+    json_decref (obj);
+    return NULL;
+}
+
+static json_t *decode_binary_hdir (struct bincursor *c, int depth)
+{
+    json_t *obj, *shard = NULL;
+    uint64_t level, count, i;
+    uint8_t index;
+
+    if (bincursor_get_uint (c, &level) < 0
+        || level >= TREEOBJ_HDIR_MAXLEVEL
+        || bincursor_get_uint (c, &count) < 0
+        || count > TREEOBJ_HDIR_FANOUT
+        || !(obj = treeobj_create_hdir (level)))
+        return NULL;
+    for (i = 0; i < count; i++) {
+        if (bincursor_get_byte (c, &index) < 0
+            || treeobj_peek_shard (obj, index) != NULL
+            || !(shard = decode_binary (c, depth + 1))
+            || treeobj_set_shard (obj, index, shard) < 0)
+            goto error;
+        json_decref (shard);
+        shard = NULL;
+    }
+    return obj;
+error:
+    json_decref (shard);
+    json_decref (obj);
     return NULL;
 }
 
+static json_t *decode_binary_symlink (struct bincursor *c)
+{
+    json_t *obj = NULL;
+    char *ns = NULL;
+    char *target = NULL;
+    uint8_t has_ns;
+
+    if (bincursor_get_byte (c, &has_ns) < 0
+        || has_ns > 1
+        || (has_ns && !(ns = bincursor_get_cstr (c)))
+        || !(target = bincursor_get_cstr (c)))
+        goto done;
+    obj = treeobj_create_symlink (ns, target);
+done:
+    free (ns);
+    free (target);
+    return obj;
+}
+
+static json_t *decode_binary (struct bincursor *c, int depth)
+{
+    uint8_t type;
+
+    if (depth > binary_maxdepth || bincursor_get_byte (c, &type) < 0)
+        return NULL;
+    switch (type) {
+        case BINARY_VAL: {
+            const void *p;
+            size_t len;
+            if (bincursor_get_str (c, &p, &len) < 0 || len > INT_MAX)
+                return NULL;
+            return treeobj_create_val (p, len);
+        }
+        case BINARY_VALREF:
+            return decode_binary_ref (c, false);
+        case BINARY_DIRREF:
+            return decode_binary_ref (c, true);
+        case BINARY_DIR:
+            return decode_binary_dir (c, depth);
+        case BINARY_HDIR:
+            return decode_binary_hdir (c, depth);
+        case BINARY_SYMLINK:
+            return decode_binary_symlink (c);
+    }
+    return NULL;
+}
+
+static bool is_binary (const char *buf, size_t buflen)
+{
+    return (buflen >= sizeof (binary_magic)
+            && !memcmp (buf, binary_magic, sizeof (binary_magic)));
+}
+
+static json_t *treeobj_decode_binary (const char *buf, size_t buflen)
+{
+    struct bincursor c = {
+        .p = (const uint8_t *)buf + sizeof (binary_magic),
+        .len = buflen - sizeof (binary_magic),
+    };
+    uint8_t version;
+    json_t *obj;
+
+    if (bincursor_get_byte (&c, &version) < 0
+        || version != binary_version
+        || !(obj = decode_binary (&c, 0)))
+        return NULL;
+    if (c.len > 0) {
+        json_decref (obj);
+        return NULL;
+    }
+    return obj;
+}
+
 json_t *treeobj_decode (const char *buf)
 {
     if (!buf) {
@@ -609,8 +1332,12 @@ json_t *treeobj_decode (const char *buf)
 json_t *treeobj_decodeb (const char *buf, size_t buflen)
 {
     json_t *obj = NULL;
-    if (!(obj = json_loadb (buf, buflen, 0, NULL))
-            || treeobj_validate (obj) < 0) {
+
+    if (buf && is_binary (buf, buflen))
+        obj = treeobj_decode_binary (buf, buflen);
+    else
+        obj = json_loadb (buf, buflen, 0, NULL);
+    if (!obj || treeobj_validate (obj) < 0) {
         errno = EPROTO;
         goto error;
     }
@@ -28,6 +28,7 @@ json_t *treeobj_create_val (const void *data, int len);
 json_t *treeobj_create_valref (const char *blobref);
 json_t *treeobj_create_dir (void);
 json_t *treeobj_create_dirref (const char *blobref);
+json_t *treeobj_create_hdir (int level);
 
 /* Validate treeobj, recursively.
  * Return 0 if valid, -1 with errno = EINVAL if invalid.
@@ -45,6 +46,7 @@ bool treeobj_is_val (const json_t *obj);
 bool treeobj_is_valref (const json_t *obj);
 bool treeobj_is_dir (const json_t *obj);
 bool treeobj_is_dirref (const json_t *obj);
+bool treeobj_is_hdir (const json_t *obj);
 
 /* get type-specific value.
  * For dirref/valref, this is an array of blobrefs.
@@ -72,6 +74,7 @@ int treeobj_decode_val (const json_t *obj, void **data, int *len);
 /* get type-specific count.
  * For dirref/valref, this is the number of blobrefs.
  * For directory, this is number of entries
+ * For hashed directory, this is the number of shards.
  * For symlink or val, this is 1.
  * Return count on success, -1 on error with errno = EINVAL.
  */
@@ -101,10 +104,49 @@ int treeobj_insert_entry_novalidate (json_t *obj,
  */
 const json_t *treeobj_peek_entry (const json_t *obj, const char *name);
 
+/* Hashed directories (hdir) hold the entries of a large directory in
+ * up to TREEOBJ_HDIR_FANOUT shards, each a dir, dirref, or hdir.  The
+ * shard holding an entry is selected by TREEOBJ_HDIR_BITS of the hash
+ * of its name, taken at an offset given by the hdir level, so a shard
+ * that grows too large may be split into an hdir one level down.
+ * A dirref may refer to an hdir wherever it may refer to a dir, except
+ * for the root directory.
+ */
+#define TREEOBJ_HDIR_BITS       6
+#define TREEOBJ_HDIR_FANOUT     (1 << TREEOBJ_HDIR_BITS)
+#define TREEOBJ_HDIR_MAXLEVEL   5
+
+/* get hdir level.
+ * Return level on success, -1 on error with errno = EINVAL.
+ */
+int treeobj_get_hdir_level (const json_t *obj);
+
+/* get index of the hdir shard that holds entry 'name'.
+ * Return index on success, -1 on error with errno = EINVAL.
+ */
+int treeobj_hdir_index (const json_t *obj, const char *name);
+
+/* get/set hdir shard at 'index'
+ * Get returns JSON object (owned by 'obj', do not destroy), NULL on
+ * error, with errno = ENOENT if the shard does not exist.
+ * set takes a reference on 'shard' (caller retains ownership).  If
+ * 'shard' is NULL, the shard is removed.
+ * set returns 0 on success, -1 on error with errno set.
+ */
+json_t *treeobj_get_shard (json_t *obj, int index);
+const json_t *treeobj_peek_shard (const json_t *obj, int index);
+int treeobj_set_shard (json_t *obj, int index, json_t *shard);
+
+/* Create hdir at 'level' with the entries of dir 'obj' distributed
+ * into dir shards.  Entries are shared with 'obj', not copied.
+ */
+json_t *treeobj_hdir_split (const json_t *obj, int level);
+
 /* Shallow copy a treeobj
  * Note that this is not a shallow copy on the json object, but is a
  * shallow copy on the data within a tree object.  For example, for a
- * dir object, the first level of directory entries will be copied.
+ * dir object, the first level of directory entries will be copied,
+ * and for an hdir object, its shards.
  */
 json_t *treeobj_copy (json_t *obj);
 
@@ -129,6 +171,7 @@ json_t *treeobj_create_valref_buf (const char *hashtype, int maxblob,
                                    void *data, int len);
 
 /* Convert a treeobj to/from string.
+ * treeobj_decodeb() also accepts the binary encoding below.
  * The return value of treeobj_decode must be destroyed with json_decref().
  * The return value of treeobj_encode must be destroyed with free().
  */
@@ -136,6 +179,12 @@ json_t *treeobj_decode (const char *buf);
 json_t *treeobj_decodeb (const char *buf, size_t buflen);
 char *treeobj_encode (const json_t *obj);
 
+/* Convert a treeobj to a compact, versioned binary encoding in which
+ * val data is stored as raw bytes instead of base64.  The length is
+ * returned in 'lenp'.  The return value must be destroyed with free().
+ */
+void *treeobj_encode_binary (const json_t *obj, size_t *lenp);
+
 #endif /* !_FLUX_KVS_TREEOBJ_H */
 
 /*
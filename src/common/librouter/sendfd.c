@@ -42,19 +42,40 @@
  * - sendfd/recvfd do not encrypt messages, therefore this transport
  *   is only appropriate for use on AF_LOCAL sockets or on file descriptors
  *   tunneled through a secure channel.
+ *
+ * - sendfd_batch() and recvbuf_fill() use the same encoding, but move
+ *   many messages per system call.  A sender with a queue of messages
+ *   encodes up to IOBATCH_MAX of them into an iobatch and writes them
+ *   with writev(2).  A receiver reads whatever is available into a
+ *   recvbuf, spilling into a stack buffer with a two element iovec so one
+ *   call can take more than the current buffer holds, then decodes all
+ *   complete messages from the buffer.
+ *
+ * - sendfd_rights() passes file descriptors with a message over a unix
+ *   domain socket.  recvbuf_fill() uses recvmsg(2) on sockets so they are
+ *   collected, and holds them until claimed with recvbuf_take_fds().
  */
 
 #if HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <flux/core.h>
 
 #include "sendfd.h"
 
 #define IOBUF_MAGIC 0xffee0012
 
+#define RECVBUF_MIN_FREE    4096
+#define RECVBUF_SPARE_SIZE  65536
+#define RECVBUF_MAX_IDLE    (256*1024)
+
 void iobuf_init (struct iobuf *iobuf)
 {
     memset (iobuf, 0, sizeof (*iobuf));
@@ -67,7 +88,42 @@ void iobuf_clean (struct iobuf *iobuf)
     memset (iobuf, 0, sizeof (*iobuf));
 }
 
-int sendfd (int fd, const flux_msg_t *msg, struct iobuf *iobuf)
+/* Write the first chunk of io->buf with SCM_RIGHTS ancillary data.
+ */
+static int sendmsg_rights (int fd,
+                           struct iobuf *io,
+                           const int *fds,
+                           int nfds)
+{
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE (sizeof (int) * RECVBUF_MAX_FDS)];
+    } cbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr mh;
+    struct iovec iov;
+
+    memset (&cbuf, 0, sizeof (cbuf));
+    memset (&mh, 0, sizeof (mh));
+    iov.iov_base = io->buf;
+    iov.iov_len = io->size;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = cbuf.buf;
+    mh.msg_controllen = CMSG_SPACE (sizeof (int) * nfds);
+    cmsg = CMSG_FIRSTHDR (&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (int) * nfds);
+    memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * nfds);
+    return sendmsg (fd, &mh, MSG_NOSIGNAL);
+}
+
+static int sendfd_internal (int fd,
+                            const flux_msg_t *msg,
+                            const int *fds,
+                            int nfds,
+                            struct iobuf *iobuf)
 {
     struct iobuf local;
     struct iobuf *io = iobuf ? iobuf : &local;
@@ -92,7 +148,10 @@ int sendfd (int fd, const flux_msg_t *msg, struct iobuf *iobuf)
         io->done = 0;
     }
     do {
-        rc = write (fd, io->buf + io->done, io->size - io->done);
+        if (io->done == 0 && nfds > 0)
+            rc = sendmsg_rights (fd, io, fds, nfds);
+        else
+            rc = write (fd, io->buf + io->done, io->size - io->done);
         if (rc < 0)
             goto done;
         io->done += rc;
@@ -110,6 +169,24 @@ done:
     return rc;
 }
 
+int sendfd (int fd, const flux_msg_t *msg, struct iobuf *iobuf)
+{
+    return sendfd_internal (fd, msg, NULL, 0, iobuf);
+}
+
+int sendfd_rights (int fd,
+                   const flux_msg_t *msg,
+                   const int *fds,
+                   int nfds,
+                   struct iobuf *iobuf)
+{
+    if (nfds < 1 || nfds > RECVBUF_MAX_FDS || !fds) {
+        errno = EINVAL;
+        return -1;
+    }
+    return sendfd_internal (fd, msg, fds, nfds, iobuf);
+}
+
 flux_msg_t *recvfd (int fd, struct iobuf *iobuf)
 {
     struct iobuf local;
@@ -175,6 +252,330 @@ done:
     return msg;
 }
 
+void iobatch_init (struct iobatch *b)
+{
+    memset (b, 0, sizeof (*b));
+}
+
+void iobatch_clean (struct iobatch *b)
+{
+    if (b) {
+        int i;
+        for (i = b->first; i < b->count; i++)
+            free (b->buf[i]);
+        memset (b, 0, sizeof (*b));
+    }
+}
+
+bool iobatch_full (struct iobatch *b)
+{
+    return (b->count == IOBATCH_MAX || b->size >= IOBATCH_MAX_BYTES);
+}
+
+bool iobatch_empty (struct iobatch *b)
+{
+    return (b->first == b->count);
+}
+
+int iobatch_append (struct iobatch *b, const flux_msg_t *msg)
+{
+    uint8_t *buf;
+    size_t size;
+    int i;
+
+    if (!b || !msg) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (b->count == IOBATCH_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    size = flux_msg_encode_size (msg) + 8;
+    if (!(buf = malloc (size)))
+        return -1;
+    *(uint32_t *)&buf[0] = IOBUF_MAGIC;
+    *(uint32_t *)&buf[4] = htonl (size - 8);
+    if (flux_msg_encode (msg, &buf[8], size - 8) < 0) {
+        free (buf);
+        return -1;
+    }
+    i = b->count++;
+    b->buf[i] = buf;
+    b->iov[i].iov_base = buf;
+    b->iov[i].iov_len = size;
+    b->size += size;
+    return 0;
+}
+
+int sendfd_batch (int fd, struct iobatch *b)
+{
+    ssize_t n;
+    int rc = -1;
+
+    if (fd < 0 || !b) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (b->first < b->count) {
+        if ((n = writev (fd, &b->iov[b->first], b->count - b->first)) < 0)
+            goto done;
+        b->size -= n;
+        while (n > 0) {
+            struct iovec *iov = &b->iov[b->first];
+            if (n >= iov->iov_len) {
+                n -= iov->iov_len;
+                free (b->buf[b->first]);
+                b->buf[b->first++] = NULL;
+            }
+            else {
+                iov->iov_base = (uint8_t *)iov->iov_base + n;
+                iov->iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+    rc = 0;
+done:
+    /* Move unwritten entries to the front to make room for more.
+     */
+    if (b->first > 0) {
+        int count = b->count - b->first;
+        memmove (&b->iov[0], &b->iov[b->first], count * sizeof (b->iov[0]));
+        memmove (&b->buf[0], &b->buf[b->first], count * sizeof (b->buf[0]));
+        b->count = count;
+        b->first = 0;
+    }
+    return rc;
+}
+
+void recvbuf_init (struct recvbuf *rb)
+{
+    memset (rb, 0, sizeof (*rb));
+}
+
+void recvbuf_clean (struct recvbuf *rb)
+{
+    if (rb) {
+        int i;
+        for (i = 0; i < rb->nfds; i++)
+            (void)close (rb->fds[i]);
+        free (rb->buf);
+        memset (rb, 0, sizeof (*rb));
+    }
+}
+
+/* If the frame header at the start of the buffer is complete, set
+ * 'fsize' to the total frame size and return 1.  If incomplete, return 0.
+ * If the header is invalid, return -1 with errno set.
+ */
+static int recvbuf_frame_size (struct recvbuf *rb, size_t *fsize)
+{
+    uint32_t magic;
+    uint32_t size;
+
+    if (rb->end - rb->start < 8)
+        return 0;
+    memcpy (&magic, rb->buf + rb->start, sizeof (magic));
+    memcpy (&size, rb->buf + rb->start + 4, sizeof (size));
+    if (magic != IOBUF_MAGIC) {
+        errno = EPROTO;
+        return -1;
+    }
+    *fsize = ntohl (size) + 8;
+    return 1;
+}
+
+static int recvbuf_grow (struct recvbuf *rb, size_t size)
+{
+    uint8_t *buf;
+
+    if (rb->size >= size)
+        return 0;
+    if (size < rb->size * 2)
+        size = rb->size * 2;
+    if (!(buf = realloc (rb->buf, size)))
+        return -1;
+    rb->buf = buf;
+    rb->size = size;
+    return 0;
+}
+
+/* Collect SCM_RIGHTS file descriptors from received message.
+ * Any beyond RECVBUF_MAX_FDS are closed.
+ */
+static void recvbuf_add_rights (struct recvbuf *rb, struct msghdr *mh)
+{
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR (mh); cmsg; cmsg = CMSG_NXTHDR (mh, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET
+            && cmsg->cmsg_type == SCM_RIGHTS) {
+            int n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+            int *fds = (int *)CMSG_DATA (cmsg);
+            int i;
+            for (i = 0; i < n; i++) {
+                if (rb->nfds < RECVBUF_MAX_FDS)
+                    rb->fds[rb->nfds++] = fds[i];
+                else
+                    (void)close (fds[i]);
+            }
+        }
+    }
+}
+
+static ssize_t recvbuf_read (int fd, struct recvbuf *rb, struct iovec *iov)
+{
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE (sizeof (int) * RECVBUF_MAX_FDS)];
+    } cbuf;
+    struct msghdr mh;
+    ssize_t n;
+
+    if (!rb->notsock) {
+        memset (&mh, 0, sizeof (mh));
+        mh.msg_iov = iov;
+        mh.msg_iovlen = 2;
+        mh.msg_control = cbuf.buf;
+        mh.msg_controllen = sizeof (cbuf.buf);
+        if ((n = recvmsg (fd, &mh, MSG_CMSG_CLOEXEC)) >= 0) {
+            if (mh.msg_controllen > 0)
+                recvbuf_add_rights (rb, &mh);
+            return n;
+        }
+        if (errno != ENOTSOCK)
+            return -1;
+        rb->notsock = true;
+    }
+    return readv (fd, iov, 2);
+}
+
+int recvbuf_take_fds (struct recvbuf *rb, int *fds, int maxfds)
+{
+    int count = 0;
+    int i;
+
+    if (!rb)
+        return 0;
+    for (i = 0; i < rb->nfds; i++) {
+        if (fds && count < maxfds)
+            fds[count++] = rb->fds[i];
+        else
+            (void)close (rb->fds[i]);
+    }
+    rb->nfds = 0;
+    return count;
+}
+
+ssize_t recvbuf_fill (int fd, struct recvbuf *rb)
+{
+    uint8_t spare[RECVBUF_SPARE_SIZE];
+    struct iovec iov[2];
+    size_t need;
+    size_t fsize;
+    ssize_t n;
+    int rc;
+
+    if (fd < 0 || !rb) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (rb->start > 0) {
+        memmove (rb->buf, rb->buf + rb->start, rb->end - rb->start);
+        rb->end -= rb->start;
+        rb->start = 0;
+    }
+    /* Ensure there is room for the rest of a partially received frame,
+     * or at least RECVBUF_MIN_FREE bytes.
+     */
+    need = rb->end + RECVBUF_MIN_FREE;
+    if ((rc = recvbuf_frame_size (rb, &fsize)) < 0)
+        return -1;
+    if (rc > 0 && fsize > need)
+        need = fsize;
+    if (recvbuf_grow (rb, need) < 0)
+        return -1;
+
+    iov[0].iov_base = rb->buf + rb->end;
+    iov[0].iov_len = rb->size - rb->end;
+    iov[1].iov_base = spare;
+    iov[1].iov_len = sizeof (spare);
+    if ((n = recvbuf_read (fd, rb, iov)) < 0)
+        return -1;
+    if (n == 0) {
+        errno = ECONNRESET;
+        return -1;
+    }
+    if (n > iov[0].iov_len) {
+        size_t extra = n - iov[0].iov_len;
+        rb->end += iov[0].iov_len;
+        if (recvbuf_grow (rb, rb->end + extra) < 0)
+            return -1;
+        memcpy (rb->buf + rb->end, spare, extra);
+        rb->end += extra;
+    }
+    else
+        rb->end += n;
+    return n;
+}
+
+bool recvbuf_pending (struct recvbuf *rb)
+{
+    size_t fsize;
+
+    if (rb && recvbuf_frame_size (rb, &fsize) > 0
+           && rb->end - rb->start >= fsize)
+        return true;
+    return false;
+}
+
+flux_msg_t *recvbuf_next (struct recvbuf *rb)
+{
+    const uint8_t *frame;
+    size_t fsize;
+    int rc;
+
+    if (!rb) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((rc = recvbuf_frame_size (rb, &fsize)) < 0)
+        return NULL;
+    if (rc == 0 || rb->end - rb->start < fsize) {
+        errno = EWOULDBLOCK;
+        return NULL;
+    }
+    frame = rb->buf + rb->start;
+    rb->start += fsize;
+    if (rb->start == rb->end) {
+        rb->start = rb->end = 0;
+        /* Don't hold on to a large buffer after a large message.
+         */
+        if (rb->size > RECVBUF_MAX_IDLE) {
+            flux_msg_t *msg = flux_msg_decode (frame + 8, fsize - 8);
+            int saved_errno = errno;
+            recvbuf_clean (rb);
+            errno = saved_errno;
+            return msg;
+        }
+    }
+    return flux_msg_decode (frame + 8, fsize - 8);
+}
+
+flux_msg_t *recvbuf_recv (int fd, struct recvbuf *rb)
+{
+    flux_msg_t *msg;
+
+    while (!(msg = recvbuf_next (rb))) {
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+            return NULL;
+        if (recvbuf_fill (fd, rb) < 0)
+            return NULL;
+    }
+    return msg;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -11,6 +11,8 @@
 #ifndef _ROUTER_SENDFD_H
 #define _ROUTER_SENDFD_H
 
+#include <sys/uio.h>
+#include <stdbool.h>
 #include <flux/core.h>
 
 struct iobuf {
@@ -26,6 +28,15 @@ struct iobuf {
  */
 int sendfd (int fd, const flux_msg_t *msg, struct iobuf *iobuf);
 
+/* Send message to a unix domain socket like sendfd(), passing 'fds'
+ * as SCM_RIGHTS ancillary data with the first byte.
+ */
+int sendfd_rights (int fd,
+                   const flux_msg_t *msg,
+                   const int *fds,
+                   int nfds,
+                   struct iobuf *iobuf);
+
 /* Receive message from file descriptor.
  * iobuf captures intermediate state to make EAGAIN/EWOULDBLOCK restartable.
  * Returns message on success, NULL on failure with errno set.
@@ -41,6 +52,87 @@ void iobuf_init (struct iobuf *iobuf);
  */
 void iobuf_clean (struct iobuf *iobuf);
 
+/* Batched send - messages are encoded with iobatch_append(), then
+ * written with as few writev(2) calls as possible by sendfd_batch().
+ */
+#define IOBATCH_MAX         64
+#define IOBATCH_MAX_BYTES   (256*1024)
+
+struct iobatch {
+    struct iovec iov[IOBATCH_MAX];
+    uint8_t *buf[IOBATCH_MAX];
+    int first;          // first iov[] not yet completely written
+    int count;          // number of iov[] in use
+    size_t size;        // bytes not yet written
+};
+
+void iobatch_init (struct iobatch *b);
+void iobatch_clean (struct iobatch *b);
+
+/* Return true if no more messages should be appended before the
+ * batch is written, or if the batch has nothing left to write.
+ */
+bool iobatch_full (struct iobatch *b);
+bool iobatch_empty (struct iobatch *b);
+
+/* Encode 'msg' at the end of the batch.  The message is copied, so the
+ * caller may destroy it on success.  Fails with EOVERFLOW if full.
+ */
+int iobatch_append (struct iobatch *b, const flux_msg_t *msg);
+
+/* Write the batch to file descriptor, restarting after EAGAIN/EWOULDBLOCK
+ * where it left off.  Returns 0 when the batch is empty, or -1 on failure
+ * with errno set.
+ */
+int sendfd_batch (int fd, struct iobatch *b);
+
+/* Buffered receive - recvbuf_fill() reads as much as is available with
+ * one system call, then recvbuf_next() returns complete messages from the
+ * buffer without further system calls.  File descriptors passed with
+ * sendfd_rights() are held until claimed with recvbuf_take_fds().
+ */
+#define RECVBUF_MAX_FDS     4
+
+struct recvbuf {
+    uint8_t *buf;
+    size_t size;        // allocated size of buf
+    size_t start;       // offset of first unconsumed byte
+    size_t end;         // offset past last valid byte
+    int fds[RECVBUF_MAX_FDS];
+    int nfds;
+    bool notsock;       // fd is not a socket, use readv(2)
+};
+
+void recvbuf_init (struct recvbuf *rb);
+void recvbuf_clean (struct recvbuf *rb);
+
+/* Read from file descriptor into buffer.  Returns the number of bytes
+ * read, or -1 on failure with errno set.  EOF fails with ECONNRESET.
+ */
+ssize_t recvbuf_fill (int fd, struct recvbuf *rb);
+
+/* Return the next complete message from the buffer, or NULL with
+ * errno set to EWOULDBLOCK if none is available, or another errno
+ * value on failure.
+ */
+flux_msg_t *recvbuf_next (struct recvbuf *rb);
+
+/* Move up to 'maxfds' received file descriptors to 'fds', transferring
+ * ownership to the caller.  Any others are closed.  Returns the number
+ * of file descriptors moved.
+ */
+int recvbuf_take_fds (struct recvbuf *rb, int *fds, int maxfds);
+
+/* Return true if recvbuf_next() would return a message.
+ */
+bool recvbuf_pending (struct recvbuf *rb);
+
+/* Receive message, calling recvbuf_fill() as needed.  Like recvfd(),
+ * fails with EWOULDBLOCK or EAGAIN on a non-blocking fd with no complete
+ * message, and may be called again when the fd becomes readable.
+ */
+flux_msg_t *recvbuf_recv (int fd, struct recvbuf *rb);
+
 #endif /* !_ROUTER_SENDFD_H */
 
 /*
@@ -0,0 +1,544 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* shmring.c - shared memory message rings
+ *
+ * Layout of the memfd: a header and a data area for the client to server
+ * ring, followed by the same for the server to client ring.
+ *
+ * Each ring has a free running 'head' (next byte to write, updated only by
+ * the producer) and 'tail' (next byte to read, updated only by the
+ * consumer).  Frames consist of an 8 byte header (length, type) followed
+ * by the encoded message, padded to 8 bytes.  A frame never spans the end
+ * of the data area: if it does not fit, a WRAP frame fills the rest and
+ * the frame starts over at the beginning.  Thus messages are encoded and
+ * decoded in place.
+ *
+ * Wakeups:  a consumer that finds the ring empty sets 'reader_waiting'
+ * before checking again, and a producer that finds the ring full sets
+ * 'writer_waiting'.  After changing head or tail, the other side clears
+ * the flag and writes the waiting side's eventfd.  A busy peer therefore
+ * makes no system calls.
+ *
+ * The server maps memory controlled by an untrusted client, so the ring
+ * size is read once at attach time, offsets are checked against it on
+ * every access, and the memfd must be sealed against shrinking (which
+ * would cause SIGBUS).
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/fdutils.h"
+
+#include "shmring.h"
+
+#define SHMRING_MAGIC   0x464c5852
+#define HDR_SIZE        256
+
+enum {
+    FRAME_MSG = 1,
+    FRAME_WRAP = 2,
+    FRAME_REDIRECT = 3,
+};
+
+struct ring_hdr {
+    uint32_t magic;
+    uint32_t size;
+    uint8_t pad0[56];
+    uint64_t head;              // written by producer
+    uint32_t writer_waiting;
+    uint8_t pad1[52];
+    uint64_t tail;              // written by consumer
+    uint32_t reader_waiting;
+    uint8_t pad2[52];
+};
+
+struct frame_hdr {
+    uint32_t len;
+    uint32_t type;
+};
+
+struct ring {
+    struct ring_hdr *hdr;
+    uint8_t *data;
+    size_t size;                // private copy, hdr->size is untrusted
+    uint64_t pos;               // private copy of head (tx) or tail (rx)
+};
+
+struct shmring {
+    void *base;
+    size_t mapsize;
+    struct ring tx;
+    struct ring rx;
+    int fds[SHMRING_NFDS];      // memfd, client eventfd, server eventfd
+    int waitfd;
+    int notifyfd;
+};
+
+/* 'len' may come from the peer, so widen it before rounding up so that
+ * a length near UINT32_MAX cannot wrap to a small frame size.
+ */
+#define FRAME_SIZE(len) \
+    (sizeof (struct frame_hdr) + (((size_t)(len) + 7) & ~(size_t)7))
+
+static bool valid_size (size_t size)
+{
+    return (size >= SHMRING_SIZE_MIN
+            && size <= SHMRING_SIZE_MAX
+            && (size & (size - 1)) == 0);
+}
+
+static void ring_init (struct ring *r, void *base, size_t size)
+{
+    r->hdr = base;
+    r->data = (uint8_t *)base + HDR_SIZE;
+    r->size = size;
+    r->pos = 0;
+}
+
+static void notify (struct shmring *ring, uint32_t *waiting)
+{
+    uint64_t one = 1;
+
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (waiting, __ATOMIC_RELAXED)
+        && __atomic_exchange_n (waiting, 0, __ATOMIC_ACQ_REL))
+        (void)write (ring->notifyfd, &one, sizeof (one));
+}
+
+/* Set 'waiting' flag before the caller checks the ring again.
+ */
+static void arm (uint32_t *waiting)
+{
+    __atomic_store_n (waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+static void disarm (uint32_t *waiting)
+{
+    __atomic_store_n (waiting, 0, __ATOMIC_RELAXED);
+}
+
+/* Return free space in tx ring, or -1 with errno = EPROTO if corrupt.
+ */
+static ssize_t tx_space (struct ring *r)
+{
+    uint64_t tail = __atomic_load_n (&r->hdr->tail, __ATOMIC_ACQUIRE);
+    uint64_t used = r->pos - tail;
+
+    if (used > r->size) {
+        errno = EPROTO;
+        return -1;
+    }
+    return r->size - used;
+}
+
+/* Reserve space for a frame of 'fsize' bytes, inserting a WRAP frame
+ * if needed.  The frame is not visible to the consumer until tx_commit().
+ */
+static int tx_reserve (struct ring *r, size_t fsize, uint8_t **p)
+{
+    size_t off = r->pos & (r->size - 1);
+    size_t contig = r->size - off;
+    size_t need = fsize <= contig ? fsize : contig + fsize;
+    ssize_t space;
+
+    if ((space = tx_space (r)) < 0)
+        return -1;
+    if (space < need) {
+        arm (&r->hdr->writer_waiting);
+        if ((space = tx_space (r)) < 0)
+            return -1;
+        if (space < need) {
+            errno = EAGAIN;
+            return -1;
+        }
+        disarm (&r->hdr->writer_waiting);
+    }
+    if (fsize > contig) {
+        struct frame_hdr fh = { .len = 0, .type = FRAME_WRAP };
+        memcpy (r->data + off, &fh, sizeof (fh));
+        r->pos += contig;
+        off = 0;
+    }
+    *p = r->data + off;
+    return 0;
+}
+
+static void tx_commit (struct shmring *ring, size_t fsize)
+{
+    struct ring *r = &ring->tx;
+
+    r->pos += fsize;
+    __atomic_store_n (&r->hdr->head, r->pos, __ATOMIC_RELEASE);
+    notify (ring, &r->hdr->reader_waiting);
+}
+
+static int tx_frame (struct shmring *ring,
+                     const flux_msg_t *msg,
+                     size_t len,
+                     int type)
+{
+    struct frame_hdr fh = { .len = len, .type = type };
+    size_t fsize = FRAME_SIZE (len);
+    uint8_t *p;
+
+    if (tx_reserve (&ring->tx, fsize, &p) < 0)
+        return -1;
+    if (msg && flux_msg_encode (msg, p + sizeof (fh), len) < 0)
+        return -1;
+    memcpy (p, &fh, sizeof (fh));
+    tx_commit (ring, fsize);
+    return 0;
+}
+
+int shmring_send (struct shmring *ring, const flux_msg_t *msg)
+{
+    size_t len;
+
+    if (!ring || !msg) {
+        errno = EINVAL;
+        return -1;
+    }
+    len = flux_msg_encode_size (msg);
+    if (FRAME_SIZE (len) > ring->tx.size / 4) {
+        errno = E2BIG;
+        return -1;
+    }
+    return tx_frame (ring, msg, len, FRAME_MSG);
+}
+
+int shmring_send_redirect (struct shmring *ring)
+{
+    if (!ring) {
+        errno = EINVAL;
+        return -1;
+    }
+    return tx_frame (ring, NULL, 0, FRAME_REDIRECT);
+}
+
+bool shmring_writable (struct shmring *ring)
+{
+    struct ring *r;
+    ssize_t space;
+
+    if (!ring)
+        return false;
+    /* The largest frame plus the largest WRAP frame it could require
+     * fits in half the ring.
+     */
+    r = &ring->tx;
+    if ((space = tx_space (r)) < 0)
+        return false;
+    if (space < r->size / 2) {
+        arm (&r->hdr->writer_waiting);
+        if ((space = tx_space (r)) < 0 || space < r->size / 2)
+            return false;
+        disarm (&r->hdr->writer_waiting);
+    }
+    return true;
+}
+
+/* Find the next frame, skipping any WRAP frame.
+ * Return 0 on success, -1 with errno = EAGAIN or EPROTO on failure.
+ */
+static int rx_peek (struct ring *r, struct frame_hdr *fh, uint8_t **p)
+{
+    for (;;) {
+        uint64_t head = __atomic_load_n (&r->hdr->head, __ATOMIC_ACQUIRE);
+        uint64_t avail = head - r->pos;
+        size_t off = r->pos & (r->size - 1);
+        size_t contig = r->size - off;
+
+        if (avail == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        if (avail > r->size || avail < sizeof (*fh) || (avail & 7))
+            goto proto;
+        memcpy (fh, r->data + off, sizeof (*fh));
+        if (fh->type == FRAME_WRAP) {
+            if (contig > avail)
+                goto proto;
+            r->pos += contig;
+            continue;
+        }
+        if (fh->type != FRAME_MSG && fh->type != FRAME_REDIRECT)
+            goto proto;
+        if (fh->len > contig - sizeof (*fh))
+            goto proto;
+        if (FRAME_SIZE (fh->len) > avail || FRAME_SIZE (fh->len) > contig)
+            goto proto;
+        *p = r->data + off + sizeof (*fh);
+        return 0;
+    }
+proto:
+    errno = EPROTO;
+    return -1;
+}
+
+static int rx_peek_arm (struct ring *r, struct frame_hdr *fh, uint8_t **p)
+{
+    if (rx_peek (r, fh, p) < 0) {
+        if (errno != EAGAIN)
+            return -1;
+        arm (&r->hdr->reader_waiting);
+        if (rx_peek (r, fh, p) < 0)
+            return -1;
+        disarm (&r->hdr->reader_waiting);
+    }
+    return 0;
+}
+
+static void rx_consume (struct shmring *ring, struct frame_hdr *fh)
+{
+    struct ring *r = &ring->rx;
+
+    r->pos += FRAME_SIZE (fh->len);
+    __atomic_store_n (&r->hdr->tail, r->pos, __ATOMIC_RELEASE);
+    notify (ring, &r->hdr->writer_waiting);
+}
+
+int shmring_recv (struct shmring *ring, flux_msg_t **msgp)
+{
+    struct frame_hdr fh;
+    flux_msg_t *msg = NULL;
+    uint8_t *p;
+
+    if (!ring || !msgp) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (rx_peek_arm (&ring->rx, &fh, &p) < 0)
+        return -1;
+    if (fh.type == FRAME_MSG && !(msg = flux_msg_decode (p, fh.len))) {
+        int saved_errno = errno;
+        rx_consume (ring, &fh);
+        errno = saved_errno;
+        return -1;
+    }
+    rx_consume (ring, &fh);
+    if (!msg)
+        return 1;
+    *msgp = msg;
+    return 0;
+}
+
+bool shmring_readable (struct shmring *ring)
+{
+    struct frame_hdr fh;
+    uint8_t *p;
+
+    if (!ring)
+        return false;
+    if (rx_peek_arm (&ring->rx, &fh, &p) < 0)
+        return errno != EAGAIN; // let shmring_recv() report EPROTO
+    return true;
+}
+
+int shmring_get_waitfd (struct shmring *ring)
+{
+    return ring ? ring->waitfd : -1;
+}
+
+void shmring_clear (struct shmring *ring)
+{
+    uint64_t count;
+
+    if (ring)
+        (void)read (ring->waitfd, &count, sizeof (count));
+}
+
+void shmring_get_fds (struct shmring *ring, int fds[SHMRING_NFDS])
+{
+    int i;
+
+    for (i = 0; i < SHMRING_NFDS; i++)
+        fds[i] = ring ? ring->fds[i] : -1;
+}
+
+void shmring_destroy (struct shmring *ring)
+{
+    if (ring) {
+        int saved_errno = errno;
+        int i;
+        if (ring->base)
+            (void)munmap (ring->base, ring->mapsize);
+        for (i = 0; i < SHMRING_NFDS; i++) {
+            if (ring->fds[i] >= 0)
+                (void)close (ring->fds[i]);
+        }
+        free (ring);
+        errno = saved_errno;
+    }
+}
+
+static struct shmring *shmring_alloc (void)
+{
+    struct shmring *ring;
+    int i;
+
+    if (!(ring = calloc (1, sizeof (*ring))))
+        return NULL;
+    for (i = 0; i < SHMRING_NFDS; i++)
+        ring->fds[i] = -1;
+    return ring;
+}
+
+static void hdr_init (struct ring_hdr *hdr, size_t size)
+{
+    memset (hdr, 0, HDR_SIZE);
+    hdr->magic = SHMRING_MAGIC;
+    hdr->size = size;
+}
+
+struct shmring *shmring_create (size_t size)
+{
+    struct shmring *ring;
+
+    if (!valid_size (size)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ring = shmring_alloc ()))
+        return NULL;
+    ring->mapsize = 2 * (HDR_SIZE + size);
+    if ((ring->fds[0] = memfd_create ("flux-shmring",
+                                      MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0
+        || ftruncate (ring->fds[0], ring->mapsize) < 0
+        || fcntl (ring->fds[0],
+                  F_ADD_SEALS,
+                  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+        goto error;
+    if ((ring->fds[1] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0
+        || (ring->fds[2] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        goto error;
+    if ((ring->base = mmap (NULL,
+                            ring->mapsize,
+                            PROT_READ | PROT_WRITE,
+                            MAP_SHARED,
+                            ring->fds[0],
+                            0)) == MAP_FAILED) {
+        ring->base = NULL;
+        goto error;
+    }
+    hdr_init (ring->base, size);
+    hdr_init ((void *)((uint8_t *)ring->base + HDR_SIZE + size), size);
+    ring_init (&ring->tx, ring->base, size);
+    ring_init (&ring->rx, (uint8_t *)ring->base + HDR_SIZE + size, size);
+    ring->waitfd = ring->fds[1];
+    ring->notifyfd = ring->fds[2];
+    return ring;
+error:
+    shmring_destroy (ring);
+    return NULL;
+}
+
+/* Ensure 'fd' is an eventfd, since the server reads and writes it.
+ */
+static int check_eventfd (int fd)
+{
+    char path[64];
+    char link[64];
+    ssize_t n;
+
+    snprintf (path, sizeof (path), "/proc/self/fd/%d", fd);
+    if ((n = readlink (path, link, sizeof (link) - 1)) < 0)
+        return -1;
+    link[n] = '\0';
+    if (strcmp (link, "anon_inode:[eventfd]") != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return fd_set_nonblocking (fd) < 0 ? -1 : 0;
+}
+
+struct shmring *shmring_attach (const int fds[SHMRING_NFDS])
+{
+    struct shmring *ring;
+    struct ring_hdr *hdr[2];
+    struct stat sb;
+    int seals;
+    size_t size;
+    int i;
+
+    if (!fds) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (i = 0; i < SHMRING_NFDS; i++) {
+        if (fds[i] < 0) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    if (fstat (fds[0], &sb) < 0)
+        return NULL;
+    if ((seals = fcntl (fds[0], F_GET_SEALS)) < 0)
+        return NULL;
+    if (!(seals & F_SEAL_SHRINK)
+        || sb.st_size < 2 * HDR_SIZE
+        || check_eventfd (fds[1]) < 0
+        || check_eventfd (fds[2]) < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ring = shmring_alloc ()))
+        return NULL;
+    ring->mapsize = sb.st_size;
+    if ((ring->base = mmap (NULL,
+                            ring->mapsize,
+                            PROT_READ | PROT_WRITE,
+                            MAP_SHARED,
+                            fds[0],
+                            0)) == MAP_FAILED) {
+        ring->base = NULL;
+        goto error;
+    }
+    hdr[0] = ring->base;
+    size = hdr[0]->size;
+    if (!valid_size (size) || 2 * (HDR_SIZE + size) != ring->mapsize)
+        goto inval;
+    hdr[1] = (void *)((uint8_t *)ring->base + HDR_SIZE + size);
+    if (hdr[0]->magic != SHMRING_MAGIC
+        || hdr[1]->magic != SHMRING_MAGIC
+        || hdr[1]->size != size)
+        goto inval;
+    ring_init (&ring->rx, hdr[0], size);
+    ring_init (&ring->tx, hdr[1], size);
+    ring->rx.pos = __atomic_load_n (&hdr[0]->tail, __ATOMIC_ACQUIRE);
+    ring->tx.pos = __atomic_load_n (&hdr[1]->head, __ATOMIC_ACQUIRE);
+    for (i = 0; i < SHMRING_NFDS; i++)
+        ring->fds[i] = fds[i];
+    ring->waitfd = ring->fds[2];
+    ring->notifyfd = ring->fds[1];
+    return ring;
+inval:
+    errno = EINVAL;
+error:
+    shmring_destroy (ring); // fds[] are still -1, caller retains fds
+    return NULL;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
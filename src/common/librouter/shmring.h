@@ -0,0 +1,87 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _ROUTER_SHMRING_H
+#define _ROUTER_SHMRING_H
+
+#include <stdbool.h>
+#include <flux/core.h>
+
+/* A pair of single-producer, single-consumer message rings in shared
+ * memory, one for each direction, with an eventfd per side for wakeups.
+ *
+ * The client calls shmring_create(), sends the file descriptors from
+ * shmring_get_fds() to the server, and the server calls shmring_attach().
+ */
+
+#define SHMRING_SIZE_DEFAULT    (1024*1024)
+#define SHMRING_SIZE_MIN        (64*1024)
+#define SHMRING_SIZE_MAX        (64*1024*1024)
+#define SHMRING_NFDS            3
+
+struct shmring;
+
+/* Create rings of 'size' bytes each (power of 2, between SHMRING_SIZE_MIN
+ * and SHMRING_SIZE_MAX).  The caller is the client side.
+ */
+struct shmring *shmring_create (size_t size);
+
+/* Attach to rings created by shmring_create() in another process.
+ * The caller is the server side.  On success, the fds are owned by
+ * the shmring.  The memfd must be sealed against shrinking.
+ */
+struct shmring *shmring_attach (const int fds[SHMRING_NFDS]);
+
+void shmring_destroy (struct shmring *ring);
+
+/* Get the fds to send to the server (owned by the shmring).
+ */
+void shmring_get_fds (struct shmring *ring, int fds[SHMRING_NFDS]);
+
+/* Get an fd that becomes readable when the peer has added messages to
+ * an empty receive ring, or made space in a full send ring, after this
+ * side found it so.  Call shmring_clear() to reset it.
+ */
+int shmring_get_waitfd (struct shmring *ring);
+void shmring_clear (struct shmring *ring);
+
+/* Encode 'msg' directly into the send ring.  Fail with EAGAIN if there is
+ * not enough space (the peer will signal when there is), or E2BIG if
+ * the message is larger than the ring accepts.
+ */
+int shmring_send (struct shmring *ring, const flux_msg_t *msg);
+
+/* Send a placeholder indicating the next message was sent by other means
+ * (e.g. a message that failed with E2BIG).  Fail with EAGAIN if full.
+ */
+int shmring_send_redirect (struct shmring *ring);
+
+/* Decode the next message directly from the receive ring.
+ * Returns 0 with 'msgp' set, 1 if a redirect placeholder was consumed,
+ * or -1 with errno set: EAGAIN if empty (the peer will signal when
+ * it is not), EPROTO if the ring is corrupt.
+ */
+int shmring_recv (struct shmring *ring, flux_msg_t **msgp);
+
+/* Return true if shmring_recv() would not fail with EAGAIN.
+ * If false, the peer will signal when that changes.
+ */
+bool shmring_readable (struct shmring *ring);
+
+/* Return true if a message of the maximum ring size can be sent.
+ * If false, the peer will signal when that changes.
+ */
+bool shmring_writable (struct shmring *ring);
+
+#endif /* !_ROUTER_SHMRING_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
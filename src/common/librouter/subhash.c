@@ -30,6 +30,8 @@
  *
  * subhash_topic_match() can be used to test if a message topic matches any
  * subscription topics for a given subhash, as an aid to event distribution.
+ * Entries are also indexed by topic prefix in a topic_trie, so matching
+ * cost depends on topic length rather than the number of subscriptions.
  */
 
 #if HAVE_CONFIG_H
@@ -40,6 +42,7 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/errno_safe.h"
+#include "src/common/libutil/topic_trie.h"
 
 #include "subhash.h"
 
@@ -51,6 +54,7 @@ struct subhash_entry {
 
 struct subhash {
     zhashx_t *subs;
+    struct topic_trie *trie;
     subscribe_f unsub;
     void *unsub_arg;
     subscribe_f sub;
@@ -97,27 +101,10 @@ error:
 /* sub="" matches all
  * sub="foo" matches "foo", "foobar", "foo.bar"
  */
-static bool match_event (const char *sub_topic, const char *msg_topic)
-{
-    int len = strlen (sub_topic);
-
-    if (!strncmp (sub_topic, msg_topic, len))
-        return true;
-    return false;
-}
-
 bool subhash_topic_match (struct subhash *sh, const char *topic)
 {
-    struct subhash_entry *entry;
-
-    if (sh && topic) {
-        entry = zhashx_first (sh->subs);
-        while (entry) {
-            if (match_event  (entry->topic, topic))
-                return true;
-            entry = zhashx_next (sh->subs);
-        }
-    }
+    if (sh && topic)
+        return topic_trie_match_any (sh->trie, topic);
     return false;
 }
 
@@ -135,8 +122,13 @@ int subhash_subscribe (struct subhash *sh, const char *topic)
     else {
         if (!(entry = subhash_entry_create (topic)))
             return -1;
+        if (topic_trie_insert (sh->trie, topic, entry) < 0) {
+            subhash_entry_destroy (entry);
+            return -1;
+        }
         if (sh->sub) {
             if (sh->sub (topic, sh->sub_arg) < 0) {
+                (void)topic_trie_remove (sh->trie, topic, entry);
                 subhash_entry_destroy (entry);
                 return -1;
             }
@@ -162,8 +154,10 @@ int subhash_unsubscribe (struct subhash *sh, const char *topic)
                 return -1;
             entry->sh = NULL; // prevent destructor from calling unsub()
         }
-        if (--entry->refcount == 0)
+        if (--entry->refcount == 0) {
+            (void)topic_trie_remove (sh->trie, topic, entry);
             zhashx_delete (sh->subs, topic);
+        }
     }
     else {
         errno = ENOENT;
@@ -193,6 +187,7 @@ void subhash_destroy (struct subhash *sh)
 {
     if (sh) {
         ERRNO_SAFE_WRAP (zhashx_destroy, &sh->subs);
+        topic_trie_destroy (sh->trie);
         ERRNO_SAFE_WRAP (free, sh);
     }
 }
@@ -206,6 +201,8 @@ struct subhash *subhash_create (void)
     if (!(sh->subs = zhashx_new ()))
         goto error;
     zhashx_set_destructor (sh->subs, subhash_entry_destructor);
+    if (!(sh->trie = topic_trie_create ()))
+        goto error;
     return sh;
 error:
     subhash_destroy (sh);
@@ -13,8 +13,10 @@
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdbool.h>
 #include <czmq.h>
 
 #include <flux/core.h>
@@ -106,9 +108,161 @@ void test_eof (void)
     close (pfd[0]);
 }
 
+/* Send several messages with one sendfd_batch() call over a blocking pipe,
+ * then receive them all with one recvbuf_fill() call.
+ */
+void test_batch (void)
+{
+    int pfd[2];
+    struct iobatch b;
+    struct recvbuf rb;
+    flux_msg_t *msg;
+    char topic[32];
+    int i;
+    int errors;
+
+    if (pipe2 (pfd, O_CLOEXEC) < 0)
+        BAIL_OUT ("pipe2 failed");
+    iobatch_init (&b);
+    recvbuf_init (&rb);
+
+    ok (iobatch_empty (&b) && !iobatch_full (&b),
+        "iobatch is initially empty");
+    errors = 0;
+    for (i = 0; i < IOBATCH_MAX; i++) {
+        snprintf (topic, sizeof (topic), "foo.%d", i);
+        if (!(msg = flux_request_encode (topic, NULL)))
+            BAIL_OUT ("flux_request_encode failed");
+        if (iobatch_append (&b, msg) < 0)
+            errors++;
+        flux_msg_destroy (msg);
+    }
+    ok (errors == 0,
+        "iobatch_append works %d times", IOBATCH_MAX);
+    ok (iobatch_full (&b),
+        "iobatch is full");
+    if (!(msg = flux_request_encode ("foo.bar", NULL)))
+        BAIL_OUT ("flux_request_encode failed");
+    errno = 0;
+    ok (iobatch_append (&b, msg) < 0 && errno == EOVERFLOW,
+        "iobatch_append fails with EOVERFLOW when full");
+    flux_msg_destroy (msg);
+
+    ok (sendfd_batch (pfd[1], &b) == 0,
+        "sendfd_batch works");
+    ok (iobatch_empty (&b) && !iobatch_full (&b),
+        "iobatch is empty after send");
+    ok (sendfd_batch (pfd[1], &b) == 0,
+        "sendfd_batch on empty batch works");
+
+    ok (recvbuf_fill (pfd[0], &rb) > 0,
+        "recvbuf_fill works");
+    ok (recvbuf_pending (&rb),
+        "recvbuf_pending is true");
+    errors = 0;
+    for (i = 0; i < IOBATCH_MAX; i++) {
+        const char *s;
+        snprintf (topic, sizeof (topic), "foo.%d", i);
+        if (!(msg = recvbuf_next (&rb))
+            || flux_request_decode (msg, &s, NULL) < 0
+            || strcmp (s, topic) != 0)
+            errors++;
+        flux_msg_destroy (msg);
+    }
+    ok (errors == 0,
+        "recvbuf_next returned %d messages in order", IOBATCH_MAX);
+    ok (!recvbuf_pending (&rb),
+        "recvbuf_pending is false");
+    errno = 0;
+    ok (recvbuf_next (&rb) == NULL && errno == EWOULDBLOCK,
+        "recvbuf_next fails with EWOULDBLOCK when drained");
+
+    close (pfd[1]);
+    errno = 0;
+    ok (recvbuf_recv (pfd[0], &rb) == NULL && errno == ECONNRESET,
+        "recvbuf_recv fails with ECONNRESET when sender closes pipe");
+
+    iobatch_clean (&b);
+    recvbuf_clean (&rb);
+    close (pfd[0]);
+}
+
+/* Send a message larger than the recvbuf spare buffer with sendfd(),
+ * and receive it with recvbuf_recv().
+ */
+void test_batch_large (void)
+{
+    int pfd[2];
+    struct recvbuf rb;
+    flux_msg_t *msg, *msg2;
+    static char buf[65536 + 8192];
+    const void *buf2;
+    int buf2len;
+    pid_t pid;
+
+    memset (buf, 0x0f, sizeof (buf));
+    if (pipe2 (pfd, O_CLOEXEC) < 0)
+        BAIL_OUT ("pipe2 failed");
+    if (!(msg = flux_request_encode_raw ("foo.bar", buf, sizeof (buf))))
+        BAIL_OUT ("flux_request_encode failed");
+    /* The message won't fit in the pipe, so send from a child.
+     */
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork failed");
+    if (pid == 0) {
+        close (pfd[0]);
+        if (sendfd (pfd[1], msg, NULL) < 0)
+            _exit (1);
+        _exit (0);
+    }
+    close (pfd[1]);
+    recvbuf_init (&rb);
+    ok ((msg2 = recvbuf_recv (pfd[0], &rb)) != NULL,
+        "recvbuf_recv works on large message");
+    ok (flux_request_decode_raw (msg2, NULL, &buf2, &buf2len) == 0
+        && buf2len == sizeof (buf)
+        && memcmp (buf, buf2, buf2len) == 0,
+        "received message has expected payload");
+    waitpid (pid, NULL, 0);
+
+    flux_msg_destroy (msg);
+    flux_msg_destroy (msg2);
+    recvbuf_clean (&rb);
+    close (pfd[0]);
+}
+
+/* Write garbage to a pipe and ensure recvbuf_next fails with EPROTO.
+ */
+void test_batch_proto (void)
+{
+    int pfd[2];
+    struct recvbuf rb;
+    char junk[16];
+
+    memset (junk, 0x55, sizeof (junk));
+    if (pipe2 (pfd, O_CLOEXEC) < 0)
+        BAIL_OUT ("pipe2 failed");
+    if (write (pfd[1], junk, sizeof (junk)) != sizeof (junk))
+        BAIL_OUT ("write failed");
+    recvbuf_init (&rb);
+    ok (recvbuf_fill (pfd[0], &rb) == sizeof (junk),
+        "recvbuf_fill read garbage");
+    errno = 0;
+    ok (recvbuf_next (&rb) == NULL && errno == EPROTO,
+        "recvbuf_next fails with EPROTO on bad magic");
+    ok (!recvbuf_pending (&rb),
+        "recvbuf_pending is false on bad magic");
+
+    recvbuf_clean (&rb);
+    close (pfd[1]);
+    close (pfd[0]);
+}
+
 struct io {
     zlist_t *queue;
     struct iobuf iobuf;
+    struct iobatch batch;
+    struct recvbuf rb;
     int fd;
     flux_watcher_t *w;
     int max;
@@ -165,6 +319,69 @@ void send_cb (flux_reactor_t *r, flux_watcher_t *w, int revents, void *arg)
     }
 }
 
+void recv_batch_cb (flux_reactor_t *r,
+                    flux_watcher_t *w,
+                    int revents,
+                    void *arg)
+{
+    struct io *io = arg;
+
+    if ((revents & FLUX_POLLERR))
+        BAIL_OUT ("recv_batch_cb POLLERR");
+    if ((revents & FLUX_POLLIN)) {
+        flux_msg_t *msg;
+        if (recvbuf_fill (io->fd, &io->rb) < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                diag ("recv EWOULDBLOCK");
+                return;
+            }
+            BAIL_OUT ("recvbuf_fill error: %s", strerror (errno));
+        }
+        while ((msg = recvbuf_next (&io->rb))) {
+            if (zlist_append (io->queue, msg) < 0)
+                BAIL_OUT ("zlist_append failed");
+        }
+        if (errno != EWOULDBLOCK)
+            BAIL_OUT ("recvbuf_next error: %s", strerror (errno));
+        if (zlist_size (io->queue) == io->max) {
+            diag ("recv queue full, stopping receiver");
+            flux_watcher_stop (io->w);
+        }
+    }
+}
+
+void send_batch_cb (flux_reactor_t *r,
+                    flux_watcher_t *w,
+                    int revents,
+                    void *arg)
+{
+    struct io *io = arg;
+
+    if ((revents & FLUX_POLLERR))
+        BAIL_OUT ("send_batch_cb POLLERR");
+    if ((revents & FLUX_POLLOUT)) {
+        flux_msg_t *msg;
+
+        while (!iobatch_full (&io->batch)
+               && (msg = zlist_pop (io->queue))) {
+            if (iobatch_append (&io->batch, msg) < 0)
+                BAIL_OUT ("iobatch_append error: %s", strerror (errno));
+            flux_msg_destroy (msg);
+        }
+        if (sendfd_batch (io->fd, &io->batch) < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                diag ("send EWOULDBLOCK");
+                return;
+            }
+            BAIL_OUT ("sendfd_batch error: %s", strerror (errno));
+        }
+        if (zlist_size (io->queue) == 0) {
+            diag ("send queue empty, stopping sender");
+            flux_watcher_stop (io->w);
+        }
+    }
+}
+
 void io_destroy (struct io *io)
 {
     if (io) {
@@ -177,6 +394,8 @@ void io_destroy (struct io *io)
         }
         flux_watcher_destroy (io->w);
         iobuf_clean (&io->iobuf);
+        iobatch_clean (&io->batch);
+        recvbuf_clean (&io->rb);
         free (io);
         errno = saved_errno;
     }
@@ -191,6 +410,8 @@ struct io *io_create (flux_reactor_t *r,
     if (!(io = calloc (1, sizeof (*io))))
         return NULL;
     iobuf_init (&io->iobuf);
+    iobatch_init (&io->batch);
+    recvbuf_init (&io->rb);
     if (!(io->queue = zlist_new ()))
         goto error;
     io->fd = fd;
@@ -211,9 +432,11 @@ error:
  * - sender sends all enqueued messages
  * - receiver enqueues all recived messages
  * Verify that messages are all received intact.
+ * If 'batch' is true, use sendfd_batch() and recvbuf_fill().
  */
-void test_nonblock (int size, int count)
+void test_nonblock (int size, int count, bool batch)
 {
+    const char *name = batch ? "nonblock batch" : "nonblock";
     int pfd[2];
     struct io *iow;
     struct io *ior;
@@ -231,9 +454,15 @@ void test_nonblock (int size, int count)
         BAIL_OUT ("flux_reactor_create failed");
     if (pipe2 (pfd, O_CLOEXEC) < 0)
         BAIL_OUT ("pipe2 failed");
-    if (!(iow = io_create (r, pfd[1], FLUX_POLLOUT, send_cb)))
+    if (!(iow = io_create (r,
+                           pfd[1],
+                           FLUX_POLLOUT,
+                           batch ? send_batch_cb : send_cb)))
         BAIL_OUT ("io_create failed: %s", flux_strerror (errno));
-    if (!(ior = io_create (r, pfd[0], FLUX_POLLIN, recv_cb)))
+    if (!(ior = io_create (r,
+                           pfd[0],
+                           FLUX_POLLIN,
+                           batch ? recv_batch_cb : recv_cb)))
         BAIL_OUT ("io_create failed: %s", flux_strerror (errno));
 
     for (i = 0; i < count; i++) {
@@ -247,10 +476,11 @@ void test_nonblock (int size, int count)
     diag ("messages enqueued, starting reactor", count);
 
     ok (flux_reactor_run (r, 0) == 0,
-        "nonblock %d,%d: reactor ran", count, size);
+        "%s %d,%d: reactor ran", name, count, size);
 
     ok (zlist_size (ior->queue) == count,
-        "nonblock %d,%d: all messages received",
+        "%s %d,%d: all messages received",
+        name,
         count,
         size);
 
@@ -280,7 +510,8 @@ next:
     }
 
     ok (errors == 0,
-        "nonblock %d,%d: received messages are intact",
+        "%s %d,%d: received messages are intact",
+        name,
         count,
         size);
 
@@ -310,6 +541,19 @@ void test_inval (void)
     ok (sendfd (0, NULL, NULL) < 0 && errno == EINVAL,
         "senfd msg=NULL fails with EINVAL");
 
+    errno = 0;
+    ok (iobatch_append (NULL, msg) < 0 && errno == EINVAL,
+        "iobatch_append b=NULL fails with EINVAL");
+    errno = 0;
+    ok (sendfd_batch (-1, NULL) < 0 && errno == EINVAL,
+        "sendfd_batch fd=-1 fails with EINVAL");
+    errno = 0;
+    ok (recvbuf_fill (-1, NULL) < 0 && errno == EINVAL,
+        "recvbuf_fill fd=-1 fails with EINVAL");
+    errno = 0;
+    ok (recvbuf_next (NULL) == NULL && errno == EINVAL,
+        "recvbuf_next rb=NULL fails with EINVAL");
+
     flux_msg_destroy (msg);
 }
 
@@ -320,10 +564,17 @@ int main (int argc, char *argv[])
     test_basic ();
     test_large ();
     test_eof ();
-    test_nonblock (1024, 1024);
-    test_nonblock (4096, 256);
-    test_nonblock (16384, 64);
-    test_nonblock (1048586, 1);
+    test_nonblock (1024, 1024, false);
+    test_nonblock (4096, 256, false);
+    test_nonblock (16384, 64, false);
+    test_nonblock (1048586, 1, false);
+    test_batch ();
+    test_batch_large ();
+    test_batch_proto ();
+    test_nonblock (64, 4096, true);
+    test_nonblock (1024, 1024, true);
+    test_nonblock (16384, 64, true);
+    test_nonblock (1048586, 1, true);
     test_inval ();
 
     done_testing();
@@ -0,0 +1,398 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <string.h>
+#include <errno.h>
+#include <flux/core.h>
+
+#include "src/common/librouter/shmring.h"
+#include "src/common/libtap/tap.h"
+
+/* Attach server side to 'client' in the same process.
+ * shmring_attach() takes ownership of the fds, so pass duplicates.
+ */
+static struct shmring *attach_dup (struct shmring *client)
+{
+    int fds[SHMRING_NFDS];
+    int dups[SHMRING_NFDS];
+    struct shmring *server;
+    int i;
+
+    shmring_get_fds (client, fds);
+    for (i = 0; i < SHMRING_NFDS; i++) {
+        if ((dups[i] = fcntl (fds[i], F_DUPFD_CLOEXEC, 0)) < 0)
+            BAIL_OUT ("dup failed");
+    }
+    if (!(server = shmring_attach (dups)))
+        BAIL_OUT ("shmring_attach failed: %s", strerror (errno));
+    return server;
+}
+
+static flux_msg_t *create_msg (const char *topic, int size)
+{
+    flux_msg_t *msg;
+    char *buf = NULL;
+
+    if (size > 0) {
+        if (!(buf = malloc (size)))
+            BAIL_OUT ("malloc failed");
+        memset (buf, 'x', size);
+    }
+    if (!(msg = flux_request_encode_raw (topic, buf, size)))
+        BAIL_OUT ("flux_request_encode_raw failed");
+    free (buf);
+    return msg;
+}
+
+static bool check_msg (const flux_msg_t *msg, const char *topic, int size)
+{
+    const char *s;
+    const void *buf;
+    int len;
+
+    if (flux_request_decode_raw (msg, &s, &buf, &len) < 0
+        || strcmp (s, topic) != 0
+        || len != size)
+        return false;
+    return true;
+}
+
+static bool is_signaled (struct shmring *ring)
+{
+    struct pollfd pfd = {
+        .fd = shmring_get_waitfd (ring),
+        .events = POLLIN,
+    };
+    return (poll (&pfd, 1, 0) == 1);
+}
+
+void test_basic (void)
+{
+    struct shmring *client;
+    struct shmring *server;
+    flux_msg_t *msg;
+    flux_msg_t *rmsg = NULL;
+
+    ok ((client = shmring_create (SHMRING_SIZE_MIN)) != NULL,
+        "shmring_create works");
+    server = attach_dup (client);
+    ok (server != NULL,
+        "shmring_attach works");
+
+    msg = create_msg ("foo.bar", 42);
+    ok (shmring_readable (server) == false,
+        "server ring is not readable");
+    ok (shmring_send (client, msg) == 0,
+        "client shmring_send works");
+    ok (is_signaled (server),
+        "server waitfd was signaled since it found the ring empty");
+    shmring_clear (server);
+    ok (!is_signaled (server),
+        "shmring_clear reset server waitfd");
+    ok (shmring_readable (server) == true,
+        "server ring is readable");
+    ok (shmring_recv (server, &rmsg) == 0 && check_msg (rmsg, "foo.bar", 42),
+        "server shmring_recv got expected message");
+    flux_msg_destroy (rmsg);
+    errno = 0;
+    ok (shmring_recv (server, &rmsg) < 0 && errno == EAGAIN,
+        "server shmring_recv fails with EAGAIN when empty");
+
+    ok (shmring_send (server, msg) == 0,
+        "server shmring_send works");
+    ok (!is_signaled (client),
+        "client waitfd was not signaled since it did not find ring empty");
+    ok (shmring_recv (client, &rmsg) == 0 && check_msg (rmsg, "foo.bar", 42),
+        "client shmring_recv got expected message");
+    flux_msg_destroy (rmsg);
+
+    ok (shmring_send_redirect (client) == 0,
+        "client shmring_send_redirect works");
+    ok (shmring_recv (server, &rmsg) == 1,
+        "server shmring_recv returns 1 for redirect");
+
+    flux_msg_destroy (msg);
+    msg = create_msg ("big", SHMRING_SIZE_MIN / 4);
+    errno = 0;
+    ok (shmring_send (client, msg) < 0 && errno == E2BIG,
+        "shmring_send fails with E2BIG on large message");
+    flux_msg_destroy (msg);
+
+    shmring_destroy (server);
+    shmring_destroy (client);
+}
+
+/* Fill the ring, then drain it, several times so that it wraps.
+ */
+void test_full (void)
+{
+    struct shmring *client;
+    struct shmring *server;
+    flux_msg_t *msg;
+    flux_msg_t *rmsg;
+    char topic[32];
+    int sent;
+    int recvd;
+    int errors;
+    int round;
+
+    if (!(client = shmring_create (SHMRING_SIZE_MIN)))
+        BAIL_OUT ("shmring_create failed");
+    server = attach_dup (client);
+
+    for (round = 0; round < 4; round++) {
+        sent = 0;
+        for (;;) {
+            snprintf (topic, sizeof (topic), "%d", sent);
+            msg = create_msg (topic, 1000 + round * 333);
+            if (shmring_send (client, msg) < 0) {
+                flux_msg_destroy (msg);
+                break;
+            }
+            flux_msg_destroy (msg);
+            sent++;
+        }
+        ok (errno == EAGAIN && sent > 0,
+            "round %d: shmring_send fails with EAGAIN after %d messages",
+            round,
+            sent);
+        ok (shmring_writable (client) == false,
+            "round %d: client ring is not writable",
+            round);
+        ok (!is_signaled (client),
+            "round %d: client waitfd is not signaled",
+            round);
+        errors = 0;
+        recvd = 0;
+        while (shmring_recv (server, &rmsg) == 0) {
+            snprintf (topic, sizeof (topic), "%d", recvd++);
+            if (!check_msg (rmsg, topic, 1000 + round * 333))
+                errors++;
+            flux_msg_destroy (rmsg);
+        }
+        ok (recvd == sent && errors == 0,
+            "round %d: received %d messages in order",
+            round,
+            recvd);
+        ok (is_signaled (client),
+            "round %d: client waitfd was signaled when space was made",
+            round);
+        shmring_clear (client);
+        ok (shmring_writable (client) == true,
+            "round %d: client ring is writable",
+            round);
+    }
+
+    shmring_destroy (server);
+    shmring_destroy (client);
+}
+
+/* Stream messages from a child process to the parent, which waits on
+ * the waitfd when the ring is empty.
+ */
+void test_fork (int count)
+{
+    struct shmring *client;
+    struct shmring *server;
+    flux_msg_t *rmsg;
+    char topic[32];
+    int recvd = 0;
+    int errors = 0;
+    int status;
+    pid_t pid;
+
+    if (!(client = shmring_create (SHMRING_SIZE_MIN)))
+        BAIL_OUT ("shmring_create failed");
+    server = attach_dup (client);
+
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork failed");
+    if (pid == 0) {
+        int i;
+        for (i = 0; i < count; i++) {
+            flux_msg_t *msg;
+            struct pollfd pfd = {
+                .fd = shmring_get_waitfd (client),
+                .events = POLLIN,
+            };
+            snprintf (topic, sizeof (topic), "%d", i);
+            msg = create_msg (topic, i % 2000);
+            while (shmring_send (client, msg) < 0) {
+                if (errno != EAGAIN || poll (&pfd, 1, -1) < 0)
+                    _exit (1);
+                shmring_clear (client);
+            }
+            flux_msg_destroy (msg);
+        }
+        _exit (0);
+    }
+    while (recvd < count) {
+        if (shmring_recv (server, &rmsg) < 0) {
+            struct pollfd pfd = {
+                .fd = shmring_get_waitfd (server),
+                .events = POLLIN,
+            };
+            if (errno != EAGAIN || poll (&pfd, 1, -1) < 0) {
+                diag ("shmring_recv: %s", strerror (errno));
+                break;
+            }
+            shmring_clear (server);
+            continue;
+        }
+        snprintf (topic, sizeof (topic), "%d", recvd);
+        if (!check_msg (rmsg, topic, recvd % 2000))
+            errors++;
+        flux_msg_destroy (rmsg);
+        recvd++;
+    }
+    ok (waitpid (pid, &status, 0) == pid && WIFEXITED (status)
+        && WEXITSTATUS (status) == 0,
+        "child sent %d messages", count);
+    ok (recvd == count && errors == 0,
+        "parent received %d messages in order", recvd);
+
+    shmring_destroy (server);
+    shmring_destroy (client);
+}
+
+/* Simulate a misbehaving client by scribbling on the ring header.
+ */
+void test_corrupt (void)
+{
+    struct shmring *client;
+    struct shmring *server;
+    flux_msg_t *rmsg;
+    int fds[SHMRING_NFDS];
+    uint64_t *head;
+    void *base;
+
+    if (!(client = shmring_create (SHMRING_SIZE_MIN)))
+        BAIL_OUT ("shmring_create failed");
+    server = attach_dup (client);
+    shmring_get_fds (client, fds);
+    base = mmap (NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (base == MAP_FAILED)
+        BAIL_OUT ("mmap failed");
+    head = (uint64_t *)((char *)base + 64);
+
+    *head = SHMRING_SIZE_MIN * 2;
+    errno = 0;
+    ok (shmring_recv (server, &rmsg) < 0 && errno == EPROTO,
+        "shmring_recv fails with EPROTO if head is too far ahead");
+    *head = 16;
+    memset ((char *)base + 256, 0xff, 16);
+    errno = 0;
+    ok (shmring_recv (server, &rmsg) < 0 && errno == EPROTO,
+        "shmring_recv fails with EPROTO on bad frame");
+    *head = 16;
+    memset ((char *)base + 256, 0, 16);
+    *(uint32_t *)((char *)base + 256) = 0xffffffff; // len
+    *(uint32_t *)((char *)base + 260) = 1;          // type=FRAME_MSG
+    errno = 0;
+    ok (shmring_recv (server, &rmsg) < 0 && errno == EPROTO,
+        "shmring_recv fails with EPROTO on frame len=0xffffffff");
+
+    munmap (base, 4096);
+    shmring_destroy (server);
+    shmring_destroy (client);
+}
+
+void test_inval (void)
+{
+    struct shmring *client;
+    flux_msg_t *msg;
+    int fds[SHMRING_NFDS];
+    int bad[SHMRING_NFDS];
+    int pfd[2];
+
+    if (!(msg = flux_request_encode ("foo", NULL)))
+        BAIL_OUT ("flux_request_encode failed");
+
+    errno = 0;
+    ok (shmring_create (SHMRING_SIZE_MIN + 1) == NULL && errno == EINVAL,
+        "shmring_create size=non-power-of-2 fails with EINVAL");
+    errno = 0;
+    ok (shmring_create (SHMRING_SIZE_MIN / 2) == NULL && errno == EINVAL,
+        "shmring_create size=too small fails with EINVAL");
+    errno = 0;
+    ok (shmring_attach (NULL) == NULL && errno == EINVAL,
+        "shmring_attach fds=NULL fails with EINVAL");
+
+    if (!(client = shmring_create (SHMRING_SIZE_MIN)))
+        BAIL_OUT ("shmring_create failed");
+    shmring_get_fds (client, fds);
+    if (pipe2 (pfd, O_CLOEXEC) < 0)
+        BAIL_OUT ("pipe2 failed");
+    bad[0] = fds[0];
+    bad[1] = pfd[0];
+    bad[2] = pfd[1];
+    errno = 0;
+    ok (shmring_attach (bad) == NULL && errno == EINVAL,
+        "shmring_attach fails with EINVAL if fds are not eventfds");
+    bad[0] = fds[1];
+    bad[1] = fds[1];
+    bad[2] = fds[2];
+    errno = 0;
+    ok (shmring_attach (bad) == NULL,
+        "shmring_attach fails if memfd is not a memfd");
+    close (pfd[0]);
+    close (pfd[1]);
+
+    errno = 0;
+    ok (shmring_send (NULL, msg) < 0 && errno == EINVAL,
+        "shmring_send ring=NULL fails with EINVAL");
+    errno = 0;
+    ok (shmring_send (client, NULL) < 0 && errno == EINVAL,
+        "shmring_send msg=NULL fails with EINVAL");
+    errno = 0;
+    ok (shmring_send_redirect (NULL) < 0 && errno == EINVAL,
+        "shmring_send_redirect ring=NULL fails with EINVAL");
+    errno = 0;
+    ok (shmring_recv (NULL, NULL) < 0 && errno == EINVAL,
+        "shmring_recv ring=NULL fails with EINVAL");
+    ok (shmring_readable (NULL) == false,
+        "shmring_readable ring=NULL returns false");
+    ok (shmring_writable (NULL) == false,
+        "shmring_writable ring=NULL returns false");
+    ok (shmring_get_waitfd (NULL) == -1,
+        "shmring_get_waitfd ring=NULL returns -1");
+    lives_ok ({shmring_destroy (NULL);},
+        "shmring_destroy ring=NULL doesn't crash");
+
+    shmring_destroy (client);
+    flux_msg_destroy (msg);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_full ();
+    test_fork (100000);
+    test_corrupt ();
+    test_inval ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
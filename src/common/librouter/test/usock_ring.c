@@ -0,0 +1,503 @@
+/************************************************************  \
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <flux/core.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/unlink_recursive.h"
+#include "src/common/libtestutil/util.h"
+#include "src/common/librouter/usock.h"
+#include "src/common/librouter/sendfd.h"
+#include "src/common/librouter/shmring.h"
+
+/* Test Server
+ *
+ * Accept all connections on <tmpdir>/server.
+ * Echo messages back to sender.
+ * Destroy connection on error callback.
+ */
+
+static char tmpdir[PATH_MAX + 1];
+static char sockpath[PATH_MAX + 1];
+
+static void tmpdir_destroy (void)
+{
+    diag ("rm -r %s", tmpdir);
+    if (unlink_recursive (tmpdir) < 0)
+        BAIL_OUT ("unlink_recursive failed");
+}
+
+static void tmpdir_create (void)
+{
+    const char *tmp = getenv ("TMPDIR");
+
+    if (snprintf (tmpdir,
+                  sizeof (tmpdir),
+                  "%s/usock.XXXXXXX",
+                  tmp ? tmp : "/tmp") >= sizeof (tmpdir))
+        BAIL_OUT ("tmpdir_create buffer overflow");
+    if (!mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp %s: %s", tmpdir, strerror (errno));
+    diag ("mkdir %s", tmpdir);
+    if (snprintf (sockpath,
+                  sizeof (sockpath),
+                  "%s/server",
+                  tmpdir) >= sizeof (sockpath))
+        BAIL_OUT ("sockpath buffer overflow");
+}
+
+static void server_recv_cb (struct usock_conn *conn, flux_msg_t *msg, void *arg)
+{
+    if (usock_conn_send (conn, msg) < 0)
+        diag ("usock_conn_send failed: %s", flux_strerror (errno));
+}
+
+static void server_error_cb (struct usock_conn *conn, int errnum, void *arg)
+{
+    diag ("server_error_cb uuid=%.5s: %s",
+         usock_conn_get_uuid (conn),
+         flux_strerror (errnum));
+
+    usock_conn_destroy (conn);
+}
+
+static void server_acceptor (struct usock_conn *conn, void *arg)
+{
+    usock_conn_set_error_cb (conn, server_error_cb, NULL);
+    usock_conn_set_recv_cb (conn, server_recv_cb, NULL);
+
+    usock_conn_accept (conn, usock_conn_get_cred (conn));
+}
+
+static int server_cb (flux_t *h, void *arg)
+{
+    flux_reactor_t *r = flux_get_reactor (h);
+    struct usock_server *server;
+
+    if (!(server = usock_server_create (r, sockpath, 0644))) {
+        diag ("usock_server_create failed");
+        return -1;
+    }
+    usock_server_set_acceptor (server, server_acceptor, NULL);
+
+    if (flux_reactor_run (r, 0) < 0) {
+        diag ("flux_reactor_run failed");
+        return -1;
+    }
+    usock_server_destroy (server);
+    return 0;
+}
+
+/* End Test Server
+ */
+
+static struct usock_client *client_connect (int *fdp)
+{
+    struct usock_client *client;
+    int fd;
+
+    if ((fd = usock_client_connect (sockpath, USOCK_RETRY_DEFAULT)) < 0)
+        BAIL_OUT ("usock_client_connect failed");
+    if (!(client = usock_client_create (fd)))
+        BAIL_OUT ("usock_client_create failed");
+    *fdp = fd;
+    return client;
+}
+
+static void client_disconnect (struct usock_client *client, int fd)
+{
+    usock_client_destroy (client);
+    (void)close (fd);
+}
+
+/* Create request with 'size' byte payload filled with 'c'.
+ */
+static flux_msg_t *create_msg (const char *topic, int size, char c)
+{
+    flux_msg_t *msg;
+    char *buf;
+
+    if (!(buf = malloc (size)))
+        BAIL_OUT ("malloc failed");
+    memset (buf, c, size);
+    if (!(msg = flux_request_encode_raw (topic, buf, size)))
+        BAIL_OUT ("flux_request_encode_raw failed");
+    free (buf);
+    return msg;
+}
+
+static bool check_msg (const flux_msg_t *msg,
+                       const char *topic,
+                       int size,
+                       char c)
+{
+    const char *s;
+    const char *buf;
+    int len;
+    int i;
+
+    if (flux_msg_get_topic (msg, &s) < 0 || strcmp (s, topic) != 0)
+        return false;
+    if (flux_msg_get_payload (msg, (const void **)&buf, &len) < 0
+        || len != size)
+        return false;
+    for (i = 0; i < len; i++) {
+        if (buf[i] != c)
+            return false;
+    }
+    return true;
+}
+
+/* Check that the server is still answering over a fresh connection.
+ */
+static bool server_alive (void)
+{
+    struct usock_client *client;
+    flux_msg_t *msg;
+    flux_msg_t *rmsg = NULL;
+    bool result;
+    int fd;
+
+    client = client_connect (&fd);
+    msg = create_msg ("alive", 16, 'x');
+    result = usock_client_send (client, msg, 0) == 0
+          && (rmsg = usock_client_recv (client, 0)) != NULL
+          && check_msg (rmsg, "alive", 16, 'x');
+    flux_msg_destroy (rmsg);
+    flux_msg_destroy (msg);
+    client_disconnect (client, fd);
+    return result;
+}
+
+/* Attach rings and echo one small message through them.
+ */
+static void test_attach (void)
+{
+    struct usock_client *client;
+    flux_msg_t *msg;
+    flux_msg_t *rmsg = NULL;
+    int fd;
+
+    client = client_connect (&fd);
+    ok (usock_client_attach_ring (client, SHMRING_SIZE_MIN) == 0,
+        "usock_client_attach_ring works");
+    errno = 0;
+    ok (usock_client_attach_ring (client, SHMRING_SIZE_MIN) < 0
+        && errno == EINVAL,
+        "usock_client_attach_ring fails with EINVAL when attached");
+
+    msg = create_msg ("a", 64, 'a');
+    ok (usock_client_send (client, msg, 0) == 0,
+        "usock_client_send works");
+    ok ((rmsg = usock_client_recv (client, 0)) != NULL
+        && check_msg (rmsg, "a", 64, 'a'),
+        "usock_client_recv got echoed message");
+    flux_msg_destroy (rmsg);
+    flux_msg_destroy (msg);
+
+    client_disconnect (client, fd);
+}
+
+/* Interleave messages that fit the minimum ring size with messages that
+ * must be redirected to the socket, in both directions.  Send them all
+ * before receiving any, then check they come back in order.
+ */
+static void test_redirect_order (void)
+{
+    const int sizes[] = { 16, 128*1024, 16, 16, 1024*1024, 32*1024, 16 };
+    const int count = sizeof (sizes) / sizeof (sizes[0]);
+    struct usock_client *client;
+    flux_msg_t *msg;
+    char topic[16];
+    int errors;
+    int i;
+    int fd;
+
+    client = client_connect (&fd);
+    if (usock_client_attach_ring (client, SHMRING_SIZE_MIN) < 0)
+        BAIL_OUT ("usock_client_attach_ring failed");
+
+    errors = 0;
+    for (i = 0; i < count; i++) {
+        snprintf (topic, sizeof (topic), "m%d", i);
+        msg = create_msg (topic, sizes[i], 'a' + i);
+        if (usock_client_send (client, msg, 0) < 0) {
+            diag ("usock_client_send: %s", strerror (errno));
+            errors++;
+        }
+        flux_msg_destroy (msg);
+    }
+    ok (errors == 0,
+        "sent %d messages, some larger than the ring", count);
+
+    errors = 0;
+    for (i = 0; i < count; i++) {
+        snprintf (topic, sizeof (topic), "m%d", i);
+        if (!(msg = usock_client_recv (client, 0))) {
+            diag ("usock_client_recv: %s", strerror (errno));
+            errors++;
+            break;
+        }
+        if (!check_msg (msg, topic, sizes[i], 'a' + i)) {
+            diag ("message %d is out of order or corrupt", i);
+            errors++;
+        }
+        flux_msg_destroy (msg);
+    }
+    ok (errors == 0,
+        "received %d messages in order", count);
+
+    client_disconnect (client, fd);
+}
+
+/* Send a usock.ring-attach request with 'fds' (if any) as SCM_RIGHTS.
+ */
+static int send_attach (int fd, const int *fds, int nfds)
+{
+    struct iobuf iobuf;
+    flux_msg_t *msg;
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    int rc;
+
+    iobuf_init (&iobuf);
+    if (!(msg = flux_request_encode ("usock.ring-attach", NULL)))
+        BAIL_OUT ("flux_request_encode failed");
+    while ((rc = nfds > 0 ? sendfd_rights (fd, msg, fds, nfds, &iobuf)
+                          : sendfd (fd, msg, &iobuf)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            break;
+        (void)poll (&pfd, 1, -1);
+    }
+    iobuf_clean (&iobuf);
+    flux_msg_destroy (msg);
+    return rc;
+}
+
+/* Receive the usock.ring-attach response and return its errnum.
+ */
+static int recv_attach_response (struct usock_client *client)
+{
+    flux_msg_t *msg;
+    int errnum = EPROTO;
+
+    if ((msg = usock_client_recv (client, 0))) {
+        if (flux_msg_get_errnum (msg, &errnum) < 0)
+            errnum = EPROTO;
+        flux_msg_destroy (msg);
+    }
+    return errnum;
+}
+
+static int create_memfd (bool seal)
+{
+    int fd;
+
+    if ((fd = memfd_create ("test", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+        BAIL_OUT ("memfd_create failed");
+    if (ftruncate (fd, 4 * SHMRING_SIZE_MIN) < 0)
+        BAIL_OUT ("ftruncate failed");
+    if (seal && fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+        BAIL_OUT ("F_ADD_SEALS failed");
+    return fd;
+}
+
+static int create_eventfd (void)
+{
+    int fd;
+
+    if ((fd = eventfd (0, EFD_CLOEXEC)) < 0)
+        BAIL_OUT ("eventfd failed");
+    return fd;
+}
+
+/* Send a ring-attach request with bad fds.  Expect an EINVAL response,
+ * after which the connection keeps working over the socket.
+ */
+static void check_reject (const int *fds, int nfds, const char *desc)
+{
+    struct usock_client *client;
+    flux_msg_t *msg;
+    flux_msg_t *rmsg = NULL;
+    int fd;
+    int i;
+
+    client = client_connect (&fd);
+    ok (send_attach (fd, fds, nfds) == 0
+        && recv_attach_response (client) == EINVAL,
+        "ring-attach with %s fails with EINVAL", desc);
+    msg = create_msg ("a", 64, 'a');
+    ok (usock_client_send (client, msg, 0) == 0
+        && (rmsg = usock_client_recv (client, 0)) != NULL
+        && check_msg (rmsg, "a", 64, 'a'),
+        "echo still works over the socket");
+    flux_msg_destroy (rmsg);
+    flux_msg_destroy (msg);
+    client_disconnect (client, fd);
+
+    for (i = 0; i < nfds; i++)
+        (void)close (fds[i]);
+}
+
+static void test_reject (void)
+{
+    int fds[SHMRING_NFDS];
+    int pfds[2];
+
+    fds[0] = create_memfd (false);
+    fds[1] = create_eventfd ();
+    fds[2] = create_eventfd ();
+    check_reject (fds, 3, "unsealed memfd");
+
+    if (pipe2 (pfds, O_CLOEXEC) < 0)
+        BAIL_OUT ("pipe2 failed");
+    fds[0] = create_memfd (true);
+    fds[1] = pfds[0];
+    fds[2] = pfds[1];
+    check_reject (fds, 3, "pipe instead of eventfds");
+
+    if ((fds[0] = open ("/dev/null", O_RDWR | O_CLOEXEC)) < 0)
+        BAIL_OUT ("open /dev/null failed");
+    fds[1] = create_eventfd ();
+    fds[2] = create_eventfd ();
+    check_reject (fds, 3, "/dev/null instead of memfd");
+
+    fds[0] = create_memfd (true);
+    fds[1] = create_eventfd ();
+    check_reject (fds, 2, "two fds");
+
+    check_reject (fds, 0, "no fds");
+}
+
+/* Receive a message from a ring owned by the test, waiting if empty.
+ */
+static int ring_recv_wait (struct shmring *ring, flux_msg_t **msgp)
+{
+    struct pollfd pfd = { .fd = shmring_get_waitfd (ring), .events = POLLIN };
+    int rc;
+
+    while ((rc = shmring_recv (ring, msgp)) < 0 && errno == EAGAIN) {
+        if (poll (&pfd, 1, 5000) != 1)
+            return -1;
+        shmring_clear (ring);
+    }
+    return rc;
+}
+
+/* Attach rings by hand, then put a redirect placeholder in the ring and
+ * disconnect without sending the redirected message, so the server
+ * connection is destroyed with ring_owed > 0.
+ */
+static void test_teardown_server_owed (void)
+{
+    struct usock_client *client;
+    struct shmring *ring;
+    int fds[SHMRING_NFDS];
+    flux_msg_t *msg;
+    flux_msg_t *rmsg = NULL;
+    int fd;
+
+    client = client_connect (&fd);
+    if (!(ring = shmring_create (SHMRING_SIZE_MIN)))
+        BAIL_OUT ("shmring_create failed");
+    shmring_get_fds (ring, fds);
+    ok (send_attach (fd, fds, SHMRING_NFDS) == 0
+        && recv_attach_response (client) == 0,
+        "ring-attach with valid fds works");
+
+    msg = create_msg ("a", 64, 'a');
+    ok (shmring_send (ring, msg) == 0
+        && ring_recv_wait (ring, &rmsg) == 0
+        && check_msg (rmsg, "a", 64, 'a'),
+        "echo works through the ring");
+    flux_msg_destroy (rmsg);
+
+    ok (shmring_send_redirect (ring) == 0 && shmring_send (ring, msg) == 0,
+        "sent redirect placeholder and a message behind it");
+    flux_msg_destroy (msg);
+
+    diag ("disconnecting without sending redirected message");
+    client_disconnect (client, fd);
+    shmring_destroy (ring);
+
+    ok (server_alive (),
+        "server survives connection teardown with redirect owed");
+}
+
+/* Disconnect while the echo of a redirected message is in flight.
+ * The non-blocking receive may find the placeholder but only part of
+ * the message, leaving the client with ring_owed > 0.
+ */
+static void test_teardown_client_owed (void)
+{
+    struct usock_client *client;
+    flux_msg_t *msg;
+    int fd;
+
+    client = client_connect (&fd);
+    if (usock_client_attach_ring (client, SHMRING_SIZE_MIN) < 0)
+        BAIL_OUT ("usock_client_attach_ring failed");
+    msg = create_msg ("big", 1024*1024, 'b');
+    ok (usock_client_send (client, msg, 0) == 0,
+        "sent message larger than the ring");
+    flux_msg_destroy (msg);
+    flux_msg_destroy (usock_client_recv (client, FLUX_O_NONBLOCK));
+
+    diag ("disconnecting with redirected echo in flight");
+    client_disconnect (client, fd);
+
+    ok (server_alive (),
+        "server survives client teardown with redirect in flight");
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h;
+
+    plan (NO_PLAN);
+
+    tmpdir_create ();
+
+    signal (SIGPIPE, SIG_IGN);
+
+    diag ("starting test server");
+    test_server_environment_init ("usock_ring");
+
+    if (!(h = test_server_create (server_cb, NULL)))
+        BAIL_OUT ("test_server_create failed");
+
+    test_attach ();
+    test_redirect_order ();
+    test_reject ();
+    test_teardown_server_owed ();
+    test_teardown_client_owed ();
+
+    diag ("stopping test server");
+    if (test_server_stop (h) < 0)
+        BAIL_OUT ("test_server_stop failed");
+    flux_close (h);
+
+    tmpdir_destroy ();
+    done_testing ();
+
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
@@ -51,8 +51,9 @@ int cli_send (struct cli *cli, const flux_msg_t *msg)
     return 0;
 }
 
-/* Client is ready for reading.  Try to recv a message.  If a full message
- * is read, call the user's recv callback.  Otherwise, go back to sleep.
+/* Client is ready for reading.  Recv messages and call the user's recv
+ * callback for each, until no full message is available.  One read may
+ * buffer several messages, and the fd won't wake us again for those.
  */
 static void cli_recv_cb (flux_reactor_t *r,
                          flux_watcher_t *w,
@@ -65,15 +66,13 @@ static void cli_recv_cb (flux_reactor_t *r,
         BAIL_OUT ("cli_recv_cb POLLERR");
     if ((revents & FLUX_POLLIN)) {
         flux_msg_t *msg;
-        if (!(msg = usock_client_recv (cli->client, FLUX_O_NONBLOCK))) {
-            if (errno != EWOULDBLOCK && errno != EAGAIN)
-                BAIL_OUT ("usock_client_recv failed: %s",
-                          flux_strerror (errno));
-        }
-        else {
+        while ((msg = usock_client_recv (cli->client, FLUX_O_NONBLOCK))) {
             cli->recv_cb (cli, msg, cli->recv_arg);
             flux_msg_destroy (msg);
         }
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+            BAIL_OUT ("usock_client_recv failed: %s",
+                      flux_strerror (errno));
     }
 }
 
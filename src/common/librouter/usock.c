@@ -31,6 +31,26 @@
  * - usock_conn_send() adds a message to a queue, starts fd (write) watcher.
  * - Register a receive callback to receive complete messages from client.
  * - Register an error callback to be notified when I/O errors occur.
+ *
+ * Batching:
+ * - When the fd is writable, as many queued messages as fit in an iobatch
+ *   are written with one writev(2).
+ * - When the fd is readable, one readv(2) fills the receive buffer, and
+ *   all complete messages in it are passed to the receive callback.
+ *   A connection destroyed from the receive callback is freed after the
+ *   read callback has finished with it.
+ * - The client receive side is buffered the same way.  Client sends are
+ *   synchronous (there is no queue to batch), so they use sendfd().
+ *
+ * Shared memory rings:
+ * - A client may call usock_client_attach_ring() right after connecting.
+ *   It creates a pair of rings (see shmring.c) and sends the memfd and
+ *   eventfds with a "usock.ring-attach" request over the socket.  The
+ *   server responds on the socket, and from then on both sides send all
+ *   messages through the rings.
+ * - A message too large for a ring is sent on the socket, preceded by a
+ *   redirect placeholder in the ring so the receiver keeps message order.
+ * - The socket is still watched, for redirected messages and disconnect.
  */
 
 #if HAVE_CONFIG_H
@@ -39,6 +59,7 @@
 #include <sys/un.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
 #include <poll.h>
 #include <unistd.h>
 #include <errno.h>
@@ -54,9 +75,12 @@
 
 #include "usock.h"
 #include "sendfd.h"
+#include "shmring.h"
 
 #define LISTEN_BACKLOG 5
 
+#define RING_ATTACH_TOPIC "usock.ring-attach"
+
 #ifndef UUID_STR_LEN
 #define UUID_STR_LEN 37     // defined in later libuuid headers
 #endif
@@ -74,15 +98,22 @@ struct usock_server {
 struct usock_io {
     int fd;
     flux_watcher_t *w;
-    struct iobuf iobuf;
 };
 
 struct usock_conn {
     struct flux_msg_cred cred;
     struct usock_io in;
     struct usock_io out;
+    struct recvbuf inbuf;
+    struct iobatch outbatch;
     zlist_t *outqueue;
 
+    flux_reactor_t *reactor;
+    struct shmring *ring;
+    flux_watcher_t *ring_w;
+    zlist_t *ringqueue;     // messages waiting for space in ring
+    int ring_owed;          // redirected messages expected on socket
+
     usock_conn_close_f close_cb;
     void *close_arg;
 
@@ -100,12 +131,17 @@ struct usock_conn {
     int refcount;
 
     unsigned char enable_close_on_destroy:1;
+    unsigned char in_recv_cb:1;
+    unsigned char destroy_pending:1;
 };
 
 struct usock_client {
     int fd;
-    struct iobuf in_iobuf;
+    struct recvbuf inbuf;
     struct iobuf out_iobuf;
+    struct shmring *ring;
+    int ring_owed;          // redirected messages expected on socket
+    int pollfd;             // epoll fd for socket + ring wakeups
 };
 
 const struct flux_msg_cred *usock_conn_get_cred (struct usock_conn *conn)
@@ -180,27 +216,231 @@ static void conn_io_error (struct usock_conn *conn, int errnum)
     }
 }
 
+static int conn_socket_send (struct usock_conn *conn, const flux_msg_t *msg)
+{
+    if (zlist_append (conn->outqueue, (void *)flux_msg_incref (msg)) < 0) {
+        flux_msg_decref (msg);
+        errno = ENOMEM;
+        return -1;
+    }
+    flux_watcher_start (conn->out.w);
+    return 0;
+}
+
+/* Send message through the ring.  A message too large for the ring
+ * goes on the socket, with a placeholder in the ring to keep its place.
+ */
+static int conn_ring_send (struct usock_conn *conn, const flux_msg_t *msg)
+{
+    if (shmring_send (conn->ring, msg) == 0)
+        return 0;
+    if (errno != E2BIG)
+        return -1;
+    if (shmring_send_redirect (conn->ring) < 0)
+        return -1;
+    return conn_socket_send (conn, msg);
+}
+
+/* Move messages that were waiting for ring space into the ring.
+ */
+static int conn_ring_flush (struct usock_conn *conn)
+{
+    const flux_msg_t *msg;
+
+    while ((msg = zlist_head (conn->ringqueue))) {
+        if (conn_ring_send (conn, msg) < 0)
+            return errno == EAGAIN ? 0 : -1;
+        flux_msg_decref (zlist_pop (conn->ringqueue));
+    }
+    return 0;
+}
+
 int usock_conn_send (struct usock_conn *conn, const flux_msg_t *msg)
 {
     if (!conn || !msg) {
         errno = EINVAL;
         return -1;
     }
-    if (zlist_append (conn->outqueue, (void *)flux_msg_incref (msg)) < 0) {
+    if (!conn->ring)
+        return conn_socket_send (conn, msg);
+    if (zlist_size (conn->ringqueue) == 0) {
+        if (conn_ring_send (conn, msg) == 0)
+            return 0;
+        if (errno != EAGAIN)
+            return -1;
+    }
+    if (zlist_append (conn->ringqueue, (void *)flux_msg_incref (msg)) < 0) {
         flux_msg_decref (msg);
         errno = ENOMEM;
         return -1;
     }
-    flux_watcher_start (conn->out.w);
     return 0;
 }
 
+/* Update message credentials based on connected creds, then pass
+ * the message to the receive callback.
+ */
+static int conn_deliver (struct usock_conn *conn, flux_msg_t *msg)
+{
+    if (auth_init_message (msg, &conn->cred) < 0)
+        return -1;
+    if (conn->recv_cb)
+        conn->recv_cb (conn, msg, conn->recv_arg);
+    return 0;
+}
+
+/* Deliver messages from the ring until it is empty, or until a redirect
+ * placeholder indicates that the next message is on the socket.
+ */
+static int conn_ring_drain (struct usock_conn *conn)
+{
+    flux_msg_t *msg;
+    int rc;
+
+    while (conn->ring && conn->ring_owed == 0 && !conn->destroy_pending) {
+        if ((rc = shmring_recv (conn->ring, &msg)) < 0) {
+            if (errno == EAGAIN)
+                break;
+            return -1;
+        }
+        if (rc == 1) {
+            conn->ring_owed++;
+            break;
+        }
+        if (conn_deliver (conn, msg) < 0) {
+            ERRNO_SAFE_WRAP (flux_msg_destroy, msg);
+            return -1;
+        }
+        flux_msg_destroy (msg);
+    }
+    return 0;
+}
+
+static void conn_ring_cb (flux_reactor_t *r,
+                          flux_watcher_t *w,
+                          int revents,
+                          void *arg)
+{
+    struct usock_conn *conn = arg;
+    int rc;
+
+    shmring_clear (conn->ring);
+    if (conn_ring_flush (conn) < 0)
+        goto error;
+    conn->in_recv_cb = 1;
+    rc = conn_ring_drain (conn);
+    conn->in_recv_cb = 0;
+    if (conn->destroy_pending) {
+        usock_conn_destroy (conn);
+        return;
+    }
+    if (rc < 0)
+        goto error;
+    return;
+error:
+    conn_io_error (conn, errno);
+}
+
+static bool is_ring_attach (const flux_msg_t *msg)
+{
+    const char *topic;
+    int type;
+
+    if (flux_msg_get_type (msg, &type) < 0
+        || type != FLUX_MSGTYPE_REQUEST
+        || flux_msg_get_topic (msg, &topic) < 0
+        || strcmp (topic, RING_ATTACH_TOPIC) != 0)
+        return false;
+    return true;
+}
+
+/* Client asks to switch to shared memory rings, passing the memfd and
+ * eventfds with the request.  Respond on the socket.  If successful,
+ * all further messages are sent through the ring.
+ */
+static int conn_ring_attach (struct usock_conn *conn, const flux_msg_t *msg)
+{
+    int fds[SHMRING_NFDS];
+    struct shmring *ring = NULL;
+    flux_watcher_t *w = NULL;
+    flux_msg_t *rep;
+    int errnum = 0;
+    int nfds;
+    int i;
+
+    nfds = recvbuf_take_fds (&conn->inbuf, fds, SHMRING_NFDS);
+    if (conn->ring || nfds != SHMRING_NFDS) {
+        errnum = EINVAL;
+        goto respond;
+    }
+    if (!(ring = shmring_attach (fds))) {
+        errnum = errno;
+        goto respond;
+    }
+    nfds = 0; // fds now belong to ring
+    if (!(w = flux_fd_watcher_create (conn->reactor,
+                                      shmring_get_waitfd (ring),
+                                      FLUX_POLLIN,
+                                      conn_ring_cb,
+                                      conn))
+        || !(conn->ringqueue = zlist_new ())) {
+        errnum = ENOMEM;
+        goto respond;
+    }
+respond:
+    for (i = 0; i < nfds; i++)
+        (void)close (fds[i]);
+    if (!(rep = flux_response_derive (msg, errnum))
+        || conn_socket_send (conn, rep) < 0) {
+        errnum = errno;
+        flux_msg_destroy (rep);
+        flux_watcher_destroy (w);
+        shmring_destroy (ring);
+        errno = errnum;
+        return -1;
+    }
+    flux_msg_destroy (rep);
+    if (errnum != 0) {
+        flux_watcher_destroy (w);
+        shmring_destroy (ring);
+        return 0;
+    }
+    conn->ring = ring;
+    conn->ring_w = w;
+    flux_watcher_start (w);
+    /* The peer only signals a reader that has found the ring empty,
+     * so look now, or the client's first message would go unnoticed.
+     */
+    return conn_ring_drain (conn);
+}
+
+/* Handle a message received on the socket.  If the ring is in use,
+ * messages ahead of it in the ring are delivered first.
+ */
+static int conn_recv_socket (struct usock_conn *conn, flux_msg_t *msg)
+{
+    if (conn->ring && conn->ring_owed == 0) {
+        if (conn_ring_drain (conn) < 0)
+            return -1;
+        if (conn->destroy_pending)
+            return 0;
+    }
+    if (conn->ring_owed > 0)
+        conn->ring_owed--;
+    if (is_ring_attach (msg))
+        return conn_ring_attach (conn, msg);
+    if (conn_deliver (conn, msg) < 0)
+        return -1;
+    return conn_ring_drain (conn);
+}
+
 static void conn_read_cb (flux_reactor_t *r,
                           flux_watcher_t *w,
                           int revents,
                           void *arg)
 {
     struct usock_conn *conn = arg;
+    int errnum = 0;
 
     if ((revents & FLUX_POLLERR)) {
         errno = EIO;
@@ -209,20 +449,38 @@ static void conn_read_cb (flux_reactor_t *r,
     if ((revents & FLUX_POLLIN)) {
         flux_msg_t *msg;
 
-        if (!(msg = recvfd (conn->in.fd, &conn->in.iobuf))) {
+        /* Deliver messages that arrived before an error (e.g. EOF)
+         * before reporting the error.
+         */
+        if (recvbuf_fill (conn->in.fd, &conn->inbuf) < 0) {
             if (errno != EWOULDBLOCK && errno != EAGAIN)
-                goto error;
+                errnum = errno;
         }
-        else {
-            /* Update message credentials based on connected creds.
-             */
-            if (auth_init_message (msg, &conn->cred) < 0)
-                goto error;
-
-            if (conn->recv_cb)
-                conn->recv_cb (conn, msg, conn->recv_arg);
+        conn->in_recv_cb = 1;
+        while (!conn->destroy_pending
+               && (msg = recvbuf_next (&conn->inbuf))) {
+            if (conn_recv_socket (conn, msg) < 0) {
+                errnum = errno;
+                flux_msg_destroy (msg);
+                break;
+            }
             flux_msg_destroy (msg);
         }
+        if (!conn->destroy_pending && errno != EWOULDBLOCK && errnum == 0)
+            errnum = errno;
+        /* Client may have written to the ring before disconnecting.
+         */
+        if (!conn->destroy_pending && errnum != 0)
+            (void)conn_ring_drain (conn);
+        conn->in_recv_cb = 0;
+        if (conn->destroy_pending) {
+            usock_conn_destroy (conn);
+            return;
+        }
+        if (errnum != 0) {
+            errno = errnum;
+            goto error;
+        }
     }
     return;
 error:
@@ -251,9 +509,18 @@ static void conn_write_cb (flux_reactor_t *r,
     }
 
     if ((revents & FLUX_POLLOUT)) {
-        const flux_msg_t *msg = zlist_head (conn->outqueue);
-        if (msg) {
-            if (sendfd (conn->out.fd, msg, &conn->out.iobuf) < 0) {
+        const flux_msg_t *msg;
+
+        /* Move queued messages into the batch, then write it.
+         */
+        while (!iobatch_full (&conn->outbatch)
+               && (msg = zlist_head (conn->outqueue))) {
+            if (iobatch_append (&conn->outbatch, msg) < 0)
+                goto error;
+            (void) conn_outqueue_drop (conn);
+        }
+        if (!iobatch_empty (&conn->outbatch)) {
+            if (sendfd_batch (conn->out.fd, &conn->outbatch) < 0) {
                 if (errno == EPIPE) {
                     /* Remote peer has closed connection.
                      * However, there may still be pending messages sent
@@ -264,17 +531,16 @@ static void conn_write_cb (flux_reactor_t *r,
                      */
                     while (conn_outqueue_drop (conn))
                         ;
+                    iobatch_clean (&conn->outbatch);
                     flux_watcher_stop (conn->out.w);
                 }
                 else if (errno != EWOULDBLOCK && errno != EAGAIN)
                     goto error;
             }
-            else {
-                (void) conn_outqueue_drop (conn);
-                if (zlist_size (conn->outqueue) == 0)
-                    flux_watcher_stop (conn->out.w);
-            }
         }
+        if (iobatch_empty (&conn->outbatch)
+            && zlist_size (conn->outqueue) == 0)
+            flux_watcher_stop (conn->out.w);
     }
     return;
 error:
@@ -326,11 +592,17 @@ void usock_conn_destroy (struct usock_conn *conn)
 {
     if (conn) {
         int saved_errno = errno;
+        /* conn_read_cb() will finish destruction.
+         */
+        if (conn->in_recv_cb) {
+            conn->destroy_pending = 1;
+            return;
+        }
         if (conn->close_cb)
             (*conn->close_cb) (conn, conn->close_arg);
         aux_destroy (&conn->aux);
         flux_watcher_destroy (conn->in.w);
-        iobuf_clean (&conn->in.iobuf);
+        recvbuf_clean (&conn->inbuf);
         if (conn->outqueue) {
             const flux_msg_t *msg;
             while ((msg = zlist_pop (conn->outqueue)))
@@ -338,7 +610,15 @@ void usock_conn_destroy (struct usock_conn *conn)
             zlist_destroy (&conn->outqueue);
         }
         flux_watcher_destroy (conn->out.w);
-        iobuf_clean (&conn->out.iobuf);
+        iobatch_clean (&conn->outbatch);
+        flux_watcher_destroy (conn->ring_w);
+        shmring_destroy (conn->ring);
+        if (conn->ringqueue) {
+            const flux_msg_t *msg;
+            while ((msg = zlist_pop (conn->ringqueue)))
+                flux_msg_decref (msg);
+            zlist_destroy (&conn->ringqueue);
+        }
         if (conn->server)
             zlist_remove (conn->server->connections, conn);
         if (conn->enable_close_on_destroy) {
@@ -419,6 +699,7 @@ struct usock_conn *usock_conn_create (flux_reactor_t *r, int infd, int outfd)
 
     conn->in.fd = infd;
     conn->out.fd = outfd;
+    conn->reactor = r;
     conn->cred.userid = FLUX_USERID_UNKNOWN;
     conn->cred.rolemask = FLUX_ROLE_NONE;
 
@@ -428,7 +709,7 @@ struct usock_conn *usock_conn_create (flux_reactor_t *r, int infd, int outfd)
                                                conn_read_cb,
                                                conn)))
         goto error;
-    iobuf_init (&conn->in.iobuf);
+    recvbuf_init (&conn->inbuf);
 
     if (!(conn->out.w = flux_fd_watcher_create (r,
                                                 conn->out.fd,
@@ -436,7 +717,7 @@ struct usock_conn *usock_conn_create (flux_reactor_t *r, int infd, int outfd)
                                                 conn_write_cb,
                                                 conn)))
         goto error;
-    iobuf_init (&conn->out.iobuf);
+    iobatch_init (&conn->outbatch);
     uuid_generate (conn->uuid);
     uuid_unparse (conn->uuid, conn->uuid_str);
 
@@ -552,11 +833,42 @@ static bool is_poll_error (int revents)
  * If none are pending, return 0.  If an error occurred, return FLUX_POLLERR.
  * N.B. see op->pollevents in libflux/connector.h
  */
+/* With rings, the pollfd is an epoll fd covering the socket and the
+ * ring eventfd.  Clear the eventfd, and re-arm the ring wakeups as needed.
+ */
+static int ring_pollevents (struct usock_client *client)
+{
+    struct pollfd pfd;
+    int flux_revents = 0;
+
+    shmring_clear (client->ring);
+
+    pfd.fd = client->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (poll (&pfd, 1, 0) < 0)
+        return FLUX_POLLERR;
+    if ((pfd.revents & POLLIN) || recvbuf_pending (&client->inbuf))
+        flux_revents |= FLUX_POLLIN;
+    if (is_poll_error (pfd.revents))
+        flux_revents |= FLUX_POLLERR;
+    if (shmring_readable (client->ring))
+        flux_revents |= FLUX_POLLIN;
+    if (shmring_writable (client->ring))
+        flux_revents |= FLUX_POLLOUT;
+
+    return flux_revents;
+}
+
 int usock_client_pollevents (struct usock_client *client)
 {
     struct pollfd pfd;
     int flux_revents = 0;
 
+    if (client->ring)
+        return ring_pollevents (client);
+
     pfd.fd = client->fd;
     pfd.events = POLLIN | POLLOUT;
     pfd.revents = 0;
@@ -569,6 +881,10 @@ int usock_client_pollevents (struct usock_client *client)
         flux_revents |= FLUX_POLLOUT;
     if (is_poll_error (pfd.revents))
         flux_revents |= FLUX_POLLERR;
+    /* A complete message may already be buffered.
+     */
+    if (recvbuf_pending (&client->inbuf))
+        flux_revents |= FLUX_POLLIN;
 
     return flux_revents;
 }
@@ -579,7 +895,7 @@ int usock_client_pollevents (struct usock_client *client)
  */
 int usock_client_pollfd (struct usock_client *client)
 {
-    return client->fd;
+    return client->ring ? client->pollfd : client->fd;
 }
 
 /* Poll wrapper that blocks until the specified event occurs.
@@ -602,13 +918,34 @@ static int usock_client_poll (int fd, int events)
     return 0;
 }
 
-/* Try to send message.  If flags does not include FLUX_O_NONBLOCK,
- * and sendfd fails with EWOULDBLOCK/EAGAIN, then poll(POLLOUT) and
- * keep trying until the full message is sent.
+/* Block until the peer signals a ring change, or the socket is readable.
+ * Socket data is moved to the receive buffer so the socket does not stay
+ * readable, and so that disconnect is reported.
  */
-int usock_client_send (struct usock_client *client,
-                       const flux_msg_t *msg,
-                       int flags)
+static int ring_wait (struct usock_client *client)
+{
+    struct pollfd pfd[2];
+
+    memset (pfd, 0, sizeof (pfd));
+    pfd[0].fd = shmring_get_waitfd (client->ring);
+    pfd[0].events = POLLIN;
+    pfd[1].fd = client->fd;
+    pfd[1].events = POLLIN;
+
+    if (poll (pfd, 2, -1) < 0)
+        return -1;
+    shmring_clear (client->ring);
+    if (pfd[1].revents) {
+        if (recvbuf_fill (client->fd, &client->inbuf) < 0
+            && errno != EWOULDBLOCK && errno != EAGAIN)
+            return -1;
+    }
+    return 0;
+}
+
+static int socket_send (struct usock_client *client,
+                        const flux_msg_t *msg,
+                        int flags)
 {
     while (sendfd (client->fd, msg, &client->out_iobuf) < 0) {
         if (errno != EWOULDBLOCK && errno != EAGAIN)
@@ -621,15 +958,96 @@ int usock_client_send (struct usock_client *client,
     return 0;
 }
 
+/* A message too large for the ring is sent on the socket after a
+ * placeholder.  Once the placeholder is sent, the message must follow,
+ * so FLUX_O_NONBLOCK only applies to the placeholder.
+ */
+static int ring_send (struct usock_client *client,
+                      const flux_msg_t *msg,
+                      int flags)
+{
+    while (shmring_send (client->ring, msg) < 0) {
+        if (errno == E2BIG) {
+            while (shmring_send_redirect (client->ring) < 0) {
+                if (errno != EAGAIN || (flags & FLUX_O_NONBLOCK))
+                    return -1;
+                if (ring_wait (client) < 0)
+                    return -1;
+            }
+            return socket_send (client, msg, 0);
+        }
+        if (errno != EAGAIN || (flags & FLUX_O_NONBLOCK))
+            return -1;
+        if (ring_wait (client) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Try to send message.  If flags does not include FLUX_O_NONBLOCK,
+ * and sendfd fails with EWOULDBLOCK/EAGAIN, then poll(POLLOUT) and
+ * keep trying until the full message is sent.
+ */
+int usock_client_send (struct usock_client *client,
+                       const flux_msg_t *msg,
+                       int flags)
+{
+    if (client->ring)
+        return ring_send (client, msg, flags);
+    return socket_send (client, msg, flags);
+}
+
+/* Messages are taken from the ring until a redirect placeholder is found,
+ * then the next message is taken from the socket.  Socket data is only
+ * read into the receive buffer until a placeholder calls for it, since
+ * it may have arrived before ring messages that precede it were seen.
+ */
+static flux_msg_t *ring_recv (struct usock_client *client, int flags)
+{
+    flux_msg_t *msg;
+    int rc;
+
+    for (;;) {
+        if (client->ring_owed == 0) {
+            if ((rc = shmring_recv (client->ring, &msg)) == 0)
+                return msg;
+            if (rc == 1)
+                client->ring_owed++;
+            else if (errno != EAGAIN)
+                return NULL;
+            else if (recvbuf_pending (&client->inbuf))
+                return recvbuf_next (&client->inbuf); // unexpected
+        }
+        if (client->ring_owed > 0) {
+            if ((msg = recvbuf_next (&client->inbuf))) {
+                client->ring_owed--;
+                return msg;
+            }
+            if (errno != EWOULDBLOCK)
+                return NULL;
+        }
+        if (recvbuf_fill (client->fd, &client->inbuf) >= 0)
+            continue;
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+            return NULL;
+        if ((flags & FLUX_O_NONBLOCK))
+            return NULL;
+        if (ring_wait (client) < 0)
+            return NULL;
+    }
+}
+
 /* Try to recv message.  If flags does not include FLUX_O_NONBLOCK,
- * and recvfd fails with EWOULDBLOCK/EAGAIN, then poll(POLLIN) and
+ * and recvbuf_recv fails with EWOULDBLOCK/EAGAIN, then poll(POLLIN) and
  * keep trying until the full message is received
  */
 flux_msg_t *usock_client_recv (struct usock_client *client, int flags)
 {
     flux_msg_t *msg;
 
-    while (!(msg = recvfd (client->fd, &client->in_iobuf))) {
+    if (client->ring)
+        return ring_recv (client, flags);
+    while (!(msg = recvbuf_recv (client->fd, &client->inbuf))) {
         if (errno != EWOULDBLOCK && errno != EAGAIN)
             return NULL;
         if ((flags & FLUX_O_NONBLOCK))
@@ -704,6 +1122,68 @@ static int usock_client_read_zero (int fd)
     return 0;
 }
 
+static int epoll_add (int efd, int fd)
+{
+    struct epoll_event ev;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl (efd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int usock_client_attach_ring (struct usock_client *client, size_t size)
+{
+    struct shmring *ring;
+    flux_msg_t *msg = NULL;
+    const char *topic;
+    int fds[SHMRING_NFDS];
+    int pollfd = -1;
+
+    if (!client || client->ring) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(ring = shmring_create (size)))
+        return -1;
+    if ((pollfd = epoll_create1 (EPOLL_CLOEXEC)) < 0
+        || epoll_add (pollfd, client->fd) < 0
+        || epoll_add (pollfd, shmring_get_waitfd (ring)) < 0)
+        goto error;
+    shmring_get_fds (ring, fds);
+    if (!(msg = flux_request_encode (RING_ATTACH_TOPIC, NULL)))
+        goto error;
+    while (sendfd_rights (client->fd,
+                          msg,
+                          fds,
+                          SHMRING_NFDS,
+                          &client->out_iobuf) < 0) {
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+            goto error;
+        if (usock_client_poll (client->fd, POLLOUT) < 0)
+            goto error;
+    }
+    flux_msg_destroy (msg);
+    if (!(msg = usock_client_recv (client, 0)))
+        goto error;
+    if (flux_response_decode (msg, &topic, NULL) < 0)
+        goto error;
+    if (strcmp (topic, RING_ATTACH_TOPIC) != 0) {
+        errno = EPROTO;
+        goto error;
+    }
+    flux_msg_destroy (msg);
+    client->ring = ring;
+    client->pollfd = pollfd;
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (flux_msg_destroy, msg);
+    if (pollfd >= 0)
+        ERRNO_SAFE_WRAP (close, pollfd);
+    shmring_destroy (ring);
+    return -1;
+}
+
 struct usock_client *usock_client_create (int fd)
 {
     struct usock_client *client;
@@ -716,7 +1196,8 @@ struct usock_client *usock_client_create (int fd)
         return NULL;
 
     client->fd = fd;
-    iobuf_init (&client->in_iobuf);
+    client->pollfd = -1;
+    recvbuf_init (&client->inbuf);
     iobuf_init (&client->out_iobuf);
 
     if (usock_client_read_zero (client->fd) < 0)
@@ -732,8 +1213,11 @@ error:
 void usock_client_destroy (struct usock_client *client)
 {
     if (client) {
-        iobuf_clean (&client->in_iobuf);
+        recvbuf_clean (&client->inbuf);
         iobuf_clean (&client->out_iobuf);
+        shmring_destroy (client->ring);
+        if (client->pollfd >= 0)
+            ERRNO_SAFE_WRAP (close, client->pollfd);
         ERRNO_SAFE_WRAP (free, client);
     }
 }
@@ -106,6 +106,12 @@ int usock_client_send (struct usock_client *client,
                        int flags);
 flux_msg_t *usock_client_recv (struct usock_client *client, int flags);
 
+/* Ask the server to exchange further messages through shared memory
+ * rings of 'size' bytes.  Call before sending any other messages.
+ * On failure, the socket continues to be used.
+ */
+int usock_client_attach_ring (struct usock_client *client, size_t size);
+
 int usock_client_connect (const char *sockpath,
                           struct usock_retry_params retry);
 
@@ -0,0 +1,283 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* blake3.c - portable BLAKE3, after the specification's reference
+ * implementation.  Input is split into 1K chunks, each compressed as a
+ * chain of 64 byte blocks, and chunk chaining values are merged into a
+ * binary tree with a stack holding one value per tree level.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+
+#include "blake3.h"
+
+enum {
+    CHUNK_START = 1 << 0,
+    CHUNK_END = 1 << 1,
+    PARENT = 1 << 2,
+    ROOT = 1 << 3,
+};
+
+static const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static const uint8_t MSG_SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+static inline uint32_t rotr32 (uint32_t w, int c)
+{
+    return (w >> c) | (w << (32 - c));
+}
+
+static inline uint32_t load32 (const uint8_t *p)
+{
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32 (uint8_t *p, uint32_t w)
+{
+    p[0] = w;
+    p[1] = w >> 8;
+    p[2] = w >> 16;
+    p[3] = w >> 24;
+}
+
+static inline void g (uint32_t *s, int a, int b, int c, int d,
+                      uint32_t x, uint32_t y)
+{
+    s[a] = s[a] + s[b] + x;
+    s[d] = rotr32 (s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32 (s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y;
+    s[d] = rotr32 (s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32 (s[b] ^ s[c], 7);
+}
+
+static void compress (const uint32_t cv[8],
+                      const uint8_t block[BLAKE3_BLOCK_LEN],
+                      uint8_t block_len,
+                      uint64_t counter,
+                      uint8_t flags,
+                      uint32_t out[16])
+{
+    uint32_t m[16];
+    uint32_t s[16];
+    int r, i;
+
+    for (i = 0; i < 16; i++)
+        m[i] = load32 (block + 4 * i);
+    memcpy (s, cv, 8 * sizeof (uint32_t));
+    s[8] = IV[0];
+    s[9] = IV[1];
+    s[10] = IV[2];
+    s[11] = IV[3];
+    s[12] = (uint32_t)counter;
+    s[13] = (uint32_t)(counter >> 32);
+    s[14] = block_len;
+    s[15] = flags;
+    for (r = 0; r < 7; r++) {
+        const uint8_t *sc = MSG_SCHEDULE[r];
+        g (s, 0, 4, 8, 12, m[sc[0]], m[sc[1]]);
+        g (s, 1, 5, 9, 13, m[sc[2]], m[sc[3]]);
+        g (s, 2, 6, 10, 14, m[sc[4]], m[sc[5]]);
+        g (s, 3, 7, 11, 15, m[sc[6]], m[sc[7]]);
+        g (s, 0, 5, 10, 15, m[sc[8]], m[sc[9]]);
+        g (s, 1, 6, 11, 12, m[sc[10]], m[sc[11]]);
+        g (s, 2, 7, 8, 13, m[sc[12]], m[sc[13]]);
+        g (s, 3, 4, 9, 14, m[sc[14]], m[sc[15]]);
+    }
+    for (i = 0; i < 8; i++) {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+}
+
+/* The input to a compression that has not yet been performed, kept
+ * until it is known whether it is the root of the tree.
+ */
+struct output {
+    uint32_t cv[8];
+    uint8_t block[BLAKE3_BLOCK_LEN];
+    uint8_t block_len;
+    uint64_t counter;
+    uint8_t flags;
+};
+
+static void output_cv (const struct output *o, uint32_t cv[8])
+{
+    uint32_t out[16];
+
+    compress (o->cv, o->block, o->block_len, o->counter, o->flags, out);
+    memcpy (cv, out, 8 * sizeof (uint32_t));
+}
+
+static void parent_output (const uint32_t left[8],
+                           const uint32_t right[8],
+                           struct output *o)
+{
+    int i;
+
+    memcpy (o->cv, IV, sizeof (IV));
+    for (i = 0; i < 8; i++) {
+        store32 (o->block + 4 * i, left[i]);
+        store32 (o->block + 32 + 4 * i, right[i]);
+    }
+    o->block_len = BLAKE3_BLOCK_LEN;
+    o->counter = 0;
+    o->flags = PARENT;
+}
+
+static void chunk_init (blake3_chunk_state *cs, uint64_t counter)
+{
+    memcpy (cs->cv, IV, sizeof (IV));
+    cs->chunk_counter = counter;
+    memset (cs->block, 0, sizeof (cs->block));
+    cs->block_len = 0;
+    cs->blocks_compressed = 0;
+}
+
+static size_t chunk_len (const blake3_chunk_state *cs)
+{
+    return BLAKE3_BLOCK_LEN * (size_t)cs->blocks_compressed + cs->block_len;
+}
+
+static uint8_t chunk_start_flag (const blake3_chunk_state *cs)
+{
+    return cs->blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+/* A full block is only compressed once more input arrives, since the
+ * last block of the chunk must be compressed with CHUNK_END.
+ */
+static void chunk_update (blake3_chunk_state *cs,
+                          const uint8_t *input,
+                          size_t len)
+{
+    while (len > 0) {
+        size_t take;
+
+        if (cs->block_len == BLAKE3_BLOCK_LEN) {
+            uint32_t out[16];
+            compress (cs->cv,
+                      cs->block,
+                      BLAKE3_BLOCK_LEN,
+                      cs->chunk_counter,
+                      chunk_start_flag (cs),
+                      out);
+            memcpy (cs->cv, out, 8 * sizeof (uint32_t));
+            cs->blocks_compressed++;
+            memset (cs->block, 0, sizeof (cs->block));
+            cs->block_len = 0;
+        }
+        take = BLAKE3_BLOCK_LEN - cs->block_len;
+        if (take > len)
+            take = len;
+        memcpy (cs->block + cs->block_len, input, take);
+        cs->block_len += take;
+        input += take;
+        len -= take;
+    }
+}
+
+static void chunk_output (const blake3_chunk_state *cs, struct output *o)
+{
+    memcpy (o->cv, cs->cv, sizeof (o->cv));
+    memcpy (o->block, cs->block, sizeof (o->block));
+    o->block_len = cs->block_len;
+    o->counter = cs->chunk_counter;
+    o->flags = chunk_start_flag (cs) | CHUNK_END;
+}
+
+void blake3_hasher_init (blake3_hasher *self)
+{
+    chunk_init (&self->chunk, 0);
+    self->cv_stack_len = 0;
+}
+
+/* Push the chaining value of a completed chunk, first merging it with
+ * every completed subtree it closes.  The number of trailing zero bits
+ * in 'total_chunks' is the number of subtrees to merge.
+ */
+static void add_chunk_cv (blake3_hasher *self,
+                          uint32_t cv[8],
+                          uint64_t total_chunks)
+{
+    struct output o;
+
+    while ((total_chunks & 1) == 0) {
+        parent_output (self->cv_stack[--self->cv_stack_len], cv, &o);
+        output_cv (&o, cv);
+        total_chunks >>= 1;
+    }
+    memcpy (self->cv_stack[self->cv_stack_len++], cv, 8 * sizeof (uint32_t));
+}
+
+void blake3_hasher_update (blake3_hasher *self, const void *input, size_t len)
+{
+    const uint8_t *p = input;
+
+    while (len > 0) {
+        size_t take;
+
+        if (chunk_len (&self->chunk) == BLAKE3_CHUNK_LEN) {
+            uint64_t total_chunks = self->chunk.chunk_counter + 1;
+            struct output o;
+            uint32_t cv[8];
+
+            chunk_output (&self->chunk, &o);
+            output_cv (&o, cv);
+            add_chunk_cv (self, cv, total_chunks);
+            chunk_init (&self->chunk, total_chunks);
+        }
+        take = BLAKE3_CHUNK_LEN - chunk_len (&self->chunk);
+        if (take > len)
+            take = len;
+        chunk_update (&self->chunk, p, take);
+        p += take;
+        len -= take;
+    }
+}
+
+void blake3_hasher_finalize (const blake3_hasher *self,
+                             uint8_t out[BLAKE3_OUT_LEN])
+{
+    struct output o;
+    uint32_t words[16];
+    uint32_t cv[8];
+    int i;
+
+    chunk_output (&self->chunk, &o);
+    for (i = self->cv_stack_len - 1; i >= 0; i--) {
+        output_cv (&o, cv);
+        parent_output (self->cv_stack[i], cv, &o);
+    }
+    compress (o.cv, o.block, o.block_len, 0, o.flags | ROOT, words);
+    for (i = 0; i < 8; i++)
+        store32 (out + 4 * i, words[i]);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -20,6 +20,8 @@
 #include "blobref.h"
 #include "sha1.h"
 #include "sha256.h"
+#include "sha_ni.h"
+#include "blake3.h"
 
 #define SHA1_PREFIX_STRING  "sha1-"
 #define SHA1_PREFIX_LENGTH  5
@@ -29,6 +31,10 @@
 #define SHA256_PREFIX_LENGTH  7
 #define SHA256_STRING_SIZE    (SHA256_BLOCK_SIZE*2 + SHA256_PREFIX_LENGTH + 1)
 
+#define BLAKE3_PREFIX_STRING  "blake3-"
+#define BLAKE3_PREFIX_LENGTH  7
+#define BLAKE3_STRING_SIZE    (BLAKE3_OUT_LEN*2 + BLAKE3_PREFIX_LENGTH + 1)
+
 #if BLOBREF_MAX_STRING_SIZE < SHA1_STRING_SIZE
 #error BLOBREF_MAX_STRING_SIZE is too small
 #endif
@@ -41,24 +47,49 @@
 #if BLOBREF_MAX_DIGEST_SIZE < SHA256_BLOCK_SIZE
 #error BLOBREF_MAX_DIGEST_SIZE is too small
 #endif
+#if BLOBREF_MAX_STRING_SIZE < BLAKE3_STRING_SIZE
+#error BLOBREF_MAX_STRING_SIZE is too small
+#endif
+#if BLOBREF_MAX_DIGEST_SIZE < BLAKE3_OUT_LEN
+#error BLOBREF_MAX_DIGEST_SIZE is too small
+#endif
 
 static void sha1_hash (const void *data, int data_len, void *hash, int hash_len);
 static void sha256_hash (const void *data, int data_len, void *hash, int hash_len);
+static void blake3_hash (const void *data, int data_len, void *hash, int hash_len);
+static void sha1_hash2 (const void *data0, int len0, void *hash0,
+                        const void *data1, int len1, void *hash1,
+                        int hash_len);
+static void sha256_hash2 (const void *data0, int len0, void *hash0,
+                          const void *data1, int len1, void *hash1,
+                          int hash_len);
 
+/* 'hashfun2' is optional.  If set, it hashes two buffers at once,
+ * which blobref_hash_batch() uses to pair up requests.
+ */
 struct blobhash {
     char *name;
     int hashlen;
     void (*hashfun)(const void *data, int data_len, void *hash, int hash_len);
+    void (*hashfun2)(const void *data0, int len0, void *hash0,
+                     const void *data1, int len1, void *hash1,
+                     int hash_len);
 };
 
 static struct blobhash blobtab[] = {
     { .name = "sha1",
       .hashlen = SHA1_DIGEST_SIZE,
       .hashfun = sha1_hash,
+      .hashfun2 = sha1_hash2,
     },
     { .name = "sha256",
       .hashlen = SHA256_BLOCK_SIZE,
       .hashfun = sha256_hash,
+      .hashfun2 = sha256_hash2,
+    },
+    { .name = "blake3",
+      .hashlen = BLAKE3_OUT_LEN,
+      .hashfun = blake3_hash,
     },
     { NULL, 0, 0 },
 };
@@ -68,6 +99,10 @@ static void sha1_hash (const void *data, int data_len, void *hash, int hash_len)
     SHA1_CTX ctx;
 
     assert (hash_len == SHA1_DIGEST_SIZE);
+    if (sha_ni_available ()) {
+        sha1_ni_hash (data, data_len, hash);
+        return;
+    }
     SHA1_Init (&ctx);
     SHA1_Update (&ctx, data, data_len);
     SHA1_Final (&ctx, hash);
@@ -78,11 +113,51 @@ static void sha256_hash (const void *data, int data_len, void *hash, int hash_le
     SHA256_CTX ctx;
 
     assert (hash_len == SHA256_BLOCK_SIZE);
+    if (sha_ni_available ()) {
+        sha256_ni_hash (data, data_len, hash);
+        return;
+    }
     sha256_init (&ctx);
     sha256_update (&ctx, data, data_len);
     sha256_final (&ctx, hash);
 }
 
+static void sha1_hash2 (const void *data0, int len0, void *hash0,
+                        const void *data1, int len1, void *hash1,
+                        int hash_len)
+{
+    if (sha_ni_available ()) {
+        assert (hash_len == SHA1_DIGEST_SIZE);
+        sha1_ni_hash_x2 (data0, len0, hash0, data1, len1, hash1);
+        return;
+    }
+    sha1_hash (data0, len0, hash0, hash_len);
+    sha1_hash (data1, len1, hash1, hash_len);
+}
+
+static void sha256_hash2 (const void *data0, int len0, void *hash0,
+                          const void *data1, int len1, void *hash1,
+                          int hash_len)
+{
+    if (sha_ni_available ()) {
+        assert (hash_len == SHA256_BLOCK_SIZE);
+        sha256_ni_hash_x2 (data0, len0, hash0, data1, len1, hash1);
+        return;
+    }
+    sha256_hash (data0, len0, hash0, hash_len);
+    sha256_hash (data1, len1, hash1, hash_len);
+}
+
+static void blake3_hash (const void *data, int data_len, void *hash, int hash_len)
+{
+    blake3_hasher hasher;
+
+    assert (hash_len == BLAKE3_OUT_LEN);
+    blake3_hasher_init (&hasher);
+    blake3_hasher_update (&hasher, data, data_len);
+    blake3_hasher_finalize (&hasher, hash);
+}
+
 /* true if s1 contains "s2-" prefix
  */
 static int prefixmatch (const char *s1, const char *s2)
@@ -205,6 +280,41 @@ int blobref_hash (const char *hashtype,
     return hashtostr (bh, hash, bh->hashlen, blobref, blobref_len);
 }
 
+int blobref_hash_batch (const char *hashtype,
+                        struct blobref_hashreq *req,
+                        int count)
+{
+    struct blobhash *bh;
+    uint8_t hash0[BLOBREF_MAX_DIGEST_SIZE];
+    uint8_t hash1[BLOBREF_MAX_DIGEST_SIZE];
+    int i = 0;
+
+    if (!(bh = lookup_blobhash (hashtype)) || count < 0 || (count && !req)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (bh->hashfun2) {
+        for (; i + 1 < count; i += 2) {
+            bh->hashfun2 (req[i].data, req[i].len, hash0,
+                          req[i + 1].data, req[i + 1].len, hash1,
+                          bh->hashlen);
+            if (hashtostr (bh, hash0, bh->hashlen,
+                           req[i].blobref, sizeof (req[i].blobref)) < 0
+                || hashtostr (bh, hash1, bh->hashlen,
+                              req[i + 1].blobref,
+                              sizeof (req[i + 1].blobref)) < 0)
+                return -1;
+        }
+    }
+    for (; i < count; i++) {
+        bh->hashfun (req[i].data, req[i].len, hash0, bh->hashlen);
+        if (hashtostr (bh, hash0, bh->hashlen,
+                       req[i].blobref, sizeof (req[i].blobref)) < 0)
+            return -1;
+    }
+    return 0;
+}
+
 int blobref_validate (const char *blobref)
 {
     struct blobhash *bh;
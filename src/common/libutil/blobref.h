@@ -38,6 +38,24 @@ int blobref_hash (const char *hashtype,
                   const void *data, int len,
                   void *blobref, int blobref_len);
 
+/* A single hash request for blobref_hash_batch().
+ */
+struct blobref_hashreq {
+    const void *data;
+    int len;
+    char blobref[BLOBREF_MAX_STRING_SIZE];  // result
+};
+
+/* Compute blobrefs for an array of 'count' requests, e.g. all the new
+ * objects of a KVS transaction.  Where the CPU allows, buffers are hashed
+ * in pairs with their rounds interleaved, which is faster than calling
+ * blobref_hash() on each one.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int blobref_hash_batch (const char *hashtype,
+                        struct blobref_hashreq *req,
+                        int count);
+
 /* Check validity of blobref string.
  */
 int blobref_validate (const char *blobref);
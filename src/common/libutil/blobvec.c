@@ -0,0 +1,179 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "blobvec.h"
+
+struct blobvec {
+    char *buf;
+    int len;
+    int alloc;
+    int count;
+};
+
+void blobvec_destroy (struct blobvec *bv)
+{
+    if (bv) {
+        int saved_errno = errno;
+        free (bv->buf);
+        free (bv);
+        errno = saved_errno;
+    }
+}
+
+struct blobvec *blobvec_create (void)
+{
+    struct blobvec *bv;
+
+    if (!(bv = calloc (1, sizeof (*bv))))
+        return NULL;
+    return bv;
+}
+
+/* Ensure there is room for 'size' more bytes in the buffer.
+ */
+static int blobvec_reserve (struct blobvec *bv, int size)
+{
+    if (size < 0 || size > INT32_MAX - bv->len) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (bv->len + size > bv->alloc) {
+        int alloc = bv->alloc > 0 ? bv->alloc : 4096;
+        char *buf;
+
+        while (alloc < bv->len + size) {
+            if (alloc > INT32_MAX / 2) {
+                alloc = bv->len + size;
+                break;
+            }
+            alloc *= 2;
+        }
+        if (!(buf = realloc (bv->buf, alloc)))
+            return -1;
+        bv->buf = buf;
+        bv->alloc = alloc;
+    }
+    return 0;
+}
+
+static void blobvec_put_length (struct blobvec *bv, int32_t len)
+{
+    uint32_t n = htonl ((uint32_t)len);
+
+    memcpy (bv->buf + bv->len, &n, sizeof (n));
+    bv->len += sizeof (n);
+}
+
+int blobvec_append (struct blobvec *bv, const void *data, int len)
+{
+    if (!bv || len < 0 || (len > 0 && !data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (blobvec_reserve (bv, sizeof (uint32_t) + len) < 0)
+        return -1;
+    blobvec_put_length (bv, len);
+    if (len > 0)
+        memcpy (bv->buf + bv->len, data, len);
+    bv->len += len;
+    bv->count++;
+    return 0;
+}
+
+int blobvec_append_error (struct blobvec *bv, int errnum)
+{
+    if (!bv || errnum <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (blobvec_reserve (bv, sizeof (uint32_t)) < 0)
+        return -1;
+    blobvec_put_length (bv, -errnum);
+    bv->count++;
+    return 0;
+}
+
+int blobvec_count (struct blobvec *bv)
+{
+    return bv ? bv->count : 0;
+}
+
+void blobvec_encode (struct blobvec *bv, const void **buf, int *len)
+{
+    if (buf)
+        *buf = bv ? bv->buf : NULL;
+    if (len)
+        *len = bv ? bv->len : 0;
+}
+
+int blobvec_next (const void *buf,
+                  int len,
+                  int *cursor,
+                  const void **data,
+                  int *datalen)
+{
+    const char *p = buf;
+    uint32_t n;
+    int32_t size;
+
+    if (!cursor || *cursor < 0 || *cursor > len || (len > 0 && !buf))
+        goto eproto;
+    if (*cursor == len)
+        return 0;
+    if (len - *cursor < sizeof (n))
+        goto eproto;
+    memcpy (&n, p + *cursor, sizeof (n));
+    size = (int32_t)ntohl (n);
+    *cursor += sizeof (n);
+    if (size < 0) {
+        if (data)
+            *data = NULL;
+        if (datalen)
+            *datalen = size;
+        return 1;
+    }
+    if (len - *cursor < size)
+        goto eproto;
+    if (data)
+        *data = p + *cursor;
+    if (datalen)
+        *datalen = size;
+    *cursor += size;
+    return 1;
+eproto:
+    errno = EPROTO;
+    return -1;
+}
+
+int blobvec_decode_count (const void *buf, int len)
+{
+    int cursor = 0;
+    int count = 0;
+    int rc;
+
+    while ((rc = blobvec_next (buf, len, &cursor, NULL, NULL)) == 1)
+        count++;
+    if (rc < 0)
+        return -1;
+    return count;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,68 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* blobvec - encode/decode a vector of blobs in a single buffer
+ *
+ * Each element consists of a 4 byte signed length in network byte order,
+ * followed by that many bytes of data.  A negative length is an error
+ * element carrying -errno, with no data following.  This is the payload
+ * format of the content.load-batch and content.store-batch RPCs.
+ */
+
+#ifndef _UTIL_BLOBVEC_H
+#define _UTIL_BLOBVEC_H
+
+struct blobvec;
+
+struct blobvec *blobvec_create (void);
+void blobvec_destroy (struct blobvec *bv);
+
+/* Append a copy of 'data' of length 'len' to the vector.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int blobvec_append (struct blobvec *bv, const void *data, int len);
+
+/* Append an error element carrying 'errnum' to the vector.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int blobvec_append_error (struct blobvec *bv, int errnum);
+
+/* Return the number of elements in the vector.
+ */
+int blobvec_count (struct blobvec *bv);
+
+/* Access the encoded vector.  Storage belongs to 'bv' and is valid
+ * until 'bv' is modified or destroyed.
+ */
+void blobvec_encode (struct blobvec *bv, const void **buf, int *len);
+
+/* Iterate over the elements of encoded vector 'buf' of length 'len'.
+ * '*cursor' should be set to 0 before the first call.
+ * Returns 1 with 'data' and 'datalen' set to the next element, or 0 if
+ * there are no more elements.  For an error element, 'data' is set to NULL
+ * and 'datalen' is set to -errno.  Returns -1 with errno = EPROTO if the
+ * encoding is invalid.
+ */
+int blobvec_next (const void *buf,
+                  int len,
+                  int *cursor,
+                  const void **data,
+                  int *datalen);
+
+/* Return the number of elements in encoded vector 'buf' of length 'len',
+ * or -1 with errno = EPROTO if the encoding is invalid.
+ */
+int blobvec_decode_count (const void *buf, int len);
+
+#endif /* !_UTIL_BLOBVEC_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
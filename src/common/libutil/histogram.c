@@ -0,0 +1,162 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* histogram.c - log-linear histogram
+ *
+ * A value v >= SUB_COUNT with highest set bit e lands in bucket
+ * (e - SUB_BITS + 1) * SUB_COUNT + (the SUB_BITS bits below bit e).
+ * Values below SUB_COUNT get a bucket each.  Values with e > MAX_EXP
+ * share the last bucket, and percentiles that land there report max.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "histogram.h"
+
+#define SUB_BITS    4
+#define SUB_COUNT   (1 << SUB_BITS)
+#define MAX_EXP     39  // 2^40 nanoseconds is about 18 minutes
+#define NBUCKETS    ((MAX_EXP - SUB_BITS + 2) * SUB_COUNT)
+
+struct histogram {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t bucket[NBUCKETS];
+};
+
+static int bucket_index (uint64_t value)
+{
+    int e;
+
+    if (value < SUB_COUNT)
+        return value;
+    e = 63 - __builtin_clzll (value);
+    if (e > MAX_EXP)
+        return NBUCKETS - 1;
+    return (e - SUB_BITS + 1) * SUB_COUNT
+           + ((value >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+/* Largest value that maps to bucket 'i'.
+ */
+static uint64_t bucket_highest (int i)
+{
+    int shift;
+
+    if (i < SUB_COUNT)
+        return i;
+    shift = i / SUB_COUNT - 1;
+    return (((uint64_t)(SUB_COUNT + i % SUB_COUNT)) << shift)
+           + (1ULL << shift) - 1;
+}
+
+void histogram_destroy (struct histogram *hist)
+{
+    if (hist) {
+        int saved_errno = errno;
+        free (hist);
+        errno = saved_errno;
+    }
+}
+
+struct histogram *histogram_create (void)
+{
+    struct histogram *hist;
+
+    if (!(hist = malloc (sizeof (*hist)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    histogram_clear (hist);
+    return hist;
+}
+
+void histogram_clear (struct histogram *hist)
+{
+    if (hist) {
+        memset (hist, 0, sizeof (*hist));
+        hist->min = UINT64_MAX;
+    }
+}
+
+void histogram_record (struct histogram *hist, uint64_t value)
+{
+    if (hist) {
+        hist->bucket[bucket_index (value)]++;
+        hist->count++;
+        hist->sum += value;
+        if (hist->min > value)
+            hist->min = value;
+        if (hist->max < value)
+            hist->max = value;
+    }
+}
+
+uint64_t histogram_count (struct histogram *hist)
+{
+    return hist ? hist->count : 0;
+}
+
+uint64_t histogram_min (struct histogram *hist)
+{
+    return hist && hist->count > 0 ? hist->min : 0;
+}
+
+uint64_t histogram_max (struct histogram *hist)
+{
+    return hist ? hist->max : 0;
+}
+
+double histogram_mean (struct histogram *hist)
+{
+    return hist && hist->count > 0 ? hist->sum / hist->count : 0;
+}
+
+uint64_t histogram_percentile (struct histogram *hist, double percentile)
+{
+    double rank;
+    uint64_t target;
+    uint64_t seen = 0;
+    int i;
+
+    if (!hist || hist->count == 0)
+        return 0;
+    if (percentile <= 0)
+        return hist->min;
+    if (percentile >= 100)
+        return hist->max;
+    rank = percentile / 100. * hist->count;
+    target = rank;
+    if (target < rank || target == 0)
+        target++;
+    for (i = 0; i < NBUCKETS - 1; i++) {
+        seen += hist->bucket[i];
+        if (seen >= target) {
+            uint64_t value = bucket_highest (i);
+            if (value > hist->max)
+                value = hist->max;
+            if (value < hist->min)
+                value = hist->min;
+            return value;
+        }
+    }
+    return hist->max;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,45 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_HISTOGRAM_H
+#define _UTIL_HISTOGRAM_H
+
+#include <stdint.h>
+
+/* Log-linear histogram of unsigned 64-bit values, in the style of
+ * HdrHistogram.  Each power of two is split into 16 linear buckets,
+ * so any recorded value is reported to within 1/16 (6.25%) of its
+ * true value.  Values below 16 are exact.  Recording is O(1) and
+ * does not allocate.  Count, min, max, and mean are exact.
+ */
+struct histogram;
+
+struct histogram *histogram_create (void);
+void histogram_destroy (struct histogram *hist);
+
+void histogram_record (struct histogram *hist, uint64_t value);
+void histogram_clear (struct histogram *hist);
+
+uint64_t histogram_count (struct histogram *hist);
+uint64_t histogram_min (struct histogram *hist);
+uint64_t histogram_max (struct histogram *hist);
+double histogram_mean (struct histogram *hist);
+
+/* Return the smallest value such that 'percentile' percent of recorded
+ * values are less than or equal to it, subject to bucket resolution.
+ * 'percentile' ranges from 0 to 100.  Returns 0 if the histogram is empty.
+ */
+uint64_t histogram_percentile (struct histogram *hist, double percentile);
+
+#endif /* !_UTIL_HISTOGRAM_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,255 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* mpscq.c - lock-free multi-producer, single-consumer queue
+ *
+ * Singly linked list with a stub node, after Dmitry Vyukov's
+ * non-intrusive MPSC node-based queue.  Producers swap themselves into
+ * 'head' with one atomic exchange, then link the previous head to the
+ * new node.  The consumer follows 'next' pointers from 'tail'.  Between
+ * the exchange and the link, the list is briefly broken and the consumer
+ * treats the queue as empty; 'count' lets it tell that case apart from
+ * a truly empty queue.
+ *
+ * Notification uses an eventfd written only on the empty to non-empty
+ * transition of 'count', so a busy queue costs no system calls.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+
+#include "mpscq.h"
+
+#define CACHELINE_SIZE 64
+
+struct mpscq_node {
+    struct mpscq_node *next;
+    void *item;
+};
+
+struct mpscq {
+    struct mpscq_node *head;        /* producers */
+    char pad1[CACHELINE_SIZE - sizeof (void *)];
+    struct mpscq_node *tail;        /* consumer */
+    struct mpscq_node stub;
+    char pad2[CACHELINE_SIZE - 3 * sizeof (void *)];
+    int count;
+    int pollfd;
+    mpscq_free_f destructor;
+};
+
+static void push_node (struct mpscq *q, struct mpscq_node *n)
+{
+    struct mpscq_node *prev;
+
+    __atomic_store_n (&n->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n (&q->head, n, __ATOMIC_ACQ_REL);
+    __atomic_store_n (&prev->next, n, __ATOMIC_RELEASE);
+}
+
+static struct mpscq_node *pop_node (struct mpscq *q)
+{
+    struct mpscq_node *tail = q->tail;
+    struct mpscq_node *next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    struct mpscq_node *head;
+
+    if (tail == &q->stub) {
+        if (!next)
+            return NULL;
+        q->tail = tail = next;
+        next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    head = __atomic_load_n (&q->head, __ATOMIC_ACQUIRE);
+    if (tail != head)
+        return NULL; // a producer is between exchange and link
+    /* 'tail' is the last node.  Put the stub behind it so it can be
+     * detached without racing a producer that is appending to it.
+     */
+    push_node (q, &q->stub);
+    next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void raise_event (struct mpscq *q)
+{
+    uint64_t val = 1;
+
+    /* eventfd write can only fail if the counter would overflow,
+     * which cannot happen since the consumer resets it to zero.
+     */
+    if (write (q->pollfd, &val, sizeof (val)) < 0)
+        return;
+}
+
+static int clear_event (struct mpscq *q)
+{
+    uint64_t val;
+
+    if (read (q->pollfd, &val, sizeof (val)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+    }
+    return 0;
+}
+
+void mpscq_destroy (struct mpscq *q)
+{
+    if (q) {
+        int saved_errno = errno;
+        struct mpscq_node *n;
+        while ((n = pop_node (q))) {
+            if (q->destructor)
+                q->destructor (n->item);
+            free (n);
+        }
+        if (q->pollfd >= 0)
+            close (q->pollfd);
+        free (q);
+        errno = saved_errno;
+    }
+}
+
+struct mpscq *mpscq_create (mpscq_free_f fun)
+{
+    struct mpscq *q;
+
+    if (!(q = calloc (1, sizeof (*q)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    q->head = q->tail = &q->stub;
+    q->destructor = fun;
+    if ((q->pollfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        goto error;
+    return q;
+error:
+    mpscq_destroy (q);
+    return NULL;
+}
+
+int mpscq_push (struct mpscq *q, void *item)
+{
+    struct mpscq_node *n;
+
+    if (!q || !item) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(n = malloc (sizeof (*n)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    n->item = item;
+    push_node (q, n);
+    if (__atomic_fetch_add (&q->count, 1, __ATOMIC_ACQ_REL) == 0)
+        raise_event (q);
+    return 0;
+}
+
+void *mpscq_pop (struct mpscq *q)
+{
+    struct mpscq_node *n;
+    void *item;
+
+    if (!q) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(n = pop_node (q))) {
+        errno = EWOULDBLOCK;
+        return NULL;
+    }
+    item = n->item;
+    free (n);
+    __atomic_fetch_sub (&q->count, 1, __ATOMIC_ACQ_REL);
+    return item;
+}
+
+void *mpscq_pop_wait (struct mpscq *q)
+{
+    struct pollfd pfd;
+    void *item;
+
+    if (!q) {
+        errno = EINVAL;
+        return NULL;
+    }
+    pfd.fd = q->pollfd;
+    pfd.events = POLLIN;
+    for (;;) {
+        if ((item = mpscq_pop (q)))
+            return item;
+        if (clear_event (q) < 0)
+            return NULL;
+        /* A producer that raises 'count' from zero after this point
+         * also writes the eventfd, so poll() cannot miss it.
+         */
+        if ((item = mpscq_pop (q)))
+            return item;
+        if (mpscq_count (q) > 0) {
+            sched_yield (); // producer is mid-push
+            continue;
+        }
+        if (poll (&pfd, 1, -1) < 0 && errno != EINTR)
+            return NULL;
+    }
+}
+
+int mpscq_count (struct mpscq *q)
+{
+    if (!q) {
+        errno = EINVAL;
+        return -1;
+    }
+    return __atomic_load_n (&q->count, __ATOMIC_ACQUIRE);
+}
+
+int mpscq_pollevents (struct mpscq *q)
+{
+    int revents = POLLOUT;
+
+    if (!q) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (clear_event (q) < 0)
+        return -1;
+    if (mpscq_count (q) > 0)
+        revents |= POLLIN;
+    return revents;
+}
+
+int mpscq_pollfd (struct mpscq *q)
+{
+    if (!q) {
+        errno = EINVAL;
+        return -1;
+    }
+    return q->pollfd;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,65 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_MPSCQ_H
+#define _UTIL_MPSCQ_H
+
+#include <poll.h>
+
+/* Unbounded lock-free multi-producer, single-consumer queue of pointers.
+ * Any thread may push.  Only one thread at a time may pop, poll, or
+ * destroy the queue.  Pushing a non-NULL item transfers it to the consumer.
+ */
+struct mpscq;
+
+typedef void (*mpscq_free_f)(void *item);
+
+/* Create/destroy queue.
+ * If 'fun' is non-NULL, mpscq_destroy () will use it to destroy any
+ * items on the queue at that time.
+ */
+struct mpscq *mpscq_create (mpscq_free_f fun);
+void mpscq_destroy (struct mpscq *q);
+
+/* Append 'item' to the queue.  Safe to call from any thread.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int mpscq_push (struct mpscq *q, void *item);
+
+/* Remove the oldest item from the queue (consumer only).
+ * mpscq_pop () returns NULL with errno = EWOULDBLOCK if no item is ready.
+ * mpscq_pop_wait () blocks until an item is ready.
+ */
+void *mpscq_pop (struct mpscq *q);
+void *mpscq_pop_wait (struct mpscq *q);
+
+/* Number of items pushed and not yet popped.  An item counted here may
+ * briefly be invisible to mpscq_pop () while its producer completes the push.
+ */
+int mpscq_count (struct mpscq *q);
+
+/* Get the queue 'pollevents' bitmask (consumer only).
+ * POLLIN = items can be removed with mpscq_pop()
+ * POLLOUT = items can be added with mpscq_push() (always set)
+ * Returns pollevents on success, -1 on error with errno set.
+ */
+int mpscq_pollevents (struct mpscq *q);
+
+/* Obtain a file descriptor that becomes readable when the queue goes
+ * from empty to non-empty (edge triggered).  Call mpscq_pollevents ()
+ * to re-arm it.  The file descriptor belongs to the queue.
+ */
+int mpscq_pollfd (struct mpscq *q);
+
+#endif /* !_UTIL_MPSCQ_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
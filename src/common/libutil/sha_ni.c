@@ -0,0 +1,504 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* sha_ni.c - SHA-1 and SHA-256 with the x86 SHA extensions
+ *
+ * The round structure follows the Intel SHA extensions white paper.
+ * Messages are padded up front, so the kernels below only ever see
+ * whole 64 byte blocks: those of the message, then one or two blocks
+ * holding the tail, the 0x80 terminator and the big-endian bit length.
+ *
+ * The kernels are built with a function target attribute, so the rest
+ * of the tree need not be compiled for a CPU that has SHA-NI.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <string.h>
+
+#include "sha_ni.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+struct lane {
+    const uint8_t *data;    // message
+    size_t nblocks;         // whole blocks in message
+    size_t total;           // nblocks + padding blocks
+    uint8_t pad[128];       // padding blocks
+};
+
+static void lane_init (struct lane *l, const void *data, size_t len)
+{
+    size_t rem = len % 64;
+    size_t npad = rem < 56 ? 1 : 2;
+    uint64_t bits = (uint64_t)len * 8;
+    int i;
+
+    l->data = data;
+    l->nblocks = len / 64;
+    l->total = l->nblocks + npad;
+    memset (l->pad, 0, sizeof (l->pad));
+    if (rem > 0)
+        memcpy (l->pad, l->data + len - rem, rem);
+    l->pad[rem] = 0x80;
+    for (i = 0; i < 8; i++)
+        l->pad[npad * 64 - 1 - i] = bits >> (8 * i);
+}
+
+static inline const uint8_t *lane_block (const struct lane *l, size_t i)
+{
+    if (i < l->nblocks)
+        return l->data + 64 * i;
+    return l->pad + 64 * (i - l->nblocks);
+}
+
+static void store_be32 (uint8_t *p, const uint32_t *w, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        p[4 * i] = w[i] >> 24;
+        p[4 * i + 1] = w[i] >> 16;
+        p[4 * i + 2] = w[i] >> 8;
+        p[4 * i + 3] = w[i];
+    }
+}
+
+/* SHA-256
+ */
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t IV256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/* The SHA-NI state is held as ABEF, CDGH.
+ */
+SHA_NI_TARGET
+static inline void sha256_load (const uint32_t state[8],
+                                __m128i *abef,
+                                __m128i *cdgh)
+{
+    __m128i tmp = _mm_loadu_si128 ((const __m128i *)&state[0]);
+    __m128i st1 = _mm_loadu_si128 ((const __m128i *)&state[4]);
+
+    tmp = _mm_shuffle_epi32 (tmp, 0xB1);            // CDAB
+    st1 = _mm_shuffle_epi32 (st1, 0x1B);            // EFGH
+    *abef = _mm_alignr_epi8 (tmp, st1, 8);
+    *cdgh = _mm_blend_epi16 (st1, tmp, 0xF0);
+}
+
+SHA_NI_TARGET
+static inline void sha256_store (uint32_t state[8], __m128i abef, __m128i cdgh)
+{
+    __m128i tmp = _mm_shuffle_epi32 (abef, 0x1B);   // FEBA
+
+    cdgh = _mm_shuffle_epi32 (cdgh, 0xB1);          // DCHG
+    _mm_storeu_si128 ((__m128i *)&state[0], _mm_blend_epi16 (tmp, cdgh, 0xF0));
+    _mm_storeu_si128 ((__m128i *)&state[4], _mm_alignr_epi8 (cdgh, tmp, 8));
+}
+
+#define SHA256_MASK \
+    _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL)
+
+#define SHA256_LOAD(L, w, i) \
+    L##w = _mm_shuffle_epi8 ( \
+        _mm_loadu_si128 ((const __m128i *)(L##p + 16 * (i))), SHA256_MASK)
+
+/* w0..w3 hold W[i-4]..W[i-1]; W[i] replaces W[i-4] in w0.
+ */
+#define SHA256_SCHED(L, w0, w1, w2, w3) \
+    L##w0 = _mm_sha256msg2_epu32 ( \
+        _mm_add_epi32 (_mm_sha256msg1_epu32 (L##w0, L##w1), \
+                       _mm_alignr_epi8 (L##w3, L##w2, 4)), \
+        L##w3)
+
+#define SHA256_RNDS(L, w, i) do { \
+    __m128i m_ = _mm_add_epi32 (L##w, \
+        _mm_loadu_si128 ((const __m128i *)&K256[4 * (i)])); \
+    L##cdgh = _mm_sha256rnds2_epu32 (L##cdgh, L##abef, m_); \
+    m_ = _mm_shuffle_epi32 (m_, 0x0E); \
+    L##abef = _mm_sha256rnds2_epu32 (L##abef, L##cdgh, m_); \
+} while (0)
+
+#define SHA256_QUAD_LOAD(L, i, w) do { \
+    SHA256_LOAD (L, w, i); \
+    SHA256_RNDS (L, w, i); \
+} while (0)
+
+#define SHA256_QUAD(L, i, w0, w1, w2, w3) do { \
+    SHA256_SCHED (L, w0, w1, w2, w3); \
+    SHA256_RNDS (L, w0, i); \
+} while (0)
+
+/* Apply OP(i, ...) to all 64 rounds, four at a time.
+ */
+#define SHA256_ALL(OPL, OP) \
+    OPL (0, w0); OPL (1, w1); OPL (2, w2); OPL (3, w3); \
+    OP (4, w0, w1, w2, w3); OP (5, w1, w2, w3, w0); \
+    OP (6, w2, w3, w0, w1); OP (7, w3, w0, w1, w2); \
+    OP (8, w0, w1, w2, w3); OP (9, w1, w2, w3, w0); \
+    OP (10, w2, w3, w0, w1); OP (11, w3, w0, w1, w2); \
+    OP (12, w0, w1, w2, w3); OP (13, w1, w2, w3, w0); \
+    OP (14, w2, w3, w0, w1); OP (15, w3, w0, w1, w2)
+
+#define SHA256_X1_OPL(i, w) SHA256_QUAD_LOAD (a_, i, w)
+#define SHA256_X1_OP(i, w0, w1, w2, w3) SHA256_QUAD (a_, i, w0, w1, w2, w3)
+
+#define SHA256_X2_OPL(i, w) do { \
+    SHA256_QUAD_LOAD (a_, i, w); \
+    SHA256_QUAD_LOAD (b_, i, w); \
+} while (0)
+#define SHA256_X2_OP(i, w0, w1, w2, w3) do { \
+    SHA256_QUAD (a_, i, w0, w1, w2, w3); \
+    SHA256_QUAD (b_, i, w0, w1, w2, w3); \
+} while (0)
+
+SHA_NI_TARGET
+static void sha256_blocks (uint32_t state[8],
+                           const struct lane *a,
+                           size_t start,
+                           size_t count)
+{
+    __m128i a_abef, a_cdgh, a_w0, a_w1, a_w2, a_w3;
+    __m128i abef_save, cdgh_save;
+    const uint8_t *a_p;
+    size_t n;
+
+    sha256_load (state, &a_abef, &a_cdgh);
+    for (n = start; n < start + count; n++) {
+        a_p = lane_block (a, n);
+        abef_save = a_abef;
+        cdgh_save = a_cdgh;
+        SHA256_ALL (SHA256_X1_OPL, SHA256_X1_OP);
+        a_abef = _mm_add_epi32 (a_abef, abef_save);
+        a_cdgh = _mm_add_epi32 (a_cdgh, cdgh_save);
+    }
+    sha256_store (state, a_abef, a_cdgh);
+}
+
+SHA_NI_TARGET
+static void sha256_blocks_x2 (uint32_t state_a[8],
+                              const struct lane *a,
+                              uint32_t state_b[8],
+                              const struct lane *b,
+                              size_t count)
+{
+    __m128i a_abef, a_cdgh, a_w0, a_w1, a_w2, a_w3;
+    __m128i b_abef, b_cdgh, b_w0, b_w1, b_w2, b_w3;
+    __m128i a_abef_save, a_cdgh_save, b_abef_save, b_cdgh_save;
+    const uint8_t *a_p, *b_p;
+    size_t n;
+
+    sha256_load (state_a, &a_abef, &a_cdgh);
+    sha256_load (state_b, &b_abef, &b_cdgh);
+    for (n = 0; n < count; n++) {
+        a_p = lane_block (a, n);
+        b_p = lane_block (b, n);
+        a_abef_save = a_abef;
+        a_cdgh_save = a_cdgh;
+        b_abef_save = b_abef;
+        b_cdgh_save = b_cdgh;
+        SHA256_ALL (SHA256_X2_OPL, SHA256_X2_OP);
+        a_abef = _mm_add_epi32 (a_abef, a_abef_save);
+        a_cdgh = _mm_add_epi32 (a_cdgh, a_cdgh_save);
+        b_abef = _mm_add_epi32 (b_abef, b_abef_save);
+        b_cdgh = _mm_add_epi32 (b_cdgh, b_cdgh_save);
+    }
+    sha256_store (state_a, a_abef, a_cdgh);
+    sha256_store (state_b, b_abef, b_cdgh);
+}
+
+void sha256_ni_hash (const void *data, size_t len, uint8_t digest[32])
+{
+    struct lane a;
+    uint32_t state[8];
+
+    lane_init (&a, data, len);
+    memcpy (state, IV256, sizeof (state));
+    sha256_blocks (state, &a, 0, a.total);
+    store_be32 (digest, state, 8);
+}
+
+void sha256_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[32],
+                        const void *data1, size_t len1, uint8_t digest1[32])
+{
+    struct lane a, b;
+    uint32_t state_a[8], state_b[8];
+    size_t common;
+
+    lane_init (&a, data0, len0);
+    lane_init (&b, data1, len1);
+    memcpy (state_a, IV256, sizeof (state_a));
+    memcpy (state_b, IV256, sizeof (state_b));
+    common = a.total < b.total ? a.total : b.total;
+    sha256_blocks_x2 (state_a, &a, state_b, &b, common);
+    if (a.total > common)
+        sha256_blocks (state_a, &a, common, a.total - common);
+    if (b.total > common)
+        sha256_blocks (state_b, &b, common, b.total - common);
+    store_be32 (digest0, state_a, 8);
+    store_be32 (digest1, state_b, 8);
+}
+
+/* SHA-1
+ */
+
+static const uint32_t IV1[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+#define SHA1_MASK \
+    _mm_set_epi64x (0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL)
+
+#define SHA1_LOAD(L, w, i) \
+    L##w = _mm_shuffle_epi8 ( \
+        _mm_loadu_si128 ((const __m128i *)(L##p + 16 * (i))), SHA1_MASK)
+
+/* w0..w3 hold W[i-4]..W[i-1]; W[i] replaces W[i-4] in w0.
+ */
+#define SHA1_SCHED(L, w0, w1, w2, w3) \
+    L##w0 = _mm_sha1msg2_epu32 ( \
+        _mm_xor_si128 (_mm_sha1msg1_epu32 (L##w0, L##w1), L##w2), L##w3)
+
+/* Rounds 4i..4i+3.  'ex' holds E for these rounds, 'ey' receives ABCD
+ * to derive E for the next four.  The round function changes every 20.
+ */
+#define SHA1_RNDS(L, i, w, ex, ey) do { \
+    L##ex = _mm_sha1nexte_epu32 (L##ex, L##w); \
+    L##ey = L##abcd; \
+    L##abcd = _mm_sha1rnds4_epu32 (L##abcd, L##ex, (i) / 5); \
+} while (0)
+
+#define SHA1_QUAD_FIRST(L) do { \
+    SHA1_LOAD (L, w0, 0); \
+    L##e0 = _mm_add_epi32 (L##e0, L##w0); \
+    L##e1 = L##abcd; \
+    L##abcd = _mm_sha1rnds4_epu32 (L##abcd, L##e0, 0); \
+} while (0)
+
+#define SHA1_QUAD_LOAD(L, i, w, ex, ey) do { \
+    SHA1_LOAD (L, w, i); \
+    SHA1_RNDS (L, i, w, ex, ey); \
+} while (0)
+
+#define SHA1_QUAD(L, i, w0, w1, w2, w3, ex, ey) do { \
+    SHA1_SCHED (L, w0, w1, w2, w3); \
+    SHA1_RNDS (L, i, w0, ex, ey); \
+} while (0)
+
+#define SHA1_ALL(OPF, OPL, OP) \
+    OPF (); \
+    OPL (1, w1, e1, e0); OPL (2, w2, e0, e1); OPL (3, w3, e1, e0); \
+    OP (4, w0, w1, w2, w3, e0, e1); OP (5, w1, w2, w3, w0, e1, e0); \
+    OP (6, w2, w3, w0, w1, e0, e1); OP (7, w3, w0, w1, w2, e1, e0); \
+    OP (8, w0, w1, w2, w3, e0, e1); OP (9, w1, w2, w3, w0, e1, e0); \
+    OP (10, w2, w3, w0, w1, e0, e1); OP (11, w3, w0, w1, w2, e1, e0); \
+    OP (12, w0, w1, w2, w3, e0, e1); OP (13, w1, w2, w3, w0, e1, e0); \
+    OP (14, w2, w3, w0, w1, e0, e1); OP (15, w3, w0, w1, w2, e1, e0); \
+    OP (16, w0, w1, w2, w3, e0, e1); OP (17, w1, w2, w3, w0, e1, e0); \
+    OP (18, w2, w3, w0, w1, e0, e1); OP (19, w3, w0, w1, w2, e1, e0)
+
+#define SHA1_X1_OPF() SHA1_QUAD_FIRST (a_)
+#define SHA1_X1_OPL(i, w, ex, ey) SHA1_QUAD_LOAD (a_, i, w, ex, ey)
+#define SHA1_X1_OP(i, w0, w1, w2, w3, ex, ey) \
+    SHA1_QUAD (a_, i, w0, w1, w2, w3, ex, ey)
+
+#define SHA1_X2_OPF() do { \
+    SHA1_QUAD_FIRST (a_); \
+    SHA1_QUAD_FIRST (b_); \
+} while (0)
+#define SHA1_X2_OPL(i, w, ex, ey) do { \
+    SHA1_QUAD_LOAD (a_, i, w, ex, ey); \
+    SHA1_QUAD_LOAD (b_, i, w, ex, ey); \
+} while (0)
+#define SHA1_X2_OP(i, w0, w1, w2, w3, ex, ey) do { \
+    SHA1_QUAD (a_, i, w0, w1, w2, w3, ex, ey); \
+    SHA1_QUAD (b_, i, w0, w1, w2, w3, ex, ey); \
+} while (0)
+
+/* The SHA-NI state is held as ABCD (A in the high word) and E in the
+ * high word of a second register.
+ */
+SHA_NI_TARGET
+static void sha1_blocks (uint32_t state[5],
+                         const struct lane *a,
+                         size_t start,
+                         size_t count)
+{
+    __m128i a_abcd, a_e0, a_e1, a_w0, a_w1, a_w2, a_w3;
+    __m128i abcd_save, e0_save;
+    const uint8_t *a_p;
+    size_t n;
+
+    a_abcd = _mm_shuffle_epi32 (
+                _mm_loadu_si128 ((const __m128i *)state), 0x1B);
+    a_e0 = _mm_set_epi32 (state[4], 0, 0, 0);
+    for (n = start; n < start + count; n++) {
+        a_p = lane_block (a, n);
+        abcd_save = a_abcd;
+        e0_save = a_e0;
+        SHA1_ALL (SHA1_X1_OPF, SHA1_X1_OPL, SHA1_X1_OP);
+        a_e0 = _mm_sha1nexte_epu32 (a_e0, e0_save);
+        a_abcd = _mm_add_epi32 (a_abcd, abcd_save);
+    }
+    _mm_storeu_si128 ((__m128i *)state, _mm_shuffle_epi32 (a_abcd, 0x1B));
+    state[4] = _mm_extract_epi32 (a_e0, 3);
+}
+
+SHA_NI_TARGET
+static void sha1_blocks_x2 (uint32_t state_a[5],
+                            const struct lane *a,
+                            uint32_t state_b[5],
+                            const struct lane *b,
+                            size_t count)
+{
+    __m128i a_abcd, a_e0, a_e1, a_w0, a_w1, a_w2, a_w3;
+    __m128i b_abcd, b_e0, b_e1, b_w0, b_w1, b_w2, b_w3;
+    __m128i a_abcd_save, a_e0_save, b_abcd_save, b_e0_save;
+    const uint8_t *a_p, *b_p;
+    size_t n;
+
+    a_abcd = _mm_shuffle_epi32 (
+                _mm_loadu_si128 ((const __m128i *)state_a), 0x1B);
+    a_e0 = _mm_set_epi32 (state_a[4], 0, 0, 0);
+    b_abcd = _mm_shuffle_epi32 (
+                _mm_loadu_si128 ((const __m128i *)state_b), 0x1B);
+    b_e0 = _mm_set_epi32 (state_b[4], 0, 0, 0);
+    for (n = 0; n < count; n++) {
+        a_p = lane_block (a, n);
+        b_p = lane_block (b, n);
+        a_abcd_save = a_abcd;
+        a_e0_save = a_e0;
+        b_abcd_save = b_abcd;
+        b_e0_save = b_e0;
+        SHA1_ALL (SHA1_X2_OPF, SHA1_X2_OPL, SHA1_X2_OP);
+        a_e0 = _mm_sha1nexte_epu32 (a_e0, a_e0_save);
+        a_abcd = _mm_add_epi32 (a_abcd, a_abcd_save);
+        b_e0 = _mm_sha1nexte_epu32 (b_e0, b_e0_save);
+        b_abcd = _mm_add_epi32 (b_abcd, b_abcd_save);
+    }
+    _mm_storeu_si128 ((__m128i *)state_a, _mm_shuffle_epi32 (a_abcd, 0x1B));
+    state_a[4] = _mm_extract_epi32 (a_e0, 3);
+    _mm_storeu_si128 ((__m128i *)state_b, _mm_shuffle_epi32 (b_abcd, 0x1B));
+    state_b[4] = _mm_extract_epi32 (b_e0, 3);
+}
+
+void sha1_ni_hash (const void *data, size_t len, uint8_t digest[20])
+{
+    struct lane a;
+    uint32_t state[5];
+
+    lane_init (&a, data, len);
+    memcpy (state, IV1, sizeof (state));
+    sha1_blocks (state, &a, 0, a.total);
+    store_be32 (digest, state, 5);
+}
+
+void sha1_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[20],
+                      const void *data1, size_t len1, uint8_t digest1[20])
+{
+    struct lane a, b;
+    uint32_t state_a[5], state_b[5];
+    size_t common;
+
+    lane_init (&a, data0, len0);
+    lane_init (&b, data1, len1);
+    memcpy (state_a, IV1, sizeof (state_a));
+    memcpy (state_b, IV1, sizeof (state_b));
+    common = a.total < b.total ? a.total : b.total;
+    sha1_blocks_x2 (state_a, &a, state_b, &b, common);
+    if (a.total > common)
+        sha1_blocks (state_a, &a, common, a.total - common);
+    if (b.total > common)
+        sha1_blocks (state_b, &b, common, b.total - common);
+    store_be32 (digest0, state_a, 5);
+    store_be32 (digest1, state_b, 5);
+}
+
+/* SHA-NI needs SSSE3 and SSE4.1 as well for the shuffles and blends.
+ */
+static bool sha_ni_probe (void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)
+        || !(ecx & bit_SSSE3)
+        || !(ecx & bit_SSE4_1))
+        return false;
+    if (!__get_cpuid_count (7, 0, &eax, &ebx, &ecx, &edx)
+        || !(ebx & (1U << 29)))
+        return false;
+    return true;
+}
+
+bool sha_ni_available (void)
+{
+    static int available = -1;
+
+    if (available < 0)
+        available = sha_ni_probe () ? 1 : 0;
+    return available == 1;
+}
+
+#else /* !x86_64 */
+
+bool sha_ni_available (void)
+{
+    return false;
+}
+
+void sha1_ni_hash (const void *data, size_t len, uint8_t digest[20])
+{
+}
+
+void sha256_ni_hash (const void *data, size_t len, uint8_t digest[32])
+{
+}
+
+void sha1_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[20],
+                      const void *data1, size_t len1, uint8_t digest1[20])
+{
+}
+
+void sha256_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[32],
+                        const void *data1, size_t len1, uint8_t digest1[32])
+{
+}
+
+#endif
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
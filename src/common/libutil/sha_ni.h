@@ -0,0 +1,40 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_SHA_NI_H
+#define _UTIL_SHA_NI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* One-shot SHA-1 and SHA-256 using the x86 SHA extensions (SHA-NI).
+ * Only call these if sha_ni_available() returns true, which it never
+ * does on other architectures.
+ */
+bool sha_ni_available (void);
+
+void sha1_ni_hash (const void *data, size_t len, uint8_t digest[20]);
+void sha256_ni_hash (const void *data, size_t len, uint8_t digest[32]);
+
+/* Hash two buffers at once.  The rounds of the two computations are
+ * interleaved so the CPU can overlap their latencies, which is faster
+ * than hashing them one after the other.
+ */
+void sha1_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[20],
+                      const void *data1, size_t len1, uint8_t digest1[20]);
+void sha256_ni_hash_x2 (const void *data0, size_t len0, uint8_t digest0[32],
+                        const void *data1, size_t len1, uint8_t digest1[32]);
+
+#endif /* !_UTIL_SHA_NI_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
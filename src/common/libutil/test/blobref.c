@@ -14,6 +14,7 @@
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/sha1.h"
 #include "src/common/libutil/sha256.h"
+#include "src/common/libutil/sha_ni.h"
 
 const char *badref[] = {
     "nerf-4d4ed591f7d26abd8145650f334d283bdb661765", // unknown hash
@@ -26,15 +27,111 @@ const char *badref[] = {
 const char *goodref[] = {
     "sha1-4d4ed591f7d26abd8145650f334d283bdb661765",
     "sha256-a99c07ce93703c7390589c5b007bd9a97a8b6de29e9a920d474d4f028ce2d42c",
+    "blake3-af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
     NULL,
 };
 
+/* Lengths around the SHA padding boundaries and the BLAKE3 block and
+ * chunk boundaries.
+ */
+const int testlen[] = {
+    0, 1, 55, 56, 63, 64, 65, 119, 120, 128,
+    1023, 1024, 1025, 2048, 4097, 65536,
+};
+#define NTESTLEN (sizeof (testlen) / sizeof (testlen[0]))
+
+static void portable_ref (const char *hashtype,
+                          const void *data,
+                          int len,
+                          char *ref,
+                          int ref_len)
+{
+    uint8_t digest[BLOBREF_MAX_DIGEST_SIZE];
+
+    if (!strcmp (hashtype, "sha1")) {
+        SHA1_CTX ctx;
+        SHA1_Init (&ctx);
+        SHA1_Update (&ctx, data, len);
+        SHA1_Final (&ctx, digest);
+        blobref_hashtostr ("sha1", digest, SHA1_DIGEST_SIZE, ref, ref_len);
+    }
+    else {
+        SHA256_CTX ctx;
+        sha256_init (&ctx);
+        sha256_update (&ctx, data, len);
+        sha256_final (&ctx, digest);
+        blobref_hashtostr ("sha256", digest, SHA256_BLOCK_SIZE, ref, ref_len);
+    }
+}
+
+/* blobref_hash() may use SHA-NI, so check it against the portable code.
+ */
+static void test_dispatch (const char *hashtype, const uint8_t *buf)
+{
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    char ref2[BLOBREF_MAX_STRING_SIZE];
+    int errors = 0;
+    int i;
+
+    for (i = 0; i < NTESTLEN; i++) {
+        portable_ref (hashtype, buf, testlen[i], ref, sizeof (ref));
+        if (blobref_hash (hashtype, buf, testlen[i], ref2, sizeof (ref2)) < 0
+            || strcmp (ref, ref2) != 0) {
+            diag ("%s len=%d: %s != %s", hashtype, testlen[i], ref2, ref);
+            errors++;
+        }
+    }
+    ok (errors == 0,
+        "blobref_hash %s matches portable implementation (sha-ni %s)",
+        hashtype,
+        sha_ni_available () ? "available" : "unavailable");
+}
+
+/* Pair every length with every other, so interleaved lanes finish at
+ * different blocks, and include an odd request at the end.
+ */
+static void test_batch (const char *hashtype, const uint8_t *buf)
+{
+    struct blobref_hashreq req[NTESTLEN * NTESTLEN + 1];
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    int count = 0;
+    int errors = 0;
+    int i, j;
+
+    for (i = 0; i < NTESTLEN; i++) {
+        for (j = 0; j < NTESTLEN; j++) {
+            req[count].data = buf + j;
+            req[count].len = testlen[(i + j) % NTESTLEN];
+            count++;
+        }
+    }
+    req[count].data = buf;
+    req[count].len = 100;
+    count++;
+
+    ok (blobref_hash_batch (hashtype, req, count) == 0,
+        "blobref_hash_batch %s works on %d requests", hashtype, count);
+    for (i = 0; i < count; i++) {
+        if (blobref_hash (hashtype, req[i].data, req[i].len,
+                          ref, sizeof (ref)) < 0
+            || strcmp (ref, req[i].blobref) != 0) {
+            diag ("%s req %d len=%d: %s != %s",
+                  hashtype, i, req[i].len, req[i].blobref, ref);
+            errors++;
+        }
+    }
+    ok (errors == 0,
+        "blobref_hash_batch %s results match blobref_hash", hashtype);
+}
+
 int main(int argc, char** argv)
 {
     char ref[BLOBREF_MAX_STRING_SIZE];
     char ref2[BLOBREF_MAX_STRING_SIZE];
     uint8_t digest[BLOBREF_MAX_DIGEST_SIZE];
     uint8_t data[1024];
+    static uint8_t buf[65536 + NTESTLEN];
+    int i;
 
     plan (NO_PLAN);
 
@@ -131,6 +228,48 @@ int main(int argc, char** argv)
     ok (strcmp (ref, ref2) == 0,
         "and blobrefs match");
 
+    /* blake3 */
+    ok (blobref_hash ("blake3", NULL, 0, ref, sizeof (ref)) == 0
+        && !strcmp (ref, "blake3-af1349b9f5f9a1a6a0404dea36dcc949"
+                         "9bcb25c9adc112b7cc9a93cae41f3262"),
+        "blobref_hash blake3 handles zero length data");
+    diag ("%s", ref);
+    ok (blobref_hash ("blake3", "abc", 3, ref, sizeof (ref)) == 0
+        && !strcmp (ref, "blake3-6437b3ac38465133ffb63b75273a8db5"
+                         "48c558465d79db03fd359c6cd5bd9d85"),
+        "blobref_hash blake3 abc works");
+    diag ("%s", ref);
+    ok (blobref_hash ("blake3", data, sizeof (data), ref, sizeof (ref)) == 0
+        && !strcmp (ref, "blake3-72a4c14a61b6eb4f41f8428112ad9d4b"
+                         "c6dd0b3e1b3dde3c7372b9e2f564d167"),
+        "blobref_hash blake3 works on a full chunk");
+    diag ("%s", ref);
+
+    ok (blobref_strtohash (ref, digest, sizeof (digest)) == 32,
+        "blobref_strtohash returns expected size hash");
+    ok (blobref_hashtostr ("blake3", digest, 32, ref2, sizeof (ref2)) == 0,
+        "blobref_hashtostr back again works");
+    ok (strcmp (ref, ref2) == 0,
+        "and blobrefs match");
+
+    /* accelerated and batch hashing */
+    for (i = 0; i < sizeof (buf); i++)
+        buf[i] = i % 251;
+    test_dispatch ("sha1", buf);
+    test_dispatch ("sha256", buf);
+    test_batch ("sha1", buf);
+    test_batch ("sha256", buf);
+    test_batch ("blake3", buf);
+
+    ok (blobref_hash_batch ("sha1", NULL, 0) == 0,
+        "blobref_hash_batch works with zero requests");
+    errno = 0;
+    ok (blobref_hash_batch ("nerf", NULL, 0) < 0 && errno == EINVAL,
+        "blobref_hash_batch fails EINVAL with unknown hash name");
+    errno = 0;
+    ok (blobref_hash_batch ("sha1", NULL, 1) < 0 && errno == EINVAL,
+        "blobref_hash_batch fails EINVAL with NULL request array");
+
     /* blobref_validate */
     const char **pp;
     pp = &goodref[0];
@@ -152,6 +291,8 @@ int main(int argc, char** argv)
         "blobref_validate_hashtype sha1 is valid");
     ok (blobref_validate_hashtype ("sha256") == 0,
         "blobref_validate_hashtype sha256 is valid");
+    ok (blobref_validate_hashtype ("blake3") == 0,
+        "blobref_validate_hashtype blake3 is valid");
     ok (blobref_validate_hashtype ("nerf") == -1,
         "blobref_validate_hashtype nerf is invalid");
     ok (blobref_validate_hashtype (NULL) == -1,
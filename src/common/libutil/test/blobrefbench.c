@@ -0,0 +1,178 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* blobrefbench.c - measure blobref hash throughput
+ *
+ * Usage: blobrefbench [size [total-MB]]
+ *
+ * Hash 'total' bytes as 'size' byte buffers (default 4096 bytes, 256MB)
+ * with the portable sha1 and sha256 code, with SHA-NI one buffer at a
+ * time and two at a time if the CPU supports it, with blobref_hash()
+ * and blobref_hash_batch() for each blobref hash type.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/blobref.h"
+#include "src/common/libutil/sha1.h"
+#include "src/common/libutil/sha256.h"
+#include "src/common/libutil/sha_ni.h"
+
+#define BATCH_SIZE 64
+
+static int size = 4096;
+static int count;
+static uint8_t *buf;
+
+static void report (const char *name, struct timespec t0)
+{
+    double ms = monotime_since (t0);
+
+    printf ("%-28s %10.1f MB/s %10.0f hashes/s\n",
+            name,
+            ((double)size * count / (1024 * 1024)) / (ms / 1000),
+            count / (ms / 1000));
+}
+
+static void bench_sha1_portable (void)
+{
+    struct timespec t0;
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    SHA1_CTX ctx;
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count; i++) {
+        SHA1_Init (&ctx);
+        SHA1_Update (&ctx, buf, size);
+        SHA1_Final (&ctx, digest);
+    }
+    report ("sha1 portable", t0);
+}
+
+static void bench_sha256_portable (void)
+{
+    struct timespec t0;
+    uint8_t digest[SHA256_BLOCK_SIZE];
+    SHA256_CTX ctx;
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count; i++) {
+        sha256_init (&ctx);
+        sha256_update (&ctx, buf, size);
+        sha256_final (&ctx, digest);
+    }
+    report ("sha256 portable", t0);
+}
+
+static void bench_sha_ni (void)
+{
+    struct timespec t0;
+    uint8_t d0[SHA256_BLOCK_SIZE];
+    uint8_t d1[SHA256_BLOCK_SIZE];
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count; i++)
+        sha1_ni_hash (buf, size, d0);
+    report ("sha1 sha-ni", t0);
+
+    monotime (&t0);
+    for (i = 0; i + 1 < count; i += 2)
+        sha1_ni_hash_x2 (buf, size, d0, buf, size, d1);
+    report ("sha1 sha-ni x2", t0);
+
+    monotime (&t0);
+    for (i = 0; i < count; i++)
+        sha256_ni_hash (buf, size, d0);
+    report ("sha256 sha-ni", t0);
+
+    monotime (&t0);
+    for (i = 0; i + 1 < count; i += 2)
+        sha256_ni_hash_x2 (buf, size, d0, buf, size, d1);
+    report ("sha256 sha-ni x2", t0);
+}
+
+static void bench_blobref (const char *hashtype)
+{
+    struct timespec t0;
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    struct blobref_hashreq req[BATCH_SIZE];
+    char name[64];
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count; i++) {
+        if (blobref_hash (hashtype, buf, size, ref, sizeof (ref)) < 0)
+            log_err_exit ("blobref_hash %s", hashtype);
+    }
+    snprintf (name, sizeof (name), "blobref_hash %s", hashtype);
+    report (name, t0);
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        req[i].data = buf;
+        req[i].len = size;
+    }
+    monotime (&t0);
+    for (i = 0; i < count; i += BATCH_SIZE) {
+        if (blobref_hash_batch (hashtype, req, BATCH_SIZE) < 0)
+            log_err_exit ("blobref_hash_batch %s", hashtype);
+    }
+    snprintf (name, sizeof (name), "blobref_hash_batch %s", hashtype);
+    report (name, t0);
+}
+
+int main (int argc, char *argv[])
+{
+    long total = 256;
+
+    log_init ("blobrefbench");
+
+    if (argc > 1)
+        size = strtol (argv[1], NULL, 10);
+    if (argc > 2)
+        total = strtol (argv[2], NULL, 10);
+    if (size <= 0 || total <= 0)
+        log_msg_exit ("Usage: blobrefbench [size [total-MB]]");
+    count = (total * 1024 * 1024) / size;
+    count -= count % BATCH_SIZE;
+    if (count == 0)
+        count = BATCH_SIZE;
+    if (!(buf = malloc (size)))
+        log_err_exit ("malloc");
+    memset (buf, 0x5a, size);
+
+    printf ("%d hashes of %d bytes\n", count, size);
+    bench_sha1_portable ();
+    bench_sha256_portable ();
+    if (sha_ni_available ())
+        bench_sha_ni ();
+    else
+        printf ("sha-ni is not available\n");
+    bench_blobref ("sha1");
+    bench_blobref ("sha256");
+    bench_blobref ("blake3");
+
+    free (buf);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
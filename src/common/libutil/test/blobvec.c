@@ -0,0 +1,123 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/blobvec.h"
+
+void check_basic (void)
+{
+    struct blobvec *bv;
+    const void *buf;
+    int len;
+    const void *data;
+    int datalen;
+    int cursor;
+    char big[8192];
+
+    memset (big, 0x5a, sizeof (big));
+
+    bv = blobvec_create ();
+    ok (bv != NULL,
+        "blobvec_create works");
+    ok (blobvec_count (bv) == 0,
+        "blobvec_count returns 0 on new vector");
+    blobvec_encode (bv, &buf, &len);
+    ok (len == 0,
+        "blobvec_encode of empty vector has zero length");
+    ok (blobvec_append (bv, "foo", 4) == 0,
+        "blobvec_append foo works");
+    ok (blobvec_append (bv, NULL, 0) == 0,
+        "blobvec_append empty blob works");
+    ok (blobvec_append_error (bv, ENOENT) == 0,
+        "blobvec_append_error ENOENT works");
+    ok (blobvec_append (bv, big, sizeof (big)) == 0,
+        "blobvec_append 8K blob works (grows buffer)");
+    ok (blobvec_count (bv) == 4,
+        "blobvec_count returns 4");
+
+    blobvec_encode (bv, &buf, &len);
+    ok (len == 4 * 4 + 4 + sizeof (big),
+        "blobvec_encode returns expected length");
+    ok (blobvec_decode_count (buf, len) == 4,
+        "blobvec_decode_count returns 4");
+
+    cursor = 0;
+    ok (blobvec_next (buf, len, &cursor, &data, &datalen) == 1
+        && datalen == 4 && !strcmp (data, "foo"),
+        "blobvec_next returns foo");
+    ok (blobvec_next (buf, len, &cursor, &data, &datalen) == 1
+        && datalen == 0,
+        "blobvec_next returns empty blob");
+    ok (blobvec_next (buf, len, &cursor, &data, &datalen) == 1
+        && datalen == -ENOENT && data == NULL,
+        "blobvec_next returns ENOENT error element");
+    ok (blobvec_next (buf, len, &cursor, &data, &datalen) == 1
+        && datalen == sizeof (big) && !memcmp (data, big, sizeof (big)),
+        "blobvec_next returns 8K blob");
+    ok (blobvec_next (buf, len, &cursor, &data, &datalen) == 0,
+        "blobvec_next returns 0 at end of vector");
+
+    blobvec_destroy (bv);
+}
+
+void check_invalid (void)
+{
+    struct blobvec *bv;
+    uint32_t n;
+    char buf[16];
+    int cursor;
+
+    if (!(bv = blobvec_create ()))
+        BAIL_OUT ("blobvec_create failed");
+    errno = 0;
+    ok (blobvec_append (bv, NULL, 1) < 0 && errno == EINVAL,
+        "blobvec_append data=NULL len=1 fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append (bv, "x", -1) < 0 && errno == EINVAL,
+        "blobvec_append len=-1 fails with EINVAL");
+    errno = 0;
+    ok (blobvec_append_error (bv, 0) < 0 && errno == EINVAL,
+        "blobvec_append_error errnum=0 fails with EINVAL");
+    blobvec_destroy (bv);
+
+    ok (blobvec_decode_count ("abc", 3) < 0 && errno == EPROTO,
+        "blobvec_decode_count fails with EPROTO on runt length");
+
+    n = htonl (100);
+    memcpy (buf, &n, sizeof (n));
+    errno = 0;
+    ok (blobvec_decode_count (buf, sizeof (buf)) < 0 && errno == EPROTO,
+        "blobvec_decode_count fails with EPROTO on truncated data");
+
+    cursor = sizeof (buf) + 1;
+    errno = 0;
+    ok (blobvec_next (buf, sizeof (buf), &cursor, NULL, NULL) < 0
+        && errno == EPROTO,
+        "blobvec_next fails with EPROTO on out of range cursor");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    check_basic ();
+    check_invalid ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,143 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/histogram.h"
+
+/* Reported value must be >= the true value and within 1/16 of it.
+ */
+static bool within_resolution (uint64_t reported, uint64_t actual)
+{
+    return reported >= actual && reported - actual <= actual / 16;
+}
+
+void test_empty (void)
+{
+    struct histogram *hist;
+
+    ok ((hist = histogram_create ()) != NULL,
+        "histogram_create works");
+    ok (histogram_count (hist) == 0
+        && histogram_min (hist) == 0
+        && histogram_max (hist) == 0
+        && histogram_mean (hist) == 0,
+        "empty histogram has zero count, min, max, mean");
+    ok (histogram_percentile (hist, 50) == 0,
+        "empty histogram reports zero for 50th percentile");
+    histogram_destroy (hist);
+
+    ok (histogram_count (NULL) == 0 && histogram_percentile (NULL, 50) == 0,
+        "histogram accessors tolerate NULL");
+    lives_ok ({histogram_record (NULL, 1);},
+        "histogram_record hist=NULL doesn't crash");
+    lives_ok ({histogram_destroy (NULL);},
+        "histogram_destroy hist=NULL doesn't crash");
+}
+
+void test_small (void)
+{
+    struct histogram *hist;
+    uint64_t i;
+
+    if (!(hist = histogram_create ()))
+        BAIL_OUT ("histogram_create failed");
+    for (i = 1; i <= 10; i++)
+        histogram_record (hist, i);
+    ok (histogram_count (hist) == 10,
+        "count is 10");
+    ok (histogram_min (hist) == 1 && histogram_max (hist) == 10,
+        "min is 1 and max is 10");
+    ok (histogram_mean (hist) == 5.5,
+        "mean is 5.5");
+    ok (histogram_percentile (hist, 50) == 5,
+        "50th percentile of 1..10 is exactly 5");
+    ok (histogram_percentile (hist, 90) == 9,
+        "90th percentile of 1..10 is exactly 9");
+    ok (histogram_percentile (hist, 100) == 10,
+        "100th percentile is max");
+    ok (histogram_percentile (hist, 0) == 1,
+        "0th percentile is min");
+
+    histogram_clear (hist);
+    ok (histogram_count (hist) == 0 && histogram_max (hist) == 0,
+        "histogram_clear resets count and max");
+    histogram_record (hist, 7);
+    ok (histogram_min (hist) == 7 && histogram_percentile (hist, 50) == 7,
+        "min and percentile are correct after clear");
+    histogram_destroy (hist);
+}
+
+void test_large (void)
+{
+    struct histogram *hist;
+    uint64_t i;
+    bool range_ok = true;
+
+    if (!(hist = histogram_create ()))
+        BAIL_OUT ("histogram_create failed");
+    for (i = 1; i <= 1000000; i++)
+        histogram_record (hist, i * 1000);
+    ok (histogram_count (hist) == 1000000,
+        "count is 1000000");
+    ok (histogram_min (hist) == 1000 && histogram_max (hist) == 1000000000,
+        "min and max are exact");
+    ok (within_resolution (histogram_percentile (hist, 50), 500000000),
+        "50th percentile is within resolution");
+    ok (within_resolution (histogram_percentile (hist, 99), 990000000),
+        "99th percentile is within resolution");
+    ok (within_resolution (histogram_percentile (hist, 99.9), 999000000),
+        "99.9th percentile is within resolution");
+    histogram_destroy (hist);
+
+    /* Check resolution of a single value across the whole range.
+     */
+    for (i = 16; i < (1ULL << 40); i = i * 3 + 1) {
+        if (!(hist = histogram_create ()))
+            BAIL_OUT ("histogram_create failed");
+        histogram_record (hist, 0);
+        histogram_record (hist, i);
+        if (!within_resolution (histogram_percentile (hist, 75), i)) {
+            diag ("value %ju reported as %ju", (uintmax_t)i,
+                  (uintmax_t)histogram_percentile (hist, 75));
+            range_ok = false;
+        }
+        histogram_destroy (hist);
+    }
+    ok (range_ok == true,
+        "single values up to 2^40 are reported within resolution");
+
+    if (!(hist = histogram_create ()))
+        BAIL_OUT ("histogram_create failed");
+    histogram_record (hist, UINT64_MAX);
+    histogram_record (hist, 1ULL << 50);
+    ok (histogram_max (hist) == UINT64_MAX
+        && histogram_percentile (hist, 50) == UINT64_MAX,
+        "values past the bucket range report max");
+    histogram_destroy (hist);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_empty ();
+    test_small ();
+    test_large ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,221 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/mpscq.h"
+
+#define NPRODUCERS  4
+#define NITEMS      100000
+
+struct item {
+    int producer;
+    int seq;
+};
+
+struct producer {
+    pthread_t t;
+    int id;
+    struct mpscq *q;
+    int errors;
+};
+
+static int free_count;
+
+static void item_free (void *arg)
+{
+    free (arg);
+    free_count++;
+}
+
+static void *producer_thread (void *arg)
+{
+    struct producer *p = arg;
+    int i;
+
+    for (i = 0; i < NITEMS; i++) {
+        struct item *item;
+        if (!(item = malloc (sizeof (*item)))) {
+            p->errors++;
+            continue;
+        }
+        item->producer = p->id;
+        item->seq = i;
+        if (mpscq_push (p->q, item) < 0) {
+            free (item);
+            p->errors++;
+        }
+    }
+    return NULL;
+}
+
+void test_basic (void)
+{
+    struct mpscq *q;
+    struct pollfd pfd;
+    char *s;
+    int e;
+
+    ok ((q = mpscq_create (free)) != NULL,
+        "mpscq_create works");
+    ok ((pfd.fd = mpscq_pollfd (q)) >= 0,
+        "mpscq_pollfd works");
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    ok (poll (&pfd, 1, 0) == 0,
+        "pollfd is not ready on empty queue");
+    ok ((e = mpscq_pollevents (q)) == POLLOUT,
+        "mpscq_pollevents on empty queue returns POLLOUT");
+    errno = 0;
+    ok (mpscq_pop (q) == NULL && errno == EWOULDBLOCK,
+        "mpscq_pop on empty queue fails with EWOULDBLOCK");
+    errno = 0;
+    ok (mpscq_push (q, NULL) < 0 && errno == EINVAL,
+        "mpscq_push item=NULL fails with EINVAL");
+
+    ok (mpscq_push (q, strdup ("foo")) == 0
+        && mpscq_push (q, strdup ("bar")) == 0
+        && mpscq_push (q, strdup ("baz")) == 0,
+        "mpscq_push works three times");
+    ok (mpscq_count (q) == 3,
+        "mpscq_count returns 3");
+    pfd.revents = 0;
+    ok (poll (&pfd, 1, 0) == 1 && pfd.revents == POLLIN,
+        "pollfd is ready");
+    ok ((e = mpscq_pollevents (q)) == (POLLIN | POLLOUT),
+        "mpscq_pollevents returns POLLIN | POLLOUT");
+    pfd.revents = 0;
+    ok (poll (&pfd, 1, 0) == 0,
+        "pollfd is not ready after mpscq_pollevents");
+
+    s = mpscq_pop (q);
+    ok (s != NULL && !strcmp (s, "foo"),
+        "mpscq_pop returns first item");
+    free (s);
+    s = mpscq_pop_wait (q);
+    ok (s != NULL && !strcmp (s, "bar"),
+        "mpscq_pop_wait returns second item");
+    free (s);
+    s = mpscq_pop (q);
+    ok (s != NULL && !strcmp (s, "baz"),
+        "mpscq_pop returns third item");
+    free (s);
+    ok (mpscq_count (q) == 0,
+        "mpscq_count returns 0");
+    ok (mpscq_pollevents (q) == POLLOUT,
+        "mpscq_pollevents returns POLLOUT");
+
+    ok (mpscq_push (q, strdup ("qux")) == 0,
+        "mpscq_push works after queue was drained");
+    pfd.revents = 0;
+    ok (poll (&pfd, 1, 0) == 1 && pfd.revents == POLLIN,
+        "pollfd is ready again");
+    s = mpscq_pop (q);
+    ok (s != NULL && !strcmp (s, "qux"),
+        "mpscq_pop returns item");
+    free (s);
+    mpscq_destroy (q);
+
+    errno = 0;
+    ok (mpscq_push (NULL, "x") < 0 && errno == EINVAL,
+        "mpscq_push q=NULL fails with EINVAL");
+    errno = 0;
+    ok (mpscq_pop (NULL) == NULL && errno == EINVAL,
+        "mpscq_pop q=NULL fails with EINVAL");
+    lives_ok ({mpscq_destroy (NULL);},
+        "mpscq_destroy q=NULL doesn't crash");
+}
+
+void test_destroy (void)
+{
+    struct mpscq *q;
+    int i;
+
+    if (!(q = mpscq_create (item_free)))
+        BAIL_OUT ("mpscq_create failed");
+    for (i = 0; i < 16; i++) {
+        if (mpscq_push (q, malloc (sizeof (struct item))) < 0)
+            BAIL_OUT ("mpscq_push failed");
+    }
+    free_count = 0;
+    mpscq_destroy (q);
+    ok (free_count == 16,
+        "mpscq_destroy freed all items with destructor");
+}
+
+void test_threads (void)
+{
+    struct producer p[NPRODUCERS];
+    int next[NPRODUCERS];
+    struct mpscq *q;
+    int total = NPRODUCERS * NITEMS;
+    int errors = 0;
+    int order_errors = 0;
+    int i, e;
+
+    if (!(q = mpscq_create (free)))
+        BAIL_OUT ("mpscq_create failed");
+    for (i = 0; i < NPRODUCERS; i++) {
+        p[i].id = i;
+        p[i].q = q;
+        p[i].errors = 0;
+        next[i] = 0;
+        if ((e = pthread_create (&p[i].t, NULL, producer_thread, &p[i])))
+            BAIL_OUT ("pthread_create: %s", strerror (e));
+    }
+    for (i = 0; i < total; i++) {
+        struct item *item;
+        if (!(item = mpscq_pop_wait (q))) {
+            errors++;
+            break;
+        }
+        if (item->producer < 0 || item->producer >= NPRODUCERS
+            || item->seq != next[item->producer]++)
+            order_errors++;
+        free (item);
+    }
+    for (i = 0; i < NPRODUCERS; i++) {
+        if ((e = pthread_join (p[i].t, NULL)))
+            BAIL_OUT ("pthread_join: %s", strerror (e));
+        errors += p[i].errors;
+    }
+    ok (errors == 0,
+        "%d producers pushed %d items and consumer popped them all",
+        NPRODUCERS, NITEMS);
+    ok (order_errors == 0,
+        "items from each producer were received in order");
+    ok (mpscq_count (q) == 0,
+        "mpscq_count returns 0");
+    errno = 0;
+    ok (mpscq_pop (q) == NULL && errno == EWOULDBLOCK,
+        "mpscq_pop fails with EWOULDBLOCK");
+    mpscq_destroy (q);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_destroy ();
+    test_threads ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,230 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/topic_trie.h"
+
+struct matches {
+    char buf[256];
+};
+
+static void append_cb (void *item, void *arg)
+{
+    struct matches *m = arg;
+    const char *name = item;
+
+    if (strlen (m->buf) > 0)
+        strcat (m->buf, ",");
+    strcat (m->buf, name);
+}
+
+static const char *match (struct topic_trie *tt, const char *topic)
+{
+    static struct matches m;
+
+    m.buf[0] = '\0';
+    topic_trie_match (tt, topic, append_cb, &m);
+    return m.buf;
+}
+
+void test_badargs (void)
+{
+    struct topic_trie *tt;
+
+    if (!(tt = topic_trie_create ()))
+        BAIL_OUT ("topic_trie_create failed");
+
+    errno = 0;
+    ok (topic_trie_insert (NULL, "a", "A") < 0 && errno == EINVAL,
+        "topic_trie_insert tt=NULL fails with EINVAL");
+    errno = 0;
+    ok (topic_trie_insert (tt, NULL, "A") < 0 && errno == EINVAL,
+        "topic_trie_insert prefix=NULL fails with EINVAL");
+    errno = 0;
+    ok (topic_trie_remove (NULL, "a", "A") < 0 && errno == EINVAL,
+        "topic_trie_remove tt=NULL fails with EINVAL");
+    errno = 0;
+    ok (topic_trie_remove (tt, NULL, "A") < 0 && errno == EINVAL,
+        "topic_trie_remove prefix=NULL fails with EINVAL");
+    errno = 0;
+    ok (topic_trie_remove (tt, "a", "A") < 0 && errno == ENOENT,
+        "topic_trie_remove of unknown item fails with ENOENT");
+    ok (topic_trie_match_any (NULL, "a") == false,
+        "topic_trie_match_any tt=NULL returns false");
+    ok (topic_trie_match_any (tt, NULL) == false,
+        "topic_trie_match_any topic=NULL returns false");
+    ok (topic_trie_count (NULL) == 0,
+        "topic_trie_count tt=NULL returns 0");
+    lives_ok ({topic_trie_match (NULL, "a", append_cb, NULL);},
+        "topic_trie_match tt=NULL doesn't crash");
+    lives_ok ({topic_trie_destroy (NULL);},
+        "topic_trie_destroy tt=NULL doesn't crash");
+
+    topic_trie_destroy (tt);
+}
+
+void test_basic (void)
+{
+    struct topic_trie *tt;
+
+    if (!(tt = topic_trie_create ()))
+        BAIL_OUT ("topic_trie_create failed");
+    ok (topic_trie_count (tt) == 0,
+        "topic_trie_count is 0 on new trie");
+    ok (topic_trie_match_any (tt, "foo") == false,
+        "empty trie matches nothing");
+    ok (!strcmp (match (tt, "foo"), ""),
+        "topic_trie_match on empty trie visits nothing");
+
+    ok (topic_trie_insert (tt, "job-state", "A") == 0
+        && topic_trie_insert (tt, "kvs.setroot", "B") == 0
+        && topic_trie_insert (tt, "job", "C") == 0
+        && topic_trie_insert (tt, "job-state", "D") == 0
+        && topic_trie_insert (tt, "heartbeat.pulse", "E") == 0,
+        "inserted 5 items");
+    ok (topic_trie_count (tt) == 5,
+        "topic_trie_count is 5");
+
+    ok (!strcmp (match (tt, "job-state.run"), "C,A,D"),
+        "job-state.run matches shortest prefix first, then insert order");
+    ok (!strcmp (match (tt, "job-state"), "C,A,D"),
+        "job-state matches exact and shorter prefixes");
+    ok (!strcmp (match (tt, "job-stat"), "C"),
+        "job-stat matches only the shorter prefix");
+    ok (!strcmp (match (tt, "jo"), ""),
+        "jo matches nothing");
+    ok (!strcmp (match (tt, "kvs.setroot-pri"), "B"),
+        "kvs.setroot-pri matches kvs.setroot");
+    ok (!strcmp (match (tt, "kvs.namespace-removed"), ""),
+        "kvs.namespace-removed matches nothing");
+    ok (!strcmp (match (tt, ""), ""),
+        "empty topic matches nothing");
+    ok (topic_trie_match_any (tt, "heartbeat.pulse") == true,
+        "topic_trie_match_any heartbeat.pulse returns true");
+    ok (topic_trie_match_any (tt, "heartbeat") == false,
+        "topic_trie_match_any heartbeat returns false");
+
+    ok (topic_trie_insert (tt, "", "F") == 0,
+        "inserted item with empty prefix");
+    ok (!strcmp (match (tt, "anything"), "F"),
+        "empty prefix matches any topic");
+    ok (!strcmp (match (tt, ""), "F"),
+        "empty prefix matches empty topic");
+    ok (!strcmp (match (tt, "job-state.run"), "F,C,A,D"),
+        "empty prefix matches first");
+
+    errno = 0;
+    ok (topic_trie_remove (tt, "job-state", "C") < 0 && errno == ENOENT,
+        "topic_trie_remove with wrong prefix fails with ENOENT");
+    errno = 0;
+    ok (topic_trie_remove (tt, "job-stat", "A") < 0 && errno == ENOENT,
+        "topic_trie_remove with partial prefix fails with ENOENT");
+    ok (topic_trie_remove (tt, "job-state", "A") == 0,
+        "removed A");
+    ok (!strcmp (match (tt, "job-state.run"), "F,C,D"),
+        "job-state.run no longer matches A");
+    ok (topic_trie_remove (tt, "job", "C") == 0,
+        "removed C");
+    ok (!strcmp (match (tt, "job-state.run"), "F,D"),
+        "job-state.run still matches D after parent prefix removed");
+    ok (topic_trie_remove (tt, "", "F") == 0,
+        "removed F");
+    ok (topic_trie_remove (tt, "job-state", "D") == 0,
+        "removed D");
+    ok (topic_trie_match_any (tt, "job-state.run") == false,
+        "job-state.run no longer matches");
+    ok (topic_trie_count (tt) == 2,
+        "topic_trie_count is 2");
+
+    topic_trie_destroy (tt);
+}
+
+void test_duplicates (void)
+{
+    struct topic_trie *tt;
+
+    if (!(tt = topic_trie_create ()))
+        BAIL_OUT ("topic_trie_create failed");
+    ok (topic_trie_insert (tt, "foo", "A") == 0
+        && topic_trie_insert (tt, "foo", "A") == 0
+        && topic_trie_insert (tt, "foo.bar", "A") == 0,
+        "inserted same item three times");
+    ok (!strcmp (match (tt, "foo.bar"), "A,A,A"),
+        "item is visited once per matching instance");
+    ok (topic_trie_remove (tt, "foo", "A") == 0,
+        "removed one instance");
+    ok (!strcmp (match (tt, "foo.bar"), "A,A"),
+        "remaining instances still match");
+    ok (topic_trie_remove (tt, "foo", "A") == 0
+        && topic_trie_remove (tt, "foo.bar", "A") == 0,
+        "removed remaining instances");
+    ok (topic_trie_count (tt) == 0,
+        "topic_trie_count is 0");
+    errno = 0;
+    ok (topic_trie_remove (tt, "foo", "A") < 0 && errno == ENOENT,
+        "removing again fails with ENOENT");
+
+    topic_trie_destroy (tt);
+}
+
+void test_many (void)
+{
+    struct topic_trie *tt;
+    char topic[64];
+    int i;
+    int errors = 0;
+
+    if (!(tt = topic_trie_create ()))
+        BAIL_OUT ("topic_trie_create failed");
+    for (i = 0; i < 1000; i++) {
+        snprintf (topic, sizeof (topic), "topic.%d", i);
+        if (topic_trie_insert (tt, topic, "X") < 0)
+            errors++;
+    }
+    ok (errors == 0 && topic_trie_count (tt) == 1000,
+        "inserted 1000 items");
+    ok (!strcmp (match (tt, "topic.999.foo"), "X,X,X"),
+        "topic.999.foo matches topic.9, topic.99, and topic.999");
+    ok (!strcmp (match (tt, "topic.10"), "X,X"),
+        "topic.10 matches topic.1 and topic.10");
+    errors = 0;
+    for (i = 0; i < 1000; i++) {
+        snprintf (topic, sizeof (topic), "topic.%d", i);
+        if (topic_trie_remove (tt, topic, "X") < 0)
+            errors++;
+    }
+    ok (errors == 0 && topic_trie_count (tt) == 0,
+        "removed 1000 items");
+    ok (topic_trie_match_any (tt, "topic.1") == false,
+        "topic.1 no longer matches");
+
+    topic_trie_destroy (tt);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_badargs ();
+    test_basic ();
+    test_duplicates ();
+    test_many ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
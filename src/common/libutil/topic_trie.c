@@ -0,0 +1,243 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* topic_trie.c - index items by topic string prefix
+ *
+ * One node per character of each stored prefix.  A node's children are
+ * kept on a singly linked sibling list, which is short in practice since
+ * topics share a small alphabet at each position.  Nodes with no items
+ * and no children are pruned on removal.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "topic_trie.h"
+
+struct trie_node {
+    unsigned char c;
+    struct trie_node *parent;
+    struct trie_node *children;
+    struct trie_node *next;
+    void **items;
+    int count;
+    int size;
+};
+
+struct topic_trie {
+    struct trie_node root;
+    int count;
+};
+
+static void node_destroy (struct trie_node *node)
+{
+    while (node->children) {
+        struct trie_node *child = node->children;
+        node->children = child->next;
+        node_destroy (child);
+        free (child);
+    }
+    free (node->items);
+}
+
+static struct trie_node *node_child (struct trie_node *node, unsigned char c)
+{
+    struct trie_node *child;
+
+    for (child = node->children; child != NULL; child = child->next) {
+        if (child->c == c)
+            return child;
+    }
+    return NULL;
+}
+
+static struct trie_node *node_child_create (struct trie_node *node,
+                                            unsigned char c)
+{
+    struct trie_node *child;
+
+    if (!(child = calloc (1, sizeof (*child))))
+        return NULL;
+    child->c = c;
+    child->parent = node;
+    child->next = node->children;
+    node->children = child;
+    return child;
+}
+
+static void node_unlink (struct trie_node *node)
+{
+    struct trie_node **np = &node->parent->children;
+
+    while (*np != node)
+        np = &(*np)->next;
+    *np = node->next;
+}
+
+static struct trie_node *node_lookup (struct topic_trie *tt,
+                                      const char *prefix)
+{
+    struct trie_node *node = &tt->root;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)prefix; *p != '\0'; p++) {
+        if (!(node = node_child (node, *p)))
+            return NULL;
+    }
+    return node;
+}
+
+int topic_trie_insert (struct topic_trie *tt, const char *prefix, void *item)
+{
+    struct trie_node *node;
+    struct trie_node *child;
+    const unsigned char *p;
+
+    if (!tt || !prefix) {
+        errno = EINVAL;
+        return -1;
+    }
+    node = &tt->root;
+    for (p = (const unsigned char *)prefix; *p != '\0'; p++) {
+        if (!(child = node_child (node, *p))
+            && !(child = node_child_create (node, *p)))
+            goto nomem;
+        node = child;
+    }
+    if (node->count == node->size) {
+        int size = node->size ? node->size * 2 : 2;
+        void **items;
+        if (!(items = realloc (node->items, size * sizeof (items[0]))))
+            goto nomem;
+        node->items = items;
+        node->size = size;
+    }
+    node->items[node->count++] = item;
+    tt->count++;
+    return 0;
+nomem:
+    /* Prune any empty nodes created above.
+     */
+    while (node != &tt->root && node->count == 0 && !node->children) {
+        struct trie_node *parent = node->parent;
+        node_unlink (node);
+        free (node->items);
+        free (node);
+        node = parent;
+    }
+    errno = ENOMEM;
+    return -1;
+}
+
+int topic_trie_remove (struct topic_trie *tt, const char *prefix, void *item)
+{
+    struct trie_node *node;
+    int i;
+
+    if (!tt || !prefix) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(node = node_lookup (tt, prefix)))
+        goto noent;
+    for (i = 0; i < node->count; i++) {
+        if (node->items[i] == item)
+            break;
+    }
+    if (i == node->count)
+        goto noent;
+    memmove (&node->items[i],
+             &node->items[i + 1],
+             (node->count - i - 1) * sizeof (node->items[0]));
+    node->count--;
+    tt->count--;
+    while (node != &tt->root && node->count == 0 && !node->children) {
+        struct trie_node *parent = node->parent;
+        node_unlink (node);
+        free (node->items);
+        free (node);
+        node = parent;
+    }
+    return 0;
+noent:
+    errno = ENOENT;
+    return -1;
+}
+
+void topic_trie_match (struct topic_trie *tt,
+                       const char *topic,
+                       topic_trie_f cb,
+                       void *arg)
+{
+    struct trie_node *node;
+    const unsigned char *p;
+    int i;
+
+    if (!tt || !topic || !cb)
+        return;
+    node = &tt->root;
+    p = (const unsigned char *)topic;
+    for (;;) {
+        for (i = 0; i < node->count; i++)
+            cb (node->items[i], arg);
+        if (*p == '\0' || !(node = node_child (node, *p++)))
+            break;
+    }
+}
+
+bool topic_trie_match_any (struct topic_trie *tt, const char *topic)
+{
+    struct trie_node *node;
+    const unsigned char *p;
+
+    if (!tt || !topic)
+        return false;
+    node = &tt->root;
+    p = (const unsigned char *)topic;
+    for (;;) {
+        if (node->count > 0)
+            return true;
+        if (*p == '\0' || !(node = node_child (node, *p++)))
+            break;
+    }
+    return false;
+}
+
+int topic_trie_count (struct topic_trie *tt)
+{
+    return tt ? tt->count : 0;
+}
+
+void topic_trie_destroy (struct topic_trie *tt)
+{
+    if (tt) {
+        int saved_errno = errno;
+        node_destroy (&tt->root);
+        free (tt);
+        errno = saved_errno;
+    }
+}
+
+struct topic_trie *topic_trie_create (void)
+{
+    struct topic_trie *tt;
+
+    if (!(tt = calloc (1, sizeof (*tt))))
+        return NULL;
+    return tt;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
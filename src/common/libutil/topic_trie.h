@@ -0,0 +1,65 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/*
+ *  topic_trie - index items by topic string prefix
+ *
+ *  Items are stored under a prefix string.  Given a message topic, the
+ *  trie finds all items whose prefix is a prefix of the topic in time
+ *  proportional to the topic length, rather than the number of items.
+ *  This is the event subscription matching rule, where "" matches all
+ *  topics, and "foo" matches "foo", "foo.bar", and "foobar".
+ */
+
+#ifndef _UTIL_TOPIC_TRIE_H
+#define _UTIL_TOPIC_TRIE_H
+
+#include <stdbool.h>
+
+struct topic_trie;
+
+typedef void (*topic_trie_f)(void *item, void *arg);
+
+struct topic_trie *topic_trie_create (void);
+void topic_trie_destroy (struct topic_trie *tt);
+
+/* Store 'item' under 'prefix'.  The same item may be stored more
+ * than once, under the same or different prefixes.
+ */
+int topic_trie_insert (struct topic_trie *tt, const char *prefix, void *item);
+
+/* Remove one instance of 'item' stored under 'prefix'.
+ * Fail with ENOENT if not found.
+ */
+int topic_trie_remove (struct topic_trie *tt, const char *prefix, void *item);
+
+/* Call 'cb' for each item whose prefix matches 'topic'.  Items are
+ * visited shortest prefix first, then in insertion order.  An item
+ * stored more than once is visited once per matching instance.
+ * The trie must not be modified from 'cb'.
+ */
+void topic_trie_match (struct topic_trie *tt,
+                       const char *topic,
+                       topic_trie_f cb,
+                       void *arg);
+
+/* Return true if any item's prefix matches 'topic'.
+ */
+bool topic_trie_match_any (struct topic_trie *tt, const char *topic);
+
+/* Return the number of items stored.
+ */
+int topic_trie_count (struct topic_trie *tt);
+
+#endif /* !_UTIL_TOPIC_TRIE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
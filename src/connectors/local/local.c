@@ -26,6 +26,7 @@
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/errno_safe.h"
 #include "src/common/librouter/usock.h"
+#include "src/common/librouter/shmring.h"
 
 struct local_connector {
     struct usock_client *uclient;
@@ -198,6 +199,39 @@ static int override_retry_count (struct usock_retry_params *retry)
     return 0;
 }
 
+/* If FLUX_LOCAL_CONNECTOR_SHM is set to a nonzero value, exchange messages
+ * with the server through shared memory rings.  The value is the ring size
+ * in bytes, or 1 for the default size.  If the server declines (e.g. it
+ * does not support rings), the socket is used.
+ */
+static int attach_ring (struct local_connector *ctx)
+{
+    const char *s;
+    char *endptr;
+    unsigned long size;
+
+    if (!(s = getenv ("FLUX_LOCAL_CONNECTOR_SHM")))
+        return 0;
+    errno = 0;
+    size = strtoul (s, &endptr, 10);
+    if (errno != 0 || *endptr != '\0') {
+        errno = EINVAL;
+        return -1;
+    }
+    if (size == 0)
+        return 0;
+    if (size == 1)
+        size = SHMRING_SIZE_DEFAULT;
+    if (size < SHMRING_SIZE_MIN
+        || size > SHMRING_SIZE_MAX
+        || (size & (size - 1)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    (void)usock_client_attach_ring (ctx->uclient, size);
+    return 0;
+}
+
 /* Path is interpreted as the directory containing the unix domain socket.
  */
 flux_t *connector_init (const char *path, int flags)
@@ -220,6 +254,8 @@ flux_t *connector_init (const char *path, int flags)
         goto error;
     if (!(ctx->uclient = usock_client_create (ctx->fd)))
         goto error;
+    if (attach_ring (ctx) < 0)
+        goto error;
     if (!(ctx->h = flux_handle_create (ctx, &handle_ops, flags)))
         goto error;
     return ctx->h;
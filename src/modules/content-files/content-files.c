@@ -10,10 +10,19 @@
 
 /* content-files.c - content addressable storage with files back end
  *
- * This is mainly for demo/experimentation purposes.
- * The "store" is a flat directory with blobrefs as filenames.
+ * By default, the "store" is a flat directory with blobrefs as filenames.
  * As such, it is hungry for inodes and may run the file system out of them
- * if used in anger!
+ * if used in anger!  This is mainly for demo/experimentation purposes.
+ *
+ * With the "pack" module option, blobs and checkpoints are instead appended
+ * to a small number of large segment files, with a hash index from key to
+ * record that is kept in memory and persisted periodically (see packdb.h).
+ * Reads are served directly from mmapped segments.  A timer periodically
+ * compacts segments that are mostly dead and syncs the index.
+ * Options:
+ *   pack                  use the packed storage engine
+ *   segment-size=N        start a new segment after N bytes (default 64M)
+ *   compact-period=N      compact and sync every N seconds (default 60)
  *
  * There are four main operations (RPC handlers):
  *
@@ -23,6 +32,10 @@
  * content-backing.store:
  * Given a blob, store it and return its blobref
  *
+ * content-backing.load-batch, content-backing.store-batch:
+ * Batch versions of the above, which carry many blobrefs or blobs per
+ * message, encoded as a blobvec.
+ *
  * kvs-checkpoint.get:
  * Given a string key, lookup string value and return it or a "not found" error.
  *
@@ -54,19 +67,77 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 #include "src/common/libutil/log.h"
 
 #include "src/common/libcontent/content-util.h"
 
 #include "filedb.h"
+#include "packdb.h"
+
+static const size_t default_segment_size = 64*1024*1024;
+static const double default_compact_period = 60.;
+static const double compact_threshold = 0.5;
 
 struct content_files {
     flux_msg_handler_t **handlers;
     char *dbpath;
     flux_t *h;
     const char *hashfun;
+    bool testing;
+    bool pack;
+    size_t segment_size;
+    double compact_period;
+    struct packdb *packdb;
+    flux_watcher_t *compact_w;
 };
 
+/* Look up 'key' in whichever store is in use.  On success, 'datap' and
+ * 'sizep' are assigned the value.  If a buffer had to be allocated for it,
+ * it is assigned to 'bufp' and the caller must free it.
+ */
+static int db_get (struct content_files *ctx,
+                   const char *key,
+                   const void **datap,
+                   size_t *sizep,
+                   void **bufp,
+                   const char **errstr)
+{
+    *bufp = NULL;
+    if (ctx->packdb)
+        return packdb_get (ctx->packdb, key, datap, sizep, errstr);
+    if (filedb_get (ctx->dbpath, key, bufp, sizep, errstr) < 0)
+        return -1;
+    *datap = *bufp;
+    return 0;
+}
+
+static int db_put (struct content_files *ctx,
+                   const char *key,
+                   const void *data,
+                   size_t size,
+                   const char **errstr)
+{
+    if (ctx->packdb)
+        return packdb_put (ctx->packdb, key, data, size, errstr);
+    return filedb_put (ctx->dbpath, key, data, size, errstr);
+}
+
+/* Store a blob under its blobref.  Since content is immutable, the packed
+ * store skips blobs it already has rather than appending dead duplicates.
+ */
+static int blob_put (struct content_files *ctx,
+                     const char *blobref,
+                     const void *data,
+                     size_t size,
+                     const char **errstr)
+{
+    if (ctx->packdb
+        && packdb_get (ctx->packdb, blobref, NULL, NULL, NULL) == 0)
+        return 0;
+    return db_put (ctx, blobref, data, size, errstr);
+}
+
 /* Handle a content-backing.load request from the rank 0 broker's
  * content-cache service.  The raw request payload is a blobref string,
  * including NULL terminator.  The raw response payload is the blob content.
@@ -80,7 +151,8 @@ static void load_cb (flux_t *h,
     struct content_files *ctx = arg;
     const char *blobref;
     int blobref_size;
-    void *data = NULL;
+    const void *data;
+    void *buf = NULL;
     size_t size;
     const char *errstr = NULL;
 
@@ -95,16 +167,16 @@ static void load_cb (flux_t *h,
         errstr = "invalid blobref";
         goto error;
     }
-    if (filedb_get (ctx->dbpath, blobref, &data, &size, &errstr) < 0)
+    if (db_get (ctx, blobref, &data, &size, &buf, &errstr) < 0)
         goto error;
     if (flux_respond_raw (h, msg, data, size) < 0)
         flux_log_error (h, "error responding to load request");
-    free (data);
+    free (buf);
     return;
 error:
     if (flux_respond_error (h, msg, errno, errstr) < 0)
         flux_log_error (h, "error responding to load request");
-    free (data);
+    free (buf);
 }
 
 /* Handle a content-backing.store request from the rank 0 broker's
@@ -131,7 +203,7 @@ void store_cb (flux_t *h,
                       blobref,
                       sizeof (blobref)) < 0)
         goto error;
-    if (filedb_put (ctx->dbpath, blobref, data, size, &errstr) < 0)
+    if (blob_put (ctx, blobref, data, size, &errstr) < 0)
         goto error;
     if (flux_respond_raw (h, msg, blobref, strlen (blobref) + 1) < 0)
         flux_log_error (h, "error responding to store request");
@@ -141,12 +213,131 @@ error:
         flux_log_error (h, "error responding to store request");
 }
 
+/* Handle a content-backing.load-batch request from the rank 0 broker's
+ * content-cache service.  The raw request payload is a blobvec of blobref
+ * strings, including NULL terminators.  The raw response payload is a
+ * blobvec with one element per blobref, either the blob content or an
+ * error element.
+ */
+static void load_batch_cb (flux_t *h,
+                           flux_msg_handler_t *mh,
+                           const flux_msg_t *msg,
+                           void *arg)
+{
+    struct content_files *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const char *blobref;
+    int blobref_size;
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    while ((rc = blobvec_next (buf,
+                               len,
+                               &cursor,
+                               (const void **)&blobref,
+                               &blobref_size)) == 1) {
+        const void *data;
+        void *dbuf;
+        size_t size;
+        const char *errstr;
+
+        if (blobref_size <= 0 || blobref[blobref_size - 1] != '\0') {
+            errno = EPROTO;
+            goto error;
+        }
+        if (blobref_validate (blobref) < 0)
+            rc = blobvec_append_error (bv, EINVAL);
+        else if (db_get (ctx, blobref, &data, &size, &dbuf, &errstr) < 0)
+            rc = blobvec_append_error (bv, errno);
+        else {
+            rc = blobvec_append (bv, data, size);
+            free (dbuf);
+        }
+        if (rc < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "error responding to load-batch request");
+    blobvec_destroy (bv);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "error responding to load-batch request");
+    blobvec_destroy (bv);
+}
+
+/* Handle a content-backing.store-batch request from the rank 0 broker's
+ * content-cache service.  The raw request payload is a blobvec of blobs.
+ * The raw response payload is a blobvec of blobref strings, including NULL
+ * terminators, in the same order.  Any failure fails the entire request.
+ */
+static void store_batch_cb (flux_t *h,
+                            flux_msg_handler_t *mh,
+                            const flux_msg_t *msg,
+                            void *arg)
+{
+    struct content_files *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const void *data;
+    int size;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    const char *errstr = NULL;
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    while ((rc = blobvec_next (buf, len, &cursor, &data, &size)) == 1) {
+        if (size < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if (blobref_hash (ctx->hashfun,
+                          (uint8_t *)data,
+                          size,
+                          blobref,
+                          sizeof (blobref)) < 0)
+            goto error;
+        if (blob_put (ctx, blobref, data, size, &errstr) < 0)
+            goto error;
+        if (blobvec_append (bv, blobref, strlen (blobref) + 1) < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "error responding to store-batch request");
+    blobvec_destroy (bv);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, errstr) < 0)
+        flux_log_error (h, "error responding to store-batch request");
+    blobvec_destroy (bv);
+}
+
 /* Handle a kvs-checkpoint.get request from the rank 0 kvs module.
  * The KVS stores its last root reference here for restart purposes.
  *
- * N.B. filedb_get() calls read_all() which ensures that the returned buffer
- * is padded with an extra NULL not included in the returned length,
- * so it is safe to use the result as a string argument in flux_respond_pack().
+ * N.B. the value is not necessarily NULL terminated when read from the
+ * packed store, so its length is passed explicitly.
  */
 void checkpoint_get_cb (flux_t *h,
                         flux_msg_handler_t *mh,
@@ -155,26 +346,28 @@ void checkpoint_get_cb (flux_t *h,
 {
     struct content_files *ctx = arg;
     const char *key;
-    void *data = NULL;
+    const void *data;
+    void *buf = NULL;
     size_t size;
     const char *errstr = NULL;
 
     if (flux_request_unpack (msg, NULL, "{s:s}", "key", &key) < 0)
         goto error;
-    if (filedb_get (ctx->dbpath, key, &data, &size, &errstr) < 0)
+    if (db_get (ctx, key, &data, &size, &buf, &errstr) < 0)
         goto error;
     if (flux_respond_pack (h,
                            msg,
-                           "{s:s}",
+                           "{s:s#}",
                            "value",
-                           size > 0 ? data : "", 0) < 0)
+                           size > 0 ? data : "",
+                           size) < 0)
         flux_log_error (h, "error responding to kvs-checkpoint.get request");
-    free (data);
+    free (buf);
     return;
 error:
     if (flux_respond_error (h, msg, errno, errstr) < 0)
         flux_log_error (h, "error responding to kvs-checkpoint.get request");
-    free (data);
+    free (buf);
 }
 
 /* Handle a kvs-checkpoint.put request from the rank 0 kvs module.
@@ -198,7 +391,7 @@ void checkpoint_put_cb (flux_t *h,
                              "value",
                              &value) < 0)
         goto error;
-    if (filedb_put (ctx->dbpath, key, value, strlen (value), &errstr) < 0)
+    if (db_put (ctx, key, value, strlen (value), &errstr) < 0)
         goto error;
     if (flux_respond (h, msg, NULL) < 0)
         flux_log_error (h, "error responding to kvs-checkpoint.put request");
@@ -208,6 +401,25 @@ error:
         flux_log_error (h, "error responding to kvs-checkpoint.put request");
 }
 
+/* Periodically reclaim mostly-dead segments and persist the index of the
+ * packed store, so a restart need only scan recently appended records.
+ */
+static void compact_cb (flux_reactor_t *r,
+                        flux_watcher_t *w,
+                        int revents,
+                        void *arg)
+{
+    struct content_files *ctx = arg;
+    int count;
+
+    if ((count = packdb_compact (ctx->packdb, compact_threshold)) < 0)
+        flux_log_error (ctx->h, "error compacting packed store");
+    else if (count > 0)
+        flux_log (ctx->h, LOG_DEBUG, "compacted %d segments", count);
+    if (packdb_sync (ctx->packdb) < 0)
+        flux_log_error (ctx->h, "error syncing packed store");
+}
+
 /* Destroy module context.
  */
 static void content_files_destroy (struct content_files *ctx)
@@ -215,6 +427,8 @@ static void content_files_destroy (struct content_files *ctx)
     if (ctx) {
         int saved_errno = errno;
         flux_msg_handler_delvec (ctx->handlers);
+        flux_watcher_destroy (ctx->compact_w);
+        packdb_close (ctx->packdb);
         free (ctx->dbpath);
         free (ctx);
         errno = saved_errno;
@@ -227,14 +441,53 @@ static void content_files_destroy (struct content_files *ctx)
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.load-batch", load_batch_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.store-batch", store_batch_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.get", checkpoint_get_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.put", checkpoint_put_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
+static int parse_args (struct content_files *ctx, int argc, char **argv)
+{
+    int i;
+    for (i = 0; i < argc; i++) {
+        if (!strcmp (argv[i], "testing"))
+            ctx->testing = true;
+        else if (!strcmp (argv[i], "pack"))
+            ctx->pack = true;
+        else if (!strncmp (argv[i], "segment-size=", 13)) {
+            char *endptr;
+            unsigned long long val;
+            errno = 0;
+            val = strtoull (argv[i] + 13, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || val == 0
+                                              || val > UINT32_MAX)
+                goto inval;
+            ctx->segment_size = val;
+        }
+        else if (!strncmp (argv[i], "compact-period=", 15)) {
+            char *endptr;
+            errno = 0;
+            ctx->compact_period = strtod (argv[i] + 15, &endptr);
+            if (errno != 0 || *endptr != '\0' || ctx->compact_period <= 0)
+                goto inval;
+        }
+        else
+            goto inval;
+    }
+    return 0;
+inval:
+    errno = EINVAL;
+    flux_log_error (ctx->h, "%s", argv[i]);
+    return -1;
+}
+
 /* Create module context and perform some initialization.
  */
-static struct content_files *content_files_create (flux_t *h)
+static struct content_files *content_files_create (flux_t *h,
+                                                   int argc,
+                                                   char **argv)
 {
     struct content_files *ctx;
     const char *backing_path;
@@ -242,6 +495,10 @@ static struct content_files *content_files_create (flux_t *h)
     if (!(ctx = calloc (1, sizeof (*ctx))))
         return NULL;
     ctx->h = h;
+    ctx->segment_size = default_segment_size;
+    ctx->compact_period = default_compact_period;
+    if (parse_args (ctx, argc, argv) < 0)
+        goto error;
 
     /* Some tunables:
      * - the hash function, e.g. sha1, sha256
@@ -280,6 +537,26 @@ static struct content_files *content_files_create (flux_t *h)
         if (mkdir (ctx->dbpath, 0700) < 0)
             goto error;
     }
+    if (ctx->pack) {
+        const char *errstr = NULL;
+
+        if (!(ctx->packdb = packdb_open (ctx->dbpath,
+                                         ctx->segment_size,
+                                         &errstr))) {
+            flux_log_error (h,
+                            "%s: %s",
+                            ctx->dbpath,
+                            errstr ? errstr : "error opening packed store");
+            goto error;
+        }
+        if (!(ctx->compact_w = flux_timer_watcher_create (flux_get_reactor (h),
+                                                          ctx->compact_period,
+                                                          ctx->compact_period,
+                                                          compact_cb,
+                                                          ctx)))
+            goto error;
+        flux_watcher_start (ctx->compact_w);
+    }
     if (flux_msg_handler_addvec (h, htab, ctx, &ctx->handlers) < 0)
         goto error;
     return ctx;
@@ -288,21 +565,6 @@ error:
     return NULL;
 }
 
-static int parse_args (flux_t *h, int argc, char **argv, bool *testing)
-{
-    int i;
-    for (i = 0; i < argc; i++) {
-        if (!strcmp (argv[i], "testing"))
-            *testing = true;
-        else {
-            errno = EINVAL;
-            flux_log_error (h, "%s", argv[i]);
-            return -1;
-        }
-    }
-    return 0;
-}
-
 /* The module thread enters here with broker handle 'h' pre-connected.
  * The pattern used by most flux modules is to perform some initialization
  * including installing message handlers, then enter the flux reactor loop.
@@ -318,16 +580,13 @@ static int parse_args (flux_t *h, int argc, char **argv, bool *testing)
 int mod_main (flux_t *h, int argc, char **argv)
 {
     struct content_files *ctx;
-    bool testing = false;
     int rc = -1;
 
-    if (parse_args (h, argc, argv, &testing) < 0)
-        return -1;
-    if (!(ctx = content_files_create (h))) {
+    if (!(ctx = content_files_create (h, argc, argv))) {
         flux_log_error (h, "content_files_create failed");
         return -1;
     }
-    if (!testing) {
+    if (!ctx->testing) {
         if (content_register_backing_store (h, "content-files") < 0)
             goto done;
     }
@@ -339,7 +598,7 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log_error (h, "flux_reactor_run");
         goto done;
     }
-    if (!testing) {
+    if (!ctx->testing) {
         if (content_unregister_backing_store (h) < 0)
             goto done;
     }
@@ -0,0 +1,884 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* packdb.c - log-structured key-value store
+ *
+ * Segment record format (integers in network byte order):
+ *
+ *   magic (4) | keylen (4) | datalen (4) | checksum (4) | key | data
+ *
+ * The checksum is FNV-1a over key and data, and is only checked when
+ * scanning a segment to rebuild the index.
+ *
+ * Index file format (integers in network byte order):
+ *
+ *   magic (4) | version (4) | count (4) | tail_id (4) | tail_size (4)
+ *   count * { keylen (4) | segment id (4) | offset (4) | datalen (4) | key }
+ *   checksum (4)
+ *
+ * tail_id and tail_size record how much of the log the index covers.
+ * On open, records beyond that point are found by scanning.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <arpa/inet.h>
+#include <czmq.h>
+
+#include "src/common/libutil/errno_safe.h"
+
+#include "packdb.h"
+
+#define RECORD_MAGIC    0x706b6462  /* "pkdb" */
+#define INDEX_MAGIC     0x706b6978  /* "pkix" */
+#define INDEX_VERSION   1
+#define KEY_MAX         1024
+
+struct record_header {
+    uint32_t magic;
+    uint32_t keylen;
+    uint32_t datalen;
+    uint32_t checksum;
+};
+
+struct segment {
+    uint32_t id;
+    int fd;
+    void *map;
+    size_t maplen;
+    size_t size;        /* bytes of valid records */
+    size_t live;        /* bytes belonging to records in the index */
+    bool compacting;
+};
+
+struct entry {
+    uint32_t seg;
+    uint32_t offset;    /* offset of record header in segment */
+    uint32_t datalen;
+};
+
+struct packdb {
+    char *dbpath;
+    size_t segment_size;
+    zhashx_t *index;            /* key => struct entry */
+    struct segment **segs;      /* sorted by id, last is current */
+    int nsegs;
+    int segs_alloc;
+    bool dirty;                 /* index changed since last sync */
+};
+
+static uint32_t fnv1a (uint32_t hash, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+static const uint32_t fnv1a_init = 2166136261;
+
+static size_t record_size (size_t keylen, size_t datalen)
+{
+    return sizeof (struct record_header) + keylen + datalen;
+}
+
+static int pwrite_all (int fd, const void *buf, size_t len, off_t offset)
+{
+    const char *p = buf;
+
+    while (len > 0) {
+        ssize_t n = pwrite (fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int validate_key (const char *key, const char **errstr)
+{
+    size_t len;
+
+    if (!key || (len = strlen (key)) == 0) {
+        errno = EINVAL;
+        if (errstr)
+            *errstr = "invalid key";
+        return -1;
+    }
+    if (len > KEY_MAX) {
+        errno = EOVERFLOW;
+        if (errstr)
+            *errstr = "key name too long";
+        return -1;
+    }
+    return 0;
+}
+
+/* Segments
+ */
+
+static void segment_destroy (struct segment *seg)
+{
+    if (seg) {
+        int saved_errno = errno;
+        if (seg->map != MAP_FAILED && seg->map != NULL)
+            (void)munmap (seg->map, seg->maplen);
+        if (seg->fd >= 0)
+            (void)close (seg->fd);
+        free (seg);
+        errno = saved_errno;
+    }
+}
+
+/* (Re-)map 'seg' with at least 'len' bytes of address space.
+ * Mapping beyond EOF is allowed, and appended records become visible
+ * through the shared mapping without remapping.  A segment that holds
+ * records is never remapped, since packdb_get() hands out pointers into
+ * the mapping.
+ */
+static int segment_map (struct segment *seg, size_t len)
+{
+    void *map;
+
+    if (len < seg->size)
+        len = seg->size;
+    if (seg->map && len <= seg->maplen)
+        return 0;
+    if (seg->map && seg->size > 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (len == 0)
+        len = 1;
+    if ((map = mmap (NULL, len, PROT_READ, MAP_SHARED, seg->fd, 0))
+                                                            == MAP_FAILED)
+        return -1;
+    if (seg->map)
+        (void)munmap (seg->map, seg->maplen);
+    seg->map = map;
+    seg->maplen = len;
+    return 0;
+}
+
+static void segment_path (struct packdb *db,
+                          uint32_t id,
+                          char *buf,
+                          size_t bufsz)
+{
+    snprintf (buf, bufsz, "%s/pack.%08x", db->dbpath, (unsigned int)id);
+}
+
+static struct segment *segment_open (struct packdb *db,
+                                     uint32_t id,
+                                     bool create)
+{
+    char path[1024];
+    struct segment *seg;
+    struct stat sb;
+    int flags = O_RDWR;
+
+    if (create)
+        flags |= O_CREAT | O_EXCL;
+    if (!(seg = calloc (1, sizeof (*seg))))
+        return NULL;
+    seg->id = id;
+    segment_path (db, id, path, sizeof (path));
+    if ((seg->fd = open (path, flags, 0600)) < 0)
+        goto error;
+    if (fstat (seg->fd, &sb) < 0)
+        goto error;
+    seg->size = sb.st_size;
+    if (segment_map (seg, db->segment_size) < 0)
+        goto error;
+    return seg;
+error:
+    segment_destroy (seg);
+    return NULL;
+}
+
+static struct segment *segment_find (struct packdb *db, uint32_t id)
+{
+    int lo = 0;
+    int hi = db->nsegs - 1;
+
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (db->segs[mid]->id == id)
+            return db->segs[mid];
+        if (db->segs[mid]->id < id)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return NULL;
+}
+
+static struct segment *segment_current (struct packdb *db)
+{
+    return db->nsegs > 0 ? db->segs[db->nsegs - 1] : NULL;
+}
+
+/* Add 'seg' to the segment array, which must remain sorted by id.
+ */
+static int segment_push (struct packdb *db, struct segment *seg)
+{
+    int i;
+
+    if (db->nsegs == db->segs_alloc) {
+        int alloc = db->segs_alloc > 0 ? db->segs_alloc * 2 : 16;
+        struct segment **segs;
+        if (!(segs = realloc (db->segs, alloc * sizeof (segs[0]))))
+            return -1;
+        db->segs = segs;
+        db->segs_alloc = alloc;
+    }
+    i = db->nsegs;
+    while (i > 0 && db->segs[i - 1]->id > seg->id) {
+        db->segs[i] = db->segs[i - 1];
+        i--;
+    }
+    db->segs[i] = seg;
+    db->nsegs++;
+    return 0;
+}
+
+static void segment_remove (struct packdb *db, struct segment *seg)
+{
+    char path[1024];
+    int i;
+
+    for (i = 0; i < db->nsegs; i++) {
+        if (db->segs[i] == seg)
+            break;
+    }
+    if (i == db->nsegs)
+        return;
+    memmove (&db->segs[i],
+             &db->segs[i + 1],
+             (db->nsegs - i - 1) * sizeof (db->segs[0]));
+    db->nsegs--;
+    segment_path (db, seg->id, path, sizeof (path));
+    (void)unlink (path);
+    segment_destroy (seg);
+}
+
+/* Start a new current segment.
+ */
+static struct segment *segment_new (struct packdb *db)
+{
+    struct segment *cur = segment_current (db);
+    struct segment *seg;
+
+    if (!(seg = segment_open (db, cur ? cur->id + 1 : 0, true)))
+        return NULL;
+    if (segment_push (db, seg) < 0) {
+        ERRNO_SAFE_WRAP (segment_destroy, seg);
+        return NULL;
+    }
+    return seg;
+}
+
+/* Return the segment that a record of 'size' bytes should be appended to,
+ * starting a new one if the current one would exceed the segment size or
+ * its mapping.  Only an empty segment is remapped to fit a large record.
+ */
+static struct segment *segment_for_append (struct packdb *db, size_t size)
+{
+    struct segment *seg = segment_current (db);
+
+    if (!seg || (seg->size > 0 && (seg->size + size > db->segment_size
+                                   || seg->size + size > seg->maplen))) {
+        if (!(seg = segment_new (db)))
+            return NULL;
+    }
+    if (segment_map (seg, seg->size + size) < 0)
+        return NULL;
+    return seg;
+}
+
+/* Index
+ */
+
+static void entry_destructor (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+/* Point 'key' at the record at 'offset' in 'seg', updating live byte
+ * counts of the old and new segments.
+ */
+static int index_update (struct packdb *db,
+                         const char *key,
+                         struct segment *seg,
+                         uint32_t offset,
+                         uint32_t datalen)
+{
+    size_t keylen = strlen (key);
+    struct entry *e;
+
+    if ((e = zhashx_lookup (db->index, key))) {
+        struct segment *old = segment_find (db, e->seg);
+        if (old)
+            old->live -= record_size (keylen, e->datalen);
+    }
+    else {
+        if (!(e = calloc (1, sizeof (*e))))
+            return -1;
+        if (zhashx_insert (db->index, key, e) < 0) {
+            free (e);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    e->seg = seg->id;
+    e->offset = offset;
+    e->datalen = datalen;
+    seg->live += record_size (keylen, datalen);
+    db->dirty = true;
+    return 0;
+}
+
+static void index_clear (struct packdb *db)
+{
+    int i;
+
+    zhashx_purge (db->index);
+    for (i = 0; i < db->nsegs; i++)
+        db->segs[i]->live = 0;
+}
+
+/* Append a record for 'key' to the current segment and update the index.
+ */
+static int append_record (struct packdb *db,
+                          const char *key,
+                          const void *data,
+                          size_t size)
+{
+    size_t keylen = strlen (key);
+    char buf[sizeof (struct record_header) + KEY_MAX];
+    struct record_header hdr;
+    struct segment *seg;
+    uint32_t offset;
+
+    if (size > UINT32_MAX - record_size (keylen, 0)) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (!(seg = segment_for_append (db, record_size (keylen, size))))
+        return -1;
+    if (seg->size > UINT32_MAX - record_size (keylen, size)) {
+        errno = EFBIG;
+        return -1;
+    }
+    offset = seg->size;
+    hdr.magic = htonl (RECORD_MAGIC);
+    hdr.keylen = htonl (keylen);
+    hdr.datalen = htonl (size);
+    hdr.checksum = htonl (fnv1a (fnv1a (fnv1a_init, key, keylen), data, size));
+    memcpy (buf, &hdr, sizeof (hdr));
+    memcpy (buf + sizeof (hdr), key, keylen);
+    if (pwrite_all (seg->fd, buf, sizeof (hdr) + keylen, offset) < 0
+        || pwrite_all (seg->fd,
+                       data,
+                       size,
+                       offset + sizeof (hdr) + keylen) < 0) {
+        /* don't leave a torn record behind for the next append */
+        ERRNO_SAFE_WRAP (ftruncate, seg->fd, offset);
+        return -1;
+    }
+    seg->size += record_size (keylen, size);
+    return index_update (db, key, seg, offset, size);
+}
+
+/* Scan records in 'seg' starting at 'offset', adding them to the index.
+ * Anything after the last valid record is truncated.
+ */
+static int segment_scan (struct packdb *db, struct segment *seg, size_t offset)
+{
+    const char *map = seg->map;
+    char key[KEY_MAX + 1];
+
+    while (offset + sizeof (struct record_header) <= seg->size) {
+        struct record_header hdr;
+        uint32_t keylen, datalen;
+        const char *p = map + offset + sizeof (hdr);
+
+        memcpy (&hdr, map + offset, sizeof (hdr));
+        if (ntohl (hdr.magic) != RECORD_MAGIC)
+            break;
+        keylen = ntohl (hdr.keylen);
+        datalen = ntohl (hdr.datalen);
+        if (keylen == 0 || keylen > KEY_MAX)
+            break;
+        if (record_size (keylen, datalen) > seg->size - offset)
+            break;
+        if (memchr (p, '\0', keylen))
+            break;
+        if (fnv1a (fnv1a (fnv1a_init, p, keylen), p + keylen, datalen)
+                                                    != ntohl (hdr.checksum))
+            break;
+        memcpy (key, p, keylen);
+        key[keylen] = '\0';
+        if (index_update (db, key, seg, offset, datalen) < 0)
+            return -1;
+        offset += record_size (keylen, datalen);
+    }
+    if (offset < seg->size) {
+        if (ftruncate (seg->fd, offset) < 0)
+            return -1;
+        seg->size = offset;
+    }
+    return 0;
+}
+
+static int read_u32 (const char **p, const char *end, uint32_t *val)
+{
+    uint32_t n;
+
+    if (end - *p < sizeof (n))
+        return -1;
+    memcpy (&n, *p, sizeof (n));
+    *val = ntohl (n);
+    *p += sizeof (n);
+    return 0;
+}
+
+/* Load the index file, if any.  If it is missing or invalid, return -1
+ * and leave the index empty.
+ */
+static int index_load (struct packdb *db, uint32_t *tail_id, size_t *tail_size)
+{
+    char path[1024];
+    int fd;
+    struct stat sb;
+    char *buf = MAP_FAILED;
+    const char *p, *end;
+    uint32_t magic, version, count, id, size, checksum;
+    uint32_t i;
+    char key[KEY_MAX + 1];
+
+    snprintf (path, sizeof (path), "%s/pack.index", db->dbpath);
+    if ((fd = open (path, O_RDONLY)) < 0)
+        return -1;
+    if (fstat (fd, &sb) < 0 || sb.st_size < sizeof (uint32_t))
+        goto error;
+    if ((buf = mmap (NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+                                                            == MAP_FAILED)
+        goto error;
+    p = buf;
+    end = buf + sb.st_size - sizeof (uint32_t);
+    memcpy (&checksum, end, sizeof (checksum));
+    if (fnv1a (fnv1a_init, buf, end - buf) != ntohl (checksum))
+        goto error;
+    if (read_u32 (&p, end, &magic) < 0
+        || magic != INDEX_MAGIC
+        || read_u32 (&p, end, &version) < 0
+        || version != INDEX_VERSION
+        || read_u32 (&p, end, &count) < 0
+        || read_u32 (&p, end, &id) < 0
+        || read_u32 (&p, end, &size) < 0)
+        goto error;
+    *tail_id = id;
+    *tail_size = size;
+    for (i = 0; i < count; i++) {
+        uint32_t keylen, seg_id, offset, datalen;
+        struct segment *seg;
+
+        if (read_u32 (&p, end, &keylen) < 0
+            || read_u32 (&p, end, &seg_id) < 0
+            || read_u32 (&p, end, &offset) < 0
+            || read_u32 (&p, end, &datalen) < 0
+            || keylen == 0
+            || keylen > KEY_MAX
+            || end - p < keylen)
+            goto error;
+        memcpy (key, p, keylen);
+        key[keylen] = '\0';
+        p += keylen;
+        if (!(seg = segment_find (db, seg_id))
+            || offset > seg->size
+            || record_size (keylen, datalen) > seg->size - offset)
+            goto error;
+        if (index_update (db, key, seg, offset, datalen) < 0)
+            goto error;
+    }
+    (void)munmap (buf, sb.st_size);
+    (void)close (fd);
+    return 0;
+error:
+    if (buf != MAP_FAILED)
+        (void)munmap (buf, sb.st_size);
+    (void)close (fd);
+    index_clear (db);
+    return -1;
+}
+
+struct index_writer {
+    FILE *f;
+    uint32_t checksum;
+};
+
+static int write_u32 (struct index_writer *w, uint32_t val)
+{
+    uint32_t n = htonl (val);
+
+    w->checksum = fnv1a (w->checksum, &n, sizeof (n));
+    if (fwrite (&n, sizeof (n), 1, w->f) != 1)
+        return -1;
+    return 0;
+}
+
+static int write_bytes (struct index_writer *w, const void *buf, size_t len)
+{
+    w->checksum = fnv1a (w->checksum, buf, len);
+    if (fwrite (buf, 1, len, w->f) != len)
+        return -1;
+    return 0;
+}
+
+/* Write the index to a temporary file, then rename it into place.
+ */
+static int index_save (struct packdb *db)
+{
+    char path[1024];
+    char tmp[1024];
+    struct segment *cur = segment_current (db);
+    struct index_writer w = { .checksum = fnv1a_init };
+    struct entry *e;
+    uint32_t checksum;
+
+    snprintf (path, sizeof (path), "%s/pack.index", db->dbpath);
+    snprintf (tmp, sizeof (tmp), "%s/pack.index.tmp", db->dbpath);
+    if (!(w.f = fopen (tmp, "w")))
+        return -1;
+    if (write_u32 (&w, INDEX_MAGIC) < 0
+        || write_u32 (&w, INDEX_VERSION) < 0
+        || write_u32 (&w, zhashx_size (db->index)) < 0
+        || write_u32 (&w, cur ? cur->id : 0) < 0
+        || write_u32 (&w, cur ? cur->size : 0) < 0)
+        goto error;
+    e = zhashx_first (db->index);
+    while (e) {
+        const char *key = zhashx_cursor (db->index);
+        size_t keylen = strlen (key);
+
+        if (write_u32 (&w, keylen) < 0
+            || write_u32 (&w, e->seg) < 0
+            || write_u32 (&w, e->offset) < 0
+            || write_u32 (&w, e->datalen) < 0
+            || write_bytes (&w, key, keylen) < 0)
+            goto error;
+        e = zhashx_next (db->index);
+    }
+    checksum = htonl (w.checksum);
+    if (fwrite (&checksum, sizeof (checksum), 1, w.f) != 1)
+        goto error;
+    if (fflush (w.f) != 0 || fsync (fileno (w.f)) < 0)
+        goto error;
+    if (fclose (w.f) != 0) {
+        w.f = NULL;
+        goto error;
+    }
+    w.f = NULL;
+    if (rename (tmp, path) < 0)
+        goto error;
+    db->dirty = false;
+    return 0;
+error:
+    if (w.f)
+        ERRNO_SAFE_WRAP (fclose, w.f);
+    ERRNO_SAFE_WRAP (unlink, tmp);
+    return -1;
+}
+
+/* Open all existing segments in dbpath.
+ */
+static int segments_open (struct packdb *db)
+{
+    DIR *dir;
+    struct dirent *dent;
+
+    if (!(dir = opendir (db->dbpath)))
+        return -1;
+    while ((dent = readdir (dir))) {
+        unsigned int id;
+        char c;
+        struct segment *seg;
+
+        if (sscanf (dent->d_name, "pack.%8x%c", &id, &c) != 1
+            || strlen (dent->d_name) != 13)
+            continue;
+        if (!(seg = segment_open (db, id, false)))
+            goto error;
+        if (segment_push (db, seg) < 0) {
+            segment_destroy (seg);
+            goto error;
+        }
+    }
+    closedir (dir);
+    return 0;
+error:
+    ERRNO_SAFE_WRAP (closedir, dir);
+    return -1;
+}
+
+void packdb_close (struct packdb *db)
+{
+    if (db) {
+        int saved_errno = errno;
+        int i;
+        if (db->dirty)
+            (void)packdb_sync (db);
+        for (i = 0; i < db->nsegs; i++)
+            segment_destroy (db->segs[i]);
+        free (db->segs);
+        zhashx_destroy (&db->index);
+        free (db->dbpath);
+        free (db);
+        errno = saved_errno;
+    }
+}
+
+struct packdb *packdb_open (const char *dbpath,
+                            size_t segment_size,
+                            const char **errstr)
+{
+    struct packdb *db;
+    uint32_t tail_id = 0;
+    size_t tail_size = 0;
+    uint64_t scan_from = 0;
+    int i;
+
+    if (!dbpath || segment_size == 0 || segment_size > UINT32_MAX) {
+        errno = EINVAL;
+        if (errstr)
+            *errstr = "invalid argument";
+        return NULL;
+    }
+    if (!(db = calloc (1, sizeof (*db))))
+        return NULL;
+    db->segment_size = segment_size;
+    if (!(db->dbpath = strdup (dbpath)))
+        goto error;
+    if (!(db->index = zhashx_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    zhashx_set_destructor (db->index, entry_destructor);
+    if (segments_open (db) < 0) {
+        if (errstr)
+            *errstr = "error opening segments";
+        goto error;
+    }
+    /* Trust the persisted index up to the tail it recorded, then scan
+     * whatever was appended after it.  Without a usable index, scan all.
+     */
+    if (index_load (db, &tail_id, &tail_size) == 0) {
+        struct segment *tail = segment_find (db, tail_id);
+
+        db->dirty = false;
+        if (!tail || tail_size > tail->size) {
+            index_clear (db);
+            scan_from = 0;
+        }
+        else {
+            if (segment_scan (db, tail, tail_size) < 0)
+                goto error_scan;
+            scan_from = tail_id + 1;
+        }
+    }
+    for (i = 0; i < db->nsegs; i++) {
+        if (db->segs[i]->id >= scan_from) {
+            if (segment_scan (db, db->segs[i], 0) < 0)
+                goto error_scan;
+        }
+    }
+    if (!segment_current (db) && !segment_new (db)) {
+        if (errstr)
+            *errstr = "error creating segment";
+        goto error;
+    }
+    return db;
+error_scan:
+    if (errstr)
+        *errstr = "error scanning segment";
+error:
+    db->dirty = false; // don't persist a partially loaded index
+    packdb_close (db);
+    return NULL;
+}
+
+int packdb_get (struct packdb *db,
+                const char *key,
+                const void **datap,
+                size_t *sizep,
+                const char **errstr)
+{
+    struct entry *e;
+    struct segment *seg;
+
+    if (!db) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (validate_key (key, errstr) < 0)
+        return -1;
+    if (!(e = zhashx_lookup (db->index, key))
+        || !(seg = segment_find (db, e->seg))) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (datap) {
+        *datap = (char *)seg->map + e->offset
+                                  + record_size (strlen (key), 0);
+    }
+    if (sizep)
+        *sizep = e->datalen;
+    return 0;
+}
+
+int packdb_put (struct packdb *db,
+                const char *key,
+                const void *data,
+                size_t size,
+                const char **errstr)
+{
+    if (!db || (size > 0 && !data)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (validate_key (key, errstr) < 0)
+        return -1;
+    return append_record (db, key, data, size);
+}
+
+int packdb_sync (struct packdb *db)
+{
+    struct segment *cur;
+
+    if (!db) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((cur = segment_current (db)) && fdatasync (cur->fd) < 0)
+        return -1;
+    if (!db->dirty)
+        return 0;
+    return index_save (db);
+}
+
+int packdb_compact (struct packdb *db, double threshold)
+{
+    struct entry *e;
+    int count = 0;
+    int i;
+
+    if (!db || threshold < 0. || threshold > 1.) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < db->nsegs - 1; i++) {
+        struct segment *seg = db->segs[i];
+        if (seg->size == 0
+            || (double)(seg->size - seg->live) >= threshold * seg->size) {
+            seg->compacting = true;
+            count++;
+        }
+    }
+    if (count == 0)
+        return 0;
+    /* Copy live records out of the segments being compacted.  The source
+     * mappings stay valid since the segments are not removed until the
+     * index no longer refers to them.
+     */
+    e = zhashx_first (db->index);
+    while (e) {
+        struct segment *seg = segment_find (db, e->seg);
+
+        if (seg && seg->compacting) {
+            const char *key = zhashx_cursor (db->index);
+            size_t keylen = strlen (key);
+            const char *data = (char *)seg->map + e->offset
+                                                + record_size (keylen, 0);
+            if (append_record (db, key, data, e->datalen) < 0)
+                goto error;
+        }
+        e = zhashx_next (db->index);
+    }
+    if (packdb_sync (db) < 0)
+        goto error;
+    i = 0;
+    while (i < db->nsegs) {
+        if (db->segs[i]->compacting)
+            segment_remove (db, db->segs[i]);
+        else
+            i++;
+    }
+    return count;
+error:
+    for (i = 0; i < db->nsegs; i++)
+        db->segs[i]->compacting = false;
+    return -1;
+}
+
+void packdb_stats (struct packdb *db,
+                   int *keys,
+                   int *segments,
+                   size_t *size,
+                   size_t *live)
+{
+    size_t total_size = 0;
+    size_t total_live = 0;
+    int i;
+
+    if (db) {
+        for (i = 0; i < db->nsegs; i++) {
+            total_size += db->segs[i]->size;
+            total_live += db->segs[i]->live;
+        }
+    }
+    if (keys)
+        *keys = db ? zhashx_size (db->index) : 0;
+    if (segments)
+        *segments = db ? db->nsegs : 0;
+    if (size)
+        *size = total_size;
+    if (live)
+        *live = total_live;
+}
+
+/*
+ * vi:ts=4 sw=4 expandtab
+ */
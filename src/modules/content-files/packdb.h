@@ -0,0 +1,96 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _CONTENT_FILES_PACKDB_H
+#define _CONTENT_FILES_PACKDB_H
+
+#include <stddef.h>
+
+/* packdb - log-structured key-value store
+ *
+ * Values are appended to segment files (pack.XXXXXXXX) in the dbpath
+ * directory, and an in-memory hash index maps each key to its latest
+ * record.  Segments are mapped into memory for reads.  The index is
+ * persisted to pack.index by packdb_sync(), and on open, any records
+ * appended after the last sync are recovered by scanning the tail.
+ * A torn record at the end of a segment is truncated away.
+ *
+ * Overwriting a key leaves a dead record behind.  packdb_compact()
+ * copies the live records out of mostly-dead segments and removes them.
+ */
+
+struct packdb;
+
+/* Open the packed database in existing directory 'dbpath', creating an
+ * empty one if needed.  A new segment is started when appending to the
+ * current one would exceed 'segment_size' bytes.
+ * On failure, NULL is returned with errno set.
+ * Pass '*errstr' in pre-set to NULL and if a human readable error message
+ * is appropriate, it is assigned on error (do not free).
+ */
+struct packdb *packdb_open (const char *dbpath,
+                            size_t segment_size,
+                            const char **errstr);
+
+/* Sync (see below) and close the database.
+ */
+void packdb_close (struct packdb *db);
+
+/* Look up 'key'.  On success, 'datap' and 'sizep' are assigned the value
+ * and its size and 0 is returned.  The value points into a read-only
+ * mapping and remains valid until packdb_compact() or packdb_close().
+ * packdb_put() does not move existing mappings, so it does not
+ * invalidate it.
+ * On failure, -1 is returned with errno set.
+ */
+int packdb_get (struct packdb *db,
+                const char *key,
+                const void **datap,
+                size_t *sizep,
+                const char **errstr);
+
+/* Append value 'data' of length 'size' for 'key', replacing any
+ * previous value.  On success, 0 is returned.
+ * On failure, -1 is returned with errno set.
+ */
+int packdb_put (struct packdb *db,
+                const char *key,
+                const void *data,
+                size_t size,
+                const char **errstr);
+
+/* Flush the current segment to disk and persist the index if it changed,
+ * so that the next open need not scan.  Returns 0 on success, -1 on failure
+ * with errno set.
+ */
+int packdb_sync (struct packdb *db);
+
+/* Reclaim segments (other than the current one) in which at least
+ * 'threshold' (0 to 1) of the bytes belong to dead records.  Live
+ * records are copied to the current segment, the index is synced,
+ * and the old segments are removed.  Returns the number of segments
+ * removed, or -1 on failure with errno set.
+ */
+int packdb_compact (struct packdb *db, double threshold);
+
+/* Get the number of keys, the number of segments, and the total and
+ * live number of bytes stored in segments.  Any output may be NULL.
+ */
+void packdb_stats (struct packdb *db,
+                   int *keys,
+                   int *segments,
+                   size_t *size,
+                   size_t *live);
+
+#endif /* !_CONTENT_FILES_PACKDB_H */
+
+/*
+ * vi:ts=4 sw=4 expandtab
+ */
@@ -0,0 +1,387 @@
+/************************************************************\
+ * Copyright 2021 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/modules/content-files/packdb.h"
+#include "src/common/libutil/unlink_recursive.h"
+
+static bool check_value (struct packdb *db,
+                         const char *key,
+                         const void *val,
+                         size_t len)
+{
+    const void *data;
+    size_t size;
+
+    if (packdb_get (db, key, &data, &size, NULL) < 0)
+        return false;
+    return size == len && (len == 0 || memcmp (data, val, len) == 0);
+}
+
+static void make_key (char *buf, size_t len, int i)
+{
+    snprintf (buf, len, "key%d", i);
+}
+
+void test_badargs (const char *dbpath)
+{
+    struct packdb *db;
+    const void *data;
+    size_t size;
+    const char *errstr;
+    char longkey[8192];
+
+    memset (longkey, 'x', sizeof (longkey));
+    longkey[sizeof (longkey) - 1] = '\0';
+
+    errno = 0;
+    ok (packdb_open (NULL, 4096, NULL) == NULL && errno == EINVAL,
+        "packdb_open dbpath=NULL fails with EINVAL");
+    errno = 0;
+    ok (packdb_open (dbpath, 0, NULL) == NULL && errno == EINVAL,
+        "packdb_open segment_size=0 fails with EINVAL");
+    errno = 0;
+    ok (packdb_open ("/noexist", 4096, NULL) == NULL && errno == ENOENT,
+        "packdb_open dbpath=/noexist fails with ENOENT");
+
+    if (!(db = packdb_open (dbpath, 4096, NULL)))
+        BAIL_OUT ("packdb_open failed");
+
+    errno = 0;
+    errstr = NULL;
+    ok (packdb_get (db, "", &data, &size, &errstr) < 0 && errno == EINVAL,
+        "packdb_get key=\"\" failed with EINVAL");
+    ok (errstr != NULL,
+        "and error string was set");
+    errno = 0;
+    errstr = NULL;
+    ok (packdb_get (db, longkey, &data, &size, &errstr) < 0
+        && errno == EOVERFLOW,
+        "packdb_get key=<long> failed with EOVERFLOW");
+    ok (errstr != NULL,
+        "and error string was set");
+    errno = 0;
+    ok (packdb_get (db, "noexist", &data, &size, NULL) < 0 && errno == ENOENT,
+        "packdb_get key=noexist failed with ENOENT");
+
+    errno = 0;
+    errstr = NULL;
+    ok (packdb_put (db, "", "", 1, &errstr) < 0 && errno == EINVAL,
+        "packdb_put key=\"\" failed with EINVAL");
+    ok (errstr != NULL,
+        "and error string was set");
+    errno = 0;
+    ok (packdb_put (db, longkey, "", 1, NULL) < 0 && errno == EOVERFLOW,
+        "packdb_put key=<long> failed with EOVERFLOW");
+    errno = 0;
+    ok (packdb_put (db, "key", NULL, 1, NULL) < 0 && errno == EINVAL,
+        "packdb_put data=NULL size=1 failed with EINVAL");
+    errno = 0;
+    ok (packdb_compact (db, 2.) < 0 && errno == EINVAL,
+        "packdb_compact threshold=2 failed with EINVAL");
+
+    packdb_close (db);
+}
+
+void test_simple (const char *dbpath)
+{
+    struct packdb *db;
+    char val1[] = { 'a', 'b', 'c' };
+    char val2[] = { 'z', 'y', 'x', 'w', 'v', 'u'};
+    int keys;
+
+    ok ((db = packdb_open (dbpath, 4096, NULL)) != NULL,
+        "packdb_open works");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+
+    ok (packdb_put (db, "key1", val1, sizeof (val1), NULL) == 0,
+        "packdb_put key1={abc} works");
+    ok (check_value (db, "key1", val1, sizeof (val1)),
+        "packdb_get key1 returns {abc}");
+    ok (packdb_put (db, "empty", NULL, 0, NULL) == 0,
+        "packdb_put empty={} works");
+    ok (check_value (db, "empty", NULL, 0),
+        "packdb_get empty returns {}");
+
+    ok (packdb_put (db, "key1", val2, sizeof (val2), NULL) == 0,
+        "packdb_put key1={zyxwvu} works (overwrite)");
+    ok (check_value (db, "key1", val2, sizeof (val2)),
+        "packdb_get key1 returns the updated data");
+    packdb_stats (db, &keys, NULL, NULL, NULL);
+    ok (keys == 2,
+        "packdb_stats reports 2 keys");
+
+    packdb_close (db);
+
+    ok ((db = packdb_open (dbpath, 4096, NULL)) != NULL,
+        "packdb_open works on existing database");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+    ok (check_value (db, "key1", val2, sizeof (val2)),
+        "packdb_get key1 returns the updated data after reopen");
+    ok (check_value (db, "empty", NULL, 0),
+        "packdb_get empty returns {} after reopen");
+    packdb_close (db);
+}
+
+/* Put 'count' keys with 100 byte values into 'db', which should
+ * span several 4K segments.
+ */
+static int put_many (struct packdb *db, int count, char fill)
+{
+    char key[64];
+    char val[100];
+    int i;
+
+    memset (val, fill, sizeof (val));
+    for (i = 0; i < count; i++) {
+        make_key (key, sizeof (key), i);
+        val[0] = i;
+        if (packdb_put (db, key, val, sizeof (val), NULL) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int check_many (struct packdb *db, int count, char fill)
+{
+    char key[64];
+    char val[100];
+    int i;
+
+    memset (val, fill, sizeof (val));
+    for (i = 0; i < count; i++) {
+        make_key (key, sizeof (key), i);
+        val[0] = i;
+        if (!check_value (db, key, val, sizeof (val)))
+            return -1;
+    }
+    return 0;
+}
+
+void test_segments (const char *dbpath)
+{
+    struct packdb *db;
+    char path[1024];
+    int keys, segments, segments2;
+    size_t size, live;
+
+    if (!(db = packdb_open (dbpath, 4096, NULL)))
+        BAIL_OUT ("packdb_open failed");
+    ok (put_many (db, 200, 'a') == 0,
+        "packdb_put 200 keys works");
+    packdb_stats (db, &keys, &segments, &size, &live);
+    ok (segments > 1,
+        "values span %d segments", segments);
+    ok (check_many (db, 200, 'a') == 0,
+        "packdb_get 200 keys works");
+    ok (packdb_sync (db) == 0,
+        "packdb_sync works");
+    packdb_close (db);
+
+    /* reopen without an index forces a full scan
+     */
+    snprintf (path, sizeof (path), "%s/pack.index", dbpath);
+    ok (unlink (path) == 0,
+        "removed pack.index");
+    ok ((db = packdb_open (dbpath, 4096, NULL)) != NULL,
+        "packdb_open works without pack.index");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+    ok (check_many (db, 200, 'a') == 0,
+        "packdb_get 200 keys works after scan");
+
+    /* overwrite everything so the old segments are dead
+     */
+    ok (put_many (db, 200, 'b') == 0,
+        "packdb_put 200 keys works (overwrite)");
+    packdb_stats (db, &keys, &segments, &size, &live);
+    ok (live < size,
+        "packdb_stats reports dead bytes");
+    ok (packdb_compact (db, 0.5) > 0,
+        "packdb_compact removed some segments");
+    packdb_stats (db, &keys, &segments2, &size, &live);
+    ok (segments2 < segments,
+        "segment count went from %d to %d", segments, segments2);
+    ok (check_many (db, 200, 'b') == 0,
+        "packdb_get 200 keys works after compaction");
+    ok (packdb_compact (db, 0.5) == 0,
+        "packdb_compact again removes nothing");
+    packdb_close (db);
+
+    ok ((db = packdb_open (dbpath, 4096, NULL)) != NULL,
+        "packdb_open works after compaction");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+    ok (check_many (db, 200, 'b') == 0,
+        "packdb_get 200 keys works after reopen");
+    packdb_close (db);
+}
+
+void test_large (const char *dbpath)
+{
+    struct packdb *db;
+    size_t len = 16384;
+    char *val;
+
+    if (!(val = malloc (len)))
+        BAIL_OUT ("out of memory");
+    memset (val, 'L', len);
+    if (!(db = packdb_open (dbpath, 4096, NULL)))
+        BAIL_OUT ("packdb_open failed");
+    ok (packdb_put (db, "large", val, len, NULL) == 0,
+        "packdb_put value larger than segment size works");
+    ok (check_value (db, "large", val, len),
+        "packdb_get returns large value");
+    ok (packdb_put (db, "small", "x", 1, NULL) == 0
+        && check_value (db, "small", "x", 1),
+        "packdb_put/get small value after large value works");
+    packdb_close (db);
+    free (val);
+}
+
+/* A pointer returned by packdb_get() must survive later puts, including
+ * ones that start new segments or need a segment larger than the
+ * segment size.
+ */
+void test_stable (const char *dbpath)
+{
+    struct packdb *db;
+    size_t len = 16384;
+    const void *data;
+    size_t size;
+    char *val;
+
+    if (!(val = malloc (len)))
+        BAIL_OUT ("out of memory");
+    memset (val, 'S', len);
+    if (!(db = packdb_open (dbpath, 4096, NULL)))
+        BAIL_OUT ("packdb_open failed");
+    if (packdb_put (db, "stable", "abcdef", 6, NULL) < 0)
+        BAIL_OUT ("packdb_put failed");
+    ok (packdb_get (db, "stable", &data, &size, NULL) == 0 && size == 6,
+        "packdb_get works");
+    ok (put_many (db, 200, 'c') == 0
+        && packdb_put (db, "stable-large", val, len, NULL) == 0
+        && put_many (db, 200, 'd') == 0,
+        "packdb_put many values and a large value works");
+    ok (memcmp (data, "abcdef", 6) == 0,
+        "value returned earlier by packdb_get is unchanged");
+    packdb_close (db);
+    free (val);
+}
+
+void test_torn (const char *dbpath)
+{
+    struct packdb *db;
+    char path[1024];
+    int fd;
+    struct stat sb;
+    const void *data;
+    size_t size;
+
+    if (!(db = packdb_open (dbpath, 1024*1024, NULL)))
+        BAIL_OUT ("packdb_open failed");
+    ok (packdb_put (db, "first", "1111", 4, NULL) == 0
+        && packdb_sync (db) == 0,
+        "packdb_put first + packdb_sync works");
+    ok (packdb_put (db, "second", "2222", 4, NULL) == 0,
+        "packdb_put second works");
+    packdb_close (db);
+
+    /* chop the last byte off the second record to simulate a crash
+     * during append
+     */
+    snprintf (path, sizeof (path), "%s/pack.00000000", dbpath);
+    if ((fd = open (path, O_RDWR)) < 0
+        || fstat (fd, &sb) < 0
+        || ftruncate (fd, sb.st_size - 1) < 0
+        || close (fd) < 0)
+        BAIL_OUT ("could not truncate %s", path);
+
+    ok ((db = packdb_open (dbpath, 1024*1024, NULL)) != NULL,
+        "packdb_open works with torn record");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+    ok (check_value (db, "first", "1111", 4),
+        "packdb_get first works");
+    errno = 0;
+    ok (packdb_get (db, "second", &data, &size, NULL) < 0 && errno == ENOENT,
+        "packdb_get second fails with ENOENT");
+    ok (packdb_put (db, "third", "3333", 4, NULL) == 0,
+        "packdb_put third works");
+    packdb_close (db);
+
+    ok ((db = packdb_open (dbpath, 1024*1024, NULL)) != NULL,
+        "packdb_open works again");
+    if (!db)
+        BAIL_OUT ("packdb_open failed");
+    ok (check_value (db, "first", "1111", 4)
+        && check_value (db, "third", "3333", 4),
+        "packdb_get first and third work");
+    packdb_close (db);
+}
+
+static void make_tmpdir (char *dir, size_t len, const char *name)
+{
+    const char *tmp = getenv ("TMPDIR");
+
+    if (!tmp)
+        tmp = "/tmp";
+    if (snprintf (dir, len, "%s/%s.XXXXXX", tmp, name) >= len)
+        BAIL_OUT ("internal buffer overflow");
+    if (!mkdtemp (dir))
+        BAIL_OUT ("mkdtemp failed");
+    diag ("mkdir %s", dir);
+}
+
+int main (int argc, char *argv[])
+{
+    char dir[1024];
+
+    plan (NO_PLAN);
+
+    make_tmpdir (dir, sizeof (dir), "packdb");
+    test_badargs (dir);
+    test_simple (dir);
+    if (unlink_recursive (dir) < 0)
+        BAIL_OUT ("unlink_recursive failed");
+
+    make_tmpdir (dir, sizeof (dir), "packdb");
+    test_segments (dir);
+    test_large (dir);
+    test_stable (dir);
+    if (unlink_recursive (dir) < 0)
+        BAIL_OUT ("unlink_recursive failed");
+
+    make_tmpdir (dir, sizeof (dir), "packdb");
+    test_torn (dir);
+    if (unlink_recursive (dir) < 0)
+        BAIL_OUT ("unlink_recursive failed");
+
+    done_testing ();
+    return (0);
+}
+
+// vi: ts=4 sw=4 expandtab
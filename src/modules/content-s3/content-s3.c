@@ -15,6 +15,7 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 #include "src/common/libutil/log.h"
 
 #include "src/common/libcontent/content-util.h"
@@ -313,6 +314,121 @@ error:
         flux_log_error (h, "error responding to store request");
 }
 
+/* Handle a content-backing.load-batch request from the rank 0 broker's
+ * content-cache service.  The raw request payload is a blobvec of blobref
+ * strings, including NULL terminators.  The raw response payload is a
+ * blobvec with one element per blobref, either the blob content or an
+ * error element.
+ */
+static void load_batch_cb (flux_t *h, flux_msg_handler_t *mh, const flux_msg_t *msg, void *arg)
+{
+    struct content_s3 *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const char *blobref;
+    int blobref_size;
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    while ((rc = blobvec_next (buf,
+                               len,
+                               &cursor,
+                               (const void **)&blobref,
+                               &blobref_size)) == 1) {
+        void *data = NULL;
+        size_t size;
+        const char *errstr;
+
+        if (blobref_size <= 0 || blobref[blobref_size - 1] != '\0') {
+            errno = EPROTO;
+            goto error;
+        }
+        if (blobref_validate (blobref) < 0)
+            rc = blobvec_append_error (bv, EINVAL);
+        else if (s3_get (ctx->cfg, blobref, &data, &size, &errstr) < 0)
+            rc = blobvec_append_error (bv, errno);
+        else {
+            rc = blobvec_append (bv, data, size);
+            free (data);
+        }
+        if (rc < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "error responding to load-batch request");
+    blobvec_destroy (bv);
+    return;
+
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "error responding to load-batch request");
+    blobvec_destroy (bv);
+}
+
+/* Handle a content-backing.store-batch request from the rank 0 broker's
+ * content-cache service.  The raw request payload is a blobvec of blobs.
+ * The raw response payload is a blobvec of blobref strings, including NULL
+ * terminators, in the same order.  Any failure fails the entire request.
+ */
+static void store_batch_cb (flux_t *h, flux_msg_handler_t *mh, const flux_msg_t *msg, void *arg)
+{
+    struct content_s3 *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const void *data;
+    int size;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    const char *errstr = NULL;
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0)
+        goto error;
+    while ((rc = blobvec_next (buf, len, &cursor, &data, &size)) == 1) {
+        if (size < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if (blobref_hash (ctx->hashfun,
+                          (uint8_t *)data,
+                          size,
+                          blobref,
+                          sizeof (blobref)) < 0)
+            goto error;
+        if (s3_put (ctx->cfg, blobref, data, size, &errstr) < 0)
+            goto error;
+        if (blobvec_append (bv, blobref, strlen (blobref) + 1) < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "error responding to store-batch request");
+    blobvec_destroy (bv);
+    return;
+
+error:
+    if (flux_respond_error (h, msg, errno, errstr) < 0)
+        flux_log_error (h, "error responding to store-batch request");
+    blobvec_destroy (bv);
+}
+
 /* Handle a kvs-checkpoint.get request from the rank 0 kvs module.
  * The KVS stores its last root reference here for restart purposes.
  *
@@ -392,6 +508,8 @@ error:
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.load-batch", load_batch_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.store-batch", store_batch_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.get", checkpoint_get_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.put", checkpoint_put_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-s3.config-reload", config_reload_cb, 0 },
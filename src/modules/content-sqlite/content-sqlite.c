@@ -8,7 +8,26 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* content-sqlite.c - content addressable storage with sqlite back end */
+/* content-sqlite.c - content addressable storage with sqlite back end
+ *
+ * Module options:
+ *   journal_mode=MODE     sqlite journal mode, e.g. OFF (default), WAL
+ *   synchronous=LEVEL     sqlite synchronous level, e.g. OFF (default), NORMAL
+ *   group-commit-max=N    commit after N blobs (default 256, or 0 if
+ *                         journal_mode=OFF; 0 disables group commit)
+ *   group-commit-delay=T  hold the group open for up to T seconds
+ *                         (default 0, commit once per reactor loop iteration)
+ *
+ * With group commit, stores are executed inside a transaction that is
+ * committed by a prepare watcher once per reactor loop iteration (or by
+ * a timer if group-commit-delay is set, or when the group fills), and
+ * responses are deferred until the transaction commits.  Checkpoint
+ * updates commit any open group first.
+ *
+ * A failed group commit is rolled back, but ROLLBACK is undefined with
+ * journal_mode=OFF, so group commit is only enabled with a rollback
+ * journal or WAL.
+ */
 
 #if HAVE_CONFIG_H
 #include "config.h"
@@ -19,6 +38,7 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/blobvec.h"
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/errno_safe.h"
 
@@ -46,6 +66,23 @@ const char *sql_checkpt_get = "SELECT value FROM checkpt"
 const char *sql_checkpt_put = "REPLACE INTO checkpt (key,value) "
                               "  values (?1, ?2)";
 
+static const char *journal_modes[] = {
+    "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF", NULL,
+};
+static const char *synchronous_levels[] = {
+    "OFF", "NORMAL", "FULL", "EXTRA", NULL,
+};
+
+static const int default_group_commit_max = 256;
+
+/* A store request whose response is deferred until group commit.
+ */
+struct group_req {
+    const flux_msg_t *msg;
+    void *rsp;
+    int rsp_len;
+};
+
 struct content_sqlite {
     flux_msg_handler_t **handlers;
     char *dbfile;
@@ -58,8 +95,26 @@ struct content_sqlite {
     const char *hashfun;
     size_t lzo_bufsize;
     void *lzo_buf;
+    char journal_mode[16];
+    char synchronous[16];
+
+    /* group commit */
+    int group_commit_max;
+    double group_commit_delay;
+    bool group_active;          /* transaction is open */
+    int group_blobs;            /* number of blobs stored in transaction */
+    zlist_t *group;             /* list of struct group_req */
+    flux_watcher_t *prep_w;
+    flux_watcher_t *timer_w;
 };
 
+/* ROLLBACK is undefined with journal_mode=OFF.
+ */
+static bool rollback_supported (struct content_sqlite *ctx)
+{
+    return strcmp (ctx->journal_mode, "OFF") != 0;
+}
+
 static void log_sqlite_error (struct content_sqlite *ctx, const char *fmt, ...)
 {
     char buf[64];
@@ -273,6 +328,141 @@ error:
     return -1;
 }
 
+static void group_req_destroy (struct group_req *gr)
+{
+    if (gr) {
+        int saved_errno = errno;
+        flux_msg_decref (gr->msg);
+        free (gr->rsp);
+        free (gr);
+        errno = saved_errno;
+    }
+}
+
+static struct group_req *group_req_create (const flux_msg_t *msg,
+                                           const void *rsp,
+                                           int rsp_len)
+{
+    struct group_req *gr;
+
+    if (!(gr = calloc (1, sizeof (*gr))))
+        return NULL;
+    if (rsp_len > 0) {
+        if (!(gr->rsp = malloc (rsp_len)))
+            goto error;
+        memcpy (gr->rsp, rsp, rsp_len);
+        gr->rsp_len = rsp_len;
+    }
+    gr->msg = flux_msg_incref (msg);
+    return gr;
+error:
+    group_req_destroy (gr);
+    return NULL;
+}
+
+/* Commit the open group transaction, if any, then respond to all
+ * deferred store requests.  If the commit fails, they all get an error.
+ */
+static void group_commit (struct content_sqlite *ctx)
+{
+    struct group_req *gr;
+    int errnum = 0;
+
+    if (!ctx->group_active)
+        return;
+    if (sqlite3_exec (ctx->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "group commit");
+        set_errno_from_sqlite_error (ctx);
+        errnum = errno;
+        if (sqlite3_get_autocommit (ctx->db) == 0) {
+            if (sqlite3_exec (ctx->db,
+                              "ROLLBACK",
+                              NULL,
+                              NULL,
+                              NULL) != SQLITE_OK)
+                log_sqlite_error (ctx, "group rollback");
+        }
+    }
+    ctx->group_active = false;
+    ctx->group_blobs = 0;
+    flux_watcher_stop (ctx->prep_w);
+    flux_watcher_stop (ctx->timer_w);
+    while ((gr = zlist_pop (ctx->group))) {
+        if (errnum) {
+            if (flux_respond_error (ctx->h, gr->msg, errnum, NULL) < 0)
+                flux_log_error (ctx->h, "group commit: flux_respond_error");
+        }
+        else {
+            if (flux_respond_raw (ctx->h, gr->msg, gr->rsp, gr->rsp_len) < 0)
+                flux_log_error (ctx->h, "group commit: flux_respond_raw");
+        }
+        group_req_destroy (gr);
+    }
+}
+
+static void group_prep_cb (flux_reactor_t *r,
+                           flux_watcher_t *w,
+                           int revents,
+                           void *arg)
+{
+    group_commit (arg);
+}
+
+static void group_timer_cb (flux_reactor_t *r,
+                            flux_watcher_t *w,
+                            int revents,
+                            void *arg)
+{
+    group_commit (arg);
+}
+
+/* Open a group transaction if one is not already open.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+static int group_begin (struct content_sqlite *ctx)
+{
+    if (ctx->group_active)
+        return 0;
+    if (sqlite3_exec (ctx->db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "group begin");
+        set_errno_from_sqlite_error (ctx);
+        return -1;
+    }
+    ctx->group_active = true;
+    if (ctx->group_commit_delay > 0.) {
+        flux_timer_watcher_reset (ctx->timer_w, ctx->group_commit_delay, 0.);
+        flux_watcher_start (ctx->timer_w);
+    }
+    else
+        flux_watcher_start (ctx->prep_w);
+    return 0;
+}
+
+/* Defer response 'rsp' to 'msg' until the group transaction commits.
+ * 'blobs' is the number of blobs the request stored.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+static int group_add (struct content_sqlite *ctx,
+                      const flux_msg_t *msg,
+                      const void *rsp,
+                      int rsp_len,
+                      int blobs)
+{
+    struct group_req *gr;
+
+    if (!(gr = group_req_create (msg, rsp, rsp_len)))
+        return -1;
+    if (zlist_append (ctx->group, gr) < 0) {
+        group_req_destroy (gr);
+        errno = ENOMEM;
+        return -1;
+    }
+    ctx->group_blobs += blobs;
+    if (ctx->group_blobs >= ctx->group_commit_max)
+        group_commit (ctx);
+    return 0;
+}
+
 static void load_cb (flux_t *h,
                      flux_msg_handler_t *mh,
                      const flux_msg_t *msg,
@@ -321,8 +511,15 @@ void store_cb (flux_t *h,
         flux_log_error (h, "store: request decode failed");
         goto error;
     }
+    if (ctx->group_commit_max > 0 && group_begin (ctx) < 0)
+        goto error;
     if (content_sqlite_store (ctx, data, size, blobref, sizeof (blobref)) < 0)
         goto error;
+    if (ctx->group_commit_max > 0) {
+        if (group_add (ctx, msg, blobref, strlen (blobref) + 1, 1) < 0)
+            goto error;
+        return;
+    }
     if (flux_respond_raw (h, msg, blobref, strlen (blobref) + 1) < 0)
         flux_log_error (h, "store: flux_respond_raw");
     return;
@@ -331,6 +528,165 @@ error:
         flux_log_error (h, "store: flux_respond_error");
 }
 
+/* Load a batch of blobs.  The request is a blobvec of blobrefs, and the
+ * response is a blobvec with one element per blobref, either the blob
+ * or an error element.
+ */
+static void load_batch_cb (flux_t *h,
+                           flux_msg_handler_t *mh,
+                           const flux_msg_t *msg,
+                           void *arg)
+{
+    struct content_sqlite *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const char *blobref;
+    int blobref_size;
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0) {
+        flux_log_error (h, "load-batch: request decode failed");
+        goto error;
+    }
+    while ((rc = blobvec_next (buf,
+                               len,
+                               &cursor,
+                               (const void **)&blobref,
+                               &blobref_size)) == 1) {
+        const void *data;
+        int size;
+
+        if (blobref_size <= 0 || blobref[blobref_size - 1] != '\0') {
+            errno = EPROTO;
+            flux_log_error (h, "load-batch: malformed blobref");
+            goto error;
+        }
+        if (blobref_validate (blobref) < 0)
+            rc = blobvec_append_error (bv, EINVAL);
+        else if (content_sqlite_load (ctx, blobref, &data, &size) < 0)
+            rc = blobvec_append_error (bv, errno);
+        else {
+            rc = blobvec_append (bv, data, size);
+            (void )sqlite3_reset (ctx->load_stmt);
+        }
+        if (rc < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "load-batch: flux_respond_raw");
+    blobvec_destroy (bv);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "load-batch: flux_respond_error");
+    blobvec_destroy (bv);
+}
+
+/* Store a batch of blobs in a single transaction.  The request is a
+ * blobvec of blobs, and the response is a blobvec of blobrefs in the
+ * same order.  Any failure fails the entire request, though blobs stored
+ * before the failure may still be committed: with group commit, the batch
+ * joins the open group transaction, which goes on to commit them, and
+ * without a rollback journal, the batch transaction is committed rather
+ * than rolled back.  Extra blobs are harmless in a content addressable
+ * store.
+ */
+static void store_batch_cb (flux_t *h,
+                            flux_msg_handler_t *mh,
+                            const flux_msg_t *msg,
+                            void *arg)
+{
+    struct content_sqlite *ctx = arg;
+    const void *buf;
+    int len;
+    int cursor = 0;
+    const void *data;
+    int size;
+    char blobref[BLOBREF_MAX_STRING_SIZE];
+    struct blobvec *bv;
+    const void *rbuf;
+    int rlen;
+    bool txn = false;
+    int rc;
+
+    if (!(bv = blobvec_create ()))
+        goto error;
+    if (flux_request_decode_raw (msg, NULL, &buf, &len) < 0) {
+        flux_log_error (h, "store-batch: request decode failed");
+        goto error;
+    }
+    if (ctx->group_commit_max > 0) {
+        if (group_begin (ctx) < 0)
+            goto error;
+    }
+    else {
+        if (sqlite3_exec (ctx->db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+            log_sqlite_error (ctx, "store-batch: begin transaction");
+            set_errno_from_sqlite_error (ctx);
+            goto error;
+        }
+        txn = true;
+    }
+    while ((rc = blobvec_next (buf, len, &cursor, &data, &size)) == 1) {
+        if (size < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if (content_sqlite_store (ctx,
+                                  data,
+                                  size,
+                                  blobref,
+                                  sizeof (blobref)) < 0)
+            goto error;
+        if (blobvec_append (bv, blobref, strlen (blobref) + 1) < 0)
+            goto error;
+    }
+    if (rc < 0)
+        goto error;
+    if (ctx->group_commit_max > 0) {
+        blobvec_encode (bv, &rbuf, &rlen);
+        if (group_add (ctx, msg, rbuf, rlen, blobvec_count (bv)) < 0)
+            goto error;
+        blobvec_destroy (bv);
+        return;
+    }
+    if (sqlite3_exec (ctx->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "store-batch: commit transaction");
+        set_errno_from_sqlite_error (ctx);
+        goto error;
+    }
+    blobvec_encode (bv, &rbuf, &rlen);
+    if (flux_respond_raw (h, msg, rbuf, rlen) < 0)
+        flux_log_error (h, "store-batch: flux_respond_raw");
+    blobvec_destroy (bv);
+    return;
+error:
+    if (txn && sqlite3_get_autocommit (ctx->db) == 0) {
+        int saved_errno = errno;
+        if (!rollback_supported (ctx)) {
+            if (sqlite3_exec (ctx->db, "COMMIT", NULL, NULL, NULL)
+                != SQLITE_OK)
+                log_sqlite_error (ctx, "store-batch: commit transaction");
+        }
+        else if (sqlite3_exec (ctx->db, "ROLLBACK", NULL, NULL, NULL)
+                 != SQLITE_OK)
+            log_sqlite_error (ctx, "store-batch: rollback transaction");
+        errno = saved_errno;
+    }
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "store-batch: flux_respond_error");
+    blobvec_destroy (bv);
+}
+
 void checkpoint_get_cb (flux_t *h,
                         flux_msg_handler_t *mh,
                         const flux_msg_t *msg,
@@ -389,6 +745,10 @@ void checkpoint_put_cb (flux_t *h,
         errno = EINVAL;
         goto error;
     }
+    /* A checkpoint refers to previously stored blobs, so make sure they
+     * are committed first.
+     */
+    group_commit (ctx);
     if (sqlite3_bind_text (ctx->checkpt_put_stmt,
                            1,
                            (char *)key,
@@ -456,33 +816,31 @@ static void content_sqlite_closedb (struct content_sqlite *ctx)
 static int content_sqlite_opendb (struct content_sqlite *ctx)
 {
     int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    char s[64];
 
     if (sqlite3_open_v2 (ctx->dbfile, &ctx->db, flags, NULL) != SQLITE_OK) {
         log_sqlite_error (ctx, "opening %s", ctx->dbfile);
         goto error;
     }
+    /* N.B. locking_mode must be set before journal_mode so that WAL mode
+     * does not require shared memory.
+     */
     if (sqlite3_exec (ctx->db,
-                      "PRAGMA journal_mode=OFF",
+                      "PRAGMA locking_mode=EXCLUSIVE",
                       NULL,
                       NULL,
                       NULL) != SQLITE_OK) {
-        log_sqlite_error (ctx, "setting sqlite 'journal_mode' pragma");
+        log_sqlite_error (ctx, "setting sqlite 'locking_mode' pragma");
         goto error;
     }
-    if (sqlite3_exec (ctx->db,
-                      "PRAGMA synchronous=OFF",
-                      NULL,
-                      NULL,
-                      NULL) != SQLITE_OK) {
-        log_sqlite_error (ctx, "setting sqlite 'synchronous' pragma");
+    snprintf (s, sizeof (s), "PRAGMA journal_mode=%s", ctx->journal_mode);
+    if (sqlite3_exec (ctx->db, s, NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "setting sqlite 'journal_mode' pragma");
         goto error;
     }
-    if (sqlite3_exec (ctx->db,
-                      "PRAGMA locking_mode=EXCLUSIVE",
-                      NULL,
-                      NULL,
-                      NULL) != SQLITE_OK) {
-        log_sqlite_error (ctx, "setting sqlite 'locking_mode' pragma");
+    snprintf (s, sizeof (s), "PRAGMA synchronous=%s", ctx->synchronous);
+    if (sqlite3_exec (ctx->db, s, NULL, NULL, NULL) != SQLITE_OK) {
+        log_sqlite_error (ctx, "setting sqlite 'synchronous' pragma");
         goto error;
     }
     if (sqlite3_exec (ctx->db,
@@ -544,6 +902,14 @@ static void content_sqlite_destroy (struct content_sqlite *ctx)
     if (ctx) {
         int saved_errno = errno;
         flux_msg_handler_delvec (ctx->handlers);
+        flux_watcher_destroy (ctx->prep_w);
+        flux_watcher_destroy (ctx->timer_w);
+        if (ctx->group) {
+            struct group_req *gr;
+            while ((gr = zlist_pop (ctx->group)))
+                group_req_destroy (gr);
+            zlist_destroy (&ctx->group);
+        }
         free (ctx->dbfile);
         free (ctx->lzo_buf);
         free (ctx);
@@ -554,15 +920,83 @@ static void content_sqlite_destroy (struct content_sqlite *ctx)
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.load-batch", load_batch_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-backing.store-batch", store_batch_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.get", checkpoint_get_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "kvs-checkpoint.put", checkpoint_put_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
-static struct content_sqlite *content_sqlite_create (flux_t *h)
+/* Copy 'value' to 'buf' if it matches (case insensitively) one of the
+ * strings in the NULL-terminated 'choices' array.
+ */
+static int parse_choice (const char *value,
+                         const char **choices,
+                         char *buf,
+                         size_t bufsz)
+{
+    int i;
+
+    for (i = 0; choices[i] != NULL; i++) {
+        if (!strcasecmp (value, choices[i])) {
+            snprintf (buf, bufsz, "%s", choices[i]);
+            return 0;
+        }
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static int process_args (struct content_sqlite *ctx, int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (!strncmp (argv[i], "journal_mode=", 13)) {
+            if (parse_choice (argv[i] + 13,
+                              journal_modes,
+                              ctx->journal_mode,
+                              sizeof (ctx->journal_mode)) < 0)
+                goto inval;
+        }
+        else if (!strncmp (argv[i], "synchronous=", 12)) {
+            if (parse_choice (argv[i] + 12,
+                              synchronous_levels,
+                              ctx->synchronous,
+                              sizeof (ctx->synchronous)) < 0)
+                goto inval;
+        }
+        else if (!strncmp (argv[i], "group-commit-max=", 17)) {
+            char *endptr;
+            errno = 0;
+            ctx->group_commit_max = strtol (argv[i] + 17, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || ctx->group_commit_max < 0)
+                goto inval;
+        }
+        else if (!strncmp (argv[i], "group-commit-delay=", 19)) {
+            char *endptr;
+            errno = 0;
+            ctx->group_commit_delay = strtod (argv[i] + 19, &endptr);
+            if (errno != 0 || *endptr != '\0' || ctx->group_commit_delay < 0)
+                goto inval;
+        }
+        else
+            goto inval;
+    }
+    return 0;
+inval:
+    flux_log (ctx->h, LOG_ERR, "invalid option: %s", argv[i]);
+    errno = EINVAL;
+    return -1;
+}
+
+static struct content_sqlite *content_sqlite_create (flux_t *h,
+                                                     int argc,
+                                                     char **argv)
 {
     struct content_sqlite *ctx;
     const char *backing_path;
+    flux_reactor_t *r = flux_get_reactor (h);
 
     if (!(ctx = calloc (1, sizeof (*ctx))))
         return NULL;
@@ -570,6 +1004,31 @@ static struct content_sqlite *content_sqlite_create (flux_t *h)
         goto error;
     ctx->lzo_bufsize = lzo_buf_chunksize;
     ctx->h = h;
+    snprintf (ctx->journal_mode, sizeof (ctx->journal_mode), "OFF");
+    snprintf (ctx->synchronous, sizeof (ctx->synchronous), "OFF");
+    ctx->group_commit_max = -1;
+    if (process_args (ctx, argc, argv) < 0)
+        goto error;
+    if (ctx->group_commit_max < 0)
+        ctx->group_commit_max = rollback_supported (ctx)
+                                ? default_group_commit_max : 0;
+    else if (ctx->group_commit_max > 0 && !rollback_supported (ctx)) {
+        flux_log (h, LOG_ERR, "group-commit-max requires a journal_mode"
+                  " other than OFF");
+        errno = EINVAL;
+        goto error;
+    }
+    if (!(ctx->group = zlist_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(ctx->prep_w = flux_prepare_watcher_create (r, group_prep_cb, ctx))
+        || !(ctx->timer_w = flux_timer_watcher_create (r,
+                                                       0.,
+                                                       0.,
+                                                       group_timer_cb,
+                                                       ctx)))
+        goto error;
 
     /* Some tunables:
      * - the hash function, e.g. sha1, sha256
@@ -617,7 +1076,7 @@ int mod_main (flux_t *h, int argc, char **argv)
 {
     struct content_sqlite *ctx;
 
-    if (!(ctx = content_sqlite_create (h))) {
+    if (!(ctx = content_sqlite_create (h, argc, argv))) {
         flux_log_error (h, "content_sqlite_create failed");
         return -1;
     }
@@ -633,9 +1092,14 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log_error (h, "flux_reactor_run");
         goto done;
     }
+    /* Commit the open group, if any, and respond to its deferred store
+     * requests before the content cache is told the backing store is gone.
+     */
+    group_commit (ctx);
     if (content_unregister_backing_store (h) < 0)
         goto done;
 done:
+    group_commit (ctx);
     content_sqlite_closedb (ctx);
     content_sqlite_destroy (ctx);
     return 0;
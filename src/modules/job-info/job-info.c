@@ -228,6 +228,7 @@ int mod_main (flux_t *h, int argc, char **argv)
         goto done;
     if (flux_reactor_run (flux_get_reactor (h), 0) < 0)
         goto done;
+    (void)job_state_checkpoint (ctx);
     rc = 0;
 done:
     info_ctx_destroy (ctx);
@@ -208,6 +208,184 @@ static void revert_job_state (struct info_ctx *ctx,
     }
 }
 
+/* Hash userid in 'key'.
+ * N.B. zhashx_hash_fn signature
+ */
+static size_t userid_hasher (const void *key)
+{
+    const uint32_t *userid = key;
+    return *userid;
+}
+
+/* Compare userid hash keys.
+ * N.B. zhashx_comparator_fn signature
+ */
+static int userid_cmp (const void *key1, const void *key2)
+{
+    const uint32_t *u1 = key1;
+    const uint32_t *u2 = key2;
+
+    return NUMCMP (*u1, *u2);
+}
+
+static void user_jobs_destroy (struct user_jobs *uj)
+{
+    if (uj) {
+        zlistx_destroy (&uj->pending);
+        zlistx_destroy (&uj->running);
+        zlistx_destroy (&uj->inactive);
+        free (uj);
+    }
+}
+
+static void user_jobs_destroy_wrapper (void **data)
+{
+    struct user_jobs **uj = (struct user_jobs **)data;
+    user_jobs_destroy (*uj);
+}
+
+static struct user_jobs *user_jobs_create (uint32_t userid)
+{
+    struct user_jobs *uj;
+
+    if (!(uj = calloc (1, sizeof (*uj))))
+        return NULL;
+    uj->userid = userid;
+    if (!(uj->pending = zlistx_new ())
+        || !(uj->running = zlistx_new ())
+        || !(uj->inactive = zlistx_new ())) {
+        user_jobs_destroy (uj);
+        errno = ENOMEM;
+        return NULL;
+    }
+    zlistx_set_comparator (uj->pending, job_urgency_cmp);
+    zlistx_set_comparator (uj->running, job_running_cmp);
+    zlistx_set_comparator (uj->inactive, job_inactive_cmp);
+    return uj;
+}
+
+/* Look up the jobs of 'userid', adding an entry on first use.
+ */
+static struct user_jobs *user_jobs_get (struct job_state_ctx *jsctx,
+                                        uint32_t userid)
+{
+    struct user_jobs *uj;
+
+    if (!(uj = zhashx_lookup (jsctx->users, &userid))) {
+        if (!(uj = user_jobs_create (userid)))
+            return NULL;
+        if (zhashx_insert (jsctx->users, &uj->userid, uj) < 0) {
+            user_jobs_destroy (uj);
+            errno = EEXIST;
+            return NULL;
+        }
+    }
+    return uj;
+}
+
+/* Return the user's list that mirrors main list 'list', or NULL if
+ * 'list' is not indexed (e.g. processing).
+ */
+static zlistx_t *user_jobs_list (struct job_state_ctx *jsctx,
+                                 struct user_jobs *uj,
+                                 zlistx_t *list)
+{
+    if (list == jsctx->pending)
+        return uj->pending;
+    else if (list == jsctx->running)
+        return uj->running;
+    else if (list == jsctx->inactive)
+        return uj->inactive;
+    return NULL;
+}
+
+/* Map a job result to its inactive_result[] slot.
+ */
+static int result_index (flux_job_result_t result)
+{
+    switch (result) {
+        case FLUX_JOB_RESULT_COMPLETED:
+            return 0;
+        case FLUX_JOB_RESULT_CANCELED:
+            return 2;
+        case FLUX_JOB_RESULT_TIMEOUT:
+            return 3;
+        case FLUX_JOB_RESULT_FAILED:
+        default:
+            return 1;
+    }
+}
+
+/* Add job to the secondary indices, in the same manner as
+ * job_insert_list() adds it to the main lists.
+ */
+static void job_index_insert (struct job_state_ctx *jsctx,
+                              struct job *job,
+                              flux_job_state_t newstate)
+{
+    struct user_jobs *uj;
+
+    if (!(uj = user_jobs_get (jsctx, job->userid))) {
+        flux_log_error (jsctx->h, "%s: user_jobs_get", __FUNCTION__);
+        return;
+    }
+    if (newstate == FLUX_JOB_STATE_DEPEND
+        || newstate == FLUX_JOB_STATE_PRIORITY
+        || newstate == FLUX_JOB_STATE_SCHED)
+        job->user_list_handle = zlistx_insert (uj->pending,
+                                               job,
+                                               search_direction (job));
+    else if (newstate == FLUX_JOB_STATE_RUN
+             || newstate == FLUX_JOB_STATE_CLEANUP)
+        job->user_list_handle = zlistx_add_start (uj->running, job);
+    else { /* newstate == FLUX_JOB_STATE_INACTIVE */
+        int i = result_index (job->result);
+        job->user_list_handle = zlistx_add_start (uj->inactive, job);
+        if (!zlistx_add_start (jsctx->inactive_result[i], job))
+            flux_log_error (jsctx->h, "%s: zlistx_add_start",
+                            __FUNCTION__);
+    }
+    if (!job->user_list_handle)
+        flux_log_error (jsctx->h, "%s: zlistx_insert", __FUNCTION__);
+}
+
+/* Remove job from the user list that mirrors main list 'oldlist'.
+ * Inactive jobs are never removed, so inactive_result[] is untouched.
+ */
+static void job_index_remove (struct job_state_ctx *jsctx,
+                              struct job *job,
+                              zlistx_t *oldlist)
+{
+    struct user_jobs *uj;
+    zlistx_t *list;
+
+    if (job->user_list_handle
+        && (uj = zhashx_lookup (jsctx->users, &job->userid))
+        && (list = user_jobs_list (jsctx, uj, oldlist))) {
+        if (zlistx_detach (list, job->user_list_handle) < 0)
+            flux_log_error (jsctx->h, "%s: zlistx_detach",
+                            __FUNCTION__);
+    }
+    job->user_list_handle = NULL;
+}
+
+/* Re-sort a pending job after its priority changed.
+ */
+static void job_pending_reorder (struct job_state_ctx *jsctx,
+                                 struct job *job)
+{
+    struct user_jobs *uj;
+
+    zlistx_reorder (jsctx->pending,
+                    job->list_handle,
+                    search_direction (job));
+    if (job->user_list_handle
+        && (uj = zhashx_lookup (jsctx->users, &job->userid)))
+        zlistx_reorder (uj->pending,
+                        job->user_list_handle,
+                        search_direction (job));
+}
+
 static void job_insert_list (struct job_state_ctx *jsctx,
                              struct job *job,
                              flux_job_state_t newstate)
@@ -236,6 +414,7 @@ static void job_insert_list (struct job_state_ctx *jsctx,
             flux_log_error (jsctx->h, "%s: zlistx_add_start",
                             __FUNCTION__);
     }
+    job_index_insert (jsctx, job, newstate);
 }
 
 /* remove job from one list and move it to another based on the
@@ -249,6 +428,7 @@ static void job_change_list (struct job_state_ctx *jsctx,
         flux_log_error (jsctx->h, "%s: zlistx_detach",
                         __FUNCTION__);
     job->list_handle = NULL;
+    job_index_remove (jsctx, job, oldlist);
 
     job_insert_list (jsctx, job, newstate);
 }
@@ -292,9 +472,7 @@ static void update_job_state_and_list (struct info_ctx *ctx,
         job_change_list (jsctx, job, oldlist, newstate);
     else if (oldlist == jsctx->pending
              && newstate == FLUX_JOB_STATE_SCHED)
-        zlistx_reorder (jsctx->pending,
-                        job->list_handle,
-                        search_direction (job));
+        job_pending_reorder (jsctx, job);
 }
 
 static void list_id_respond (struct info_ctx *ctx,
@@ -385,6 +563,40 @@ parse_job_name (const char *path)
     return path;
 }
 
+/* Set job->name from jobspec attributes.system.job.name, or if not
+ * present, from the basename of the first command argument.
+ */
+static int job_name_parse (struct info_ctx *ctx, struct job *job)
+{
+    json_error_t error;
+
+    if (job->jobspec_job) {
+        if (json_unpack_ex (job->jobspec_job, &error, 0,
+                            "{s?:s}",
+                            "name", &job->name) < 0) {
+            flux_log (ctx->h, LOG_ERR,
+                      "%s: job %ju invalid job dictionary: %s",
+                      __FUNCTION__, (uintmax_t)job->id, error.text);
+            return -1;
+        }
+    }
+
+    /* If user did not specify job.name, we treat arg 0 of the command
+     * as the job name */
+    if (!job->name) {
+        json_t *arg0 = json_array_get (job->jobspec_cmd, 0);
+        if (!arg0 || !json_is_string (arg0)) {
+            flux_log (ctx->h, LOG_ERR,
+                      "%s: job %ju invalid job command",
+                      __FUNCTION__, (uintmax_t)job->id);
+            return -1;
+        }
+        job->name = parse_job_name (json_string_value (arg0));
+        assert (job->name);
+    }
+    return 0;
+}
+
 static int jobspec_parse (struct info_ctx *ctx,
                           struct job *job,
                           const char *s)
@@ -449,30 +661,8 @@ static int jobspec_parse (struct info_ctx *ctx,
 
     job->jobspec_cmd = json_incref (command);
 
-    if (job->jobspec_job) {
-        if (json_unpack_ex (job->jobspec_job, &error, 0,
-                            "{s?:s}",
-                            "name", &job->name) < 0) {
-            flux_log (ctx->h, LOG_ERR,
-                      "%s: job %ju invalid job dictionary: %s",
-                      __FUNCTION__, (uintmax_t)job->id, error.text);
-            goto nonfatal_error;
-        }
-    }
-
-    /* If user did not specify job.name, we treat arg 0 of the command
-     * as the job name */
-    if (!job->name) {
-        json_t *arg0 = json_array_get (job->jobspec_cmd, 0);
-        if (!arg0 || !json_is_string (arg0)) {
-            flux_log (ctx->h, LOG_ERR,
-                      "%s: job %ju invalid job command",
-                      __FUNCTION__, (uintmax_t)job->id);
-            goto nonfatal_error;
-        }
-        job->name = parse_job_name (json_string_value (arg0));
-        assert (job->name);
-    }
+    if (job_name_parse (ctx, job) < 0)
+        goto nonfatal_error;
 
     if (json_unpack_ex (jobspec, &error, 0,
                         "{s:o}",
@@ -1017,11 +1207,12 @@ static int depthfirst_count_depth (const char *s)
     return count;
 }
 
-static int depthfirst_map_one (struct info_ctx *ctx, const char *key,
-                               int dirskip)
+/* Read job 'id' from the KVS and add it to the index and lists.
+ * Returns 1 on success, -1 on failure with errno set.
+ */
+static int restart_job (struct info_ctx *ctx, flux_jobid_t id)
 {
     struct job *job = NULL;
-    flux_jobid_t id;
     flux_future_t *f1 = NULL;
     flux_future_t *f2 = NULL;
     flux_future_t *f3 = NULL;
@@ -1029,12 +1220,6 @@ static int depthfirst_map_one (struct info_ctx *ctx, const char *key,
     char path[64];
     int rc = -1;
 
-    if (strlen (key) <= dirskip) {
-        errno = EINVAL;
-        return -1;
-    }
-    if (fluid_decode (key + dirskip + 1, &id, FLUID_STRING_DOTHEX) < 0)
-        return -1;
     if (flux_job_kvs_key (path, sizeof (path), id, "eventlog") < 0) {
         errno = EINVAL;
         return -1;
@@ -1092,6 +1277,20 @@ done:
     return rc;
 }
 
+static int depthfirst_map_one (struct info_ctx *ctx, const char *key,
+                               int dirskip)
+{
+    flux_jobid_t id;
+
+    if (strlen (key) <= dirskip) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (fluid_decode (key + dirskip + 1, &id, FLUID_STRING_DOTHEX) < 0)
+        return -1;
+    return restart_job (ctx, id);
+}
+
 static int depthfirst_map (struct info_ctx *ctx, const char *key,
                            int dirskip)
 {
@@ -1141,6 +1340,427 @@ done:
     return rc;
 }
 
+/* Snapshot of job state, saved by job_state_checkpoint() on unload.
+ *
+ * Inactive jobs never change, so they are saved in full.  Other jobs are
+ * saved by id only, and are re-read from the KVS on restart.  The snapshot
+ * also holds the treeobj of the KVS job directory, which changes if any
+ * job data changes.  If it has changed by the next restart, the snapshot
+ * is stale and the job directory is walked as usual.
+ */
+static const char *snapshot_key = "checkpoint.job-info";
+static const int snapshot_version = 1;
+
+/* Look up the treeobj of the KVS job directory, or JSON null if it
+ * doesn't exist.  Returns a new reference, or NULL on failure.
+ */
+static json_t *jobdir_lookup (flux_t *h)
+{
+    flux_future_t *f;
+    const char *treeobj;
+    json_t *o = NULL;
+
+    if (!(f = flux_kvs_lookup (h, NULL, FLUX_KVS_TREEOBJ, "job")))
+        return NULL;
+    if (flux_kvs_lookup_get_treeobj (f, &treeobj) < 0) {
+        if (errno == ENOENT)
+            o = json_null ();
+        goto done;
+    }
+    if (!(o = json_loads (treeobj, 0, NULL)))
+        errno = EPROTO;
+done:
+    flux_future_destroy (f);
+    return o;
+}
+
+static int object_set_optional (json_t *o, const char *key, json_t *value)
+{
+    if (value && json_object_set (o, key, value) < 0)
+        return -1;
+    return 0;
+}
+
+static int object_set_optional_string (json_t *o,
+                                       const char *key,
+                                       const char *s)
+{
+    json_t *value;
+
+    if (!s)
+        return 0;
+    if (!(value = json_string (s))
+        || json_object_set_new (o, key, value) < 0) {
+        json_decref (value);
+        return -1;
+    }
+    return 0;
+}
+
+static json_t *inactive_job_encode (struct job *job)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:I s:i s:i s:I s:f s:i s:i s:i s:f s:i s:b s:i"
+                         " s:i s:f s:f s:f}",
+                         "id", job->id,
+                         "userid", job->userid,
+                         "urgency", job->urgency,
+                         "priority", job->priority,
+                         "t_submit", job->t_submit,
+                         "flags", job->flags,
+                         "ntasks", job->ntasks,
+                         "nnodes", job->nnodes,
+                         "expiration", job->expiration,
+                         "wait_status", job->wait_status,
+                         "success", job->success,
+                         "eventlog_seq", job->eventlog_seq,
+                         "states_mask", job->states_mask,
+                         "t_run", job->t_run,
+                         "t_cleanup", job->t_cleanup,
+                         "t_inactive", job->t_inactive)))
+        goto nomem;
+    if (object_set_optional_string (o, "ranks", job->ranks) < 0
+        || object_set_optional_string (o, "nodelist", job->nodelist) < 0
+        || object_set_optional (o, "exception", job->exception_context) < 0
+        || object_set_optional (o, "annotations", job->annotations) < 0
+        || object_set_optional (o, "jobspec_job", job->jobspec_job) < 0
+        || object_set_optional (o, "jobspec_cmd", job->jobspec_cmd) < 0
+        || object_set_optional (o, "R", job->R) < 0)
+        goto nomem;
+    return o;
+nomem:
+    json_decref (o);
+    errno = ENOMEM;
+    return NULL;
+}
+
+static struct job *inactive_job_decode (struct info_ctx *ctx, json_t *o)
+{
+    struct job *job;
+    flux_jobid_t id;
+    double t_inactive;
+    int success;
+    const char *ranks = NULL;
+    const char *nodelist = NULL;
+    json_t *exception = NULL;
+    json_t *annotations = NULL;
+    json_t *jobspec_job = NULL;
+    json_t *jobspec_cmd = NULL;
+    json_t *R = NULL;
+
+    if (json_unpack (o, "{s:I}", "id", &id) < 0
+        || !(job = job_create (ctx, id))) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (json_unpack (o,
+                     "{s:i s:i s:I s:f s:i s:i s:i s:f s:i s:b s:i"
+                     " s:i s:f s:f s:f"
+                     " s?:s s?:s s?:o s?:o s?:o s?:o s?:o}",
+                     "userid", &job->userid,
+                     "urgency", &job->urgency,
+                     "priority", &job->priority,
+                     "t_submit", &job->t_submit,
+                     "flags", &job->flags,
+                     "ntasks", &job->ntasks,
+                     "nnodes", &job->nnodes,
+                     "expiration", &job->expiration,
+                     "wait_status", &job->wait_status,
+                     "success", &success,
+                     "eventlog_seq", &job->eventlog_seq,
+                     "states_mask", &job->states_mask,
+                     "t_run", &job->t_run,
+                     "t_cleanup", &job->t_cleanup,
+                     "t_inactive", &t_inactive,
+                     "ranks", &ranks,
+                     "nodelist", &nodelist,
+                     "exception", &exception,
+                     "annotations", &annotations,
+                     "jobspec_job", &jobspec_job,
+                     "jobspec_cmd", &jobspec_cmd,
+                     "R", &R) < 0)
+        goto inval;
+    job->success = success ? true : false;
+    if ((ranks && !(job->ranks = strdup (ranks)))
+        || (nodelist && !(job->nodelist = strdup (nodelist))))
+        goto error;
+    if (exception) {
+        if (exception_context_parse (ctx->h, job, exception, NULL) < 0)
+            goto error;
+    }
+    job->annotations = json_incref (annotations);
+    job->jobspec_job = json_incref (jobspec_job);
+    job->jobspec_cmd = json_incref (jobspec_cmd);
+    job->R = json_incref (R);
+    if (job->jobspec_cmd)
+        (void)job_name_parse (ctx, job);
+    eventlog_inactive_complete (ctx, job);
+    update_job_state (ctx, job, FLUX_JOB_STATE_INACTIVE, t_inactive);
+    return job;
+inval:
+    errno = EPROTO;
+error:
+    job_destroy (job);
+    return NULL;
+}
+
+static int array_append_id (json_t *a, flux_jobid_t id)
+{
+    json_t *o;
+
+    if (!(o = json_integer (id)) || json_array_append_new (a, o) < 0) {
+        json_decref (o);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+static int array_append_list_ids (json_t *a, zlistx_t *l)
+{
+    struct job *job;
+
+    job = zlistx_first (l);
+    while (job) {
+        if (array_append_id (a, job->id) < 0)
+            return -1;
+        job = zlistx_next (l);
+    }
+    return 0;
+}
+
+static json_t *snapshot_create (struct job_state_ctx *jsctx)
+{
+    json_t *jobdir = NULL;
+    json_t *active = NULL;
+    json_t *inactive = NULL;
+    json_t *snapshot;
+    struct job *job;
+
+    if (!(jobdir = jobdir_lookup (jsctx->h)))
+        return NULL;
+    if (!(active = json_array ())
+        || !(inactive = json_array ()))
+        goto nomem;
+    if (array_append_list_ids (active, jsctx->pending) < 0
+        || array_append_list_ids (active, jsctx->running) < 0)
+        goto error;
+    job = zlistx_first (jsctx->inactive);
+    while (job) {
+        json_t *o;
+        if (!(o = inactive_job_encode (job))
+            || json_array_append_new (inactive, o) < 0) {
+            json_decref (o);
+            goto nomem;
+        }
+        job = zlistx_next (jsctx->inactive);
+    }
+    if (!(snapshot = json_pack ("{s:i s:o s:o s:o}",
+                                "version", snapshot_version,
+                                "jobdir", jobdir,
+                                "active", active,
+                                "inactive", inactive)))
+        goto nomem;
+    return snapshot;
+nomem:
+    errno = ENOMEM;
+error:
+    json_decref (jobdir);
+    json_decref (active);
+    json_decref (inactive);
+    return NULL;
+}
+
+/* Save a snapshot of job state to the KVS for the next restart.
+ * The snapshot is skipped if jobs are still being processed.
+ */
+int job_state_checkpoint (struct info_ctx *ctx)
+{
+    struct job_state_ctx *jsctx = ctx->jsctx;
+    json_t *snapshot = NULL;
+    flux_kvs_txn_t *txn = NULL;
+    flux_future_t *f = NULL;
+    int rc = -1;
+
+    if (zlistx_size (jsctx->processing) > 0
+        || zlistx_size (jsctx->futures) > 0
+        || zlistx_size (jsctx->events_journal_backlog) > 0) {
+        flux_log (ctx->h, LOG_DEBUG, "%s: jobs in progress, skipping",
+                  __FUNCTION__);
+        return 0;
+    }
+    if (!(snapshot = snapshot_create (jsctx))
+        || !(txn = flux_kvs_txn_create ())
+        || flux_kvs_txn_pack (txn, 0, snapshot_key, "O", snapshot) < 0
+        || !(f = flux_kvs_commit (ctx->h, NULL, 0, txn))
+        || flux_future_get (f, NULL) < 0) {
+        flux_log_error (ctx->h, "%s: error saving %s",
+                        __FUNCTION__, snapshot_key);
+        goto done;
+    }
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+    json_decref (snapshot);
+    return rc;
+}
+
+/* Drop all jobs, e.g. after a partially loaded snapshot.
+ */
+static void job_state_clear (struct job_state_ctx *jsctx)
+{
+    int i;
+
+    zhashx_purge (jsctx->users);
+    for (i = 0; i < JOB_RESULT_COUNT; i++)
+        zlistx_purge (jsctx->inactive_result[i]);
+    zlistx_purge (jsctx->pending);
+    zlistx_purge (jsctx->running);
+    zlistx_purge (jsctx->inactive);
+    zhashx_purge (jsctx->index);
+    memset (&jsctx->stats, 0, sizeof (jsctx->stats));
+}
+
+/* Add active job ids from the job-manager checkpoint, in case the
+ * job-manager accepted jobs that had not yet reached job-info when
+ * the snapshot was taken.
+ */
+static int restart_job_manager_active (struct info_ctx *ctx)
+{
+    flux_future_t *f;
+    json_t *active = NULL;
+    size_t index;
+    json_t *value;
+    int count = 0;
+    int rc = -1;
+
+    if (!(f = flux_kvs_lookup (ctx->h, NULL, 0, "checkpoint.job-manager")))
+        return -1;
+    if (flux_kvs_lookup_get_unpack (f,
+                                    "{s?:{s?:o}}",
+                                    "snapshot",
+                                    "active", &active) < 0) {
+        if (errno == ENOENT)
+            rc = 0;
+        goto done;
+    }
+    if (active) {
+        json_array_foreach (active, index, value) {
+            flux_jobid_t id = json_integer_value (value);
+            if (zhashx_lookup (ctx->jsctx->index, &id))
+                continue;
+            if (restart_job (ctx, id) < 0)
+                goto done;
+            count++;
+        }
+    }
+    rc = count;
+done:
+    flux_future_destroy (f);
+    return rc;
+}
+
+/* Load jobs from the snapshot saved by job_state_checkpoint().
+ * Returns the number of jobs loaded, or -1 on failure with errno set.
+ * If the snapshot is missing or stale, errno is set to ESTALE and no
+ * jobs are loaded.
+ */
+static int restart_from_snapshot (struct info_ctx *ctx)
+{
+    struct job_state_ctx *jsctx = ctx->jsctx;
+    flux_future_t *f;
+    int version;
+    json_t *jobdir;
+    json_t *active;
+    json_t *inactive;
+    json_t *cur = NULL;
+    size_t index;
+    json_t *value;
+    int count = 0;
+    int n;
+
+    if (!(f = flux_kvs_lookup (ctx->h, NULL, 0, snapshot_key)))
+        return -1;
+    if (flux_kvs_lookup_get_unpack (f,
+                                    "{s:i s:o s:o s:o}",
+                                    "version", &version,
+                                    "jobdir", &jobdir,
+                                    "active", &active,
+                                    "inactive", &inactive) < 0
+        || version != snapshot_version
+        || !json_is_array (active)
+        || !json_is_array (inactive)
+        || !(cur = jobdir_lookup (ctx->h))
+        || !json_equal (cur, jobdir))
+        goto stale;
+    json_array_foreach (inactive, index, value) {
+        struct job *job;
+        if (!(job = inactive_job_decode (ctx, value)))
+            goto stale;
+        if (zhashx_insert (jsctx->index, &job->id, job) < 0) {
+            job_destroy (job);
+            goto stale;
+        }
+        job_insert_list (jsctx, job, job->state);
+        count++;
+    }
+    json_array_foreach (active, index, value) {
+        if (restart_job (ctx, json_integer_value (value)) < 0)
+            goto stale;
+        count++;
+    }
+    if ((n = restart_job_manager_active (ctx)) < 0)
+        goto stale;
+    count += n;
+    json_decref (cur);
+    flux_future_destroy (f);
+    return count;
+stale:
+    job_state_clear (jsctx);
+    json_decref (cur);
+    flux_future_destroy (f);
+    errno = ESTALE;
+    return -1;
+}
+
+/* Re-add the jobs of main list 'list' to the secondary indices.
+ * The list is walked backwards, since job_index_insert() adds
+ * running and inactive jobs to the head of their lists.
+ */
+static void job_list_reindex (struct job_state_ctx *jsctx,
+                              zlistx_t *list)
+{
+    struct job *job;
+
+    job = zlistx_last (list);
+    while (job) {
+        job->list_handle = zlistx_cursor (list);
+        job_index_insert (jsctx, job, job->state);
+        job = zlistx_prev (list);
+    }
+}
+
+/* Sort the running and inactive lists after restart, then rebuild the
+ * secondary indices in the new order.  N.B. zlistx_sort() swaps items
+ * between list nodes, so list handles are refreshed too.
+ */
+static void job_state_sort (struct job_state_ctx *jsctx)
+{
+    int i;
+
+    zlistx_sort (jsctx->running);
+    zlistx_sort (jsctx->inactive);
+
+    zhashx_purge (jsctx->users);
+    for (i = 0; i < JOB_RESULT_COUNT; i++)
+        zlistx_purge (jsctx->inactive_result[i]);
+    job_list_reindex (jsctx, jsctx->pending);
+    job_list_reindex (jsctx, jsctx->running);
+    job_list_reindex (jsctx, jsctx->inactive);
+}
+
 /* Read jobs present in the KVS at startup. */
 int job_state_init_from_kvs (struct info_ctx *ctx)
 {
@@ -1148,13 +1768,16 @@ int job_state_init_from_kvs (struct info_ctx *ctx)
     int dirskip = strlen (dirname);
     int count;
 
-    count = depthfirst_map (ctx, dirname, dirskip);
-    if (count < 0)
-        return -1;
+    if ((count = restart_from_snapshot (ctx)) < 0) {
+        if (errno != ESTALE)
+            return -1;
+        count = depthfirst_map (ctx, dirname, dirskip);
+        if (count < 0)
+            return -1;
+    }
     flux_log (ctx->h, LOG_DEBUG, "%s: read %d jobs", __FUNCTION__, count);
 
-    zlistx_sort (ctx->jsctx->running);
-    zlistx_sort (ctx->jsctx->inactive);
+    job_state_sort (ctx->jsctx);
     return 0;
 }
 
@@ -1357,9 +1980,7 @@ static int journal_priority_event (struct job_state_ctx *jsctx,
 
     if (job->state & FLUX_JOB_STATE_PENDING
         && job->priority != orig_priority)
-        zlistx_reorder (jsctx->pending,
-                        job->list_handle,
-                        search_direction (job));
+        job_pending_reorder (jsctx, job);
 
     return job_transition_state (jsctx,
                                  job,
@@ -1737,6 +2358,7 @@ struct job_state_ctx *job_state_create (struct info_ctx *ctx)
 {
     struct job_state_ctx *jsctx = NULL;
     int saved_errno;
+    int i;
 
     if (!(jsctx = calloc (1, sizeof (*jsctx)))) {
         flux_log_error (ctx->h, "calloc");
@@ -1769,6 +2391,21 @@ struct job_state_ctx *job_state_create (struct info_ctx *ctx)
     if (!(jsctx->processing = zlistx_new ()))
         goto error;
 
+    if (!(jsctx->users = zhashx_new ()))
+        goto error;
+    zhashx_set_key_hasher (jsctx->users, userid_hasher);
+    zhashx_set_key_comparator (jsctx->users, userid_cmp);
+    zhashx_set_key_duplicator (jsctx->users, NULL);
+    zhashx_set_key_destructor (jsctx->users, NULL);
+    zhashx_set_destructor (jsctx->users, user_jobs_destroy_wrapper);
+
+    for (i = 0; i < JOB_RESULT_COUNT; i++) {
+        if (!(jsctx->inactive_result[i] = zlistx_new ()))
+            goto error;
+        zlistx_set_comparator (jsctx->inactive_result[i],
+                               job_inactive_cmp);
+    }
+
     if (!(jsctx->futures = zlistx_new ()))
         goto error;
 
@@ -1807,6 +2444,7 @@ void job_state_destroy (void *data)
 {
     struct job_state_ctx *jsctx = data;
     if (jsctx) {
+        int i;
         /* Don't destroy processing until futures are complete */
         if (jsctx->futures) {
             flux_future_t *f;
@@ -1822,6 +2460,9 @@ void job_state_destroy (void *data)
         }
         /* Destroy index last, as it is the one that will actually
          * destroy the job objects */
+        zhashx_destroy (&jsctx->users);
+        for (i = 0; i < JOB_RESULT_COUNT; i++)
+            zlistx_destroy (&jsctx->inactive_result[i]);
         zlistx_destroy (&jsctx->processing);
         zlistx_destroy (&jsctx->inactive);
         zlistx_destroy (&jsctx->running);
@@ -34,8 +34,27 @@
  * cannot yet be stored on one of the lists above.
  *
  * The list `futures` is used to store in process futures.
+ *
+ * Secondary indices allow filtered list requests to skip jobs that
+ * cannot match.  Their lists are kept in the same order as the lists
+ * above.
+ *
+ * - users - hash of userid to struct user_jobs, the pending, running,
+ *   and inactive jobs of each user.
+ * - inactive_result - inactive jobs, one list per job result, in the
+ *   order of the flux_job_result_t bits.
  */
 
+#define JOB_RESULT_COUNT 4
+#define JOB_RESULT_ALL ((1 << JOB_RESULT_COUNT) - 1)
+
+struct user_jobs {
+    uint32_t userid;
+    zlistx_t *pending;
+    zlistx_t *running;
+    zlistx_t *inactive;
+};
+
 struct job_state_ctx {
     flux_t *h;
     struct info_ctx *ctx;
@@ -45,6 +64,8 @@ struct job_state_ctx {
     zlistx_t *inactive;
     zlistx_t *processing;
     zlistx_t *futures;
+    zhashx_t *users;
+    zlistx_t *inactive_result[JOB_RESULT_COUNT];
 
     /*  Job statistics: */
     struct job_stats stats;
@@ -106,6 +127,7 @@ struct job {
     unsigned int states_mask;
     unsigned int states_events_mask;
     void *list_handle;
+    void *user_list_handle;
 
     /* timestamp of when we enter the state
      *
@@ -137,6 +159,11 @@ void job_state_unpause_cb (flux_t *h, flux_msg_handler_t *mh,
 
 int job_state_init_from_kvs (struct info_ctx *ctx);
 
+/* Save a snapshot of job state to the KVS, so that the next
+ * job_state_init_from_kvs() can avoid walking the job directory.
+ */
+int job_state_checkpoint (struct info_ctx *ctx);
+
 #endif /* ! _FLUX_JOB_INFO_JOB_STATE_H */
 
 /*
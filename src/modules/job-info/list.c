@@ -44,6 +44,29 @@ bool job_filter (struct job *job, uint32_t userid, int states, int results)
     return true;
 }
 
+/* Put job onto jobs array.  Returns 1 if jobs array is full, 0 if
+ * continue, -1 on error with errno set.
+ */
+static int get_jobs_append (json_t *jobs,
+                            job_info_error_t *errp,
+                            struct job *job,
+                            int max_entries,
+                            json_t *attrs)
+{
+    json_t *o;
+
+    if (!(o = job_to_json (job, attrs, errp)))
+        return -1;
+    if (json_array_append_new (jobs, o) < 0) {
+        json_decref (o);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (json_array_size (jobs) == max_entries)
+        return 1;
+    return 0;
+}
+
 /* Put jobs from list onto jobs array, breaking if max_entries has
  * been reached. Returns 1 if jobs array is full, 0 if continue, -1
  * one error with errno set:
@@ -60,20 +83,17 @@ int get_jobs_from_list (json_t *jobs,
                         int results)
 {
     struct job *job;
+    int ret;
 
     job = zlistx_first (list);
     while (job) {
         if (job_filter (job, userid, states, results)) {
-            json_t *o;
-            if (!(o = job_to_json (job, attrs, errp)))
-                return -1;
-            if (json_array_append_new (jobs, o) < 0) {
-                json_decref (o);
-                errno = ENOMEM;
-                return -1;
-            }
-            if (json_array_size (jobs) == max_entries)
-                return 1;
+            if ((ret = get_jobs_append (jobs,
+                                        errp,
+                                        job,
+                                        max_entries,
+                                        attrs)) != 0)
+                return ret;
         }
         job = zlistx_next (list);
     }
@@ -81,6 +101,45 @@ int get_jobs_from_list (json_t *jobs,
     return 0;
 }
 
+/* Put inactive jobs with one of 'results' onto jobs array, merging
+ * the per-result lists so that jobs are returned in the same order as
+ * the inactive list.  Returns as get_jobs_from_list().
+ */
+static int get_jobs_from_results (json_t *jobs,
+                                  job_info_error_t *errp,
+                                  struct job_state_ctx *jsctx,
+                                  int max_entries,
+                                  json_t *attrs,
+                                  int results)
+{
+    struct job *next[JOB_RESULT_COUNT] = { NULL };
+    int i, ret;
+
+    for (i = 0; i < JOB_RESULT_COUNT; i++) {
+        if (results & (1 << i))
+            next[i] = zlistx_first (jsctx->inactive_result[i]);
+    }
+    while (1) {
+        int n = -1;
+        for (i = 0; i < JOB_RESULT_COUNT; i++) {
+            if (next[i]
+                && (n < 0 || next[i]->t_inactive > next[n]->t_inactive))
+                n = i;
+        }
+        if (n < 0)
+            break;
+        if ((ret = get_jobs_append (jobs,
+                                    errp,
+                                    next[n],
+                                    max_entries,
+                                    attrs)) != 0)
+            return ret;
+        next[n] = zlistx_next (jsctx->inactive_result[n]);
+    }
+
+    return 0;
+}
+
 /* Create a JSON array of 'job' objects.  'max_entries' determines the
  * max number of jobs to return, 0=unlimited.  Returns JSON object
  * which the caller must free.  On error, return NULL with errno set:
@@ -96,6 +155,10 @@ json_t *get_jobs (struct info_ctx *ctx,
                   int states,
                   int results)
 {
+    struct job_state_ctx *jsctx = ctx->jsctx;
+    zlistx_t *pending = jsctx->pending;
+    zlistx_t *running = jsctx->running;
+    zlistx_t *inactive = jsctx->inactive;
     json_t *jobs = NULL;
     int saved_errno;
     int ret = 0;
@@ -103,13 +166,26 @@ json_t *get_jobs (struct info_ctx *ctx,
     if (!(jobs = json_array ()))
         goto error_nomem;
 
+    /* Use the secondary indices to skip jobs that cannot match.
+     */
+    if (userid != FLUX_USERID_UNKNOWN) {
+        struct user_jobs *uj;
+        if (!(uj = zhashx_lookup (jsctx->users, &userid)))
+            return jobs;
+        pending = uj->pending;
+        running = uj->running;
+        inactive = uj->inactive;
+    }
+    else if ((results & JOB_RESULT_ALL) != JOB_RESULT_ALL)
+        inactive = NULL;
+
     /* We return jobs in the following order, pending, running,
      * inactive */
 
     if (states & FLUX_JOB_STATE_PENDING) {
         if ((ret = get_jobs_from_list (jobs,
                                        errp,
-                                       ctx->jsctx->pending,
+                                       pending,
                                        max_entries,
                                        attrs,
                                        userid,
@@ -122,7 +198,7 @@ json_t *get_jobs (struct info_ctx *ctx,
         if (!ret) {
             if ((ret = get_jobs_from_list (jobs,
                                            errp,
-                                           ctx->jsctx->running,
+                                           running,
                                            max_entries,
                                            attrs,
                                            userid,
@@ -133,10 +209,10 @@ json_t *get_jobs (struct info_ctx *ctx,
     }
 
     if (states & FLUX_JOB_STATE_INACTIVE) {
-        if (!ret) {
+        if (!ret && inactive) {
             if ((ret = get_jobs_from_list (jobs,
                                            errp,
-                                           ctx->jsctx->inactive,
+                                           inactive,
                                            max_entries,
                                            attrs,
                                            userid,
@@ -144,6 +220,15 @@ json_t *get_jobs (struct info_ctx *ctx,
                                            results)) < 0)
                 goto error;
         }
+        else if (!ret) {
+            if ((ret = get_jobs_from_results (jobs,
+                                              errp,
+                                              jsctx,
+                                              max_entries,
+                                              attrs,
+                                              results)) < 0)
+                goto error;
+        }
     }
 
     return jobs;
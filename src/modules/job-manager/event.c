@@ -30,7 +30,8 @@
  * Notes:
  * - A KVS commit failure is handled as fatal to the job-manager
  * - event_job_action() is idempotent
- * - event_ctx_destroy() flushes batched eventlog updates before returning
+ * - event_flush() and event_ctx_destroy() flush batched eventlog updates
+ *   before returning
  */
 
 #if HAVE_CONFIG_H
@@ -699,18 +700,16 @@ error:
 
 /* Finalizes in-flight batch KVS commits and event pubs (synchronously).
  */
-void event_ctx_destroy (struct event *event)
+void event_flush (struct event *event)
 {
     if (event) {
         int saved_errno = errno;
-        flux_watcher_destroy (event->timer);
         event_batch_commit (event);
         if (event->pending) {
             struct event_batch *batch;
             while ((batch = zlist_pop (event->pending)))
                 event_batch_destroy (batch); // N.B. can append to pub_futures
         }
-        zlist_destroy (&event->pending);
         if (event->pub_futures) {
             flux_future_t *f;
             while ((f = zlist_pop (event->pub_futures))) {
@@ -720,6 +719,17 @@ void event_ctx_destroy (struct event *event)
                 flux_future_destroy (f);
             }
         }
+        errno = saved_errno;
+    }
+}
+
+void event_ctx_destroy (struct event *event)
+{
+    if (event) {
+        int saved_errno = errno;
+        flux_watcher_destroy (event->timer);
+        event_flush (event);
+        zlist_destroy (&event->pending);
         zlist_destroy (&event->pub_futures);
         free (event);
         errno = saved_errno;
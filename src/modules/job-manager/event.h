@@ -56,6 +56,11 @@ int event_job_post_pack (struct event *event,
                          const char *context_fmt,
                          ...);
 
+/* Commit any batched eventlog updates and wait for in-flight commits
+ * and event publishes to complete.
+ */
+void event_flush (struct event *event);
+
 void event_ctx_destroy (struct event *event);
 struct event *event_ctx_create (struct job_manager *ctx);
 
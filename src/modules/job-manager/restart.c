@@ -8,7 +8,14 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* restart - reload active jobs from the KVS */
+/* restart - reload active jobs from the KVS
+ *
+ * On shutdown, checkpoint_to_kvs() saves a snapshot of the active job ids
+ * along with the treeobj of the KVS job directory.  Since any change to
+ * job data in the KVS changes that treeobj, if it is unchanged at restart,
+ * only the active jobs need to be reloaded.  Otherwise the snapshot is
+ * stale, and the entire job directory is walked.
+ */
 
 #if HAVE_CONFIG_H
 #include "config.h"
@@ -17,6 +24,7 @@
 #include <argz.h>
 #include <envz.h>
 #include <flux/core.h>
+#include <jansson.h>
 
 #include "src/common/libutil/fluid.h"
 
@@ -32,6 +40,7 @@
 typedef int (*restart_map_f)(struct job *job, void *arg);
 
 const char *checkpoint_key = "checkpoint.job-manager";
+static const int snapshot_version = 1;
 
 int restart_count_char (const char *s, char c)
 {
@@ -158,20 +167,85 @@ static int restart_map_cb (struct job *job, void *arg)
     return 0;
 }
 
+/* Look up the treeobj of the KVS job directory, or JSON null if it
+ * doesn't exist.  Returns a new reference, or NULL on failure.
+ */
+static json_t *jobdir_lookup (flux_t *h)
+{
+    flux_future_t *f;
+    const char *treeobj;
+    json_t *o = NULL;
+
+    if (!(f = flux_kvs_lookup (h, NULL, FLUX_KVS_TREEOBJ, "job")))
+        return NULL;
+    if (flux_kvs_lookup_get_treeobj (f, &treeobj) < 0) {
+        if (errno == ENOENT)
+            o = json_null ();
+        goto done;
+    }
+    if (!(o = json_loads (treeobj, 0, NULL)))
+        errno = EPROTO;
+done:
+    flux_future_destroy (f);
+    return o;
+}
+
+/* Create a snapshot of the active job ids and the job directory treeobj.
+ * Eventlog updates must have been flushed so the treeobj reflects them.
+ */
+static json_t *snapshot_create (struct job_manager *ctx)
+{
+    json_t *jobdir;
+    json_t *active;
+    json_t *snapshot;
+    struct job *job;
+
+    if (!(jobdir = jobdir_lookup (ctx->h)))
+        return NULL;
+    if (!(active = json_array ()))
+        goto nomem;
+    job = zhashx_first (ctx->active_jobs);
+    while (job) {
+        json_t *id;
+        if (!(id = json_integer (job->id))
+            || json_array_append_new (active, id) < 0) {
+            json_decref (id);
+            goto nomem;
+        }
+        job = zhashx_next (ctx->active_jobs);
+    }
+    if (!(snapshot = json_pack ("{s:i s:o s:o}",
+                                "version", snapshot_version,
+                                "jobdir", jobdir,
+                                "active", active)))
+        goto nomem;
+    return snapshot;
+nomem:
+    json_decref (jobdir);
+    json_decref (active);
+    errno = ENOMEM;
+    return NULL;
+}
+
 static int checkpoint_save (struct job_manager *ctx)
 {
     flux_future_t *f = NULL;
     flux_kvs_txn_t *txn;
+    json_t *snapshot;
     int rc = -1;
 
-    if (!(txn = flux_kvs_txn_create ()))
+    if (!(snapshot = snapshot_create (ctx)))
         return -1;
+    if (!(txn = flux_kvs_txn_create ()))
+        goto done;
     if (flux_kvs_txn_pack (txn,
                            0,
                            checkpoint_key,
-                           "{s:I}",
+                           "{s:I s:O}",
                            "max_jobid",
-                           ctx->max_jobid) < 0)
+                           ctx->max_jobid,
+                           "snapshot",
+                           snapshot) < 0)
         goto done;
     if (!(f = flux_kvs_commit (ctx->h, NULL, 0, txn)))
         goto done;
@@ -181,38 +255,141 @@ static int checkpoint_save (struct job_manager *ctx)
 done:
     flux_future_destroy (f);
     flux_kvs_txn_destroy (txn);
+    json_decref (snapshot);
     return rc;
 }
 
-static int checkpoint_restore (struct job_manager *ctx)
+/* Restore misc state from the checkpoint object.  If it contains a
+ * snapshot, assign a new reference to it to 'snapshot'.
+ */
+static int checkpoint_restore (struct job_manager *ctx, json_t **snapshot)
 {
     flux_future_t *f;
+    json_t *o = NULL;
 
     if (!(f = flux_kvs_lookup (ctx->h, NULL, 0, checkpoint_key)))
         return -1;
     if (flux_kvs_lookup_get_unpack (f,
-                                    "{s:I}",
+                                    "{s:I s?:o}",
                                     "max_jobid",
-                                    &ctx->max_jobid) < 0) {
+                                    &ctx->max_jobid,
+                                    "snapshot",
+                                    &o) < 0) {
         flux_future_destroy (f);
         return -1;
     }
+    *snapshot = json_incref (o);
     flux_future_destroy (f);
     return 0;
 }
 
+/* Reload the active jobs listed in 'snapshot'.  All jobs are looked up
+ * before any are enqueued, so if the snapshot turns out to be unusable,
+ * -1 is returned with errno set to ESTALE and nothing has been loaded.
+ * Otherwise, the number of jobs loaded is returned.
+ */
+static int restart_from_snapshot (struct job_manager *ctx, json_t *snapshot)
+{
+    int version;
+    json_t *jobdir;
+    json_t *active;
+    json_t *cur;
+    zlist_t *jobs;
+    struct job *job;
+    size_t index;
+    json_t *value;
+    int count = 0;
+    int rc = -1;
+
+    if (json_unpack (snapshot,
+                     "{s:i s:o s:o}",
+                     "version", &version,
+                     "jobdir", &jobdir,
+                     "active", &active) < 0
+        || version != snapshot_version
+        || !json_is_array (active)) {
+        errno = ESTALE;
+        return -1;
+    }
+    if (!(cur = jobdir_lookup (ctx->h)))
+        return -1;
+    if (!json_equal (cur, jobdir)) {
+        json_decref (cur);
+        errno = ESTALE;
+        return -1;
+    }
+    json_decref (cur);
+    if (!(jobs = zlist_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    json_array_foreach (active, index, value) {
+        if (!json_is_integer (value)
+            || !(job = lookup_job (ctx->h, json_integer_value (value)))) {
+            errno = ESTALE;
+            goto done;
+        }
+        if (zlist_append (jobs, job) < 0) {
+            job_decref (job);
+            errno = ENOMEM;
+            goto done;
+        }
+    }
+    while ((job = zlist_pop (jobs))) {
+        int n = restart_map_cb (job, ctx);
+        job_decref (job);
+        if (n < 0)
+            goto done;
+        count++;
+    }
+    rc = count;
+done:
+    while ((job = zlist_pop (jobs)))
+        job_decref (job);
+    zlist_destroy (&jobs);
+    return rc;
+}
+
 int restart_from_kvs (struct job_manager *ctx)
 {
     const char *dirname = "job";
     int dirskip = strlen (dirname);
-    int count;
+    int count = -1;
     struct job *job;
+    json_t *snapshot = NULL;
 
-    /* Load any active jobs present in the KVS at startup.
+    /* Restore misc state.
      */
-    count = depthfirst_map (ctx->h, dirname, dirskip, restart_map_cb, ctx);
-    if (count < 0)
-        return -1;
+    if (checkpoint_restore (ctx, &snapshot) < 0) {
+        if (errno != ENOENT) {
+            flux_log_error (ctx->h, "restart: %s", checkpoint_key);
+            return -1;
+        }
+        flux_log (ctx->h, LOG_INFO, "restart: no checkpoint object");
+    }
+    flux_log (ctx->h,
+              LOG_DEBUG,
+              "restart: max_jobid=%ju",
+              (uintmax_t)ctx->max_jobid);
+
+    /* Load any active jobs present in the KVS at startup, from the
+     * checkpoint snapshot if it is still valid, otherwise by walking
+     * the job directory.
+     */
+    if (snapshot) {
+        count = restart_from_snapshot (ctx, snapshot);
+        json_decref (snapshot);
+        if (count < 0) {
+            if (errno != ESTALE)
+                return -1;
+            flux_log (ctx->h, LOG_INFO, "restart: snapshot is stale");
+        }
+    }
+    if (count < 0) {
+        count = depthfirst_map (ctx->h, dirname, dirskip, restart_map_cb, ctx);
+        if (count < 0)
+            return -1;
+    }
     flux_log (ctx->h, LOG_INFO, "restart: %d jobs", count);
     /* Post flux-restart to any jobs in SCHED state, so they may
      * transition back to PRIORITY and re-obtain the priority.
@@ -259,25 +436,15 @@ int restart_from_kvs (struct job_manager *ctx)
         job = zhashx_next (ctx->active_jobs);
     }
     flux_log (ctx->h, LOG_INFO, "restart: %d running jobs", ctx->running_jobs);
-
-    /* Restore misc state.
-     */
-    if (checkpoint_restore (ctx) < 0) {
-        if (errno != ENOENT) {
-            flux_log_error (ctx->h, "restart: %s", checkpoint_key);
-            return -1;
-        }
-        flux_log (ctx->h, LOG_INFO, "restart: no checkpoint object");
-    }
-    flux_log (ctx->h,
-              LOG_DEBUG,
-              "restart: max_jobid=%ju",
-              (uintmax_t)ctx->max_jobid);
     return 0;
 }
 
 int checkpoint_to_kvs (struct job_manager *ctx)
 {
+    /* Ensure the job directory treeobj in the snapshot reflects
+     * all eventlog updates.
+     */
+    event_flush (ctx->event);
     if (checkpoint_save (ctx) < 0) {
         flux_log_error (ctx->h, "checkpoint");
         return -1;
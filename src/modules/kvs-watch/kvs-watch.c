@@ -20,6 +20,7 @@
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libkvs/kvs_util_private.h"
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/errno_safe.h"
 
 /* State for one watcher */
 struct watcher {
@@ -40,6 +41,19 @@ struct watcher {
     struct ns_monitor *nsm;     // back pointer for removal
     json_t *prev;               // previous watch value for KVS_WATCH_FULL/UNIQ
     int append_offset;          // offset for KVS_WATCH_APPEND
+    int append_blobs;           // valref blobrefs sent for KVS_WATCH_APPEND
+    char *append_lastref;       // last of those blobrefs
+    bool append_follow;         // key is a symlink, look up full values
+};
+
+/* Content load of newly appended blobrefs for KVS_WATCH_APPEND.
+ * Attached to the load future, which is queued on w->lookups.
+ */
+struct append_load {
+    int count;                  // number of blobrefs loaded
+    int base;                   // value offset of first loaded blob
+    int nblobs;                 // valref blobref count
+    char *lastref;              // last valref blobref
 };
 
 /* Current KVS root.
@@ -66,6 +80,21 @@ struct ns_monitor {
     char *topic;                // topic string for subscription
     bool subscribed;            // subscription active
     flux_future_t *getrootf;    // initial getroot future
+    zhash_t *lookups;           // shared lookups in flight, by id
+};
+
+/* A lookup RPC shared by all watchers of one key at one root sequence
+ * with the same lookup flags and credentials.  Each watcher queues its
+ * own future, which is fulfilled with the RPC response.  The waiters
+ * list does not hold a reference on those futures.  Instead each has
+ * the shared lookup in its "shared" aux item, so a watcher destroyed
+ * early can take its future off the list, see shared_lookup_leave().
+ */
+struct shared_lookup {
+    char *id;                   // hash key for nsm->lookups
+    flux_future_t *f;           // lookup RPC future
+    zlist_t *waiters;           // watcher futures to fulfill
+    struct ns_monitor *nsm;     // back pointer for removal
 };
 
 /* Module state.
@@ -74,8 +103,23 @@ struct watch_ctx {
     flux_t *h;
     flux_msg_handler_t **handlers;
     zhash_t *namespaces;        // hash of monitored namespaces
+    int lookups_shared;         // lookups that joined a shared lookup
+    int append_blobs_loaded;    // blobs loaded for append watchers
 };
 
+/* Remove watcher future 'f' from the waiters of its shared lookup,
+ * if any, so it is not fulfilled after being destroyed.
+ */
+static void shared_lookup_leave (flux_future_t *f)
+{
+    struct shared_lookup *sl;
+
+    if ((sl = flux_future_aux_get (f, "shared"))) {
+        zlist_remove (sl->waiters, f);
+        (void)flux_future_aux_set (f, "shared", NULL, NULL);
+    }
+}
+
 static void watcher_destroy (struct watcher *w)
 {
     if (w) {
@@ -84,11 +128,14 @@ static void watcher_destroy (struct watcher *w)
         free (w->key);
         if (w->lookups) {
             flux_future_t *f;
-            while ((f = zlist_pop (w->lookups)))
+            while ((f = zlist_pop (w->lookups))) {
+                shared_lookup_leave (f);
                 flux_future_destroy (f);
+            }
             zlist_destroy (&w->lookups);
         }
         json_decref (w->prev);
+        free (w->append_lastref);
         free (w);
         errno = saved_errno;
     }
@@ -162,6 +209,7 @@ static void namespace_destroy (struct ns_monitor *nsm)
         free (nsm->topic);
         free (nsm->ns_name);
         flux_future_destroy (nsm->getrootf);
+        zhash_destroy (&nsm->lookups);
         free (nsm);
         errno = saved_errno;
     }
@@ -175,6 +223,8 @@ static struct ns_monitor *namespace_create (struct watch_ctx *ctx,
         return NULL;
     if (!(nsm->watchers = zlist_new ()))
         goto error;
+    if (!(nsm->lookups = zhash_new ()))
+        goto error;
     if (!(nsm->ns_name = strdup (ns)))
         goto error;
     /* We are subscribing to the kvs.namespace-<NS> substring.
@@ -248,15 +298,6 @@ static int handle_initial_response (flux_t *h,
         || (w->flags & FLUX_KVS_WATCH_UNIQ))
         w->prev = json_incref (val);
 
-    if ((w->flags & FLUX_KVS_WATCH_APPEND)) {
-        if (treeobj_decode_val (val,
-                                NULL,
-                                &w->append_offset) < 0) {
-            flux_log_error (h, "%s: treeobj_decode_val", __FUNCTION__);
-            return -1;
-        }
-    }
-
     if (flux_respond_pack (h, w->request, "{ s:O }", "val", val) < 0) {
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
         return -1;
@@ -302,70 +343,244 @@ static int handle_compare_response (flux_t *h,
     return 0;
 }
 
-static int handle_append_response (flux_t *h,
-                                    struct watcher *w,
-                                    json_t *val)
+static void append_load_destroy (struct append_load *al)
 {
-    if (!w->responded) {
-        /* this is the first response case, store the first response
-         * info.  This is here b/c initial response could have been
-         * ENOENT case */
-        if (treeobj_decode_val (val,
-                                NULL,
-                                &w->append_offset) < 0) {
-            flux_log_error (h, "%s: treeobj_decode_val", __FUNCTION__);
-            return -1;
-        }
+    if (al) {
+        int saved_errno = errno;
+        free (al->lastref);
+        free (al);
+        errno = saved_errno;
+    }
+}
 
-        if (flux_respond_pack (h, w->request, "{ s:O }", "val", val) < 0) {
-            flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
-            return -1;
-        }
+/* Send the appended data 'data', 'len' to watcher as a val.
+ */
+static int append_respond (flux_t *h, struct watcher *w,
+                           const void *data, int len)
+{
+    json_t *val;
 
-        w->responded = true;
+    if (w->mute)
+        return 0;
+    if (!(val = treeobj_create_val (data, len)))
+        return -1;
+    if (flux_respond_pack (h, w->request, "{ s:o }", "val", val) < 0) {
+        json_decref (val);
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+        return -1;
     }
-    else {
-        json_t *new_val = NULL;
-        void *new_data = NULL;
-        int new_offset;
-
-        if (treeobj_decode_val (val,
-                                &new_data,
-                                &new_offset) < 0) {
-            flux_log_error (h, "%s: treeobj_decode_val", __FUNCTION__);
-            return -1;
-        }
+    w->responded = true;
+    return 0;
+}
 
-        /* check length to determine if append actually happened, note
-         * that zero length append is legal
-         *
-         * Note that this check does not ensure that the key was not
-         * "fake" appended to.  i.e. the key overwritten with data
-         * longer than the original.
-         */
-        if (new_offset < w->append_offset) {
-            free (new_data);
-            errno = EINVAL;
-            return -1;
-        }
+static void lookup_continuation (flux_future_t *f, void *arg);
 
-        if (!(new_val = treeobj_create_val (new_data + w->append_offset,
-                                            new_offset - w->append_offset))) {
-            free (new_data);
-            return -1;
-        }
+static flux_future_t *lookupat (flux_t *h,
+                                struct watcher *w,
+                                const char *blobref,
+                                int root_seq,
+                                const char *ns);
 
-        free (new_data);
-        w->append_offset = new_offset;
+/* Queue future 'f' at the head of w->lookups, so that it is handled
+ * in place of the lookup response being handled now.
+ */
+static int append_queue_head (struct watcher *w, flux_future_t *f)
+{
+    if (zlist_push (w->lookups, f) < 0) {
+        flux_future_destroy (f);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (flux_future_then (f, -1., lookup_continuation, w) < 0) {
+        zlist_remove (w->lookups, f);
+        flux_future_destroy (f);
+        return -1;
+    }
+    return 0;
+}
 
-        if (flux_respond_pack (h, w->request, "{ s:o }", "val", new_val) < 0) {
-            json_decref (new_val);
-            flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
-            return -1;
+/* The watched key is a symlink, which FLUX_KVS_TREEOBJ lookups do not
+ * follow.  Redo the lookup at the same root without FLUX_KVS_TREEOBJ,
+ * and do likewise for the rest of this watcher's lookups.
+ */
+static int append_lookup_follow (flux_future_t *f,
+                                 struct watcher *w,
+                                 bool initial)
+{
+    flux_t *h = flux_future_get_flux (f);
+    const char *rootref;
+    int root_seq;
+    flux_future_t *f2;
+
+    if (flux_rpc_get_unpack (f, "{ s:s s:i }",
+                             "rootref", &rootref,
+                             "rootseq", &root_seq) < 0)
+        return -1;
+    w->append_follow = true;
+    if (!(f2 = lookupat (h, w, rootref, root_seq, w->nsm->ns_name)))
+        return -1;
+    if (initial && flux_future_aux_set (f2, "initial", f2, NULL) < 0) {
+        flux_future_destroy (f2);
+        return -1;
+    }
+    return append_queue_head (w, f2);
+}
+
+/* Load the blobrefs of 'valref' that the watcher has not yet been sent.
+ * If the blobrefs sent before are no longer a prefix of 'valref', the
+ * key was overwritten, so load them all and skip append_offset bytes.
+ * The load is handled by handle_append_load().
+ */
+static int append_load_blobs (flux_t *h, struct watcher *w, json_t *valref)
+{
+    struct append_load *al = NULL;
+    const char **refs = NULL;
+    flux_future_t *f;
+    const char *ref;
+    int count;
+    int start = 0;
+    int base = 0;
+    int i;
+
+    if ((count = treeobj_get_count (valref)) < 0)
+        return -1;
+    if (w->append_blobs > 0 && count >= w->append_blobs) {
+        if ((ref = treeobj_get_blobref (valref, w->append_blobs - 1))
+            && !strcmp (ref, w->append_lastref)) {
+            start = w->append_blobs;
+            base = w->append_offset;
         }
     }
+    /* N.B. zero length append is legal */
+    if (start == count)
+        return append_respond (h, w, NULL, 0);
+    if (!(refs = calloc (count - start, sizeof (refs[0])))
+        || !(al = calloc (1, sizeof (*al)))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    for (i = start; i < count; i++) {
+        if (!(refs[i - start] = treeobj_get_blobref (valref, i)))
+            goto error;
+    }
+    al->count = count - start;
+    al->base = base;
+    al->nblobs = count;
+    if (!(al->lastref = strdup (refs[al->count - 1]))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(f = flux_content_load_batch (h, refs, al->count, 0)))
+        goto error;
+    w->nsm->ctx->append_blobs_loaded += al->count;
+    if (flux_future_aux_set (f, "append",
+                             al,
+                             (flux_free_f)append_load_destroy) < 0) {
+        flux_future_destroy (f);
+        goto error;
+    }
+    free (refs);
+    return append_queue_head (w, f);
+error:
+    append_load_destroy (al);
+    ERRNO_SAFE_WRAP (free, refs);
+    return -1;
+}
 
-    return 0;
+/* KVS_WATCH_APPEND lookups are made with FLUX_KVS_TREEOBJ, so that
+ * only appended blobrefs need be loaded.  If 'val' is a valref, the
+ * response is deferred until those are loaded.  Otherwise, send the
+ * data of 'val' past append_offset.
+ *
+ * Note that a key "fake" appended to, i.e. overwritten with data
+ * longer than the original, is not detected.
+ */
+static int handle_append_response (flux_future_t *f,
+                                   struct watcher *w,
+                                   json_t *val,
+                                   bool initial)
+{
+    flux_t *h = flux_future_get_flux (f);
+    void *data = NULL;
+    int len;
+    int rc;
+
+    if (treeobj_is_symlink (val))
+        return append_lookup_follow (f, w, initial);
+    if (treeobj_is_valref (val))
+        return append_load_blobs (h, w, val);
+    if (!treeobj_is_val (val)) {
+        errno = EISDIR;
+        return -1;
+    }
+    if (treeobj_decode_val (val, &data, &len) < 0) {
+        flux_log_error (h, "%s: treeobj_decode_val", __FUNCTION__);
+        return -1;
+    }
+    if (len < w->append_offset) {
+        free (data);
+        errno = EINVAL;
+        return -1;
+    }
+    rc = append_respond (h, w, data + w->append_offset,
+                         len - w->append_offset);
+    free (data);
+    w->append_offset = len;
+    w->append_blobs = 0;
+    free (w->append_lastref);
+    w->append_lastref = NULL;
+    return rc;
+}
+
+/* Appended blobrefs have been loaded.  Send them to the watcher as one
+ * val, less any bytes already sent.
+ */
+static void handle_append_load (flux_future_t *f, struct watcher *w)
+{
+    flux_t *h = flux_future_get_flux (f);
+    struct append_load *al = flux_future_aux_get (f, "append");
+    const void *buf;
+    char *data = NULL;
+    int len;
+    int total = 0;
+    int skip;
+    int i;
+
+    for (i = 0; i < al->count; i++) {
+        if (flux_content_load_batch_get (f, i, &buf, &len) < 0)
+            goto error;
+        total += len;
+    }
+    if (total > 0 && !(data = malloc (total)))
+        goto error;
+    total = 0;
+    for (i = 0; i < al->count; i++) {
+        if (flux_content_load_batch_get (f, i, &buf, &len) < 0)
+            goto error;
+        memcpy (data + total, buf, len);
+        total += len;
+    }
+    if (al->base + total < w->append_offset) {
+        errno = EINVAL;
+        goto error;
+    }
+    skip = w->append_offset - al->base;
+    if (append_respond (h, w, data + skip, total - skip) < 0)
+        goto error;
+    free (data);
+    w->append_offset = al->base + total;
+    w->append_blobs = al->nblobs;
+    free (w->append_lastref);
+    w->append_lastref = al->lastref;
+    al->lastref = NULL;
+    return;
+error:
+    ERRNO_SAFE_WRAP (free, data);
+    if (!w->mute) {
+        if (flux_respond_error (h, w->request, errno, NULL) < 0)
+            flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    }
+    w->finished = true;
 }
 
 static int handle_normal_response (flux_t *h,
@@ -437,7 +652,12 @@ static void handle_lookup_response (flux_future_t *f,
             goto error;
         }
 
-        if (handle_initial_response (h, w, val, root_seq) < 0)
+        if ((w->flags & FLUX_KVS_WATCH_APPEND)) {
+            w->initial_rootseq = root_seq;
+            if (handle_append_response (f, w, val, true) < 0)
+                goto error;
+        }
+        else if (handle_initial_response (h, w, val, root_seq) < 0)
             goto error;
     }
     else {
@@ -467,7 +687,7 @@ static void handle_lookup_response (flux_future_t *f,
                     goto error;
             }
             else if (w->flags & FLUX_KVS_WATCH_APPEND) {
-                if (handle_append_response (h, w, val) < 0)
+                if (handle_append_response (f, w, val, false) < 0)
                     goto error;
             }
             else {
@@ -496,8 +716,12 @@ static void lookup_continuation (flux_future_t *f, void *arg)
 
     while ((f = zlist_first (w->lookups)) && flux_future_is_ready (f)) {
         f = zlist_pop (w->lookups);
-        if (!w->finished)
-            handle_lookup_response (f, w);
+        if (!w->finished) {
+            if (flux_future_aux_get (f, "append"))
+                handle_append_load (f, w);
+            else
+                handle_lookup_response (f, w);
+        }
         flux_future_destroy (f);
         /* if WAITCREATE and !WATCH, then we only care about sending
          * one response and being done.  We can use the responded flag
@@ -512,12 +736,25 @@ static void lookup_continuation (flux_future_t *f, void *arg)
         watcher_cleanup (nsm, w);
 }
 
+/* Flags for watcher lookups.  FLUX_KVS_TREEOBJ is added for
+ * KVS_WATCH_APPEND, see handle_append_response().
+ */
+static int lookup_flags (struct watcher *w)
+{
+    int flags = w->flags;
+
+    if ((w->flags & FLUX_KVS_WATCH_APPEND) && !w->append_follow)
+        flags |= FLUX_KVS_TREEOBJ;
+    return flags;
+}
+
 /* Like flux_kvs_lookupat() except:
  * - targets kvs.lookup-plus, so root_ref & root_seq are available in
  *   response
  * - blobref param replaces treeobj
  * - namespace param (ignores namespace associated with flux_t handle)
  * - cred params (see N.B. below)
+ * - flags are from lookup_flags()
  * Use flux_rpc_get() not flux_kvs_lookup_get() to access the response.
  */
 static flux_future_t *lookupat (flux_t *h,
@@ -529,6 +766,7 @@ static flux_future_t *lookupat (flux_t *h,
     flux_msg_t *msg;
     json_t *o = NULL;
     flux_future_t *f;
+    int flags = lookup_flags (w);
     int saved_errno;
 
     if (!(msg = flux_request_encode ("kvs.lookup-plus", NULL)))
@@ -537,7 +775,7 @@ static flux_future_t *lookupat (flux_t *h,
         if (flux_msg_pack (msg, "{s:s s:s s:i}",
                            "key", w->key,
                            "namespace", ns,
-                           "flags", w->flags) < 0)
+                           "flags", flags) < 0)
             goto error;
     }
     else {
@@ -545,7 +783,7 @@ static flux_future_t *lookupat (flux_t *h,
             goto error;
         if (flux_msg_pack (msg, "{s:s s:i s:i s:O}",
                            "key", w->key,
-                           "flags", w->flags,
+                           "flags", flags,
                            "rootseq", root_seq,
                            "rootdir", o) < 0)
             goto error;
@@ -579,23 +817,164 @@ error:
     return NULL;
 }
 
+static void shared_lookup_destroy (struct shared_lookup *sl)
+{
+    if (sl) {
+        int saved_errno = errno;
+        flux_future_t *f;
+        flux_future_destroy (sl->f);
+        if (sl->waiters) {
+            while ((f = zlist_pop (sl->waiters)))
+                (void)flux_future_aux_set (f, "shared", NULL, NULL);
+            zlist_destroy (&sl->waiters);
+        }
+        free (sl->id);
+        free (sl);
+        errno = saved_errno;
+    }
+}
+
+/* Shared lookup has completed.  Fulfill each waiting watcher future
+ * with the response message, or the error, then retire the lookup.
+ */
+static void shared_lookup_continuation (flux_future_t *f, void *arg)
+{
+    struct shared_lookup *sl = arg;
+    const flux_msg_t *msg;
+    flux_future_t *wf;
+
+    if (flux_future_get (f, (const void **)&msg) < 0) {
+        int errnum = errno;
+        const char *errstr = NULL;
+
+        if (flux_future_has_error (f))
+            errstr = flux_future_error_string (f);
+        while ((wf = zlist_pop (sl->waiters))) {
+            (void)flux_future_aux_set (wf, "shared", NULL, NULL);
+            flux_future_fulfill_error (wf, errnum, errstr);
+        }
+    }
+    else {
+        while ((wf = zlist_pop (sl->waiters))) {
+            (void)flux_future_aux_set (wf, "shared", NULL, NULL);
+            flux_future_fulfill (wf,
+                                 (void *)flux_msg_incref (msg),
+                                 (flux_free_f)flux_msg_decref);
+        }
+    }
+    zhash_delete (sl->nsm->lookups, sl->id);
+}
+
+static struct shared_lookup *shared_lookup_create (struct ns_monitor *nsm,
+                                                   struct watcher *w,
+                                                   const char *id)
+{
+    struct shared_lookup *sl;
+
+    if (!(sl = calloc (1, sizeof (*sl))))
+        return NULL;
+    sl->nsm = nsm;
+    if (!(sl->id = strdup (id))
+        || !(sl->waiters = zlist_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(sl->f = lookupat (nsm->ctx->h,
+                            w,
+                            nsm->commit->rootref,
+                            nsm->commit->rootseq,
+                            nsm->ns_name))) {
+        flux_log_error (nsm->ctx->h, "%s: lookupat", __FUNCTION__);
+        goto error;
+    }
+    if (flux_future_then (sl->f, -1., shared_lookup_continuation, sl) < 0)
+        goto error;
+    return sl;
+error:
+    shared_lookup_destroy (sl);
+    return NULL;
+}
+
+/* Get a future for the lookup of watcher's key at the current root.
+ * The lookup is made with the watcher's credentials, so it is shared
+ * only by watchers with the same userid and rolemask, as well as the
+ * same key and lookup flags.
+ */
+static flux_future_t *shared_lookup_join (struct ns_monitor *nsm,
+                                          struct watcher *w)
+{
+    struct shared_lookup *sl;
+    flux_future_t *f;
+    char *id;
+
+    if (asprintf (&id, "%d:%d:%ju:%ju:%s",
+                  nsm->commit->rootseq,
+                  lookup_flags (w),
+                  (uintmax_t)w->cred.userid,
+                  (uintmax_t)w->cred.rolemask,
+                  w->key) < 0)
+        return NULL;
+    if ((sl = zhash_lookup (nsm->lookups, id)))
+        nsm->ctx->lookups_shared++;
+    else {
+        if (!(sl = shared_lookup_create (nsm, w, id)))
+            goto error;
+        if (zhash_insert (nsm->lookups, id, sl) < 0) {
+            shared_lookup_destroy (sl);
+            errno = EEXIST;
+            goto error;
+        }
+        zhash_freefn (nsm->lookups,
+                      id,
+                      (zhash_free_fn *)shared_lookup_destroy);
+    }
+    if (!(f = flux_future_create (NULL, NULL)))
+        goto error;
+    flux_future_set_flux (f, nsm->ctx->h);
+    if (flux_future_aux_set (f, "shared", sl, NULL) < 0) {
+        flux_future_destroy (f);
+        goto error;
+    }
+    if (zlist_append (sl->waiters, f) < 0) {
+        flux_future_destroy (f);
+        errno = ENOMEM;
+        goto error;
+    }
+    free (id);
+    return f;
+error:
+    ERRNO_SAFE_WRAP (free, id);
+    return NULL;
+}
+
+/* Queue a lookup of the watcher's key at the current root.  The initial
+ * lookup is made at whatever root the KVS has, so is never shared.
+ */
 static int process_lookup_response (struct ns_monitor *nsm, struct watcher *w)
 {
     flux_future_t *f;
-    if (!(f = lookupat (nsm->ctx->h,
-                        w,
-                        nsm->commit->rootref,
-                        nsm->commit->rootseq,
-                        nsm->ns_name))) {
-        flux_log_error (nsm->ctx->h, "%s: lookupat", __FUNCTION__);
-        return -1;
+
+    if (!w->initial_rpc_sent) {
+        if (!(f = lookupat (nsm->ctx->h,
+                            w,
+                            nsm->commit->rootref,
+                            nsm->commit->rootseq,
+                            nsm->ns_name))) {
+            flux_log_error (nsm->ctx->h, "%s: lookupat", __FUNCTION__);
+            return -1;
+        }
     }
+    else if (!(f = shared_lookup_join (nsm, w)))
+        return -1;
     if (zlist_append (w->lookups, f) < 0) {
+        shared_lookup_leave (f);
         flux_future_destroy (f);
         errno = ENOMEM;
         return -1;
     }
     if (flux_future_then (f, -1., lookup_continuation, w) < 0) {
+        zlist_remove (w->lookups, f);
+        shared_lookup_leave (f);
         flux_future_destroy (f);
         return -1;
     }
@@ -1051,18 +1430,20 @@ static void stats_cb (flux_t *h, flux_msg_handler_t *mh,
     struct ns_monitor *nsm;
     json_t *stats;
     int watchers = 0;
+    int lookups = 0;
 
     if (!(stats = json_object()))
         goto nomem;
     nsm = zhash_first (ctx->namespaces);
     while (nsm) {
-        json_t *o = json_pack ("{s:i s:i s:s s:i}",
+        json_t *o = json_pack ("{s:i s:i s:s s:i s:i}",
                                "owner", (int)nsm->owner,
                                "rootseq", nsm->commit ? nsm->commit->rootseq
                                                       : -1,
                                "rootref", nsm->commit ? nsm->commit->rootref
                                                       : "(null)",
-                               "watchers", (int)zlist_size (nsm->watchers));
+                               "watchers", (int)zlist_size (nsm->watchers),
+                               "lookups", (int)zhash_size (nsm->lookups));
         if (!o)
             goto nomem;
         if (json_object_set_new (stats, nsm->ns_name, o) < 0) {
@@ -1070,10 +1451,14 @@ static void stats_cb (flux_t *h, flux_msg_handler_t *mh,
             goto nomem;
         }
         watchers += zlist_size (nsm->watchers);
+        lookups += zhash_size (nsm->lookups);
         nsm = zhash_next (ctx->namespaces);
     }
-    if (flux_respond_pack (h, msg, "{s:i s:i s:O}",
+    if (flux_respond_pack (h, msg, "{s:i s:i s:i s:i s:i s:O}",
                            "watchers", watchers,
+                           "lookups", lookups,
+                           "lookups-shared", ctx->lookups_shared,
+                           "append-blobs-loaded", ctx->append_blobs_loaded,
                            "namespace-count", (int)zhash_size (ctx->namespaces),
                            "namespaces", stats) < 0)
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
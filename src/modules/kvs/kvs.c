@@ -59,6 +59,7 @@ typedef struct {
     struct cache *cache;    /* blobref => cache_entry */
     kvsroot_mgr_t *krm;
     int faults;                 /* for kvs.stats.get, etc. */
+    int prefetches;             /* for kvs.stats.get, etc. */
     flux_t *h;
     uint32_t rank;
     int epoch;              /* tracks current heartbeat epoch */
@@ -66,6 +67,9 @@ typedef struct {
     flux_watcher_t *idle_w;
     flux_watcher_t *check_w;
     int transaction_merge;
+    int prefetch_fanout;
+    int shard_threshold;
+    int primary_flags;          /* namespace flags for primary namespace */
     bool events_init;            /* flag */
     const char *hash_name;
     unsigned int seq;           /* for commit transactions */
@@ -78,6 +82,8 @@ struct kvs_cb_data {
     int errnum;
     bool ready;
     char *sender;
+    zlist_t *refs;
+    zlist_t *prefetch;
 };
 
 static void transaction_prep_cb (flux_reactor_t *r, flux_watcher_t *w,
@@ -339,6 +345,7 @@ static void getroot_completion (flux_future_t *f, void *arg)
             flux_log_error (ctx->h, "%s: kvsroot_mgr_create_root", __FUNCTION__);
             goto error;
         }
+        kvstxn_mgr_set_shard_threshold (root->ktm, ctx->shard_threshold);
 
         if (event_subscribe (ctx, ns) < 0) {
             save_errno = errno;
@@ -468,16 +475,17 @@ static void content_load_cache_entry_error (kvs_ctx_t *ctx,
         flux_log (ctx->h, LOG_ERR, "%s: cache_remove_entry", __FUNCTION__);
 }
 
-static void content_load_completion (flux_future_t *f, void *arg)
+/* Fill in cache entry for 'blobref' with loaded data, or if 'data' is
+ * NULL, inform waiters that the load failed with 'errnum'.
+ */
+static void content_load_complete (kvs_ctx_t *ctx,
+                                   const char *blobref,
+                                   const void *data,
+                                   int size,
+                                   int errnum)
 {
-    kvs_ctx_t *ctx = arg;
-    const void *data;
-    int size;
-    const char *blobref;
     struct cache_entry *entry;
 
-    blobref = flux_future_aux_get (f, "ref");
-
     /* should be impossible for lookup to fail, cache entry created
      * earlier, and cache_expire_entries() could not have removed it
      * b/c it is not yet valid.  But check and log incase there is
@@ -485,13 +493,12 @@ static void content_load_completion (flux_future_t *f, void *arg)
      */
     if (!(entry = cache_lookup (ctx->cache, blobref, ctx->epoch))) {
         flux_log (ctx->h, LOG_ERR, "%s: cache_lookup", __FUNCTION__);
-        goto done;
+        return;
     }
 
-    if (flux_content_load_get (f, &data, &size) < 0) {
-        flux_log_error (ctx->h, "%s: flux_content_load_get", __FUNCTION__);
-        content_load_cache_entry_error (ctx, entry, errno, blobref);
-        goto done;
+    if (!data && errnum) {
+        content_load_cache_entry_error (ctx, entry, errnum, blobref);
+        return;
     }
 
     /* If cache_entry_set_raw() fails, it's a pretty terrible error
@@ -501,10 +508,66 @@ static void content_load_completion (flux_future_t *f, void *arg)
     if (cache_entry_set_raw (entry, data, size) < 0) {
         flux_log_error (ctx->h, "%s: cache_entry_set_raw", __FUNCTION__);
         content_load_cache_entry_error (ctx, entry, errno, blobref);
-        goto done;
     }
+}
 
-done:
+static void content_load_completion (flux_future_t *f, void *arg)
+{
+    kvs_ctx_t *ctx = arg;
+    const void *data = NULL;
+    int size = 0;
+    const char *blobref = flux_future_aux_get (f, "ref");
+    int errnum = 0;
+
+    if (flux_content_load_get (f, &data, &size) < 0) {
+        flux_log_error (ctx->h, "%s: flux_content_load_get", __FUNCTION__);
+        errnum = errno;
+        data = NULL;
+    }
+    content_load_complete (ctx, blobref, data, size, errnum);
+    flux_future_destroy (f);
+}
+
+/* Refs sent in a content.load-batch request, in request order.
+ */
+struct load_batch {
+    int count;
+    char *refs[];
+};
+
+static void load_batch_destroy (struct load_batch *lb)
+{
+    if (lb) {
+        int saved_errno = errno;
+        int i;
+        for (i = 0; i < lb->count; i++)
+            free (lb->refs[i]);
+        free (lb);
+        errno = saved_errno;
+    }
+}
+
+static void content_load_batch_completion (flux_future_t *f, void *arg)
+{
+    kvs_ctx_t *ctx = arg;
+    struct load_batch *lb = flux_future_aux_get (f, "refs");
+    int i;
+
+    for (i = 0; i < lb->count; i++) {
+        const void *data = NULL;
+        int size = 0;
+        int errnum = 0;
+
+        if (flux_content_load_batch_get (f, i, &data, &size) < 0) {
+            if (errno != ENOENT)
+                flux_log_error (ctx->h,
+                                "%s: flux_content_load_batch_get",
+                                __FUNCTION__);
+            errnum = errno;
+            data = NULL;
+        }
+        content_load_complete (ctx, lb->refs[i], data, size, errnum);
+    }
     flux_future_destroy (f);
 }
 
@@ -541,6 +604,56 @@ error:
     return -1;
 }
 
+/* Send a single content load request for 'count' refs and setup
+ * continuation to handle response.
+ */
+static int content_load_batch_send (kvs_ctx_t *ctx,
+                                    const char **refs,
+                                    int count)
+{
+    flux_future_t *f = NULL;
+    struct load_batch *lb;
+    int saved_errno;
+    int i;
+
+    if (count == 1)
+        return content_load_request_send (ctx, refs[0]);
+    if (!(lb = calloc (1, sizeof (*lb) + count * sizeof (lb->refs[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if (!(lb->refs[lb->count] = strdup (refs[i]))) {
+            errno = ENOMEM;
+            goto error;
+        }
+        lb->count++;
+    }
+    if (!(f = flux_content_load_batch (ctx->h, refs, count, 0))) {
+        flux_log_error (ctx->h, "%s: flux_content_load_batch", __FUNCTION__);
+        goto error;
+    }
+    if (flux_future_aux_set (f,
+                             "refs",
+                             lb,
+                             (flux_free_f)load_batch_destroy) < 0) {
+        flux_log_error (ctx->h, "%s: flux_future_aux_set", __FUNCTION__);
+        goto error;
+    }
+    lb = NULL;
+    if (flux_future_then (f, -1., content_load_batch_completion, ctx) < 0) {
+        flux_log_error (ctx->h, "%s: flux_future_then", __FUNCTION__);
+        goto error;
+    }
+    return 0;
+error:
+    saved_errno = errno;
+    load_batch_destroy (lb);
+    flux_future_destroy (f);
+    errno = saved_errno;
+    return -1;
+}
+
 /* Return 0 on success, -1 on error.  Set stall variable appropriately
  */
 static int load (kvs_ctx_t *ctx, const char *ref, wait_t *wait, bool *stall)
@@ -605,6 +718,141 @@ static int load (kvs_ctx_t *ctx, const char *ref, wait_t *wait, bool *stall)
     return 0;
 }
 
+/* Create incomplete hash entries for refs in 'refs' that are not found,
+ * appending them to 'missing'.
+ */
+static int create_missing (kvs_ctx_t *ctx,
+                           zlist_t *refs,
+                           const char **missing,
+                           int *count)
+{
+    const char *ref;
+
+    if (!refs)
+        return 0;
+    ref = zlist_first (refs);
+    while (ref) {
+        if (!cache_lookup (ctx->cache, ref, ctx->epoch)) {
+            struct cache_entry *entry;
+
+            if (!(entry = cache_entry_create (ref))) {
+                flux_log_error (ctx->h, "%s: cache_entry_create",
+                                __FUNCTION__);
+                return -1;
+            }
+            if (cache_insert (ctx->cache, entry) < 0) {
+                flux_log_error (ctx->h, "%s: cache_insert",
+                                __FUNCTION__);
+                cache_entry_destroy (entry);
+                return -1;
+            }
+            missing[(*count)++] = ref;
+        }
+        ref = zlist_next (refs);
+    }
+    return 0;
+}
+
+/* Load the list of refs in 'cbd' collected from kvstxn_iter_missing_refs()
+ * or lookup_iter_missing_refs(), sending one content load request for all
+ * refs that are not already cached or in transit, then arrange for
+ * cbd->wait to stall on each ref that is not yet valid.  Refs collected
+ * from lookup_iter_prefetch_refs() are added to the same request, but
+ * nothing waits on them.
+ * Return 0 on success, -1 on error with cbd->errnum set.
+ */
+static int load_refs (struct kvs_cb_data *cbd)
+{
+    kvs_ctx_t *ctx = cbd->ctx;
+    zlist_t *refs = cbd->refs;
+    int nrefs = refs ? zlist_size (refs) : 0;
+    int nprefetch = cbd->prefetch ? zlist_size (cbd->prefetch) : 0;
+    const char **missing;
+    const char *ref;
+    int count = 0;
+    int faults;
+    int saved_errno;
+    int i;
+
+    if (nrefs + nprefetch == 0)
+        return 0;
+    if (!(missing = calloc (nrefs + nprefetch, sizeof (missing[0])))) {
+        cbd->errnum = ENOMEM;
+        return -1;
+    }
+    if (create_missing (ctx, refs, missing, &count) < 0)
+        goto error;
+    faults = count;
+    if (create_missing (ctx, cbd->prefetch, missing, &count) < 0)
+        goto error;
+    if (count > 0) {
+        if (content_load_batch_send (ctx, missing, count) < 0) {
+            flux_log_error (ctx->h, "%s: content_load_batch_send",
+                            __FUNCTION__);
+            goto error;
+        }
+        ctx->faults += faults;
+        ctx->prefetches += count - faults;
+    }
+    free (missing);
+    /* Now that entries exist and are in transit, load() only adds waiters.
+     */
+    if (!refs)
+        return 0;
+    ref = zlist_first (refs);
+    while (ref) {
+        if (load (ctx, ref, cbd->wait, NULL) < 0) {
+            cbd->errnum = errno;
+            flux_log_error (ctx->h, "%s: load", __FUNCTION__);
+            return -1;
+        }
+        ref = zlist_next (refs);
+    }
+    return 0;
+error:
+    saved_errno = cbd->errnum = errno;
+    /* cache entries just created, should always work */
+    for (i = 0; i < count; i++) {
+        int ret = cache_remove_entry (ctx->cache, missing[i]);
+        assert (ret == 1);
+    }
+    free (missing);
+    errno = saved_errno;
+    return -1;
+}
+
+/* Add a copy of 'ref' to list 'l', creating the list if needed.
+ */
+static int refs_append (zlist_t **l, const char *ref)
+{
+    char *cpy;
+
+    if (!*l && !(*l = zlist_new ()))
+        goto nomem;
+    if (!(cpy = strdup (ref)))
+        goto nomem;
+    if (zlist_append (*l, cpy) < 0) {
+        free (cpy);
+        goto nomem;
+    }
+    zlist_freefn (*l, cpy, free, true);
+    return 0;
+nomem:
+    errno = ENOMEM;
+    return -1;
+}
+
+/* Add ref to list in 'cbd', for load_refs().
+ */
+static int cbd_add_ref (struct kvs_cb_data *cbd, const char *ref)
+{
+    if (refs_append (&cbd->refs, ref) < 0) {
+        cbd->errnum = errno;
+        return -1;
+    }
+    return 0;
+}
+
 /*
  * store/write
  */
@@ -729,16 +977,8 @@ error:
 static int kvstxn_load_cb (kvstxn_t *kt, const char *ref, void *data)
 {
     struct kvs_cb_data *cbd = data;
-    bool stall;
 
-    if (load (cbd->ctx, ref, cbd->wait, &stall) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "%s: load", __FUNCTION__);
-        return -1;
-    }
-    /* if not stalling, logic issue within code */
-    assert (stall);
-    return 0;
+    return cbd_add_ref (cbd, ref);
 }
 
 /* Flush to content cache asynchronously and push wait onto cache
@@ -975,8 +1215,12 @@ static void kvstxn_apply (kvstxn_t *kt)
         cbd.ctx = ctx;
         cbd.wait = wait;
         cbd.errnum = 0;
+        cbd.refs = NULL;
+        cbd.prefetch = NULL;
 
-        if (kvstxn_iter_missing_refs (kt, kvstxn_load_cb, &cbd) < 0) {
+        if (kvstxn_iter_missing_refs (kt, kvstxn_load_cb, &cbd) < 0
+            || load_refs (&cbd) < 0) {
+            zlist_destroy (&cbd.refs);
             errnum = cbd.errnum;
 
             /* rpcs already in flight, stall for them to complete */
@@ -987,6 +1231,7 @@ static void kvstxn_apply (kvstxn_t *kt)
 
             goto done;
         }
+        zlist_destroy (&cbd.refs);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
@@ -1247,16 +1492,30 @@ static void heartbeat_cb (flux_t *h, flux_msg_handler_t *mh,
 static int lookup_load_cb (lookup_t *lh, const char *ref, void *data)
 {
     struct kvs_cb_data *cbd = data;
-    bool stall;
 
-    if (load (cbd->ctx, ref, cbd->wait, &stall) < 0) {
-        cbd->errnum = errno;
-        flux_log_error (cbd->ctx->h, "%s: load", __FUNCTION__);
-        return -1;
-    }
-    /* if not stalling, logic issue within code */
-    assert (stall);
-    return 0;
+    return cbd_add_ref (cbd, ref);
+}
+
+static int lookup_prefetch_cb (lookup_t *lh, const char *ref, void *data)
+{
+    struct kvs_cb_data *cbd = data;
+
+    return refs_append (&cbd->prefetch, ref);
+}
+
+/* Start loading children of a directory that lookup just read, without
+ * stalling on them.  This is best effort, so errors are only logged.
+ */
+static void lookup_prefetch (kvs_ctx_t *ctx, lookup_t *lh)
+{
+    struct kvs_cb_data cbd = { .ctx = ctx };
+
+    if (ctx->prefetch_fanout == 0)
+        return;
+    if (lookup_iter_prefetch_refs (lh, lookup_prefetch_cb, &cbd) < 0
+        || load_refs (&cbd) < 0)
+        flux_log_error (ctx->h, "%s: prefetch", __FUNCTION__);
+    zlist_destroy (&cbd.prefetch);
 }
 
 static void lookup_wait_error_cb (wait_t *w, int errnum, void *arg)
@@ -1342,6 +1601,8 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
                                   flags,
                                   h)))
             goto done;
+        if (lookup_set_prefetch (lh, ctx->prefetch_fanout) < 0)
+            goto done;
     }
     else {
         int err;
@@ -1394,8 +1655,17 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
         cbd.ctx = ctx;
         cbd.wait = wait;
         cbd.errnum = 0;
+        cbd.refs = NULL;
+        cbd.prefetch = NULL;
+
+        /* prefetch refs ride along in the same load request */
+        if (ctx->prefetch_fanout > 0)
+            (void)lookup_iter_prefetch_refs (lh, lookup_prefetch_cb, &cbd);
 
-        if (lookup_iter_missing_refs (lh, lookup_load_cb, &cbd) < 0) {
+        if (lookup_iter_missing_refs (lh, lookup_load_cb, &cbd) < 0
+            || load_refs (&cbd) < 0) {
+            zlist_destroy (&cbd.refs);
+            zlist_destroy (&cbd.prefetch);
             /* rpcs already in flight, stall for them to complete */
             if (wait_get_usecount (wait) > 0) {
                 lookup_set_aux_errnum (lh, cbd.errnum);
@@ -1405,12 +1675,16 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
             errno = cbd.errnum;
             goto done;
         }
+        zlist_destroy (&cbd.refs);
+        zlist_destroy (&cbd.prefetch);
 
         assert (wait_get_usecount (wait) > 0);
         goto stall;
     }
     /* else lret == LOOKUP_PROCESS_FINISHED, fallthrough */
 
+    lookup_prefetch (ctx, lh);
+
     rc = 0;
 done:
     wait_destroy (wait);
@@ -2027,22 +2301,38 @@ static void error_event_cb (flux_t *h, flux_msg_handler_t *mh,
  * in the kvs.namespace-<NS>-setroot event.  Prime the local cache with it.
  * If there are complications, just skip it.  Not critical.
  */
-static void prime_cache_with_rootdir (kvs_ctx_t *ctx, json_t *rootdir)
+static void prime_cache_with_rootdir (kvs_ctx_t *ctx,
+                                      struct kvsroot *root,
+                                      json_t *rootdir)
 {
     struct cache_entry *entry;
     char ref[BLOBREF_MAX_STRING_SIZE];
     void *data = NULL;
-    int len;
+    size_t len;
 
     if (treeobj_validate (rootdir) < 0 || !treeobj_is_dir (rootdir)) {
         flux_log (ctx->h, LOG_ERR, "%s: invalid rootdir", __FUNCTION__);
         goto done;
     }
-    if (!(data = treeobj_encode (rootdir))) {
-        flux_log_error (ctx->h, "%s: treeobj_encode", __FUNCTION__);
-        goto done;
+    /* Encode as the namespace does, or the blobref won't match.
+     * Empty directories are stored as JSON even in binary namespaces,
+     * as in store_initial_rootdir() and kvstxn.
+     */
+    if ((root->flags & FLUX_KVS_NAMESPACE_BINARY)
+        && treeobj_get_count (rootdir) > 0) {
+        if (!(data = treeobj_encode_binary (rootdir, &len))) {
+            flux_log_error (ctx->h, "%s: treeobj_encode_binary",
+                            __FUNCTION__);
+            goto done;
+        }
+    }
+    else {
+        if (!(data = treeobj_encode (rootdir))) {
+            flux_log_error (ctx->h, "%s: treeobj_encode", __FUNCTION__);
+            goto done;
+        }
+        len = strlen (data);
     }
-    len = strlen (data);
     if (blobref_hash (ctx->hash_name, data, len, ref, sizeof (ref)) < 0) {
         flux_log_error (ctx->h, "%s: blobref_hash", __FUNCTION__);
         goto done;
@@ -2091,7 +2381,7 @@ static void setroot_event_process (kvs_ctx_t *ctx, struct kvsroot *root,
      * demand from content cache if not in local cache.
      */
     if (!json_is_null (rootdir))
-        prime_cache_with_rootdir (ctx, rootdir);
+        prime_cache_with_rootdir (ctx, root, rootdir);
 
     setroot (ctx, root, rootref, rootseq);
 }
@@ -2252,12 +2542,13 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                               "max", tstat_max (&ts)*scale)))
         goto nomem;
 
-    if (!(cstats = json_pack ("{ s:f s:O s:i s:i s:i }",
+    if (!(cstats = json_pack ("{ s:f s:O s:i s:i s:i s:i }",
                               "obj size total (MiB)", (double)size/1048576,
                               "obj size (KiB)", tstats,
                               "#obj dirty", dirty,
                               "#obj incomplete", incomplete,
-                              "#faults", ctx->faults)))
+                              "#faults", ctx->faults,
+                              "#prefetch", ctx->prefetches)))
         goto nomem;
 
     if (!(nsstats = json_object ()))
@@ -2314,6 +2605,7 @@ static int stats_clear_root_cb (struct kvsroot *root, void *arg)
 static void stats_clear (kvs_ctx_t *ctx)
 {
     ctx->faults = 0;
+    ctx->prefetches = 0;
 
     if (kvsroot_mgr_iter_roots (ctx->krm, stats_clear_root_cb, NULL) < 0)
         flux_log_error (ctx->h, "%s: kvsroot_mgr_iter_roots", __FUNCTION__);
@@ -2366,6 +2658,7 @@ static int namespace_create (kvs_ctx_t *ctx, const char *ns,
         flux_log_error (ctx->h, "%s: kvsroot_mgr_create_root", __FUNCTION__);
         return -1;
     }
+    kvstxn_mgr_set_shard_threshold (root->ktm, ctx->shard_threshold);
 
     if (!(rootdir = treeobj_create_dir ())) {
         flux_log_error (ctx->h, "%s: treeobj_create_dir", __FUNCTION__);
@@ -2443,6 +2736,11 @@ static void namespace_create_request_cb (flux_t *h, flux_msg_handler_t *mh,
         goto error;
     }
 
+    if ((flags & ~FLUX_KVS_NAMESPACE_BINARY)) {
+        errno = EINVAL;
+        goto error;
+    }
+
     if (owner == FLUX_USERID_UNKNOWN)
         owner = getuid ();
 
@@ -2826,6 +3124,14 @@ static void process_args (kvs_ctx_t *ctx, int ac, char **av)
     for (i = 0; i < ac; i++) {
         if (strncmp (av[i], "transaction-merge=", 13) == 0)
             ctx->transaction_merge = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "prefetch-fanout=", 16) == 0)
+            ctx->prefetch_fanout = strtoul (av[i]+16, NULL, 10);
+        else if (strncmp (av[i], "shard-threshold=", 16) == 0)
+            ctx->shard_threshold = strtoul (av[i]+16, NULL, 10);
+        else if (strcmp (av[i], "treeobj-encoding=binary") == 0)
+            ctx->primary_flags |= FLUX_KVS_NAMESPACE_BINARY;
+        else if (strcmp (av[i], "treeobj-encoding=json") == 0)
+            ctx->primary_flags &= ~FLUX_KVS_NAMESPACE_BINARY;
         else
             flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
     }
@@ -2998,10 +3304,12 @@ int mod_main (flux_t *h, int argc, char **argv)
                                                   ctx->hash_name,
                                                   KVS_PRIMARY_NAMESPACE,
                                                   owner,
-                                                  0))) {
+                                                  ctx->primary_flags))) {
                 flux_log_error (h, "kvsroot_mgr_create_root");
                 goto done;
             }
+            kvstxn_mgr_set_shard_threshold (root->ktm,
+                                            ctx->shard_threshold);
         }
 
         setroot (ctx, root, rootref, 0);
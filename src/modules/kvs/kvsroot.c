@@ -128,6 +128,8 @@ struct kvsroot *kvsroot_mgr_create_root (kvsroot_mgr_t *krm,
         flux_log_error (krm->h, "kvstxn_mgr_create");
         goto error;
     }
+    if (flags & FLUX_KVS_NAMESPACE_BINARY)
+        (void)kvstxn_mgr_set_binary (root->ktm, true);
 
     if (!(root->trm = treq_mgr_create ())) {
         flux_log_error (krm->h, "treq_mgr_create");
@@ -40,6 +40,8 @@ struct kvstxn_mgr {
     const char *ns_name;
     const char *hash_name;
     int noop_stores;            /* for kvs.stats.get, etc.*/
+    int shard_threshold;        /* shard dirs larger than this, 0=never */
+    bool binary;                /* store treeobjs in binary encoding */
     zlist_t *ready;
     flux_t *h;
     void *aux;
@@ -238,20 +240,17 @@ static void cleanup_dirty_cache_list (kvstxn_t *kt)
         kvstxn_cleanup_dirty_cache_entry (kt, entry);
 }
 
-/* Store object 'o' under key 'ref' in local cache.
- * Object reference is still owned by the caller.
+/* Encode object 'o' for storage in the local cache, returning the
+ * encoded data in 'datap' (caller must free) and its length in 'lenp'.
  * 'is_raw' indicates this data is a json string w/ base64 value and
  * should be flushed to the content store as raw data after it is
  * decoded.  Otherwise, the json object should be a treeobj.
- * Returns -1 on error, 0 on success entry already there, 1 on success
- * entry needs to be flushed to content store
+ * Returns -1 on error, 0 on success.
  */
-static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
-                        bool is_raw, char *ref, int ref_len,
-                        struct cache_entry **entryp)
+static int store_cache_encode (kvstxn_t *kt, json_t *o, bool is_raw,
+                               char **datap, size_t *lenp)
 {
-    struct cache_entry *entry;
-    int saved_errno, rc;
+    int saved_errno;
     const char *xdata;
     char *data = NULL;
     size_t xlen, len;
@@ -273,6 +272,18 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
             }
         }
     }
+    /* Empty directories are always stored as JSON, so an empty root has
+     * the same blobref as the initial root of any namespace.
+     */
+    else if (kt->ktm->binary
+             && !(treeobj_is_dir (o) && treeobj_get_count (o) == 0)) {
+        if (treeobj_validate (o) < 0
+            || !(data = treeobj_encode_binary (o, &len))) {
+            flux_log_error (kt->ktm->h, "%s: treeobj_encode_binary",
+                            __FUNCTION__);
+            goto error;
+        }
+    }
     else {
         if (treeobj_validate (o) < 0 || !(data = treeobj_encode (o))) {
             flux_log_error (kt->ktm->h, "%s: treeobj_encode", __FUNCTION__);
@@ -280,19 +291,38 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
         }
         len = strlen (data);
     }
-    if (blobref_hash (kt->ktm->hash_name, data, len, ref, ref_len) < 0) {
-        flux_log_error (kt->ktm->h, "%s: blobref_hash", __FUNCTION__);
-        goto error;
-    }
+    *datap = data;
+    *lenp = len;
+    return 0;
+
+ error:
+    saved_errno = errno;
+    free (data);
+    errno = saved_errno;
+    return -1;
+}
+
+/* Store encoded 'data' under key 'ref' in local cache.
+ * Data is copied, so it is still owned by the caller.
+ * Returns -1 on error, 0 on success entry already there, 1 on success
+ * entry needs to be flushed to content store
+ */
+static int store_cache_insert (kvstxn_t *kt, int current_epoch,
+                               const char *ref, const char *data, size_t len,
+                               struct cache_entry **entryp)
+{
+    struct cache_entry *entry;
+    int rc;
+
     if (!(entry = cache_lookup (kt->ktm->cache, ref, current_epoch))) {
         if (!(entry = cache_entry_create (ref))) {
             flux_log_error (kt->ktm->h, "%s: cache_entry_create", __FUNCTION__);
-            goto error;
+            return -1;
         }
         if (cache_insert (kt->ktm->cache, entry) < 0) {
             cache_entry_destroy (entry);
             flux_log_error (kt->ktm->h, "%s: cache_insert", __FUNCTION__);
-            goto error;
+            return -1;
         }
     }
     if (cache_entry_get_valid (entry)) {
@@ -304,18 +334,44 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
             int ret;
             ret = cache_remove_entry (kt->ktm->cache, ref);
             assert (ret == 1);
-            goto error;
+            return -1;
         }
         if (cache_entry_set_dirty (entry, true) < 0) {
             flux_log_error (kt->ktm->h, "%s: cache_entry_set_dirty",__FUNCTION__);
             int ret;
             ret = cache_remove_entry (kt->ktm->cache, ref);
             assert (ret == 1);
-            goto error;
+            return -1;
         }
         rc = 1;
     }
     *entryp = entry;
+    return rc;
+}
+
+/* Store object 'o' under key 'ref' in local cache.
+ * Object reference is still owned by the caller.
+ * 'is_raw' is as described in store_cache_encode().
+ * Returns -1 on error, 0 on success entry already there, 1 on success
+ * entry needs to be flushed to content store
+ */
+static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
+                        bool is_raw, char *ref, int ref_len,
+                        struct cache_entry **entryp)
+{
+    int saved_errno, rc;
+    char *data = NULL;
+    size_t len;
+
+    if (store_cache_encode (kt, o, is_raw, &data, &len) < 0)
+        return -1;
+    if (blobref_hash (kt->ktm->hash_name, data, len, ref, ref_len) < 0) {
+        flux_log_error (kt->ktm->h, "%s: blobref_hash", __FUNCTION__);
+        goto error;
+    }
+    if ((rc = store_cache_insert (kt, current_epoch, ref, data, len,
+                                  entryp)) < 0)
+        goto error;
     free (data);
     return rc;
 
@@ -326,8 +382,194 @@ static int store_cache (kvstxn_t *kt, int current_epoch, json_t *o,
     return -1;
 }
 
+static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir);
+
+/* Store dir or hdir 'obj' and return a dirref that refers to it.
+ */
+static json_t *kvstxn_store_dir (kvstxn_t *kt, int current_epoch,
+                                 json_t *obj)
+{
+    char ref[BLOBREF_MAX_STRING_SIZE];
+    struct cache_entry *entry;
+    int ret;
+
+    if ((ret = store_cache (kt, current_epoch, obj,
+                            false, ref, sizeof (ref), &entry)) < 0)
+        return NULL;
+    if (ret) {
+        if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
+            kvstxn_cleanup_dirty_cache_entry (kt, entry);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    return treeobj_create_dirref (ref);
+}
+
+static bool kvstxn_should_shard (kvstxn_t *kt, const json_t *dir, int level)
+{
+    return (kt->ktm->shard_threshold > 0
+            && level < TREEOBJ_HDIR_MAXLEVEL
+            && treeobj_get_count (dir) > kt->ktm->shard_threshold);
+}
+
+static json_t *kvstxn_unroll_store (kvstxn_t *kt, int current_epoch,
+                                    json_t *obj, int level);
+
+/* Unroll the modified shards of 'hdir'.  Empty dir shards are removed.
+ * Shards that are still dirrefs were not modified.
+ */
+static int kvstxn_unroll_hdir (kvstxn_t *kt, int current_epoch, json_t *hdir)
+{
+    json_t *shard;
+    json_t *dirref;
+    int level;
+    int i;
+
+    if ((level = treeobj_get_hdir_level (hdir)) < 0)
+        return -1;
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if (!(shard = treeobj_get_shard (hdir, i))
+            || treeobj_is_dirref (shard))
+            continue;
+        if (treeobj_is_dir (shard) && treeobj_get_count (shard) == 0) {
+            if (treeobj_set_shard (hdir, i, NULL) < 0)
+                return -1;
+            continue;
+        }
+        if (!(dirref = kvstxn_unroll_store (kt, current_epoch,
+                                            shard, level + 1)))
+            return -1;
+        if (treeobj_set_shard (hdir, i, dirref) < 0) {
+            json_decref (dirref);
+            return -1;
+        }
+        json_decref (dirref);
+    }
+    return 0;
+}
+
+/* Unroll dir or hdir 'obj' and store it, returning a dirref.  A dir
+ * with more than shard_threshold entries is first split into an hdir
+ * at 'level'.  An hdir left with no shards is stored as an empty dir.
+ */
+static json_t *kvstxn_unroll_store (kvstxn_t *kt, int current_epoch,
+                                    json_t *obj, int level)
+{
+    json_t *tmp = NULL;
+    json_t *dirref = NULL;
+
+    if (treeobj_is_dir (obj)) {
+        if (kvstxn_should_shard (kt, obj, level)) {
+            if (!(tmp = treeobj_hdir_split (obj, level)))
+                return NULL;
+            obj = tmp;
+        }
+        else if (kvstxn_unroll (kt, current_epoch, obj) < 0) /* depth first */
+            return NULL;
+    }
+    if (treeobj_is_hdir (obj)) {
+        if (kvstxn_unroll_hdir (kt, current_epoch, obj) < 0)
+            goto done;
+        if (treeobj_get_count (obj) == 0) {
+            json_decref (tmp);
+            if (!(tmp = treeobj_create_dir ()))
+                return NULL;
+            obj = tmp;
+        }
+    }
+    dirref = kvstxn_store_dir (kt, current_epoch, obj);
+done:
+    json_decref (tmp);
+    return dirref;
+}
+
+/* The large vals of one directory, decoded and waiting to be hashed
+ * together.  'iters' locates each val in the directory.
+ */
+struct valbatch {
+    struct blobref_hashreq *req;
+    void **iters;
+    int count;
+};
+
+static void valbatch_clear (struct valbatch *vb)
+{
+    int saved_errno = errno;
+    int i;
+
+    for (i = 0; i < vb->count; i++)
+        free ((void *)vb->req[i].data);
+    free (vb->req);
+    free (vb->iters);
+    errno = saved_errno;
+}
+
+static int valbatch_add (kvstxn_t *kt, struct valbatch *vb, int maxcount,
+                         json_t *val_data, void *iter)
+{
+    char *data;
+    size_t len;
+
+    if (!vb->req) {
+        if (!(vb->req = calloc (maxcount, sizeof (vb->req[0])))
+            || !(vb->iters = calloc (maxcount, sizeof (vb->iters[0])))) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    if (store_cache_encode (kt, val_data, true, &data, &len) < 0)
+        return -1;
+    vb->req[vb->count].data = data;
+    vb->req[vb->count].len = len;
+    vb->iters[vb->count] = iter;
+    vb->count++;
+    return 0;
+}
+
+/* Hash the batched vals of 'dir' at once, store them, and replace
+ * each with a valref.
+ */
+static int valbatch_store (kvstxn_t *kt, int current_epoch, json_t *dir,
+                           struct valbatch *vb)
+{
+    struct cache_entry *entry;
+    json_t *ktmp;
+    int ret;
+    int i;
+
+    if (blobref_hash_batch (kt->ktm->hash_name, vb->req, vb->count) < 0) {
+        flux_log_error (kt->ktm->h, "%s: blobref_hash_batch", __FUNCTION__);
+        return -1;
+    }
+    for (i = 0; i < vb->count; i++) {
+        if ((ret = store_cache_insert (kt, current_epoch,
+                                       vb->req[i].blobref,
+                                       vb->req[i].data,
+                                       vb->req[i].len,
+                                       &entry)) < 0)
+            return -1;
+        if (ret) {
+            if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
+                kvstxn_cleanup_dirty_cache_entry (kt, entry);
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+        if (!(ktmp = treeobj_create_valref (vb->req[i].blobref)))
+            return -1;
+        if (json_object_iter_set_new (dir, vb->iters[i], ktmp) < 0) {
+            json_decref (ktmp);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /* Store DIRVAL objects, converting them to DIRREFs.
  * Store (large) FILEVAL objects, converting them to FILEREFs.
+ * The FILEVALs of a directory are hashed as one batch.
  * Return 0 on success, -1 on error
  */
 static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir)
@@ -335,10 +577,9 @@ static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir)
     json_t *dir_entry;
     json_t *dir_data;
     json_t *ktmp;
-    char ref[BLOBREF_MAX_STRING_SIZE];
-    int ret;
-    struct cache_entry *entry;
+    struct valbatch vb = { 0 };
     void *iter;
+    int rc = -1;
 
     assert (treeobj_is_dir (dir));
 
@@ -352,56 +593,36 @@ static int kvstxn_unroll (kvstxn_t *kt, int current_epoch, json_t *dir)
      */
     while (iter) {
         dir_entry = json_object_iter_value (iter);
-        if (treeobj_is_dir (dir_entry)) {
-            if (kvstxn_unroll (kt, current_epoch, dir_entry) < 0) /* depth first */
-                return -1;
-            if ((ret = store_cache (kt, current_epoch, dir_entry,
-                                    false, ref, sizeof (ref), &entry)) < 0)
-                return -1;
-            if (ret) {
-                if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
-                    kvstxn_cleanup_dirty_cache_entry (kt, entry);
-                    errno = ENOMEM;
-                    return -1;
-                }
-            }
-            if (!(ktmp = treeobj_create_dirref (ref)))
-                return -1;
+        if (treeobj_is_dir (dir_entry) || treeobj_is_hdir (dir_entry)) {
+            if (!(ktmp = kvstxn_unroll_store (kt, current_epoch,
+                                              dir_entry, 0)))
+                goto done;
             if (json_object_iter_set_new (dir, iter, ktmp) < 0) {
                 json_decref (ktmp);
                 errno = ENOMEM;
-                return -1;
+                goto done;
             }
         }
         else if (treeobj_is_val (dir_entry)) {
             json_t *val_data;
 
             if (!(val_data = treeobj_get_data (dir_entry)))
-                return -1;
+                goto done;
             if (json_string_length (val_data) > BLOBREF_MAX_STRING_SIZE) {
-                if ((ret = store_cache (kt, current_epoch, val_data,
-                                        true, ref, sizeof (ref), &entry)) < 0)
-                    return -1;
-                if (ret) {
-                    if (zlist_push (kt->dirty_cache_entries_list, entry) < 0) {
-                        kvstxn_cleanup_dirty_cache_entry (kt, entry);
-                        errno = ENOMEM;
-                        return -1;
-                    }
-                }
-                if (!(ktmp = treeobj_create_valref (ref)))
-                    return -1;
-                if (json_object_iter_set_new (dir, iter, ktmp) < 0) {
-                    json_decref (ktmp);
-                    errno = ENOMEM;
-                    return -1;
-                }
+                if (valbatch_add (kt, &vb, json_object_size (dir_data),
+                                  val_data, iter) < 0)
+                    goto done;
             }
         }
         iter = json_object_iter_next (dir_data, iter);
     }
-
-    return 0;
+    if (vb.count > 0
+        && valbatch_store (kt, current_epoch, dir, &vb) < 0)
+        goto done;
+    rc = 0;
+done:
+    valbatch_clear (&vb);
+    return rc;
 }
 
 static int kvstxn_val_data_to_cache (kvstxn_t *kt, int current_epoch,
@@ -532,7 +753,8 @@ static int kvstxn_append (kvstxn_t *kt, int current_epoch, json_t *dirent,
         return -1;
     }
     else if (treeobj_is_dir (entry)
-             || treeobj_is_dirref (entry)) {
+             || treeobj_is_dirref (entry)
+             || treeobj_is_hdir (entry)) {
         errno = EISDIR;
         return -1;
     }
@@ -547,6 +769,103 @@ static int kvstxn_append (kvstxn_t *kt, int current_epoch, json_t *dirent,
     return 0;
 }
 
+/* Get the object that 'dirref' refers to from the cache.  If it is
+ * not cached, set 'missing_ref' and return NULL in 'objp', so the
+ * caller can stall.  Return 0 on success, -1 on error with errno set.
+ */
+static int kvstxn_load_dirref (kvstxn_t *kt, int current_epoch,
+                               const json_t *dirref,
+                               const json_t **objp,
+                               const char **missing_ref)
+{
+    struct cache_entry *entry;
+    const char *ref;
+    const json_t *obj;
+    int refcount;
+
+    if ((refcount = treeobj_get_count (dirref)) < 0)
+        return -1;
+
+    if (refcount != 1) {
+        flux_log (kt->ktm->h, LOG_ERR, "invalid dirref count: %d",
+                  refcount);
+        errno = ENOTRECOVERABLE;
+        return -1;
+    }
+
+    if (!(ref = treeobj_get_blobref (dirref, 0)))
+        return -1;
+
+    if (!(entry = cache_lookup (kt->ktm->cache, ref, current_epoch))
+        || !cache_entry_get_valid (entry)) {
+        *missing_ref = ref;
+        *objp = NULL;
+        return 0;
+    }
+
+    if (!(obj = cache_entry_get_treeobj (entry))) {
+        errno = ENOTRECOVERABLE;
+        return -1;
+    }
+    *objp = obj;
+    return 0;
+}
+
+/* Find the dir page of 'hdir' that holds entry 'name', loading and
+ * copying shards along the way so they may be modified.  If a shard
+ * does not exist and 'create' is true, create an empty page.  Return
+ * the page in 'pagep', or NULL if a shard must be loaded first
+ * ('missing_ref' is set) or does not exist.  Return 0 on success, -1 on
+ * error with errno set.
+ */
+static int kvstxn_hdir_page (kvstxn_t *kt, int current_epoch,
+                             json_t *hdir, const char *name, bool create,
+                             json_t **pagep, const char **missing_ref)
+{
+    json_t *dir = hdir;
+    json_t *shard;
+    const json_t *shardktmp;
+    int index;
+
+    while (treeobj_is_hdir (dir)) {
+        if ((index = treeobj_hdir_index (dir, name)) < 0)
+            return -1;
+        if (!(shard = treeobj_get_shard (dir, index))) {
+            if (!create) {
+                *pagep = NULL;
+                return 0;
+            }
+            if (!(shard = treeobj_create_dir ()))
+                return -1;
+            if (treeobj_set_shard (dir, index, shard) < 0) {
+                json_decref (shard);
+                return -1;
+            }
+            json_decref (shard);
+        }
+        else if (treeobj_is_dirref (shard)) {
+            if (kvstxn_load_dirref (kt, current_epoch, shard,
+                                    &shardktmp, missing_ref) < 0)
+                return -1;
+            if (!shardktmp) {
+                *pagep = NULL;
+                return 0; /* stall */
+            }
+            /* do not corrupt store by modifying orig. */
+            if (!(shard = treeobj_deep_copy (shardktmp)))
+                return -1;
+            if (treeobj_set_shard (dir, index, shard) < 0) {
+                json_decref (shard);
+                return -1;
+            }
+            json_decref (shard);
+        }
+        dir = shard;
+    }
+    *pagep = dir;
+    return 0;
+}
+
 /* link (key, dirent) into directory 'dir'.
  */
 static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
@@ -582,6 +901,17 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
     while ((next = strchr (name, '.'))) {
         *next++ = '\0';
 
+        if (treeobj_is_hdir (dir)) {
+            if (kvstxn_hdir_page (kt, current_epoch, dir, name,
+                                  !json_is_null (dirent),
+                                  &dir, missing_ref) < 0) {
+                saved_errno = errno;
+                goto done;
+            }
+            if (!dir) /* stall, or key deletion - it doesn't exist */
+                goto success;
+        }
+
         if (!treeobj_is_dir (dir)) {
             saved_errno = ENOTRECOVERABLE;
             goto done;
@@ -600,41 +930,19 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
                 goto done;
             }
             json_decref (subdir);
-        } else if (treeobj_is_dir (dir_entry)) {
+        } else if (treeobj_is_dir (dir_entry)
+                   || treeobj_is_hdir (dir_entry)) {
             subdir = dir_entry;
         } else if (treeobj_is_dirref (dir_entry)) {
-            struct cache_entry *entry;
-            const char *ref;
             const json_t *subdirktmp;
-            int refcount;
 
-            if ((refcount = treeobj_get_count (dir_entry)) < 0) {
+            if (kvstxn_load_dirref (kt, current_epoch, dir_entry,
+                                    &subdirktmp, missing_ref) < 0) {
                 saved_errno = errno;
                 goto done;
             }
-
-            if (refcount != 1) {
-                flux_log (kt->ktm->h, LOG_ERR, "invalid dirref count: %d",
-                          refcount);
-                saved_errno = ENOTRECOVERABLE;
-                goto done;
-            }
-
-            if (!(ref = treeobj_get_blobref (dir_entry, 0))) {
-                saved_errno = errno;
-                goto done;
-            }
-
-            if (!(entry = cache_lookup (kt->ktm->cache, ref, current_epoch))
-                || !cache_entry_get_valid (entry)) {
-                *missing_ref = ref;
+            if (!subdirktmp)
                 goto success; /* stall */
-            }
-
-            if (!(subdirktmp = cache_entry_get_treeobj (entry))) {
-                saved_errno = ENOTRECOVERABLE;
-                goto done;
-            }
 
             /* do not corrupt store by modifying orig. */
             if (!(subdir = treeobj_deep_copy (subdirktmp))) {
@@ -701,8 +1009,19 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
         dir = subdir;
     }
     /* This is the final path component of the key.  Add/modify/delete
-     * it in the directory.
+     * it in the directory, or in the page of a sharded directory that
+     * holds it.
      */
+    if (treeobj_is_hdir (dir)) {
+        if (kvstxn_hdir_page (kt, current_epoch, dir, name,
+                              !json_is_null (dirent),
+                              &dir, missing_ref) < 0) {
+            saved_errno = errno;
+            goto done;
+        }
+        if (!dir) /* stall, or key deletion - it doesn't exist */
+            goto success;
+    }
     if (!json_is_null (dirent)) {
         if (flags & FLUX_KVS_APPEND) {
             if (kvstxn_append (kt,
@@ -1209,6 +1528,26 @@ void kvstxn_mgr_remove_transaction (kvstxn_mgr_t *ktm, kvstxn_t *kt,
     }
 }
 
+int kvstxn_mgr_set_shard_threshold (kvstxn_mgr_t *ktm, int threshold)
+{
+    if (!ktm || threshold < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    ktm->shard_threshold = threshold;
+    return 0;
+}
+
+int kvstxn_mgr_set_binary (kvstxn_mgr_t *ktm, bool binary)
+{
+    if (!ktm) {
+        errno = EINVAL;
+        return -1;
+    }
+    ktm->binary = binary;
+    return 0;
+}
+
 int kvstxn_mgr_get_noop_stores (kvstxn_mgr_t *ktm)
 {
     return ktm->noop_stores;
@@ -178,6 +178,18 @@ void kvstxn_mgr_remove_transaction (kvstxn_mgr_t *ktm, kvstxn_t *kt,
 int kvstxn_mgr_get_noop_stores (kvstxn_mgr_t *ktm);
 void kvstxn_mgr_clear_noop_stores (kvstxn_mgr_t *ktm);
 
+/* Directories with more than 'threshold' entries are stored as hashed
+ * directories (hdir), so that a transaction that modifies one entry only
+ * stores the shards that hold it.  The root directory is never sharded.
+ * A threshold of 0 (the default) disables sharding.
+ */
+int kvstxn_mgr_set_shard_threshold (kvstxn_mgr_t *ktm, int threshold);
+
+/* Store directories with treeobj_encode_binary() rather than as JSON.
+ * Readers accept either encoding, so this may change at any time.
+ */
+int kvstxn_mgr_set_binary (kvstxn_mgr_t *ktm, bool binary);
+
 /* return count of ready transactions */
 int kvstxn_mgr_ready_transaction_count (kvstxn_mgr_t *ktm);
 
@@ -80,6 +80,20 @@ struct lookup {
     const json_t *valref_missing_refs;
     const char *missing_ref;
 
+    /* dirref listing uncached shards of a hashed directory being read,
+     * iterated via valref_missing_refs.
+     */
+    json_t *missing_shards;
+
+    /* prefetch - if prefetch_fanout > 0, remember the last directory
+     * reference we stalled on in prefetch_ref.  When that directory
+     * is later read, hold it in prefetch_entry so its children can be
+     * returned via lookup_iter_prefetch_refs().
+     */
+    int prefetch_fanout;
+    char *prefetch_ref;
+    struct cache_entry *prefetch_entry;
+
     /* for namespace callback */
 
     char *missing_namespace;
@@ -349,6 +363,208 @@ cleanup:
     return ret;
 }
 
+/* If prefetching is enabled, remember that we are stalling on
+ * directory reference 'ref'.
+ */
+static void prefetch_set_ref (lookup_t *lh, const char *ref)
+{
+    if (lh->prefetch_fanout > 0) {
+        free (lh->prefetch_ref);
+        lh->prefetch_ref = strdup (ref);
+    }
+}
+
+/* Directory 'entry' with reference 'ref' has been read.  If it is the
+ * directory we last stalled on, its children are prefetch candidates.
+ */
+static void prefetch_check_dir (lookup_t *lh,
+                                const char *ref,
+                                struct cache_entry *entry)
+{
+    if (lh->prefetch_ref && !strcmp (lh->prefetch_ref, ref)) {
+        cache_entry_decref (lh->prefetch_entry);
+        lh->prefetch_entry = entry;
+        cache_entry_incref (lh->prefetch_entry);
+        free (lh->prefetch_ref);
+        lh->prefetch_ref = NULL;
+    }
+}
+
+/* Get the blobref of single-blobref 'dirref'.
+ * Return NULL on error with lh->errnum set.
+ */
+static const char *dirref_get_ref (lookup_t *lh, const json_t *dirref)
+{
+    const char *refstr;
+    int refcount;
+
+    if ((refcount = treeobj_get_count (dirref)) < 0) {
+        lh->errnum = errno;
+        return NULL;
+    }
+    if (refcount != 1) {
+        flux_log (lh->h, LOG_ERR, "invalid dirref count: %d", refcount);
+        lh->errnum = ENOTRECOVERABLE;
+        return NULL;
+    }
+    if (!(refstr = treeobj_get_blobref (dirref, 0))) {
+        lh->errnum = errno;
+        return NULL;
+    }
+    return refstr;
+}
+
+/* Descend from hashed directory 'dirp' to the dir page that holds
+ * 'name', updating 'dirp' and 'entryp' to the page and the cache entry
+ * that holds it.  'dirp' is set to NULL if there is no such page.
+ */
+static lookup_process_t walk_hdir (lookup_t *lh,
+                                   const char *name,
+                                   const json_t **dirp,
+                                   struct cache_entry **entryp)
+{
+    const json_t *dir = *dirp;
+    struct cache_entry *entry = *entryp;
+    const json_t *shard;
+    const char *refstr;
+    int index;
+
+    while (treeobj_is_hdir (dir)) {
+        if ((index = treeobj_hdir_index (dir, name)) < 0) {
+            lh->errnum = errno;
+            return LOOKUP_PROCESS_ERROR;
+        }
+        if (!(shard = treeobj_peek_shard (dir, index))) {
+            if (errno != ENOENT) {
+                lh->errnum = errno;
+                return LOOKUP_PROCESS_ERROR;
+            }
+            *dirp = NULL;
+            return LOOKUP_PROCESS_FINISHED;
+        }
+        if (treeobj_is_dirref (shard)) {
+            if (!(refstr = dirref_get_ref (lh, shard)))
+                return LOOKUP_PROCESS_ERROR;
+            if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
+                || !cache_entry_get_valid (entry)) {
+                lh->missing_ref = refstr;
+                prefetch_set_ref (lh, refstr);
+                return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+            }
+            if (!(shard = cache_entry_get_treeobj (entry))) {
+                flux_log (lh->h, LOG_ERR, "shard points to non-treeobj");
+                lh->errnum = ENOTRECOVERABLE;
+                return LOOKUP_PROCESS_ERROR;
+            }
+            prefetch_check_dir (lh, refstr, entry);
+        }
+        if (!treeobj_is_dir (shard) && !treeobj_is_hdir (shard)) {
+            lh->errnum = ENOTRECOVERABLE;
+            return LOOKUP_PROCESS_ERROR;
+        }
+        dir = shard;
+    }
+    *dirp = dir;
+    *entryp = entry;
+    return LOOKUP_PROCESS_FINISHED;
+}
+
+/* Copy the entries of hashed directory 'hdir' into 'dir'.  Shards that
+ * are not cached are added to lh->missing_shards.
+ * Return 0 on success, -1 on error with lh->errnum set.
+ */
+static int hdir_flatten (lookup_t *lh, const json_t *hdir, json_t *dir)
+{
+    struct cache_entry *entry;
+    const json_t *shard;
+    const char *refstr;
+    const char *name;
+    json_t *dirent;
+    json_t *cpy;
+    int i;
+
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if (!(shard = treeobj_peek_shard (hdir, i)))
+            continue;
+        if (treeobj_is_dirref (shard)) {
+            if (!(refstr = dirref_get_ref (lh, shard)))
+                return -1;
+            if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
+                || !cache_entry_get_valid (entry)) {
+                if (!lh->missing_shards
+                    && !(lh->missing_shards = treeobj_create_dirref (NULL))) {
+                    lh->errnum = errno;
+                    return -1;
+                }
+                if (treeobj_append_blobref (lh->missing_shards, refstr) < 0) {
+                    lh->errnum = errno;
+                    return -1;
+                }
+                continue;
+            }
+            if (!(shard = cache_entry_get_treeobj (entry))) {
+                flux_log (lh->h, LOG_ERR, "shard points to non-treeobj");
+                lh->errnum = ENOTRECOVERABLE;
+                return -1;
+            }
+        }
+        if (treeobj_is_hdir (shard)) {
+            if (hdir_flatten (lh, shard, dir) < 0)
+                return -1;
+        }
+        else if (treeobj_is_dir (shard)) {
+            json_object_foreach (treeobj_get_data ((json_t *)shard),
+                                 name,
+                                 dirent) {
+                if (!(cpy = treeobj_deep_copy (dirent))
+                    || treeobj_insert_entry_novalidate (dir, name, cpy) < 0) {
+                    lh->errnum = errno;
+                    json_decref (cpy);
+                    return -1;
+                }
+                json_decref (cpy);
+            }
+        }
+        else {
+            lh->errnum = ENOTRECOVERABLE;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Read hashed directory 'hdir' into a flat dir in lh->val, so callers
+ * of READDIR need not know the directory is sharded.
+ * Return 0 on success, -1 on error with lh->errnum set.  On success,
+ * stall should be checked.
+ */
+static int get_hdir_value (lookup_t *lh, const json_t *hdir, bool *stall)
+{
+    json_t *dir;
+
+    lh->valref_missing_refs = NULL;
+    json_decref (lh->missing_shards);
+    lh->missing_shards = NULL;
+
+    if (!(dir = treeobj_create_dir ())) {
+        lh->errnum = errno;
+        return -1;
+    }
+    if (hdir_flatten (lh, hdir, dir) < 0) {
+        json_decref (dir);
+        return -1;
+    }
+    if (lh->missing_shards) {
+        json_decref (dir);
+        lh->valref_missing_refs = lh->missing_shards;
+        (*stall) = true;
+        return 0;
+    }
+    lh->val = dir;
+    (*stall) = false;
+    return 0;
+}
+
 /* Get dirent of the requested path starting at the given root.
  *
  * Return true on success or error, error code is returned in ep and
@@ -396,6 +612,7 @@ static lookup_process_t walk (lookup_t *lh)
             if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
                 || !cache_entry_get_valid (entry)) {
                 lh->missing_ref = refstr;
+                prefetch_set_ref (lh, refstr);
                 return LOOKUP_PROCESS_LOAD_MISSING_REFS;
             }
             if (!(dir = cache_entry_get_treeobj (entry))) {
@@ -409,7 +626,7 @@ static lookup_process_t walk (lookup_t *lh)
                     lh->errnum = ENOTRECOVERABLE;
                 goto error;
             }
-            if (!treeobj_is_dir (dir)) {
+            if (!treeobj_is_dir (dir) && !treeobj_is_hdir (dir)) {
                 /* dirref pointed to non-dir error, special case when
                  * root_dirent is bad, is EINVAL from user.
                  */
@@ -419,6 +636,7 @@ static lookup_process_t walk (lookup_t *lh)
                     lh->errnum = ENOTRECOVERABLE;
                 goto error;
             }
+            prefetch_check_dir (lh, refstr, entry);
         } else {
             /* Unexpected dirent type */
             if (treeobj_is_valref (wl->dirent)
@@ -440,6 +658,21 @@ static lookup_process_t walk (lookup_t *lh)
             }
         }
 
+        /* Get dir page of a hashed directory that holds path component */
+
+        if (treeobj_is_hdir (dir)) {
+            lookup_process_t hret;
+
+            hret = walk_hdir (lh, pathcomp, &dir, &entry);
+            if (hret != LOOKUP_PROCESS_FINISHED) {
+                if (hret == LOOKUP_PROCESS_ERROR)
+                    goto error;
+                return hret;
+            }
+            if (!dir)
+                goto done;
+        }
+
         /* Get directory reference of path component from directory */
 
         if (!(dirent_tmp = treeobj_peek_entry (dir, pathcomp))) {
@@ -601,6 +834,9 @@ void lookup_destroy (lookup_t *lh)
         json_decref (lh->val);
         free (lh->missing_namespace);
         zlist_destroy (&lh->levels);
+        json_decref (lh->missing_shards);
+        free (lh->prefetch_ref);
+        cache_entry_decref (lh->prefetch_entry);
         free (lh);
     }
 }
@@ -653,7 +889,8 @@ int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data)
         if (lh->valref_missing_refs) {
             int refcount, i;
 
-            if (!treeobj_is_valref (lh->valref_missing_refs)) {
+            if (!treeobj_is_valref (lh->valref_missing_refs)
+                && !treeobj_is_dirref (lh->valref_missing_refs)) {
                 errno = ENOTRECOVERABLE;
                 return -1;
             }
@@ -688,6 +925,57 @@ int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data)
     return -1;
 }
 
+int lookup_set_prefetch (lookup_t *lh, int fanout)
+{
+    if (!lh || fanout < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    lh->prefetch_fanout = fanout;
+    return 0;
+}
+
+int lookup_iter_prefetch_refs (lookup_t *lh, lookup_ref_f cb, void *data)
+{
+    const json_t *dir;
+    json_t *entries;
+    const char *name;
+    json_t *dirent;
+    int count = 0;
+
+    if (!lh || !cb) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!lh->prefetch_entry
+        || !(dir = cache_entry_get_treeobj (lh->prefetch_entry))
+        || !(entries = treeobj_get_data ((json_t *)dir)))
+        return 0;
+    json_object_foreach (entries, name, dirent) {
+        int refcount, i;
+
+        if (!treeobj_is_dirref (dirent) && !treeobj_is_valref (dirent))
+            continue;
+        if ((refcount = treeobj_get_count (dirent)) < 0)
+            return -1;
+        for (i = 0; i < refcount; i++) {
+            const char *ref;
+
+            if (count == lh->prefetch_fanout)
+                return 0;
+            if (!(ref = treeobj_get_blobref (dirent, i)))
+                return -1;
+            /* skip refs that are cached or already in transit */
+            if (cache_lookup (lh->cache, ref, lh->current_epoch))
+                continue;
+            if (cb (lh, ref, data) < 0)
+                return -1;
+            count++;
+        }
+    }
+    return 0;
+}
+
 const char *lookup_missing_namespace (lookup_t *lh)
 {
    if (lh
@@ -920,6 +1208,10 @@ lookup_process_t lookup (lookup_t *lh)
     if (lh->errnum)
         return LOOKUP_PROCESS_ERROR;
 
+    /* prefetch candidates are only returned once */
+    cache_entry_decref (lh->prefetch_entry);
+    lh->prefetch_entry = NULL;
+
     if (lh->state != LOOKUP_STATE_INIT
         && lh->state != LOOKUP_STATE_FINISHED)
         is_replay = true;
@@ -987,6 +1279,7 @@ lookup_process_t lookup (lookup_t *lh)
                                                 lh->current_epoch))
                         || !cache_entry_get_valid (entry)) {
                         lh->missing_ref = lh->root_ref;
+                        prefetch_set_ref (lh, lh->root_ref);
                         return LOOKUP_PROCESS_LOAD_MISSING_REFS;
                     }
                     if (!(valtmp = cache_entry_get_treeobj (entry))) {
@@ -1000,6 +1293,7 @@ lookup_process_t lookup (lookup_t *lh)
                         lh->errnum = ENOTRECOVERABLE;
                         goto error;
                     }
+                    prefetch_check_dir (lh, lh->root_ref, entry);
                     if (!(lh->val = treeobj_deep_copy (valtmp))) {
                         lh->errnum = errno;
                         goto error;
@@ -1086,6 +1380,7 @@ lookup_process_t lookup (lookup_t *lh)
                                             lh->current_epoch))
                     || !cache_entry_get_valid (entry)) {
                     lh->missing_ref = reftmp;
+                    prefetch_set_ref (lh, reftmp);
                     return LOOKUP_PROCESS_LOAD_MISSING_REFS;
                 }
                 if (!(valtmp = cache_entry_get_treeobj (entry))) {
@@ -1093,11 +1388,21 @@ lookup_process_t lookup (lookup_t *lh)
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
+                if (treeobj_is_hdir (valtmp)) {
+                    bool stall;
+
+                    if (get_hdir_value (lh, valtmp, &stall) < 0)
+                        goto error;
+                    if (stall)
+                        return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+                    goto done;
+                }
                 if (!treeobj_is_dir (valtmp)) {
                     /* dirref points to not dir */
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
+                prefetch_check_dir (lh, reftmp, entry);
                 if (!(lh->val = treeobj_deep_copy (valtmp))) {
                     lh->errnum = errno;
                     goto error;
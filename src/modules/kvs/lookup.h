@@ -75,6 +75,20 @@ json_t *lookup_get_value (lookup_t *lh);
  */
 int lookup_iter_missing_refs (lookup_t *lh, lookup_ref_f cb, void *data);
 
+/* Enable prefetching of up to 'fanout' child references of each
+ * directory that the lookup stalled on, once that directory has been
+ * loaded.  A fanout of 0 (the default) disables prefetching.
+ */
+int lookup_set_prefetch (lookup_t *lh, int fanout);
+
+/* After lookup() returns, get child references of a newly loaded
+ * directory that are not yet in the KVS cache.  Caller may load these
+ * into the KVS cache in the background, but should not stall on them.
+ *
+ * return -1 in callback to break iteration
+ */
+int lookup_iter_prefetch_refs (lookup_t *lh, lookup_ref_f cb, void *data);
+
 /* On lookup stall b/c of missing namespace, get missing namespace
  * returned by this function.
  *
@@ -2697,6 +2697,92 @@ void kvstxn_process_big_fileval (void)
     json_decref (root);
 }
 
+/* Several big values in one directory are hashed as a batch.  Use an
+ * odd count so that both paired and unpaired hashing are exercised.
+ */
+void kvstxn_process_big_fileval_batch (void)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    kvstxn_t *kt;
+    json_t *root;
+    json_t *ops;
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+    const char *newroot;
+    const char *keys[] = { "dir.a", "dir.b", "dir.c" };
+    int bigstrsize = BLOBREF_MAX_STRING_SIZE * 4;
+    char bigstr[3][bigstrsize];
+    struct cache_count cache_count;
+    int i;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    root = treeobj_create_dir ();
+    ok (treeobj_hash ("sha256", root, root_ref, sizeof (root_ref)) == 0,
+        "treeobj_hash worked");
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref);
+
+    ok ((ktm = kvstxn_mgr_create (cache,
+                                  KVS_PRIMARY_NAMESPACE,
+                                  "sha256",
+                                  NULL,
+                                  &test_global)) != NULL,
+        "kvstxn_mgr_create works");
+
+    ops = json_array ();
+    for (i = 0; i < 3; i++) {
+        memset (bigstr[i], 'a' + i, bigstrsize - 1 - i * 7);
+        bigstr[i][bigstrsize - 1 - i * 7] = '\0';
+        ops_append (ops, keys[i], bigstr[i], 0);
+    }
+    ops_append (ops, "dir.small", "smallstr", 0);
+    ok (kvstxn_mgr_add_transaction (ktm, "transaction1", ops, 0) == 0,
+        "kvstxn_mgr_add_transaction works");
+    json_decref (ops);
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    ok (kvstxn_process (kt, 1, root_ref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    cache_count.treeobj_count = 0;
+    cache_count.total_count = 0;
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_count_treeobj_cb,
+                                         &cache_count) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    /* root and dir are treeobjs, the three big values are raw */
+
+    ok (cache_count.treeobj_count == 2,
+        "correct number of cache entries were treeobj");
+
+    ok (cache_count.total_count == 5,
+        "correct number of cache entries were dirty");
+
+    ok (kvstxn_process (kt, 1, root_ref) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    ok ((newroot = kvstxn_get_newroot_ref (kt)) != NULL,
+        "kvstxn_get_newroot_ref returns != NULL when processing complete");
+
+    for (i = 0; i < 3; i++)
+        verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                      keys[i], bigstr[i]);
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot,
+                  "dir.small", "smallstr");
+
+    kvstxn_mgr_destroy (ktm);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+    json_decref (root);
+}
+
 /* Test giant directory entry, as large json objects will iterate through
  * their entries randomly based on the internal hash data structure.
  */
@@ -2828,6 +2914,303 @@ void kvstxn_process_giant_dir (void)
     json_decref (root);
 }
 
+int cache_clean_cb (kvstxn_t *kt, struct cache_entry *entry, void *data)
+{
+    int *count = data;
+
+    if (count)
+        (*count)++;
+    return cache_entry_set_dirty (entry, false);
+}
+
+/* Get the object referred to by dirref 'name' in root directory
+ * 'root_ref' from the cache.
+ */
+static const json_t *cache_get_subdir (struct cache *cache,
+                                       const char *root_ref,
+                                       const char *name)
+{
+    struct cache_entry *entry;
+    const json_t *root;
+    const json_t *dirref;
+    const char *ref;
+
+    if (!(entry = cache_lookup (cache, root_ref, 1))
+        || !(root = cache_entry_get_treeobj (entry))
+        || !(dirref = treeobj_peek_entry (root, name))
+        || !(ref = treeobj_get_blobref (dirref, 0))
+        || !(entry = cache_lookup (cache, ref, 1)))
+        return NULL;
+    return cache_entry_get_treeobj (entry);
+}
+
+void kvstxn_process_shard_dir (void)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    kvstxn_t *kt;
+    lookup_t *lh;
+    json_t *ops;
+    json_t *o;
+    json_t *shardcpy;
+    const json_t *hdir;
+    const json_t *shard;
+    const char *ref;
+    char rootref[BLOBREF_MAX_STRING_SIZE];
+    char newroot[BLOBREF_MAX_STRING_SIZE];
+    char shardref[BLOBREF_MAX_STRING_SIZE];
+    char key[64];
+    char val[64];
+    struct flux_msg_cred cred = { .rolemask = FLUX_ROLE_OWNER, .userid = 0 };
+    int count;
+    int i;
+
+    cache = create_cache_with_empty_rootdir (rootref, sizeof (rootref));
+
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, ref_dummy);
+
+    ok ((ktm = kvstxn_mgr_create (cache,
+                                  KVS_PRIMARY_NAMESPACE,
+                                  "sha1",
+                                  NULL,
+                                  &test_global)) != NULL,
+        "kvstxn_mgr_create works");
+
+    errno = 0;
+    ok (kvstxn_mgr_set_shard_threshold (ktm, -1) < 0 && errno == EINVAL,
+        "kvstxn_mgr_set_shard_threshold fails with EINVAL on bad threshold");
+    ok (kvstxn_mgr_set_shard_threshold (ktm, 4) == 0,
+        "kvstxn_mgr_set_shard_threshold works");
+
+    /* store a directory larger than the threshold */
+
+    ops = json_array ();
+    for (i = 0; i < 100; i++) {
+        snprintf (key, sizeof (key), "dir.key%d", i);
+        snprintf (val, sizeof (val), "%d", i);
+        ops_append (ops, key, val, 0);
+    }
+    ok (kvstxn_mgr_add_transaction (ktm, "transaction1", ops, 0) == 0,
+        "kvstxn_mgr_add_transaction works");
+    json_decref (ops);
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_clean_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt));
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+
+    ok ((hdir = cache_get_subdir (cache, newroot, "dir")) != NULL
+        && treeobj_is_hdir (hdir),
+        "directory was stored as hdir");
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key0", "0");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key57", "57");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key99", "99");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key100", NULL);
+
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             newroot,
+                             0,
+                             "dir",
+                             cred,
+                             FLUX_KVS_READDIR,
+                             NULL)) != NULL,
+        "lookup_create dir with FLUX_KVS_READDIR");
+    ok (lookup (lh) == LOOKUP_PROCESS_FINISHED,
+        "lookup found result");
+    ok ((o = lookup_get_value (lh)) != NULL
+        && treeobj_is_dir (o)
+        && treeobj_get_count (o) == 100,
+        "lookup_get_value returns flat dir with all entries");
+    json_decref (o);
+    lookup_destroy (lh);
+
+    /* modify one entry, only the path to its shard is stored */
+
+    create_ready_kvstxn (ktm, "transaction2", "dir.key3", "foo", 0, 0);
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    count = 0;
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_clean_cb, &count) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (count > 0 && count <= TREEOBJ_HDIR_MAXLEVEL + 2,
+        "only root, hdirs, and one shard were stored (%d)", count);
+
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt));
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key3", "foo");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key4", "4");
+
+    /* a shard missing from the cache stalls the transaction */
+
+    ok ((hdir = cache_get_subdir (cache, newroot, "dir")) != NULL
+        && (shard = treeobj_peek_shard (hdir,
+                                        treeobj_hdir_index (hdir, "key5")))
+        && (ref = treeobj_get_blobref (shard, 0)),
+        "found shard holding dir.key5");
+    strcpy (shardref, ref);
+    shardcpy = treeobj_deep_copy (cache_entry_get_treeobj (
+                                        cache_lookup (cache, shardref, 1)));
+    ok (cache_remove_entry (cache, shardref) == 1,
+        "removed shard from cache");
+
+    /* NULL value --> delete */
+    create_ready_kvstxn (ktm, "transaction3", "dir.key5", NULL, 0, 0);
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_LOAD_MISSING_REFS,
+        "kvstxn_process returns KVSTXN_PROCESS_LOAD_MISSING_REFS");
+
+    count = 0;
+    ok (kvstxn_iter_missing_refs (kt, missingref_count_cb, &count) == 0
+        && count == 1,
+        "kvstxn_iter_missing_refs returns the missing shard");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (shardref, shardcpy));
+
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_clean_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt));
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key5", NULL);
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key6", "6");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key3", "foo");
+
+    kvstxn_mgr_destroy (ktm);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+    json_decref (shardcpy);
+}
+
+void kvstxn_process_binary (void)
+{
+    struct cache *cache;
+    struct cache_entry *entry;
+    kvsroot_mgr_t *krm;
+    kvstxn_mgr_t *ktm;
+    kvstxn_t *kt;
+    const json_t *dir;
+    const void *data;
+    int len;
+    char rootref[BLOBREF_MAX_STRING_SIZE];
+    char newroot[BLOBREF_MAX_STRING_SIZE];
+
+    cache = create_cache_with_empty_rootdir (rootref, sizeof (rootref));
+
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, ref_dummy);
+
+    ok ((ktm = kvstxn_mgr_create (cache,
+                                  KVS_PRIMARY_NAMESPACE,
+                                  "sha1",
+                                  NULL,
+                                  &test_global)) != NULL,
+        "kvstxn_mgr_create works");
+
+    errno = 0;
+    ok (kvstxn_mgr_set_binary (NULL, true) < 0 && errno == EINVAL,
+        "kvstxn_mgr_set_binary fails with EINVAL on NULL ktm");
+    ok (kvstxn_mgr_set_binary (ktm, true) == 0,
+        "kvstxn_mgr_set_binary works");
+
+    create_ready_kvstxn (ktm, "transaction1", "dir.key1", "1", 0, 0);
+    create_ready_kvstxn (ktm, "transaction2", "key2", "2", 0, 0);
+
+    ok (kvstxn_mgr_merge_ready_transactions (ktm) == 0,
+        "kvstxn_mgr_merge_ready_transactions success");
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES,
+        "kvstxn_process returns KVSTXN_PROCESS_DIRTY_CACHE_ENTRIES");
+
+    ok (kvstxn_iter_dirty_cache_entries (kt, cache_clean_cb, NULL) == 0,
+        "kvstxn_iter_dirty_cache_entries works for dirty cache entries");
+
+    ok (kvstxn_process (kt, 1, rootref) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    strcpy (newroot, kvstxn_get_newroot_ref (kt));
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+
+    ok ((entry = cache_lookup (cache, newroot, 1)) != NULL
+        && cache_entry_get_raw (entry, &data, &len) == 0
+        && len > 0
+        && ((const char *)data)[0] == '\0',
+        "root directory was stored in binary encoding");
+    ok ((dir = cache_get_subdir (cache, newroot, "dir")) != NULL
+        && treeobj_is_dir (dir)
+        && treeobj_get_count (dir) == 1,
+        "subdirectory can be read back from binary encoding");
+
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "dir.key1", "1");
+    verify_value (cache, krm, KVS_PRIMARY_NAMESPACE, newroot, "key2", "2");
+
+    /* empty root is stored as JSON, like the initial root
+     */
+    create_ready_kvstxn (ktm, "transaction3", "dir", NULL, 0, 0);
+    create_ready_kvstxn (ktm, "transaction4", "key2", NULL, 0, 0);
+
+    ok (kvstxn_mgr_merge_ready_transactions (ktm) == 0,
+        "kvstxn_mgr_merge_ready_transactions success");
+
+    ok ((kt = kvstxn_mgr_get_ready_transaction (ktm)) != NULL,
+        "kvstxn_mgr_get_ready_transaction returns ready kvstxn");
+
+    /* the empty root is already in the cache, so nothing is dirty
+     */
+    ok (kvstxn_process (kt, 1, newroot) == KVSTXN_PROCESS_FINISHED,
+        "kvstxn_process returns KVSTXN_PROCESS_FINISHED");
+
+    ok (!strcmp (kvstxn_get_newroot_ref (kt), rootref),
+        "empty root directory has the same blobref as the initial root");
+    kvstxn_mgr_remove_transaction (ktm, kt, false);
+
+    kvstxn_mgr_destroy (ktm);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+}
+
 void kvstxn_process_append (void)
 {
     struct cache *cache;
@@ -3398,7 +3781,10 @@ int main (int argc, char *argv[])
     kvstxn_process_delete_filevalinpath_test ();
     kvstxn_process_bad_dirrefs ();
     kvstxn_process_big_fileval ();
+    kvstxn_process_big_fileval_batch ();
     kvstxn_process_giant_dir ();
+    kvstxn_process_shard_dir ();
+    kvstxn_process_binary ();
     kvstxn_process_append ();
     kvstxn_process_append_errors ();
     kvstxn_process_append_no_duplicate ();
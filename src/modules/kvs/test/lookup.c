@@ -3499,6 +3499,353 @@ void lookup_stall_ref_expire_cache_entries (void) {
     json_decref (root);
 }
 
+/* lookup prefetch tests */
+void lookup_prefetch (void) {
+    json_t *root;
+    json_t *dirref1;
+    json_t *dirref2;
+    json_t *test;
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    lookup_t *lh;
+    struct lookup_ref_data ld;
+    char valref1_ref[BLOBREF_MAX_STRING_SIZE];
+    char valref2_ref[BLOBREF_MAX_STRING_SIZE];
+    char valref3_ref[BLOBREF_MAX_STRING_SIZE];
+    char dirref1_ref[BLOBREF_MAX_STRING_SIZE];
+    char dirref2_ref[BLOBREF_MAX_STRING_SIZE];
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    /* This cache is
+     *
+     * dirref1_ref
+     * "val" : val to "foo"
+     * "valref1" : valref to valref1_ref
+     * "valref2" : valref to valref2_ref
+     * "valref3" : valref to valref3_ref
+     *
+     * dirref2_ref
+     * "val" : val to "bar"
+     *
+     * root_ref
+     * "dirref1" : dirref to dirref1_ref
+     * "dirref2" : dirref to dirref2_ref
+     */
+
+    blobref_hash ("sha1", "abcd", 4, valref1_ref, sizeof (valref1_ref));
+    blobref_hash ("sha1", "efgh", 4, valref2_ref, sizeof (valref2_ref));
+    blobref_hash ("sha1", "ijkl", 4, valref3_ref, sizeof (valref3_ref));
+
+    dirref1 = treeobj_create_dir ();
+    _treeobj_insert_entry_val (dirref1, "val", "foo", 3);
+    _treeobj_insert_entry_valref (dirref1, "valref1", valref1_ref);
+    _treeobj_insert_entry_valref (dirref1, "valref2", valref2_ref);
+    _treeobj_insert_entry_valref (dirref1, "valref3", valref3_ref);
+    treeobj_hash ("sha1", dirref1, dirref1_ref, sizeof (dirref1_ref));
+
+    dirref2 = treeobj_create_dir ();
+    _treeobj_insert_entry_val (dirref2, "val", "bar", 3);
+    treeobj_hash ("sha1", dirref2, dirref2_ref, sizeof (dirref2_ref));
+
+    root = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (root, "dirref1", dirref1_ref);
+    _treeobj_insert_entry_dirref (root, "dirref2", dirref2_ref);
+    treeobj_hash ("sha1", root, root_ref, sizeof (root_ref));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref, 0);
+
+    /* prefetch disabled by default */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "dirref1.val",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create prefetch dirref1.val");
+    check_stall (lh, EAGAIN, 1, root_ref, "dirref1.val no prefetch stall #1");
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+    check_stall (lh, EAGAIN, 1, dirref1_ref, "dirref1.val no prefetch stall #2");
+    ld.count = 0;
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 0,
+        "lookup_iter_prefetch_refs returns no refs by default");
+    lookup_destroy (lh);
+
+    ok (lookup_set_prefetch (NULL, 1) < 0 && errno == EINVAL,
+        "lookup_set_prefetch fails on NULL lookup handle");
+
+    /* dirref2 is already cached, it is not prefetched */
+    (void)cache_insert (cache, create_cache_entry_treeobj (dirref2_ref, dirref2));
+    (void)cache_remove_entry (cache, root_ref);
+
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "dirref1.val",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create prefetch dirref1.val");
+    ok (lookup_set_prefetch (lh, -1) < 0 && errno == EINVAL,
+        "lookup_set_prefetch fails on negative fanout");
+    ok (lookup_set_prefetch (lh, 2) == 0,
+        "lookup_set_prefetch fanout=2 works");
+    check_stall (lh, EAGAIN, 1, root_ref, "dirref1.val prefetch stall #1");
+    ld.count = 0;
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 0,
+        "lookup_iter_prefetch_refs returns no refs before root is loaded");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+
+    check_stall (lh, EAGAIN, 1, dirref1_ref, "dirref1.val prefetch stall #2");
+    ld.count = 0;
+    ld.ref = NULL;
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 1
+        && ld.ref != NULL
+        && !strcmp (ld.ref, dirref1_ref),
+        "lookup_iter_prefetch_refs returns uncached child of loaded root");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (dirref1_ref, dirref1));
+
+    test = treeobj_create_val ("foo", 3);
+    check_common (lh,
+                  LOOKUP_PROCESS_FINISHED,
+                  0,
+                  false,
+                  test,
+                  1,
+                  NULL,
+                  "dirref1.val prefetch",
+                  false);
+    json_decref (test);
+    ld.count = 0;
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 2,
+        "lookup_iter_prefetch_refs returns children of dirref1 up to fanout");
+
+    (void)lookup (lh);
+    ld.count = 0;
+    ok (lookup_iter_prefetch_refs (lh, lookup_ref, &ld) == 0
+        && ld.count == 0,
+        "lookup_iter_prefetch_refs returns refs only once");
+    lookup_destroy (lh);
+
+    cache_destroy (cache);
+    kvsroot_mgr_destroy (krm);
+    json_decref (dirref1);
+    json_decref (dirref2);
+    json_decref (root);
+}
+
+/* lookup tests on a hashed directory */
+void lookup_hdir (void) {
+    json_t *root;
+    json_t *dir;
+    json_t *hdir;
+    json_t *sub;
+    json_t *dirref;
+    json_t *test;
+    json_t *shards[TREEOBJ_HDIR_FANOUT] = { NULL };
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    lookup_t *lh;
+    char shard_refs[TREEOBJ_HDIR_FANOUT][BLOBREF_MAX_STRING_SIZE];
+    char hdir_ref[BLOBREF_MAX_STRING_SIZE];
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+    char key[64];
+    char val[64];
+    int nested;
+    int index;
+    int nshards = 0;
+    int i;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+
+    /* This cache is
+     *
+     * shard_refs[i]
+     * shard i of hdir_ref, a dir, except for the shard holding "key0",
+     * which is an hdir one level down with dir shards
+     *
+     * hdir_ref
+     * hdir at level 0 with dirref shards to shard_refs[i]
+     * holding "key0" : val to "0" ... "key255" : val to "255"
+     *
+     * root_ref
+     * "hdir" : dirref to hdir_ref
+     *
+     * Shards are not inserted into the cache until later.
+     */
+
+    dir = treeobj_create_dir ();
+    for (i = 0; i < 256; i++) {
+        snprintf (key, sizeof (key), "key%d", i);
+        snprintf (val, sizeof (val), "%d", i);
+        _treeobj_insert_entry_val (dir, key, val, strlen (val));
+    }
+    if (!(hdir = treeobj_hdir_split (dir, 0)))
+        BAIL_OUT ("treeobj_hdir_split failed");
+    nested = treeobj_hdir_index (hdir, "key0");
+    if (!(sub = treeobj_hdir_split (treeobj_peek_shard (hdir, nested), 1))
+        || treeobj_set_shard (hdir, nested, sub) < 0)
+        BAIL_OUT ("could not split shard holding key0");
+    json_decref (sub);
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if (!(shards[i] = treeobj_get_shard (hdir, i)))
+            continue;
+        json_incref (shards[i]);
+        treeobj_hash ("sha1",
+                      shards[i],
+                      shard_refs[i],
+                      sizeof (shard_refs[i]));
+        dirref = treeobj_create_dirref (shard_refs[i]);
+        treeobj_set_shard (hdir, i, dirref);
+        json_decref (dirref);
+        nshards++;
+    }
+    treeobj_hash ("sha1", hdir, hdir_ref, sizeof (hdir_ref));
+
+    root = treeobj_create_dir ();
+    _treeobj_insert_entry_dirref (root, "hdir", hdir_ref);
+    treeobj_hash ("sha1", root, root_ref, sizeof (root_ref));
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+    (void)cache_insert (cache, create_cache_entry_treeobj (hdir_ref, hdir));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref, 0);
+
+    /* lookup hdir.key5, should stall on its shard, then succeed */
+    index = treeobj_hdir_index (hdir, "key5");
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir.key5",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create stalltest hdir.key5");
+    check_stall (lh, EAGAIN, 1, shard_refs[index], "hdir.key5 stall");
+
+    (void)cache_insert (cache, create_cache_entry_treeobj (shard_refs[index],
+                                                           shards[index]));
+
+    test = treeobj_create_val ("5", 1);
+    check_value (lh, test, "hdir.key5 after stall");
+    json_decref (test);
+
+    /* readdir hdir, should stall on all shards not yet cached */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir",
+                             owner_cred,
+                             FLUX_KVS_READDIR,
+                             NULL)) != NULL,
+        "lookup_create stalltest readdir hdir");
+    check_stall (lh, EAGAIN, nshards - 1, NULL, "readdir hdir stall");
+
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++) {
+        if (shards[i] && i != index)
+            (void)cache_insert (cache,
+                                create_cache_entry_treeobj (shard_refs[i],
+                                                            shards[i]));
+    }
+
+    /* readdir returns the entries of all shards in one flat dir */
+    check_value (lh, dir, "readdir hdir after stall");
+
+    /* lookup hdir.key0, walks through the nested hdir */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir.key0",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create hdir.key0");
+    test = treeobj_create_val ("0", 1);
+    check_value (lh, test, "hdir.key0 in nested hdir");
+    json_decref (test);
+
+    /* lookup hdir.key255 */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir.key255",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create hdir.key255");
+    test = treeobj_create_val ("255", 3);
+    check_value (lh, test, "hdir.key255");
+    json_decref (test);
+
+    /* lookup hdir.nokey, returns no value */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir.nokey",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create hdir.nokey");
+    check_value (lh, NULL, "hdir.nokey");
+
+    /* lookup hdir.key5.foo, val in path */
+    ok ((lh = lookup_create (cache,
+                             krm,
+                             1,
+                             KVS_PRIMARY_NAMESPACE,
+                             NULL,
+                             0,
+                             "hdir.key5.foo",
+                             owner_cred,
+                             0,
+                             NULL)) != NULL,
+        "lookup_create hdir.key5.foo");
+    check_value (lh, NULL, "hdir.key5.foo");
+
+    for (i = 0; i < TREEOBJ_HDIR_FANOUT; i++)
+        json_decref (shards[i]);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+    json_decref (root);
+    json_decref (hdir);
+    json_decref (dir);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -3521,6 +3868,8 @@ int main (int argc, char *argv[])
     lookup_stall_ref ();
     lookup_stall_namespace_removed ();
     lookup_stall_ref_expire_cache_entries ();
+    lookup_prefetch ();
+    lookup_hdir ();
 
     done_testing ();
     return (0);
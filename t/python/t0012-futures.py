@@ -222,6 +222,34 @@ class TestHandle(unittest.TestCase):
         fut = self.f.service_unregister("rpctest")
         self.assertEqual(self.f.future_get(fut, ffi.NULL), 0)
 
+    def test_08_rpc_batch(self):
+        batch = self.f.rpc_batch()
+        for seq in six.moves.range(10):
+            index = batch.add("broker.ping", {"seq": seq})
+            self.assertEqual(index, seq)
+        batch.add("job-ingest.submit", {"J": "", "urgency": -1000, "flags": 0})
+        self.assertEqual(len(batch), 11)
+        batch.send()
+        for seq in six.moves.range(10):
+            self.assertEqual(batch.get(seq)["seq"], seq)
+        with self.assertRaises(EnvironmentError) as cm:
+            batch.get(10)
+        self.assertEqual(cm.exception.errno, errno.EINVAL)
+        self.assertRegexpMatches(cm.exception.strerror, "urgency range is .*")
+
+    def test_08_rpc_batch_then(self):
+        def then_cb(future, arg):
+            arg["responses"] = future.get()[:2]
+            self.f.reactor_stop()
+
+        arg = {}
+        batch = self.f.rpc_batch()
+        batch.add("broker.ping", {"seq": 0})
+        batch.add("broker.ping", {"seq": 1})
+        batch.send().then(then_cb, arg)
+        self.f.reactor_run()
+        self.assertEqual([r["seq"] for r in arg["responses"]], [0, 1])
+
 
 if __name__ == "__main__":
     if rerun_under_flux(__flux_size()):
@@ -191,6 +191,24 @@ test_expect_success 'flux module stats gets comms statistics' '
 	grep -q "#keepalive (rx)" comms.stats
 '
 
+test_expect_success 'flux module stats gets dispatch statistics' '
+	flux module stats $TESTMOD >dispatch.stats &&
+	grep -q "#dispatch (wakeups)" dispatch.stats &&
+	grep -q "#dispatch (messages)" dispatch.stats &&
+	grep -q "#dispatch (exhausted)" dispatch.stats &&
+	grep -q "#dispatch (max batch)" dispatch.stats &&
+	BUDGET=$(flux module stats --parse "dispatch budget" $TESTMOD) &&
+	test $BUDGET -gt 0
+'
+
+test_expect_success 'flux module stats gets message pool statistics' '
+	flux module stats $TESTMOD >msgpool.stats &&
+	grep -q "#msgpool (msg hits)" msgpool.stats &&
+	grep -q "#msgpool (msg misses)" msgpool.stats &&
+	grep -q "#msgpool (buf hits)" msgpool.stats &&
+	grep -q "#msgpool (buf misses)" msgpool.stats
+'
+
 test_expect_success 'flux module stats --parse "#event (tx)" counts events' '
 	EVENT_TX=$(flux module stats --parse "#event (tx)" $TESTMOD) &&
 	flux event pub xyz &&
@@ -244,6 +262,26 @@ test_expect_success 'flux module stats --rusage --parse maxrss works' '
 	test "$RSS" -gt 0
 '
 
+test_expect_success 'flux module stats --reactor=on enables instrumentation' '
+	flux module stats --reactor=on $TESTMOD &&
+	flux module stats $TESTMOD >reactor.stats &&
+	grep -q "\"reactor\"" reactor.stats &&
+	COUNT=$(flux module stats --parse reactor.loop.count $TESTMOD) &&
+	test "$COUNT" -gt 0 &&
+	P99=$(flux module stats --parse reactor.loop.p99 $TESTMOD) &&
+	test -n "$P99"
+'
+
+test_expect_success 'flux module stats --reactor=off disables instrumentation' '
+	flux module stats --reactor=off $TESTMOD &&
+	flux module stats $TESTMOD >reactor-off.stats &&
+	! grep -q "\"reactor\"" reactor-off.stats
+'
+
+test_expect_success 'flux module stats --reactor=bad fails' '
+	test_must_fail flux module stats --reactor=bad $TESTMOD
+'
+
 # try to hit some error cases
 
 test_expect_success 'flux module with no arguments prints usage and fails' '
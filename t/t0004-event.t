@@ -83,4 +83,49 @@ test_expect_success 'event.pub request with empty payload fails with EPROTO(71)'
 	${RPC} event.pub 71 </dev/null
 '
 
+test_expect_success 'enable overlay event batching on all ranks' '
+	flux exec -n flux setattr tbon.event-batch-ms 10 &&
+	flux exec -n flux getattr tbon.event-batch-ms >batch_ms.out &&
+	test $(grep -c "^10$" batch_ms.out) -eq $SIZE
+'
+
+test_expect_success 'batched events from rank 0 received correctly on rank 0' '
+	run_timeout 15 \
+         $SHARNESS_TEST_SRCDIR/scripts/event-trace.lua \
+         t3 t3.eof \
+         $SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh t3 0 >trace &&
+         $SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh t3 >trace.expected &&
+         test_cmp trace.expected trace
+'
+
+test_expect_success 'batched heartbeat is received on all ranks' '
+	run_timeout 5 \
+          flux exec -n flux event sub --count=1 hb >output_event_sub2 &&
+	hb_count=`grep "^hb" output_event_sub2 | wc -l` &&
+        test $hb_count -eq $SIZE
+'
+
+test_expect_success 'overlay.stats.get reports batches sent on rank 0' '
+	${RPC} overlay.stats.get </dev/null >stats.out &&
+	jq -e ".\"event-batch\".\"batches-sent\" > 0" <stats.out
+'
+
+test_expect_success 'overlay.stats.get reports batches received on rank 1' '
+	flux exec -r 1 ${RPC} overlay.stats.get </dev/null >stats1.out &&
+	jq -e ".\"event-batch\".\"batches-recv\" > 0" <stats1.out
+'
+
+test_expect_success 'overlay.stats.get reports broker message pool reuse' '
+	jq -e ".\"msg-pool\".\"msg-hits\" > 0" <stats.out
+'
+
+test_expect_success 'publishing the reserved event batch topic fails with EPERM' '
+	test_must_fail flux event pub -s overlay.event-batch 2>batch_pub.err &&
+	grep "not permitted" batch_pub.err
+'
+
+test_expect_success 'disable overlay event batching on all ranks' '
+	flux exec -n flux setattr tbon.event-batch-ms 0
+'
+
 test_done
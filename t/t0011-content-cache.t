@@ -136,6 +136,143 @@ test_expect_success 'load and verify 1m blob on all ranks' '
 	test_cmp 1m.3.all.expect 1m.3.all.output
 '
 
+# Write compressible blob on rank 3
+# Verify on all ranks, and that compression was used on the TBON
+
+test_expect_success 'content.compression is lz4 by default' '
+	test "$(flux getattr content.compression)" = "lz4"
+'
+test_expect_success 'content.compression cannot be set to unknown value' '
+	test_must_fail flux setattr content.compression foo
+'
+test_expect_success 'store compressible blob on rank 3' '
+	dd if=/dev/zero count=16 bs=4096 >64k.3.store 2>/dev/null &&
+	flux exec -n --rank 3 sh -c "flux content store <64k.3.store >64k.3.hash"
+'
+test_expect_success 'load and verify compressible blob on all ranks' '
+	HASHSTR=`cat 64k.3.hash` &&
+	flux exec -n echo ${HASHSTR} >64k.3.all.expect &&
+	flux exec -n sh -c "flux content load ${HASHSTR} | $BLOBREF $HASHFUN" \
+						>64k.3.all.output &&
+	test_cmp 64k.3.all.expect 64k.3.all.output
+'
+test_expect_success 'rank 3 sent compressed blob upstream' '
+	SAVED=`flux exec -n -r 3 flux module stats --type int \
+		--parse compress-saved content` &&
+	test $SAVED -gt 0
+'
+test_expect_success 'rank 0 received compressed blob' '
+	COUNT=`flux module stats --type int --parse decompress-count content` &&
+	test $COUNT -gt 0
+'
+test_expect_success 'blob stored with compression disabled can be loaded' '
+	flux exec -n flux setattr content.compression none &&
+	dd if=/dev/zero count=32 bs=4096 >128k.3.store 2>/dev/null &&
+	flux exec -n --rank 3 sh -c \
+		"flux content store <128k.3.store >128k.3.hash" &&
+	HASHSTR=`cat 128k.3.hash` &&
+	flux exec -n echo ${HASHSTR} >128k.3.all.expect &&
+	flux exec -n sh -c "flux content load ${HASHSTR} | $BLOBREF $HASHFUN" \
+						>128k.3.all.output &&
+	test_cmp 128k.3.all.expect 128k.3.all.output &&
+	flux exec -n flux setattr content.compression lz4
+'
+test_expect_success 'store-batch of compressible blobs on rank 3' '
+	yes a | head -c 8192 >c1.3.store &&
+	yes b | head -c 8192 >c2.3.store &&
+	cat c1.3.store c2.3.store >c.3.expect &&
+	SAVED1=`flux exec -n -r 3 flux module stats --type int \
+		--parse compress-saved content` &&
+	COUNT1=`flux module stats --type int --parse decompress-count content` &&
+	flux exec -n -r 3 flux content store \
+		c1.3.store c2.3.store >c.3.hash &&
+	SAVED2=`flux exec -n -r 3 flux module stats --type int \
+		--parse compress-saved content` &&
+	COUNT2=`flux module stats --type int --parse decompress-count content` &&
+	test $SAVED2 -gt $SAVED1 &&
+	test $COUNT2 -ge $(($COUNT1+2))
+'
+test_expect_success 'load-batch of compressible blobs on rank 2' '
+	flux exec -n -r 2 flux content dropcache &&
+	COUNT1=`flux exec -n -r 2 flux module stats --type int \
+		--parse decompress-count content` &&
+	flux exec -n -r 2 sh -c "flux content load $(cat c.3.hash) \
+		| cmp - c.3.expect" &&
+	COUNT2=`flux exec -n -r 2 flux module stats --type int \
+		--parse decompress-count content` &&
+	test $COUNT2 -ge $(($COUNT1+2))
+'
+
+# Verify LRU accounting and the hard size limit on a rank > 0,
+# where loaded entries are clean and therefore eligible for purge
+
+test_expect_success 'repeated load on rank 2 is a cache hit' '
+	HASHSTR=`cat 4k.0.hash` &&
+	HIT1=`flux exec -n -r 2 flux module stats --type int \
+		--parse hit content` &&
+	flux exec -n -r 2 flux content load ${HASHSTR} >/dev/null &&
+	flux exec -n -r 2 flux content load ${HASHSTR} >/dev/null &&
+	HIT2=`flux exec -n -r 2 flux module stats --type int \
+		--parse hit content` &&
+	test $HIT2 -gt $HIT1
+'
+test_expect_success 'load of uncached blob on rank 2 is a cache miss' '
+	HASHSTR=`cat 1m.0.hash` &&
+	flux exec -n -r 2 flux content dropcache &&
+	MISS1=`flux exec -n -r 2 flux module stats --type int \
+		--parse miss content` &&
+	flux exec -n -r 2 flux content load ${HASHSTR} >/dev/null &&
+	MISS2=`flux exec -n -r 2 flux module stats --type int \
+		--parse miss content` &&
+	test $MISS2 -gt $MISS1
+'
+test_expect_success 'content.purge-max-size limits cache size on rank 2' '
+	HASHSTR=`cat 1m.0.hash` &&
+	flux exec -n -r 2 flux setattr content.purge-max-size 65536 &&
+	flux exec -n -r 2 flux content load ${HASHSTR} >/dev/null &&
+	SIZE=`flux exec -n -r 2 flux module stats --type int \
+		--parse size content` &&
+	EVICT=`flux exec -n -r 2 flux module stats --type int \
+		--parse evict content` &&
+	flux exec -n -r 2 flux setattr content.purge-max-size 0 &&
+	test $SIZE -le 65536 &&
+	test $EVICT -gt 0
+'
+
+# Batch load/store through the cache
+
+test_expect_success 'store-batch on rank 3 returns blobrefs in order' '
+	dd if=/dev/urandom count=1 bs=100 >b1.3.store 2>/dev/null &&
+	dd if=/dev/urandom count=1 bs=2000 >b2.3.store 2>/dev/null &&
+	dd if=/dev/urandom count=2 bs=4096 >b3.3.store 2>/dev/null &&
+	flux exec -n -r 3 flux content store \
+		b1.3.store b2.3.store b3.3.store >b.3.hash &&
+	for f in b1 b2 b3; do \
+		$BLOBREF $HASHFUN <$f.3.store; \
+	done >b.3.hash.expect &&
+	test_cmp b.3.hash.expect b.3.hash
+'
+test_expect_success 'load-batch on all ranks returns blobs in order' '
+	cat b1.3.store b2.3.store b3.3.store >b.3.expect &&
+	flux exec -n sh -c "flux content load $(cat b.3.hash) \
+		| cmp - b.3.expect"
+'
+test_expect_success 'load-batch on rank 2 mixes cache hits and misses' '
+	flux exec -n -r 2 flux content dropcache &&
+	flux exec -n -r 2 flux content load $(sed -n 1p b.3.hash) >/dev/null &&
+	flux exec -n -r 2 sh -c "flux content load $(cat b.3.hash) \
+		| cmp - b.3.expect"
+'
+test_expect_success 'load-batch of unknown blobref fails' '
+	NOENT=$(echo nonexistent-batch | $BLOBREF $HASHFUN) &&
+	test_must_fail flux exec -n -r 1 flux content load \
+		$(sed -n 1p b.3.hash) ${NOENT} >/dev/null 2>batch-noent.err &&
+	grep "No such file or directory" batch-noent.err
+'
+test_expect_success 'load-batch request with bad payload fails with EPROTO(71)' '
+	echo -n xyz | ${RPC} content.load-batch 71
+'
+
 # Simulate a lookup failure on all ranks
 # Store the thing we tried to look up so it should no longer fail
 # Verify that it can be retrieved on all ranks
@@ -110,6 +110,41 @@ test_expect_success 'exercise batching of synchronous flush to backing store' '
 	test ${NDIRTY} -eq 0
 '
 
+test_expect_success 'store-batch blobs bypassing cache' '
+	flux content store --bypass-cache \
+		0.0.store 64.0.store 4k.0.store 1m.0.store >batch.hash &&
+	cat 0.0.hash 64.0.hash 4k.0.hash 1m.0.hash >batch.hash.expect &&
+	test_cmp batch.hash.expect batch.hash
+'
+
+test_expect_success 'load-batch blobs bypassing cache' '
+	flux content load --bypass-cache $(cat batch.hash) >batch.load &&
+	cat 0.0.store 64.0.store 4k.0.store 1m.0.store >batch.load.expect &&
+	test_cmp batch.load.expect batch.load
+'
+
+test_expect_success 'load-batch with unknown blobref fails' '
+	NOENT=$(echo nonexistent | $BLOBREF $HASHFUN) &&
+	test_must_fail flux content load --bypass-cache \
+		$(cat 64.0.hash) ${NOENT} >/dev/null 2>noent.err &&
+	grep "No such file or directory" noent.err
+'
+
+test_expect_success 'load-batch blobs on all ranks after dropcache' '
+	flux exec -n flux content dropcache &&
+	flux exec -n sh -c "flux content load $(cat batch.hash) \
+		| cmp - batch.load.expect"
+'
+
+test_expect_success 'flush uses store-batch to backing store' '
+	flux setattr content.flush-batch-limit 64 &&
+	store_junk batchflush 200 &&
+	flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test ${NDIRTY} -eq 0 &&
+	flux setattr content.flush-batch-limit 256
+'
+
 kvs_checkpoint_put() {
         jq -j -c -n  "{key:\"$1\",value:\"$2\"}" | $RPC kvs-checkpoint.put
 }
@@ -157,6 +192,61 @@ test_expect_success 'content-backing.load invalid blobref fails' '
         $RPC content-backing.load 2 <bad.blobref 2>load.err
 '
 
+test_expect_success 'reload content-sqlite module with WAL journal' '
+	flux module reload content-sqlite \
+		journal_mode=WAL synchronous=NORMAL group-commit-max=16 &&
+	test -f $(flux getattr content.backing-path)-wal
+'
+
+test_expect_success 'load-batch blobs with WAL journal' '
+	flux content load --bypass-cache $(cat batch.hash) >batch.wal.load &&
+	test_cmp batch.load.expect batch.wal.load
+'
+
+test_expect_success 'store blobs with WAL journal and group commit' '
+	store_junk wal 100 &&
+	flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test ${NDIRTY} -eq 0
+'
+
+test_expect_success 'store blobs with group commit delay' '
+	flux module reload content-sqlite \
+		journal_mode=WAL group-commit-delay=0.01 &&
+	store_junk delay 100 &&
+	flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test ${NDIRTY} -eq 0
+'
+
+test_expect_success 'store blobs with group commit disabled' '
+	flux module reload content-sqlite group-commit-max=0 &&
+	store_junk nogroup 100 &&
+	flux content flush &&
+	NDIRTY=`flux module stats --type int --parse dirty content` &&
+	test ${NDIRTY} -eq 0
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.get foo still returns baz' '
+	kvs_checkpoint_get foo | jq -r .value >value4.out &&
+	test_cmp value3.exp value4.out
+'
+
+test_expect_success 'content-sqlite fails to load with bad synchronous level' '
+	flux module remove content-sqlite &&
+	test_must_fail flux module load content-sqlite synchronous=BAD
+'
+
+test_expect_success 'group-commit-max fails with journal_mode=OFF' '
+	test_must_fail flux module load content-sqlite \
+		journal_mode=OFF group-commit-max=16
+'
+
+test_expect_success 'content-sqlite fails to load with bad option' '
+	test_must_fail flux module load content-sqlite badopt=42 &&
+	flux module load content-sqlite
+'
+
 test_expect_success 'remove content-sqlite module on rank 0' '
 	flux module remove content-sqlite
 '
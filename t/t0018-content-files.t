@@ -148,6 +148,16 @@ test_expect_success HAVE_JQ 'kvs-checkpoint.get foo returns same value' '
         test_cmp value2.exp value2.out
 '
 
+test_expect_success 'store-batch/load-batch various size small blobs' '
+	for size in $SIZES; do make_blob $size >batch.$size; done &&
+	flux content store --bypass-cache \
+		$(for size in $SIZES; do echo batch.$size; done) >batch.refs &&
+	test $(wc -l <batch.refs) -eq $(echo $SIZES | wc -w) &&
+	flux content load --bypass-cache $(cat batch.refs) >batch.out &&
+	cat $(for size in $SIZES; do echo batch.$size; done) >batch.expect &&
+	test_cmp batch.expect batch.out
+'
+
 test_expect_success 'load with invalid blobref fails' '
 	test_must_fail backing_load notblobref 2>notblobref.err &&
 	grep "invalid blobref" notblobref.err
@@ -189,6 +199,12 @@ test_expect_success LONGTEST 'reload/verify various size large blobs through cac
 	test $err -eq 0
 '
 
+test_expect_success 'load-batch various size small blobs through cache' '
+	flux content dropcache &&
+	flux content load $(cat batch.refs) >batch.cache.out &&
+	test_cmp batch.expect batch.cache.out
+'
+
 test_expect_success 'remove content-files module' '
 	flux module remove content-files
 '
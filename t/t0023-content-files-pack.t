@@ -0,0 +1,199 @@
+#!/bin/sh
+
+test_description='Test content-files backing store service with packed storage'
+
+. `dirname $0`/sharness.sh
+
+test_under_flux 1 minimal
+
+RPC=${FLUX_BUILD_DIR}/t/request/rpc
+
+SIZES="0 1 64 100 1000 1024 1025 8192 65536 262144 1048576 4194304"
+
+##
+# Functions used by tests
+##
+
+# Usage: backing_load blobref
+backing_load() {
+        echo -n $1 | $RPC content-backing.load
+}
+# Usage: backing_store <blob >blobref
+backing_store() {
+        $RPC -r content-backing.store
+}
+# Usage: make_blob size >blob
+make_blob() {
+	if test $1 -eq 0; then
+		dd if=/dev/null 2>/dev/null
+	else
+		dd if=/dev/urandom count=1 bs=$1 2>/dev/null
+	fi
+}
+# Usage: check_blob size
+# Leaves behind blob.<size> and blobref.<size>
+check_blob() {
+	make_blob $1 >blob.$1 &&
+	backing_store <blob.$1 >blobref.$1 &&
+	backing_load $(cat blobref.$1) >blob.$1.check &&
+	test_cmp blob.$1 blob.$1.check
+}
+# Usage: check_blob size
+# Relies on existence of blob.<size> and blobref.<size>
+recheck_blob() {
+	backing_load $(cat blobref.$1) >blob.$1.recheck &&
+	test_cmp blob.$1 blob.$1.recheck
+}
+# Usage: kvs_checkpoint_put key value
+kvs_checkpoint_put() {
+        jq -j -c -n  "{key:\"$1\",value:\"$2\"}" | $RPC kvs-checkpoint.put
+}
+# Usage: kvs_checkpoint_get key >value
+kvs_checkpoint_get() {
+        jq -j -c -n  "{key:\"$1\"}" | $RPC kvs-checkpoint.get
+}
+
+test_expect_success 'load content-files module with invalid option fails' '
+	test_must_fail flux module load content-files testing pack \
+		segment-size=0 &&
+	test_must_fail flux module load content-files testing pack \
+		compact-period=x
+'
+
+test_expect_success 'load content-files module with pack option' '
+	flux module load content-files testing pack
+'
+
+test_expect_success 'packed store created a segment file' '
+	FILEDB=$(flux getattr content.backing-path) &&
+	test -f ${FILEDB}/pack.00000000
+'
+
+test_expect_success 'store/load/verify various size small blobs' '
+	err=0 &&
+	for size in $SIZES; do \
+		if ! check_blob $size; then err=$(($err+1)); fi; \
+	done &&
+	test $err -eq 0
+'
+
+test_expect_success 'storing the same blob again returns the same blobref' '
+	backing_store <blob.1024 >blobref.1024.again &&
+	test_cmp blobref.1024 blobref.1024.again
+'
+
+test_expect_success 'load of unknown blobref fails' '
+	test_must_fail backing_load \
+		sha1-0000000000000000000000000000000000000000 2>unknown.err &&
+	grep "No such file or directory" unknown.err
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.put foo=bar' '
+        kvs_checkpoint_put foo bar
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.get foo returned bar' '
+        echo bar >value.exp &&
+        kvs_checkpoint_get foo | jq -r .value >value.out &&
+        test_cmp value.exp value.out
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.put updates foo=baz' '
+        kvs_checkpoint_put foo baz
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.get foo returned baz' '
+        echo baz >value2.exp &&
+        kvs_checkpoint_get foo | jq -r .value >value2.out &&
+        test_cmp value2.exp value2.out
+'
+
+test_expect_success 'store-batch/load-batch various size small blobs' '
+	for size in $SIZES; do make_blob $size >batch.$size; done &&
+	flux content store --bypass-cache \
+		$(for size in $SIZES; do echo batch.$size; done) >batch.refs &&
+	test $(wc -l <batch.refs) -eq $(echo $SIZES | wc -w) &&
+	flux content load --bypass-cache $(cat batch.refs) >batch.out &&
+	cat $(for size in $SIZES; do echo batch.$size; done) >batch.expect &&
+	test_cmp batch.expect batch.out
+'
+
+test_expect_success 'reload content-files module' '
+	flux module reload content-files testing pack
+'
+
+test_expect_success 'module unload persisted the index' '
+	test -f ${FILEDB}/pack.index
+'
+
+test_expect_success 'reload/verify various size small blobs' '
+	err=0 &&
+	for size in $SIZES; do \
+		if ! recheck_blob $size; then err=$(($err+1)); fi; \
+	done &&
+	test $err -eq 0
+'
+
+test_expect_success HAVE_JQ 'kvs-checkpoint.get foo returns same value' '
+        kvs_checkpoint_get foo | jq -r .value >value2.out &&
+        test_cmp value2.exp value2.out
+'
+
+test_expect_success 'reload without index recovers content by scanning' '
+	flux module remove content-files &&
+	rm -f ${FILEDB}/pack.index &&
+	flux module load content-files testing pack &&
+	flux content load --bypass-cache $(cat batch.refs) >batch.scan.out &&
+	test_cmp batch.expect batch.scan.out
+'
+
+test_expect_success 'reload with small segments and frequent compaction' '
+	flux module reload content-files testing pack \
+		segment-size=4096 compact-period=0.1
+'
+
+test_expect_success HAVE_JQ 'overwrite checkpoint many times' '
+	pad=$(printf "%0200d" 0) &&
+	for i in $(seq 1 200); do \
+		kvs_checkpoint_put foo $pad$i || return 1; \
+	done &&
+	echo ${pad}200 >value3.exp &&
+	kvs_checkpoint_get foo | jq -r .value >value3.out &&
+	test_cmp value3.exp value3.out
+'
+
+test_expect_success HAVE_JQ 'dead segments are compacted away' '
+	sleep 0.5 &&
+	ls ${FILEDB}/pack.0* >segments.out &&
+	test $(wc -l <segments.out) -le 4
+'
+
+test_expect_success 'blobs are intact after compaction' '
+	flux content load --bypass-cache $(cat batch.refs) >batch.compact.out &&
+	test_cmp batch.expect batch.compact.out &&
+	err=0 &&
+	for size in $SIZES; do \
+		if ! recheck_blob $size; then err=$(($err+1)); fi; \
+	done &&
+	test $err -eq 0
+'
+
+test_expect_success 'reload content-files module without testing option' '
+	flux module reload content-files pack
+'
+
+test_expect_success 'verify content.backing-module=content-files' '
+        test "$(flux getattr content.backing-module)" = "content-files"
+'
+
+test_expect_success 'load-batch various size small blobs through cache' '
+	flux content dropcache &&
+	flux content load $(cat batch.refs) >batch.cache.out &&
+	test_cmp batch.expect batch.cache.out
+'
+
+test_expect_success 'remove content-files module' '
+	flux module remove content-files
+'
+
+test_done
@@ -0,0 +1,96 @@
+#!/bin/sh
+#
+
+test_description='Test the local connector with shared memory rings
+
+Run RPC and event tests with FLUX_LOCAL_CONNECTOR_SHM set, once with
+the default ring size, and once with the minimum (64K) ring size so that
+large messages are redirected to the socket.'
+
+. `dirname $0`/sharness.sh
+SIZE=4
+LASTRANK=$(($SIZE-1))
+test_under_flux ${SIZE} minimal
+
+RPC=${FLUX_BUILD_DIR}/t/request/rpc
+
+# Succeed if a connected python client has a shared memory ring mapped
+has_shmring() {
+	flux python -c "
+import flux, os
+h = flux.Flux()
+links = []
+for f in os.listdir('/proc/self/fd'):
+    try:
+        links.append(os.readlink('/proc/self/fd/' + f))
+    except OSError:
+        pass
+assert any('flux-shmring' in l for l in links)
+"
+}
+
+test_expect_success 'FLUX_LOCAL_CONNECTOR_SHM=0 uses the socket' '
+	(export FLUX_LOCAL_CONNECTOR_SHM=0 && test_must_fail has_shmring)
+'
+test_expect_success 'FLUX_LOCAL_CONNECTOR_SHM=3 (not a power of 2) fails' '
+	test_must_fail env FLUX_LOCAL_CONNECTOR_SHM=3 flux getattr rank
+'
+test_expect_success 'FLUX_LOCAL_CONNECTOR_SHM=foo fails' '
+	test_must_fail env FLUX_LOCAL_CONNECTOR_SHM=foo flux getattr rank
+'
+
+for shm in 1 65536; do
+	export FLUX_LOCAL_CONNECTOR_SHM=$shm
+
+	test_expect_success "shm=$shm: client attaches shared memory rings" '
+		has_shmring
+	'
+	test_expect_success "shm=$shm: ping 1K 10K byte echo requests" '
+		run_timeout 20 flux ping --pad 10240 --count 1024 --interval 0 0
+	'
+	test_expect_success "shm=$shm: ping 100 100K byte echo requests" '
+		run_timeout 15 flux ping --pad 102400 --count 100 --interval 0 0
+	'
+	test_expect_success "shm=$shm: ping 10 1M byte echo requests (batched)" '
+		run_timeout 15 \
+			flux ping --pad 1048576 --count 10 --batch --interval 0 0
+	'
+	test_expect_success "shm=$shm: ping --rank $LASTRANK works" '
+		run_timeout 15 flux ping --rank $LASTRANK --count 10 \
+			--interval 0 broker
+	'
+	test_expect_success "shm=$shm: RPC to unknown service fails with ENOSYS" '
+		echo {} | ${RPC} nosuchservice.foo 38
+	'
+	test_expect_success "shm=$shm: heartbeat is received on all ranks" '
+		run_timeout 5 \
+			flux exec -n flux event sub --count=1 hb >hb.$shm &&
+		test $(grep "^hb" hb.$shm | wc -l) -eq $SIZE
+	'
+	test_expect_success "shm=$shm: events from rank 0 received correctly" '
+		run_timeout 15 \
+			$SHARNESS_TEST_SRCDIR/scripts/event-trace.lua \
+			t1 t1.eof \
+			$SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh \
+			t1 0 >trace.0.$shm &&
+		$SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh \
+			t1 >trace.0.$shm.expected &&
+		test_cmp trace.0.$shm.expected trace.0.$shm
+	'
+	test_expect_success "shm=$shm: events from rank $LASTRANK received correctly" '
+		run_timeout 15 \
+			$SHARNESS_TEST_SRCDIR/scripts/event-trace.lua \
+			t2 t2.eof \
+			$SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh \
+			t2 $LASTRANK >trace.$LASTRANK.$shm &&
+		$SHARNESS_TEST_SRCDIR/scripts/t0004-event-helper.sh \
+			t2 >trace.$LASTRANK.$shm.expected &&
+		test_cmp trace.$LASTRANK.$shm.expected trace.$LASTRANK.$shm
+	'
+	test_expect_success "shm=$shm: publish large raw event (synchronous)" '
+		run_timeout 5 flux event pub -s -r foo.bar $(printf "%0100000d" 0)
+	'
+done
+unset FLUX_LOCAL_CONNECTOR_SHM
+
+test_done
@@ -121,6 +121,15 @@ test_expect_success 'kvs: test that KVS_NO_MERGE works with kvs_commit()' '
 	test "$OUTPUT" = "${THREADS}"
 '
 
+# prefetch-fanout option test
+test_expect_success 'kvs: walk 16x3 directory tree with prefetch enabled' '
+	${FLUX_BUILD_DIR}/t/kvs/dtree -h3 -w16 --prefix $DIR.prefetch &&
+	flux module reload kvs prefetch-fanout=16 &&
+	test $(flux kvs dir -R $DIR.prefetch | wc -l) = 4096 &&
+	PREFETCH=$(flux module stats --parse "cache.#prefetch" kvs) &&
+	test ${PREFETCH} -gt 0
+'
+
 # All tests below assume transaction-merge=0
 
 # transaction-merge option test
@@ -232,6 +232,48 @@ test_expect_success 'kvs: removed namespace not listed' '
         ! flux kvs namespace list | grep $NAMESPACETMP-BASIC
 '
 
+#
+# Namespace with binary treeobj encoding
+#
+
+test_expect_success 'kvs: namespace create --binary works' '
+	flux kvs namespace create --binary $NAMESPACETMP-BINARY &&
+        flux kvs namespace list | grep $NAMESPACETMP-BINARY | grep 0x00000001
+'
+
+test_expect_success 'kvs: put/get/dir in binary namespace works' '
+        flux kvs put --namespace=$NAMESPACETMP-BINARY $DIR.a=4 $DIR.b=5 &&
+        flux kvs put --namespace=$NAMESPACETMP-BINARY $DIR.sub.c=6 &&
+        test_kvs_key_namespace $NAMESPACETMP-BINARY $DIR.sub.c 6 &&
+        flux kvs dir -R --namespace=$NAMESPACETMP-BINARY $DIR | sort > output &&
+        cat >expected <<EOF &&
+$DIR.a = 4
+$DIR.b = 5
+$DIR.sub.c = 6
+EOF
+        test_cmp expected output
+'
+
+test_expect_success 'kvs: binary namespace directory is stored in binary' '
+        flux kvs get --namespace=$NAMESPACETMP-BINARY --treeobj $DIR \
+            | grep -q \"dirref\" &&
+        ref=$(flux kvs get --namespace=$NAMESPACETMP-BINARY --treeobj $DIR \
+            | grep -o "sha[0-9]*-[0-9a-f]*") &&
+        flux content load $ref | head -c 3 | tail -c 2 > magic &&
+        printf TO > magic.expected &&
+        test_cmp magic.expected magic
+'
+
+test_expect_success 'kvs: binary namespace can be read on other ranks' '
+        flux exec -n -r 1 sh -c "flux kvs get --namespace=$NAMESPACETMP-BINARY $DIR.sub.c" > output &&
+        echo 6 > expected &&
+        test_cmp expected output
+'
+
+test_expect_success 'kvs: binary namespace remove works' '
+	flux kvs namespace remove $NAMESPACETMP-BINARY
+'
+
 #
 # Basic tests, data in new namespace available across ranks
 #
@@ -46,6 +46,31 @@ test_expect_success NO_CHAIN_LINT 'kvs-watch stats reports active watcher' '
        wait $pid
 '
 
+test_expect_success NO_CHAIN_LINT 'kvs-watch shares lookups among watchers of one key' '
+       flux kvs put test.shared=0 &&
+       before=$(flux module stats --parse=lookups-shared kvs-watch) &&
+       pids="" &&
+       for i in 1 2 3 4; do
+               flux kvs get --watch --count=2 test.shared >shared$i.out &
+               pids="$pids $!"
+       done &&
+       for i in 1 2 3 4; do
+               $waitfile --count=1 --timeout=10 --pattern="[0-9]+" \
+                       shared$i.out || return 1
+       done &&
+       count=$(flux module stats --parse=watchers kvs-watch) &&
+       test $count -eq 4 &&
+       flux kvs put --no-merge test.shared=1 &&
+       wait $pids &&
+       for i in 1 2 3 4; do
+               printf "0\n1\n" | test_cmp - shared$i.out || return 1
+       done &&
+       after=$(flux module stats --parse=lookups-shared kvs-watch) &&
+       test $after -eq $(($before+3)) &&
+       count=$(flux module stats --parse=lookups kvs-watch) &&
+       test $count -eq 0
+'
+
 # Check that stdin contains an integer on each line that
 # is one more than the integer on the previous line.
 test_monotonicity() {
@@ -437,6 +462,47 @@ e
         test_cmp expected append9.out
 '
 
+test_expect_success NO_CHAIN_LINT 'flux kvs get: --append works through a symlink' '
+        flux kvs unlink -Rf test &&
+        flux kvs put test.append.test="abc" &&
+        flux kvs link test.append.test test.append.link &&
+        flux kvs get --watch --append --count=4 \
+                     test.append.link > append11.out 2>&1 &
+        pid=$! &&
+        wait_watcherscount_nonzero primary &&
+        flux kvs put --append test.append.test="d" &&
+        flux kvs put --append test.append.test="e" &&
+        flux kvs put --append test.append.test="f" &&
+        wait $pid &&
+	cat >expected <<-EOF &&
+abc
+d
+e
+f
+	EOF
+        test_cmp expected append11.out
+'
+
+test_expect_success NO_CHAIN_LINT 'flux kvs get: --append sends only new data of a long value' '
+        flux kvs unlink -Rf test &&
+        flux kvs put test.append.test="0" &&
+        before=$(flux module stats --parse=append-blobs-loaded kvs-watch) &&
+        flux kvs get --watch --append --count=101 \
+                     test.append.test > append12.out 2>&1 &
+        pid=$! &&
+        wait_watcherscount_nonzero primary &&
+        for i in $(seq 1 100); do
+                flux kvs put --append test.append.test="$i" || return 1
+        done &&
+        wait $pid &&
+        seq 0 100 >expected &&
+        test_cmp expected append12.out &&
+        after=$(flux module stats --parse=append-blobs-loaded kvs-watch) &&
+        loaded=$(($after-$before)) &&
+        echo "loaded $loaded blobs for 101 values" &&
+        test $loaded -le 101
+'
+
 test_expect_success NO_CHAIN_LINT 'flux kvs get: --append fails on shortened write' '
         flux kvs unlink -Rf test &&
         flux kvs put test.append.test="abc" &&
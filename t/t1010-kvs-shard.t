@@ -0,0 +1,100 @@
+#!/bin/sh
+#
+
+test_description='Test KVS directory sharding
+
+Store directories larger than the kvs shard-threshold module option,
+which are split into hashed directory (hdir) shards.'
+
+# Append --logfile option if FLUX_TESTS_LOGFILE is set in environment:
+test -n "$FLUX_TESTS_LOGFILE" && set -- "$@" --logfile
+. `dirname $0`/sharness.sh
+
+test_under_flux 1
+
+# Usage: dirref_blobref key
+dirref_blobref() {
+	flux kvs get --treeobj $1 | sed -e 's/.*"data":\["\([^"]*\)".*/\1/'
+}
+
+# Usage: put_keys dir count
+put_keys() {
+	for i in $(seq 0 $(($2-1))); do
+		echo "$1.key$i=$i"
+	done >puts.$1 &&
+	flux kvs put $(cat puts.$1)
+}
+
+# Usage: expected_dir dir count
+expected_dir() {
+	for i in $(seq 0 $(($2-1))); do
+		echo "$1.key$i = $i"
+	done | sort
+}
+
+test_expect_success 'reload kvs with shard-threshold=8' '
+	flux module reload kvs shard-threshold=8
+'
+test_expect_success 'put 200 keys in one directory' '
+	put_keys test.big 200
+'
+test_expect_success 'directory was stored as an hdir' '
+	ref=$(dirref_blobref test.big) &&
+	flux content load $ref | grep -q \"hdir\"
+'
+test_expect_success 'get keys from the sharded directory' '
+	test $(flux kvs get test.big.key0) = 0 &&
+	test $(flux kvs get test.big.key99) = 99 &&
+	test $(flux kvs get test.big.key199) = 199 &&
+	test_must_fail flux kvs get test.big.nokey
+'
+test_expect_success 'dir -R lists every key of the sharded directory' '
+	expected_dir test.big 200 >expected &&
+	flux kvs dir -R test.big | sort >output &&
+	test_cmp expected output
+'
+test_expect_success 'ls lists every key of the sharded directory' '
+	flux kvs ls -1 test.big | wc -l >count &&
+	test $(cat count) -eq 200
+'
+test_expect_success 'update, add, and unlink keys in the sharded directory' '
+	flux kvs put test.big.key5=five test.big.key200=200 &&
+	flux kvs unlink test.big.key7 &&
+	test $(flux kvs get test.big.key5) = five &&
+	test $(flux kvs get test.big.key200) = 200 &&
+	test_must_fail flux kvs get test.big.key7
+'
+test_expect_success 'dir -R reflects the updates' '
+	expected_dir test.big 201 \
+		| sed -e "s/^test.big.key5 = 5$/test.big.key5 = five/" \
+		| grep -v "^test.big.key7 = " >expected2 &&
+	flux kvs dir -R test.big | sort >output2 &&
+	test_cmp expected2 output2
+'
+test_expect_success 'sharded subdirectories work' '
+	put_keys test.big.sub 50 &&
+	expected_dir test.big.sub 50 >expected.sub &&
+	flux kvs dir -R test.big.sub | sort >output.sub &&
+	test_cmp expected.sub output.sub
+'
+test_expect_success 'reload kvs without shard-threshold' '
+	flux module reload kvs
+'
+test_expect_success 'sharded directory survives kvs reload' '
+	flux kvs dir -R test.big | grep -v "^test.big.sub." | sort >output3 &&
+	test_cmp expected2 output3 &&
+	test $(flux kvs get test.big.sub.key49) = 49
+'
+test_expect_success 'run instance with sharding and content.backing-path' '
+	flux start -o,--setattr=content.backing-path=$(pwd)/content.sqlite \
+		sh -c "flux module reload kvs shard-threshold=8 && \
+		       flux kvs put $(cat puts.test.big)" &&
+	test -f content.sqlite
+'
+test_expect_success 're-run instance and list the sharded directory' '
+	flux start -o,--setattr=content.backing-path=$(pwd)/content.sqlite \
+		flux kvs dir -R test.big | sort >output4 &&
+	expected_dir test.big 200 >expected4 &&
+	test_cmp expected4 output4
+'
+test_done
@@ -256,6 +256,22 @@ test_expect_success HAVE_JQ 'flux job list only completed jobs' '
         test_cmp completed.ids list_result_completed.out
 '
 
+test_expect_success HAVE_JQ 'flux job list canceled and failed jobs of all users' '
+        id=4294967295 &&
+        state=`${JOB_CONV} strtostate INACTIVE` &&
+        result=$((`${JOB_CONV} strtoresult CANCELED` | `${JOB_CONV} strtoresult FAILED`)) &&
+        $jq -j -c -n  "{max_entries:1000, userid:${id}, states:${state}, results:${result}, attrs:[]}" \
+          | $RPC job-info.list | $jq .jobs | $jq -c '.[]' | $jq .id > list_result_canceled_failed.out &&
+        cat canceled.ids failed.ids > list_result_canceled_failed.exp &&
+        test_cmp list_result_canceled_failed.exp list_result_canceled_failed.out
+'
+
+test_expect_success HAVE_JQ 'flux job list jobs of user with no jobs' '
+        id=$(($(id -u) + 1)) &&
+        $jq -j -c -n  "{max_entries:1000, userid:${id}, states:0, results:0, attrs:[]}" \
+          | $RPC job-info.list | $jq -e ".jobs == []"
+'
+
 # Note: "pending" = "depend" | "sched", we also test just "sched"
 # state since we happen to know all these jobs are in the "sched"
 # state given checks above
@@ -417,6 +433,22 @@ test_expect_success HAVE_JQ 'job-info: list successfully reconstructed' '
         test_cmp before_reload.out after_reload.out
 '
 
+test_expect_success HAVE_JQ 'job-info: checkpoint saved on unload' '
+        flux kvs get checkpoint.job-info | jq -e ".version == 1"
+'
+
+test_expect_success 'job-info: reload with invalid checkpoint' '
+        flux module remove job-info &&
+        flux kvs put checkpoint.job-info="{}" &&
+        flux module load job-info &&
+        wait_inactive
+'
+
+test_expect_success HAVE_JQ 'job-info: list reconstructed without checkpoint' '
+        flux job list -a > after_reload2.out &&
+        test_cmp before_reload.out after_reload2.out
+'
+
 test_expect_success HAVE_JQ 'job stats lists jobs in correct state (all inactive)' '
         flux job stats | jq -e ".job_states.depend == 0" &&
         flux job stats | jq -e ".job_states.priority == 0" &&